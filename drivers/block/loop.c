@@ -52,6 +52,7 @@
 #include <linux/module.h>
 #include <linux/moduleparam.h>
 #include <linux/sched.h>
+#include <linux/sched/mm.h>
 #include <linux/fs.h>
 #include <linux/file.h>
 #include <linux/stat.h>
@@ -77,6 +78,7 @@
 #include <linux/falloc.h>
 #include <linux/uio.h>
 #include <linux/ioprio.h>
+#include <linux/topology.h>
 
 #include "loop.h"
 
@@ -88,6 +90,20 @@ static DEFINE_MUTEX(loop_index_mutex);
 static int max_part;
 static int part_shift;
 
+/*
+ * Read-only devices (APEX and other image-backed mounts) have no order
+ * to keep between their requests, so they get a hardware queue per CPU,
+ * or per cluster, and each request is served by a worker of the CPU it
+ * was issued on. Writable devices keep a worker of their own, so writes,
+ * flushes and discards reach the backing file in the order the device
+ * took them.
+ */
+static bool multi_queue = true;
+static bool queue_per_cluster;
+static unsigned int loop_nr_hw_queues = 1;
+static unsigned int loop_cpu_queue[NR_CPUS];
+static struct workqueue_struct *loop_wq;
+
 static int transfer_xor(struct loop_device *lo, int cmd,
 			struct page *raw_page, unsigned raw_off,
 			struct page *loop_page, unsigned loop_off,
@@ -1048,9 +1064,12 @@ static int loop_configure(struct loop_device *lo, fmode_t mode,
 	    !file->f_op->write_iter)
 		lo->lo_flags |= LO_FLAGS_READ_ONLY;
 
-	error = loop_prepare_queue(lo);
-	if (error)
-		goto out_putf;
+	lo->ordered = !loop_wq || !(lo->lo_flags & LO_FLAGS_READ_ONLY);
+	if (lo->ordered) {
+		error = loop_prepare_queue(lo);
+		if (error)
+			goto out_putf;
+	}
 
 	error = 0;
 
@@ -1181,7 +1200,9 @@ static int loop_clr_fd(struct loop_device *lo)
 	lo->lo_flags = 0;
 	if (!part_shift)
 		lo->lo_disk->flags |= GENHD_FL_NO_PART_SCAN;
-	loop_unprepare_queue(lo);
+	/* the queue was frozen, nothing is left on the shared workers */
+	if (lo->ordered)
+		loop_unprepare_queue(lo);
 	mutex_unlock(&lo->lo_ctl_mutex);
 	/*
 	 * Need not hold lo_ctl_mutex to fput backing file.
@@ -1796,6 +1817,10 @@ module_param(max_loop, int, S_IRUGO);
 MODULE_PARM_DESC(max_loop, "Maximum number of loop devices");
 module_param(max_part, int, S_IRUGO);
 MODULE_PARM_DESC(max_part, "Maximum number of partitions per loop device");
+module_param(multi_queue, bool, S_IRUGO);
+MODULE_PARM_DESC(multi_queue, "Serve read-only devices from per-CPU workers");
+module_param(queue_per_cluster, bool, S_IRUGO);
+MODULE_PARM_DESC(queue_per_cluster, "One hardware queue per cluster instead of per CPU");
 MODULE_LICENSE("GPL");
 MODULE_ALIAS_BLOCKDEV_MAJOR(LOOP_MAJOR);
 
@@ -1859,7 +1884,10 @@ static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 		break;
 	}
 
-	kthread_queue_work(&lo->worker, &cmd->work);
+	if (lo->ordered)
+		kthread_queue_work(&lo->worker, &cmd->work);
+	else
+		queue_work(loop_wq, &cmd->mq_work);
 
 	return BLK_STS_OK;
 }
@@ -1892,6 +1920,26 @@ static void loop_queue_work(struct kthread_work *work)
 	loop_handle_cmd(cmd);
 }
 
+static void loop_mq_work(struct work_struct *work)
+{
+	struct loop_cmd *cmd =
+		container_of(work, struct loop_cmd, mq_work);
+	bool less_throttle = !(current->flags & PF_LESS_THROTTLE);
+	unsigned int noio_flags;
+
+	/*
+	 * What loop_kthread_worker_fn sets for the whole thread, only for
+	 * this command: the kworker is shared, so leave its other flags be.
+	 */
+	noio_flags = memalloc_noio_save();
+	if (less_throttle)
+		current->flags |= PF_LESS_THROTTLE;
+	loop_handle_cmd(cmd);
+	if (less_throttle)
+		current->flags &= ~PF_LESS_THROTTLE;
+	memalloc_noio_restore(noio_flags);
+}
+
 static int loop_init_request(struct blk_mq_tag_set *set, struct request *rq,
 		unsigned int hctx_idx, unsigned int numa_node)
 {
@@ -1899,6 +1947,17 @@ static int loop_init_request(struct blk_mq_tag_set *set, struct request *rq,
 
 	cmd->rq = rq;
 	kthread_init_work(&cmd->work, loop_queue_work);
+	INIT_WORK(&cmd->mq_work, loop_mq_work);
+
+	return 0;
+}
+
+static int loop_map_queues(struct blk_mq_tag_set *set)
+{
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu)
+		set->mq_map[cpu] = loop_cpu_queue[cpu];
 
 	return 0;
 }
@@ -1907,8 +1966,30 @@ static const struct blk_mq_ops loop_mq_ops = {
 	.queue_rq       = loop_queue_rq,
 	.init_request	= loop_init_request,
 	.complete	= lo_complete_rq,
+	.map_queues	= loop_map_queues,
 };
 
+/* CPUs of a cluster share the queue of the first of them */
+static void __init loop_init_queue_map(void)
+{
+	unsigned int cpu, first, nr = 0;
+
+	if (!multi_queue)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		for_each_possible_cpu(first) {
+			if (first == cpu || (queue_per_cluster &&
+			    topology_physical_package_id(first) ==
+			    topology_physical_package_id(cpu)))
+				break;
+		}
+		loop_cpu_queue[cpu] = first == cpu ? nr++ :
+				      loop_cpu_queue[first];
+	}
+	loop_nr_hw_queues = nr;
+}
+
 static int loop_add(struct loop_device **l, int i)
 {
 	struct loop_device *lo;
@@ -1936,8 +2017,12 @@ static int loop_add(struct loop_device **l, int i)
 
 	err = -ENOMEM;
 	lo->tag_set.ops = &loop_mq_ops;
-	lo->tag_set.nr_hw_queues = 1;
-	lo->tag_set.queue_depth = 128;
+	lo->tag_set.nr_hw_queues = loop_nr_hw_queues;
+	/*
+	 * The 128 tags of a single queue split over the queues, so the total
+	 * stays at 128 up to eight queues and only grows past that.
+	 */
+	lo->tag_set.queue_depth = max(128U / loop_nr_hw_queues, 16U);
 	lo->tag_set.numa_node = NUMA_NO_NODE;
 	lo->tag_set.cmd_size = sizeof(struct loop_cmd);
 	lo->tag_set.flags = BLK_MQ_F_SHOULD_MERGE | BLK_MQ_F_SG_MERGE;
@@ -2195,9 +2280,19 @@ static int __init loop_init(void)
 		range = 1UL << MINORBITS;
 	}
 
+	loop_init_queue_map();
+	if (multi_queue) {
+		loop_wq = alloc_workqueue("kloopd",
+					  WQ_MEM_RECLAIM | WQ_HIGHPRI, 0);
+		if (!loop_wq) {
+			err = -ENOMEM;
+			goto err_out;
+		}
+	}
+
 	err = misc_register(&loop_misc);
 	if (err < 0)
-		goto err_out;
+		goto wq_out;
 
 
 	if (register_blkdev(LOOP_MAJOR, "loop")) {
@@ -2219,6 +2314,9 @@ static int __init loop_init(void)
 
 misc_out:
 	misc_deregister(&loop_misc);
+wq_out:
+	if (loop_wq)
+		destroy_workqueue(loop_wq);
 err_out:
 	return err;
 }
@@ -2244,6 +2342,9 @@ static void __exit loop_exit(void)
 	unregister_blkdev(LOOP_MAJOR, "loop");
 
 	misc_deregister(&loop_misc);
+
+	if (loop_wq)
+		destroy_workqueue(loop_wq);
 }
 
 module_init(loop_init);
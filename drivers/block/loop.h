@@ -15,6 +15,7 @@
 #include <linux/spinlock.h>
 #include <linux/mutex.h>
 #include <linux/kthread.h>
+#include <linux/workqueue.h>
 #include <uapi/linux/loop.h>
 
 /* Possible states of device */
@@ -57,6 +58,7 @@ struct loop_device {
 	struct mutex		lo_ctl_mutex;
 	struct kthread_worker	worker;
 	struct task_struct	*worker_task;
+	bool			ordered;	/* served by worker above */
 	bool			use_dio;
 	bool			sysfs_inited;
 
@@ -67,6 +69,7 @@ struct loop_device {
 
 struct loop_cmd {
 	struct kthread_work work;
+	struct work_struct mq_work;
 	struct request *rq;
 	bool use_aio; /* use AIO interface to handle I/O */
 	atomic_t ref; /* only for aio */
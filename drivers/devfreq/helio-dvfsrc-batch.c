@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See http://www.gnu.org/licenses/gpl-2.0.html for more details.
+ */
+
+#include <linux/bitops.h>
+#include <linux/bug.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/string.h>
+
+#include "helio-dvfsrc-batch.h"
+
+static enum hrtimer_restart dvfsrc_batch_timer(struct hrtimer *timer)
+{
+	struct dvfsrc_batch *b = container_of(timer, struct dvfsrc_batch,
+					      timer);
+
+	/* commit() sleeps, leave it to the worker */
+	queue_work(system_highpri_wq, &b->work);
+
+	return HRTIMER_NORESTART;
+}
+
+static void dvfsrc_batch_work(struct work_struct *work)
+{
+	dvfsrc_batch_flush(container_of(work, struct dvfsrc_batch, work));
+}
+
+/* Commits whatever is pending, now, in the caller's context */
+void dvfsrc_batch_flush(struct dvfsrc_batch *b)
+{
+	unsigned long flags, mask;
+	ktime_t first;
+	u64 wait;
+
+	mutex_lock(&b->commit_lock);
+
+	spin_lock_irqsave(&b->lock, flags);
+	mask = b->pending;
+	first = b->first;
+	b->pending = 0;
+	memcpy(b->committed, b->vote, sizeof(b->committed));
+	if (b->armed) {
+		/* a timer already firing finds nothing left to do */
+		hrtimer_try_to_cancel(&b->timer);
+		b->armed = false;
+	}
+	spin_unlock_irqrestore(&b->lock, flags);
+
+	if (mask) {
+		b->commit(b, b->committed, mask);
+		wait = ktime_to_ns(ktime_sub(ktime_get(), first));
+
+		spin_lock_irqsave(&b->lock, flags);
+		b->nr_commit++;
+		b->max_wait_ns = max(b->max_wait_ns, wait);
+		spin_unlock_irqrestore(&b->lock, flags);
+	}
+
+	mutex_unlock(&b->commit_lock);
+}
+EXPORT_SYMBOL_GPL(dvfsrc_batch_flush);
+
+/* Called from pm_qos notifiers, may sleep */
+void dvfsrc_batch_vote(struct dvfsrc_batch *b, int cls, int val)
+{
+	unsigned long flags;
+	bool now;
+
+	if (WARN_ON(cls < 0 || cls >= DVFSRC_BATCH_MAX))
+		return;
+
+	spin_lock_irqsave(&b->lock, flags);
+	b->vote[cls] = val;
+	if (!b->pending)
+		b->first = ktime_get();
+	b->pending |= BIT(cls);
+	b->nr_vote++;
+
+	now = (b->urgent & BIT(cls)) || !b->delay_us;
+	if (now) {
+		b->nr_urgent++;
+	} else if (!b->armed) {
+		b->armed = true;
+		hrtimer_start(&b->timer, ns_to_ktime((u64)b->delay_us *
+			      NSEC_PER_USEC), HRTIMER_MODE_REL);
+	}
+	spin_unlock_irqrestore(&b->lock, flags);
+
+	if (now)
+		dvfsrc_batch_flush(b);
+}
+EXPORT_SYMBOL_GPL(dvfsrc_batch_vote);
+
+char *dvfsrc_batch_info(struct dvfsrc_batch *b, char *p, char *end)
+{
+	unsigned long flags;
+	u64 vote, commit, urgent, wait;
+
+	unsigned long urgent_mask;
+	unsigned int delay_us;
+
+	spin_lock_irqsave(&b->lock, flags);
+	vote = b->nr_vote;
+	commit = b->nr_commit;
+	urgent = b->nr_urgent;
+	wait = b->max_wait_ns;
+	urgent_mask = b->urgent;
+	delay_us = b->delay_us;
+	spin_unlock_irqrestore(&b->lock, flags);
+
+	p += snprintf(p, end - p, "%-24s: %u us, urgent 0x%lx\n",
+			"batch delay", delay_us, urgent_mask);
+	p += snprintf(p, end - p, "%-24s: %llu (%llu urgent)\n",
+			"batch votes", vote, urgent);
+	p += snprintf(p, end - p, "%-24s: %llu\n", "batch commits", commit);
+	p += snprintf(p, end - p, "%-24s: %llu ns\n",
+			"batch max wait", wait);
+
+	return p;
+}
+EXPORT_SYMBOL_GPL(dvfsrc_batch_info);
+
+/* Takes effect from the next vote on, a batch already armed keeps its timer */
+void dvfsrc_batch_set_delay(struct dvfsrc_batch *b, unsigned int delay_us)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&b->lock, flags);
+	b->delay_us = delay_us;
+	spin_unlock_irqrestore(&b->lock, flags);
+}
+EXPORT_SYMBOL_GPL(dvfsrc_batch_set_delay);
+
+/*
+ * A class taken out of urgent has its votes wait up to delay_us like any
+ * other, so its requests take effect that much later than before.
+ */
+void dvfsrc_batch_set_urgent(struct dvfsrc_batch *b, unsigned long urgent)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&b->lock, flags);
+	b->urgent = urgent;
+	spin_unlock_irqrestore(&b->lock, flags);
+}
+EXPORT_SYMBOL_GPL(dvfsrc_batch_set_urgent);
+
+void dvfsrc_batch_init(struct dvfsrc_batch *b,
+		int (*commit)(struct dvfsrc_batch *b, const int *vote,
+			      unsigned long mask),
+		unsigned long urgent, unsigned int delay_us)
+{
+	memset(b, 0, sizeof(*b));
+	b->commit = commit;
+	b->urgent = urgent;
+	b->delay_us = delay_us;
+	spin_lock_init(&b->lock);
+	mutex_init(&b->commit_lock);
+	hrtimer_init(&b->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	b->timer.function = dvfsrc_batch_timer;
+	INIT_WORK(&b->work, dvfsrc_batch_work);
+}
+EXPORT_SYMBOL_GPL(dvfsrc_batch_init);
+
+/* Drops whatever is still pending; callers stop voting first */
+void dvfsrc_batch_exit(struct dvfsrc_batch *b)
+{
+	hrtimer_cancel(&b->timer);
+	cancel_work_sync(&b->work);
+}
+EXPORT_SYMBOL_GPL(dvfsrc_batch_exit);
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See http://www.gnu.org/licenses/gpl-2.0.html for more details.
+ */
+
+#ifndef __HELIO_DVFSRC_BATCH_H
+#define __HELIO_DVFSRC_BATCH_H
+
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+
+#define DVFSRC_BATCH_MAX	16
+#define DVFSRC_BATCH_DELAY_US	500
+
+/*
+ * Collects votes of up to DVFSRC_BATCH_MAX classes and hands them to
+ * commit() together. A vote of a class in urgent is committed before
+ * dvfsrc_batch_vote() returns, along with whatever else is pending; any
+ * other vote waits at most delay_us for more votes to join it. The timer
+ * is armed by the first vote of a batch and never pushed back, so a steady
+ * stream of votes cannot hold a batch off.
+ */
+struct dvfsrc_batch {
+	int (*commit)(struct dvfsrc_batch *b, const int *vote,
+		      unsigned long mask);
+
+	spinlock_t		lock;
+	int			vote[DVFSRC_BATCH_MAX];
+	unsigned long		pending;
+	unsigned long		urgent;
+	unsigned int		delay_us;
+	bool			armed;
+	ktime_t			first;		/* oldest pending vote */
+	struct hrtimer		timer;
+	struct work_struct	work;
+
+	struct mutex		commit_lock;	/* one commit at a time */
+	int			committed[DVFSRC_BATCH_MAX];
+
+	/* stats, under lock */
+	u64			nr_vote;
+	u64			nr_commit;
+	u64			nr_urgent;
+	u64			max_wait_ns;	/* vote to end of its commit */
+};
+
+extern void dvfsrc_batch_init(struct dvfsrc_batch *b,
+		int (*commit)(struct dvfsrc_batch *b, const int *vote,
+			      unsigned long mask),
+		unsigned long urgent, unsigned int delay_us);
+extern void dvfsrc_batch_exit(struct dvfsrc_batch *b);
+extern void dvfsrc_batch_vote(struct dvfsrc_batch *b, int cls, int val);
+extern void dvfsrc_batch_flush(struct dvfsrc_batch *b);
+extern char *dvfsrc_batch_info(struct dvfsrc_batch *b, char *p, char *end);
+extern void dvfsrc_batch_set_delay(struct dvfsrc_batch *b,
+		unsigned int delay_us);
+extern void dvfsrc_batch_set_urgent(struct dvfsrc_batch *b,
+		unsigned long urgent);
+
+#endif /* __HELIO_DVFSRC_BATCH_H */
@@ -207,6 +207,9 @@ static ssize_t dvfsrc_debug_show(struct device *dev,
 			dvfsrc_read(dvfsrc, DVFSRC_SW_BW_4));
 	p += snprintf(p, buff_end - p, "\n");
 
+	p = dvfsrc_batch_info(&dvfsrc->batch, p, buff_end);
+	p += snprintf(p, buff_end - p, "\n");
+
 	return p - buf;
 }
 
@@ -239,6 +242,11 @@ static ssize_t dvfsrc_debug_store(struct device *dev,
 		dvfsrc->skip = val;
 	else if (!strcmp(cmd, "log_mask"))
 		dvfsrc->log_mask = val;
+	else if (!strcmp(cmd, "batch_delay") && val >= 0)
+		dvfsrc_batch_set_delay(&dvfsrc->batch, val);
+	/* clearing a class bit delays its requests by up to batch_delay */
+	else if (!strcmp(cmd, "batch_urgent"))
+		dvfsrc_batch_set_urgent(&dvfsrc->batch, val);
 	else
 		r = -EPERM;
 
@@ -282,46 +282,52 @@ int is_dvfsrc_opp_fixed(void)
 	return 0;
 }
 
-static int commit_data(struct helio_dvfsrc *dvfsrc, int type, int data)
-{
-	int ret = 0;
-	int level = 0;
-	int opp = 0;
-	int last_cnt = 0;
-	int opp_uv;
-	int vcore_uv = 0;
-
-	mutex_lock(&dvfsrc->devfreq->lock);
-
-	if (!dvfsrc->enable)
-		goto out;
-
-	if (is_force_opp_enable())
-		goto out;
-
-	if (dvfsrc->skip)
-		goto out;
+enum dvfsrc_vote {
+	DVFSRC_VOTE_MEMORY_BW,
+	DVFSRC_VOTE_CPU_MEMORY_BW,
+	DVFSRC_VOTE_GPU_MEMORY_BW,
+	DVFSRC_VOTE_MM_MEMORY_BW,
+	DVFSRC_VOTE_MD_PERI_MEMORY_BW,
+	DVFSRC_VOTE_EMI_OPP,
+	DVFSRC_VOTE_VCORE_OPP,
+	DVFSRC_VOTE_FIXED_OPP,
+	DVFSRC_VOTE_NUM,
+};
 
-	spm_check_status_before_dvfs();
+static const int dvfsrc_vote_class[DVFSRC_VOTE_NUM] = {
+	[DVFSRC_VOTE_MEMORY_BW] = PM_QOS_MEMORY_BANDWIDTH,
+	[DVFSRC_VOTE_CPU_MEMORY_BW] = PM_QOS_CPU_MEMORY_BANDWIDTH,
+	[DVFSRC_VOTE_GPU_MEMORY_BW] = PM_QOS_GPU_MEMORY_BANDWIDTH,
+	[DVFSRC_VOTE_MM_MEMORY_BW] = PM_QOS_MM_MEMORY_BANDWIDTH,
+	[DVFSRC_VOTE_MD_PERI_MEMORY_BW] = PM_QOS_MD_PERI_MEMORY_BANDWIDTH,
+	[DVFSRC_VOTE_EMI_OPP] = PM_QOS_EMI_OPP,
+	[DVFSRC_VOTE_VCORE_OPP] = PM_QOS_VCORE_OPP,
+	[DVFSRC_VOTE_FIXED_OPP] = PM_QOS_VCORE_DVFS_FIXED_OPP,
+};
 
-	if (type == PM_QOS_EMI_OPP ||
-	    type == PM_QOS_VCORE_OPP ||
-	    type == PM_QOS_VCORE_DVFS_FIXED_OPP) {
-		last_cnt = dvfsrc_read(dvfsrc, DVFSRC_LAST);
-		ret = wait_for_completion
-			(is_dvfsrc_in_progress(dvfsrc) == 0, DVFSRC_TIMEOUT);
-		if (ret) {
-			pr_info("[%s] wait no idle, class: %d, data: 0x%x",
-				__func__, type, data);
-			pr_info("rc_level: 0x%x (last: %d -> %d)\n",
-				dvfsrc_read(dvfsrc, DVFSRC_LEVEL),
-				last_cnt, dvfsrc_read(dvfsrc, DVFSRC_LAST));
+/* Votes that move the level and are waited for */
+#define DVFSRC_OPP_VOTES	(BIT(DVFSRC_VOTE_EMI_OPP) |	\
+				 BIT(DVFSRC_VOTE_VCORE_OPP) |	\
+				 BIT(DVFSRC_VOTE_FIXED_OPP))
 
-			/* aee_kernel_warning(NULL); */
-			/* goto out; */
-		}
-	}
+/*
+ * The level the EMI and vcore requests of one commit resolve to: the
+ * lowest opp on MT6771, the highest DVFSRC level elsewhere.
+ */
+#if defined(CONFIG_MACH_MT6771)
+#define DVFSRC_NO_TARGET		VCORE_DVFS_OPP_NUM
+#define dvfsrc_target_merge(a, b)	min(a, b)
+#define dvfsrc_target_reached(dvfsrc, t)	\
+	(spm_vcorefs_get_dvfs_opp() <= (t))
+#else
+#define DVFSRC_NO_TARGET		0
+#define dvfsrc_target_merge(a, b)	max(a, b)
+#define dvfsrc_target_reached(dvfsrc, t)	\
+	(get_dvfsrc_level(dvfsrc) >= (t))
+#endif
 
+static void commit_bw(struct helio_dvfsrc *dvfsrc, int type, int data)
+{
 	switch (type) {
 	case PM_QOS_MEMORY_BANDWIDTH:
 		if (data == PM_QOS_MEMORY_BANDWIDTH_DEFAULT_VALUE)
@@ -347,139 +353,221 @@ static int commit_data(struct helio_dvfsrc *dvfsrc, int type, int data)
 	case PM_QOS_MD_PERI_MEMORY_BANDWIDTH:
 		dvfsrc_write(dvfsrc, DVFSRC_SW_BW_4, data / 100);
 		break;
-	case PM_QOS_EMI_OPP:
-		if (dvfsrc->log_mask & (0x1 << type))
-			pr_info("[%s] class: %d, data: 0x%x\n",
-				__func__, type, data);
+	default:
+		break;
+	}
+}
 
-		if (data >= DDR_OPP_NUM)
-			data = DDR_OPP_NUM - 1;
-		else if (data < 0)
-			data = DDR_OPP_NUM - 1;
+/* Writes the EMI request and returns the target it needs */
+static int commit_emi_opp(struct helio_dvfsrc *dvfsrc, int data)
+{
+	int level;
+
+	if (dvfsrc->log_mask & (0x1 << PM_QOS_EMI_OPP))
+		pr_info("[%s] class: %d, data: 0x%x\n",
+			__func__, PM_QOS_EMI_OPP, data);
+
+	if (data >= DDR_OPP_NUM)
+		data = DDR_OPP_NUM - 1;
+	else if (data < 0)
+		data = DDR_OPP_NUM - 1;
+
+	level = DDR_OPP_NUM - data - 1;
+	dvfsrc_write(dvfsrc, DVFSRC_SW_REQ,
+			(dvfsrc_read(dvfsrc, DVFSRC_SW_REQ)
+			& ~(0x3)) | level);
 
-		level = DDR_OPP_NUM - data - 1;
-		dvfsrc_write(dvfsrc, DVFSRC_SW_REQ,
-				(dvfsrc_read(dvfsrc, DVFSRC_SW_REQ)
-				& ~(0x3)) | level);
-		udelay(1);
-		ret = wait_for_completion
-		(is_dvfsrc_in_progress(dvfsrc) == 0, DVFSRC_TIMEOUT);
-		udelay(1);
 #if defined(CONFIG_MACH_MT6771)
-		opp = get_min_opp_for_ddr(data);
-		ret = wait_for_completion(spm_vcorefs_get_dvfs_opp() <= opp,
-				SPM_DVFS_TIMEOUT);
+	return get_min_opp_for_ddr(data);
+#else
+	return emi_to_vcore_dvfs_level[level];
+#endif
+}
+
+/* Writes the vcore request and returns the target it needs */
+static int commit_vcore_opp(struct helio_dvfsrc *dvfsrc, int data)
+{
+	int level;
+
+	if (dvfsrc->log_mask & (0x1 << PM_QOS_VCORE_OPP))
+		pr_info("[%s] class: %d, data: 0x%x\n",
+			__func__, PM_QOS_VCORE_OPP, data);
+
+	if (data >= VCORE_OPP_NUM)
+		data = VCORE_OPP_NUM - 1;
+	else if (data < 0)
+		data = VCORE_OPP_NUM - 1;
+
+	level = VCORE_OPP_NUM - data - 1;
+	dvfsrc_write(dvfsrc, DVFSRC_VCORE_REQUEST2,
+			(dvfsrc_read(dvfsrc, DVFSRC_VCORE_REQUEST2)
+			& ~(0x03000000)) | (level << 24));
+
+#if defined(CONFIG_MACH_MT6771)
+	return get_min_opp_for_vcore(data);
+#else
+	return vcore_to_vcore_dvfs_level[level];
+#endif
+}
+
+static void check_vcore_volt(struct helio_dvfsrc *dvfsrc, int opp)
+{
+	int opp_uv;
+	int vcore_uv = 0;
+
+	if (!vcore_reg_id)
+		return;
+
+	vcore_uv = regulator_get_voltage(vcore_reg_id);
+	opp_uv = get_vcore_opp_volt(get_min_opp_for_vcore(opp));
+	if (vcore_uv < opp_uv) {
+		pr_info("DVFS FAIL= %d %d 0x%08x %08x\n",
+			vcore_uv, opp_uv,
+			dvfsrc_read(dvfsrc, DVFSRC_LEVEL),
+			spm_vcorefs_get_dvfs_opp());
+
+		aee_kernel_warning("DVFSRC", "VCORE failed.", __func__);
+	}
+}
+
+static int commit_fixed_opp(struct helio_dvfsrc *dvfsrc, int data)
+{
+	int ret = 0;
+	int level = 0;
+
+	if (dvfsrc->log_mask & (0x1 << PM_QOS_VCORE_DVFS_FIXED_OPP))
+		pr_info("[%s] class: %d, data: 0x%x\n",
+			__func__, PM_QOS_VCORE_DVFS_FIXED_OPP, data);
+
+	if (data >= VCORE_DVFS_OPP_NUM)
+		data = VCORE_DVFS_OPP_NUM;
+
+	if (data == VCORE_DVFS_OPP_NUM) { /* no fix opp*/
+		dvfsrc_write(dvfsrc, DVFSRC_BASIC_CONTROL,
+				(dvfsrc_read(dvfsrc,
+				DVFSRC_BASIC_CONTROL) & ~(1 << 15)));
+		dvfsrc_write(dvfsrc, DVFSRC_FORCE,
+			       dvfsrc_read(dvfsrc, DVFSRC_FORCE)
+			       & 0xFFFF0000);
+	} else { /* fix opp */
+		level = 1 << (VCORE_DVFS_OPP_NUM - data - 1);
+		dvfsrc_write(dvfsrc, DVFSRC_FORCE, level);
+		dvfsrc_write(dvfsrc, DVFSRC_BASIC_CONTROL,
+			(dvfsrc_read(dvfsrc, DVFSRC_BASIC_CONTROL)
+			| (1 << 15)));
+#if defined(CONFIG_MACH_MT6771)
+		ret = wait_for_completion
+		(spm_vcorefs_get_dvfs_opp() == data, SPM_DVFS_TIMEOUT);
 #else
 		ret = wait_for_completion
-		(get_dvfsrc_level(dvfsrc) >= emi_to_vcore_dvfs_level[level],
+		(get_dvfsrc_level(dvfsrc) ==
+			vcore_dvfs_to_vcore_dvfs_level[level],
 		SPM_DVFS_TIMEOUT);
 #endif
 		if (ret < 0) {
 			pr_info
-			("[%s] wair not complete, class: %d, data: 0x%x\n",
-			__func__, type, data);
+			("[%s] not complete, class: %d, data: 0x%x\n",
+			__func__, PM_QOS_VCORE_DVFS_FIXED_OPP, data);
 			spm_vcorefs_dump_dvfs_regs(NULL);
-			aee_kernel_warning("VCOREFS",
-			"emi_opp cannot be done.");
+			aee_kernel_exception("VCOREFS",
+			"dvfsrc cannot be done.");
 		}
+	}
 
-		break;
-	case PM_QOS_VCORE_OPP:
-		if (dvfsrc->log_mask & (0x1 << type))
-			pr_info("[%s] class: %d, data: 0x%x\n",
-				__func__, type, data);
+	return ret;
+}
+
+/*
+ * Commits every vote in mask at once: the bandwidth registers are written,
+ * then the EMI and vcore requests, and the level they resolve to is waited
+ * for a single time.
+ */
+static int commit_data(struct dvfsrc_batch *b, const int *vote,
+		unsigned long mask)
+{
+	struct helio_dvfsrc *dvfsrc;
+	int ret = 0;
+	int last_cnt = 0;
+	int target = DVFSRC_NO_TARGET;
+	int vcore_target = DVFSRC_NO_TARGET;
+	int i;
+
+	dvfsrc = container_of(b, struct helio_dvfsrc, batch);
+
+	mutex_lock(&dvfsrc->devfreq->lock);
+
+	if (!dvfsrc->enable)
+		goto out;
+
+	if (is_force_opp_enable())
+		goto out;
+
+	if (dvfsrc->skip)
+		goto out;
+
+	spm_check_status_before_dvfs();
+
+	if (mask & DVFSRC_OPP_VOTES) {
+		last_cnt = dvfsrc_read(dvfsrc, DVFSRC_LAST);
+		ret = wait_for_completion
+			(is_dvfsrc_in_progress(dvfsrc) == 0, DVFSRC_TIMEOUT);
+		if (ret) {
+			pr_info("[%s] wait no idle, votes: 0x%lx",
+				__func__, mask);
+			pr_info("rc_level: 0x%x (last: %d -> %d)\n",
+				dvfsrc_read(dvfsrc, DVFSRC_LEVEL),
+				last_cnt, dvfsrc_read(dvfsrc, DVFSRC_LAST));
+
+			/* aee_kernel_warning(NULL); */
+			/* goto out; */
+		}
+	}
+
+	for (i = DVFSRC_VOTE_MEMORY_BW;
+	     i <= DVFSRC_VOTE_MD_PERI_MEMORY_BW; i++)
+		if (mask & BIT(i))
+			commit_bw(dvfsrc, dvfsrc_vote_class[i], vote[i]);
+
+	if (mask & BIT(DVFSRC_VOTE_EMI_OPP))
+		target = commit_emi_opp(dvfsrc, vote[DVFSRC_VOTE_EMI_OPP]);
 
-		if (data >= VCORE_OPP_NUM)
-			data = VCORE_OPP_NUM - 1;
-		else if (data < 0)
-			data = VCORE_OPP_NUM - 1;
+	if (mask & BIT(DVFSRC_VOTE_VCORE_OPP)) {
+		vcore_target = commit_vcore_opp(dvfsrc,
+				vote[DVFSRC_VOTE_VCORE_OPP]);
+		target = dvfsrc_target_merge(target, vcore_target);
+	}
 
-		level = ((VCORE_OPP_NUM - data - 1) << 24);
-		dvfsrc_write(dvfsrc, DVFSRC_VCORE_REQUEST2,
-				(dvfsrc_read(dvfsrc, DVFSRC_VCORE_REQUEST2)
-				& ~(0x03000000)) | level);
+	if (mask & (BIT(DVFSRC_VOTE_EMI_OPP) | BIT(DVFSRC_VOTE_VCORE_OPP))) {
 		udelay(1);
 		ret = wait_for_completion
 		(is_dvfsrc_in_progress(dvfsrc) == 0, DVFSRC_TIMEOUT);
 		udelay(1);
-#if defined(CONFIG_MACH_MT6771)
-		opp = get_min_opp_for_vcore(data);
-		ret = wait_for_completion(spm_vcorefs_get_dvfs_opp() <= opp,
-				SPM_DVFS_TIMEOUT);
-#else
-		ret = wait_for_completion
-		(get_dvfsrc_level(dvfsrc) >= vcore_to_vcore_dvfs_level[level],
+		ret = wait_for_completion(dvfsrc_target_reached(dvfsrc, target),
 				SPM_DVFS_TIMEOUT);
-#endif
 		if (ret < 0) {
 			pr_info
-			("[%s] not complete, class: %d, data: 0x%x\n",
-			__func__, type, data);
+			("[%s] not complete, votes: 0x%lx, emi: 0x%x, vcore: 0x%x\n",
+			__func__, mask, vote[DVFSRC_VOTE_EMI_OPP],
+			vote[DVFSRC_VOTE_VCORE_OPP]);
 			spm_vcorefs_dump_dvfs_regs(NULL);
 			aee_kernel_warning("VCOREFS",
-			"vcore_opp cannot be done.");
+				(mask & BIT(DVFSRC_VOTE_VCORE_OPP)) ?
+				"vcore_opp cannot be done." :
+				"emi_opp cannot be done.");
 		}
+	}
 
-		if (vcore_reg_id) {
-			vcore_uv = regulator_get_voltage(vcore_reg_id);
-			opp_uv = get_vcore_opp_volt(get_min_opp_for_vcore(opp));
-				if (vcore_uv < opp_uv) {
-					pr_info("DVFS FAIL= %d %d 0x%08x %08x\n",
-					vcore_uv, opp_uv,
-					dvfsrc_read(dvfsrc, DVFSRC_LEVEL),
-					spm_vcorefs_get_dvfs_opp());
-
-					aee_kernel_warning("DVFSRC",
-						"VCORE failed.",
-						__func__);
-				}
-		}
-		break;
-	case PM_QOS_VCORE_DVFS_FIXED_OPP:
-		if (dvfsrc->log_mask & (0x1 << type))
-			pr_info("[%s] class: %d, data: 0x%x\n",
-					__func__, type, data);
-
-		if (data >= VCORE_DVFS_OPP_NUM)
-			data = VCORE_DVFS_OPP_NUM;
-
-		if (data == VCORE_DVFS_OPP_NUM) { /* no fix opp*/
-			dvfsrc_write(dvfsrc, DVFSRC_BASIC_CONTROL,
-					(dvfsrc_read(dvfsrc,
-					DVFSRC_BASIC_CONTROL) & ~(1 << 15)));
-			dvfsrc_write(dvfsrc, DVFSRC_FORCE,
-				       dvfsrc_read(dvfsrc, DVFSRC_FORCE)
-				       & 0xFFFF0000);
-		} else { /* fix opp */
-			level = 1 << (VCORE_DVFS_OPP_NUM - data - 1);
-			dvfsrc_write(dvfsrc, DVFSRC_FORCE, level);
-			dvfsrc_write(dvfsrc, DVFSRC_BASIC_CONTROL,
-				(dvfsrc_read(dvfsrc, DVFSRC_BASIC_CONTROL)
-				| (1 << 15)));
+	if (mask & BIT(DVFSRC_VOTE_VCORE_OPP)) {
 #if defined(CONFIG_MACH_MT6771)
-			ret = wait_for_completion
-			(spm_vcorefs_get_dvfs_opp() == data, SPM_DVFS_TIMEOUT);
+		check_vcore_volt(dvfsrc, vcore_target);
 #else
-			ret = wait_for_completion
-			(get_dvfsrc_level(dvfsrc) ==
-				vcore_dvfs_to_vcore_dvfs_level[level],
-			SPM_DVFS_TIMEOUT);
+		check_vcore_volt(dvfsrc, 0);
 #endif
-			if (ret < 0) {
-				pr_info
-				("[%s] not complete, class: %d, data: 0x%x\n",
-				__func__, type, data);
-				spm_vcorefs_dump_dvfs_regs(NULL);
-				aee_kernel_exception("VCOREFS",
-				"dvfsrc cannot be done.");
-			}
-
-		}
-		break;
-	default:
-		break;
 	}
 
+	if (mask & BIT(DVFSRC_VOTE_FIXED_OPP))
+		ret = commit_fixed_opp(dvfsrc, vote[DVFSRC_VOTE_FIXED_OPP]);
+
 out:
 	mutex_unlock(&dvfsrc->devfreq->lock);
 
@@ -526,7 +614,7 @@ static int pm_qos_memory_bw_notify(struct notifier_block *b,
 
 	dvfsrc = container_of(b, struct helio_dvfsrc, pm_qos_memory_bw_nb);
 
-	commit_data(dvfsrc, PM_QOS_MEMORY_BANDWIDTH, l);
+	dvfsrc_batch_vote(&dvfsrc->batch, DVFSRC_VOTE_MEMORY_BW, l);
 
 	return NOTIFY_OK;
 }
@@ -538,7 +626,7 @@ static int pm_qos_cpu_memory_bw_notify(struct notifier_block *b,
 
 	dvfsrc = container_of(b, struct helio_dvfsrc, pm_qos_cpu_memory_bw_nb);
 
-	commit_data(dvfsrc, PM_QOS_CPU_MEMORY_BANDWIDTH, l);
+	dvfsrc_batch_vote(&dvfsrc->batch, DVFSRC_VOTE_CPU_MEMORY_BW, l);
 
 	return NOTIFY_OK;
 }
@@ -550,7 +638,7 @@ static int pm_qos_gpu_memory_bw_notify(struct notifier_block *b,
 
 	dvfsrc = container_of(b, struct helio_dvfsrc, pm_qos_gpu_memory_bw_nb);
 
-	commit_data(dvfsrc, PM_QOS_GPU_MEMORY_BANDWIDTH, l);
+	dvfsrc_batch_vote(&dvfsrc->batch, DVFSRC_VOTE_GPU_MEMORY_BW, l);
 
 	return NOTIFY_OK;
 }
@@ -562,7 +650,7 @@ static int pm_qos_mm_memory_bw_notify(struct notifier_block *b,
 
 	dvfsrc = container_of(b, struct helio_dvfsrc, pm_qos_mm_memory_bw_nb);
 
-	commit_data(dvfsrc, PM_QOS_MM_MEMORY_BANDWIDTH, l);
+	dvfsrc_batch_vote(&dvfsrc->batch, DVFSRC_VOTE_MM_MEMORY_BW, l);
 
 	return NOTIFY_OK;
 }
@@ -575,7 +663,8 @@ static int pm_qos_md_peri_memory_bw_notify(struct notifier_block *b,
 	dvfsrc = container_of(b,
 			struct helio_dvfsrc, pm_qos_md_peri_memory_bw_nb);
 
-	commit_data(dvfsrc, PM_QOS_MD_PERI_MEMORY_BANDWIDTH, l);
+	dvfsrc_batch_vote(&dvfsrc->batch,
+			DVFSRC_VOTE_MD_PERI_MEMORY_BW, l);
 
 	return NOTIFY_OK;
 }
@@ -587,7 +676,7 @@ static int pm_qos_emi_opp_notify(struct notifier_block *b,
 
 	dvfsrc = container_of(b, struct helio_dvfsrc, pm_qos_emi_opp_nb);
 
-	commit_data(dvfsrc, PM_QOS_EMI_OPP, l);
+	dvfsrc_batch_vote(&dvfsrc->batch, DVFSRC_VOTE_EMI_OPP, l);
 
 	return NOTIFY_OK;
 }
@@ -599,7 +688,7 @@ static int pm_qos_vcore_opp_notify(struct notifier_block *b,
 
 	dvfsrc = container_of(b, struct helio_dvfsrc, pm_qos_vcore_opp_nb);
 
-	commit_data(dvfsrc, PM_QOS_VCORE_OPP, l);
+	dvfsrc_batch_vote(&dvfsrc->batch, DVFSRC_VOTE_VCORE_OPP, l);
 
 	return NOTIFY_OK;
 }
@@ -612,7 +701,7 @@ static int pm_qos_vcore_dvfs_fixed_opp_notify(struct notifier_block *b,
 	dvfsrc = container_of(b,
 			struct helio_dvfsrc, pm_qos_vcore_dvfs_fixed_opp_nb);
 
-	commit_data(dvfsrc, PM_QOS_VCORE_DVFS_FIXED_OPP, l);
+	dvfsrc_batch_vote(&dvfsrc->batch, DVFSRC_VOTE_FIXED_OPP, l);
 
 	return NOTIFY_OK;
 }
@@ -650,6 +739,24 @@ static void pm_qos_notifier_register(struct helio_dvfsrc *dvfsrc)
 				&dvfsrc->pm_qos_vcore_dvfs_fixed_opp_nb);
 }
 
+static void pm_qos_notifier_unregister(struct helio_dvfsrc *dvfsrc)
+{
+	pm_qos_remove_notifier(PM_QOS_MEMORY_BANDWIDTH,
+					&dvfsrc->pm_qos_memory_bw_nb);
+	pm_qos_remove_notifier(PM_QOS_CPU_MEMORY_BANDWIDTH,
+					&dvfsrc->pm_qos_cpu_memory_bw_nb);
+	pm_qos_remove_notifier(PM_QOS_GPU_MEMORY_BANDWIDTH,
+					&dvfsrc->pm_qos_gpu_memory_bw_nb);
+	pm_qos_remove_notifier(PM_QOS_MM_MEMORY_BANDWIDTH,
+					&dvfsrc->pm_qos_mm_memory_bw_nb);
+	pm_qos_remove_notifier(PM_QOS_MD_PERI_MEMORY_BANDWIDTH,
+					&dvfsrc->pm_qos_md_peri_memory_bw_nb);
+	pm_qos_remove_notifier(PM_QOS_EMI_OPP, &dvfsrc->pm_qos_emi_opp_nb);
+	pm_qos_remove_notifier(PM_QOS_VCORE_OPP, &dvfsrc->pm_qos_vcore_opp_nb);
+	pm_qos_remove_notifier(PM_QOS_VCORE_DVFS_FIXED_OPP,
+				&dvfsrc->pm_qos_vcore_dvfs_fixed_opp_nb);
+}
+
 static int helio_dvfsrc_probe(struct platform_device *pdev)
 {
 	int ret;
@@ -695,6 +802,9 @@ static int helio_dvfsrc_probe(struct platform_device *pdev)
 		return ret;
 #endif
 
+	/* opp votes are waited for by their callers, never hold them */
+	dvfsrc_batch_init(&dvfsrc->batch, commit_data, DVFSRC_OPP_VOTES,
+			DVFSRC_BATCH_DELAY_US);
 	pm_qos_notifier_register(dvfsrc);
 	helio_dvfsrc_enable(dvfsrc);
 
@@ -705,6 +815,10 @@ static int helio_dvfsrc_probe(struct platform_device *pdev)
 
 static int helio_dvfsrc_remove(struct platform_device *pdev)
 {
+	struct helio_dvfsrc *dvfsrc = platform_get_drvdata(pdev);
+
+	pm_qos_notifier_unregister(dvfsrc);
+	dvfsrc_batch_exit(&dvfsrc->batch);
 	helio_dvfsrc_remove_interface(&pdev->dev);
 	return 0;
 }
@@ -722,6 +836,8 @@ static __maybe_unused int helio_dvfsrc_suspend(struct device *dev)
 	struct helio_dvfsrc *dvfsrc = dev_get_drvdata(dev);
 	int ret = 0;
 
+	dvfsrc_batch_flush(&dvfsrc->batch);
+
 	ret = devfreq_suspend_device(dvfsrc->devfreq);
 	if (ret < 0) {
 		dev_err(dev, "failed to suspend the devfreq devices\n");
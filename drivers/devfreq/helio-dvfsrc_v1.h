@@ -18,6 +18,8 @@
 #include <linux/devfreq.h>
 #include <linux/io.h>
 
+#include "helio-dvfsrc-batch.h"
+
 #if defined(CONFIG_MACH_MT6775)
 #include <helio-dvfsrc-mt6775.h>
 #elif defined(CONFIG_MACH_MT6771)
@@ -57,6 +59,7 @@ struct helio_dvfsrc {
 	struct notifier_block	pm_qos_emi_opp_nb;
 	struct notifier_block	pm_qos_vcore_opp_nb;
 	struct notifier_block	pm_qos_vcore_dvfs_fixed_opp_nb;
+	struct dvfsrc_batch	batch;
 
 	struct reg_config	*init_config;
 	struct reg_config	*suspend_config;
@@ -0,0 +1,405 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See http://www.gnu.org/licenses/gpl-2.0.html for more details.
+ */
+
+/*
+ * DVFSRC vote batching test
+ *
+ * Runs a dvfsrc_batch against a stand-in for the DVFSRC: a small register
+ * file with the SW_BW, SW_REQ, VCORE_REQUEST2 and LEVEL registers, and an
+ * hrtimer playing the sequencer, which moves LEVEL one step every step_us
+ * toward what the request registers ask for and flags it in progress
+ * meanwhile. The commit callback writes those registers the way
+ * helio-dvfsrc.c does and waits for the level when an opp was voted, so
+ * the test can count commits and register writes and time every vote to
+ * the end of the commit that carried it. Results go to the kernel log;
+ * loading always fails with -EAGAIN so the test can be run again without
+ * rmmod.
+ */
+
+#define pr_fmt(fmt) "dvfsrc_batch_test: " fmt
+
+#include <linux/delay.h>
+#include <linux/io.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+
+#include "helio-dvfsrc-batch.h"
+
+enum { T_BW_0, T_BW_1, T_BW_2, T_BW_3, T_BW_4, T_EMI, T_VCORE, T_NUM };
+
+#define T_NR_BW		5
+#define T_URGENT	(BIT(T_EMI) | BIT(T_VCORE))
+
+/* Stand-in register map */
+#define SW_BW(i)	((i) * 4)
+#define SW_REQ		0x20
+#define VCORE_REQUEST2	0x24
+#define LEVEL		0x28
+#define REG_SIZE	0x40
+
+#define BW_PER_LEVEL	40	/* in 100MB/s, like SW_BW */
+#define MAX_LEVEL	3
+#define LEVEL_TIMEOUT_US	10000
+
+static unsigned int delay_us = 2000;
+module_param(delay_us, uint, 0444);
+MODULE_PARM_DESC(delay_us, "Batch delay");
+
+static unsigned int step_us = 30;
+module_param(step_us, uint, 0444);
+MODULE_PARM_DESC(step_us, "Time the stand-in takes per level");
+
+static unsigned int slack_us = 5000;
+module_param(slack_us, uint, 0444);
+MODULE_PARM_DESC(slack_us, "Scheduling allowance on top of the delay");
+
+#define EXPECT(cond, fmt, ...)						\
+	do {								\
+		if (!(cond)) {						\
+			pr_err("%s:%d: " fmt "\n", __func__, __LINE__,	\
+			       ##__VA_ARGS__);				\
+			return -EINVAL;					\
+		}							\
+	} while (0)
+
+static struct dvfsrc_batch batch;
+
+static void __iomem *regs;
+static struct hrtimer seq;
+static DEFINE_SPINLOCK(hw_lock);
+
+static DEFINE_SPINLOCK(stat_lock);
+static ktime_t stamp[T_NUM];
+static unsigned long stamped;
+static unsigned int nr_commit, nr_write;
+static u64 max_lat_ns[T_NUM];
+
+static int hw_target(void)
+{
+	u32 bw = 0;
+	int i, level;
+
+	for (i = 0; i < T_NR_BW; i++)
+		bw += readl(regs + SW_BW(i));
+	level = min_t(u32, bw / BW_PER_LEVEL, MAX_LEVEL);
+	level = max_t(int, level, readl(regs + SW_REQ) & 0x3);
+
+	return max_t(int, level, (readl(regs + VCORE_REQUEST2) >> 24) & 0x3);
+}
+
+/* The sequencer: one level step per step_us */
+static enum hrtimer_restart hw_step(struct hrtimer *t)
+{
+	enum hrtimer_restart ret = HRTIMER_NORESTART;
+	unsigned long flags;
+	int cur, target;
+
+	spin_lock_irqsave(&hw_lock, flags);
+	cur = readl(regs + LEVEL) >> 16;
+	target = hw_target();
+	if (cur != target)
+		cur += cur < target ? 1 : -1;
+	writel(cur << 16 | (cur != target), regs + LEVEL);
+	/* a write may have queued us again already */
+	if (cur != target && !hrtimer_is_queued(t)) {
+		hrtimer_forward_now(t, us_to_ktime(step_us));
+		ret = HRTIMER_RESTART;
+	}
+	spin_unlock_irqrestore(&hw_lock, flags);
+
+	return ret;
+}
+
+static void hw_write(u32 val, u32 off)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&hw_lock, flags);
+	writel(val, regs + off);
+	writel(readl(regs + LEVEL) | 1, regs + LEVEL);
+	if (!hrtimer_is_queued(&seq))
+		hrtimer_start(&seq, us_to_ktime(step_us), HRTIMER_MODE_REL);
+	spin_unlock_irqrestore(&hw_lock, flags);
+	nr_write++;
+}
+
+static int hw_level(void)
+{
+	return readl(regs + LEVEL) >> 16;
+}
+
+static int wait_level(int target)
+{
+	int us;
+
+	for (us = 0; us < LEVEL_TIMEOUT_US; us++) {
+		if (hw_level() >= target)
+			return 0;
+		udelay(1);
+	}
+
+	return -ETIMEDOUT;
+}
+
+static int fake_commit(struct dvfsrc_batch *b, const int *vote,
+		unsigned long mask)
+{
+	ktime_t begin = ktime_get(), now;
+	unsigned long flags;
+	int i, target = 0, ret = 0;
+
+	for (i = 0; i < T_NR_BW; i++)
+		if (mask & BIT(i))
+			hw_write(vote[i] / 100, SW_BW(i));
+	if (mask & BIT(T_EMI)) {
+		hw_write(vote[T_EMI], SW_REQ);
+		target = vote[T_EMI];
+	}
+	if (mask & BIT(T_VCORE)) {
+		hw_write(vote[T_VCORE] << 24, VCORE_REQUEST2);
+		target = max(target, vote[T_VCORE]);
+	}
+	if (mask & T_URGENT)
+		ret = wait_level(target);
+
+	now = ktime_get();
+	spin_lock_irqsave(&stat_lock, flags);
+	nr_commit++;
+	for_each_set_bit(i, &mask, T_NUM) {
+		/* a vote newer than the commit rides on the next one */
+		if (!(stamped & BIT(i)) || ktime_after(stamp[i], begin))
+			continue;
+		max_lat_ns[i] = max_t(u64, max_lat_ns[i],
+				      ktime_to_ns(ktime_sub(now, stamp[i])));
+		stamped &= ~BIT(i);
+	}
+	spin_unlock_irqrestore(&stat_lock, flags);
+
+	return ret;
+}
+
+static void vote(int cls, int val)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&stat_lock, flags);
+	if (!(stamped & BIT(cls))) {
+		stamp[cls] = ktime_get();
+		stamped |= BIT(cls);
+	}
+	spin_unlock_irqrestore(&stat_lock, flags);
+
+	dvfsrc_batch_vote(&batch, cls, val);
+}
+
+static unsigned int commits(void)
+{
+	return READ_ONCE(nr_commit);
+}
+
+/* Waits for the batch timer to have done its job */
+static void wait_commits(unsigned int want)
+{
+	unsigned int us;
+
+	for (us = 0; us < delay_us + slack_us && commits() < want; us += 100)
+		usleep_range(100, 150);
+}
+
+static u64 max_bw_lat_us(void)
+{
+	u64 lat = 0;
+	int i;
+
+	for (i = 0; i < T_NR_BW; i++)
+		lat = max(lat, max_lat_ns[i]);
+
+	return div_u64(lat, NSEC_PER_USEC);
+}
+
+static int reset(unsigned int delay)
+{
+	int i;
+
+	dvfsrc_batch_exit(&batch);
+	for (i = 0; i < T_NR_BW; i++)
+		hw_write(0, SW_BW(i));
+	hw_write(0, SW_REQ);
+	hw_write(0, VCORE_REQUEST2);
+	usleep_range((MAX_LEVEL + 2) * step_us, (MAX_LEVEL + 4) * step_us);
+	EXPECT(!(readl(regs + LEVEL) & 0xffff) && !hw_level(),
+	       "stand-in stuck at 0x%x", readl(regs + LEVEL));
+
+	dvfsrc_batch_init(&batch, fake_commit, T_URGENT, delay);
+	nr_commit = 0;
+	nr_write = 0;
+	stamped = 0;
+	memset(max_lat_ns, 0, sizeof(max_lat_ns));
+
+	return 0;
+}
+
+/* Each class votes twice per frame, the frame commits once */
+static int burst(int frame)
+{
+	int i;
+
+	for (i = 0; i < T_NR_BW; i++) {
+		vote(i, frame * 1000 + i * 100);
+		vote(i, frame * 1000 + i * 100 + 500);
+	}
+
+	return 2 * T_NR_BW;
+}
+
+static int case_burst(void)
+{
+	int frame, i, votes = 0;
+
+	if (reset(delay_us))
+		return -EINVAL;
+
+	for (frame = 1; frame <= 8; frame++) {
+		votes += burst(frame);
+		EXPECT(commits() == frame - 1, "frame %d committed early",
+		       frame);
+		wait_commits(frame);
+		EXPECT(commits() == frame, "frame %d: %u commits", frame,
+		       commits());
+	}
+	for (i = 0; i < T_NR_BW; i++)
+		EXPECT(readl(regs + SW_BW(i)) == (8000 + i * 100 + 500) / 100,
+		       "SW_BW_%d holds %u", i, readl(regs + SW_BW(i)));
+	EXPECT(max_bw_lat_us() <= delay_us + slack_us,
+	       "bandwidth vote waited %llu us", max_bw_lat_us());
+
+	pr_info("burst: %d votes, %u commits, %u writes, max wait %llu us\n",
+		votes, commits(), nr_write, max_bw_lat_us());
+
+	return 0;
+}
+
+/* An opp vote commits at once and takes what is pending along */
+static int case_bypass(void)
+{
+	int i;
+
+	if (reset(delay_us))
+		return -EINVAL;
+
+	for (i = 0; i < T_NR_BW; i++)
+		vote(i, 1000);
+	vote(T_EMI, MAX_LEVEL);
+	EXPECT(commits() == 1, "%u commits for the opp vote", commits());
+	EXPECT(hw_level() >= MAX_LEVEL, "returned at level %d", hw_level());
+	for (i = 0; i < T_NR_BW; i++)
+		EXPECT(readl(regs + SW_BW(i)) == 10,
+		       "SW_BW_%d not carried along", i);
+
+	usleep_range(2 * delay_us, 2 * delay_us + 100);
+	EXPECT(commits() == 1, "%u commits after the delay", commits());
+
+	pr_info("bypass: request to level %llu us over %d levels\n",
+		div_u64(max_lat_ns[T_EMI], NSEC_PER_USEC), MAX_LEVEL);
+
+	return 0;
+}
+
+/* Votes that keep coming do not hold a batch off */
+static int case_stream(void)
+{
+	int n, votes = 40;
+
+	if (reset(delay_us))
+		return -EINVAL;
+
+	for (n = 0; n < votes; n++) {
+		vote(n % T_NR_BW, n * 100);
+		usleep_range(delay_us / 4, delay_us / 4 + 50);
+	}
+	wait_commits(commits() + 1);
+	EXPECT(commits() <= votes / 2, "%u commits for %d votes", commits(),
+	       votes);
+	EXPECT(max_bw_lat_us() <= delay_us + slack_us,
+	       "bandwidth vote waited %llu us", max_bw_lat_us());
+
+	pr_info("stream: %d votes, %u commits, max wait %llu us\n", votes,
+		commits(), max_bw_lat_us());
+
+	return 0;
+}
+
+/* No delay is the old path: one commit per vote */
+static int case_unbatched(void)
+{
+	int votes;
+
+	if (reset(0))
+		return -EINVAL;
+
+	votes = burst(1);
+	EXPECT(commits() == votes, "%u commits for %d votes", commits(),
+	       votes);
+
+	pr_info("unbatched: %d votes, %u commits, %u writes\n", votes,
+		commits(), nr_write);
+
+	return 0;
+}
+
+static const struct {
+	const char *name;
+	int (*run)(void);
+} cases[] = {
+	{ "burst", case_burst },
+	{ "bypass", case_bypass },
+	{ "stream", case_stream },
+	{ "unbatched", case_unbatched },
+};
+
+static int __init dvfsrc_batch_test_init(void)
+{
+	int i, failed = 0;
+
+	regs = (void __force __iomem *)kzalloc(REG_SIZE, GFP_KERNEL);
+	if (!regs) {
+		failed = -ENOMEM;
+		goto out;
+	}
+	hrtimer_init(&seq, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	seq.function = hw_step;
+	dvfsrc_batch_init(&batch, fake_commit, T_URGENT, delay_us);
+
+	for (i = 0; i < ARRAY_SIZE(cases); i++) {
+		if (cases[i].run()) {
+			pr_info("not ok %d %s\n", i + 1, cases[i].name);
+			failed++;
+		} else {
+			pr_info("ok %d %s\n", i + 1, cases[i].name);
+		}
+	}
+
+	dvfsrc_batch_exit(&batch);
+	hrtimer_cancel(&seq);
+	kfree((void __force *)regs);
+out:
+	pr_info("%s\n", failed ? "FAIL" : "PASS");
+
+	return -EAGAIN;
+}
+
+module_init(dvfsrc_batch_test_init);
+
+MODULE_AUTHOR("Mediatek");
+MODULE_DESCRIPTION("DVFSRC vote batching test");
+MODULE_LICENSE("GPL");
@@ -66,6 +66,12 @@
 #define LOGE LOG_NOTICE
 
 static struct mrdump_mini_elf_header *mrdump_mini_ehdr;
+
+/* phdr of the packed regions, after the two note phdrs set up at init */
+#define MRDUMP_MINI_ZREGION_PHDR 2
+#define MRDUMP_MINI_ZREGION_OFF	(MRDUMP_MINI_HEADER_SIZE + \
+	ALIGN(sizeof(struct aee_process_info), 8))
+
 #ifdef CONFIG_MODULES
 static char modules_info_buf[MODULES_INFO_BUF_SIZE];
 #endif
@@ -739,6 +745,27 @@ void mrdump_mini_add_extra_misc(void)
 	}
 }
 
+static unsigned int mrdump_mini_addr;
+static unsigned int mrdump_mini_size;
+
+static void mrdump_mini_add_zregions(void)
+{
+	struct mrdump_mini_zsum sum;
+	size_t used;
+
+	if (mrdump_mini_ehdr == NULL ||
+		mrdump_mini_size <= MRDUMP_MINI_ZREGION_OFF)
+		return;
+	used = mrdump_mini_zpack((void *)mrdump_mini_ehdr +
+			MRDUMP_MINI_ZREGION_OFF,
+			mrdump_mini_size - MRDUMP_MINI_ZREGION_OFF, &sum);
+	fill_elf_note_phdr(&mrdump_mini_ehdr->phdrs[MRDUMP_MINI_ZREGION_PHDR],
+			used, MRDUMP_MINI_ZREGION_OFF);
+	LOGE("mrdump: regions %u/%u stored, 0x%llx -> 0x%llx bytes in %llu ns\n",
+		sum.nr_stored, sum.nr_regions, sum.raw_bytes,
+		sum.stored_bytes, sum.elapsed_ns);
+}
+
 static void mrdump_mini_add_loads(void);
 void mrdump_mini_ke_cpu_regs(struct pt_regs *regs)
 {
@@ -755,6 +782,7 @@ void mrdump_mini_ke_cpu_regs(struct pt_regs *regs)
 	mrdump_mini_build_task_info(regs);
 	mrdump_modules_info(NULL, -1);
 	mrdump_mini_add_extra_misc();
+	mrdump_mini_add_zregions();
 }
 EXPORT_SYMBOL(mrdump_mini_ke_cpu_regs);
 
@@ -764,8 +792,6 @@ static void mrdump_mini_fatal(const char *str)
 	BUG();
 }
 
-static unsigned int mrdump_mini_addr;
-static unsigned int mrdump_mini_size;
 void mrdump_mini_set_addr_size(unsigned int addr, unsigned int size)
 {
 	mrdump_mini_addr = addr;
@@ -1002,6 +1028,9 @@ int mrdump_mini_init(void)
 	fill_elf_note_phdr(&mrdump_mini_ehdr->phdrs[1],
 			sizeof(mrdump_mini_ehdr->misc),
 			offsetof(struct mrdump_mini_elf_header, misc));
+	/* filled at panic, keeps the loads from taking the slot */
+	fill_elf_note_phdr(&mrdump_mini_ehdr->phdrs[MRDUMP_MINI_ZREGION_PHDR],
+			0, MRDUMP_MINI_ZREGION_OFF);
 
 	if (mrdump_cblock) {
 
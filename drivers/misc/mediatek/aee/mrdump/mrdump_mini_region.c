@@ -0,0 +1,394 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See http://www.gnu.org/licenses/gpl-2.0.html for more details.
+ */
+
+/*
+ * Minidump regions
+ *
+ * Memory worth having in every minidump is registered here while the
+ * system runs; the task list is refreshed in the background into one of
+ * two buffers so the registered one is always whole. At panic the regions
+ * are packed, most valuable first, as ELF notes into the minidump buffer:
+ * lz4 compressed when that helps, stored raw otherwise, and skipped once
+ * the time budget or the space is used up. The first note sums it up.
+ */
+
+#include <linux/atomic.h>
+#include <linux/elf.h>
+#include <linux/io.h>
+#include <linux/lz4.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/module.h>
+#include <linux/sched/clock.h>
+#include <linux/sched/cputime.h>
+#include <linux/sched/signal.h>
+#include <linux/spinlock.h>
+#include <linux/vmalloc.h>
+#include <linux/vmstat.h>
+#include <linux/workqueue.h>
+#include <mrdump.h>
+#include "mrdump_private.h"
+
+#define ZNOTE_NAME_SZ	ALIGN(sizeof(MRDUMP_MINI_ZNOTE_NAME), 4)
+#define ZNOTE_LEN(desc)	(sizeof(struct elf_note) + ZNOTE_NAME_SZ + \
+			 ALIGN(desc, 4))
+/* first guess of the packing cost, until a region has been timed */
+#define ZPACK_NS_PER_KB	10000
+
+#define MRDUMP_MINI_NR_TASK	2048
+
+static struct mrdump_mini_region mrdump_regions[MRDUMP_MINI_NR_REGION];
+static int mrdump_nr_regions;
+static DEFINE_SPINLOCK(mrdump_region_lock);
+
+static atomic_t zpack_busy;
+#if IS_BUILTIN(CONFIG_LZ4_COMPRESS)
+static char zpack_wrkmem[LZ4_MEM_COMPRESS];
+static void *zpack_bounce;
+#endif
+
+static struct mrdump_mini_task *mrdump_tasks[2];
+static int mrdump_task_idx;
+static struct delayed_work mrdump_task_work;
+
+static unsigned int zpack_budget_us = 20000;
+module_param(zpack_budget_us, uint, 0644);
+
+static unsigned int task_refresh_ms = 2000;
+module_param(task_refresh_ms, uint, 0644);
+
+static int mrdump_mini_find_region(const char *name)
+{
+	int i;
+
+	for (i = 0; i < mrdump_nr_regions; i++)
+		if (!strncmp(mrdump_regions[i].name, name,
+			     MRDUMP_MINI_REGION_NAME))
+			return i;
+	return -1;
+}
+
+int mrdump_mini_add_region(const char *name, void *vaddr, unsigned long size,
+		unsigned int prio)
+{
+	struct mrdump_mini_region *r;
+	unsigned long flags;
+	int ret = 0;
+
+	spin_lock_irqsave(&mrdump_region_lock, flags);
+	if (mrdump_mini_find_region(name) >= 0) {
+		ret = -EEXIST;
+	} else if (mrdump_nr_regions == MRDUMP_MINI_NR_REGION) {
+		ret = -ENOSPC;
+	} else {
+		r = &mrdump_regions[mrdump_nr_regions];
+		strncpy(r->name, name, MRDUMP_MINI_REGION_NAME - 1);
+		r->vaddr = (unsigned long)vaddr;
+		r->size = size;
+		r->prio = prio;
+		smp_wmb();
+		mrdump_nr_regions++;
+	}
+	spin_unlock_irqrestore(&mrdump_region_lock, flags);
+
+	return ret;
+}
+EXPORT_SYMBOL(mrdump_mini_add_region);
+
+/* Read at panic without the lock, so the size never covers a wrong buffer */
+void mrdump_mini_update_region(const char *name, void *vaddr,
+		unsigned long size)
+{
+	struct mrdump_mini_region *r;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&mrdump_region_lock, flags);
+	i = mrdump_mini_find_region(name);
+	if (i >= 0) {
+		r = &mrdump_regions[i];
+		WRITE_ONCE(r->size, 0);
+		smp_wmb();
+		WRITE_ONCE(r->vaddr, (unsigned long)vaddr);
+		smp_wmb();
+		WRITE_ONCE(r->size, size);
+	}
+	spin_unlock_irqrestore(&mrdump_region_lock, flags);
+}
+EXPORT_SYMBOL(mrdump_mini_update_region);
+
+void mrdump_mini_del_region(const char *name)
+{
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&mrdump_region_lock, flags);
+	i = mrdump_mini_find_region(name);
+	if (i >= 0) {
+		mrdump_regions[i].size = 0;
+		smp_wmb();
+		mrdump_regions[i] = mrdump_regions[--mrdump_nr_regions];
+	}
+	spin_unlock_irqrestore(&mrdump_region_lock, flags);
+}
+EXPORT_SYMBOL(mrdump_mini_del_region);
+
+static bool zpack_readable(unsigned long vaddr, unsigned long size)
+{
+	unsigned long p;
+
+	for (p = vaddr & PAGE_MASK; p < vaddr + size; p += PAGE_SIZE)
+		if (!kernel_addr_valid(p))
+			return false;
+	return true;
+}
+
+static unsigned long zpack_pa(unsigned long vaddr)
+{
+	if (virt_addr_valid((void *)vaddr))
+		return __pa(vaddr);
+	if (is_vmalloc_addr((void *)vaddr))
+		return page_to_phys(vmalloc_to_page((void *)vaddr)) +
+			offset_in_page(vaddr);
+	return 0;
+}
+
+/* Returns the bytes written at buf + off, 0 if the note does not fit */
+static size_t zpack_note(void *buf, size_t off, size_t size, u32 type,
+		const void *desc, size_t desc_len,
+		const void *data, size_t data_len)
+{
+	static const char name[ZNOTE_NAME_SZ] = MRDUMP_MINI_ZNOTE_NAME;
+	static const char zero[4];
+	size_t len = ZNOTE_LEN(desc_len + data_len);
+	struct elf_note note;
+
+	if (off + len > size)
+		return 0;
+
+	note.n_namesz = sizeof(MRDUMP_MINI_ZNOTE_NAME);
+	note.n_descsz = desc_len + data_len;
+	note.n_type = type;
+	buf += off;
+	memcpy_toio(buf, &note, sizeof(note));
+	buf += sizeof(note);
+	memcpy_toio(buf, name, ZNOTE_NAME_SZ);
+	buf += ZNOTE_NAME_SZ;
+	memcpy_toio(buf, desc, desc_len);
+	buf += desc_len;
+	memcpy_toio(buf, data, data_len);
+	buf += data_len;
+	memcpy_toio(buf, zero, ALIGN(desc_len + data_len, 4) -
+		    (desc_len + data_len));
+
+	return len;
+}
+
+/* Stores one region, returns how it went in desc->codec */
+static const void *zpack_one(const struct mrdump_mini_region *r,
+		struct mrdump_mini_zdesc *desc, size_t room)
+{
+	const void *src = (const void *)r->vaddr;
+	int zlen = 0;
+
+	if (!desc->raw_size || !zpack_readable(r->vaddr, desc->raw_size)) {
+		desc->codec = MRDUMP_MINI_Z_SKIP_INVALID;
+		return NULL;
+	}
+
+#if IS_BUILTIN(CONFIG_LZ4_COMPRESS)
+	if (zpack_bounce && room)
+		zlen = LZ4_compress_fast(src, zpack_bounce, desc->raw_size,
+				min_t(size_t, room,
+				      LZ4_compressBound(MRDUMP_MINI_REGION_MAX)),
+				1, zpack_wrkmem);
+	if (zlen > 0 && zlen < desc->raw_size) {
+		desc->codec = MRDUMP_MINI_Z_LZ4;
+		desc->stored_size = zlen;
+		return zpack_bounce;
+	}
+#endif
+	if (desc->raw_size <= room) {
+		desc->codec = MRDUMP_MINI_Z_RAW;
+		desc->stored_size = desc->raw_size;
+		return src;
+	}
+	desc->codec = MRDUMP_MINI_Z_SKIP_SPACE;
+	return NULL;
+}
+
+/*
+ * Packs regions into [buf, buf + size) as ELF notes, lower prio first.
+ * The most valuable region is always tried; every other one only if the
+ * time spent so far plus its estimated cost stays within budget_ns.
+ * Returns the bytes of notes written, 0 if nothing could be.
+ */
+size_t mrdump_mini_zpack_regions(const struct mrdump_mini_region *regions,
+		int nr, void *buf, size_t size, u64 budget_ns,
+		struct mrdump_mini_zsum *sum)
+{
+	int order[MRDUMP_MINI_NR_REGION];
+	u64 start = local_clock(), t, ns_per_kb = ZPACK_NS_PER_KB;
+	size_t off = ZNOTE_LEN(sizeof(*sum)), room, len;
+	struct mrdump_mini_zdesc desc;
+	const void *data;
+	int i, j, k;
+
+	memset(sum, 0, sizeof(*sum));
+	sum->budget_ns = budget_ns;
+	nr = min(nr, MRDUMP_MINI_NR_REGION);
+	if (off > size || atomic_xchg(&zpack_busy, 1))
+		return 0;
+
+	for (i = 0; i < nr; i++) {
+		for (j = i; j > 0 && regions[order[j - 1]].prio >
+			    regions[i].prio; j--)
+			order[j] = order[j - 1];
+		order[j] = i;
+	}
+
+	for (k = 0; k < nr; k++) {
+		const struct mrdump_mini_region *r = &regions[order[k]];
+
+		memset(&desc, 0, sizeof(desc));
+		strncpy(desc.name, r->name, MRDUMP_MINI_REGION_NAME - 1);
+		desc.vaddr = READ_ONCE(r->vaddr);
+		desc.raw_size = min_t(unsigned long, READ_ONCE(r->size),
+				      MRDUMP_MINI_REGION_MAX);
+		desc.prio = r->prio;
+		data = NULL;
+
+		t = local_clock();
+		room = size - off > ZNOTE_LEN(sizeof(desc)) ?
+			size - off - ZNOTE_LEN(sizeof(desc)) : 0;
+		if (k && t - start + (desc.raw_size >> 10) * ns_per_kb >
+		    budget_ns) {
+			desc.codec = MRDUMP_MINI_Z_SKIP_TIME;
+		} else {
+			data = zpack_one(r, &desc, room);
+			if (desc.raw_size >= SZ_1K)
+				ns_per_kb = div64_u64(local_clock() - t,
+						      desc.raw_size >> 10);
+		}
+		if (data)
+			desc.paddr = zpack_pa(desc.vaddr);
+
+		len = zpack_note(buf, off, size, NT_MRDUMP_ZREGION, &desc,
+				 sizeof(desc), data, data ? desc.stored_size : 0);
+		if (!len)
+			break;
+		off += len;
+		sum->nr_regions++;
+		sum->raw_bytes += desc.raw_size;
+		if (data) {
+			sum->nr_stored++;
+			sum->stored_bytes += desc.stored_size;
+		}
+	}
+
+	sum->elapsed_ns = local_clock() - start;
+	sum->used = off;
+	zpack_note(buf, 0, size, NT_MRDUMP_ZSUM, sum, sizeof(*sum), NULL, 0);
+	atomic_set(&zpack_busy, 0);
+
+	return off;
+}
+EXPORT_SYMBOL(mrdump_mini_zpack_regions);
+
+/* Panic path: packs the registered regions with the configured budget */
+size_t mrdump_mini_zpack(void *buf, size_t size, struct mrdump_mini_zsum *sum)
+{
+	return mrdump_mini_zpack_regions(mrdump_regions,
+			READ_ONCE(mrdump_nr_regions), buf, size,
+			(u64)zpack_budget_us * NSEC_PER_USEC, sum);
+}
+
+static void mrdump_mini_fill_task(struct mrdump_mini_task *t,
+		struct task_struct *p)
+{
+	u64 utime, stime;
+
+	memset(t, 0, sizeof(*t));
+	task_cputime_adjusted(p, &utime, &stime);
+	t->task = (unsigned long)p;
+	t->stack = (unsigned long)p->stack;
+	t->pid = p->pid;
+	t->tgid = p->tgid;
+	t->ppid = task_pid_nr(rcu_dereference(p->real_parent));
+	t->cpu = task_cpu(p);
+	t->state = p->state;
+	t->prio = p->prio;
+	t->utime = utime;
+	t->stime = stime;
+	t->sum_exec_runtime = p->se.sum_exec_runtime;
+	memcpy(t->comm, p->comm, sizeof(t->comm));
+}
+
+/* Refills the buffer not registered, then points the region at it */
+static void mrdump_mini_task_refresh(struct work_struct *work)
+{
+	struct mrdump_mini_task *t = mrdump_tasks[mrdump_task_idx ^ 1];
+	struct task_struct *g, *p;
+	int n = 0;
+
+	rcu_read_lock();
+	for_each_process_thread(g, p) {
+		if (n == MRDUMP_MINI_NR_TASK)
+			goto out;
+		mrdump_mini_fill_task(&t[n++], p);
+	}
+out:
+	rcu_read_unlock();
+
+	mrdump_task_idx ^= 1;
+	mrdump_mini_update_region("TASKS", t, n * sizeof(*t));
+	schedule_delayed_work(&mrdump_task_work,
+			      msecs_to_jiffies(task_refresh_ms));
+}
+
+static int __init mrdump_mini_region_init(void)
+{
+	char name[MRDUMP_MINI_REGION_NAME];
+	size_t sz = MRDUMP_MINI_NR_TASK * sizeof(struct mrdump_mini_task);
+	int nid;
+
+	BUILD_BUG_ON(MRDUMP_MINI_NR_TASK * sizeof(struct mrdump_mini_task) >
+		     MRDUMP_MINI_REGION_MAX);
+
+#if IS_BUILTIN(CONFIG_LZ4_COMPRESS)
+	zpack_bounce = vmalloc(LZ4_compressBound(MRDUMP_MINI_REGION_MAX));
+#endif
+
+	mrdump_tasks[0] = vzalloc(sz);
+	mrdump_tasks[1] = vzalloc(sz);
+	if (mrdump_tasks[0] && mrdump_tasks[1]) {
+		mrdump_mini_add_region("TASKS", mrdump_tasks[0], 0, 0);
+		INIT_DEFERRABLE_WORK(&mrdump_task_work,
+				     mrdump_mini_task_refresh);
+		schedule_delayed_work(&mrdump_task_work, 0);
+	}
+
+	for_each_online_node(nid) {
+		snprintf(name, sizeof(name), "NODE%d", nid);
+		mrdump_mini_add_region(name, NODE_DATA(nid),
+				       sizeof(pg_data_t), 1);
+	}
+	mrdump_mini_add_region("VM_ZONE_STAT", vm_zone_stat,
+			       sizeof(vm_zone_stat), 2);
+	mrdump_mini_add_region("VM_NODE_STAT", vm_node_stat,
+			       sizeof(vm_node_stat), 2);
+
+	return 0;
+}
+late_initcall(mrdump_mini_region_init);
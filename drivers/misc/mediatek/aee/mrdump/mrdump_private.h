@@ -96,6 +96,8 @@ extern void mrdump_mini_add_misc(unsigned long addr, unsigned long size,
 		unsigned long start, char *name);
 extern int mrdump_task_info(unsigned char *buffer, size_t sz_buf);
 extern int mrdump_modules_info(unsigned char *buffer, size_t sz_buf);
+extern size_t mrdump_mini_zpack(void *buf, size_t size,
+		struct mrdump_mini_zsum *sum);
 
 /* for WDT timeout case : dump timer/schedule/irq/softirq etc...
  * debug information
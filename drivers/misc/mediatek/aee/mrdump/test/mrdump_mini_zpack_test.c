@@ -0,0 +1,331 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See http://www.gnu.org/licenses/gpl-2.0.html for more details.
+ */
+
+/*
+ * Minidump region packing test
+ *
+ * Packs synthetic regions (a task table, random bytes, zeroes and an
+ * unmapped address) with mrdump_mini_zpack_regions(), the function the
+ * panic path uses, then walks the ELF notes it wrote the way a minidump
+ * reader would: every stored region must decompress to its source, the
+ * notes must come in priority order and the summary must add up. Cases
+ * cover a roomy buffer, a zero time budget and a buffer too small for
+ * everything. Results go to the kernel log; loading always fails with
+ * -EAGAIN so the test can be run again without rmmod.
+ */
+
+#define pr_fmt(fmt) "mrdump_zpack_test: " fmt
+
+#include <linux/elf.h>
+#include <linux/lz4.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/sched.h>
+#include <linux/vmalloc.h>
+#include <mrdump.h>
+
+#define NR_TASK		1024
+#define NOISE_SIZE	SZ_64K
+#define ZERO_SIZE	SZ_128K
+#define BUF_SIZE	SZ_1M
+
+#define EXPECT(cond, fmt, ...)						\
+	do {								\
+		if (!(cond)) {						\
+			pr_err("%s:%d: " fmt "\n", __func__, __LINE__,	\
+			       ##__VA_ARGS__);				\
+			return -EINVAL;					\
+		}							\
+	} while (0)
+
+enum { R_TASKS, R_NOISE, R_ZERO, R_BAD, NR_R };
+
+static struct mrdump_mini_region regions[NR_R];
+static struct mrdump_mini_task *tasks;
+static void *noise, *zero, *buf, *scratch;
+
+/* What the notes said, by region */
+struct parsed {
+	struct mrdump_mini_zsum sum;
+	u32 codec[NR_R];
+	u32 stored[NR_R];
+	int nr;
+};
+
+static int region_index(const char *name)
+{
+	int i;
+
+	for (i = 0; i < NR_R; i++)
+		if (!strncmp(regions[i].name, name, MRDUMP_MINI_REGION_NAME))
+			return i;
+	return -1;
+}
+
+static int check_region(const struct mrdump_mini_zdesc *d, const void *data,
+		struct parsed *p)
+{
+	int i = region_index(d->name);
+	int len;
+
+	EXPECT(i >= 0, "unknown region %.16s", d->name);
+	EXPECT(d->vaddr == regions[i].vaddr && d->prio == regions[i].prio,
+	       "%s: desc does not match the region", regions[i].name);
+	p->codec[i] = d->codec;
+	p->stored[i] = d->stored_size;
+
+	switch (d->codec) {
+	case MRDUMP_MINI_Z_LZ4:
+		len = LZ4_decompress_safe(data, scratch, d->stored_size,
+					  MRDUMP_MINI_REGION_MAX);
+		EXPECT(len == d->raw_size, "%s: decompressed %d of %u",
+		       regions[i].name, len, d->raw_size);
+		EXPECT(!memcmp(scratch, (void *)regions[i].vaddr, len),
+		       "%s: decompressed data differs", regions[i].name);
+		break;
+	case MRDUMP_MINI_Z_RAW:
+		EXPECT(d->stored_size == d->raw_size, "%s: raw %u of %u",
+		       regions[i].name, d->stored_size, d->raw_size);
+		EXPECT(!memcmp(data, (void *)regions[i].vaddr, d->raw_size),
+		       "%s: raw data differs", regions[i].name);
+		break;
+	default:
+		EXPECT(!d->stored_size, "%s: skipped but %u bytes stored",
+		       regions[i].name, d->stored_size);
+		break;
+	}
+
+	return 0;
+}
+
+/* Walks the notes in [buf, buf + used) */
+static int parse(size_t used, struct parsed *p)
+{
+	const struct elf_note *n;
+	const struct mrdump_mini_zdesc *d;
+	size_t off = 0, len;
+	u32 prio = 0;
+	int ret;
+
+	memset(p, 0, sizeof(*p));
+	while (off < used) {
+		EXPECT(used - off >= sizeof(*n) + 8, "truncated note at %zu",
+		       off);
+		n = buf + off;
+		EXPECT(n->n_namesz == sizeof(MRDUMP_MINI_ZNOTE_NAME) &&
+		       !strcmp((char *)(n + 1), MRDUMP_MINI_ZNOTE_NAME),
+		       "bad note name at %zu", off);
+		len = sizeof(*n) + ALIGN(n->n_namesz, 4) +
+			ALIGN(n->n_descsz, 4);
+		EXPECT(off + len <= used, "note at %zu runs past %zu", off,
+		       used);
+		d = (void *)(n + 1) + ALIGN(n->n_namesz, 4);
+
+		if (!off) {
+			EXPECT(n->n_type == NT_MRDUMP_ZSUM &&
+			       n->n_descsz == sizeof(p->sum),
+			       "first note is not the summary");
+			memcpy(&p->sum, d, sizeof(p->sum));
+		} else {
+			EXPECT(n->n_type == NT_MRDUMP_ZREGION &&
+			       n->n_descsz == sizeof(*d) + d->stored_size,
+			       "bad region note at %zu", off);
+			EXPECT(d->prio >= prio, "%.16s out of priority order",
+			       d->name);
+			prio = d->prio;
+			ret = check_region(d, d + 1, p);
+			if (ret)
+				return ret;
+			p->nr++;
+		}
+		off += len;
+	}
+
+	EXPECT(off == used && p->sum.used == used, "used %zu, summary %llu",
+	       used, p->sum.used);
+	EXPECT(p->sum.nr_regions == p->nr, "summary has %u regions, %d notes",
+	       p->sum.nr_regions, p->nr);
+
+	return 0;
+}
+
+static int pack(size_t size, u64 budget_ns, struct parsed *p)
+{
+	struct mrdump_mini_zsum sum;
+	size_t used;
+	int ret;
+
+	memset(buf, 0xa5, BUF_SIZE);
+	used = mrdump_mini_zpack_regions(regions, NR_R, buf, size,
+					 budget_ns, &sum);
+	EXPECT(used && used <= size, "packed %zu into %zu", used, size);
+	ret = parse(used, p);
+	if (ret)
+		return ret;
+	EXPECT(!memcmp(&sum, &p->sum, sizeof(sum)),
+	       "returned summary differs from the note");
+	pr_info("%zu bytes budget %llu ns: %u/%u stored, %llu -> %llu bytes, %llu ns\n",
+		size, budget_ns, sum.nr_stored, sum.nr_regions, sum.raw_bytes,
+		sum.stored_bytes, sum.elapsed_ns);
+
+	return 0;
+}
+
+static int case_roomy(void)
+{
+	struct parsed p;
+	int ret;
+
+	ret = pack(BUF_SIZE, NSEC_PER_SEC, &p);
+	if (ret)
+		return ret;
+	EXPECT(p.codec[R_BAD] == MRDUMP_MINI_Z_SKIP_INVALID,
+	       "unmapped region got codec %u", p.codec[R_BAD]);
+	EXPECT(p.codec[R_NOISE] == MRDUMP_MINI_Z_RAW,
+	       "random bytes got codec %u", p.codec[R_NOISE]);
+	EXPECT(p.sum.nr_stored == 3, "%u regions stored", p.sum.nr_stored);
+	if (IS_BUILTIN(CONFIG_LZ4_COMPRESS)) {
+		EXPECT(p.codec[R_TASKS] == MRDUMP_MINI_Z_LZ4 &&
+		       p.codec[R_ZERO] == MRDUMP_MINI_Z_LZ4,
+		       "tasks/zero not compressed");
+		EXPECT(p.sum.stored_bytes * 2 < p.sum.raw_bytes,
+		       "saved only %llu of %llu bytes",
+		       p.sum.raw_bytes - p.sum.stored_bytes,
+		       p.sum.raw_bytes);
+	}
+
+	return 0;
+}
+
+/* The most valuable region is packed even with no time at all */
+static int case_no_budget(void)
+{
+	struct parsed p;
+	int ret;
+
+	ret = pack(BUF_SIZE, 0, &p);
+	if (ret)
+		return ret;
+	EXPECT(p.codec[R_TASKS] <= MRDUMP_MINI_Z_LZ4, "tasks not stored");
+	EXPECT(p.codec[R_NOISE] == MRDUMP_MINI_Z_SKIP_TIME &&
+	       p.codec[R_ZERO] == MRDUMP_MINI_Z_SKIP_TIME,
+	       "lower regions not skipped for time");
+
+	return 0;
+}
+
+/* Room for the tasks and little else */
+static int case_tight(void)
+{
+	struct parsed p;
+	size_t size;
+	int ret;
+
+	ret = pack(BUF_SIZE, NSEC_PER_SEC, &p);
+	if (ret)
+		return ret;
+	size = p.sum.used - p.stored[R_NOISE] - p.stored[R_ZERO];
+	ret = pack(size, NSEC_PER_SEC, &p);
+	if (ret)
+		return ret;
+	EXPECT(p.codec[R_TASKS] <= MRDUMP_MINI_Z_LZ4, "tasks not stored");
+	EXPECT(p.codec[R_NOISE] == MRDUMP_MINI_Z_SKIP_SPACE,
+	       "random bytes got codec %u in %zu bytes", p.codec[R_NOISE],
+	       size);
+
+	return 0;
+}
+
+static void fill_state(void)
+{
+	struct mrdump_mini_task *t;
+	int i;
+
+	for (i = 0; i < NR_TASK; i++) {
+		t = &tasks[i];
+		t->task = 0xffffffc0c0000000UL + i * 0x1400;
+		t->stack = 0xffffff8008000000UL + i * THREAD_SIZE;
+		t->pid = 100 + i;
+		t->tgid = 100 + i - i % 4;
+		t->ppid = i % 16 ? 1 : 2;
+		t->cpu = i % 8;
+		t->state = i % 3 ? TASK_INTERRUPTIBLE : TASK_RUNNING;
+		t->prio = 120;
+		t->utime = i * 1000000ULL;
+		t->stime = i * 300000ULL;
+		t->sum_exec_runtime = t->utime + t->stime;
+		snprintf(t->comm, sizeof(t->comm), "kworker/%d:%d", i % 8,
+			 i / 8);
+	}
+	get_random_bytes(noise, NOISE_SIZE);
+
+	regions[R_TASKS] = (struct mrdump_mini_region){ "T_TASKS",
+		(unsigned long)tasks, NR_TASK * sizeof(*tasks), 0 };
+	regions[R_NOISE] = (struct mrdump_mini_region){ "T_NOISE",
+		(unsigned long)noise, NOISE_SIZE, 1 };
+	regions[R_ZERO] = (struct mrdump_mini_region){ "T_ZERO",
+		(unsigned long)zero, ZERO_SIZE, 2 };
+	regions[R_BAD] = (struct mrdump_mini_region){ "T_BAD",
+		0x10, PAGE_SIZE, 3 };
+}
+
+static const struct {
+	const char *name;
+	int (*run)(void);
+} cases[] = {
+	{ "roomy", case_roomy },
+	{ "no_budget", case_no_budget },
+	{ "tight", case_tight },
+};
+
+static int __init mrdump_zpack_test_init(void)
+{
+	int i, failed = 0;
+
+	tasks = vzalloc(NR_TASK * sizeof(*tasks));
+	noise = vmalloc(NOISE_SIZE);
+	zero = vzalloc(ZERO_SIZE);
+	buf = vmalloc(BUF_SIZE);
+	scratch = vmalloc(MRDUMP_MINI_REGION_MAX);
+	if (!tasks || !noise || !zero || !buf || !scratch) {
+		failed = -ENOMEM;
+		goto out;
+	}
+
+	fill_state();
+	for (i = 0; i < ARRAY_SIZE(cases); i++) {
+		if (cases[i].run()) {
+			pr_info("not ok %d %s\n", i + 1, cases[i].name);
+			failed++;
+		} else {
+			pr_info("ok %d %s\n", i + 1, cases[i].name);
+		}
+	}
+
+out:
+	vfree(scratch);
+	vfree(buf);
+	vfree(zero);
+	vfree(noise);
+	vfree(tasks);
+
+	pr_info("%s\n", failed ? "FAIL" : "PASS");
+
+	return -EAGAIN;
+}
+
+module_init(mrdump_zpack_test_init);
+
+MODULE_AUTHOR("Mediatek");
+MODULE_DESCRIPTION("minidump region packing test");
+MODULE_LICENSE("GPL");
@@ -187,7 +187,8 @@ unsigned int hps_cpu_get_nr_heavy_task(void)
 void hps_cpu_get_tlp(unsigned int *avg, unsigned int *iowait_avg)
 {
 #ifdef CONFIG_MTK_SCHED_RQAVG_KS
-	sched_get_nr_running_avg((int *)avg, (int *)iowait_avg);
+	sched_get_nr_running_avg_decayed(HPS_TLP_HL_MS,
+		(int *)avg, (int *)iowait_avg);
 #else
 	*avg = 0;
 	*iowait_avg = 0;
@@ -286,7 +286,10 @@ extern unsigned int sched_get_percpu_load(
 			int cpu, bool reset, bool use_maxfreq);
 /* definition in mediatek/kernel/kernel/sched/rq_stats.c */
 extern unsigned int sched_get_nr_heavy_task(void);
-extern void sched_get_nr_running_avg(int *avg, int *iowait_avg);
+extern void sched_get_nr_running_avg_decayed(unsigned int hl_ms,
+		int *avg, int *iowait_avg);
+/* half-life of the tlp average, about the hps period */
+#define HPS_TLP_HL_MS	64
 
 #ifdef __cplusplus
 }
@@ -30,6 +30,10 @@ enum {
 extern unsigned int mt_cpufreq_get_freq_by_idx(int id, int idx);
 extern int update_userlimit_cpu_freq(int kicker, int num_cluster
 				, struct ppm_limit_data *freq_limit);
+/* same as above, the request is dropped after timeout_ms */
+extern int update_userlimit_cpu_freq_timeout(int kicker, int num_cluster
+				, struct ppm_limit_data *freq_limit
+				, unsigned int timeout_ms);
 extern int update_userlimit_cpu_core(int kicker, int num_cluster
 				, struct ppm_limit_data *core_limit);
 
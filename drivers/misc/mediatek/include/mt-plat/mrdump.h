@@ -17,6 +17,7 @@
 #include <stdarg.h>
 #include <linux/elf.h>
 #include <linux/elfcore.h>
+#include <linux/sizes.h>
 #include <asm/ptrace.h>
 #include <mt-plat/aee.h>
 
@@ -215,6 +216,82 @@ struct mrdump_rsvmem_block {
 	(MRDUMP_MINI_NR_SECTION * MRDUMP_MINI_SECTION_SIZE)
 #define MRDUMP_MINI_BUF_SIZE (MRDUMP_MINI_HEADER_SIZE + MRDUMP_MINI_DATA_SIZE)
 
+/*
+ * Regions kept up to date while the system runs and copied, compressed,
+ * into the minidump buffer at panic. Lower prio is more valuable and is
+ * packed first.
+ */
+#define MRDUMP_MINI_NR_REGION	16
+#define MRDUMP_MINI_REGION_NAME	16
+#define MRDUMP_MINI_REGION_MAX	SZ_512K
+
+struct mrdump_mini_region {
+	char name[MRDUMP_MINI_REGION_NAME];
+	unsigned long vaddr;
+	unsigned long size;
+	unsigned int prio;
+};
+
+/* NOTE!! any change to these structs should be compatible in aed */
+#define NT_MRDUMP_ZSUM		4093
+#define NT_MRDUMP_ZREGION	4094
+#define MRDUMP_MINI_ZNOTE_NAME	"MRDUMPZ"
+
+enum {
+	MRDUMP_MINI_Z_RAW,		/* stored as is */
+	MRDUMP_MINI_Z_LZ4,		/* lz4 block */
+	MRDUMP_MINI_Z_SKIP_TIME,	/* over the time budget, not stored */
+	MRDUMP_MINI_Z_SKIP_SPACE,	/* did not fit, not stored */
+	MRDUMP_MINI_Z_SKIP_INVALID,	/* address not mapped, not stored */
+};
+
+/* desc of the NT_MRDUMP_ZREGION note, followed by the stored bytes */
+struct mrdump_mini_zdesc {
+	char name[MRDUMP_MINI_REGION_NAME];
+	uint64_t vaddr;
+	uint64_t paddr;
+	uint32_t raw_size;
+	uint32_t stored_size;
+	uint32_t codec;
+	uint32_t prio;
+};
+
+/* desc of the NT_MRDUMP_ZSUM note, the first note of the area */
+struct mrdump_mini_zsum {
+	uint32_t nr_regions;
+	uint32_t nr_stored;
+	uint64_t raw_bytes;
+	uint64_t stored_bytes;
+	uint64_t elapsed_ns;
+	uint64_t budget_ns;
+	uint64_t used;		/* bytes of notes, this one included */
+};
+
+/* entry of the "TASKS" region */
+struct mrdump_mini_task {
+	uint64_t task;
+	uint64_t stack;
+	int32_t pid;
+	int32_t tgid;
+	int32_t ppid;
+	int32_t cpu;
+	uint32_t state;
+	int32_t prio;
+	uint64_t utime;
+	uint64_t stime;
+	uint64_t sum_exec_runtime;
+	char comm[16];
+};
+
+int mrdump_mini_add_region(const char *name, void *vaddr, unsigned long size,
+		unsigned int prio);
+void mrdump_mini_update_region(const char *name, void *vaddr,
+		unsigned long size);
+void mrdump_mini_del_region(const char *name);
+size_t mrdump_mini_zpack_regions(const struct mrdump_mini_region *regions,
+		int nr, void *buf, size_t size, u64 budget_ns,
+		struct mrdump_mini_zsum *sum);
+
 int mrdump_init(void);
 void __mrdump_create_oops_dump(enum AEE_REBOOT_MODE reboot_mode,
 		struct pt_regs *regs, const char *msg, ...);
@@ -58,6 +58,19 @@ extern int zmc_unregister_client(struct notifier_block *nb);
 extern int zmc_notifier_call_chain(unsigned long val, void *v);
 
 #define ZMC_EVENT_ALLOC_MOVABLE 0x01
+/* data is a struct zmc_predict, expected to be allocated soon */
+#define ZMC_EVENT_PREDICT_MOVABLE 0x02
+/* data is a struct zmc_predict, it will not be allocated after all */
+#define ZMC_EVENT_CANCEL_MOVABLE 0x03
+
+struct zmc_predict {
+	struct cma *cma;
+	unsigned long count;
+	unsigned int align;
+	enum zmc_prio prio;
+};
+
+extern void zmc_prefetch_progress(unsigned long *held, unsigned long *total);
 #endif
 
 #ifdef CONFIG_MTK_SSMR
@@ -15,6 +15,72 @@
 #define __MTK_PERFOBSERVER_H__
 
 #include <linux/notifier.h>
+#include <linux/types.h>
+
+enum pob_ntf_type {
+	POB_NTF_BQD,
+	POB_NTF_FPSGO,
+	POB_NTF_RS,
+	POB_NTF_QOS,
+	POB_NTF_QOS_IND,
+	POB_NTF_NN,
+	POB_NTF_XPUFREQ,
+	NR_POB_NTF,
+};
+
+#define POB_NTF_PAYLOAD_MAX	32
+#define POB_NTF_HIST_NR		16
+
+/* typed event record, the payload is a copy of the notifier data */
+struct pob_ntf_rec {
+	u64 ts;
+	unsigned long val;
+	unsigned short type;
+	bool has_payload;
+	u64 payload[POB_NTF_PAYLOAD_MAX / sizeof(u64)];
+};
+
+/*
+ * A burst of events queued by one publisher and dispatched in a single
+ * pass by pob_ntf_batch_flush(). The batch is flushed automatically when
+ * full. Storage belongs to the caller, who serializes its use.
+ */
+struct pob_ntf_batch {
+	int nr;
+	int max;
+	struct pob_ntf_rec *rec;
+};
+
+#define DEFINE_POB_NTF_BATCH(name, n)				\
+	struct pob_ntf_rec name##_rec[n];			\
+	struct pob_ntf_batch name = { .max = n, .rec = name##_rec }
+
+/* delivery latency, publish to last subscriber returned */
+struct pob_ntf_stat {
+	u64 events;
+	u64 lat_sum;
+	u64 lat_max;
+	u64 hist[POB_NTF_HIST_NR];	/* log2(us) buckets */
+};
+
+#ifdef CONFIG_MTK_PERF_OBSERVER
+extern int pob_ntf_batch_add(struct pob_ntf_batch *batch,
+			enum pob_ntf_type type, unsigned long val,
+			const void *v, size_t size);
+extern void pob_ntf_batch_flush(struct pob_ntf_batch *batch);
+extern void pob_ntf_get_stat(enum pob_ntf_type type,
+			struct pob_ntf_stat *sum);
+extern void pob_ntf_reset_stat(void);
+#else
+static inline int pob_ntf_batch_add(struct pob_ntf_batch *batch,
+			enum pob_ntf_type type, unsigned long val,
+			const void *v, size_t size)
+{ return 0; }
+static inline void pob_ntf_batch_flush(struct pob_ntf_batch *batch) { }
+static inline void pob_ntf_get_stat(enum pob_ntf_type type,
+			struct pob_ntf_stat *sum) { }
+static inline void pob_ntf_reset_stat(void) { }
+#endif
 
 enum pob_dqd_info_num {
 	POB_BQD_QUEUE,
@@ -62,6 +128,7 @@ enum pob_fpsgo_info_num {
 	POB_FPSGO_QTSK_CPUCAP_UPDATE,
 	POB_FPSGO_QTSK_GPUCAP_UPDATE,
 	POB_FPSGO_QTSK_APUCAP_UPDATE,
+	POB_FPSGO_FRAME_START,
 };
 
 struct pob_fpsgo_fpsstats_info {
@@ -85,6 +152,11 @@ struct pob_fpsgo_qtsk_info {
 	unsigned int max_apu_cap;
 };
 
+struct pob_fpsgo_frame_info {
+	int tskid;
+	unsigned long long ts;
+};
+
 #ifdef CONFIG_MTK_PERF_OBSERVER
 extern int pob_fpsgo_register_client(struct notifier_block *nb);
 extern int pob_fpsgo_unregister_client(struct notifier_block *nb);
@@ -93,6 +165,8 @@ extern int pob_fpsgo_fstb_stats_update(unsigned long infonum,
 			struct pob_fpsgo_fpsstats_info *info);
 extern int pob_fpsgo_qtsk_update(unsigned long infonum,
 			struct pob_fpsgo_qtsk_info *info);
+extern int pob_fpsgo_frame_update(unsigned long infonum,
+			struct pob_fpsgo_frame_info *info);
 #else
 static inline int pob_fpsgo_register_client(struct notifier_block *nb)
 { return 0; }
@@ -104,6 +178,9 @@ static inline int pob_fpsgo_fstb_stats_update(unsigned long infonum,
 static inline int pob_fpsgo_qtsk_update(unsigned long infonum,
 			struct pob_fpsgo_qtsk_info *info)
 { return 0; }
+static inline int pob_fpsgo_frame_update(unsigned long infonum,
+			struct pob_fpsgo_frame_info *info)
+{ return 0; }
 #endif
 
 struct pob_rs_quaweitime_info {
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __MTK_RAM_RECORD_H__
+#define __MTK_RAM_RECORD_H__
+
+#include <linux/compiler.h>
+#include <linux/types.h>
+
+/* text records are cut to this */
+#define RAM_RECORD_TEXT_MAX	256
+
+enum RAM_RECORD_TYPE {
+	RAM_RECORD_PRINTK = 1,	/* arg: log level, data: text */
+	RAM_RECORD_BOOT,	/* arg: 0, data: text */
+	RAM_RECORD_INITCALL,	/* data: function address */
+	RAM_RECORD_DPM,		/* arg: 1 if async, data: callback address */
+	RAM_RECORD_HOTPLUG,	/* arg: cpu, data: footprint */
+	RAM_RECORD_SUSPEND,	/* data: spm suspend value */
+	RAM_RECORD_TYPE_NR,
+};
+
+#ifdef CONFIG_MTK_RAM_RECORD
+extern void ram_record_write(u16 type, u16 arg, u64 ts_ns,
+			     const void *data, u16 len);
+extern void ram_record_value(u16 type, u16 arg, u64 val);
+extern __printf(2, 3)
+void ram_record_text(u16 type, const char *fmt, ...);
+#else
+static inline void ram_record_write(u16 type, u16 arg, u64 ts_ns,
+				    const void *data, u16 len)
+{
+}
+
+static inline void ram_record_value(u16 type, u16 arg, u64 val)
+{
+}
+
+static inline __printf(2, 3)
+void ram_record_text(u16 type, const char *fmt, ...)
+{
+}
+#endif
+
+#endif
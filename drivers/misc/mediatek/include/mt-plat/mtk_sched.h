@@ -36,6 +36,24 @@ extern unsigned int
 sched_get_nr_heavy_task_by_threshold(unsigned int threshold);
 #endif /* CONFIG_MTK_SCHED_RQAVG_US */
 
+#ifdef CONFIG_MTK_SCHED_RQAVG_KS
+/*
+ * @hl_ms: half-life of the average in ms (about 4, 16, 64 or 256)
+ * @avg: decayed nr_running of all cpus x 100
+ * @iowait_avg: decayed nr_iowait of all cpus x 100
+ * lockless, and unlike sched_get_nr_running_avg() it resets nothing
+ */
+extern void sched_get_nr_running_avg_decayed(unsigned int hl_ms,
+		int *avg, int *iowait_avg);
+
+/*
+ * @fn: called when a cpu goes idle <-> busy, with its rq lock held, so it
+ *      must only queue irq_work; NULL to remove it
+ * removing waits until no cpu is still in the old one
+ */
+extern void sched_set_lt_kick(void (*fn)(int cpu, u64 now));
+#endif /* CONFIG_MTK_SCHED_RQAVG_KS */
+
 #ifdef CONFIG_MTK_SCHED_CPULOAD
 extern unsigned int sched_get_cpu_load(int cpu);
 #endif
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _MTK_THERMAL_HEADROOM_H
+#define _MTK_THERMAL_HEADROOM_H
+
+#include <linux/errno.h>
+#include <linux/types.h>
+
+/*
+ * Thermal headroom
+ *
+ * The hottest zone is taken as one thermal resistance r to an ambient
+ * and one heat capacity c, so at constant power p it settles at
+ * ambient + p x r with time constant tau = r x c. From that the budget
+ * is what p can be held forever under the limit, and how much heat and
+ * how long at the current power are left before the limit is reached.
+ * Past the limit the heat left goes negative, by what has to be shed.
+ *
+ * Temperatures are in m°C, power in mW, r in m°C per W, heat in mJ.
+ */
+
+#define THERMAL_HR_FOREVER	(~0U)
+
+struct thermal_rc {
+	unsigned int r;		/* m°C per W */
+	unsigned int tau_ms;	/* r x c */
+	int ambient;
+};
+
+struct mtk_thermal_headroom {
+	int temp;
+	int limit;
+	int ambient;		/* as observed, includes unmodelled power */
+	unsigned int power;	/* drawn at the last sample */
+	unsigned int sustain;	/* power that settles at limit */
+	int burst_mj;		/* heat left, < 0 past limit */
+	unsigned int burst_ms;	/* time to limit at power */
+	unsigned long long ts;	/* ns */
+};
+
+/* model with an ambient observer, fed by the adaptive thermal manager */
+struct thermal_hr {
+	struct thermal_rc rc;
+	unsigned int obs_ms;	/* time constant of the observer */
+	unsigned int guard;	/* kept below the cooler's limit */
+	int win_temp;
+	unsigned long long win_ts;
+	unsigned long long win_energy;	/* mW x ms */
+	unsigned long long last_ts;
+	unsigned int last_power;
+	struct mtk_thermal_headroom now;
+};
+
+extern int thermal_rc_steady(const struct thermal_rc *rc, unsigned int power);
+extern unsigned int thermal_rc_sustain(const struct thermal_rc *rc, int limit);
+extern unsigned int thermal_rc_time_to(const struct thermal_rc *rc, int temp,
+	int limit, unsigned int power);
+extern int thermal_rc_step(const struct thermal_rc *rc, int temp,
+	unsigned int power, unsigned int dt_ms);
+
+extern void thermal_hr_init(struct thermal_hr *h, unsigned int r,
+	unsigned int tau_ms, int ambient, unsigned int obs_ms);
+extern void thermal_hr_update(struct thermal_hr *h, int temp, int limit,
+	unsigned int power, unsigned long long ts);
+
+#if defined(CONFIG_THERMAL)
+extern void mtk_thermal_headroom_update(int temp, int limit,
+	unsigned int power);
+extern int mtk_thermal_get_headroom(struct mtk_thermal_headroom *hr);
+#else
+static inline void mtk_thermal_headroom_update(int temp, int limit,
+	unsigned int power) { }
+static inline int mtk_thermal_get_headroom(struct mtk_thermal_headroom *hr)
+{
+	return -ENODEV;
+}
+#endif
+
+#endif	/* _MTK_THERMAL_HEADROOM_H */
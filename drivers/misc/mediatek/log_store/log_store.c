@@ -27,6 +27,8 @@
 #include <linux/syscalls.h>
 #include <asm/memory.h>
 
+#include <mt-plat/mtk_ram_record.h>
+
 #include "log_store_kernel.h"
 
 static struct sram_log_header *sram_header;
@@ -69,6 +71,7 @@ void log_store_bootup(void)
 {
 	/* Boot up finish, don't save log to emmc in next boot.*/
 	store_log_to_emmc_enable(false);
+	ram_record_text(RAM_RECORD_BOOT, "bootup done");
 }
 
 int set_emmc_config(int type, int value)
@@ -267,6 +270,10 @@ static int __init log_store_late_init(void)
 		dram_curlog_header->off_lk, dram_curlog_header->sz_lk,
 		dram_curlog_header->pl_flag, dram_curlog_header->lk_flag);
 
+	ram_record_text(RAM_RECORD_BOOT, "pl %u bytes flag 0x%x, lk %u bytes flag 0x%x",
+		dram_curlog_header->sz_pl, dram_curlog_header->pl_flag,
+		dram_curlog_header->sz_lk, dram_curlog_header->lk_flag);
+
 	entry = proc_create("pl_lk", 0444, NULL, &pl_lk_file_ops);
 	if (!entry) {
 		pr_notice("log_store: failed to create proc entry\n");
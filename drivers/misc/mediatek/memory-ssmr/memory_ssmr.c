@@ -647,7 +647,7 @@ static int memory_region_offline(struct SSMR_Region *region,
 
 		if (end > upper_limit) {
 			pr_err("Reserve Over Limit, region end: %pa\n", &end);
-			cma_release(cma, page, alloc_pages);
+			zmc_cma_release(cma, page, alloc_pages);
 			page = NULL;
 		}
 	}
@@ -1125,6 +1125,50 @@ int ssmr_online(unsigned int feat)
 }
 EXPORT_SYMBOL(ssmr_online);
 
+static void ssmr_notify_zmc(unsigned long event, unsigned int feat)
+{
+	struct zmc_predict pred = {
+		.cma = cma,
+		.count = _ssmr_feats[feat].req_size / PAGE_SIZE,
+		.align = SSMR_CMA_ALIGN_PAGE_ORDER,
+		.prio = saved_memory_ssmr_registration.prio,
+	};
+
+	zmc_notifier_call_chain(event, &pred);
+}
+
+/*
+ * The feature is about to be offlined, let ZMC start migrating
+ * the region out of the way in the background.
+ */
+int ssmr_predict(unsigned int feat)
+{
+	struct SSMR_Region *region;
+
+	if (!is_valid_feature(feat))
+		return -EINVAL;
+
+	region = &_ssmregs[_ssmr_feats[feat].region];
+
+	/* nothing to migrate for dedicated or already offline memory */
+	if (region->state != SSMR_STATE_ON || region->use_cache_memory)
+		return 0;
+
+	ssmr_notify_zmc(ZMC_EVENT_PREDICT_MOVABLE, feat);
+	return 0;
+}
+EXPORT_SYMBOL(ssmr_predict);
+
+int ssmr_predict_cancel(unsigned int feat)
+{
+	if (!is_valid_feature(feat))
+		return -EINVAL;
+
+	ssmr_notify_zmc(ZMC_EVENT_CANCEL_MOVABLE, feat);
+	return 0;
+}
+EXPORT_SYMBOL(ssmr_predict_cancel);
+
 #ifdef CONFIG_MTK_SEC_VIDEO_PATH_SUPPORT
 static long svp_cma_ioctl(struct file *filp, unsigned int cmd,
 				 unsigned long arg)
@@ -1135,13 +1179,17 @@ static long svp_cma_ioctl(struct file *filp, unsigned int cmd,
 
 	switch (cmd) {
 	case SVP_REGION_ACQUIRE:
-		atomic_inc(&svp_ref_count);
+		/* playback is starting, the svp offline follows shortly */
+		if (atomic_inc_return(&svp_ref_count) == 1)
+			ssmr_predict(SSMR_FEAT_SVP);
 		break;
 	case SVP_REGION_RELEASE:
 		atomic_dec(&svp_ref_count);
 
-		if (atomic_read(&svp_ref_count) == 0)
+		if (atomic_read(&svp_ref_count) == 0) {
+			ssmr_predict_cancel(SSMR_FEAT_SVP);
 			svp_start_wdt();
+		}
 		break;
 	default:
 		return -ENOTTY;
@@ -50,6 +50,8 @@ enum ssmr_feature_type {
 extern int ssmr_offline(phys_addr_t *pa, unsigned long *size, bool is_64bit,
 		unsigned int feat);
 extern int ssmr_online(unsigned int feat);
+extern int ssmr_predict(unsigned int feat);
+extern int ssmr_predict_cancel(unsigned int feat);
 
 
 #endif
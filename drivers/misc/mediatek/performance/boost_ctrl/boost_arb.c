@@ -0,0 +1,391 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#define pr_fmt(fmt) "[boost_arb]"fmt
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#include "boost_arb.h"
+
+static bool boost_arb_row_unset(struct boost_arb *arb, int kicker)
+{
+	struct boost_arb_val *row = boost_arb_req(arb, kicker);
+	int i;
+
+	for (i = 0; i < arb->nr_item; i++)
+		if (row[i].min != arb->unset.min ||
+				row[i].max != arb->unset.max)
+			return false;
+
+	return true;
+}
+
+static void boost_arb_hist_add(struct boost_arb *arb, int kicker, u64 now,
+		unsigned int timeout_ms, bool expired)
+{
+	struct boost_arb_hist *h;
+	unsigned int idx;
+
+	idx = arb->hist_head[kicker]++ % BOOST_ARB_HIST_NR;
+	h = &arb->hist[kicker * BOOST_ARB_HIST_NR + idx];
+
+	memset(h, 0, sizeof(*h));
+	h->ts = now;
+	h->timeout_ms = timeout_ms;
+	h->expired = expired;
+	memcpy(h->req, boost_arb_req(arb, kicker),
+		arb->nr_item * sizeof(struct boost_arb_val));
+}
+
+/* fill in the outcome of the requests covered by this apply */
+static void boost_arb_hist_done(struct boost_arb *arb, u64 now)
+{
+	struct boost_arb_hist *h;
+	int i, n = arb->nr_kicker * BOOST_ARB_HIST_NR;
+
+	for (i = 0; i < n; i++) {
+		h = &arb->hist[i];
+		if (!h->ts || h->apply_ts)
+			continue;
+		h->apply_ts = now;
+		memcpy(h->eff, arb->cur,
+			arb->nr_item * sizeof(struct boost_arb_val));
+	}
+}
+
+static void __boost_arb_merge(struct boost_arb *arb, u64 now)
+{
+	arb->ops->merge(arb, arb->cur);
+	arb->dirty = memcmp(arb->cur, arb->applied,
+			arb->nr_item * sizeof(struct boost_arb_val)) != 0;
+
+	/* nothing to push, the request is effective right away */
+	if (!arb->dirty)
+		boost_arb_hist_done(arb, now);
+}
+
+/* next apply point or request deadline, whichever comes first */
+static void __boost_arb_arm(struct boost_arb *arb, u64 now)
+{
+	u64 next = U64_MAX;
+	int i;
+
+	if (arb->dirty)
+		next = max(arb->last_apply + (u64)arb->window_us * NSEC_PER_USEC,
+				now);
+
+	for (i = 0; i < arb->nr_kicker; i++)
+		if (arb->deadline[i] && arb->deadline[i] < next)
+			next = arb->deadline[i];
+
+	if (next == U64_MAX)
+		hrtimer_try_to_cancel(&arb->timer);
+	else
+		hrtimer_start(&arb->timer, ns_to_ktime(next),
+				HRTIMER_MODE_ABS);
+}
+
+/* force: push the result even if unchanged and have every item written */
+static void boost_arb_apply(struct boost_arb *arb, bool force)
+{
+	struct boost_arb_val out[BOOST_ARB_MAX_ITEM];
+	struct boost_arb_val prev[BOOST_ARB_MAX_ITEM];
+	u64 now;
+
+	mutex_lock(&arb->apply_lock);
+	mutex_lock(&arb->lock);
+
+	if (!arb->dirty && !force) {
+		mutex_unlock(&arb->lock);
+		mutex_unlock(&arb->apply_lock);
+		return;
+	}
+
+	now = ktime_get_ns();
+	memcpy(prev, arb->applied, sizeof(prev));
+	memcpy(out, arb->cur, sizeof(out));
+	memcpy(arb->applied, arb->cur, sizeof(arb->applied));
+	arb->dirty = false;
+	arb->last_apply = now;
+	arb->nr_apply++;
+	boost_arb_hist_done(arb, now);
+	__boost_arb_arm(arb, now);
+
+	mutex_unlock(&arb->lock);
+
+	arb->ops->apply(arb, out, force ? NULL : prev);
+
+	mutex_unlock(&arb->apply_lock);
+}
+
+static void boost_arb_work(struct work_struct *work)
+{
+	struct boost_arb *arb = container_of(work, struct boost_arb, work);
+	struct boost_arb_val *row;
+	bool sync;
+	u64 now;
+	int i, j;
+
+	mutex_lock(&arb->lock);
+
+	now = ktime_get_ns();
+	for (i = 0; i < arb->nr_kicker; i++) {
+		if (!arb->deadline[i] || arb->deadline[i] > now)
+			continue;
+
+		row = boost_arb_req(arb, i);
+		for (j = 0; j < arb->nr_item; j++)
+			row[j] = arb->unset;
+		arb->deadline[i] = 0;
+		arb->nr_expire++;
+		boost_arb_hist_add(arb, i, now, 0, true);
+	}
+
+	__boost_arb_merge(arb, now);
+
+	/* expiry does not bypass the window either */
+	sync = arb->dirty &&
+		now - arb->last_apply >= (u64)arb->window_us * NSEC_PER_USEC;
+	if (!sync)
+		__boost_arb_arm(arb, now);
+
+	mutex_unlock(&arb->lock);
+
+	if (sync)
+		boost_arb_apply(arb, false);
+}
+
+static enum hrtimer_restart boost_arb_timer_fn(struct hrtimer *timer)
+{
+	struct boost_arb *arb = container_of(timer, struct boost_arb, timer);
+
+	queue_work(system_highpri_wq, &arb->work);
+
+	return HRTIMER_NORESTART;
+}
+
+static int __boost_arb_update(struct boost_arb *arb, int kicker, int item,
+		const struct boost_arb_val *req, unsigned int timeout_ms)
+{
+	struct boost_arb_val *row;
+	bool sync;
+	u64 now;
+
+	if (kicker < 0 || kicker >= arb->nr_kicker)
+		return -EINVAL;
+	if (item >= arb->nr_item)
+		return -EINVAL;
+
+	mutex_lock(&arb->lock);
+
+	now = ktime_get_ns();
+	row = boost_arb_req(arb, kicker);
+	if (item < 0)
+		memcpy(row, req, arb->nr_item * sizeof(*row));
+	else
+		row[item] = *req;
+
+	/* a request without timeout cancels the previous one */
+	if (timeout_ms && !boost_arb_row_unset(arb, kicker))
+		arb->deadline[kicker] = now + (u64)timeout_ms * NSEC_PER_MSEC;
+	else
+		arb->deadline[kicker] = 0;
+
+	arb->nr_request++;
+	boost_arb_hist_add(arb, kicker, now, timeout_ms, false);
+	__boost_arb_merge(arb, now);
+
+	sync = arb->dirty && (!arb->window_us ||
+		now - arb->last_apply >= (u64)arb->window_us * NSEC_PER_USEC);
+	if (!sync)
+		__boost_arb_arm(arb, now);
+
+	mutex_unlock(&arb->lock);
+
+	if (sync)
+		boost_arb_apply(arb, false);
+
+	return 0;
+}
+
+/**
+ * boost_arb_update - replace the whole request of a kicker
+ * @req:	nr_item values, 'unset' values drop the request
+ * @timeout_ms:	reset the request after this time, 0 for none
+ */
+int boost_arb_update(struct boost_arb *arb, int kicker,
+		const struct boost_arb_val *req, unsigned int timeout_ms)
+{
+	return __boost_arb_update(arb, kicker, -1, req, timeout_ms);
+}
+EXPORT_SYMBOL(boost_arb_update);
+
+/**
+ * boost_arb_update_item - change one item of a kicker's request
+ *
+ * The timeout covers the whole request of the kicker.
+ */
+int boost_arb_update_item(struct boost_arb *arb, int kicker, int item,
+		struct boost_arb_val val, unsigned int timeout_ms)
+{
+	if (item < 0)
+		return -EINVAL;
+
+	return __boost_arb_update(arb, kicker, item, &val, timeout_ms);
+}
+EXPORT_SYMBOL(boost_arb_update_item);
+
+/* merged result of the current requests, maybe not applied yet */
+void boost_arb_get(struct boost_arb *arb, struct boost_arb_val *out)
+{
+	mutex_lock(&arb->lock);
+	memcpy(out, arb->cur, arb->nr_item * sizeof(*out));
+	mutex_unlock(&arb->lock);
+}
+EXPORT_SYMBOL(boost_arb_get);
+
+/* apply a pending result now instead of at the end of the window */
+void boost_arb_flush(struct boost_arb *arb)
+{
+	boost_arb_apply(arb, false);
+}
+EXPORT_SYMBOL(boost_arb_flush);
+
+/*
+ * Write the current result to every item again, e.g. once a debug
+ * override that made ops->apply() skip items is dropped.
+ */
+void boost_arb_reapply(struct boost_arb *arb)
+{
+	boost_arb_apply(arb, true);
+}
+EXPORT_SYMBOL(boost_arb_reapply);
+
+void boost_arb_show(struct boost_arb *arb, struct seq_file *m)
+{
+	struct boost_arb_hist *h;
+	u64 now = ktime_get_ns();
+	int i, j, k;
+
+	mutex_lock(&arb->lock);
+
+	seq_printf(m, "%s window_us %u requests %llu applies %llu expired %llu\n",
+		arb->name, arb->window_us, arb->nr_request, arb->nr_apply,
+		arb->nr_expire);
+
+	seq_puts(m, "current");
+	for (j = 0; j < arb->nr_item; j++)
+		seq_printf(m, " (%d)(%d)", arb->cur[j].min, arb->cur[j].max);
+	seq_printf(m, "%s\n", arb->dirty ? " pending" : "");
+
+	for (i = 0; i < arb->nr_kicker; i++) {
+		if (!arb->hist_head[i])
+			continue;
+
+		seq_printf(m, "kicker %d", i);
+		if (arb->deadline[i])
+			seq_printf(m, " expires in %llu ms",
+				arb->deadline[i] > now ?
+				div_u64(arb->deadline[i] - now,
+					NSEC_PER_MSEC) : 0);
+		seq_puts(m, "\n");
+
+		/* oldest first */
+		for (k = 0; k < BOOST_ARB_HIST_NR; k++) {
+			h = &arb->hist[i * BOOST_ARB_HIST_NR +
+				(arb->hist_head[i] + k) % BOOST_ARB_HIST_NR];
+			if (!h->ts)
+				continue;
+
+			seq_printf(m, "  -%llums %s", div_u64(now - h->ts,
+				NSEC_PER_MSEC), h->expired ? "expired" : "req");
+			for (j = 0; j < arb->nr_item; j++)
+				seq_printf(m, " (%d)(%d)",
+					h->req[j].min, h->req[j].max);
+			if (h->timeout_ms)
+				seq_printf(m, " timeout %ums", h->timeout_ms);
+
+			if (!h->apply_ts) {
+				seq_puts(m, " => pending\n");
+				continue;
+			}
+
+			seq_printf(m, " => +%lluus", div_u64(h->apply_ts -
+				h->ts, NSEC_PER_USEC));
+			for (j = 0; j < arb->nr_item; j++)
+				seq_printf(m, " {%d}{%d}",
+					h->eff[j].min, h->eff[j].max);
+			seq_puts(m, "\n");
+		}
+	}
+
+	mutex_unlock(&arb->lock);
+}
+EXPORT_SYMBOL(boost_arb_show);
+
+int boost_arb_init(struct boost_arb *arb)
+{
+	int i;
+
+	if (arb->nr_item <= 0 || arb->nr_item > BOOST_ARB_MAX_ITEM ||
+			arb->nr_kicker <= 0 || !arb->ops)
+		return -EINVAL;
+
+	mutex_init(&arb->lock);
+	mutex_init(&arb->apply_lock);
+	hrtimer_init(&arb->timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	arb->timer.function = boost_arb_timer_fn;
+	INIT_WORK(&arb->work, boost_arb_work);
+
+	arb->req = kcalloc(arb->nr_kicker * arb->nr_item,
+			sizeof(*arb->req), GFP_KERNEL);
+	arb->deadline = kcalloc(arb->nr_kicker, sizeof(*arb->deadline),
+			GFP_KERNEL);
+	arb->hist = kcalloc(arb->nr_kicker * BOOST_ARB_HIST_NR,
+			sizeof(*arb->hist), GFP_KERNEL);
+	arb->hist_head = kcalloc(arb->nr_kicker, sizeof(*arb->hist_head),
+			GFP_KERNEL);
+	if (!arb->req || !arb->deadline || !arb->hist || !arb->hist_head) {
+		boost_arb_exit(arb);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < arb->nr_kicker * arb->nr_item; i++)
+		arb->req[i] = arb->unset;
+	for (i = 0; i < BOOST_ARB_MAX_ITEM; i++) {
+		arb->cur[i] = arb->unset;
+		arb->applied[i] = arb->unset;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(boost_arb_init);
+
+void boost_arb_exit(struct boost_arb *arb)
+{
+	hrtimer_cancel(&arb->timer);
+	cancel_work_sync(&arb->work);
+
+	kfree(arb->req);
+	kfree(arb->deadline);
+	kfree(arb->hist);
+	kfree(arb->hist_head);
+	arb->req = NULL;
+	arb->deadline = NULL;
+	arb->hist = NULL;
+	arb->hist_head = NULL;
+}
+EXPORT_SYMBOL(boost_arb_exit);
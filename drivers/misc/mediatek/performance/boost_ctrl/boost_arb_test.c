@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Boost arbiter kicker storm test
+ *
+ * Runs one kthread per kicker issuing random min/max requests, part of
+ * them with timeouts, against an arbiter whose apply callback is a
+ * dummy cpufreq policy. Checks that the policy is updated at most once
+ * per window, that the final policy matches the merged requests and
+ * that timed requests expire without help from the kicker.
+ */
+#include <linux/atomic.h>
+#include <linux/delay.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+
+#include "boost_arb.h"
+
+#define TAG "[ARB_TEST]"
+#define ARB_TEST_CLUSTERS	3
+#define ARB_TEST_KICKERS	8
+
+static unsigned int run_ms = 1000;
+module_param(run_ms, uint, 0444);
+MODULE_PARM_DESC(run_ms, "Duration of the storm");
+
+static unsigned int window_us = BOOST_ARB_WINDOW_US;
+module_param(window_us, uint, 0444);
+MODULE_PARM_DESC(window_us, "Coalescing window");
+
+/* dummy cpufreq policy */
+static struct {
+	struct boost_arb_val limit[ARB_TEST_CLUSTERS];
+	u64 nr_update;
+	u64 last_ns;
+	u64 min_gap_ns;
+} arb_test_policy;
+
+static void arb_test_merge(struct boost_arb *arb, struct boost_arb_val *out)
+{
+	struct boost_arb_val *req;
+	int i, j;
+
+	for (j = 0; j < ARB_TEST_CLUSTERS; j++)
+		out[j] = arb->unset;
+
+	for (i = 0; i < ARB_TEST_KICKERS; i++) {
+		req = boost_arb_req(arb, i);
+		for (j = 0; j < ARB_TEST_CLUSTERS; j++) {
+			out[j].min = max(req[j].min, out[j].min);
+			out[j].max = max(req[j].max, out[j].max);
+			if (out[j].min > out[j].max && out[j].max != -1)
+				out[j].max = out[j].min;
+		}
+	}
+}
+
+static void arb_test_apply(struct boost_arb *arb,
+		const struct boost_arb_val *out,
+		const struct boost_arb_val *prev)
+{
+	/* time of the apply decision, not of this callback */
+	u64 now = arb->last_apply;
+
+	if (arb_test_policy.nr_update &&
+	    now - arb_test_policy.last_ns < arb_test_policy.min_gap_ns)
+		arb_test_policy.min_gap_ns = now - arb_test_policy.last_ns;
+	arb_test_policy.last_ns = now;
+	arb_test_policy.nr_update++;
+	memcpy(arb_test_policy.limit, out, sizeof(arb_test_policy.limit));
+
+	/* a policy update is not free */
+	usleep_range(50, 100);
+}
+
+static const struct boost_arb_ops arb_test_ops = {
+	.merge = arb_test_merge,
+	.apply = arb_test_apply,
+};
+
+static struct boost_arb arb_test = {
+	.name = "arb_test",
+	.nr_kicker = ARB_TEST_KICKERS,
+	.nr_item = ARB_TEST_CLUSTERS,
+	.unset = { -1, -1 },
+	.ops = &arb_test_ops,
+};
+
+static atomic64_t arb_test_nr_req;
+
+static int arb_test_kicker_fn(void *data)
+{
+	struct boost_arb_val req[ARB_TEST_CLUSTERS];
+	int kicker = (long)data;
+	unsigned int timeout;
+	u32 r;
+	int j;
+
+	while (!kthread_should_stop()) {
+		for (j = 0; j < ARB_TEST_CLUSTERS; j++) {
+			r = prandom_u32();
+			req[j].min = r & 1 ? -1 : (int)(r % 2000000);
+			req[j].max = r & 2 ? -1 : (int)((r >> 8) % 2500000);
+		}
+
+		/* odd kickers use timeouts instead of releasing */
+		timeout = kicker & 1 ? 1 + prandom_u32() % 20 : 0;
+		boost_arb_update(&arb_test, kicker, req, timeout);
+		atomic64_inc(&arb_test_nr_req);
+
+		/* bursts of requests, then a short pause */
+		if (!(prandom_u32() % 16))
+			usleep_range(100, 2000);
+		else
+			cond_resched();
+	}
+
+	return 0;
+}
+
+static int arb_test_check(const char *what)
+{
+	struct boost_arb_val expect[ARB_TEST_CLUSTERS];
+	int j;
+
+	boost_arb_get(&arb_test, expect);
+	for (j = 0; j < ARB_TEST_CLUSTERS; j++) {
+		if (expect[j].min == arb_test_policy.limit[j].min &&
+		    expect[j].max == arb_test_policy.limit[j].max)
+			continue;
+
+		pr_info(TAG"FAIL: %s cluster %d policy (%d)(%d) expect (%d)(%d)\n",
+			what, j, arb_test_policy.limit[j].min,
+			arb_test_policy.limit[j].max,
+			expect[j].min, expect[j].max);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int __init arb_test_init(void)
+{
+	struct task_struct *tsk[ARB_TEST_KICKERS];
+	struct boost_arb_val req[ARB_TEST_CLUSTERS];
+	u64 nr_req, nr_update;
+	long i;
+	int j, ret;
+
+	arb_test.window_us = window_us;
+	arb_test_policy.min_gap_ns = U64_MAX;
+	ret = boost_arb_init(&arb_test);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < ARB_TEST_KICKERS; i++) {
+		tsk[i] = kthread_run(arb_test_kicker_fn, (void *)i,
+				"arb_test/%ld", i);
+		if (IS_ERR(tsk[i]))
+			tsk[i] = NULL;
+	}
+
+	msleep(run_ms);
+
+	for (i = 0; i < ARB_TEST_KICKERS; i++)
+		if (tsk[i])
+			kthread_stop(tsk[i]);
+
+	nr_req = atomic64_read(&arb_test_nr_req);
+	nr_update = arb_test_policy.nr_update;
+	pr_info(TAG"requests %llu policy updates %llu expired %llu min gap %llu us\n",
+		nr_req, nr_update, arb_test.nr_expire,
+		nr_update > 1 ? div_u64(arb_test_policy.min_gap_ns,
+			NSEC_PER_USEC) : 0);
+
+	if (nr_update > 1 &&
+	    arb_test_policy.min_gap_ns < (u64)window_us * NSEC_PER_USEC) {
+		pr_info(TAG"FAIL: policy updated twice within the window\n");
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* the last window of the storm lands without any new request */
+	msleep(window_us / USEC_PER_MSEC + 25);
+	ret = arb_test_check("storm");
+	if (ret)
+		goto out;
+
+	/* timed request of kicker 1 falls back to the others */
+	for (i = 0; i < ARB_TEST_KICKERS; i++) {
+		for (j = 0; j < ARB_TEST_CLUSTERS; j++) {
+			req[j].min = i == 1 ? 3000000 : 1000000;
+			req[j].max = -1;
+		}
+		boost_arb_update(&arb_test, i, req, i == 1 ? 10 : 0);
+	}
+	msleep(window_us / USEC_PER_MSEC + 2);
+	boost_arb_flush(&arb_test);
+	if (arb_test_policy.limit[0].min != 3000000) {
+		pr_info(TAG"FAIL: timed request not applied\n");
+		ret = -EINVAL;
+		goto out;
+	}
+
+	msleep(10 + window_us / USEC_PER_MSEC + 25);
+	if (arb_test_policy.limit[0].min != 1000000) {
+		pr_info(TAG"FAIL: timed request did not expire\n");
+		ret = -EINVAL;
+		goto out;
+	}
+	ret = arb_test_check("expiry");
+
+out:
+	boost_arb_exit(&arb_test);
+
+	if (!ret)
+		pr_info(TAG"PASS\n");
+
+	return ret;
+}
+
+static void __exit arb_test_exit(void)
+{
+}
+
+module_init(arb_test_init);
+module_exit(arb_test_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Boost arbiter kicker storm test");
@@ -23,6 +23,7 @@
 #include <linux/uaccess.h>
 
 #include "cpu_ctrl.h"
+#include "boost_arb.h"
 #include "boost_ctrl.h"
 #include "mtk_perfmgr_internal.h"
 
@@ -35,9 +36,8 @@
 #include <linux/trace_events.h>
 #endif
 
-static struct mutex boost_freq;
 static struct ppm_limit_data *current_freq;
-static struct ppm_limit_data *freq_set[CPU_MAX_KIR];
+static struct ppm_limit_data *final_freq;
 static int log_enable;
 static unsigned long *policy_mask;
 
@@ -48,107 +48,139 @@ static int cfp_init_ret;
 int powerhal_tid;
 
 /*******************************************/
-int update_userlimit_cpu_freq(int kicker, int num_cluster
-		, struct ppm_limit_data *freq_limit)
+static void cpu_freq_arb_merge(struct boost_arb *arb,
+		struct boost_arb_val *out)
 {
-	struct ppm_limit_data *final_freq;
-	int retval = 0;
-	int i, j, len = 0, len1 = 0;
-	char msg[LOG_BUF_SIZE];
-	char msg1[LOG_BUF_SIZE];
+	struct boost_arb_val *req;
+	int i, j;
 
+	for_each_perfmgr_clusters(j) {
+		out[j].min = -1;
+		out[j].max = -1;
+		policy_mask[j] = 0;
+	}
 
-	mutex_lock(&boost_freq);
+	for (i = 0; i < CPU_MAX_KIR; i++) {
+		req = boost_arb_req(arb, i);
+		for_each_perfmgr_clusters(j) {
+			if (req[j].min != -1 || req[j].max != -1)
+				set_bit(i, &policy_mask[j]);
 
-	final_freq = kcalloc(perfmgr_clusters
-			, sizeof(struct ppm_limit_data), GFP_KERNEL);
-	if (!final_freq) {
-		retval = -1;
-		perfmgr_trace_printk("cpu_ctrl", "!final_freq\n");
-		goto ret_update;
+			out[j].min = MAX(req[j].min, out[j].min);
+#ifdef CONFIG_MTK_CPU_CTRL_CFP
+			out[j].max = out[j].max != -1 && req[j].max != -1 ?
+				MIN(req[j].max, out[j].max) :
+				MAX(req[j].max, out[j].max);
+#else
+			out[j].max = MAX(req[j].max, out[j].max);
+#endif
+			if (out[j].min > out[j].max && out[j].max != -1)
+				out[j].max = out[j].min;
+		}
+	}
+
+	for_each_perfmgr_clusters(j) {
+		current_freq[j].min = out[j].min;
+		current_freq[j].max = out[j].max;
 	}
+}
+
+/* serialized by the arbiter, one policy update per window */
+static void cpu_freq_arb_apply(struct boost_arb *arb,
+		const struct boost_arb_val *out,
+		const struct boost_arb_val *prev)
+{
+	int i;
+
+	for_each_perfmgr_clusters(i) {
+		final_freq[i].min = out[i].min;
+		final_freq[i].max = out[i].max;
+	}
+
+#ifdef CONFIG_MTK_CPU_CTRL_CFP
+	if (!cfp_init_ret)
+		cpu_ctrl_cfp(final_freq);
+	else
+		mt_ppm_userlimit_cpu_freq(perfmgr_clusters, final_freq);
+#else
+	mt_ppm_userlimit_cpu_freq(perfmgr_clusters, final_freq);
+#endif
+}
+
+static const struct boost_arb_ops cpu_freq_arb_ops = {
+	.merge = cpu_freq_arb_merge,
+	.apply = cpu_freq_arb_apply,
+};
+
+static struct boost_arb cpu_freq_arb = {
+	.name = "cpu_freq",
+	.nr_kicker = CPU_MAX_KIR,
+	.unset = { -1, -1 },
+	.ops = &cpu_freq_arb_ops,
+	.window_us = BOOST_ARB_WINDOW_US,
+};
+
+/*
+ * Requests of all kickers are merged right away, the merged limit is
+ * pushed to ppm at most once per arb_window_us. With timeout_ms the
+ * request of this kicker is dropped after timeout_ms.
+ */
+int update_userlimit_cpu_freq_timeout(int kicker, int num_cluster
+		, struct ppm_limit_data *freq_limit, unsigned int timeout_ms)
+{
+	struct boost_arb_val req[BOOST_ARB_MAX_ITEM];
+	struct boost_arb_val final[BOOST_ARB_MAX_ITEM];
+	unsigned long mask[BOOST_ARB_MAX_ITEM];
+	int retval;
+	int i, len = 0, len1 = 0;
+	char msg[LOG_BUF_SIZE];
+	char msg1[LOG_BUF_SIZE];
+
+	if (kicker < 0 || kicker >= CPU_MAX_KIR)
+		return -EINVAL;
+
 	if (num_cluster != perfmgr_clusters) {
 		pr_debug(
 				"num_cluster : %d perfmgr_clusters: %d, doesn't match\n",
 				num_cluster, perfmgr_clusters);
-		retval = -1;
 		perfmgr_trace_printk("cpu_ctrl",
 			"num_cluster != perfmgr_clusters\n");
-		goto ret_update;
+		return -1;
 	}
 
-
 	for_each_perfmgr_clusters(i) {
-		final_freq[i].min = -1;
-		final_freq[i].max = -1;
+		req[i].min = freq_limit[i].min >= -1 ? freq_limit[i].min : -1;
+		req[i].max = freq_limit[i].max >= -1 ? freq_limit[i].max : -1;
 	}
 
-	len += snprintf(msg + len, sizeof(msg) - len, "[%d] ", kicker);
-	if (len < 0) {
-		perfmgr_trace_printk("cpu_ctrl", "return -EIO 1\n");
-		mutex_unlock(&boost_freq);
-		return -EIO;
+	retval = boost_arb_update(&cpu_freq_arb, kicker, req, timeout_ms);
+	if (retval) {
+		perfmgr_trace_printk("cpu_ctrl", "arb update failed\n");
+		return retval;
 	}
-	for_each_perfmgr_clusters(i) {
-		freq_set[kicker][i].min = freq_limit[i].min >= -1 ?
-			freq_limit[i].min : -1;
-		freq_set[kicker][i].max = freq_limit[i].max >= -1 ?
-			freq_limit[i].max : -1;
-
-		len += snprintf(msg + len, sizeof(msg) - len, "(%d)(%d) ",
-		freq_set[kicker][i].min, freq_set[kicker][i].max);
-		if (len < 0) {
-			perfmgr_trace_printk("cpu_ctrl", "return -EIO 2\n");
-			mutex_unlock(&boost_freq);
-			return -EIO;
-		}
 
-		if (freq_set[kicker][i].min == -1 &&
-				freq_set[kicker][i].max == -1)
-			clear_bit(kicker, &policy_mask[i]);
-		else
-			set_bit(kicker, &policy_mask[i]);
-
-		len1 += snprintf(msg1 + len1, sizeof(msg1) - len1,
-				"[0x %lx] ", policy_mask[i]);
-		if (len1 < 0) {
-			perfmgr_trace_printk("cpu_ctrl", "return -EIO 3\n");
-			mutex_unlock(&boost_freq);
-			return -EIO;
-		}
-	}
+	if (!log_enable && !IS_ENABLED(CONFIG_TRACING))
+		return 0;
 
-	for (i = 0; i < CPU_MAX_KIR; i++) {
-		for_each_perfmgr_clusters(j) {
-			final_freq[j].min
-				= MAX(freq_set[i][j].min, final_freq[j].min);
-#ifdef CONFIG_MTK_CPU_CTRL_CFP
-			final_freq[j].max
-				= final_freq[j].max != -1 &&
-				freq_set[i][j].max != -1 ?
-				MIN(freq_set[i][j].max, final_freq[j].max) :
-				MAX(freq_set[i][j].max, final_freq[j].max);
-#else
-			final_freq[j].max
-				= MAX(freq_set[i][j].max, final_freq[j].max);
-#endif
-			if (final_freq[j].min > final_freq[j].max &&
-					final_freq[j].max != -1)
-				final_freq[j].max = final_freq[j].min;
-		}
+	/* merged result and policy_mask of the same merge */
+	boost_arb_lock(&cpu_freq_arb);
+	for_each_perfmgr_clusters(i) {
+		final[i].min = current_freq[i].min;
+		final[i].max = current_freq[i].max;
+		mask[i] = policy_mask[i];
 	}
+	boost_arb_unlock(&cpu_freq_arb);
 
+	len += scnprintf(msg + len, sizeof(msg) - len, "[%d] ", kicker);
 	for_each_perfmgr_clusters(i) {
-		current_freq[i].min = final_freq[i].min;
-		current_freq[i].max = final_freq[i].max;
-		len += snprintf(msg + len, sizeof(msg) - len, "{%d}{%d} ",
-				current_freq[i].min, current_freq[i].max);
-		if (len < 0) {
-			perfmgr_trace_printk("cpu_ctrl", "return -EIO 4\n");
-			mutex_unlock(&boost_freq);
-			return -EIO;
-		}
+		len += scnprintf(msg + len, sizeof(msg) - len, "(%d)(%d) ",
+				req[i].min, req[i].max);
+		len1 += scnprintf(msg1 + len1, sizeof(msg1) - len1,
+				"[0x %lx] ", mask[i]);
 	}
+	for_each_perfmgr_clusters(i)
+		len += scnprintf(msg + len, sizeof(msg) - len, "{%d}{%d} ",
+				final[i].min, final[i].max);
 
 	if (strlen(msg) + strlen(msg1) < LOG_BUF_SIZE)
 		strncat(msg, msg1, strlen(msg1));
@@ -160,23 +192,16 @@ int update_userlimit_cpu_freq(int kicker, int num_cluster
 	perfmgr_trace_printk("cpu_ctrl", msg);
 #endif
 
-
-#ifdef CONFIG_MTK_CPU_CTRL_CFP
-	if (!cfp_init_ret)
-		cpu_ctrl_cfp(final_freq);
-	else
-		mt_ppm_userlimit_cpu_freq(perfmgr_clusters, final_freq);
-#else
-	mt_ppm_userlimit_cpu_freq(perfmgr_clusters, final_freq);
-#endif
-
-ret_update:
-	kfree(final_freq);
-	mutex_unlock(&boost_freq);
-	return retval;
-
 	return 0;
 }
+EXPORT_SYMBOL(update_userlimit_cpu_freq_timeout);
+
+int update_userlimit_cpu_freq(int kicker, int num_cluster
+		, struct ppm_limit_data *freq_limit)
+{
+	return update_userlimit_cpu_freq_timeout(kicker, num_cluster,
+			freq_limit, 0);
+}
 EXPORT_SYMBOL(update_userlimit_cpu_freq);
 
 
@@ -244,10 +269,12 @@ static int perfmgr_perfserv_freq_proc_show(struct seq_file *m, void *v)
 {
 	int i;
 
+	boost_arb_lock(&cpu_freq_arb);
 	for_each_perfmgr_clusters(i)
 		seq_printf(m, "cluster %d min:%d max:%d\n",
-				i, freq_set[CPU_KIR_PERF][i].min,
-				freq_set[CPU_KIR_PERF][i].max);
+				i, boost_arb_req(&cpu_freq_arb, CPU_KIR_PERF)[i].min,
+				boost_arb_req(&cpu_freq_arb, CPU_KIR_PERF)[i].max);
+	boost_arb_unlock(&cpu_freq_arb);
 	return 0;
 }
 /***************************************/
@@ -312,10 +339,12 @@ static int perfmgr_boot_freq_proc_show(struct seq_file *m, void *v)
 {
 	int i;
 
+	boost_arb_lock(&cpu_freq_arb);
 	for_each_perfmgr_clusters(i)
 		seq_printf(m, "cluster %d min:%d max:%d\n",
-				i, freq_set[CPU_KIR_BOOT][i].min,
-				freq_set[CPU_KIR_BOOT][i].max);
+				i, boost_arb_req(&cpu_freq_arb, CPU_KIR_BOOT)[i].min,
+				boost_arb_req(&cpu_freq_arb, CPU_KIR_BOOT)[i].max);
+	boost_arb_unlock(&cpu_freq_arb);
 
 	return 0;
 }
@@ -325,9 +354,11 @@ static int perfmgr_current_freq_proc_show(struct seq_file *m, void *v)
 {
 	int i;
 
+	boost_arb_lock(&cpu_freq_arb);
 	for_each_perfmgr_clusters(i)
 		seq_printf(m, "cluster %d min:%d max:%d\n",
 				i, current_freq[i].min, current_freq[i].max);
+	boost_arb_unlock(&cpu_freq_arb);
 
 	return 0;
 }
@@ -355,16 +386,49 @@ static int perfmgr_perfmgr_log_proc_show(struct seq_file *m, void *v)
 }
 
 
+/*******************************************/
+static ssize_t perfmgr_arb_window_us_proc_write(struct file *filp,
+		const char __user *ubuf, size_t cnt, loff_t *pos)
+{
+	int data = 0;
+
+	int rv = check_proc_write(&data, ubuf, cnt);
+
+	if (rv != 0)
+		return rv;
+
+	boost_arb_lock(&cpu_freq_arb);
+	cpu_freq_arb.window_us = clamp(data, 0, 100000);
+	boost_arb_unlock(&cpu_freq_arb);
+	boost_arb_flush(&cpu_freq_arb);
+
+	return cnt;
+}
+
+static int perfmgr_arb_window_us_proc_show(struct seq_file *m, void *v)
+{
+	seq_printf(m, "%u\n", cpu_freq_arb.window_us);
+	return 0;
+}
+
+static int perfmgr_arb_history_proc_show(struct seq_file *m, void *v)
+{
+	boost_arb_show(&cpu_freq_arb, m);
+	return 0;
+}
+
 PROC_FOPS_RW(perfserv_freq);
 PROC_FOPS_RW(boot_freq);
 PROC_FOPS_RO(current_freq);
 PROC_FOPS_RW(perfmgr_log);
+PROC_FOPS_RW(arb_window_us);
+PROC_FOPS_RO(arb_history);
 
 /************************************************/
 int cpu_ctrl_init(struct proc_dir_entry *parent)
 {
 	struct proc_dir_entry *boost_dir = NULL;
-	int i, j, ret = 0;
+	int i, ret = 0;
 
 	struct pentry {
 		const char *name;
@@ -376,8 +440,33 @@ int cpu_ctrl_init(struct proc_dir_entry *parent)
 		PROC_ENTRY(boot_freq),
 		PROC_ENTRY(current_freq),
 		PROC_ENTRY(perfmgr_log),
+		PROC_ENTRY(arb_window_us),
+		PROC_ENTRY(arb_history),
 	};
-	mutex_init(&boost_freq);
+
+	current_freq = kcalloc(perfmgr_clusters, sizeof(struct ppm_limit_data),
+			GFP_KERNEL);
+	final_freq = kcalloc(perfmgr_clusters, sizeof(struct ppm_limit_data),
+			GFP_KERNEL);
+	policy_mask = kcalloc(perfmgr_clusters, sizeof(unsigned long),
+			GFP_KERNEL);
+	if (!current_freq || !final_freq || !policy_mask) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for_each_perfmgr_clusters(i) {
+		current_freq[i].min = -1;
+		current_freq[i].max = -1;
+		policy_mask[i] = 0;
+	}
+
+	cpu_freq_arb.nr_item = perfmgr_clusters;
+	ret = boost_arb_init(&cpu_freq_arb);
+	if (ret) {
+		pr_debug("%s(), arbiter init failed %d\n", __func__, ret);
+		goto out;
+	}
 
 	boost_dir = proc_mkdir("cpu_ctrl", parent);
 
@@ -399,30 +488,6 @@ int cpu_ctrl_init(struct proc_dir_entry *parent)
 	cfp_init_ret = cpu_ctrl_cfp_init(boost_dir);
 #endif
 
-	current_freq = kcalloc(perfmgr_clusters, sizeof(struct ppm_limit_data),
-			GFP_KERNEL);
-
-	policy_mask = kcalloc(perfmgr_clusters, sizeof(unsigned long),
-			GFP_KERNEL);
-
-
-	for (i = 0; i < CPU_MAX_KIR; i++)
-		freq_set[i] = kcalloc(perfmgr_clusters
-				, sizeof(struct ppm_limit_data)
-				, GFP_KERNEL);
-
-	for_each_perfmgr_clusters(i) {
-		current_freq[i].min = -1;
-		current_freq[i].max = -1;
-		policy_mask[i] = 0;
-	}
-
-	for (i = 0; i < CPU_MAX_KIR; i++) {
-		for_each_perfmgr_clusters(j) {
-			freq_set[i][j].min = -1;
-			freq_set[i][j].max = -1;
-		}
-	}
 out:
 	return ret;
 
@@ -430,12 +495,10 @@ int cpu_ctrl_init(struct proc_dir_entry *parent)
 
 void cpu_ctrl_exit(void)
 {
-	int i;
-
+	boost_arb_exit(&cpu_freq_arb);
 	kfree(current_freq);
+	kfree(final_freq);
 	kfree(policy_mask);
-	for (i = 0; i < CPU_MAX_KIR; i++)
-		kfree(freq_set[i]);
 
 #ifdef CONFIG_MTK_CPU_CTRL_CFP
 	if (!cfp_init_ret)
@@ -211,6 +211,7 @@ int dram_ctrl_init(struct proc_dir_entry *parent)
 #else
 	ddr_type = -1;
 #endif
+	ret = dram_pred_ctrl_init(drams_dir);
 	pr_debug("init dram driver done\n");
 out:
 	return ret;
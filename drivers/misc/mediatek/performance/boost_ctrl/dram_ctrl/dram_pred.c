@@ -0,0 +1,635 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * DDR level prediction ahead of frame demand.
+ *
+ * Bandwidth votes reach DVFSRC once a client already needs the bandwidth,
+ * so the DDR opp trails the frames that need it. The predictor follows
+ * the frames of one FPSGO render: the EMI monitor samples of the qos
+ * observer are folded into the running frame, at every frame start the
+ * level predicted for the new frame is voted, and lead_us before the
+ * next frame is due the level predicted for it is voted too if higher.
+ */
+
+#define pr_fmt(fmt) "[dram_pred]"fmt
+#include <linux/hrtimer.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/notifier.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <linux/workqueue.h>
+
+#if defined(MTK_QOS_SUPPORT)
+#include <linux/pm_qos.h>
+#include <helio-dvfsrc-opp.h>
+#endif
+
+#include <mt-plat/mtk_perfobserver.h>
+
+#include "pob_qos.h"
+#include "mtk_perfmgr_internal.h"
+#include "boost_ctrl.h"
+#include "dram_pred.h"
+
+/*------------------------predictor------------------------*/
+
+void dram_pred_init(struct dram_pred *p, const unsigned int *thresh,
+		unsigned int nr_level)
+{
+	memset(p, 0, sizeof(*p));
+	p->nr_level = clamp_t(unsigned int, nr_level, 1, DRAM_PRED_MAX_LEVEL);
+	memcpy(p->thresh, thresh, (p->nr_level - 1) * sizeof(*thresh));
+	p->margin_pct = DRAM_PRED_MARGIN_PCT;
+	p->lead_us = DRAM_PRED_LEAD_US;
+	p->next = -1;
+}
+EXPORT_SYMBOL(dram_pred_init);
+
+int dram_pred_bw_level(const struct dram_pred *p, unsigned int bw)
+{
+	int level = 0;
+
+	while (level < p->nr_level - 1 && bw >= p->thresh[level])
+		level++;
+
+	return level;
+}
+EXPORT_SYMBOL(dram_pred_bw_level);
+
+/* bw[] in MB/s, one per client */
+void dram_pred_sample(struct dram_pred *p, const unsigned int *bw)
+{
+	unsigned int total = 0;
+	int i;
+
+	if (!p->in_frame)
+		return;
+
+	for (i = 0; i < NR_DRAM_PRED_CLIENT; i++) {
+		total += bw[i];
+		p->peak[i] = max(p->peak[i], bw[i]);
+	}
+	p->total_peak = max(p->total_peak, total);
+}
+EXPORT_SYMBOL(dram_pred_sample);
+
+static int dram_pred_lookup(struct dram_pred *p, unsigned int hist,
+		bool *pattern)
+{
+	struct dram_pred_entry *e = &p->table[hist];
+	u64 bw;
+
+	*pattern = e->conf >= DRAM_PRED_CONF_USE;
+	if (*pattern)
+		return e->level;
+
+	bw = div_u64((u64)p->total_ewma * (100 + p->margin_pct), 100);
+
+	return dram_pred_bw_level(p, min_t(u64, bw, UINT_MAX));
+}
+
+static void dram_pred_learn(struct dram_pred *p, int actual)
+{
+	struct dram_pred_entry *e = &p->table[p->hist];
+
+	if (e->level == actual) {
+		if (e->conf < DRAM_PRED_CONF_MAX)
+			e->conf++;
+	} else if (e->conf) {
+		e->conf--;
+	} else {
+		e->level = actual;
+	}
+
+	p->hist = ((p->hist << 2) | actual) & (DRAM_PRED_NR_PATTERN - 1);
+}
+
+static void dram_pred_score(struct dram_pred *p, int actual, u64 len)
+{
+	struct dram_pred_stat *s = &p->stat;
+
+	s->nr_frame++;
+	if (p->pattern)
+		s->nr_pattern++;
+
+	if (p->level == actual) {
+		s->nr_hit++;
+	} else if (p->level < actual) {
+		s->nr_under++;
+		s->under_level += actual - p->level;
+	} else {
+		s->nr_over++;
+		s->over_level_us += (p->level - actual) *
+			div_u64(len, NSEC_PER_USEC);
+	}
+}
+
+static unsigned int dram_pred_ewma(unsigned int avg, unsigned int val)
+{
+	return (avg * 3 + val) / 4;
+}
+
+/*
+ * Closes the running frame, if any, and opens one at now. Returns the
+ * level predicted for the new frame.
+ */
+int dram_pred_frame_start(struct dram_pred *p, u64 now)
+{
+	u64 len;
+	int actual, i;
+
+	if (p->in_frame && now > p->frame_start) {
+		len = now - p->frame_start;
+		actual = dram_pred_bw_level(p, p->total_peak);
+		dram_pred_score(p, actual, len);
+		dram_pred_learn(p, actual);
+
+		/* the first frame seeds the averages */
+		if (!p->period_ns) {
+			p->period_ns = len;
+			memcpy(p->ewma, p->peak, sizeof(p->ewma));
+			p->total_ewma = p->total_peak;
+		} else {
+			p->period_ns = div_u64(p->period_ns * 3 + len, 4);
+			for (i = 0; i < NR_DRAM_PRED_CLIENT; i++)
+				p->ewma[i] = dram_pred_ewma(p->ewma[i],
+						p->peak[i]);
+			p->total_ewma = dram_pred_ewma(p->total_ewma,
+					p->total_peak);
+		}
+	}
+
+	p->in_frame = true;
+	p->frame_start = now;
+	memset(p->peak, 0, sizeof(p->peak));
+	p->total_peak = 0;
+
+	if (p->next >= 0) {
+		p->level = p->next;
+		p->pattern = p->next_pattern;
+	} else {
+		p->level = dram_pred_lookup(p, p->hist, &p->pattern);
+	}
+	p->next = -1;
+
+	return p->level;
+}
+EXPORT_SYMBOL(dram_pred_frame_start);
+
+/* When the level of the next frame should be voted, 0 if unknown */
+u64 dram_pred_next_due(const struct dram_pred *p)
+{
+	u64 lead = (u64)p->lead_us * NSEC_PER_USEC;
+
+	if (!p->in_frame || !p->period_ns)
+		return 0;
+
+	return p->frame_start + (p->period_ns > lead ? p->period_ns - lead : 0);
+}
+EXPORT_SYMBOL(dram_pred_next_due);
+
+/*
+ * Predicts the frame after the running one. The running frame stands in
+ * the history with what it has shown so far once past half its period,
+ * with its own prediction before that.
+ */
+int dram_pred_predict_next(struct dram_pred *p, u64 now)
+{
+	unsigned int hist;
+	int guess = p->level;
+
+	if (p->in_frame && (now - p->frame_start) * 2 >= p->period_ns)
+		guess = dram_pred_bw_level(p, p->total_peak);
+
+	hist = ((p->hist << 2) | guess) & (DRAM_PRED_NR_PATTERN - 1);
+	p->next = dram_pred_lookup(p, hist, &p->next_pattern);
+
+	return p->next;
+}
+EXPORT_SYMBOL(dram_pred_predict_next);
+
+void dram_pred_show(struct dram_pred *p, struct seq_file *m)
+{
+	struct dram_pred_stat *s = &p->stat;
+	int i;
+
+	seq_printf(m, "levels %u thresh", p->nr_level);
+	for (i = 0; i < p->nr_level - 1; i++)
+		seq_printf(m, " %u", p->thresh[i]);
+	seq_printf(m, " MB/s margin %u%% lead %u us\n", p->margin_pct,
+		p->lead_us);
+	seq_printf(m, "period %llu us total %u MB/s", div_u64(p->period_ns,
+		NSEC_PER_USEC), p->total_ewma);
+	seq_printf(m, " cpu %u gpu %u mm %u md %u apu %u\n",
+		p->ewma[DRAM_PRED_CPU], p->ewma[DRAM_PRED_GPU],
+		p->ewma[DRAM_PRED_MM], p->ewma[DRAM_PRED_MD],
+		p->ewma[DRAM_PRED_APU]);
+	seq_printf(m, "frames %llu hit %llu (%llu%%) pattern %llu\n",
+		s->nr_frame, s->nr_hit,
+		s->nr_frame ? div64_u64(s->nr_hit * 100, s->nr_frame) : 0,
+		s->nr_pattern);
+	seq_printf(m, "under %llu (%llu levels) over %llu (%llu level-us)\n",
+		s->nr_under, s->under_level, s->nr_over, s->over_level_us);
+}
+EXPORT_SYMBOL(dram_pred_show);
+
+/*------------------------voting------------------------*/
+
+/* a render quiet for this long is dropped, and with it the vote */
+#define DRAM_PRED_IDLE_NS	(100 * NSEC_PER_MSEC)
+
+static const enum pob_qosbm_type dram_pred_pqbt[NR_DRAM_PRED_CLIENT] = {
+	[DRAM_PRED_CPU] = PQBT_CPU,
+	[DRAM_PRED_GPU] = PQBT_GPU,
+	[DRAM_PRED_MM] = PQBT_MM,
+	[DRAM_PRED_MD] = PQBT_MD,
+	[DRAM_PRED_APU] = PQBT_APU,
+};
+
+static unsigned int dram_pred_thresh[DRAM_PRED_MAX_LEVEL - 1] = {
+	4000, 8000, 12000
+};
+
+static struct dram_pred dram_pred;
+static DEFINE_SPINLOCK(dram_pred_lock);
+static DEFINE_MUTEX(dram_pred_mutex);	/* enable/disable */
+static int dram_pred_enable;
+static int dram_pred_follow;		/* render followed */
+static u64 dram_pred_follow_ts;
+static bool dram_pred_lead;		/* timer is the lead vote */
+static int dram_pred_vote;		/* level voted */
+static u64 dram_pred_nr_vote;
+static u64 dram_pred_nr_lead;
+static struct hrtimer dram_pred_timer;
+static struct work_struct dram_pred_work;
+
+#ifdef MTK_QOS_SUPPORT
+static struct pm_qos_request dram_pred_request;
+#endif
+
+static void dram_pred_work_fn(struct work_struct *work)
+{
+	unsigned long flags;
+	int level;
+
+	spin_lock_irqsave(&dram_pred_lock, flags);
+	level = dram_pred_vote;
+	spin_unlock_irqrestore(&dram_pred_lock, flags);
+
+#ifdef MTK_QOS_SUPPORT
+	if (!pm_qos_request_active(&dram_pred_request))
+		return;
+#if defined(MTK_QOS_EMI_OPP)
+	pm_qos_update_request(&dram_pred_request, level ?
+		DDR_OPP_NUM - 1 - level : PM_QOS_EMI_OPP_DEFAULT_VALUE);
+#else
+	pm_qos_update_request(&dram_pred_request, level ?
+		DDR_OPP_NUM - 1 - level : PM_QOS_DDR_OPP_DEFAULT_VALUE);
+#endif
+#endif
+}
+
+/* dram_pred_lock held */
+static void dram_pred_set_vote(int level)
+{
+	if (level == dram_pred_vote)
+		return;
+
+	dram_pred_vote = level;
+	dram_pred_nr_vote++;
+	queue_work(system_highpri_wq, &dram_pred_work);
+}
+
+static enum hrtimer_restart dram_pred_timer_fn(struct hrtimer *timer)
+{
+	enum hrtimer_restart ret = HRTIMER_NORESTART;
+	unsigned long flags;
+	u64 now = ktime_get_ns();
+	int next;
+
+	spin_lock_irqsave(&dram_pred_lock, flags);
+	/*
+	 * A frame that came in while we waited for the lock has re-armed
+	 * the timer with its own lead and idle check: keep that one, it
+	 * must be neither forwarded nor restarted from here.
+	 */
+	if (hrtimer_is_queued(timer))
+		goto out;
+	if (dram_pred_lead) {
+		dram_pred_lead = false;
+		next = dram_pred_predict_next(&dram_pred, now);
+		if (next > dram_pred_vote) {
+			dram_pred_set_vote(next);
+			dram_pred_nr_lead++;
+		}
+		/* come back to drop the vote if no frame shows up */
+		hrtimer_forward_now(timer, ns_to_ktime(DRAM_PRED_IDLE_NS));
+		ret = HRTIMER_RESTART;
+	} else {
+		dram_pred.in_frame = false;
+		dram_pred.next = -1;
+		dram_pred_set_vote(0);
+	}
+out:
+	spin_unlock_irqrestore(&dram_pred_lock, flags);
+
+	return ret;
+}
+
+static void dram_pred_frame(int tskid)
+{
+	unsigned long flags;
+	u64 now = ktime_get_ns(), due;
+	int level;
+
+	spin_lock_irqsave(&dram_pred_lock, flags);
+	if (!dram_pred_enable)
+		goto out;
+
+	/* one render at a time, another takes over once it goes quiet */
+	if (tskid != dram_pred_follow) {
+		if (now - dram_pred_follow_ts < DRAM_PRED_IDLE_NS)
+			goto out;
+		dram_pred_follow = tskid;
+	}
+	dram_pred_follow_ts = now;
+
+	level = dram_pred_frame_start(&dram_pred, now);
+	dram_pred_set_vote(level);
+
+	/* no period known yet, nothing to lead with, only the idle check */
+	due = dram_pred_next_due(&dram_pred);
+	dram_pred_lead = !!due;
+	if (!due)
+		due = now + DRAM_PRED_IDLE_NS;
+	hrtimer_start(&dram_pred_timer, ns_to_ktime(due > now ? due - now : 0),
+		HRTIMER_MODE_REL);
+out:
+	spin_unlock_irqrestore(&dram_pred_lock, flags);
+}
+
+static int dram_pred_fpsgo_cb(struct notifier_block *nb,
+		unsigned long val, void *data)
+{
+	struct pob_fpsgo_frame_info *info = data;
+
+	if (val == POB_FPSGO_FRAME_START && info)
+		dram_pred_frame(info->tskid);
+
+	return NOTIFY_OK;
+}
+
+static int dram_pred_qos_cb(struct notifier_block *nb,
+		unsigned long val, void *data)
+{
+	struct pob_qos_info *pqi = data;
+	unsigned int bw[NR_DRAM_PRED_CLIENT];
+	unsigned long flags;
+	int i, c, item;
+
+	if (val != POB_QOS_EMI_ALL || !pqi)
+		return NOTIFY_OK;
+
+	for (i = 0; i < pqi->size; i++) {
+		for (c = 0; c < NR_DRAM_PRED_CLIENT; c++) {
+			item = pob_qosbm_get_stat(pqi->pstats, i,
+					dram_pred_pqbt[c], PQBP_EMI,
+					PQBS_MON, 0, 0);
+			bw[c] = item > 0 ? item : 0;
+		}
+
+		spin_lock_irqsave(&dram_pred_lock, flags);
+		dram_pred_sample(&dram_pred, bw);
+		spin_unlock_irqrestore(&dram_pred_lock, flags);
+	}
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block dram_pred_fpsgo_nb = {
+	.notifier_call = dram_pred_fpsgo_cb,
+};
+
+static struct notifier_block dram_pred_qos_nb = {
+	.notifier_call = dram_pred_qos_cb,
+};
+
+static void dram_pred_set_enable(int enable)
+{
+	unsigned long flags;
+
+	mutex_lock(&dram_pred_mutex);
+	if (enable == dram_pred_enable)
+		goto out;
+
+	if (enable) {
+		/* the qos monitor only runs while it has clients */
+		pob_qos_register_client(&dram_pred_qos_nb);
+		pob_fpsgo_register_client(&dram_pred_fpsgo_nb);
+	} else {
+		pob_fpsgo_unregister_client(&dram_pred_fpsgo_nb);
+		pob_qos_unregister_client(&dram_pred_qos_nb);
+		hrtimer_cancel(&dram_pred_timer);
+	}
+
+	spin_lock_irqsave(&dram_pred_lock, flags);
+	dram_pred_enable = enable;
+	dram_pred.in_frame = false;
+	dram_pred.next = -1;
+	dram_pred_follow = 0;
+	dram_pred_follow_ts = 0;
+	dram_pred_set_vote(0);
+	spin_unlock_irqrestore(&dram_pred_lock, flags);
+out:
+	mutex_unlock(&dram_pred_mutex);
+}
+
+/*------------------------procfs------------------------*/
+
+static ssize_t perfmgr_pred_enable_proc_write(struct file *filp,
+		const char __user *ubuf, size_t cnt, loff_t *pos)
+{
+	int val, ret;
+
+	ret = kstrtoint_from_user(ubuf, cnt, 10, &val);
+	if (ret < 0)
+		return ret;
+
+	dram_pred_set_enable(!!val);
+
+	return cnt;
+}
+
+static int perfmgr_pred_enable_proc_show(struct seq_file *m, void *v)
+{
+	seq_printf(m, "%d\n", dram_pred_enable);
+	return 0;
+}
+
+static ssize_t perfmgr_pred_lead_us_proc_write(struct file *filp,
+		const char __user *ubuf, size_t cnt, loff_t *pos)
+{
+	unsigned long flags;
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint_from_user(ubuf, cnt, 10, &val);
+	if (ret < 0)
+		return ret;
+	if (val > USEC_PER_SEC)
+		return -EINVAL;
+
+	spin_lock_irqsave(&dram_pred_lock, flags);
+	dram_pred.lead_us = val;
+	spin_unlock_irqrestore(&dram_pred_lock, flags);
+
+	return cnt;
+}
+
+static int perfmgr_pred_lead_us_proc_show(struct seq_file *m, void *v)
+{
+	seq_printf(m, "%u\n", dram_pred.lead_us);
+	return 0;
+}
+
+/* "t1 t2 ..." in MB/s, one per level above the lowest */
+static ssize_t perfmgr_pred_thresh_proc_write(struct file *filp,
+		const char __user *ubuf, size_t cnt, loff_t *pos)
+{
+	unsigned int t[DRAM_PRED_MAX_LEVEL - 1];
+	unsigned long flags;
+	char buf[64];
+	int i, n;
+
+	if (cnt >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, cnt))
+		return -EFAULT;
+	buf[cnt] = 0;
+
+	n = sscanf(buf, "%u %u %u", &t[0], &t[1], &t[2]);
+	if (n != dram_pred.nr_level - 1)
+		return -EINVAL;
+	for (i = 1; i < n; i++)
+		if (t[i] <= t[i - 1])
+			return -EINVAL;
+
+	spin_lock_irqsave(&dram_pred_lock, flags);
+	memcpy(dram_pred.thresh, t, n * sizeof(t[0]));
+	spin_unlock_irqrestore(&dram_pred_lock, flags);
+
+	return cnt;
+}
+
+static int perfmgr_pred_thresh_proc_show(struct seq_file *m, void *v)
+{
+	int i;
+
+	for (i = 0; i < dram_pred.nr_level - 1; i++)
+		seq_printf(m, "%u ", dram_pred.thresh[i]);
+	seq_puts(m, "\n");
+	return 0;
+}
+
+/* any write resets the counters */
+static ssize_t perfmgr_pred_stat_proc_write(struct file *filp,
+		const char __user *ubuf, size_t cnt, loff_t *pos)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dram_pred_lock, flags);
+	memset(&dram_pred.stat, 0, sizeof(dram_pred.stat));
+	dram_pred_nr_vote = 0;
+	dram_pred_nr_lead = 0;
+	spin_unlock_irqrestore(&dram_pred_lock, flags);
+
+	return cnt;
+}
+
+static int perfmgr_pred_stat_proc_show(struct seq_file *m, void *v)
+{
+	struct dram_pred p;
+	unsigned long flags;
+	u64 nr_vote, nr_lead;
+	int vote, follow;
+
+	spin_lock_irqsave(&dram_pred_lock, flags);
+	p = dram_pred;
+	nr_vote = dram_pred_nr_vote;
+	nr_lead = dram_pred_nr_lead;
+	vote = dram_pred_vote;
+	follow = dram_pred_follow;
+	spin_unlock_irqrestore(&dram_pred_lock, flags);
+
+	dram_pred_show(&p, m);
+	seq_printf(m, "render %d vote %d votes %llu ahead %llu\n", follow,
+		vote, nr_vote, nr_lead);
+
+	return 0;
+}
+
+PROC_FOPS_RW(pred_enable);
+PROC_FOPS_RW(pred_lead_us);
+PROC_FOPS_RW(pred_thresh);
+PROC_FOPS_RW(pred_stat);
+
+int dram_pred_ctrl_init(struct proc_dir_entry *parent)
+{
+	int i, nr_level = 2;
+
+	struct pentry {
+		const char *name;
+		const struct file_operations *fops;
+	};
+
+	const struct pentry entries[] = {
+		PROC_ENTRY(pred_enable),
+		PROC_ENTRY(pred_lead_us),
+		PROC_ENTRY(pred_thresh),
+		PROC_ENTRY(pred_stat),
+	};
+
+#ifdef MTK_QOS_SUPPORT
+	nr_level = DDR_OPP_NUM;
+#if defined(MTK_QOS_EMI_OPP)
+	pm_qos_add_request(&dram_pred_request, PM_QOS_EMI_OPP,
+			PM_QOS_EMI_OPP_DEFAULT_VALUE);
+#else
+	pm_qos_add_request(&dram_pred_request, PM_QOS_DDR_OPP,
+			PM_QOS_DDR_OPP_DEFAULT_VALUE);
+#endif
+#endif
+
+	dram_pred_init(&dram_pred, dram_pred_thresh, nr_level);
+	hrtimer_init(&dram_pred_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	dram_pred_timer.function = dram_pred_timer_fn;
+	INIT_WORK(&dram_pred_work, dram_pred_work_fn);
+
+	for (i = 0; i < ARRAY_SIZE(entries); i++) {
+		if (!proc_create(entries[i].name, 0644,
+					parent, entries[i].fops)) {
+			pr_debug("%s(), create /dram_ctrl%s failed\n",
+					__func__, entries[i].name);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
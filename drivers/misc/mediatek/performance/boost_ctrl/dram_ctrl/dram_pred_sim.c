@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * DRAM bandwidth predictor trace replay
+ *
+ * Replays synthetic frame traces in virtual time. A frame moves bw x
+ * work_us worth of data; at a DDR level whose capacity is below bw it
+ * takes longer, and it loses its deadline when it runs past the frame
+ * period. Raising the level takes switch_us during which the frame still
+ * runs at the old one. Energy is the power of the level voted, summed
+ * over time. Each trace runs against three policies: the predictor as
+ * dram_ctrl drives it, a reactive vote of what the last frame needed,
+ * and the highest level all the time.
+ */
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+#include "dram_pred.h"
+
+#define TAG "[DRAM_PRED_SIM]"
+#define SIM_LEVEL	DRAM_PRED_MAX_LEVEL
+
+static unsigned int nr_frame = 600;
+module_param(nr_frame, uint, 0444);
+MODULE_PARM_DESC(nr_frame, "Frames per trace");
+
+static unsigned int period_us = 16666;
+module_param(period_us, uint, 0444);
+MODULE_PARM_DESC(period_us, "Frame period");
+
+static unsigned int lead_us = DRAM_PRED_LEAD_US;
+module_param(lead_us, uint, 0444);
+MODULE_PARM_DESC(lead_us, "Predictor lead time");
+
+static unsigned int switch_us = 500;
+module_param(switch_us, uint, 0444);
+MODULE_PARM_DESC(switch_us, "DDR level switch latency");
+
+static const unsigned int sim_thresh[SIM_LEVEL - 1] = { 4000, 8000, 12000 };
+/* MB/s each level sustains, and its power in arbitrary units */
+static const unsigned int sim_cap[SIM_LEVEL] = { 4000, 8000, 12000, 16000 };
+static const unsigned int sim_power[SIM_LEVEL] = { 100, 130, 170, 220 };
+/* share of a frame's bandwidth per client, in percent */
+static const unsigned int sim_share[NR_DRAM_PRED_CLIENT] = {
+	30, 50, 15, 5, 0
+};
+
+struct sim_frame {
+	unsigned int bw;	/* MB/s while busy */
+	unsigned int work_us;	/* busy time with bandwidth to spare */
+};
+
+enum sim_policy {
+	SIM_PRED,
+	SIM_REACTIVE,
+	SIM_MAX,
+	NR_SIM_POLICY
+};
+
+static const char * const sim_policy_name[NR_SIM_POLICY] = {
+	"pred", "reactive", "max"
+};
+
+struct sim_result {
+	unsigned int lost;
+	u64 energy;		/* power x ms */
+};
+
+static struct dram_pred sim_pred;
+static u32 sim_seed;
+
+static u32 sim_rand(void)
+{
+	sim_seed = sim_seed * 1103515245 + 12345;
+	return sim_seed >> 16;
+}
+
+/*------------------------traces------------------------*/
+
+static void trace_steady(struct sim_frame *f, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		f[i].bw = 6000 + sim_rand() % 1000;
+		f[i].work_us = 12000;
+	}
+}
+
+/* a heavy frame every fourth, as with a periodic composition pass */
+static void trace_periodic(struct sim_frame *f, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		f[i].bw = i % 4 == 3 ? 14000 : 3000;
+		f[i].work_us = i % 4 == 3 ? 15000 : 10000;
+	}
+}
+
+static void trace_burst(struct sim_frame *f, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		f[i].bw = sim_rand() % 10 ? 5000 : 13000;
+		f[i].work_us = 14000;
+	}
+}
+
+/* scene load going up and back down */
+static void trace_ramp(struct sim_frame *f, int n)
+{
+	int i, x;
+
+	for (i = 0; i < n; i++) {
+		x = i < n / 2 ? i : n - i;
+		f[i].bw = 2000 + x * 28000 / n;
+		f[i].work_us = 13000;
+	}
+}
+
+static const struct {
+	const char *name;
+	void (*gen)(struct sim_frame *f, int n);
+} sim_trace[] = {
+	{ "steady", trace_steady },
+	{ "periodic", trace_periodic },
+	{ "burst", trace_burst },
+	{ "ramp", trace_ramp },
+};
+
+/*------------------------replay------------------------*/
+
+static unsigned int sim_level_of(unsigned int bw)
+{
+	return dram_pred_bw_level(&sim_pred, bw);
+}
+
+/*
+ * Frame time when it starts at level from and from switch_us on runs at
+ * level to. A lower level takes effect at once.
+ */
+static u64 sim_frame_us(const struct sim_frame *f, int from, int to)
+{
+	u64 data = (u64)f->bw * f->work_us, moved;
+	unsigned int thr_a, thr_b;
+
+	thr_b = min(f->bw, sim_cap[to]);
+	if (from >= to)
+		return div_u64(data, thr_b);
+
+	thr_a = min(f->bw, sim_cap[from]);
+	moved = (u64)thr_a * switch_us;
+	if (moved >= data)
+		return div_u64(data, thr_a);
+
+	return switch_us + div_u64(data - moved, thr_b);
+}
+
+static void sim_sample(const struct sim_frame *f)
+{
+	unsigned int bw[NR_DRAM_PRED_CLIENT];
+	int c;
+
+	for (c = 0; c < NR_DRAM_PRED_CLIENT; c++)
+		bw[c] = f->bw * sim_share[c] / 100;
+	/* rounding must not move the frame to another level */
+	bw[DRAM_PRED_GPU] += f->bw - (bw[0] + bw[1] + bw[2] + bw[3] + bw[4]);
+
+	dram_pred_sample(&sim_pred, bw);
+}
+
+static void sim_run(const struct sim_frame *f, int n, enum sim_policy pol,
+		struct sim_result *r)
+{
+	u64 now = 0, period = (u64)period_us * NSEC_PER_USEC, due;
+	int i, k, vote = 0, level, next;
+
+	memset(r, 0, sizeof(*r));
+	dram_pred_init(&sim_pred, sim_thresh, SIM_LEVEL);
+	sim_pred.lead_us = lead_us;
+
+	for (i = 0; i < n; i++, now += period) {
+		switch (pol) {
+		case SIM_PRED:
+			level = dram_pred_frame_start(&sim_pred, now);
+			break;
+		case SIM_REACTIVE:
+			level = i ? sim_level_of(f[i - 1].bw) : 0;
+			break;
+		default:
+			level = SIM_LEVEL - 1;
+			break;
+		}
+
+		if (sim_frame_us(&f[i], vote, level) > period_us)
+			r->lost++;
+		vote = level;
+
+		if (pol != SIM_PRED) {
+			r->energy += (u64)sim_power[vote] * period_us;
+			continue;
+		}
+
+		/* monitor samples while busy, then the lead vote */
+		due = dram_pred_next_due(&sim_pred);
+		for (k = 1; k <= 4; k++)
+			if (!due || now + (u64)f[i].work_us * k / 4 *
+					NSEC_PER_USEC < due)
+				sim_sample(&f[i]);
+
+		if (due) {
+			next = dram_pred_predict_next(&sim_pred, due);
+			if (next > vote) {
+				r->energy += (u64)sim_power[vote] *
+					div_u64(due - now, NSEC_PER_USEC);
+				r->energy += (u64)sim_power[next] *
+					div_u64(now + period - due,
+						NSEC_PER_USEC);
+				vote = next;
+			} else {
+				r->energy += (u64)sim_power[vote] * period_us;
+			}
+		} else {
+			r->energy += (u64)sim_power[vote] * period_us;
+		}
+
+		for (k = 1; k <= 4; k++)
+			if (due && now + (u64)f[i].work_us * k / 4 *
+					NSEC_PER_USEC >= due)
+				sim_sample(&f[i]);
+	}
+
+	r->energy = div_u64(r->energy, USEC_PER_MSEC);
+}
+
+static int __init dram_pred_sim_init(void)
+{
+	struct sim_result r[NR_SIM_POLICY];
+	struct dram_pred_stat *s = &sim_pred.stat;
+	struct sim_frame *f;
+	int i, p, ret = 0;
+
+	if (nr_frame < 16 || !period_us)
+		return -EINVAL;
+
+	f = vmalloc(nr_frame * sizeof(*f));
+	if (!f)
+		return -ENOMEM;
+
+	for (i = 0; i < ARRAY_SIZE(sim_trace); i++) {
+		sim_seed = 0x5eed;
+		sim_trace[i].gen(f, nr_frame);
+
+		for (p = 0; p < NR_SIM_POLICY; p++) {
+			sim_run(f, nr_frame, p, &r[p]);
+			pr_info(TAG"%-8s %-8s lost %4u/%u energy %llu\n",
+				sim_trace[i].name, sim_policy_name[p],
+				r[p].lost, nr_frame, r[p].energy);
+			if (p == SIM_PRED)
+				pr_info(TAG"%-8s hit %llu under %llu over %llu pattern %llu\n",
+					sim_trace[i].name, s->nr_hit,
+					s->nr_under, s->nr_over,
+					s->nr_pattern);
+		}
+
+		/*
+		 * Cheaper than always at the top, and about as good as reacting
+		 * where there is nothing to learn: random bursts are missed by
+		 * both. Where there is a pattern it has to be learnt.
+		 */
+		if (r[SIM_PRED].energy >= r[SIM_MAX].energy ||
+		    r[SIM_PRED].lost > r[SIM_REACTIVE].lost + nr_frame / 50 ||
+		    (sim_trace[i].gen == trace_periodic &&
+		     r[SIM_PRED].lost * 4 > r[SIM_REACTIVE].lost)) {
+			pr_info(TAG"FAIL: %s\n", sim_trace[i].name);
+			ret = -EINVAL;
+		}
+	}
+
+	vfree(f);
+
+	if (!ret)
+		pr_info(TAG"PASS\n");
+
+	return ret;
+}
+
+static void __exit dram_pred_sim_exit(void)
+{
+}
+
+module_init(dram_pred_sim_init);
+module_exit(dram_pred_sim_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("DRAM bandwidth predictor trace replay");
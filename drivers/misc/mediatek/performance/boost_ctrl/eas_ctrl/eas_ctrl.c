@@ -21,6 +21,7 @@
 #include <linux/string.h>
 #include <linux/uaccess.h>
 
+#include "boost_arb.h"
 #include "boost_ctrl.h"
 #include "eas_ctrl_plat.h"
 #include "eas_ctrl.h"
@@ -35,20 +36,14 @@
 
 /* boost value */
 static struct mutex boost_eas;
-#ifdef CONFIG_SCHED_TUNE
 static int current_boost_value[NR_CGROUP];
 static unsigned long policy_mask[NR_CGROUP];
-#endif
-static int boost_value[NR_CGROUP][EAS_MAX_KIR];
 static int debug_boost_value[NR_CGROUP];
 static int debug_fix_boost;
 
 /* uclamp */
-#if defined(CONFIG_UCLAMP_TASK_GROUP) && defined(CONFIG_SCHED_TUNE)
 static int cur_uclamp_min[NR_CGROUP];
 static unsigned long uclamp_policy_mask[NR_CGROUP];
-#endif
-static int uclamp_min[NR_CGROUP][EAS_MAX_KIR];
 static int debug_uclamp_min[NR_CGROUP];
 
 static int cur_schedplus_down_throttle_ns;
@@ -274,71 +269,163 @@ int update_schedplus_sync_flag(int kicker, int enable)
 	return cur_schedplus_sync_flag;
 }
 
-#ifdef CONFIG_SCHED_TUNE
-int update_eas_boost_value(int kicker, int cgroup_idx, int value)
+/*
+ * Boost and uclamp requests go through an arbiter each: all kickers
+ * are merged right away, stune is written at most once per
+ * arb_window_us and only for the cgroups that changed.
+ */
+static void eas_boost_arb_merge(struct boost_arb *arb,
+		struct boost_arb_val *out)
 {
-	int final_boost = 0;
-	int i, len = 0, len1 = 0;
+	struct boost_arb_val *req;
+	int i, cg, final_boost;
 
-	char msg[LOG_BUF_SIZE];
-	char msg1[LOG_BUF_SIZE];
+	for (cg = 0; cg < NR_CGROUP; cg++) {
+		final_boost = 0;
+		policy_mask[cg] = 0;
 
-	mutex_lock(&boost_eas);
+		for (i = 0; i < EAS_MAX_KIR; i++) {
+			req = boost_arb_req(arb, i);
+			if (req[cg].min == 0)
+				continue;
 
-	if (cgroup_idx >= NR_CGROUP) {
-		mutex_unlock(&boost_eas);
-		pr_debug(" cgroup_idx >= NR_CGROUP, error\n");
-		perfmgr_trace_printk("cpu_ctrl", "cgroup_idx >= NR_CGROUP\n");
-		return -1;
-	}
+			/* Always set first to handle negative input */
+			if (final_boost == 0)
+				final_boost = req[cg].min;
+			else
+				final_boost = MAX(final_boost, req[cg].min);
 
-	boost_value[cgroup_idx][kicker] = value;
-	len += snprintf(msg + len, sizeof(msg) - len, "[%d] [%d] [%d]",
-			kicker, cgroup_idx, value);
+			set_bit(i, &policy_mask[cg]);
+		}
 
-	/*ptr return error EIO:I/O error */
-	if (len < 0) {
-		perfmgr_trace_printk("cpu_ctrl", "return -EIO 1\n");
-		mutex_unlock(&boost_eas);
-		return -EIO;
+		out[cg].min = check_boost_value(final_boost);
+		out[cg].max = 0;
+		current_boost_value[cg] = out[cg].min;
 	}
+}
 
-	for (i = 0; i < EAS_MAX_KIR; i++) {
-		if (boost_value[cgroup_idx][i] == 0) {
-			clear_bit(i, &policy_mask[cgroup_idx]);
-			continue;
-		}
+static void eas_boost_arb_apply(struct boost_arb *arb,
+		const struct boost_arb_val *out,
+		const struct boost_arb_val *prev)
+{
+#ifdef CONFIG_SCHED_TUNE
+	int cg;
 
-		/* Always set first to handle negative input */
-		if (final_boost == 0)
-			final_boost = boost_value[cgroup_idx][i];
-		else
-			final_boost = MAX(final_boost,
-				boost_value[cgroup_idx][i]);
+	/* the debug writes reapply once the override is dropped */
+	if (debug_fix_boost)
+		return;
 
-		set_bit(i, &policy_mask[cgroup_idx]);
-	}
+	for (cg = 0; cg < NR_CGROUP; cg++)
+		if (!prev || out[cg].min != prev[cg].min)
+			boost_write_for_perf_idx(cg, out[cg].min);
+#endif
+}
+
+static const struct boost_arb_ops eas_boost_arb_ops = {
+	.merge = eas_boost_arb_merge,
+	.apply = eas_boost_arb_apply,
+};
+
+static struct boost_arb eas_boost_arb = {
+	.name = "eas_boost",
+	.nr_kicker = EAS_MAX_KIR,
+	.nr_item = NR_CGROUP,
+	.unset = { 0, 0 },
+	.ops = &eas_boost_arb_ops,
+	.window_us = BOOST_ARB_WINDOW_US,
+};
+
+static void eas_uclamp_arb_merge(struct boost_arb *arb,
+		struct boost_arb_val *out)
+{
+	struct boost_arb_val *req;
+	int i, cg, final_uclamp;
 
-	current_boost_value[cgroup_idx] = check_boost_value(final_boost);
+	for (cg = 0; cg < NR_CGROUP; cg++) {
+		final_uclamp = 0;
+		uclamp_policy_mask[cg] = 0;
 
-	len += snprintf(msg + len, sizeof(msg) - len, "{%d} ", final_boost);
-	/*ptr return error EIO:I/O error */
-	if (len < 0) {
-		perfmgr_trace_printk("cpu_ctrl", "return -EIO 2\n");
-		mutex_unlock(&boost_eas);
-		return -EIO;
+		for (i = 0; i < EAS_UCLAMP_MAX_KIR; i++) {
+			req = boost_arb_req(arb, i);
+			if (req[cg].min == 0)
+				continue;
+
+			final_uclamp = MAX(final_uclamp, req[cg].min);
+			set_bit(i, &uclamp_policy_mask[cg]);
+		}
+
+		out[cg].min = check_uclamp_value(final_uclamp);
+		out[cg].max = 0;
+		cur_uclamp_min[cg] = out[cg].min;
 	}
-	len1 += snprintf(msg1 + len1, sizeof(msg1) - len1, "[0x %lx] ",
-			policy_mask[cgroup_idx]);
+}
+
+static void eas_uclamp_arb_apply(struct boost_arb *arb,
+		const struct boost_arb_val *out,
+		const struct boost_arb_val *prev)
+{
+#if defined(CONFIG_UCLAMP_TASK_GROUP) && defined(CONFIG_SCHED_TUNE)
+	int cg;
+
+	for (cg = 0; cg < NR_CGROUP; cg++)
+		if ((!prev || out[cg].min != prev[cg].min) &&
+				debug_uclamp_min[cg] == -1)
+			uclamp_min_pct_for_perf_idx(cg, out[cg].min);
+#endif
+}
+
+static const struct boost_arb_ops eas_uclamp_arb_ops = {
+	.merge = eas_uclamp_arb_merge,
+	.apply = eas_uclamp_arb_apply,
+};
+
+static struct boost_arb eas_uclamp_arb = {
+	.name = "eas_uclamp",
+	.nr_kicker = EAS_UCLAMP_MAX_KIR,
+	.nr_item = NR_CGROUP,
+	.unset = { 0, 0 },
+	.ops = &eas_uclamp_arb_ops,
+	.window_us = BOOST_ARB_WINDOW_US,
+};
+
+#define eas_boost_req(cg, kir) \
+	(boost_arb_req(&eas_boost_arb, kir)[cg].min)
+#define eas_uclamp_req(cg, kir) \
+	(boost_arb_req(&eas_uclamp_arb, kir)[cg].min)
+
+#ifdef CONFIG_SCHED_TUNE
+/* the request of this kicker is dropped after timeout_ms */
+int update_eas_boost_value_timeout(int kicker, int cgroup_idx, int value,
+		unsigned int timeout_ms)
+{
+	struct boost_arb_val val = { value, 0 };
+	int ret, final, len = 0, len1 = 0;
+	unsigned long mask;
+
+	char msg[LOG_BUF_SIZE];
+	char msg1[LOG_BUF_SIZE];
 
-	if (len1 < 0) {
-		perfmgr_trace_printk("cpu_ctrl", "return -EIO 3\n");
-		mutex_unlock(&boost_eas);
-		return -EIO;
+	if (cgroup_idx < 0 || cgroup_idx >= NR_CGROUP) {
+		pr_debug(" cgroup_idx >= NR_CGROUP, error\n");
+		perfmgr_trace_printk("cpu_ctrl", "cgroup_idx >= NR_CGROUP\n");
+		return -1;
 	}
-	if (!debug_fix_boost)
-		boost_write_for_perf_idx(cgroup_idx,
-				current_boost_value[cgroup_idx]);
+
+	ret = boost_arb_update_item(&eas_boost_arb, kicker, cgroup_idx,
+			val, timeout_ms);
+	if (ret)
+		return ret;
+
+	boost_arb_lock(&eas_boost_arb);
+	final = current_boost_value[cgroup_idx];
+	mask = policy_mask[cgroup_idx];
+	boost_arb_unlock(&eas_boost_arb);
+
+	len += scnprintf(msg + len, sizeof(msg) - len, "[%d] [%d] [%d]",
+			kicker, cgroup_idx, value);
+	len += scnprintf(msg + len, sizeof(msg) - len, "{%d} ", final);
+	len1 += scnprintf(msg1 + len1, sizeof(msg1) - len1, "[0x %lx] ",
+			mask);
 
 	if (strlen(msg) + strlen(msg1) < LOG_BUF_SIZE)
 		strncat(msg, msg1, strlen(msg1));
@@ -349,80 +436,54 @@ int update_eas_boost_value(int kicker, int cgroup_idx, int value)
 #ifdef CONFIG_TRACING
 	perfmgr_trace_printk("eas_ctrl", msg);
 #endif
-	mutex_unlock(&boost_eas);
 
-	return current_boost_value[cgroup_idx];
+	return final;
 }
 #else
-int update_eas_boost_value(int kicker, int cgroup_idx, int value)
+int update_eas_boost_value_timeout(int kicker, int cgroup_idx, int value,
+		unsigned int timeout_ms)
 {
 	return -1;
 }
 #endif
+EXPORT_SYMBOL(update_eas_boost_value_timeout);
+
+int update_eas_boost_value(int kicker, int cgroup_idx, int value)
+{
+	return update_eas_boost_value_timeout(kicker, cgroup_idx, value, 0);
+}
 
 #if defined(CONFIG_UCLAMP_TASK_GROUP) && defined(CONFIG_SCHED_TUNE)
 int update_eas_uclamp_min(int kicker, int cgroup_idx, int value)
 {
-	int final_uclamp = 0;
-	int i, len = 0, len1 = 0;
+	struct boost_arb_val val = { value, 0 };
+	int ret, final, len = 0, len1 = 0;
+	unsigned long mask;
 
 	char msg[LOG_BUF_SIZE];
 	char msg1[LOG_BUF_SIZE];
 
-	mutex_lock(&boost_eas);
-
-	if (cgroup_idx >= NR_CGROUP) {
-		mutex_unlock(&boost_eas);
+	if (cgroup_idx < 0 || cgroup_idx >= NR_CGROUP) {
 		pr_debug(" cgroup_idx >= NR_CGROUP, error\n");
 		perfmgr_trace_printk("uclamp_min", "cgroup_idx >= NR_CGROUP\n");
 		return -1;
 	}
 
-	uclamp_min[cgroup_idx][kicker] = value;
-	len += snprintf(msg + len, sizeof(msg) - len, "[%d] [%d] [%d]",
-			kicker, cgroup_idx, value);
-
-	/* ptr return error EIO:I/O error */
-	if (len < 0) {
-		perfmgr_trace_printk("uclamp_min", "return -EIO 1\n");
-		mutex_unlock(&boost_eas);
-		return -EIO;
-	}
-
-	for (i = 0; i < EAS_UCLAMP_MAX_KIR; i++) {
-		if (uclamp_min[cgroup_idx][i] == 0) {
-			clear_bit(i, &uclamp_policy_mask[cgroup_idx]);
-			continue;
-		}
-
-		final_uclamp = MAX(final_uclamp,
-			uclamp_min[cgroup_idx][i]);
-
-		set_bit(i, &uclamp_policy_mask[cgroup_idx]);
-	}
-
-	cur_uclamp_min[cgroup_idx] = check_uclamp_value(final_uclamp);
-
-	len += snprintf(msg + len, sizeof(msg) - len, "{%d} ", final_uclamp);
+	ret = boost_arb_update_item(&eas_uclamp_arb, kicker, cgroup_idx,
+			val, 0);
+	if (ret)
+		return ret;
 
-	/*ptr return error EIO:I/O error */
-	if (len < 0) {
-		perfmgr_trace_printk("uclamp_min", "return -EIO 2\n");
-		mutex_unlock(&boost_eas);
-		return -EIO;
-	}
-
-	len1 += snprintf(msg1 + len1, sizeof(msg1) - len1, "[0x %lx] ",
-			uclamp_policy_mask[cgroup_idx]);
+	boost_arb_lock(&eas_uclamp_arb);
+	final = cur_uclamp_min[cgroup_idx];
+	mask = uclamp_policy_mask[cgroup_idx];
+	boost_arb_unlock(&eas_uclamp_arb);
 
-	if (len1 < 0) {
-		perfmgr_trace_printk("uclamp_min", "return -EIO 3\n");
-		mutex_unlock(&boost_eas);
-		return -EIO;
-	}
-	if (debug_uclamp_min[cgroup_idx] == -1)
-		uclamp_min_pct_for_perf_idx(cgroup_idx,
-				cur_uclamp_min[cgroup_idx]);
+	len += scnprintf(msg + len, sizeof(msg) - len, "[%d] [%d] [%d]",
+			kicker, cgroup_idx, value);
+	len += scnprintf(msg + len, sizeof(msg) - len, "{%d} ", final);
+	len1 += scnprintf(msg1 + len1, sizeof(msg1) - len1, "[0x %lx] ",
+			mask);
 
 	if (strlen(msg) + strlen(msg1) < LOG_BUF_SIZE)
 		strncat(msg, msg1, strlen(msg1));
@@ -432,9 +493,8 @@ int update_eas_uclamp_min(int kicker, int cgroup_idx, int value)
 #ifdef CONFIG_TRACING
 	perfmgr_trace_printk("eas_ctrl (uclamp)", msg);
 #endif
-	mutex_unlock(&boost_eas);
 
-	return cur_uclamp_min[cgroup_idx];
+	return final;
 }
 #else
 int update_eas_uclamp_min(int kicker, int cgroup_idx, int value)
@@ -464,7 +524,7 @@ static ssize_t perfmgr_perfserv_fg_boost_proc_write(struct file *filp
 
 static int perfmgr_perfserv_fg_boost_proc_show(struct seq_file *m, void *v)
 {
-	seq_printf(m, "%d\n", boost_value[CGROUP_FG][EAS_KIR_PERF]);
+	seq_printf(m, "%d\n", eas_boost_req(CGROUP_FG, EAS_KIR_PERF));
 
 	return 0;
 }
@@ -473,7 +533,9 @@ static int perfmgr_perfserv_fg_boost_proc_show(struct seq_file *m, void *v)
 static int perfmgr_current_fg_boost_proc_show(struct seq_file *m, void *v)
 {
 #ifdef CONFIG_SCHED_TUNE
+	boost_arb_lock(&eas_boost_arb);
 	seq_printf(m, "%d\n", current_boost_value[CGROUP_FG]);
+	boost_arb_unlock(&eas_boost_arb);
 #else
 	seq_printf(m, "%d\n", -1);
 #endif
@@ -498,8 +560,11 @@ static ssize_t perfmgr_debug_fg_boost_proc_write(
 	debug_fix_boost = debug_boost_value[CGROUP_FG] > 0 ? 1:0;
 
 #ifdef CONFIG_SCHED_TUNE
-	boost_write_for_perf_idx(CGROUP_FG,
-			debug_boost_value[CGROUP_FG]);
+	if (debug_fix_boost)
+		boost_write_for_perf_idx(CGROUP_FG,
+				debug_boost_value[CGROUP_FG]);
+	else
+		boost_arb_reapply(&eas_boost_arb);
 #endif
 	return cnt;
 }
@@ -530,7 +595,7 @@ static ssize_t perfmgr_perfserv_bg_boost_proc_write(struct file *filp,
 
 static int perfmgr_perfserv_bg_boost_proc_show(struct seq_file *m, void *v)
 {
-	seq_printf(m, "%d\n", boost_value[CGROUP_BG][EAS_KIR_PERF]);
+	seq_printf(m, "%d\n", eas_boost_req(CGROUP_BG, EAS_KIR_PERF));
 
 	return 0;
 }
@@ -538,7 +603,9 @@ static int perfmgr_perfserv_bg_boost_proc_show(struct seq_file *m, void *v)
 static int perfmgr_current_bg_boost_proc_show(struct seq_file *m, void *v)
 {
 #ifdef CONFIG_SCHED_TUNE
+	boost_arb_lock(&eas_boost_arb);
 	seq_printf(m, "%d\n", current_boost_value[CGROUP_BG]);
+	boost_arb_unlock(&eas_boost_arb);
 #else
 	seq_printf(m, "%d\n", -1);
 #endif
@@ -561,8 +628,11 @@ static ssize_t perfmgr_debug_bg_boost_proc_write(
 	debug_fix_boost = debug_boost_value[CGROUP_BG] > 0 ? 1:0;
 
 #ifdef CONFIG_SCHED_TUNE
-	boost_write_for_perf_idx(CGROUP_BG,
-			debug_boost_value[CGROUP_BG]);
+	if (debug_fix_boost)
+		boost_write_for_perf_idx(CGROUP_BG,
+				debug_boost_value[CGROUP_BG]);
+	else
+		boost_arb_reapply(&eas_boost_arb);
 #endif
 
 	return cnt;
@@ -595,7 +665,7 @@ static ssize_t perfmgr_perfserv_ta_boost_proc_write(
 static int perfmgr_perfserv_ta_boost_proc_show(
 		struct seq_file *m, void *v)
 {
-	seq_printf(m, "%d\n", boost_value[CGROUP_TA][EAS_KIR_PERF]);
+	seq_printf(m, "%d\n", eas_boost_req(CGROUP_TA, EAS_KIR_PERF));
 
 	return 0;
 }
@@ -624,7 +694,7 @@ static int perfmgr_boot_boost_proc_show(struct seq_file *m, void *v)
 	int i;
 
 	for (i = 0; i < NR_CGROUP; i++)
-		seq_printf(m, "%d\n", boost_value[i][EAS_KIR_BOOT]);
+		seq_printf(m, "%d\n", eas_boost_req(i, EAS_KIR_BOOT));
 
 	return 0;
 }
@@ -632,7 +702,9 @@ static int perfmgr_boot_boost_proc_show(struct seq_file *m, void *v)
 static int perfmgr_current_ta_boost_proc_show(struct seq_file *m, void *v)
 {
 #ifdef CONFIG_SCHED_TUNE
+	boost_arb_lock(&eas_boost_arb);
 	seq_printf(m, "%d\n", current_boost_value[CGROUP_TA]);
+	boost_arb_unlock(&eas_boost_arb);
 #else
 	seq_printf(m, "%d\n", -1);
 #endif
@@ -656,8 +728,11 @@ static ssize_t perfmgr_debug_ta_boost_proc_write(
 	debug_fix_boost = debug_boost_value[CGROUP_TA] > 0 ? 1:0;
 
 #ifdef CONFIG_SCHED_TUNE
-	boost_write_for_perf_idx(CGROUP_TA,
-			debug_boost_value[CGROUP_TA]);
+	if (debug_fix_boost)
+		boost_write_for_perf_idx(CGROUP_TA,
+				debug_boost_value[CGROUP_TA]);
+	else
+		boost_arb_reapply(&eas_boost_arb);
 #endif
 
 	return cnt;
@@ -692,7 +767,8 @@ static ssize_t perfmgr_perfserv_uclamp_min_proc_write(struct file *filp
 
 static int perfmgr_perfserv_uclamp_min_proc_show(struct seq_file *m, void *v)
 {
-	seq_printf(m, "%d\n", uclamp_min[CGROUP_ROOT][EAS_UCLAMP_KIR_PERF]);
+	seq_printf(m, "%d\n",
+		eas_uclamp_req(CGROUP_ROOT, EAS_UCLAMP_KIR_PERF));
 
 	return 0;
 }
@@ -701,7 +777,9 @@ static int perfmgr_perfserv_uclamp_min_proc_show(struct seq_file *m, void *v)
 static int perfmgr_current_uclamp_min_proc_show(struct seq_file *m, void *v)
 {
 #if defined(CONFIG_UCLAMP_TASK_GROUP) && defined(CONFIG_SCHED_TUNE)
+	boost_arb_lock(&eas_uclamp_arb);
 	seq_printf(m, "%d\n", cur_uclamp_min[CGROUP_ROOT]);
+	boost_arb_unlock(&eas_uclamp_arb);
 #else
 	seq_printf(m, "%d\n", -1);
 #endif
@@ -728,8 +806,7 @@ static ssize_t perfmgr_debug_uclamp_min_proc_write(
 		uclamp_min_pct_for_perf_idx(CGROUP_ROOT,
 			debug_uclamp_min[CGROUP_ROOT]);
 	else
-		uclamp_min_pct_for_perf_idx(CGROUP_ROOT,
-			cur_uclamp_min[CGROUP_ROOT]);
+		boost_arb_reapply(&eas_uclamp_arb);
 #endif
 	return cnt;
 }
@@ -760,7 +837,7 @@ static ssize_t perfmgr_perfserv_fg_uclamp_min_proc_write(struct file *filp
 
 static int perfmgr_perfserv_fg_uclamp_min_proc_show(struct seq_file *m, void *v)
 {
-	seq_printf(m, "%d\n", uclamp_min[CGROUP_FG][EAS_UCLAMP_KIR_PERF]);
+	seq_printf(m, "%d\n", eas_uclamp_req(CGROUP_FG, EAS_UCLAMP_KIR_PERF));
 
 	return 0;
 }
@@ -769,7 +846,9 @@ static int perfmgr_perfserv_fg_uclamp_min_proc_show(struct seq_file *m, void *v)
 static int perfmgr_current_fg_uclamp_min_proc_show(struct seq_file *m, void *v)
 {
 #if defined(CONFIG_UCLAMP_TASK_GROUP) && defined(CONFIG_SCHED_TUNE)
+	boost_arb_lock(&eas_uclamp_arb);
 	seq_printf(m, "%d\n", cur_uclamp_min[CGROUP_FG]);
+	boost_arb_unlock(&eas_uclamp_arb);
 #else
 	seq_printf(m, "%d\n", -1);
 #endif
@@ -796,8 +875,7 @@ static ssize_t perfmgr_debug_fg_uclamp_min_proc_write(
 		uclamp_min_pct_for_perf_idx(CGROUP_FG,
 			debug_uclamp_min[CGROUP_FG]);
 	else
-		uclamp_min_pct_for_perf_idx(CGROUP_FG,
-			cur_uclamp_min[CGROUP_FG]);
+		boost_arb_reapply(&eas_uclamp_arb);
 #endif
 	return cnt;
 }
@@ -828,7 +906,7 @@ static ssize_t perfmgr_perfserv_bg_uclamp_min_proc_write(struct file *filp
 
 static int perfmgr_perfserv_bg_uclamp_min_proc_show(struct seq_file *m, void *v)
 {
-	seq_printf(m, "%d\n", uclamp_min[CGROUP_BG][EAS_UCLAMP_KIR_PERF]);
+	seq_printf(m, "%d\n", eas_uclamp_req(CGROUP_BG, EAS_UCLAMP_KIR_PERF));
 
 	return 0;
 }
@@ -837,7 +915,9 @@ static int perfmgr_perfserv_bg_uclamp_min_proc_show(struct seq_file *m, void *v)
 static int perfmgr_current_bg_uclamp_min_proc_show(struct seq_file *m, void *v)
 {
 #if defined(CONFIG_UCLAMP_TASK_GROUP) && defined(CONFIG_SCHED_TUNE)
+	boost_arb_lock(&eas_uclamp_arb);
 	seq_printf(m, "%d\n", cur_uclamp_min[CGROUP_BG]);
+	boost_arb_unlock(&eas_uclamp_arb);
 #else
 	seq_printf(m, "%d\n", -1);
 #endif
@@ -864,8 +944,7 @@ static ssize_t perfmgr_debug_bg_uclamp_min_proc_write(
 		uclamp_min_pct_for_perf_idx(CGROUP_BG,
 			debug_uclamp_min[CGROUP_BG]);
 	else
-		uclamp_min_pct_for_perf_idx(CGROUP_BG,
-			cur_uclamp_min[CGROUP_BG]);
+		boost_arb_reapply(&eas_uclamp_arb);
 #endif
 	return cnt;
 }
@@ -896,7 +975,7 @@ static ssize_t perfmgr_perfserv_ta_uclamp_min_proc_write(struct file *filp
 
 static int perfmgr_perfserv_ta_uclamp_min_proc_show(struct seq_file *m, void *v)
 {
-	seq_printf(m, "%d\n", uclamp_min[CGROUP_TA][EAS_UCLAMP_KIR_PERF]);
+	seq_printf(m, "%d\n", eas_uclamp_req(CGROUP_TA, EAS_UCLAMP_KIR_PERF));
 
 	return 0;
 }
@@ -905,7 +984,9 @@ static int perfmgr_perfserv_ta_uclamp_min_proc_show(struct seq_file *m, void *v)
 static int perfmgr_current_ta_uclamp_min_proc_show(struct seq_file *m, void *v)
 {
 #if defined(CONFIG_UCLAMP_TASK_GROUP) && defined(CONFIG_SCHED_TUNE)
+	boost_arb_lock(&eas_uclamp_arb);
 	seq_printf(m, "%d\n", cur_uclamp_min[CGROUP_TA]);
+	boost_arb_unlock(&eas_uclamp_arb);
 #else
 	seq_printf(m, "%d\n", -1);
 #endif
@@ -932,8 +1013,7 @@ static ssize_t perfmgr_debug_ta_uclamp_min_proc_write(
 		uclamp_min_pct_for_perf_idx(CGROUP_TA,
 			debug_uclamp_min[CGROUP_TA]);
 	else
-		uclamp_min_pct_for_perf_idx(CGROUP_TA,
-			cur_uclamp_min[CGROUP_TA]);
+		boost_arb_reapply(&eas_uclamp_arb);
 #endif
 	return cnt;
 }
@@ -1253,6 +1333,43 @@ static int perfmgr_perfmgr_log_proc_show(struct seq_file *m, void *v)
 	return 0;
 }
 
+static ssize_t perfmgr_arb_window_us_proc_write(
+		struct file *filp, const char __user *ubuf,
+		size_t cnt, loff_t *pos)
+{
+	int data = 0;
+
+	int rv = check_proc_write(&data, ubuf, cnt);
+
+	if (rv != 0)
+		return rv;
+
+	data = clamp(data, 0, 100000);
+	boost_arb_lock(&eas_boost_arb);
+	eas_boost_arb.window_us = data;
+	boost_arb_unlock(&eas_boost_arb);
+	boost_arb_lock(&eas_uclamp_arb);
+	eas_uclamp_arb.window_us = data;
+	boost_arb_unlock(&eas_uclamp_arb);
+	boost_arb_flush(&eas_boost_arb);
+	boost_arb_flush(&eas_uclamp_arb);
+
+	return cnt;
+}
+
+static int perfmgr_arb_window_us_proc_show(struct seq_file *m, void *v)
+{
+	seq_printf(m, "%u\n", eas_boost_arb.window_us);
+	return 0;
+}
+
+static int perfmgr_arb_history_proc_show(struct seq_file *m, void *v)
+{
+	boost_arb_show(&eas_boost_arb, m);
+	boost_arb_show(&eas_uclamp_arb, m);
+	return 0;
+}
+
 /* boost value */
 PROC_FOPS_RW(perfserv_fg_boost);
 PROC_FOPS_RO(current_fg_boost);
@@ -1292,14 +1409,13 @@ PROC_FOPS_RW(m_sched_migrate_cost_n);
 PROC_FOPS_RW(sched_big_task_rotation);
 PROC_FOPS_RW(sched_stune_task_thresh);
 PROC_FOPS_RW(perfmgr_log);
+PROC_FOPS_RW(arb_window_us);
+PROC_FOPS_RO(arb_history);
 
 /*******************************************/
 int eas_ctrl_init(struct proc_dir_entry *parent)
 {
 	int i, ret = 0;
-#if defined(CONFIG_SCHED_TUNE)
-	int j;
-#endif
 	struct proc_dir_entry *boost_dir = NULL;
 
 	struct pentry {
@@ -1342,6 +1458,8 @@ int eas_ctrl_init(struct proc_dir_entry *parent)
 
 		/* log */
 		PROC_ENTRY(perfmgr_log),
+		PROC_ENTRY(arb_window_us),
+		PROC_ENTRY(arb_history),
 		/*--ext_launch--*/
 		PROC_ENTRY(perfserv_ext_launch_mon),
 		/*--sched migrate cost n--*/
@@ -1350,6 +1468,16 @@ int eas_ctrl_init(struct proc_dir_entry *parent)
 		PROC_ENTRY(sched_stune_task_thresh),
 	};
 	mutex_init(&boost_eas);
+
+	/* requests start unset, boost and uclamp 0 */
+	ret = boost_arb_init(&eas_boost_arb);
+	if (!ret)
+		ret = boost_arb_init(&eas_uclamp_arb);
+	if (ret) {
+		pr_debug("%s(), arbiter init failed %d\n", __func__, ret);
+		return ret;
+	}
+
 	boost_dir = proc_mkdir("eas_ctrl", parent);
 
 	if (!boost_dir)
@@ -1366,23 +1494,10 @@ int eas_ctrl_init(struct proc_dir_entry *parent)
 		}
 	}
 
-#if defined(CONFIG_SCHED_TUNE)
-	/* boost value */
-	for (i = 0; i < NR_CGROUP; i++) {
-		current_boost_value[i] = 0;
-		for (j = 0; j < EAS_MAX_KIR; j++)
-			boost_value[i][j] = 0;
-	}
-#endif
-
 #if defined(CONFIG_UCLAMP_TASK_GROUP) && defined(CONFIG_SCHED_TUNE)
 	/* uclamp */
-	for (i = 0; i < NR_CGROUP; i++) {
-		cur_uclamp_min[i] = 0;
+	for (i = 0; i < NR_CGROUP; i++)
 		debug_uclamp_min[i] = -1;
-		for (j = 0; j < EAS_UCLAMP_MAX_KIR; j++)
-			uclamp_min[i][j] = 0;
-	}
 #endif
 
 	perf_sched_big_task_rotation = 0;
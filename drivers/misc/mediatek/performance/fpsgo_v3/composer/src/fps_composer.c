@@ -27,6 +27,7 @@
 #include <linux/sched/task.h>
 
 #include <fpsgo_common.h>
+#include <mt-plat/mtk_perfobserver.h>
 
 #include "fpsgo_base.h"
 #include "fpsgo_common.h"
@@ -306,6 +307,7 @@ void fpsgo_ctrl2comp_enqueue_end(int pid,
 	int check_render;
 	unsigned long long running_time = 0;
 	unsigned long long mid = 0;
+	struct pob_fpsgo_frame_info pffi;
 	int ret;
 
 	FPSGO_COM_TRACE("%s pid[%d] id %llu", __func__, pid, identifier);
@@ -368,6 +370,9 @@ void fpsgo_ctrl2comp_enqueue_end(int pid,
 
 		fpsgo_comp2fbt_frame_start(f_render,
 				enqueue_end_time);
+		pffi.tskid = pid;
+		pffi.ts = enqueue_end_time;
+		pob_fpsgo_frame_update(POB_FPSGO_FRAME_START, &pffi);
 		fpsgo_comp2fstb_queue_time_update(pid, f_render->frame_type,
 			enqueue_end_time,
 			f_render->buffer_id, f_render->api);
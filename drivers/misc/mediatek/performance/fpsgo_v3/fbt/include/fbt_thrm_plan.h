@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __FBT_THRM_PLAN_H__
+#define __FBT_THRM_PLAN_H__
+
+#include <linux/seq_file.h>
+#include <mt-plat/mtk_thermal_headroom.h>
+
+struct fbt_thrm_plan {
+	/* tunables */
+	unsigned int idle_mw;	/* power not spent on frames */
+	unsigned int horizon_ms;	/* heat left is spread over it */
+	unsigned int down_fps;	/* fastest fall, fps per second */
+	unsigned int up_fps;	/* fastest rise, fps per second */
+	unsigned int margin;	/* fps the budget must exceed to rise */
+	unsigned int min_fps;
+
+	/* state */
+	unsigned int frame_uj;	/* learnt energy of a frame */
+	unsigned int mfps;	/* plan in 1/1000 fps, 0 when not limiting */
+	unsigned int fps;	/* last target handed out */
+	long long budget;	/* mW, smoothed */
+	unsigned int allow;	/* fps the budget would allow */
+	unsigned long long hr_ts;
+	unsigned long long nr_change;
+};
+
+void fbt_thrm_plan_init(struct fbt_thrm_plan *p);
+unsigned int fbt_thrm_plan_update(struct fbt_thrm_plan *p,
+	const struct mtk_thermal_headroom *hr, unsigned int req_fps);
+void fbt_thrm_plan_show(struct seq_file *m, struct fbt_thrm_plan *p);
+
+#endif
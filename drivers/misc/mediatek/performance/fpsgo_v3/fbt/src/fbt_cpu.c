@@ -69,6 +69,7 @@
 #include "mini_top.h"
 #include "fps_composer.h"
 #include "fbt_fteh.h"
+#include "fbt_thrm_plan.h"
 #include "eara_job.h"
 #include "mtk_upower.h"
 
@@ -83,6 +84,7 @@
 #define TIME_MS_TO_NS  1000000ULL
 #define MAX_DEP_NUM 30
 #define LOADING_WEIGHT 50
+#define THRM_PLAN_KEEP_FRAMES 10
 
 #define SEQ_printf(m, x...)\
 do {\
@@ -177,6 +179,10 @@ static int sync_flag;
 static int fbt_sync_flag_enable;
 static int ultra_rescue;
 static int loading_policy;
+static int thrm_plan_enable;
+static struct fbt_thrm_plan thrm_plan;
+static int thrm_plan_pid;
+static int thrm_plan_miss;
 
 static int vsync_period;
 
@@ -1968,11 +1974,54 @@ static long fbt_get_loading(struct render_info *thr, unsigned long long ts)
 	return loading;
 }
 
+/*
+ * Target fps the thermal headroom can carry, see fbt_thrm_plan.c. The plan
+ * learns the energy of one renderer's frames, so it is only run for the
+ * renderer that sets the boost (max_blc_pid); the others keep their own
+ * target. Renderers taking turns at max_blc_pid would restart it on every
+ * frame, so it only moves to another renderer once that one has set the
+ * boost for THRM_PLAN_KEEP_FRAMES frames without the planned one.
+ */
+static int fbt_thrm_plan_fps(struct render_info *thr, int target_fps)
+{
+	struct mtk_thermal_headroom hr;
+	int has_hr, fps;
+
+	if (!thrm_plan_enable || target_fps <= 0)
+		return target_fps;
+
+	has_hr = !mtk_thermal_get_headroom(&hr);
+
+	mutex_lock(&fbt_mlock);
+	if (thr->pid != max_blc_pid) {
+		mutex_unlock(&fbt_mlock);
+		return target_fps;
+	}
+	if (thr->pid != thrm_plan_pid) {
+		if (thrm_plan_pid && ++thrm_plan_miss < THRM_PLAN_KEEP_FRAMES) {
+			mutex_unlock(&fbt_mlock);
+			return target_fps;
+		}
+		fbt_thrm_plan_init(&thrm_plan);
+		thrm_plan_pid = thr->pid;
+	}
+	thrm_plan_miss = 0;
+	fps = fbt_thrm_plan_update(&thrm_plan, has_hr ? &hr : NULL,
+			target_fps);
+	mutex_unlock(&fbt_mlock);
+
+	if (has_hr)
+		fpsgo_systrace_c_fbt_gm(-100, hr.burst_mj, "thrm_burst_mj");
+	fpsgo_systrace_c_fbt(thr->pid, fps, "thrm_plan_fps");
+
+	return fps;
+}
+
 static void fbt_frame_start(struct render_info *thr, unsigned long long ts)
 {
 	struct fbt_boost_info *boost;
 	unsigned long long runtime;
-	int targettime, targetfps;
+	int targettime, targetfps, planfps;
 	unsigned int limited_cap;
 	int blc_wt = 0;
 	long loading = 0L;
@@ -1990,6 +2039,12 @@ static void fbt_frame_start(struct render_info *thr, unsigned long long ts)
 	if (!targetfps)
 		targetfps = TARGET_UNLIMITED_FPS;
 
+	planfps = fbt_thrm_plan_fps(thr, targetfps);
+	if (planfps < targetfps) {
+		targetfps = planfps;
+		targettime = max(targettime, FBTCPU_SEC_DIVIDER / targetfps);
+	}
+
 	fpsgo_systrace_c_fbt(thr->pid, targetfps, "target_fps");
 	fpsgo_systrace_c_fbt(thr->pid, targettime, "target_time");
 
@@ -2924,6 +2979,42 @@ static ssize_t fbt_ultra_rescue_write(struct file *flip,
 
 FBT_DEBUGFS_ENTRY(ultra_rescue);
 
+static int fbt_thermal_plan_show(struct seq_file *m, void *unused)
+{
+	mutex_lock(&fbt_mlock);
+	SEQ_printf(m, "enable %d pid %d\n", thrm_plan_enable, thrm_plan_pid);
+	fbt_thrm_plan_show(m, &thrm_plan);
+	mutex_unlock(&fbt_mlock);
+
+	return 0;
+}
+
+static ssize_t fbt_thermal_plan_write(struct file *flip,
+			const char *ubuf, size_t cnt, loff_t *data)
+{
+	int val;
+	int ret;
+
+	ret = kstrtoint_from_user(ubuf, cnt, 0, &val);
+	if (ret)
+		return ret;
+
+	mutex_lock(&fbt_mlock);
+
+	if (!!val != thrm_plan_enable) {
+		fbt_thrm_plan_init(&thrm_plan);
+		thrm_plan_pid = 0;
+		thrm_plan_miss = 0;
+	}
+	thrm_plan_enable = !!val;
+
+	mutex_unlock(&fbt_mlock);
+
+	return cnt;
+}
+
+FBT_DEBUGFS_ENTRY(thermal_plan);
+
 void __exit fbt_cpu_exit(void)
 {
 	minitop_exit();
@@ -2972,6 +3063,7 @@ int __init fbt_cpu_init(void)
 	sync_flag = -1;
 	fbt_sync_flag_enable = 1;
 	boost_ta = fbt_get_default_boost_ta();
+	fbt_thrm_plan_init(&thrm_plan);
 
 	cluster_num = arch_get_nr_clusters();
 	max_cap_cluster = min((cluster_num - 1), 0);
@@ -3044,6 +3136,11 @@ int __init fbt_cpu_init(void)
 					fbt_debugfs_dir,
 					NULL,
 					&fbt_ultra_rescue_fops);
+			debugfs_create_file("thermal_plan",
+					0664,
+					fbt_debugfs_dir,
+					NULL,
+					&fbt_thermal_plan_fops);
 		}
 	}
 
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Thermal frame rate plan
+ *
+ * Picks the target fps the thermal headroom can carry, so that FPSGO
+ * walks the frame rate down ahead of the limit rather than boosting into
+ * it and getting cut by the coolers.
+ *
+ * The energy of a frame is learnt from the power drawn at the rate being
+ * run. The budget is the sustainable power plus the heat left below the
+ * limit spread over horizon_ms: far from the limit that is plenty, at the
+ * limit it is exactly what holds there, and in between holding it brings
+ * the temperature onto the limit without overshoot. Past the limit the
+ * heat to shed comes off the budget instead. The plan follows the
+ * budget at a bounded rate in both directions, and only rises once the
+ * budget clears it by a margin.
+ */
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+
+#include "fbt_thrm_plan.h"
+
+#define PLAN_DEF_IDLE_MW	(500)
+#define PLAN_DEF_HORIZON_MS	(30000)
+#define PLAN_DEF_DOWN_FPS	(4)
+#define PLAN_DEF_UP_FPS		(1)
+#define PLAN_DEF_MARGIN		(2)
+#define PLAN_DEF_MIN_FPS	(20)
+/* a gap longer than this does not buy a longer step */
+#define PLAN_MAX_STEP_MS	(1000)
+
+void fbt_thrm_plan_init(struct fbt_thrm_plan *p)
+{
+	memset(p, 0, sizeof(*p));
+	p->idle_mw = PLAN_DEF_IDLE_MW;
+	p->horizon_ms = PLAN_DEF_HORIZON_MS;
+	p->down_fps = PLAN_DEF_DOWN_FPS;
+	p->up_fps = PLAN_DEF_UP_FPS;
+	p->margin = PLAN_DEF_MARGIN;
+	p->min_fps = PLAN_DEF_MIN_FPS;
+}
+EXPORT_SYMBOL(fbt_thrm_plan_init);
+
+static void fbt_thrm_plan_learn(struct fbt_thrm_plan *p,
+	const struct mtk_thermal_headroom *hr, unsigned int fps)
+{
+	unsigned int e;
+
+	if (hr->power <= p->idle_mw)
+		return;
+
+	e = (hr->power - p->idle_mw) * 1000 / fps;
+	p->frame_uj = p->frame_uj ? (p->frame_uj * 7 + e) / 8 : e;
+}
+
+static unsigned int fbt_thrm_plan_allow(struct fbt_thrm_plan *p,
+	const struct mtk_thermal_headroom *hr, unsigned int req_fps,
+	unsigned int dt_ms)
+{
+	s64 budget;
+	unsigned int fps;
+
+	budget = hr->sustain + div_s64((s64)hr->burst_mj * 1000,
+				max(p->horizon_ms, 1U));
+	/* sensor noise comes through the heat left, smooth it out */
+	p->budget = dt_ms ? div_s64(p->budget * 7 + budget, 8) : budget;
+	budget = p->budget;
+	if (budget <= p->idle_mw)
+		fps = 0;
+	else
+		fps = min_t(u64, div_u64((budget - p->idle_mw) * 1000,
+					p->frame_uj), req_fps);
+
+	return max(fps, min(p->min_fps, req_fps));
+}
+
+/*
+ * Target fps for a frame that asks for req_fps, with hr the latest
+ * budget or NULL when there is none. The plan only moves on a new
+ * budget sample.
+ */
+unsigned int fbt_thrm_plan_update(struct fbt_thrm_plan *p,
+	const struct mtk_thermal_headroom *hr, unsigned int req_fps)
+{
+	unsigned int dt_ms, allow, fps;
+	u64 m, req_m = (u64)req_fps * 1000;
+
+	if (!req_fps)
+		return req_fps;
+
+	if (!hr) {
+		p->mfps = 0;
+		p->hr_ts = 0;
+		goto out;
+	}
+
+	if (hr->ts == p->hr_ts)
+		goto out;
+
+	dt_ms = p->hr_ts && hr->ts > p->hr_ts ?
+		min_t(u64, div_u64(hr->ts - p->hr_ts, NSEC_PER_MSEC),
+			PLAN_MAX_STEP_MS) : 0;
+	p->hr_ts = hr->ts;
+
+	fbt_thrm_plan_learn(p, hr, p->fps ? p->fps : req_fps);
+	if (!p->frame_uj)
+		goto out;
+
+	allow = fbt_thrm_plan_allow(p, hr, req_fps, dt_ms);
+	p->allow = allow;
+
+	/* a lower request is followed at once */
+	m = p->mfps ? min_t(u64, p->mfps, req_m) : req_m;
+	if ((u64)allow * 1000 < m)
+		m = max_t(u64, (u64)allow * 1000,
+			m - min_t(u64, m, (u64)p->down_fps * dt_ms));
+	else if (allow == req_fps || allow >= div_u64(m, 1000) + p->margin)
+		m = min_t(u64, (u64)allow * 1000, m + (u64)p->up_fps * dt_ms);
+
+	p->mfps = m >= req_m ? 0 : m;
+
+out:
+	fps = p->mfps ? max_t(unsigned int, p->mfps / 1000, 1) : req_fps;
+	if (fps != p->fps)
+		p->nr_change++;
+	p->fps = fps;
+
+	return fps;
+}
+EXPORT_SYMBOL(fbt_thrm_plan_update);
+
+void fbt_thrm_plan_show(struct seq_file *m, struct fbt_thrm_plan *p)
+{
+	seq_printf(m, "idle_mw %u horizon_ms %u down_fps %u up_fps %u\n",
+		p->idle_mw, p->horizon_ms, p->down_fps, p->up_fps);
+	seq_printf(m, "margin %u min_fps %u\n", p->margin, p->min_fps);
+	seq_printf(m, "frame_uj %u allow %u fps %u limiting %d changes %llu\n",
+		p->frame_uj, p->allow, p->fps, !!p->mfps, p->nr_change);
+}
+EXPORT_SYMBOL(fbt_thrm_plan_show);
@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Thermal frame rate plan, long run emulation
+ *
+ * A thermal zone with a single RC is heated by a game for sim_min minutes
+ * of virtual time, stepped at the ATM period. The game's power grows a
+ * little faster than its frame rate, the sensor is noisy, the ambient is
+ * not the one the headroom model starts from, and part of the power is
+ * not seen by the OPP power ATM reports. A trip cooler stands in for the
+ * cooler tables: past trip it cuts the frame rate to trip_fps until the
+ * zone has cooled by trip_hyst.
+ *
+ * Each trace runs with the cooler alone and with the plan in front of
+ * it. The plan has to hold frame rate and temperature steady without the
+ * cooler ever tripping, and without giving up frame rate on average.
+ */
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/string.h>
+
+#include <mt-plat/mtk_thermal_headroom.h>
+#include "fbt_thrm_plan.h"
+
+#define TAG "[FBT_THRM_PLAN_SIM]"
+
+static unsigned int sim_min = 30;
+module_param(sim_min, uint, 0444);
+MODULE_PARM_DESC(sim_min, "Minutes of virtual time per run");
+
+static unsigned int step_ms = 100;
+module_param(step_ms, uint, 0444);
+MODULE_PARM_DESC(step_ms, "ATM period");
+
+static int ambient = 35000;
+module_param(ambient, int, 0444);
+MODULE_PARM_DESC(ambient, "Ambient of the emulated zone, m°C");
+
+static unsigned int noise = 300;
+module_param(noise, uint, 0444);
+MODULE_PARM_DESC(noise, "Sensor noise, m°C peak");
+
+static int trip = 65000;
+module_param(trip, int, 0444);
+MODULE_PARM_DESC(trip, "Cooler trip and ATM target, m°C");
+
+static unsigned int trip_hyst = 3000;
+module_param(trip_hyst, uint, 0444);
+MODULE_PARM_DESC(trip_hyst, "Cooler release below trip, m°C");
+
+static unsigned int trip_fps = 30;
+module_param(trip_fps, uint, 0444);
+MODULE_PARM_DESC(trip_fps, "Frame rate the cooler cuts to");
+
+/* the zone: what the headroom model assumes, on another ambient */
+#define SIM_R			(10000)
+#define SIM_TAU_MS		(40000)
+#define SIM_MODEL_AMBIENT	(30000)
+#define SIM_OBS_MS		(4 * SIM_TAU_MS)
+
+/* the game: power = idle + fps x frame, frame energy grows with fps */
+#define SIM_IDLE_MW		(600)
+#define SIM_FRAME_UJ		(60000)
+#define SIM_UNSEEN_MW		(300)
+/* a frame rate move larger than this in one step is a jerk */
+#define SIM_JERK_FPS		(5)
+
+struct sim_scene {
+	unsigned int until_min;
+	unsigned int req_fps;
+	unsigned int load;	/* percent */
+};
+
+enum sim_policy {
+	SIM_TRIP,
+	SIM_PLAN,
+	NR_SIM_POLICY
+};
+
+static const char * const sim_policy_name[NR_SIM_POLICY] = {
+	"trip", "plan"
+};
+
+struct sim_result {
+	unsigned int mean;	/* 1/1000 fps, over the second half */
+	unsigned int stddev;	/* 1/1000 fps, over the second half */
+	unsigned int nr_jerk;
+	unsigned int nr_trip;
+	int max_temp;
+	int swing;		/* max - min over the second half */
+	int ambient;		/* as observed at the end */
+	unsigned long long nr_change;
+};
+
+static struct fbt_thrm_plan sim_plan;
+static struct thermal_hr sim_hr;
+static u32 sim_seed;
+
+static u32 sim_rand(void)
+{
+	sim_seed = sim_seed * 1103515245 + 12345;
+	return sim_seed >> 16;
+}
+
+/*------------------------traces------------------------*/
+
+/* each starts in the lobby of the game, long enough to observe ambient */
+static const struct sim_scene trace_steady[] = {
+	{ 3, 30, 60 },
+	{ ~0U, 60, 100 },
+};
+
+/* heavier levels, a menu at half rate and back to the lobby */
+static const struct sim_scene trace_scenes[] = {
+	{ 3, 30, 60 },
+	{ 5, 60, 100 },
+	{ 10, 60, 130 },
+	{ 12, 60, 100 },
+	{ 13, 30, 100 },
+	{ 18, 60, 120 },
+	{ 20, 30, 60 },
+	{ 25, 60, 130 },
+	{ ~0U, 60, 100 },
+};
+
+static const struct {
+	const char *name;
+	const struct sim_scene *scene;
+} sim_trace[] = {
+	{ "steady", trace_steady },
+	{ "scenes", trace_scenes },
+};
+
+/*------------------------replay------------------------*/
+
+static unsigned int sim_power(unsigned int fps, unsigned int load)
+{
+	u64 frame = (u64)SIM_FRAME_UJ * load / 100 * (fps + 60) / 120;
+
+	return SIM_IDLE_MW + div_u64(frame * fps, 1000);
+}
+
+static void sim_run(const struct sim_scene *scene, enum sim_policy pol,
+		struct sim_result *r)
+{
+	struct thermal_rc zone = {
+		.r = SIM_R,
+		.tau_ms = SIM_TAU_MS,
+		.ambient = ambient,
+	};
+	struct mtk_thermal_headroom *hr = &sim_hr.now;
+	unsigned int nr_step = sim_min * 60 * 1000 / step_ms;
+	unsigned int i, fps, prev_fps = 0, prev_req = 0, power, nr_half = 0;
+	int temp = ambient, sensed, lo = INT_MAX, hi = INT_MIN;
+	bool tripped = false;
+	u64 now = 0, sum = 0, sum_sq = 0, mean;
+
+	memset(r, 0, sizeof(*r));
+	r->max_temp = INT_MIN;
+	thermal_hr_init(&sim_hr, SIM_R, SIM_TAU_MS, SIM_MODEL_AMBIENT,
+			SIM_OBS_MS);
+	fbt_thrm_plan_init(&sim_plan);
+
+	for (i = 0; i < nr_step; i++, now += (u64)step_ms * NSEC_PER_MSEC) {
+		while (i * step_ms >= scene->until_min * 60 * 1000)
+			scene++;
+
+		sensed = temp + (int)(sim_rand() % (2 * noise + 1)) - noise;
+
+		if (sensed >= trip && !tripped) {
+			tripped = true;
+			r->nr_trip++;
+		} else if (sensed < trip - (int)trip_hyst) {
+			tripped = false;
+		}
+
+		fps = scene->req_fps;
+		if (pol == SIM_PLAN)
+			fps = fbt_thrm_plan_update(&sim_plan, hr, fps);
+		if (tripped)
+			fps = min(fps, trip_fps);
+
+		power = sim_power(fps, scene->load);
+		temp = thermal_rc_step(&zone, temp, power, step_ms);
+		thermal_hr_update(&sim_hr, sensed, trip,
+				  power - SIM_UNSEEN_MW, now);
+
+		if (i && fps != prev_fps)
+			r->nr_change++;
+		if (i && scene->req_fps == prev_req &&
+		    abs((int)fps - (int)prev_fps) > SIM_JERK_FPS)
+			r->nr_jerk++;
+		prev_fps = fps;
+		prev_req = scene->req_fps;
+
+		r->max_temp = max(r->max_temp, temp);
+		if (i >= nr_step / 2) {
+			lo = min(lo, temp);
+			hi = max(hi, temp);
+			sum += fps;
+			sum_sq += fps * fps;
+			nr_half++;
+		}
+	}
+
+	mean = div_u64(sum * 1000, nr_half);
+	r->mean = mean;
+	r->stddev = int_sqrt(div_u64(sum_sq * 1000000, nr_half) - mean * mean);
+	r->swing = hi - lo;
+	r->ambient = sim_hr.rc.ambient;
+}
+
+static int __init fbt_thrm_plan_sim_init(void)
+{
+	struct sim_result r[NR_SIM_POLICY];
+	int i, p, ret = 0;
+	int seen_ambient = ambient + SIM_UNSEEN_MW * SIM_R / 1000;
+
+	if (sim_min < 10 || !step_ms || step_ms > 1000 || trip <= ambient)
+		return -EINVAL;
+
+	for (i = 0; i < ARRAY_SIZE(sim_trace); i++) {
+		for (p = 0; p < NR_SIM_POLICY; p++) {
+			sim_seed = 0x5eed;
+			sim_run(sim_trace[i].scene, p, &r[p]);
+			pr_info(TAG"%-8s %-6s fps %u.%03u sd %u.%03u jerk %u trip %u\n",
+				sim_trace[i].name, sim_policy_name[p],
+				r[p].mean / 1000, r[p].mean % 1000,
+				r[p].stddev / 1000, r[p].stddev % 1000,
+				r[p].nr_jerk, r[p].nr_trip);
+			pr_info(TAG"%-8s %-6s max %d swing %d ambient %d changes %llu\n",
+				sim_trace[i].name, sim_policy_name[p],
+				r[p].max_temp, r[p].swing, r[p].ambient,
+				r[p].nr_change);
+		}
+
+		/*
+		 * The cooler saws between full and cut rate. The plan must
+		 * stay under it without jerks and be as fast on average, hold
+		 * frame rate and temperature flat once a steady game has
+		 * settled, and learn the ambient the zone really behaves like.
+		 */
+		if (r[SIM_PLAN].nr_trip || r[SIM_PLAN].nr_jerk ||
+		    r[SIM_PLAN].max_temp > trip ||
+		    r[SIM_PLAN].mean + 1000 < r[SIM_TRIP].mean ||
+		    (sim_trace[i].scene == trace_steady &&
+		     (r[SIM_PLAN].stddev > 1500 || r[SIM_PLAN].swing > 1000)) ||
+		    abs(r[SIM_PLAN].ambient - seen_ambient) > 1500) {
+			pr_info(TAG"FAIL: %s\n", sim_trace[i].name);
+			ret = -EINVAL;
+		}
+	}
+
+	if (!ret)
+		pr_info(TAG"PASS\n");
+
+	return ret;
+}
+
+static void __exit fbt_thrm_plan_sim_exit(void)
+{
+}
+
+module_init(fbt_thrm_plan_sim_init);
+module_exit(fbt_thrm_plan_sim_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Thermal frame rate plan long run emulation");
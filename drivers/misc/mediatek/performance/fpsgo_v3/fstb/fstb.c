@@ -1301,6 +1301,13 @@ static int calculate_fps_limit(struct FSTB_FRAME_INFO *iter, int target_fps)
 	return ret_fps;
 }
 
+/* one fstb_fps_stats() pass is dispatched to pob in a single batch */
+static struct pob_ntf_rec fstb_pob_rec[16];
+static struct pob_ntf_batch fstb_pob_batch = {
+	.max = ARRAY_SIZE(fstb_pob_rec),
+	.rec = fstb_pob_rec,
+};
+
 static int cal_target_fps(struct FSTB_FRAME_INFO *iter)
 {
 	long long target_limit = max_fps_limit;
@@ -1317,7 +1324,8 @@ static int cal_target_fps(struct FSTB_FRAME_INFO *iter)
 		pffi.quantile_weighted_cpu_time = cur_cpu_time;
 		pffi.quantile_weighted_gpu_time = cur_gpu_time;
 
-		pob_fpsgo_fstb_stats_update(POB_FPSGO_FSTB_STATS_UPDATE, &pffi);
+		pob_ntf_batch_add(&fstb_pob_batch, POB_NTF_FPSGO,
+			POB_FPSGO_FSTB_STATS_UPDATE, &pffi, sizeof(pffi));
 	}
 
 	if (iter->new_info == 1) {
@@ -1465,7 +1473,8 @@ static void fstb_fps_stats(struct work_struct *work)
 
 	mutex_lock(&fstb_lock);
 
-	pob_fpsgo_fstb_stats_update(POB_FPSGO_FSTB_STATS_START, NULL);
+	pob_ntf_batch_add(&fstb_pob_batch, POB_NTF_FPSGO,
+		POB_FPSGO_FSTB_STATS_START, NULL, 0);
 
 	hlist_for_each_entry_safe(iter, n, &fstb_frame_infos, hlist) {
 		/* if this process did queue buffer while last polling window */
@@ -1504,8 +1513,9 @@ static void fstb_fps_stats(struct work_struct *work)
 			{
 				struct pob_fpsgo_qtsk_info pffi = {iter->pid};
 
-				pob_fpsgo_qtsk_update(POB_FPSGO_QTSK_DEL,
-							&pffi);
+				pob_ntf_batch_add(&fstb_pob_batch,
+					POB_NTF_FPSGO, POB_FPSGO_QTSK_DEL,
+					&pffi, sizeof(pffi));
 			}
 
 			vfree(iter);
@@ -1534,9 +1544,12 @@ static void fstb_fps_stats(struct work_struct *work)
 		disable_fstb_timer();
 
 	fpsgo_fstb2eara_notify_fps_active(fstb_active);
-	pob_fpsgo_fstb_stats_update(POB_FPSGO_FSTB_STATS_END, NULL);
+	pob_ntf_batch_add(&fstb_pob_batch, POB_NTF_FPSGO,
+		POB_FPSGO_FSTB_STATS_END, NULL, 0);
 	if (fstb_active == 0)
-		pob_fpsgo_qtsk_update(POB_FPSGO_QTSK_DELALL, NULL);
+		pob_ntf_batch_add(&fstb_pob_batch, POB_NTF_FPSGO,
+			POB_FPSGO_QTSK_DELALL, NULL, 0);
+	pob_ntf_batch_flush(&fstb_pob_batch);
 
 
 	mutex_unlock(&fstb_lock);
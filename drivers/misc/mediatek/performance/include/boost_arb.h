@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _BOOST_ARB_H
+#define _BOOST_ARB_H
+
+#include <linux/hrtimer.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include <linux/types.h>
+#include <linux/workqueue.h>
+
+#define BOOST_ARB_MAX_ITEM	8	/* clusters or cgroups */
+#define BOOST_ARB_HIST_NR	8	/* history entries per kicker */
+#define BOOST_ARB_WINDOW_US	1000
+
+struct boost_arb_val {
+	int min;
+	int max;
+};
+
+/* one request of a kicker and the result that was applied for it */
+struct boost_arb_hist {
+	u64 ts;
+	u64 apply_ts;		/* 0 while still pending */
+	unsigned int timeout_ms;
+	bool expired;
+	struct boost_arb_val req[BOOST_ARB_MAX_ITEM];
+	struct boost_arb_val eff[BOOST_ARB_MAX_ITEM];
+};
+
+struct boost_arb;
+
+struct boost_arb_ops {
+	/* fold the requests of all kickers into out[], arb->lock held */
+	void (*merge)(struct boost_arb *arb, struct boost_arb_val *out);
+	/*
+	 * push a merged result to the policy, may sleep; prev is the result
+	 * pushed last time, NULL when every item has to be written
+	 */
+	void (*apply)(struct boost_arb *arb, const struct boost_arb_val *out,
+			const struct boost_arb_val *prev);
+};
+
+/*
+ * Arbiter of the per-kicker min/max requests of one controller.
+ *
+ * Requests are stored and merged synchronously, the merged result is
+ * pushed by ops->apply() at most once per window_us: the first change
+ * after a quiet period is applied in the caller context, changes that
+ * follow within the window are folded into one deferred apply.
+ * A request may carry a timeout after which the kicker's whole request
+ * is reset to 'unset' by the arbiter.
+ */
+struct boost_arb {
+	const char *name;
+	int nr_kicker;
+	int nr_item;
+	struct boost_arb_val unset;
+	const struct boost_arb_ops *ops;
+	unsigned int window_us;
+
+	/* private */
+	struct mutex lock;
+	struct mutex apply_lock;
+	struct boost_arb_val *req;	/* [nr_kicker][nr_item] */
+	u64 *deadline;			/* [nr_kicker], 0 for none */
+	struct boost_arb_val cur[BOOST_ARB_MAX_ITEM];
+	struct boost_arb_val applied[BOOST_ARB_MAX_ITEM];
+	bool dirty;
+	u64 last_apply;
+	struct hrtimer timer;
+	struct work_struct work;
+	struct boost_arb_hist *hist;	/* [nr_kicker][BOOST_ARB_HIST_NR] */
+	unsigned int *hist_head;
+	u64 nr_request;
+	u64 nr_apply;
+	u64 nr_expire;
+};
+
+/* for the state ops->merge() keeps aside of out[] */
+static inline void boost_arb_lock(struct boost_arb *arb)
+{
+	mutex_lock(&arb->lock);
+}
+
+static inline void boost_arb_unlock(struct boost_arb *arb)
+{
+	mutex_unlock(&arb->lock);
+}
+
+static inline struct boost_arb_val *boost_arb_req(struct boost_arb *arb,
+		int kicker)
+{
+	return &arb->req[kicker * arb->nr_item];
+}
+
+extern int boost_arb_init(struct boost_arb *arb);
+extern void boost_arb_exit(struct boost_arb *arb);
+extern int boost_arb_update(struct boost_arb *arb, int kicker,
+		const struct boost_arb_val *req, unsigned int timeout_ms);
+extern int boost_arb_update_item(struct boost_arb *arb, int kicker,
+		int item, struct boost_arb_val val, unsigned int timeout_ms);
+extern void boost_arb_get(struct boost_arb *arb, struct boost_arb_val *out);
+extern void boost_arb_flush(struct boost_arb *arb);
+extern void boost_arb_reapply(struct boost_arb *arb);
+extern void boost_arb_show(struct boost_arb *arb, struct seq_file *m);
+
+#endif /* _BOOST_ARB_H */
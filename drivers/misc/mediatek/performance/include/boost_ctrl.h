@@ -23,6 +23,7 @@ void cpu_ctrl_exit(void);
 
 /*dram controller*/
 int dram_ctrl_init(struct proc_dir_entry *parent);
+int dram_pred_ctrl_init(struct proc_dir_entry *parent);
 
 /*eas controller*/
 int eas_ctrl_init(struct proc_dir_entry *parent);
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _DRAM_PRED_H
+#define _DRAM_PRED_H
+
+#include <linux/seq_file.h>
+#include <linux/types.h>
+
+#define DRAM_PRED_MAX_LEVEL	4	/* DDR opps the predictor tells apart */
+#define DRAM_PRED_HIST_LEN	4	/* frames of history per pattern */
+#define DRAM_PRED_NR_PATTERN	(1 << (2 * DRAM_PRED_HIST_LEN))
+#define DRAM_PRED_CONF_MAX	3
+#define DRAM_PRED_CONF_USE	2	/* pattern trusted from this on */
+#define DRAM_PRED_LEAD_US	2000
+#define DRAM_PRED_MARGIN_PCT	10
+
+enum dram_pred_client {
+	DRAM_PRED_CPU,
+	DRAM_PRED_GPU,
+	DRAM_PRED_MM,		/* display, camera, codecs */
+	DRAM_PRED_MD,
+	DRAM_PRED_APU,
+	NR_DRAM_PRED_CLIENT
+};
+
+/* what frame history was followed by, learnt like a branch predictor */
+struct dram_pred_entry {
+	u8 level;
+	u8 conf;
+};
+
+struct dram_pred_stat {
+	u64 nr_frame;
+	u64 nr_hit;
+	u64 nr_under;		/* predicted below what the frame needed */
+	u64 nr_over;		/* predicted above it */
+	u64 under_level;	/* summed shortfall, in levels */
+	u64 over_level_us;	/* surplus level x frame time, energy proxy */
+	u64 nr_pattern;		/* predictions taken from the pattern table */
+};
+
+/*
+ * Per frame DDR level predictor. Bandwidth samples are folded into the
+ * running frame; at each frame start the frame that ended is scored
+ * against what was predicted for it and taught to the pattern table,
+ * indexed by the levels of the frames before it. A prediction comes from
+ * the table when its entry is confident, else from the smoothed frame
+ * peak plus margin_pct. Time is passed in by the caller, so traces can be
+ * replayed at any speed. Not locked, callers serialize.
+ */
+struct dram_pred {
+	unsigned int nr_level;
+	/* MB/s from which level i + 1 is needed, ascending */
+	unsigned int thresh[DRAM_PRED_MAX_LEVEL - 1];
+	unsigned int margin_pct;
+	unsigned int lead_us;
+
+	/* running frame */
+	bool in_frame;
+	u64 frame_start;
+	unsigned int peak[NR_DRAM_PRED_CLIENT];
+	unsigned int total_peak;
+	int level;		/* predicted for the running frame */
+	int next;		/* predicted for the next one, -1 if not yet */
+	bool pattern;		/* level came from the pattern table */
+	bool next_pattern;
+
+	/* history */
+	u64 period_ns;
+	unsigned int ewma[NR_DRAM_PRED_CLIENT];
+	unsigned int total_ewma;
+	unsigned int hist;	/* levels of the last frames, 2 bits each */
+	struct dram_pred_entry table[DRAM_PRED_NR_PATTERN];
+
+	struct dram_pred_stat stat;
+};
+
+extern void dram_pred_init(struct dram_pred *p, const unsigned int *thresh,
+		unsigned int nr_level);
+extern int dram_pred_bw_level(const struct dram_pred *p, unsigned int bw);
+extern void dram_pred_sample(struct dram_pred *p, const unsigned int *bw);
+extern int dram_pred_frame_start(struct dram_pred *p, u64 now);
+extern u64 dram_pred_next_due(const struct dram_pred *p);
+extern int dram_pred_predict_next(struct dram_pred *p, u64 now);
+extern void dram_pred_show(struct dram_pred *p, struct seq_file *m);
+
+#endif /* _DRAM_PRED_H */
@@ -13,14 +13,99 @@
 #ifndef LOAD_TRACK_H
 #define LOAD_TRACK_H
 
+#include <linux/list.h>
+#include <linux/types.h>
+
+#define LT_MAX_CLUSTER		4
+#define LT_THRESH_NONE		(-1)
+#define LT_CLUSTER_SYSTEM	(-1)
+
+/**
+ * struct lt_load_info - loading delivered to a subscriber
+ * @loading:		system loading (0~100) since this subscriber was last
+ *			notified, or -EOVERFLOW if idle/wall counter overflowed
+ * @recent:		system loading of the latest evaluation window
+ * @nr_clusters:	valid entries in @cluster_loading
+ * @cluster_loading:	per cluster loading of the latest evaluation window
+ * @timestamp:		ktime (ns) of the evaluation
+ */
+struct lt_load_info {
+	int loading;
+	int recent;
+	int nr_clusters;
+	int cluster_loading[LT_MAX_CLUSTER];
+	u64 timestamp;
+};
+
+/**
+ * struct lt_subscriber - event driven loading subscriber
+ * @notify:		called in process context, may sleep
+ * @up_thresh:		notify when the watched loading rises to >= up_thresh,
+ *			LT_THRESH_NONE to disable
+ * @down_thresh:	notify when the watched loading falls to <= down_thresh,
+ *			LT_THRESH_NONE to disable
+ * @max_stale_ms:	notify at least this often, 0 to only notify on
+ *			threshold crossings
+ * @cluster:		cluster id whose loading is watched, or
+ *			LT_CLUSTER_SYSTEM
+ *
+ * All subscribers share one evaluation, which is kicked by scheduler
+ * idle/busy transitions (rate limited) and by the earliest staleness
+ * deadline. Staleness deadlines are aligned to a global grid so that
+ * subscribers of the same period are served by the same evaluation.
+ */
+struct lt_subscriber {
+	void (*notify)(struct lt_subscriber *sub,
+		const struct lt_load_info *info);
+	int up_thresh;
+	int down_thresh;
+	unsigned long max_stale_ms;
+	int cluster;
+
+	/* private to load_track */
+	struct list_head node;
+	u64 deadline;
+	u64 snap_busy;
+	u64 snap_wall;
+	bool above;
+};
+
+struct lt_stats {
+	u64 nr_eval;
+	u64 nr_kick;
+	u64 nr_notify;
+	u64 lock_max_ns;
+	u64 lock_total_ns;
+	int nr_subscriber;
+};
+
 #ifdef CONFIG_MTK_LOAD_TRACKER
 
+/**
+ * DESCRIPTION:
+ *	This function MIGHT SLEEP.
+ *	Add subscriber sub. sub must stay valid until lt_unsubscribe
+ *	returns. Neither function may be called from sub->notify.
+ *
+ * RETURN VALUE:
+ *	On Success zero is returned.
+ *
+ * ERRORS:
+ *	EINVAL sub->notify == NULL, no threshold and no max_stale_ms,
+ *	       invalid cluster or load_track_init fail
+ *	EBUSY  sub is already subscribed
+ */
+extern int lt_subscribe(struct lt_subscriber *sub);
+extern void lt_unsubscribe(struct lt_subscriber *sub);
+extern void lt_get_stats(struct lt_stats *stats);
+
 /**
  * DESCRIPTION:
  *	This function MIGHT SLEEP.
  *	Register a Loading Tracking callback function fn of polling
  *	time polling_ms. Callback function fn will be called per
- *	polling_ms with loading value.
+ *	polling_ms with loading value. This is a lt_subscriber with
+ *	max_stale_ms = polling_ms and no threshold.
  *	Callback function fn: loading may get -EOVERFLOW if idle/wall
  *	counter overflowed, otherwise loading will be between 0~100.
  *
@@ -65,6 +150,11 @@ extern int unreg_loading_tracking_sp(void (*fn)(int loading),
 
 #else
 
+static inline int lt_subscribe(struct lt_subscriber *sub)
+{ return -EINVAL; }
+static inline void lt_unsubscribe(struct lt_subscriber *sub) { }
+static inline void lt_get_stats(struct lt_stats *stats) { }
+
 #define reg_loading_tracking(p_fn, polling_ms) \
 reg_loading_tracking_sp(p_fn, polling_ms, __func__)
 static inline int reg_loading_tracking_sp(void (*fn)(int loading),
@@ -21,6 +21,7 @@
 #include <linux/notifier.h>
 #include <linux/hrtimer.h>
 #include <linux/workqueue.h>
+#include <linux/input.h>
 
 
 #include "cpu_ctrl.h"
@@ -48,5 +49,13 @@ int init_utch(struct proc_dir_entry *parent);
 int init_ktch(struct proc_dir_entry *parent);
 int ktch_suspend(void);
 
+/*kernel gesture*/
+extern int ktch_gest_enable;
+bool ktch_gest_event(struct input_dev *dev, unsigned int type,
+		unsigned int code, int value);
+long ktch_gest_work(int base_freq);
+void ktch_gest_reset(void);
+int ktch_gest_init(struct proc_dir_entry *parent);
+
 
 #endif /* _TCHBST_H */
@@ -10,40 +10,80 @@
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
  * GNU General Public License for more details.
  */
+
+/*
+ * Loading Tracking Service
+ *
+ * All subscribers share a single evaluation work. The evaluation walks
+ * the CPUs once, under lt_stat_lock, and keeps cumulative busy/wall sums
+ * so that every subscriber can derive the loading of its own window in
+ * O(1). It runs when:
+ *  - a CPU goes idle <-> busy (sched_update_nr_prod hook), rate limited
+ *    by lt_min_interval_ms and only while a threshold subscriber exists
+ *  - the earliest staleness deadline of any subscriber is reached
+ *
+ * Subscribers are walked under SRCU, so lt_stat_lock hold time does not
+ * depend on the number of subscribers.
+ */
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
 #include <linux/ktime.h>
 #include <linux/time.h>
 #include <linux/list.h>
+#include <linux/rculist.h>
+#include <linux/srcu.h>
 #include <linux/slab.h>
 #include <linux/cpufreq.h>
+#include <linux/irq_work.h>
+#include <linux/workqueue.h>
+#include <linux/arch_topology.h>
+#include <linux/sched/clock.h>
 
 #include <soc/oppo/oppo_project.h>
+#include <mt-plat/mtk_sched.h>
+
+#include "load_track.h"
 
 #define TAG "[LT]"
 
 struct LT_USER_DATA {
 	void (*fn)(int loading);
-	unsigned long polling_ms;
-	u64 *prev_idle_time;
-	u64 *prev_wall_time;
+	struct lt_subscriber sub;
 	struct hlist_node user_list_node;
-	struct LT_WORK_DATA *link2work;
 };
 
-struct LT_WORK_DATA {
-	struct LT_USER_DATA *link2user;
-	struct delayed_work s_work;
-	ktime_t target_expire;
-};
+static int nr_clusters;
+static int *cpu_cluster;
 
-static int nr_cpus;
+static unsigned int lt_min_interval_ms = 20;
+module_param(lt_min_interval_ms, uint, 0644);
+MODULE_PARM_DESC(lt_min_interval_ms,
+	"Minimum interval between scheduler kicked evaluations");
 
 static struct workqueue_struct *ps_lk_wq;
 static HLIST_HEAD(lt_user_list);
+static LIST_HEAD(lt_sub_list);
 DEFINE_MUTEX(lt_mlock);
-static void lt_work_fn(struct work_struct *ps_work);
+DEFINE_STATIC_SRCU(lt_srcu);
+
+/* shared evaluation state, protected by lt_stat_lock */
+static DEFINE_SPINLOCK(lt_stat_lock);
+static u64 *prev_idle_time;
+static u64 *prev_wall_time;
+static u64 lt_busy_sum;
+static u64 lt_wall_sum;
+static bool lt_overflow;
+static struct lt_stats lt_stat;
+
+static u64 lt_epoch;
+static atomic_t lt_nr_event_sub;
+static atomic64_t lt_nr_kick;
+static atomic64_t lt_next_kick;
+static struct irq_work lt_kick_irq_work;
+static void lt_eval_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(lt_eval_work, lt_eval_fn);
 
 static inline void lt_lock(const char *tag)
 {
@@ -60,133 +100,286 @@ static inline void lt_lockprove(const char *tag)
 	WARN_ON(!mutex_is_locked(&lt_mlock));
 }
 
-static void *new_lt_work(struct LT_USER_DATA *lt_user)
+static inline bool lt_has_thresh(struct lt_subscriber *sub)
 {
-	struct LT_WORK_DATA *new_work;
-
-	lt_lockprove(__func__);
-	new_work = kzalloc(sizeof(*new_work), GFP_KERNEL);
-	if (!new_work)
-		goto new_lt_work_out;
+	return sub->up_thresh != LT_THRESH_NONE ||
+		sub->down_thresh != LT_THRESH_NONE;
+}
 
-	new_work->link2user = lt_user;
-	INIT_DELAYED_WORK(&new_work->s_work, lt_work_fn);
-	new_work->target_expire =
-		ktime_add_ms(ktime_get(), lt_user->polling_ms);
+static inline int lt_pct(u64 busy, u64 wall)
+{
+	if (!wall)
+		return 0;
 
-new_lt_work_out:
-	return new_work;
+	return div64_u64(min(busy, wall) * 100, wall);
 }
 
-static inline void free_lt_work(struct LT_WORK_DATA *lt_work)
+/* next point of the global grid of period_ms after now */
+static u64 lt_align(u64 now, unsigned long period_ms)
 {
-	lt_lockprove(__func__);
-	kfree(lt_work);
+	u64 period = (u64)period_ms * NSEC_PER_MSEC;
+
+	return lt_epoch + (div64_u64(now - lt_epoch, period) + 1) * period;
 }
 
-static int lt_update_loading(struct LT_USER_DATA *lt_data)
+/*
+ * Walk every CPU once and fold idle/wall deltas into the cumulative sums
+ * and the per cluster loading of this window.
+ */
+static void lt_update_loading(struct lt_load_info *info)
 {
-	int ret = -EOVERFLOW;
-	int cpu;
-	u64 cur_idle_time_i, cur_wall_time_i;
-	u64 cpu_idle_time = 0, cpu_wall_time = 0;
+	u64 cl_busy[LT_MAX_CLUSTER] = {0}, cl_wall[LT_MAX_CLUSTER] = {0};
+	u64 cur_idle_time_i, cur_wall_time_i, idle, wall;
+	u64 busy_sum = 0, wall_sum = 0;
+	u64 t0, hold;
+	int cpu, cl;
+
+	spin_lock(&lt_stat_lock);
+	t0 = ktime_get_ns();
 
-	lt_lockprove(__func__);
 	for_each_possible_cpu(cpu) {
 		cur_idle_time_i = get_cpu_idle_time(cpu, &cur_wall_time_i, 1);
-		cpu_idle_time += cur_idle_time_i - lt_data->prev_idle_time[cpu];
-		cpu_wall_time += cur_wall_time_i - lt_data->prev_wall_time[cpu];
-		lt_data->prev_idle_time[cpu] = cur_idle_time_i;
-		lt_data->prev_wall_time[cpu] = cur_wall_time_i;
+		idle = cur_idle_time_i - prev_idle_time[cpu];
+		wall = cur_wall_time_i - prev_wall_time[cpu];
+		prev_idle_time[cpu] = cur_idle_time_i;
+		prev_wall_time[cpu] = cur_wall_time_i;
+
+		if (idle > wall) {
+			lt_overflow = true;
+			continue;
+		}
+
+		busy_sum += wall - idle;
+		wall_sum += wall;
+		cl = cpu_cluster[cpu];
+		cl_busy[cl] += wall - idle;
+		cl_wall[cl] += wall;
 	}
 
-	if (cpu_wall_time > 0 && cpu_wall_time >= cpu_idle_time)
-		ret =
-			div_u64((cpu_wall_time - cpu_idle_time) * 100,
-				cpu_wall_time);
+	lt_busy_sum += busy_sum;
+	lt_wall_sum += wall_sum;
 
-	return ret;
+	info->recent = lt_pct(busy_sum, wall_sum);
+	info->nr_clusters = nr_clusters;
+	for (cl = 0; cl < nr_clusters; cl++)
+		info->cluster_loading[cl] = lt_pct(cl_busy[cl], cl_wall[cl]);
+
+	lt_stat.nr_eval++;
+	hold = ktime_get_ns() - t0;
+	lt_stat.lock_total_ns += hold;
+	if (hold > lt_stat.lock_max_ns)
+		lt_stat.lock_max_ns = hold;
+
+	spin_unlock(&lt_stat_lock);
 }
 
-static void lt_work_fn(struct work_struct *ps_work)
+static bool lt_crossed(struct lt_subscriber *sub,
+	const struct lt_load_info *info)
 {
-	struct delayed_work *dwork;
-	struct LT_WORK_DATA *lt_work;
-	struct LT_USER_DATA *lt_user;
-	ktime_t ktime_now;
+	int load;
 
-	lt_lock(__func__);
-	dwork = container_of(ps_work, struct delayed_work, work);
-	lt_work = container_of(dwork, struct LT_WORK_DATA, s_work);
-	lt_user = lt_work->link2user;
-	if (lt_user) {
-		lt_user->fn(lt_update_loading(lt_user));
-
-		ktime_now = ktime_get();
-		do {
-			lt_work->target_expire =
-				ktime_add_ms(lt_work->target_expire,
-					lt_user->polling_ms);
-		} while (!ktime_after(lt_work->target_expire, ktime_now));
-
-		queue_delayed_work(ps_lk_wq, &lt_work->s_work,
-			msecs_to_jiffies(ktime_ms_delta(
-				lt_work->target_expire, ktime_now)));
-	} else
-		free_lt_work(lt_work);
+	if (!lt_has_thresh(sub))
+		return false;
 
-	lt_unlock(__func__);
+	load = sub->cluster == LT_CLUSTER_SYSTEM ?
+		info->recent : info->cluster_loading[sub->cluster];
+
+	if (!sub->above && sub->up_thresh != LT_THRESH_NONE &&
+		load >= sub->up_thresh) {
+		sub->above = true;
+		return true;
+	}
+
+	if (sub->above && sub->down_thresh != LT_THRESH_NONE &&
+		load <= sub->down_thresh) {
+		sub->above = false;
+		return true;
+	}
+
+	return false;
 }
 
-static void *new_lt_user(void (*fn)(int loading),
-	unsigned long polling_ms)
+static void lt_eval_fn(struct work_struct *work)
 {
-	struct LT_USER_DATA *new_lt;
-	int cpu;
+	struct lt_load_info info;
+	struct lt_subscriber *sub;
+	u64 busy, wall, now, slack, next = U64_MAX;
+	u64 nr_notify = 0;
+	bool overflow;
+	int idx;
+
+	lt_update_loading(&info);
+
+	spin_lock(&lt_stat_lock);
+	busy = lt_busy_sum;
+	wall = lt_wall_sum;
+	overflow = lt_overflow;
+	lt_overflow = false;
+	spin_unlock(&lt_stat_lock);
+
+	now = ktime_get_ns();
+	info.timestamp = now;
+	/* the work fires on a jiffy boundary, don't miss a deadline by it */
+	slack = TICK_NSEC;
+
+	idx = srcu_read_lock(&lt_srcu);
+	list_for_each_entry_rcu(sub, &lt_sub_list, node) {
+		bool stale = sub->max_stale_ms && sub->deadline <= now + slack;
+
+		if (lt_crossed(sub, &info) || stale) {
+			if (overflow)
+				info.loading = -EOVERFLOW;
+			else
+				info.loading = lt_pct(busy - sub->snap_busy,
+					wall - sub->snap_wall);
+			sub->snap_busy = busy;
+			sub->snap_wall = wall;
+			sub->notify(sub, &info);
+			nr_notify++;
+		}
+
+		if (sub->max_stale_ms) {
+			if (stale)
+				sub->deadline = lt_align(now + slack,
+					sub->max_stale_ms);
+			next = min(next, sub->deadline);
+		}
+	}
+	srcu_read_unlock(&lt_srcu, idx);
+
+	spin_lock(&lt_stat_lock);
+	lt_stat.nr_notify += nr_notify;
+	spin_unlock(&lt_stat_lock);
+
+	if (next != U64_MAX) {
+		now = ktime_get_ns();
+		queue_delayed_work(ps_lk_wq, &lt_eval_work,
+			next > now ? nsecs_to_jiffies(next - now) : 0);
+	}
+}
+
+static void lt_kick_fn(struct irq_work *work)
+{
+	mod_delayed_work(ps_lk_wq, &lt_eval_work, 0);
+}
+
+#ifdef CONFIG_MTK_SCHED_RQAVG_KS
+/* scheduler hook, rq lock held */
+static void lt_sched_kick(int cpu, u64 now)
+{
+	u64 next = atomic64_read(&lt_next_kick);
+
+	if (!atomic_read(&lt_nr_event_sub) || now < next)
+		return;
+
+	if (atomic64_cmpxchg(&lt_next_kick, next,
+		now + (u64)lt_min_interval_ms * NSEC_PER_MSEC) != next)
+		return;
+
+	atomic64_inc(&lt_nr_kick);
+	irq_work_queue(&lt_kick_irq_work);
+}
+#endif
+
+static int __lt_subscribe(struct lt_subscriber *sub)
+{
+	struct lt_subscriber *iter;
+	unsigned long flags;
 
 	lt_lockprove(__func__);
-	new_lt                 = kzalloc(sizeof(*new_lt), GFP_KERNEL);
-	if (!new_lt)
-		goto new_lt_alloc_err;
-
-	new_lt->fn             = fn;
-	new_lt->polling_ms     = polling_ms;
-	new_lt->prev_idle_time =
-		kcalloc(nr_cpus, sizeof(u64), GFP_KERNEL);
-	if (!new_lt->prev_idle_time)
-		goto new_lt_idle_alloc_err;
-
-	new_lt->prev_wall_time =
-		kcalloc(nr_cpus, sizeof(u64), GFP_KERNEL);
-	if (!new_lt->prev_wall_time)
-		goto new_lt_wall_alloc_err;
-
-	for_each_possible_cpu(cpu)
-		new_lt->prev_idle_time[cpu] =
-			get_cpu_idle_time(cpu, &new_lt->prev_wall_time[cpu], 1);
-
-	hlist_add_head(&new_lt->user_list_node, &lt_user_list);
-
-	return new_lt;
-
-new_lt_wall_alloc_err:
-	kfree(new_lt->prev_idle_time);
-new_lt_idle_alloc_err:
-	kfree(new_lt);
-new_lt_alloc_err:
-	return NULL;
+	if (!sub || !sub->notify || !ps_lk_wq)
+		return -EINVAL;
+
+	if (!sub->max_stale_ms && !lt_has_thresh(sub))
+		return -EINVAL;
+
+	if (sub->cluster != LT_CLUSTER_SYSTEM &&
+		(sub->cluster < 0 || sub->cluster >= nr_clusters))
+		return -EINVAL;
+
+	list_for_each_entry(iter, &lt_sub_list, node)
+		if (iter == sub)
+			return -EBUSY;
+
+	spin_lock_irqsave(&lt_stat_lock, flags);
+	sub->snap_busy = lt_busy_sum;
+	sub->snap_wall = lt_wall_sum;
+	lt_stat.nr_subscriber++;
+	spin_unlock_irqrestore(&lt_stat_lock, flags);
+
+	sub->above = false;
+	if (sub->max_stale_ms)
+		sub->deadline = lt_align(ktime_get_ns(), sub->max_stale_ms);
+
+	list_add_tail_rcu(&sub->node, &lt_sub_list);
+	if (lt_has_thresh(sub))
+		atomic_inc(&lt_nr_event_sub);
+
+	/* pick up the new deadline */
+	mod_delayed_work(ps_lk_wq, &lt_eval_work, 0);
+
+	return 0;
 }
 
-static void free_lt_user(struct LT_USER_DATA *node)
+/* caller must synchronize_srcu(&lt_srcu) after dropping lt_mlock */
+static void __lt_unsubscribe(struct lt_subscriber *sub)
 {
+	unsigned long flags;
+
 	lt_lockprove(__func__);
-	if (node->link2work)
-		node->link2work->link2user = NULL;
+	list_del_rcu(&sub->node);
+	if (lt_has_thresh(sub))
+		atomic_dec(&lt_nr_event_sub);
+
+	spin_lock_irqsave(&lt_stat_lock, flags);
+	lt_stat.nr_subscriber--;
+	spin_unlock_irqrestore(&lt_stat_lock, flags);
+}
+
+int lt_subscribe(struct lt_subscriber *sub)
+{
+	int ret;
+
+	might_sleep();
+
+	lt_lock(__func__);
+	ret = __lt_subscribe(sub);
+	lt_unlock(__func__);
+
+	return ret;
+}
+EXPORT_SYMBOL(lt_subscribe);
+
+void lt_unsubscribe(struct lt_subscriber *sub)
+{
+	might_sleep();
+
+	lt_lock(__func__);
+	__lt_unsubscribe(sub);
+	lt_unlock(__func__);
+
+	synchronize_srcu(&lt_srcu);
+}
+EXPORT_SYMBOL(lt_unsubscribe);
+
+void lt_get_stats(struct lt_stats *stats)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&lt_stat_lock, flags);
+	*stats = lt_stat;
+	spin_unlock_irqrestore(&lt_stat_lock, flags);
+	stats->nr_kick = atomic64_read(&lt_nr_kick);
+}
+EXPORT_SYMBOL(lt_get_stats);
+
+static void lt_legacy_notify(struct lt_subscriber *sub,
+	const struct lt_load_info *info)
+{
+	struct LT_USER_DATA *lt_user =
+		container_of(sub, struct LT_USER_DATA, sub);
 
-	hlist_del(&node->user_list_node);
-	kfree(node->prev_idle_time);
-	kfree(node->prev_wall_time);
-	kfree(node);
+	lt_user->fn(info->loading);
 }
 
 static void lt_cleanup(void)
@@ -195,17 +388,22 @@ static void lt_cleanup(void)
 	struct hlist_node *t;
 
 	lt_lock(__func__);
-	hlist_for_each_entry_safe(ltiter, t, &lt_user_list, user_list_node)
-		free_lt_user(ltiter);
-
+	hlist_for_each_entry(ltiter, &lt_user_list, user_list_node)
+		__lt_unsubscribe(&ltiter->sub);
 	lt_unlock(__func__);
+
+	synchronize_srcu(&lt_srcu);
+
+	hlist_for_each_entry_safe(ltiter, t, &lt_user_list, user_list_node) {
+		hlist_del(&ltiter->user_list_node);
+		kfree(ltiter);
+	}
 }
 
 int reg_loading_tracking_sp(void (*fn)(int loading), unsigned long polling_ms,
 	const char *caller)
 {
 	struct LT_USER_DATA *ltiter = NULL, *new_user;
-	struct LT_WORK_DATA *new_work;
 	int ret = 0;
 
 	might_sleep();
@@ -225,20 +423,26 @@ int reg_loading_tracking_sp(void (*fn)(int loading), unsigned long polling_ms,
 		goto reg_loading_tracking_out;
 	}
 
-	new_user = new_lt_user(fn, polling_ms);
+	new_user = kzalloc(sizeof(*new_user), GFP_KERNEL);
 	if (!new_user) {
 		ret = -ENOMEM;
 		goto reg_loading_tracking_out;
 	}
 
-	new_work = new_lt_work(new_user);
-	if (!new_work)
-		goto reg_loading_tracking_new_work_err;
+	new_user->fn = fn;
+	new_user->sub.notify = lt_legacy_notify;
+	new_user->sub.up_thresh = LT_THRESH_NONE;
+	new_user->sub.down_thresh = LT_THRESH_NONE;
+	new_user->sub.max_stale_ms = polling_ms;
+	new_user->sub.cluster = LT_CLUSTER_SYSTEM;
 
-	new_user->link2work = new_work;
+	ret = __lt_subscribe(&new_user->sub);
+	if (ret) {
+		kfree(new_user);
+		goto reg_loading_tracking_out;
+	}
 
-	queue_delayed_work(ps_lk_wq, &new_work->s_work,
-		msecs_to_jiffies(new_user->polling_ms));
+	hlist_add_head(&new_user->user_list_node, &lt_user_list);
 
 #if defined(VENDOR_EDIT)
 	if (get_eng_version() != 0) {
@@ -246,10 +450,6 @@ int reg_loading_tracking_sp(void (*fn)(int loading), unsigned long polling_ms,
 	}
 #endif
 
-	goto reg_loading_tracking_out;
-
-reg_loading_tracking_new_work_err:
-	free_lt_user(new_user);
 reg_loading_tracking_out:
 	lt_unlock(__func__);
 
@@ -279,13 +479,20 @@ int unreg_loading_tracking_sp(void (*fn)(int loading), const char *caller)
 		goto unreg_loading_tracking_out;
 	}
 
-	free_lt_user(ltiter);
+	hlist_del(&ltiter->user_list_node);
+	__lt_unsubscribe(&ltiter->sub);
+	lt_unlock(__func__);
+
+	synchronize_srcu(&lt_srcu);
+	kfree(ltiter);
 #if defined(VENDOR_EDIT)
 	if (get_eng_version() != 0) {
 	pr_debug(TAG"%s %s success\n", __func__, caller);
 	}
 #endif
 
+	return 0;
+
 unreg_loading_tracking_out:
 	lt_unlock(__func__);
 
@@ -294,21 +501,56 @@ int unreg_loading_tracking_sp(void (*fn)(int loading), const char *caller)
 
 static int __init load_track_init(void)
 {
-	nr_cpus = num_possible_cpus();
-	ps_lk_wq = create_workqueue("lt_wq");
-	if (!ps_lk_wq) {
-		return -EFAULT;
-		pr_debug(TAG"%s OOM\n", __func__);
+	int cpu;
+
+	nr_clusters = min(arch_get_nr_clusters(), LT_MAX_CLUSTER);
+
+	prev_idle_time = kcalloc(nr_cpu_ids, sizeof(u64), GFP_KERNEL);
+	prev_wall_time = kcalloc(nr_cpu_ids, sizeof(u64), GFP_KERNEL);
+	cpu_cluster = kcalloc(nr_cpu_ids, sizeof(int), GFP_KERNEL);
+	if (!prev_idle_time || !prev_wall_time || !cpu_cluster)
+		goto load_track_init_oom;
+
+	for_each_possible_cpu(cpu) {
+		prev_idle_time[cpu] =
+			get_cpu_idle_time(cpu, &prev_wall_time[cpu], 1);
+		cpu_cluster[cpu] = clamp(arch_get_cluster_id(cpu), 0,
+			max(nr_clusters - 1, 0));
 	}
 
+	lt_epoch = ktime_get_ns();
+	init_irq_work(&lt_kick_irq_work, lt_kick_fn);
+
+	ps_lk_wq = alloc_ordered_workqueue("lt_wq", 0);
+	if (!ps_lk_wq)
+		goto load_track_init_oom;
+
+#ifdef CONFIG_MTK_SCHED_RQAVG_KS
+	sched_set_lt_kick(lt_sched_kick);
+#endif
+
 	return 0;
+
+load_track_init_oom:
+	pr_debug(TAG"%s OOM\n", __func__);
+	kfree(prev_idle_time);
+	kfree(prev_wall_time);
+	kfree(cpu_cluster);
+	return -ENOMEM;
 }
 
 static void __exit load_track_exit(void)
 {
+#ifdef CONFIG_MTK_SCHED_RQAVG_KS
+	sched_set_lt_kick(NULL);
+#endif
+	irq_work_sync(&lt_kick_irq_work);
 	lt_cleanup();
-	flush_workqueue(ps_lk_wq);
+	cancel_delayed_work_sync(&lt_eval_work);
 	destroy_workqueue(ps_lk_wq);
+	kfree(prev_idle_time);
+	kfree(prev_wall_time);
+	kfree(cpu_cluster);
 }
 
 module_init(load_track_init);
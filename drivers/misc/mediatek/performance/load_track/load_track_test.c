@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Loading Tracking Service scalability test
+ *
+ * Registers an increasing number of subscribers (half periodic, half
+ * threshold driven) while a kthread alternates between busy and idle
+ * phases, and checks that evaluations and lt_stat_lock hold time stay
+ * flat as the subscriber count grows.
+ */
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/delay.h>
+#include <linux/slab.h>
+#include <linux/atomic.h>
+
+#include "load_track.h"
+
+#define TAG "[LT_TEST]"
+
+static unsigned int run_ms = 2000;
+module_param(run_ms, uint, 0444);
+MODULE_PARM_DESC(run_ms, "Duration of each step");
+
+static unsigned int max_subs = 1024;
+module_param(max_subs, uint, 0444);
+MODULE_PARM_DESC(max_subs, "Largest subscriber count");
+
+static unsigned int poll_ms = 50;
+module_param(poll_ms, uint, 0444);
+MODULE_PARM_DESC(poll_ms, "max_stale_ms of periodic subscribers");
+
+static atomic64_t lt_test_notified;
+
+static void lt_test_notify(struct lt_subscriber *sub,
+	const struct lt_load_info *info)
+{
+	atomic64_inc(&lt_test_notified);
+}
+
+static int lt_test_load_fn(void *data)
+{
+	unsigned long end;
+
+	while (!kthread_should_stop()) {
+		end = jiffies + msecs_to_jiffies(30);
+		while (time_before(jiffies, end) && !kthread_should_stop())
+			cpu_relax();
+		msleep(30);
+	}
+
+	return 0;
+}
+
+static int lt_test_step(unsigned int nr, struct lt_stats *delta)
+{
+	struct lt_subscriber *subs;
+	struct lt_stats before, after;
+	unsigned int i;
+	int ret = 0;
+
+	subs = kcalloc(nr, sizeof(*subs), GFP_KERNEL);
+	if (!subs)
+		return -ENOMEM;
+
+	for (i = 0; i < nr; i++) {
+		subs[i].notify = lt_test_notify;
+		subs[i].cluster = LT_CLUSTER_SYSTEM;
+		if (i & 1) {
+			subs[i].up_thresh = 40 + i % 40;
+			subs[i].down_thresh = 20;
+			subs[i].max_stale_ms = 0;
+		} else {
+			subs[i].up_thresh = LT_THRESH_NONE;
+			subs[i].down_thresh = LT_THRESH_NONE;
+			subs[i].max_stale_ms = poll_ms;
+		}
+
+		ret = lt_subscribe(&subs[i]);
+		if (ret) {
+			pr_info(TAG"subscribe %u failed %d\n", i, ret);
+			break;
+		}
+	}
+
+	lt_get_stats(&before);
+	if (!ret)
+		msleep(run_ms);
+	lt_get_stats(&after);
+
+	while (i--)
+		lt_unsubscribe(&subs[i]);
+	kfree(subs);
+
+	delta->nr_eval = after.nr_eval - before.nr_eval;
+	delta->nr_kick = after.nr_kick - before.nr_kick;
+	delta->nr_notify = after.nr_notify - before.nr_notify;
+	delta->lock_total_ns = after.lock_total_ns - before.lock_total_ns;
+	delta->lock_max_ns = after.lock_max_ns;
+
+	return ret;
+}
+
+static int __init lt_test_init(void)
+{
+	struct task_struct *load;
+	struct lt_stats base = {0}, cur;
+	u64 avg, base_avg = 0;
+	unsigned int nr;
+	int ret = 0;
+
+	load = kthread_run(lt_test_load_fn, NULL, "lt_test_load");
+	if (IS_ERR(load))
+		return PTR_ERR(load);
+
+	pr_info(TAG"subs evals kicks notifies lock_avg_ns lock_max_ns\n");
+	for (nr = 1; nr <= max_subs; nr *= 4) {
+		ret = lt_test_step(nr, &cur);
+		if (ret)
+			break;
+
+		avg = cur.nr_eval ? div64_u64(cur.lock_total_ns, cur.nr_eval) : 0;
+		pr_info(TAG"%u %llu %llu %llu %llu %llu\n", nr,
+			cur.nr_eval, cur.nr_kick, cur.nr_notify,
+			avg, cur.lock_max_ns);
+
+		if (nr == 1) {
+			base = cur;
+			base_avg = avg;
+			continue;
+		}
+
+		/* allow 2x plus noise, growth with nr would be orders more */
+		if (cur.nr_eval > 2 * base.nr_eval + 10) {
+			pr_info(TAG"FAIL: evaluations grow with subscribers\n");
+			ret = -EINVAL;
+		}
+		if (avg > 2 * base_avg + 10 * NSEC_PER_USEC) {
+			pr_info(TAG"FAIL: lock hold time grows with subscribers\n");
+			ret = -EINVAL;
+		}
+		if (ret)
+			break;
+	}
+
+	kthread_stop(load);
+
+	if (!ret)
+		pr_info(TAG"PASS\n");
+
+	return ret;
+}
+
+static void __exit lt_test_exit(void)
+{
+}
+
+module_init(lt_test_init);
+module_exit(lt_test_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Loading Tracking Service scalability test");
@@ -14,7 +14,7 @@
 #include <linux/notifier.h>
 #include <mt-plat/mtk_perfobserver.h>
 
-static BLOCKING_NOTIFIER_HEAD(pob_bqd_notifier_list);
+#include "pob_int.h"
 
 /**
  *	bqd_register_client - register a client notifier
@@ -22,7 +22,7 @@ static BLOCKING_NOTIFIER_HEAD(pob_bqd_notifier_list);
  */
 int pob_bqd_register_client(struct notifier_block *nb)
 {
-	return blocking_notifier_chain_register(&pob_bqd_notifier_list, nb);
+	return pob_ntf_register(POB_NTF_BQD, nb);
 }
 
 /**
@@ -31,7 +31,7 @@ int pob_bqd_register_client(struct notifier_block *nb)
  */
 int pob_bqd_unregister_client(struct notifier_block *nb)
 {
-	return blocking_notifier_chain_unregister(&pob_bqd_notifier_list, nb);
+	return pob_ntf_unregister(POB_NTF_BQD, nb);
 }
 
 /**
@@ -40,7 +40,7 @@ int pob_bqd_unregister_client(struct notifier_block *nb)
  */
 int pob_bqd_notifier_call_chain(unsigned long val, void *v)
 {
-	return blocking_notifier_call_chain(&pob_bqd_notifier_list, val, v);
+	return pob_ntf_call(POB_NTF_BQD, val, v);
 }
 
 
@@ -14,21 +14,23 @@
 #include <linux/notifier.h>
 #include <mt-plat/mtk_perfobserver.h>
 
-static BLOCKING_NOTIFIER_HEAD(pob_fpsgo_notifier_list);
+#include "pob_int.h"
 
 int pob_fpsgo_register_client(struct notifier_block *nb)
 {
-	return blocking_notifier_chain_register(&pob_fpsgo_notifier_list, nb);
+	return pob_ntf_register(POB_NTF_FPSGO, nb);
 }
+EXPORT_SYMBOL(pob_fpsgo_register_client);
 
 int pob_fpsgo_unregister_client(struct notifier_block *nb)
 {
-	return blocking_notifier_chain_unregister(&pob_fpsgo_notifier_list, nb);
+	return pob_ntf_unregister(POB_NTF_FPSGO, nb);
 }
+EXPORT_SYMBOL(pob_fpsgo_unregister_client);
 
 int pob_fpsgo_notifier_call_chain(unsigned long val, void *v)
 {
-	return blocking_notifier_call_chain(&pob_fpsgo_notifier_list, val, v);
+	return pob_ntf_call(POB_NTF_FPSGO, val, v);
 }
 
 int pob_fpsgo_fstb_stats_update(unsigned long infonum,
@@ -38,6 +40,7 @@ int pob_fpsgo_fstb_stats_update(unsigned long infonum,
 
 	return 0;
 }
+EXPORT_SYMBOL(pob_fpsgo_fstb_stats_update);
 
 int pob_fpsgo_qtsk_update(unsigned long infonum,
 				struct pob_fpsgo_qtsk_info *info)
@@ -47,3 +50,12 @@ int pob_fpsgo_qtsk_update(unsigned long infonum,
 	return 0;
 }
 
+
+int pob_fpsgo_frame_update(unsigned long infonum,
+				struct pob_fpsgo_frame_info *info)
+{
+	pob_fpsgo_notifier_call_chain(infonum, info);
+
+	return 0;
+}
+EXPORT_SYMBOL(pob_fpsgo_frame_update);
@@ -18,6 +18,7 @@
 #define POB_INT_H
 
 #include <linux/debugfs.h>
+#include <mt-plat/mtk_perfobserver.h>
 
 #define POB_CONTAINER_OF(ptr, type, member) \
 	((type *)(((char *)ptr) - offsetof(type, member)))
@@ -27,6 +28,16 @@ void pob_free(void *pvBuf);
 
 void pob_trace(const char *fmt, ...);
 
+/* event fan-out */
+struct notifier_block;
+
+int pob_ntf_init(struct dentry *pob_debugfs_dir);
+int pob_ntf_register(enum pob_ntf_type type, struct notifier_block *nb);
+int pob_ntf_unregister(enum pob_ntf_type type, struct notifier_block *nb);
+int pob_ntf_call(enum pob_ntf_type type, unsigned long val, void *v);
+int pob_ntf_empty(enum pob_ntf_type type);
+void pob_ntf_dump(enum pob_ntf_type type, char *prefix);
+
 /* QoS */
 int pob_qos_init(struct dentry *pob_debugfs_dir);
 int pob_qos_ind_client_isemtpy(void);
@@ -77,6 +77,7 @@ static int __init pob_init(void)
 	if (!pob_debugfs_dir)
 		return -ENODEV;
 
+	pob_ntf_init(pob_debugfs_dir);
 	pob_qos_init(pob_debugfs_dir);
 
 	return 0;
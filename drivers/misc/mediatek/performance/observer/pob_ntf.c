@@ -0,0 +1,383 @@
+/*
+ * Copyright (C) 2019 MediaTek Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See http://www.gnu.org/licenses/gpl-2.0.html for more details.
+ */
+
+/*
+ * Performance observer event fan-out
+ *
+ * Each event type has an array of subscribers, replaced copy-on-write
+ * under pob_ntf_mutex and read under SRCU, so publishing never takes a
+ * lock shared with other publishers and callbacks may still sleep like
+ * they did on the blocking notifier chains. Publishers can queue typed
+ * records into a pob_ntf_batch and dispatch a burst in one SRCU pass.
+ *
+ * Delivery latency (publish to last subscriber returned) is accounted
+ * per CPU and per type, and exported in debugfs pob/ntf_stats.
+ */
+
+#define pr_fmt(fmt) "pob_ntf: " fmt
+#include <linux/debugfs.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/mutex.h>
+#include <linux/notifier.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/srcu.h>
+#include <linux/string.h>
+#include <mt-plat/mtk_perfobserver.h>
+
+#include "pob_int.h"
+
+struct pob_ntf_subs {
+	int nr;
+	struct notifier_block *nb[];
+};
+
+static struct pob_ntf_subs __rcu *pob_ntf_subs[NR_POB_NTF];
+static DEFINE_MUTEX(pob_ntf_mutex);
+DEFINE_STATIC_SRCU(pob_ntf_srcu);
+
+static DEFINE_PER_CPU(struct pob_ntf_stat [NR_POB_NTF], pob_ntf_stats);
+
+static const char * const pob_ntf_name[NR_POB_NTF] = {
+	[POB_NTF_BQD]		= "bqd",
+	[POB_NTF_FPSGO]		= "fpsgo",
+	[POB_NTF_RS]		= "rs",
+	[POB_NTF_QOS]		= "qos",
+	[POB_NTF_QOS_IND]	= "qos_ind",
+	[POB_NTF_NN]		= "nn",
+	[POB_NTF_XPUFREQ]	= "xpufreq",
+};
+
+int pob_ntf_register(enum pob_ntf_type type, struct notifier_block *nb)
+{
+	struct pob_ntf_subs *old, *new;
+	int i, pos, nr;
+
+	if (type >= NR_POB_NTF || !nb)
+		return -EINVAL;
+
+	mutex_lock(&pob_ntf_mutex);
+	old = rcu_dereference_protected(pob_ntf_subs[type],
+				lockdep_is_held(&pob_ntf_mutex));
+	nr = old ? old->nr : 0;
+
+	for (i = 0; i < nr; i++) {
+		if (old->nb[i] == nb) {
+			mutex_unlock(&pob_ntf_mutex);
+			WARN(1, "double register detected");
+			return 0;
+		}
+	}
+
+	new = kmalloc(sizeof(*new) + (nr + 1) * sizeof(nb), GFP_KERNEL);
+	if (!new) {
+		mutex_unlock(&pob_ntf_mutex);
+		return -ENOMEM;
+	}
+
+	/* same ordering as notifier_chain_register() */
+	for (pos = 0; pos < nr; pos++)
+		if (nb->priority > old->nb[pos]->priority)
+			break;
+
+	for (i = 0; i < pos; i++)
+		new->nb[i] = old->nb[i];
+	new->nb[pos] = nb;
+	for (i = pos; i < nr; i++)
+		new->nb[i + 1] = old->nb[i];
+	new->nr = nr + 1;
+
+	rcu_assign_pointer(pob_ntf_subs[type], new);
+	mutex_unlock(&pob_ntf_mutex);
+
+	synchronize_srcu(&pob_ntf_srcu);
+	kfree(old);
+
+	return 0;
+}
+
+int pob_ntf_unregister(enum pob_ntf_type type, struct notifier_block *nb)
+{
+	struct pob_ntf_subs *old, *new = NULL;
+	int i, j;
+
+	if (type >= NR_POB_NTF)
+		return -EINVAL;
+
+	mutex_lock(&pob_ntf_mutex);
+	old = rcu_dereference_protected(pob_ntf_subs[type],
+				lockdep_is_held(&pob_ntf_mutex));
+
+	for (i = 0; old && i < old->nr; i++)
+		if (old->nb[i] == nb)
+			break;
+
+	if (!old || i == old->nr) {
+		mutex_unlock(&pob_ntf_mutex);
+		return -ENOENT;
+	}
+
+	if (old->nr > 1) {
+		new = kmalloc(sizeof(*new) + (old->nr - 1) * sizeof(nb),
+				GFP_KERNEL);
+		if (!new) {
+			mutex_unlock(&pob_ntf_mutex);
+			return -ENOMEM;
+		}
+
+		for (i = 0, j = 0; i < old->nr; i++)
+			if (old->nb[i] != nb)
+				new->nb[j++] = old->nb[i];
+		new->nr = j;
+	}
+
+	rcu_assign_pointer(pob_ntf_subs[type], new);
+	mutex_unlock(&pob_ntf_mutex);
+
+	/* no callback of nb is running once we return */
+	synchronize_srcu(&pob_ntf_srcu);
+	kfree(old);
+
+	return 0;
+}
+
+int pob_ntf_empty(enum pob_ntf_type type)
+{
+	return !rcu_access_pointer(pob_ntf_subs[type]);
+}
+
+void pob_ntf_dump(enum pob_ntf_type type, char *prefix)
+{
+	struct pob_ntf_subs *subs;
+	int i, idx;
+
+	idx = srcu_read_lock(&pob_ntf_srcu);
+	subs = srcu_dereference(pob_ntf_subs[type], &pob_ntf_srcu);
+	for (i = 0; subs && i < subs->nr; i++)
+		pob_trace("%s %pS", prefix, subs->nb[i]->notifier_call);
+	srcu_read_unlock(&pob_ntf_srcu, idx);
+}
+
+static void pob_ntf_account(enum pob_ntf_type type, u64 ts)
+{
+	struct pob_ntf_stat *stat;
+	u64 lat = ktime_get_ns() - ts;
+	int bucket;
+
+	bucket = min_t(int, ilog2((lat >> 10) | 1), POB_NTF_HIST_NR - 1);
+
+	stat = &get_cpu_var(pob_ntf_stats)[type];
+	stat->events++;
+	stat->lat_sum += lat;
+	if (lat > stat->lat_max)
+		stat->lat_max = lat;
+	stat->hist[bucket]++;
+	put_cpu_var(pob_ntf_stats);
+}
+
+static int __pob_ntf_call(struct pob_ntf_subs *subs, unsigned long val,
+			void *v)
+{
+	int ret = NOTIFY_DONE;
+	int i;
+
+	for (i = 0; subs && i < subs->nr; i++) {
+		ret = subs->nb[i]->notifier_call(subs->nb[i], val, v);
+		if (ret & NOTIFY_STOP_MASK)
+			break;
+	}
+
+	return ret;
+}
+
+int pob_ntf_call(enum pob_ntf_type type, unsigned long val, void *v)
+{
+	struct pob_ntf_subs *subs;
+	u64 ts = ktime_get_ns();
+	int ret = NOTIFY_DONE;
+	int idx;
+
+	if (!rcu_access_pointer(pob_ntf_subs[type]))
+		return ret;
+
+	idx = srcu_read_lock(&pob_ntf_srcu);
+	subs = srcu_dereference(pob_ntf_subs[type], &pob_ntf_srcu);
+	ret = __pob_ntf_call(subs, val, v);
+	srcu_read_unlock(&pob_ntf_srcu, idx);
+
+	pob_ntf_account(type, ts);
+
+	return ret;
+}
+
+int pob_ntf_batch_add(struct pob_ntf_batch *batch, enum pob_ntf_type type,
+			unsigned long val, const void *v, size_t size)
+{
+	struct pob_ntf_rec *rec;
+
+	if (type >= NR_POB_NTF || size > POB_NTF_PAYLOAD_MAX)
+		return -EINVAL;
+
+	/* nobody listening, nothing to record */
+	if (!rcu_access_pointer(pob_ntf_subs[type]))
+		return 0;
+
+	if (batch->nr == batch->max)
+		pob_ntf_batch_flush(batch);
+
+	rec = &batch->rec[batch->nr++];
+	rec->ts = ktime_get_ns();
+	rec->val = val;
+	rec->type = type;
+	rec->has_payload = !!v;
+	if (v)
+		memcpy(rec->payload, v, size);
+
+	return 0;
+}
+EXPORT_SYMBOL(pob_ntf_batch_add);
+
+void pob_ntf_batch_flush(struct pob_ntf_batch *batch)
+{
+	struct pob_ntf_subs *subs;
+	struct pob_ntf_rec *rec;
+	int i, idx;
+
+	if (!batch->nr)
+		return;
+
+	idx = srcu_read_lock(&pob_ntf_srcu);
+	for (i = 0; i < batch->nr; i++) {
+		rec = &batch->rec[i];
+		subs = srcu_dereference(pob_ntf_subs[rec->type],
+					&pob_ntf_srcu);
+		__pob_ntf_call(subs, rec->val,
+			rec->has_payload ? rec->payload : NULL);
+		pob_ntf_account(rec->type, rec->ts);
+	}
+	srcu_read_unlock(&pob_ntf_srcu, idx);
+
+	batch->nr = 0;
+}
+EXPORT_SYMBOL(pob_ntf_batch_flush);
+
+void pob_ntf_get_stat(enum pob_ntf_type type, struct pob_ntf_stat *sum)
+{
+	struct pob_ntf_stat *stat;
+	int cpu, i;
+
+	memset(sum, 0, sizeof(*sum));
+	if (type >= NR_POB_NTF)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		stat = &per_cpu(pob_ntf_stats, cpu)[type];
+		sum->events += stat->events;
+		sum->lat_sum += stat->lat_sum;
+		sum->lat_max = max(sum->lat_max, stat->lat_max);
+		for (i = 0; i < POB_NTF_HIST_NR; i++)
+			sum->hist[i] += stat->hist[i];
+	}
+}
+EXPORT_SYMBOL(pob_ntf_get_stat);
+
+void pob_ntf_reset_stat(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(per_cpu(pob_ntf_stats, cpu), 0,
+			sizeof(per_cpu(pob_ntf_stats, cpu)));
+}
+EXPORT_SYMBOL(pob_ntf_reset_stat);
+
+/* upper bound (us) of the histogram bucket holding the pct percentile */
+static u64 pob_ntf_pct_us(struct pob_ntf_stat *s, int pct)
+{
+	u64 target = div_u64(s->events * pct, 100);
+	u64 acc = 0;
+	int i;
+
+	for (i = 0; i < POB_NTF_HIST_NR; i++) {
+		acc += s->hist[i];
+		if (acc > target)
+			break;
+	}
+
+	return 1ULL << (min(i, POB_NTF_HIST_NR - 1) + 1);
+}
+
+static int pob_ntf_stats_show(struct seq_file *m, void *unused)
+{
+	struct pob_ntf_stat s;
+	struct pob_ntf_subs *subs;
+	int type, nr, idx;
+
+	seq_puts(m, "type subscribers events avg_ns max_ns p50_us p99_us\n");
+	for (type = 0; type < NR_POB_NTF; type++) {
+		pob_ntf_get_stat(type, &s);
+
+		idx = srcu_read_lock(&pob_ntf_srcu);
+		subs = srcu_dereference(pob_ntf_subs[type], &pob_ntf_srcu);
+		nr = subs ? subs->nr : 0;
+		srcu_read_unlock(&pob_ntf_srcu, idx);
+
+		seq_printf(m, "%s %d %llu %llu %llu %llu %llu\n",
+			pob_ntf_name[type], nr, s.events,
+			s.events ? div64_u64(s.lat_sum, s.events) : 0,
+			s.lat_max,
+			s.events ? pob_ntf_pct_us(&s, 50) : 0,
+			s.events ? pob_ntf_pct_us(&s, 99) : 0);
+	}
+
+	return 0;
+}
+
+static int pob_ntf_stats_open(struct inode *i, struct file *file)
+{
+	return single_open(file, pob_ntf_stats_show, i->i_private);
+}
+
+static ssize_t pob_ntf_stats_write(struct file *flip,
+			const char *ubuf, size_t cnt, loff_t *data)
+{
+	pob_ntf_reset_stat();
+
+	return cnt;
+}
+
+static const struct file_operations pob_ntf_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = pob_ntf_stats_open,
+	.read = seq_read,
+	.write = pob_ntf_stats_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+int __init pob_ntf_init(struct dentry *pob_debugfs_dir)
+{
+	if (!pob_debugfs_dir)
+		return -ENODEV;
+
+	debugfs_create_file("ntf_stats",
+			    0644,
+			    pob_debugfs_dir,
+			    NULL,
+			    &pob_ntf_stats_fops);
+
+	return 0;
+}
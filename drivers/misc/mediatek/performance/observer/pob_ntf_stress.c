@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2019 MediaTek Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See http://www.gnu.org/licenses/gpl-2.0.html for more details.
+ */
+
+/*
+ * Performance observer fan-out stress test
+ *
+ * One kthread per online CPU publishes synthetic FPSGO and QoS events,
+ * synchronously and in batches, to nr_subs subscribers per type. The
+ * events use info number POB_STRESS_VAL, which real subscribers ignore.
+ * Throughput and publish-to-callback latency percentiles are printed
+ * when the module is loaded.
+ */
+
+#define pr_fmt(fmt) "pob_stress: " fmt
+#include <linux/cpu.h>
+#include <linux/delay.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/module.h>
+#include <linux/notifier.h>
+#include <linux/percpu.h>
+#include <linux/slab.h>
+#include <mt-plat/mtk_perfobserver.h>
+
+#define POB_STRESS_VAL		0x5757
+#define POB_STRESS_HIST_NR	32	/* log2(ns) */
+#define POB_STRESS_BATCH_MAX	16
+
+static unsigned int duration_ms = 2000;
+module_param(duration_ms, uint, 0444);
+MODULE_PARM_DESC(duration_ms, "Stress duration");
+
+static unsigned int nr_subs = 4;
+module_param(nr_subs, uint, 0444);
+MODULE_PARM_DESC(nr_subs, "Subscribers per event type");
+
+static unsigned int batch = 8;
+module_param(batch, uint, 0444);
+MODULE_PARM_DESC(batch, "Events per batch, 0 = synchronous only");
+
+struct pob_stress_fpsgo {
+	struct pob_fpsgo_fpsstats_info info;
+	u64 ts;
+};
+
+struct pob_stress_qos {
+	struct pob_qos_info info;
+	u64 ts;
+};
+
+struct pob_stress_stat {
+	u64 published;
+	u64 delivered;
+	u64 hist[POB_STRESS_HIST_NR];
+	u64 max;
+};
+
+static DEFINE_PER_CPU(struct pob_stress_stat, pob_stress_stats);
+static struct notifier_block *pob_stress_nb;
+
+static void pob_stress_lat(u64 ts)
+{
+	struct pob_stress_stat *stat;
+	u64 lat = ktime_get_ns() - ts;
+
+	stat = &get_cpu_var(pob_stress_stats);
+	stat->delivered++;
+	stat->hist[min_t(int, ilog2(lat | 1), POB_STRESS_HIST_NR - 1)]++;
+	if (lat > stat->max)
+		stat->max = lat;
+	put_cpu_var(pob_stress_stats);
+}
+
+static int pob_stress_fpsgo_cb(struct notifier_block *nb,
+			unsigned long val, void *data)
+{
+	struct pob_stress_fpsgo *ev = data;
+
+	if (val != POB_STRESS_VAL || !ev)
+		return NOTIFY_DONE;
+
+	pob_stress_lat(ev->ts);
+	return NOTIFY_OK;
+}
+
+static int pob_stress_qos_cb(struct notifier_block *nb,
+			unsigned long val, void *data)
+{
+	struct pob_stress_qos *ev = data;
+
+	if (val != POB_STRESS_VAL || !ev)
+		return NOTIFY_DONE;
+
+	pob_stress_lat(ev->ts);
+	return NOTIFY_OK;
+}
+
+static int pob_stress_fn(void *data)
+{
+	struct pob_ntf_rec rec[POB_STRESS_BATCH_MAX];
+	struct pob_ntf_batch b = {
+		.max = min_t(unsigned int, batch, POB_STRESS_BATCH_MAX),
+		.rec = rec,
+	};
+	struct pob_stress_fpsgo fev = { .info.tskid = current->pid };
+	struct pob_stress_qos qev = { .info.size = 0 };
+	u64 published = 0;
+	int i;
+
+	while (!kthread_should_stop()) {
+		fev.ts = ktime_get_ns();
+		pob_fpsgo_fstb_stats_update(POB_STRESS_VAL, &fev.info);
+
+		qev.ts = ktime_get_ns();
+		pob_qos_monitor_update((enum pob_qos_info_num)POB_STRESS_VAL,
+					&qev);
+
+		published += 2;
+
+		for (i = 0; i < b.max; i++) {
+			fev.ts = ktime_get_ns();
+			pob_ntf_batch_add(&b, POB_NTF_FPSGO, POB_STRESS_VAL,
+				&fev, sizeof(fev));
+		}
+		pob_ntf_batch_flush(&b);
+		published += b.max;
+
+		cond_resched();
+	}
+
+	this_cpu_add(pob_stress_stats.published, published);
+
+	return 0;
+}
+
+static u64 pob_stress_pct(struct pob_stress_stat *s, int permille)
+{
+	u64 target = div_u64(s->delivered * permille, 1000);
+	u64 acc = 0;
+	int i;
+
+	for (i = 0; i < POB_STRESS_HIST_NR; i++) {
+		acc += s->hist[i];
+		if (acc > target)
+			break;
+	}
+
+	return 2ULL << min(i, POB_STRESS_HIST_NR - 1);
+}
+
+static void pob_stress_report_ntf(enum pob_ntf_type type, const char *name)
+{
+	struct pob_ntf_stat ns;
+
+	pob_ntf_get_stat(type, &ns);
+	pr_info("%s events %llu avg %llu max %llu ns\n", name, ns.events,
+		ns.events ? div64_u64(ns.lat_sum, ns.events) : 0, ns.lat_max);
+}
+
+static void pob_stress_report(void)
+{
+	struct pob_stress_stat sum = {0}, *s;
+	int cpu, i;
+
+	for_each_possible_cpu(cpu) {
+		s = per_cpu_ptr(&pob_stress_stats, cpu);
+		sum.published += s->published;
+		sum.delivered += s->delivered;
+		sum.max = max(sum.max, s->max);
+		for (i = 0; i < POB_STRESS_HIST_NR; i++)
+			sum.hist[i] += s->hist[i];
+	}
+
+	pr_info("cpus %u subs %u batch %u duration %u ms\n",
+		num_online_cpus(), nr_subs, batch, duration_ms);
+	pr_info("published %llu delivered %llu (%llu events/s)\n",
+		sum.published, sum.delivered,
+		div_u64(sum.published * MSEC_PER_SEC, duration_ms));
+	if (sum.delivered)
+		pr_info("latency p50 <%llu p99 <%llu p99.9 <%llu max %llu ns\n",
+			pob_stress_pct(&sum, 500), pob_stress_pct(&sum, 990),
+			pob_stress_pct(&sum, 999), sum.max);
+
+	pob_stress_report_ntf(POB_NTF_FPSGO, "fpsgo");
+	pob_stress_report_ntf(POB_NTF_QOS, "qos");
+}
+
+static int __init pob_stress_init(void)
+{
+	struct task_struct **tsk;
+	unsigned int i;
+	int cpu, ret = 0;
+
+	if (!nr_subs || !duration_ms)
+		return -EINVAL;
+
+	pob_stress_nb = kcalloc(2 * nr_subs, sizeof(*pob_stress_nb),
+				GFP_KERNEL);
+	tsk = kcalloc(nr_cpu_ids, sizeof(*tsk), GFP_KERNEL);
+	if (!pob_stress_nb || !tsk) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	for (i = 0; i < nr_subs; i++) {
+		pob_stress_nb[2 * i].notifier_call = pob_stress_fpsgo_cb;
+		pob_fpsgo_register_client(&pob_stress_nb[2 * i]);
+		pob_stress_nb[2 * i + 1].notifier_call = pob_stress_qos_cb;
+		pob_qos_register_client(&pob_stress_nb[2 * i + 1]);
+	}
+
+	pob_ntf_reset_stat();
+
+	get_online_cpus();
+	for_each_online_cpu(cpu) {
+		tsk[cpu] = kthread_create_on_node(pob_stress_fn, NULL,
+					cpu_to_node(cpu), "pob_stress/%d", cpu);
+		if (IS_ERR(tsk[cpu])) {
+			tsk[cpu] = NULL;
+			continue;
+		}
+		kthread_bind(tsk[cpu], cpu);
+		wake_up_process(tsk[cpu]);
+	}
+	put_online_cpus();
+
+	msleep(duration_ms);
+
+	for_each_possible_cpu(cpu)
+		if (tsk[cpu])
+			kthread_stop(tsk[cpu]);
+
+	for (i = 0; i < nr_subs; i++) {
+		pob_fpsgo_unregister_client(&pob_stress_nb[2 * i]);
+		pob_qos_unregister_client(&pob_stress_nb[2 * i + 1]);
+	}
+
+	pob_stress_report();
+
+out_free:
+	kfree(tsk);
+	kfree(pob_stress_nb);
+	pob_stress_nb = NULL;
+
+	return ret;
+}
+
+static void __exit pob_stress_exit(void)
+{
+}
+
+module_init(pob_stress_init);
+module_exit(pob_stress_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("MediaTek Performance Observer fan-out stress test");
+MODULE_AUTHOR("MediaTek Inc.");
@@ -83,9 +83,6 @@ struct pob_qos_trace_info {
 			struct pob_qos_info *pqi);
 };
 
-static BLOCKING_NOTIFIER_HEAD(pob_qos_notifier_list);
-static BLOCKING_NOTIFIER_HEAD(pob_qos_ind_notifier_list);
-
 static DEFINE_MUTEX(pob_qos_ntf_mutex);
 static int pob_qos_ntf_cnt;
 
@@ -107,41 +104,6 @@ static void pob_fn_tracelog(void *pfn, char *prefix)
 	_trace_pob_log(log);
 }
 
-static int __pob_dump_ntf_callchain(struct notifier_block **nl, char *prefix)
-{
-	int ret = NOTIFY_DONE;
-	struct notifier_block *nb, *next_nb;
-
-	nb = rcu_dereference_raw(*nl);
-
-	while (nb) {
-		next_nb = rcu_dereference_raw(nb->next);
-
-		pob_fn_tracelog(nb->notifier_call, prefix);
-
-		nb = next_nb;
-	}
-	return ret;
-}
-
-static int pob_dump_ntf_callchain(struct blocking_notifier_head *nh,
-					char *prefix)
-{
-	int ret = NOTIFY_DONE;
-
-	/*
-	 * We check the head outside the lock, but if this access is
-	 * racy then it does not matter what the result of the test
-	 * is, we re-check the list after having taken the lock anyway:
-	 */
-	if (rcu_access_pointer(nh->head)) {
-		down_read(&nh->rwsem);
-		ret = __pob_dump_ntf_callchain(&nh->head, prefix);
-		up_read(&nh->rwsem);
-	}
-	return ret;
-}
-
 int pob_qos_register_client(struct notifier_block *nb)
 {
 	mutex_lock(&pob_qos_ntf_mutex);
@@ -153,10 +115,10 @@ int pob_qos_register_client(struct notifier_block *nb)
 	mutex_unlock(&pob_qos_ntf_mutex);
 
 	pob_fn_tracelog(nb->notifier_call, "pob_qos register_client");
-	pob_dump_ntf_callchain(&pob_qos_notifier_list,
-				"pob_qos register_client before");
-	return blocking_notifier_chain_register(&pob_qos_notifier_list, nb);
+	pob_ntf_dump(POB_NTF_QOS, "pob_qos register_client before");
+	return pob_ntf_register(POB_NTF_QOS, nb);
 }
+EXPORT_SYMBOL(pob_qos_register_client);
 
 int pob_qos_unregister_client(struct notifier_block *nb)
 {
@@ -170,14 +132,14 @@ int pob_qos_unregister_client(struct notifier_block *nb)
 	mutex_unlock(&pob_qos_ntf_mutex);
 
 	pob_fn_tracelog(nb->notifier_call, "pob_qos unregister_client");
-	pob_dump_ntf_callchain(&pob_qos_notifier_list,
-				"pob_qos unregister_client before");
-	return blocking_notifier_chain_unregister(&pob_qos_notifier_list, nb);
+	pob_ntf_dump(POB_NTF_QOS, "pob_qos unregister_client before");
+	return pob_ntf_unregister(POB_NTF_QOS, nb);
 }
+EXPORT_SYMBOL(pob_qos_unregister_client);
 
 int pob_qos_notifier_call_chain(unsigned long val, void *v)
 {
-	return blocking_notifier_call_chain(&pob_qos_notifier_list, val, v);
+	return pob_ntf_call(POB_NTF_QOS, val, v);
 }
 
 int pob_qos_monitor_update(enum pob_qos_info_num info_num, void *v)
@@ -186,23 +148,21 @@ int pob_qos_monitor_update(enum pob_qos_info_num info_num, void *v)
 
 	return 0;
 }
+EXPORT_SYMBOL(pob_qos_monitor_update);
 
 int pob_qos_ind_register_client(struct notifier_block *nb)
 {
-	return blocking_notifier_chain_register(&pob_qos_ind_notifier_list,
-							nb);
+	return pob_ntf_register(POB_NTF_QOS_IND, nb);
 }
 
 int pob_qos_ind_unregister_client(struct notifier_block *nb)
 {
-	return blocking_notifier_chain_unregister(&pob_qos_ind_notifier_list,
-							nb);
+	return pob_ntf_unregister(POB_NTF_QOS_IND, nb);
 }
 
 int pob_qos_ind_notifier_call_chain(unsigned long val, void *v)
 {
-	return blocking_notifier_call_chain(&pob_qos_ind_notifier_list,
-						val, v);
+	return pob_ntf_call(POB_NTF_QOS_IND, val, v);
 }
 
 int pob_qos_ind_monitor_update(enum pob_qos_ind_info_num info_num, void *v)
@@ -214,10 +174,7 @@ int pob_qos_ind_monitor_update(enum pob_qos_ind_info_num info_num, void *v)
 
 int pob_qos_ind_client_isemtpy(void)
 {
-	if (pob_qos_ind_notifier_list.head)
-		return 0;
-
-	return 1;
+	return pob_ntf_empty(POB_NTF_QOS_IND);
 }
 
 enum {
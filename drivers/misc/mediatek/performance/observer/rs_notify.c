@@ -14,21 +14,21 @@
 #include <linux/notifier.h>
 #include <mt-plat/mtk_perfobserver.h>
 
-static BLOCKING_NOTIFIER_HEAD(pob_rs_notifier_list);
+#include "pob_int.h"
 
 int pob_rs_register_client(struct notifier_block *nb)
 {
-	return blocking_notifier_chain_register(&pob_rs_notifier_list, nb);
+	return pob_ntf_register(POB_NTF_RS, nb);
 }
 
 int pob_rs_unregister_client(struct notifier_block *nb)
 {
-	return blocking_notifier_chain_unregister(&pob_rs_notifier_list, nb);
+	return pob_ntf_unregister(POB_NTF_RS, nb);
 }
 
 int pob_rs_notifier_call_chain(unsigned long val, void *v)
 {
-	return blocking_notifier_call_chain(&pob_rs_notifier_list, val, v);
+	return pob_ntf_call(POB_NTF_RS, val, v);
 }
 
 int pob_rs_fps_update(enum pob_rs_info_num info_num)
@@ -14,24 +14,23 @@
 #include <linux/notifier.h>
 #include <mt-plat/mtk_perfobserver.h>
 
-static BLOCKING_NOTIFIER_HEAD(pob_xpufreq_notifier_list);
+#include "pob_int.h"
 
 int pob_xpufreq_register_client(struct notifier_block *nb)
 {
-	return blocking_notifier_chain_register(&pob_xpufreq_notifier_list, nb);
+	return pob_ntf_register(POB_NTF_XPUFREQ, nb);
 }
 EXPORT_SYMBOL(pob_xpufreq_register_client);
 
 int pob_xpufreq_unregister_client(struct notifier_block *nb)
 {
-	return blocking_notifier_chain_unregister(&pob_xpufreq_notifier_list,
-							nb);
+	return pob_ntf_unregister(POB_NTF_XPUFREQ, nb);
 }
 EXPORT_SYMBOL(pob_xpufreq_unregister_client);
 
 int pob_xpufreq_notifier_call_chain(unsigned long val, void *v)
 {
-	return blocking_notifier_call_chain(&pob_xpufreq_notifier_list, val, v);
+	return pob_ntf_call(POB_NTF_XPUFREQ, val, v);
 }
 
 int pob_xpufreq_update(enum pob_xpufreq_info_num info_num,
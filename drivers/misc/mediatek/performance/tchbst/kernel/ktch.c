@@ -83,14 +83,17 @@ static int ktchboost_thread(void *ptr)
 {
 	int event, core, freq;
 	unsigned long flags;
+	long timeout = MAX_SCHEDULE_TIMEOUT;
 
 	set_user_nice(current, -10);
 
 	while (!kthread_should_stop()) {
 
-		while (!atomic_read(&ktchboost.event))
-			wait_event(ktchboost.wq, atomic_read(&ktchboost.event));
-		atomic_dec(&ktchboost.event);
+		/* gesture boost may ask to be re-evaluated without events */
+		wait_event_timeout(ktchboost.wq,
+				atomic_read(&ktchboost.event) ||
+				kthread_should_stop(), timeout);
+		atomic_set(&ktchboost.event, 0);
 
 		spin_lock_irqsave(&ktchboost.touch_lock, flags);
 		event = ktchboost.touch_event;
@@ -98,8 +101,13 @@ static int ktchboost_thread(void *ptr)
 		freq = ktch_mgr_freq;
 		spin_unlock_irqrestore(&ktchboost.touch_lock, flags);
 		pr_debug("%s\n", __func__);
-		set_freq(event, core, freq);
 
+		if (ktch_gest_enable) {
+			timeout = ktch_gest_work(freq);
+		} else {
+			timeout = MAX_SCHEDULE_TIMEOUT;
+			set_freq(event, core, freq);
+		}
 	}
 	return 0;
 }
@@ -273,6 +281,14 @@ static void dbs_input_event(struct input_handle *handle, unsigned int type,
 	if (!ktch_mgr_enable)
 		return;
 
+	if (ktch_gest_enable) {
+		if (ktch_gest_event(handle->dev, type, code, value)) {
+			atomic_inc(&ktchboost.event);
+			wake_up(&ktchboost.wq);
+		}
+		return;
+	}
+
 	if ((type == EV_KEY) && (code == BTN_TOUCH)) {
 		pr_debug("input cb, type:%d, code:%d, value:%d\n",
 				type, code, value);
@@ -377,6 +393,9 @@ int init_ktch(struct proc_dir_entry *parent)
 	if (!tbclstr_dir)
 		pr_debug("tbclstr_dir not create\n");
 
+	if (ktch_gest_init(ktch_root))
+		pr_debug("ktch_gest not create\n");
+
 	spin_lock_init(&ktchboost.touch_lock);
 	init_waitqueue_head(&ktchboost.wq);
 	atomic_set(&ktchboost.event, 0);
@@ -394,6 +413,7 @@ int ktch_suspend(void)
 {
 	/*pr_debug(TAG"perfmgr_touch_suspend\n");*/
 
+	ktch_gest_reset();
 	set_freq(0, 0, 0);
 
 	return 0;
@@ -0,0 +1,567 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Gesture aware kernel touch boost
+ *
+ * The input handler of ktch feeds every event of the touch screen to
+ * ktch_gest_event(), which tracks the first finger and its velocity in
+ * per-mille of the screen width per second. The ktch thread turns the
+ * state into a boost with ktch_gest_work():
+ *
+ *  tap    finger lifted before press_ms and within slop, short boost
+ *  press  finger held still for press_ms, low boost until lifted
+ *  drag   finger moving, boost scaled with velocity, short hold after
+ *  fling  lifted while moving fast, boost scaled with release velocity
+ *         and ramped down over the expected fling duration
+ *
+ * Every boost is an update_userlimit_cpu_freq_timeout() request with
+ * a timeout, so the boost is dropped by cpu_ctrl even if the thread is
+ * late. Levels are percentages of tb_freq, see tb_policy.
+ */
+
+#define pr_fmt(fmt) "[ktch_gest]"fmt
+
+#include <linux/input.h>
+#include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+
+#include "tchbst.h"
+#include "boost_ctrl.h"
+#include "mtk_perfmgr_internal.h"
+
+#define KTCH_GEST_TIMELINE_NR	64
+#define KTCH_GEST_RAMP_STEPS	4
+#define KTCH_GEST_REPORT_NS	(16 * NSEC_PER_MSEC)
+
+enum {
+	KTCH_GEST_NONE = 0,
+	KTCH_GEST_TAP,
+	KTCH_GEST_PRESS,
+	KTCH_GEST_DRAG,
+	KTCH_GEST_FLING,
+	NR_KTCH_GEST
+};
+
+static const char * const ktch_gest_name[NR_KTCH_GEST] = {
+	"none", "tap", "press", "drag", "fling",
+};
+
+/*
+ * Level is min_pct at v_lo and below, max_pct at v_hi and above.
+ * hold_ms is kept after the finger is lifted; for fling it is the
+ * longest expected fling.
+ */
+struct ktch_gest_policy {
+	int min_pct;
+	int max_pct;
+	int v_lo;
+	int v_hi;
+	int hold_ms;
+};
+
+static struct ktch_gest_policy ktch_gest_policy[NR_KTCH_GEST] = {
+	[KTCH_GEST_TAP]   = { 100, 100,    0,    0,   80 },
+	[KTCH_GEST_PRESS] = {  60,  60,    0,    0,    0 },
+	[KTCH_GEST_DRAG]  = {  50, 100,  200, 3000,   50 },
+	[KTCH_GEST_FLING] = {  70, 100, 1500, 8000, 1200 },
+};
+
+static int ktch_gest_slop = 20;		/* per-mille of width */
+static int ktch_gest_press_ms = 300;
+static int ktch_gest_decel = 8000;	/* per-mille of width / s^2 */
+
+struct ktch_gest_rec {
+	u64 ts;
+	int class;
+	int velocity;
+	int freq;
+	int timeout_ms;
+};
+
+static struct {
+	spinlock_t lock;
+
+	/* input side, event context */
+	bool down;
+	bool up;		/* lifted, not seen by the thread yet */
+	bool frame_down;
+	bool frame_up;
+	int slot;
+	int nx, ny;
+	int x, y;
+	int x0, y0;
+	int width;
+	u64 down_ns;
+	u64 up_ns;
+	u64 last_ns;
+	u64 last_move_ns;
+	u64 last_report_ns;
+	int travel;
+	int velocity;
+	int reported_velocity;
+	int up_velocity;
+	int up_travel;
+
+	/* thread side */
+	int base_freq;
+	int class;
+	int freq;
+	u64 ramp_start;
+	int ramp_ms;
+	int ramp_pct;
+
+	struct ktch_gest_rec timeline[KTCH_GEST_TIMELINE_NR];
+	unsigned int timeline_head;
+} kg;
+
+/* off by default, tb_gesture turns it on */
+int ktch_gest_enable;
+
+static int ktch_gest_width(struct input_dev *dev)
+{
+	int w = 0;
+
+	if (test_bit(ABS_MT_POSITION_X, dev->absbit))
+		w = input_abs_get_max(dev, ABS_MT_POSITION_X) -
+			input_abs_get_min(dev, ABS_MT_POSITION_X);
+	else if (test_bit(ABS_X, dev->absbit))
+		w = input_abs_get_max(dev, ABS_X) -
+			input_abs_get_min(dev, ABS_X);
+
+	return w > 0 ? w : 1000;
+}
+
+/* per-mille of width */
+static int ktch_gest_dist(int dx, int dy)
+{
+	return (abs(dx) + abs(dy)) * 1000 / kg.width;
+}
+
+/*
+ * Called from the input handler with the device event lock held.
+ * Returns true when the thread should re-evaluate the boost.
+ */
+bool ktch_gest_event(struct input_dev *dev, unsigned int type,
+		unsigned int code, int value)
+{
+	unsigned long flags;
+	bool wake = false;
+	u64 now, dt;
+	int inst;
+
+	spin_lock_irqsave(&kg.lock, flags);
+
+	switch (type) {
+	case EV_KEY:
+		if (code != BTN_TOUCH)
+			break;
+		if (value)
+			kg.frame_down = true;
+		else
+			kg.frame_up = true;
+		break;
+	case EV_ABS:
+		switch (code) {
+		case ABS_MT_SLOT:
+			kg.slot = value;
+			break;
+		case ABS_MT_POSITION_X:
+			if (!kg.slot)
+				kg.nx = value;
+			break;
+		case ABS_MT_POSITION_Y:
+			if (!kg.slot)
+				kg.ny = value;
+			break;
+		case ABS_X:
+			kg.nx = value;
+			break;
+		case ABS_Y:
+			kg.ny = value;
+			break;
+		}
+		break;
+	case EV_SYN:
+		if (code != SYN_REPORT)
+			break;
+
+		now = ktime_get_ns();
+
+		if (kg.frame_down && !kg.down) {
+			kg.down = true;
+			kg.up = false;
+			kg.width = ktch_gest_width(dev);
+			kg.x = kg.x0 = kg.nx;
+			kg.y = kg.y0 = kg.ny;
+			kg.down_ns = kg.last_ns = kg.last_move_ns = now;
+			kg.last_report_ns = now;
+			kg.travel = 0;
+			kg.velocity = 0;
+			kg.reported_velocity = 0;
+			wake = true;
+		} else if (kg.down && (kg.nx != kg.x || kg.ny != kg.y)) {
+			dt = max_t(u64, now - kg.last_ns, NSEC_PER_MSEC);
+			inst = min_t(u64, 100000, div64_u64((u64)ktch_gest_dist(
+					kg.nx - kg.x, kg.ny - kg.y) * NSEC_PER_SEC,
+					dt));
+			kg.velocity = (3 * kg.velocity + inst) / 4;
+			kg.travel = max(kg.travel, ktch_gest_dist(
+					kg.nx - kg.x0, kg.ny - kg.y0));
+			kg.x = kg.nx;
+			kg.y = kg.ny;
+			kg.last_move_ns = now;
+
+			/* rate limited, only for a noticeable change */
+			if (now - kg.last_report_ns >= KTCH_GEST_REPORT_NS &&
+			    abs(kg.velocity - kg.reported_velocity) * 10 >
+			    kg.reported_velocity) {
+				kg.reported_velocity = kg.velocity;
+				kg.last_report_ns = now;
+				wake = true;
+			}
+		}
+		kg.last_ns = now;
+
+		if (kg.frame_up && kg.down) {
+			kg.down = false;
+			kg.up = true;
+			kg.up_ns = now;
+			kg.up_travel = kg.travel;
+			/* finger stopped before lifting, no fling */
+			kg.up_velocity = now - kg.last_move_ns <
+				50 * NSEC_PER_MSEC ? kg.velocity : 0;
+			wake = true;
+		}
+
+		kg.frame_down = false;
+		kg.frame_up = false;
+		break;
+	}
+
+	spin_unlock_irqrestore(&kg.lock, flags);
+
+	return wake;
+}
+
+static int ktch_gest_pct(int class, int velocity)
+{
+	struct ktch_gest_policy *p = &ktch_gest_policy[class];
+	int pct;
+
+	if (velocity <= p->v_lo || p->v_hi <= p->v_lo)
+		pct = p->min_pct;
+	else if (velocity >= p->v_hi)
+		pct = p->max_pct;
+	else
+		pct = p->min_pct + (p->max_pct - p->min_pct) *
+			(velocity - p->v_lo) / (p->v_hi - p->v_lo);
+
+	/* 5% steps, avoid a new request for every report */
+	return clamp(pct / 5 * 5, 0, 100);
+}
+
+static void ktch_gest_apply(int class, int velocity, int pct, int timeout_ms)
+{
+	struct ppm_limit_data freq_to_set[perfmgr_clusters];
+	struct ktch_gest_rec *rec;
+	unsigned long flags;
+	int i, freq;
+
+	freq = pct ? kg.base_freq * pct / 100 : 0;
+	if (freq == kg.freq && class == kg.class && !timeout_ms)
+		return;
+
+	for (i = 0; i < perfmgr_clusters; i++) {
+		freq_to_set[i].min = -1;
+		freq_to_set[i].max = -1;
+	}
+	if (freq)
+		freq_to_set[get_min_clstr_cap()].min = freq;
+
+	update_userlimit_cpu_freq_timeout(CPU_KIR_PERFTOUCH,
+			perfmgr_clusters, freq_to_set, freq ? timeout_ms : 0);
+
+	/* a timed request is dropped by cpu_ctrl, not by us */
+	kg.class = timeout_ms ? KTCH_GEST_NONE : class;
+	kg.freq = timeout_ms ? 0 : freq;
+
+	spin_lock_irqsave(&kg.lock, flags);
+	rec = &kg.timeline[kg.timeline_head++ % KTCH_GEST_TIMELINE_NR];
+	rec->ts = ktime_get_ns();
+	rec->class = class;
+	rec->velocity = velocity;
+	rec->freq = freq;
+	rec->timeout_ms = timeout_ms;
+	spin_unlock_irqrestore(&kg.lock, flags);
+}
+
+static long ktch_gest_ramp(u64 now)
+{
+	struct ktch_gest_policy *p = &ktch_gest_policy[KTCH_GEST_FLING];
+	int elapsed, step, pct;
+
+	elapsed = div_u64(now - kg.ramp_start, NSEC_PER_MSEC);
+	if (elapsed >= kg.ramp_ms) {
+		kg.ramp_ms = 0;
+		ktch_gest_apply(KTCH_GEST_NONE, 0, 0, 0);
+		return MAX_SCHEDULE_TIMEOUT;
+	}
+
+	/* ramp down from the release level to min_pct */
+	step = elapsed * KTCH_GEST_RAMP_STEPS / kg.ramp_ms;
+	pct = kg.ramp_pct - (kg.ramp_pct - p->min_pct) * step /
+		KTCH_GEST_RAMP_STEPS;
+	ktch_gest_apply(KTCH_GEST_FLING, 0, pct / 5 * 5,
+			kg.ramp_ms - elapsed);
+
+	return msecs_to_jiffies(kg.ramp_ms * (step + 1) /
+			KTCH_GEST_RAMP_STEPS - elapsed);
+}
+
+/*
+ * Called from the ktch thread. Returns the time until the boost has
+ * to be re-evaluated without a new event.
+ */
+long ktch_gest_work(int base_freq)
+{
+	unsigned long flags;
+	bool down, up;
+	int travel, velocity, class, dur, pct;
+	u64 now, down_ns, up_ns;
+
+	spin_lock_irqsave(&kg.lock, flags);
+	down = kg.down;
+	up = kg.up;
+	kg.up = false;
+	down_ns = kg.down_ns;
+	up_ns = kg.up_ns;
+	travel = up ? kg.up_travel : kg.travel;
+	velocity = up ? kg.up_velocity : kg.velocity;
+	spin_unlock_irqrestore(&kg.lock, flags);
+
+	now = ktime_get_ns();
+	kg.base_freq = base_freq;
+
+	if (down) {
+		/* a new touch stops the fling ramp */
+		kg.ramp_ms = 0;
+
+		if (travel >= ktch_gest_slop) {
+			ktch_gest_apply(KTCH_GEST_DRAG, velocity,
+				ktch_gest_pct(KTCH_GEST_DRAG, velocity), 0);
+			return MAX_SCHEDULE_TIMEOUT;
+		}
+
+		dur = div_u64(now - down_ns, NSEC_PER_MSEC);
+		if (dur < ktch_gest_press_ms) {
+			/* tap until proven otherwise */
+			ktch_gest_apply(KTCH_GEST_TAP, 0,
+				ktch_gest_pct(KTCH_GEST_TAP, 0), 0);
+			return msecs_to_jiffies(ktch_gest_press_ms - dur);
+		}
+
+		ktch_gest_apply(KTCH_GEST_PRESS, 0,
+			ktch_gest_pct(KTCH_GEST_PRESS, 0), 0);
+		return MAX_SCHEDULE_TIMEOUT;
+	}
+
+	if (up) {
+		if (travel < ktch_gest_slop)
+			class = div_u64(up_ns - down_ns, NSEC_PER_MSEC) <
+				ktch_gest_press_ms ?
+				KTCH_GEST_TAP : KTCH_GEST_PRESS;
+		else if (velocity >= ktch_gest_policy[KTCH_GEST_FLING].v_lo)
+			class = KTCH_GEST_FLING;
+		else
+			class = KTCH_GEST_DRAG;
+
+		if (class != KTCH_GEST_FLING) {
+			pct = ktch_gest_policy[class].hold_ms ?
+				ktch_gest_pct(class, velocity) : 0;
+			ktch_gest_apply(class, velocity, pct,
+				ktch_gest_policy[class].hold_ms);
+			return MAX_SCHEDULE_TIMEOUT;
+		}
+
+		/* constant deceleration: the fling lasts v / decel */
+		kg.ramp_start = now;
+		dur = div_u64((u64)velocity * MSEC_PER_SEC, ktch_gest_decel);
+		kg.ramp_ms = clamp(dur, 50,
+			max(ktch_gest_policy[KTCH_GEST_FLING].hold_ms, 50));
+		kg.ramp_pct = ktch_gest_pct(KTCH_GEST_FLING, velocity);
+		ktch_gest_apply(KTCH_GEST_FLING, velocity, kg.ramp_pct,
+				kg.ramp_ms);
+		return msecs_to_jiffies(kg.ramp_ms / KTCH_GEST_RAMP_STEPS);
+	}
+
+	if (kg.ramp_ms)
+		return ktch_gest_ramp(now);
+
+	return MAX_SCHEDULE_TIMEOUT;
+}
+
+void ktch_gest_reset(void)
+{
+	kg.ramp_ms = 0;
+	kg.class = KTCH_GEST_NONE;
+	kg.freq = 0;
+}
+
+/*--------------------PROCFS----------------------*/
+static ssize_t perfmgr_tb_policy_proc_write(struct file *filp,
+		const char __user *ubuf, size_t cnt, loff_t *pos)
+{
+	struct ktch_gest_policy p;
+	char buf[64], name[8];
+	int i;
+
+	if (cnt >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, cnt))
+		return -EFAULT;
+	buf[cnt] = 0;
+
+	if (sscanf(buf, "%7s %d %d %d %d %d", name, &p.min_pct, &p.max_pct,
+			&p.v_lo, &p.v_hi, &p.hold_ms) != 6)
+		return -EINVAL;
+	if (p.min_pct < 0 || p.max_pct > 100 || p.min_pct > p.max_pct ||
+			p.v_lo < 0 || p.v_hi < 0 || p.hold_ms < 0)
+		return -EINVAL;
+
+	for (i = KTCH_GEST_TAP; i < NR_KTCH_GEST; i++) {
+		if (!strcmp(name, ktch_gest_name[i])) {
+			ktch_gest_policy[i] = p;
+			return cnt;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static int perfmgr_tb_policy_proc_show(struct seq_file *m, void *v)
+{
+	struct ktch_gest_policy *p;
+	int i;
+
+	seq_puts(m, "class min_pct max_pct v_lo v_hi hold_ms\n");
+	for (i = KTCH_GEST_TAP; i < NR_KTCH_GEST; i++) {
+		p = &ktch_gest_policy[i];
+		seq_printf(m, "%s %d %d %d %d %d\n", ktch_gest_name[i],
+			p->min_pct, p->max_pct, p->v_lo, p->v_hi, p->hold_ms);
+	}
+	seq_printf(m, "slop %d press_ms %d decel %d\n", ktch_gest_slop,
+		ktch_gest_press_ms, ktch_gest_decel);
+
+	return 0;
+}
+
+/* any write clears the timeline */
+static ssize_t perfmgr_tb_timeline_proc_write(struct file *filp,
+		const char __user *ubuf, size_t cnt, loff_t *pos)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&kg.lock, flags);
+	memset(kg.timeline, 0, sizeof(kg.timeline));
+	kg.timeline_head = 0;
+	spin_unlock_irqrestore(&kg.lock, flags);
+
+	return cnt;
+}
+
+static int perfmgr_tb_timeline_proc_show(struct seq_file *m, void *v)
+{
+	struct ktch_gest_rec *rec;
+	unsigned int i, n = min_t(unsigned int, kg.timeline_head,
+			KTCH_GEST_TIMELINE_NR);
+
+	seq_puts(m, "ts_us class velocity freq timeout_ms\n");
+	for (i = kg.timeline_head - n; i != kg.timeline_head; i++) {
+		rec = &kg.timeline[i % KTCH_GEST_TIMELINE_NR];
+		seq_printf(m, "%llu %s %d %d %d\n",
+			div_u64(rec->ts, NSEC_PER_USEC),
+			ktch_gest_name[rec->class], rec->velocity,
+			rec->freq, rec->timeout_ms);
+	}
+
+	return 0;
+}
+
+#define KTCH_GEST_PARAM(name, var, lo, hi) \
+static ssize_t perfmgr_ ## name ## _proc_write(struct file *filp, \
+		const char __user *ubuf, size_t cnt, loff_t *pos) \
+{ \
+	int data = 0; \
+	int rv = check_proc_write(&data, ubuf, cnt); \
+\
+	if (rv != 0) \
+		return rv; \
+	if (data < (lo) || data > (hi)) \
+		return -EINVAL; \
+	var = data; \
+	return cnt; \
+} \
+\
+static int perfmgr_ ## name ## _proc_show(struct seq_file *m, void *v) \
+{ \
+	seq_printf(m, "%d\n", var); \
+	return 0; \
+}
+
+KTCH_GEST_PARAM(tb_gesture, ktch_gest_enable, 0, 1);
+KTCH_GEST_PARAM(tb_slop, ktch_gest_slop, 0, 1000);
+KTCH_GEST_PARAM(tb_press_ms, ktch_gest_press_ms, 1, 5000);
+KTCH_GEST_PARAM(tb_decel, ktch_gest_decel, 1, 1000000);
+
+PROC_FOPS_RW(tb_gesture);
+PROC_FOPS_RW(tb_slop);
+PROC_FOPS_RW(tb_press_ms);
+PROC_FOPS_RW(tb_decel);
+PROC_FOPS_RW(tb_policy);
+PROC_FOPS_RW(tb_timeline);
+
+int ktch_gest_init(struct proc_dir_entry *parent)
+{
+	struct pentry {
+		const char *name;
+		const struct file_operations *fops;
+	};
+	const struct pentry entries[] = {
+		PROC_ENTRY(tb_gesture),
+		PROC_ENTRY(tb_slop),
+		PROC_ENTRY(tb_press_ms),
+		PROC_ENTRY(tb_decel),
+		PROC_ENTRY(tb_policy),
+		PROC_ENTRY(tb_timeline),
+	};
+	int i;
+
+	spin_lock_init(&kg.lock);
+	kg.width = 1000;
+
+	for (i = 0; i < ARRAY_SIZE(entries); i++) {
+		if (!proc_create(entries[i].name, 0644, parent,
+					entries[i].fops)) {
+			pr_debug("%s(), create %s failed\n",
+					__func__, entries[i].name);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
@@ -27,6 +27,14 @@
 #include <linux/slab.h>
 #include <linux/miscdevice.h>   /* for misc_register, and SYNTH_MINOR */
 #include <linux/proc_fs.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
+#include <linux/poll.h>
+#include <linux/wait.h>
+#include <linux/uaccess.h>
+#include <linux/capability.h>
+#include <linux/ktime.h>
+#include <linux/uload_ind.h>
 
 #define REG_SUCCESS (0)
 #define REG_FAIL (-1)
@@ -42,6 +50,7 @@ static int under_threshold; /*threshold value for sent uevent*/
 static bool uevent_enable; /*sent uevent switch*/
 static int curr_cpu_loading; /*cat curr cpu loading node*/
 static int state;
+static int hysteresis; /*ring state hysteresis*/
 
 #define show_debug(fmt, x...) \
 	do { \
@@ -60,13 +69,33 @@ static inline void cl_unlock(const char *tag)
 	mutex_unlock(&cl_mlock);
 }
 
-enum {
-	ULOAD_STATE_HIGH = 1,
-	ULOAD_STATE_MID,
-	ULOAD_STATE_LOW,
+static struct miscdevice cpu_loading_object;
+
+/*
+ * Loading ring, mmap-able through /dev/cpu_loading.
+ *
+ * Single writer (calculat_loading_callback, under cl_mlock), lockless
+ * readers. A slot is invalidated before it is rewritten and its seq is
+ * published last, so a reader detects an overwritten slot by re-checking
+ * seq after copying it.
+ */
+#define ULOAD_RING_SLOTS	1024
+#define ULOAD_RING_SIZE		(PAGE_SIZE + \
+		ULOAD_RING_SLOTS * sizeof(struct uload_event))
+
+struct uload_reader {
+	u64 tail;
+	u64 rate_ns;
+	u64 last_wake_ns;
+	u32 mask;
 };
 
-static struct miscdevice cpu_loading_object;
+static struct uload_ring_hdr *uload_ring;
+static struct uload_event *uload_slots;
+static int ring_state;
+/* seq + 1 of the latest event of each type */
+static u64 uload_last_seq[ULOAD_EV_NORMAL + 1];
+static DECLARE_WAIT_QUEUE_HEAD(uload_wq);
 
 /*default setting*/
 static void init_cpu_loading_value(void)
@@ -80,6 +109,8 @@ static void init_cpu_loading_value(void)
 	polling_ms = 10000;
 	over_threshold = 85;
 	under_threshold = 20;
+	hysteresis = 5;
+	ring_state = ULOAD_STATE_MID;
 	uevent_enable = 1;
 	debug_enable = 0;
 	curr_cpu_loading = 0;
@@ -127,6 +158,73 @@ static bool sentuevent(const char *src)
 }
 
 #endif
+
+static void uload_ring_emit(int type, int loading)
+{
+	u64 seq = uload_ring->head;
+	struct uload_event *ev = &uload_slots[seq & (ULOAD_RING_SLOTS - 1)];
+
+	WRITE_ONCE(ev->seq, U64_MAX);
+	smp_wmb();
+	ev->ts_ns = ktime_get_ns();
+	ev->loading = loading;
+	ev->type = type;
+	ev->state = ring_state;
+	smp_wmb();
+	WRITE_ONCE(ev->seq, seq);
+
+	WRITE_ONCE(uload_last_seq[type], seq + 1);
+	smp_store_release(&uload_ring->head, seq + 1);
+}
+
+/*
+ * Unlike the uevent path, which fires on every sample beyond a threshold,
+ * crossing events are only emitted on state changes, and leaving a state
+ * needs the loading to move back by hysteresis.
+ */
+static void uload_ring_update(int loading)
+{
+	int new_state = ring_state;
+
+	if (!uload_ring || loading < 0)
+		return;
+
+	switch (ring_state) {
+	case ULOAD_STATE_HIGH:
+		if (loading <= under_threshold)
+			new_state = ULOAD_STATE_LOW;
+		else if (loading <= over_threshold - hysteresis)
+			new_state = ULOAD_STATE_MID;
+		break;
+	case ULOAD_STATE_LOW:
+		if (loading > over_threshold)
+			new_state = ULOAD_STATE_HIGH;
+		else if (loading > under_threshold + hysteresis)
+			new_state = ULOAD_STATE_MID;
+		break;
+	default:
+		if (loading > over_threshold)
+			new_state = ULOAD_STATE_HIGH;
+		else if (loading <= under_threshold)
+			new_state = ULOAD_STATE_LOW;
+		break;
+	}
+
+	uload_ring_emit(ULOAD_EV_SAMPLE, loading);
+
+	if (new_state != ring_state) {
+		ring_state = new_state;
+		if (new_state == ULOAD_STATE_HIGH)
+			uload_ring_emit(ULOAD_EV_OVER, loading);
+		else if (new_state == ULOAD_STATE_LOW)
+			uload_ring_emit(ULOAD_EV_UNDER, loading);
+		else
+			uload_ring_emit(ULOAD_EV_NORMAL, loading);
+	}
+
+	wake_up_interruptible(&uload_wq);
+}
+
 /*update info*/
 static void calculat_loading_callback(int loading)
 {
@@ -152,6 +250,7 @@ static void calculat_loading_callback(int loading)
 
 	show_debug("current state:%d\n", state);
 	curr_cpu_loading = loading;
+	uload_ring_update(loading);
 	cl_unlock(__func__);
 }
 
@@ -452,6 +551,36 @@ static ssize_t perfmgr_debug_enable_proc_write(
 
 }
 
+static int perfmgr_hysteresis_proc_show(
+		struct seq_file *m, void *v)
+{
+	cl_lock(__func__);
+	seq_printf(m, "%d\n", hysteresis);
+	cl_unlock(__func__);
+	return 0;
+}
+
+static ssize_t perfmgr_hysteresis_proc_write(
+		struct file *filp, const char *ubuf,
+		size_t cnt, loff_t *data)
+{
+	int val, ret;
+
+	ret = kstrtoint_from_user(ubuf, cnt, 10, &val);
+
+	if (ret != 0)
+		return ret;
+
+	if (val < 0 || val > 50)
+		return -EINVAL;
+
+	cl_lock(__func__);
+	hysteresis = val;
+	cl_unlock(__func__);
+
+	return cnt;
+}
+
 PROC_FOPS_RW(poltime_secs);
 PROC_FOPS_RW(poltime_nsecs);
 PROC_FOPS_RW(onoff);
@@ -459,20 +588,199 @@ PROC_FOPS_RW(overThrhld);
 PROC_FOPS_RW(underThrhld);
 PROC_FOPS_RW(uevent_enable);
 PROC_FOPS_RW(debug_enable);
+PROC_FOPS_RW(hysteresis);
 PROC_FOPS_RO(curr_cpu_loading);
 
+static bool uload_readable(struct uload_reader *r)
+{
+	u64 head = smp_load_acquire(&uload_ring->head);
+	int type;
+
+	if (head <= r->tail)
+		return false;
+
+	for (type = ULOAD_EV_OVER; type <= ULOAD_EV_NORMAL; type++)
+		if ((r->mask & ULOAD_EV_MASK(type)) &&
+			READ_ONCE(uload_last_seq[type]) > r->tail)
+			return true;
+
+	/* samples are rate limited per reader */
+	if (!(r->mask & ULOAD_EV_MASK(ULOAD_EV_SAMPLE)))
+		return false;
+
+	return ktime_get_ns() - r->last_wake_ns >= r->rate_ns;
+}
+
+static int uload_dev_open(struct inode *inode, struct file *file)
+{
+	struct uload_reader *r;
+
+	r = kzalloc(sizeof(*r), GFP_KERNEL);
+	if (!r)
+		return -ENOMEM;
+
+	r->tail = smp_load_acquire(&uload_ring->head);
+	r->mask = ULOAD_EV_MASK(ULOAD_EV_SAMPLE) | ULOAD_EV_MASK_CROSS;
+	file->private_data = r;
+
+	return nonseekable_open(inode, file);
+}
+
+static int uload_dev_release(struct inode *inode, struct file *file)
+{
+	kfree(file->private_data);
+	return 0;
+}
+
+static unsigned int uload_dev_poll(struct file *file, poll_table *wait)
+{
+	struct uload_reader *r = file->private_data;
+
+	poll_wait(file, &uload_wq, wait);
+
+	if (!uload_readable(r))
+		return 0;
+
+	r->last_wake_ns = ktime_get_ns();
+	return POLLIN | POLLRDNORM;
+}
+
+static ssize_t uload_dev_read(struct file *file, char __user *ubuf,
+		size_t cnt, loff_t *pos)
+{
+	struct uload_reader *r = file->private_data;
+	struct uload_event ev;
+	size_t done = 0;
+	u64 head;
+	int ret;
+
+	if (cnt < sizeof(ev))
+		return -EINVAL;
+
+	if (!uload_readable(r)) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = wait_event_interruptible(uload_wq, uload_readable(r));
+		if (ret)
+			return ret;
+	}
+
+	r->last_wake_ns = ktime_get_ns();
+	head = smp_load_acquire(&uload_ring->head);
+	if (head - r->tail > ULOAD_RING_SLOTS)
+		r->tail = head - ULOAD_RING_SLOTS;
+
+	while (r->tail < head && done + sizeof(ev) <= cnt) {
+		struct uload_event *slot =
+			&uload_slots[r->tail & (ULOAD_RING_SLOTS - 1)];
+
+		ev = *slot;
+		smp_rmb();
+		if (READ_ONCE(slot->seq) != r->tail || ev.seq != r->tail) {
+			/* overwritten while copying, skip ahead */
+			head = smp_load_acquire(&uload_ring->head);
+			r->tail = head - ULOAD_RING_SLOTS + 1;
+			continue;
+		}
+
+		r->tail++;
+		if (!(r->mask & ULOAD_EV_MASK(ev.type)))
+			continue;
+
+		if (copy_to_user(ubuf + done, &ev, sizeof(ev)))
+			return done ? done : -EFAULT;
+		done += sizeof(ev);
+	}
+
+	return done;
+}
+
+static long uload_dev_ioctl(struct file *file, unsigned int cmd,
+		unsigned long arg)
+{
+	struct uload_reader *r = file->private_data;
+	void __user *uarg = (void __user *)arg;
+	u64 seq, head;
+	u32 val;
+	s32 loading;
+
+	switch (cmd) {
+	case ULOAD_IOC_SET_RATE:
+		if (get_user(val, (u32 __user *)uarg))
+			return -EFAULT;
+		r->rate_ns = (u64)val * NSEC_PER_MSEC;
+		return 0;
+	case ULOAD_IOC_SET_MASK:
+		if (get_user(val, (u32 __user *)uarg))
+			return -EFAULT;
+		r->mask = val;
+		return 0;
+	case ULOAD_IOC_CONSUME:
+		if (get_user(seq, (u64 __user *)uarg))
+			return -EFAULT;
+		head = smp_load_acquire(&uload_ring->head);
+		r->tail = min(seq, head);
+		return 0;
+	case ULOAD_IOC_INJECT:
+		if (!capable(CAP_SYS_ADMIN))
+			return -EPERM;
+		if (get_user(loading, (s32 __user *)uarg))
+			return -EFAULT;
+		if (loading < 0 || loading > 100)
+			return -EINVAL;
+		calculat_loading_callback(loading);
+		return 0;
+	default:
+		return -ENOTTY;
+	}
+}
+
+static int uload_dev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	return remap_vmalloc_range(vma, uload_ring, vma->vm_pgoff);
+}
+
+static const struct file_operations uload_dev_fops = {
+	.owner		= THIS_MODULE,
+	.open		= uload_dev_open,
+	.release	= uload_dev_release,
+	.read		= uload_dev_read,
+	.poll		= uload_dev_poll,
+	.unlocked_ioctl	= uload_dev_ioctl,
+	.compat_ioctl	= uload_dev_ioctl,
+	.mmap		= uload_dev_mmap,
+	.llseek		= no_llseek,
+};
+
 static int init_cpu_loading_kobj(void)
 {
 	int ret = 0;
 
+	uload_ring = vmalloc_user(ULOAD_RING_SIZE);
+	if (!uload_ring)
+		return -ENOMEM;
+
+	uload_ring->version = ULOAD_RING_VERSION;
+	uload_ring->nr_slots = ULOAD_RING_SLOTS;
+	uload_ring->slot_size = sizeof(struct uload_event);
+	uload_ring->data_offset = PAGE_SIZE;
+	uload_slots = (void *)uload_ring + PAGE_SIZE;
+
 	/* dev init */
 
 	cpu_loading_object.name = "cpu_loading";
+	cpu_loading_object.minor = MISC_DYNAMIC_MINOR;
+	cpu_loading_object.fops = &uload_dev_fops;
 	ret = misc_register(&cpu_loading_object);
 	if (ret) {
 		ret = -ENODEV;
 		pr_debug("misc_register error:%d\n", ret);
-		return ret;
+		goto err_free_ring;
 	}
 
 	ret = kobject_uevent(
@@ -481,11 +789,15 @@ static int init_cpu_loading_kobj(void)
 	if (ret) {
 		misc_deregister(&cpu_loading_object);
 		pr_debug("uevent creat fail:%d\n", ret);
-		return ret;
+		goto err_free_ring;
 	}
 
 	return ret;
 
+err_free_ring:
+	vfree(uload_ring);
+	uload_ring = NULL;
+	return ret;
 }
 
 int init_uload_ind(struct proc_dir_entry *parent)
@@ -507,6 +819,7 @@ int init_uload_ind(struct proc_dir_entry *parent)
 		PROC_ENTRY(uevent_enable),
 		PROC_ENTRY(curr_cpu_loading),
 		PROC_ENTRY(debug_enable),
+		PROC_ENTRY(hysteresis),
 	};
 
 	lt_dir = proc_mkdir("cpu_loading", parent);
@@ -33,6 +33,7 @@
 #include <linux/pstore.h>
 #include <linux/io.h>
 #include <mt-plat/aee.h>
+#include <mt-plat/mtk_ram_record.h>
 #include "ram_console.h"
 #include <mach/memory_layout.h>
 
@@ -993,6 +994,7 @@ void aee_rr_rec_last_irq_exit(int cpu, int irq, u64 jiffies)
 
 void aee_rr_rec_hotplug_footprint(int cpu, u8 fp)
 {
+	ram_record_value(RAM_RECORD_HOTPLUG, cpu, fp);
 	if (!ram_console_init_done || !ram_console_buffer)
 		return;
 	if (cpu >= 0 && cpu < num_possible_cpus())
@@ -1238,6 +1240,7 @@ u32 aee_rr_curr_mcsodi_val(void)
 
 void aee_rr_rec_spm_suspend_val(u32 val)
 {
+	ram_record_value(RAM_RECORD_SUSPEND, 0, val);
 	if (!ram_console_init_done || !ram_console_buffer)
 		return;
 	LAST_RR_SET(spm_suspend_data, val);
@@ -2349,6 +2352,7 @@ void aee_rr_rec_scp(void)
 
 void aee_rr_rec_last_init_func(unsigned long val)
 {
+	ram_record_value(RAM_RECORD_INITCALL, 0, val);
 	if (!ram_console_init_done || !ram_console_buffer)
 		return;
 	if (LAST_RR_VAL(last_init_func) == ~(unsigned long)(0))
@@ -2358,6 +2362,7 @@ void aee_rr_rec_last_init_func(unsigned long val)
 
 void aee_rr_rec_last_async_func(unsigned long val)
 {
+	ram_record_value(RAM_RECORD_DPM, 1, val);
 	if (!ram_console_init_done || !ram_console_buffer)
 		return;
 	if (LAST_RR_VAL(last_async_func) == ~(unsigned long)(0))
@@ -2367,6 +2372,7 @@ void aee_rr_rec_last_async_func(unsigned long val)
 
 void aee_rr_rec_last_sync_func(unsigned long val)
 {
+	ram_record_value(RAM_RECORD_DPM, 0, val);
 	if (!ram_console_init_done || !ram_console_buffer)
 		return;
 	if (LAST_RR_VAL(last_sync_func) == ~(unsigned long)(0))
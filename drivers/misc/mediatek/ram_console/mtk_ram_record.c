@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * ram record: structured records that survive a warm reset
+ *
+ * printk and a few ram_console footprints (initcalls, device pm callbacks,
+ * cpu hotplug, spm suspend) are also written as records to a per-cpu ring
+ * in reserved memory, see ram_record.h for the format. At boot the rings
+ * left by the previous boot are copied out and exported, merged by
+ * sequence number, as /proc/last_records; /proc/ram_records shows the
+ * current ones.
+ */
+
+#define pr_fmt(fmt) "ram_record: " fmt
+
+#include <linux/atomic.h>
+#include <linux/init.h>
+#include <linux/io.h>
+#include <linux/irqflags.h>
+#include <linux/mm.h>
+#include <linux/of_reserved_mem.h>
+#include <linux/percpu.h>
+#include <linux/proc_fs.h>
+#include <linux/sched/clock.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/vmalloc.h>
+
+#include <mt-plat/mtk_ram_record.h>
+
+#include "ram_record.h"
+
+static phys_addr_t rr_base;
+static size_t rr_size;
+static void *rr_image;
+static void *rr_last;
+static size_t rr_last_size;
+static bool rr_ready;
+static atomic64_t rr_seq;
+static DEFINE_PER_CPU(int, rr_busy);
+
+static const char * const rr_type_name[RAM_RECORD_TYPE_NR] = {
+	[RAM_RECORD_PRINTK] = "printk",
+	[RAM_RECORD_BOOT] = "boot",
+	[RAM_RECORD_INITCALL] = "initcall",
+	[RAM_RECORD_DPM] = "dpm",
+	[RAM_RECORD_HOTPLUG] = "hotplug",
+	[RAM_RECORD_SUSPEND] = "suspend",
+};
+
+/*
+ * Appends a record to the ring of this cpu. Interrupts are off while the
+ * record is written; a record from a context that interrupted the writer
+ * anyway (fiq, or a record written from within the writer) is dropped.
+ */
+void ram_record_write(u16 type, u16 arg, u64 ts_ns, const void *data, u16 len)
+{
+	unsigned long flags;
+	unsigned int cpu;
+
+	if (!READ_ONCE(rr_ready))
+		return;
+
+	local_irq_save(flags);
+	cpu = smp_processor_id();
+	if (cpu >= ((struct rr_header *)rr_image)->nr_rings)
+		goto out;
+	if (__this_cpu_read(rr_busy)) {
+		rr_ring_of(rr_image, cpu)->dropped++;
+		goto out;
+	}
+	__this_cpu_write(rr_busy, 1);
+	rr_write(rr_image, cpu, atomic64_inc_return(&rr_seq), ts_ns,
+		 type, arg, data, len);
+	__this_cpu_write(rr_busy, 0);
+out:
+	local_irq_restore(flags);
+}
+
+void ram_record_value(u16 type, u16 arg, u64 val)
+{
+	ram_record_write(type, arg, local_clock(), &val, sizeof(val));
+}
+
+void ram_record_text(u16 type, const char *fmt, ...)
+{
+	char buf[RAM_RECORD_TEXT_MAX];
+	va_list args;
+	int len;
+
+	if (!READ_ONCE(rr_ready))
+		return;
+
+	va_start(args, fmt);
+	len = vscnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+
+	ram_record_write(type, 0, local_clock(), buf, len);
+}
+
+struct rr_list {
+	const struct rr_rec **recs;
+	unsigned int nr, max;
+};
+
+static void rr_collect(const struct rr_rec *rec, void *arg)
+{
+	struct rr_list *l = arg;
+
+	if (l->nr < l->max)
+		l->recs[l->nr++] = rec;
+}
+
+static int rr_cmp(const void *a, const void *b)
+{
+	const struct rr_rec *x = *(const struct rr_rec **)a;
+	const struct rr_rec *y = *(const struct rr_rec **)b;
+
+	if (x->seq == y->seq)
+		return 0;
+	return x->seq < y->seq ? -1 : 1;
+}
+
+static void rr_show_rec(struct seq_file *m, const struct rr_rec *rec)
+{
+	const char *name = rec->type < RAM_RECORD_TYPE_NR &&
+		rr_type_name[rec->type] ? rr_type_name[rec->type] : "unknown";
+	u64 ts = rec->ts_ns;
+	unsigned long usec = do_div(ts, NSEC_PER_SEC) / NSEC_PER_USEC;
+	u64 val = 0;
+
+	seq_printf(m, "%llu [%5llu.%06lu] %u %s %u ", rec->seq, ts, usec,
+		   rec->cpu, name, rec->arg);
+	switch (rec->type) {
+	case RAM_RECORD_PRINTK:
+	case RAM_RECORD_BOOT:
+		seq_printf(m, "%*pE\n", rec->len, rec->data);
+		break;
+	default:
+		memcpy(&val, rec->data, min_t(u16, rec->len, sizeof(val)));
+		seq_printf(m, "0x%llx\n", val);
+		break;
+	}
+}
+
+/* Merges the rings of image by sequence number */
+static int rr_show_image(struct seq_file *m, const void *image, size_t size)
+{
+	const struct rr_header *h = image;
+	struct rr_list l;
+	unsigned int i, n;
+
+	if (!image || rr_check(image, size)) {
+		seq_puts(m, "no records\n");
+		return 0;
+	}
+
+	l.max = h->ring_size / RR_REC_HDR * h->nr_rings;
+	l.nr = 0;
+	l.recs = vmalloc(l.max * sizeof(*l.recs));
+	if (!l.recs)
+		return -ENOMEM;
+
+	seq_printf(m, "# boot %u, %u rings of %u bytes\n", h->boot,
+		   h->nr_rings, h->ring_size);
+	for (i = 0; i < h->nr_rings; i++) {
+		n = rr_parse_ring(image, i, rr_collect, &l);
+		seq_printf(m, "# ring %u: %u records, %u dropped\n", i, n,
+			   rr_ring_of((void *)image, i)->dropped);
+	}
+	sort(l.recs, l.nr, sizeof(*l.recs), rr_cmp, NULL);
+	for (i = 0; i < l.nr; i++)
+		rr_show_rec(m, l.recs[i]);
+
+	vfree(l.recs);
+
+	return 0;
+}
+
+static int last_records_show(struct seq_file *m, void *v)
+{
+	return rr_show_image(m, rr_last, rr_last_size);
+}
+
+/* Works on a copy, the rings keep moving while they are read */
+static int ram_records_show(struct seq_file *m, void *v)
+{
+	void *copy;
+	int ret;
+
+	copy = vmalloc(rr_size);
+	if (!copy)
+		return -ENOMEM;
+	memcpy(copy, rr_image, rr_size);
+	ret = rr_show_image(m, copy, rr_size);
+	vfree(copy);
+
+	return ret;
+}
+
+static int last_records_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, last_records_show, NULL);
+}
+
+static int ram_records_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ram_records_show, NULL);
+}
+
+static const struct file_operations last_records_fops = {
+	.owner = THIS_MODULE,
+	.open = last_records_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static const struct file_operations ram_records_fops = {
+	.owner = THIS_MODULE,
+	.open = ram_records_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/* Write combined, so records are plain memory writes that may be unaligned */
+static void *rr_remap(phys_addr_t start, size_t size)
+{
+	unsigned int i, page_count = DIV_ROUND_UP(size, PAGE_SIZE);
+	struct page **pages;
+	void *vaddr;
+
+	if (!pfn_valid(__phys_to_pfn(start)))
+		return ioremap_wc(start, size);
+
+	pages = kmalloc_array(page_count, sizeof(struct page *), GFP_KERNEL);
+	if (!pages)
+		return NULL;
+	for (i = 0; i < page_count; i++)
+		pages[i] = pfn_to_page(__phys_to_pfn(start) + i);
+	vaddr = vmap(pages, page_count, VM_MAP,
+		     pgprot_writecombine(PAGE_KERNEL));
+	kfree(pages);
+
+	return vaddr;
+}
+
+static int __init ram_record_early_init(void)
+{
+	struct rr_header *h;
+	u32 boot = 1;
+
+	if (!rr_size)
+		return -ENODEV;
+
+	rr_image = rr_remap(rr_base, rr_size);
+	if (!rr_image) {
+		pr_err("failed to map 0x%llx (0x%zx)\n",
+		       (unsigned long long)rr_base, rr_size);
+		return -ENOMEM;
+	}
+
+	h = rr_image;
+	if (!rr_check(rr_image, rr_size)) {
+		boot = h->boot + 1;
+		rr_last_size = RR_HEADER_SIZE + (size_t)h->nr_rings *
+			(RR_RING_HEADER_SIZE + h->ring_size);
+		rr_last = vmalloc(rr_last_size);
+		if (rr_last)
+			memcpy(rr_last, rr_image, rr_last_size);
+	}
+
+	if (rr_format(rr_image, rr_size, nr_cpu_ids, boot)) {
+		pr_err("0x%zx bytes is too small for %u cpus\n",
+		       rr_size, nr_cpu_ids);
+		return -ENOSPC;
+	}
+	WRITE_ONCE(rr_ready, true);
+
+	pr_info("boot %u, %u rings of %u bytes, last boot %s\n", boot,
+		nr_cpu_ids, h->ring_size, rr_last ? "recovered" : "none");
+
+	return 0;
+}
+
+static int __init ram_record_late_init(void)
+{
+	if (!rr_ready)
+		return 0;
+
+	if (!proc_create("last_records", 0444, NULL, &last_records_fops) ||
+	    !proc_create("ram_records", 0444, NULL, &ram_records_fops))
+		pr_err("failed to create proc entry\n");
+
+	return 0;
+}
+
+early_initcall(ram_record_early_init);
+late_initcall(ram_record_late_init);
+
+/*
+ * The board device tree reserves the rings next to its ram_console, at an
+ * address of its own that stays put across a warm reset, e.g.
+ *
+ *	reserve-memory-ram_record@44500000 {
+ *		compatible = "mediatek,ram_record";
+ *		no-map;
+ *		reg = <0 0x44500000 0 0x80000>;
+ *	};
+ *
+ * 512 KiB gives eight CPUs 64 KiB of records each.
+ */
+static int __init ram_record_reserve_memory(struct reserved_mem *rmem)
+{
+	pr_info("[memblock]%s: 0x%llx - 0x%llx (0x%llx)\n",
+		"mediatek,ram_record",
+		(unsigned long long)rmem->base,
+		(unsigned long long)rmem->base +
+		(unsigned long long)rmem->size,
+		(unsigned long long)rmem->size);
+	rr_base = rmem->base;
+	rr_size = rmem->size;
+	return 0;
+}
+
+RESERVEDMEM_OF_DECLARE(reserve_memory_ram_record, "mediatek,ram_record",
+		       ram_record_reserve_memory);
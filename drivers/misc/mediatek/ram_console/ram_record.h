@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Layout of the ram record image and its writer/parser.
+ *
+ * The image is a header followed by one ring per cpu. Every ring has a
+ * single writer, the owning cpu with interrupts off, so no lock and no
+ * atomic is needed on the (write combined) memory. A record is built in
+ * place with its commit word clear, and the commit word is the last thing
+ * written; a reset at any point leaves either the whole record or a record
+ * the parser refuses. Space is reclaimed by moving the tail past whole
+ * records before they are overwritten, so the tail always points at an
+ * intact record. The parser walks from the tail and keeps going while the
+ * records check out and their ring sequence numbers follow each other,
+ * which also picks up a record committed just before head was updated.
+ * The checksum is seeded with the boot count so data left over from an
+ * earlier boot never passes for a record of this one.
+ *
+ * RR_CRASH_POINT() marks the places a reset may hit; the test defines it
+ * to take a copy of the image.
+ */
+
+#ifndef __RAM_RECORD_H__
+#define __RAM_RECORD_H__
+
+#include <linux/crc32.h>
+#include <linux/errno.h>
+#include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/string.h>
+#include <linux/types.h>
+
+#ifndef RR_CRASH_POINT
+#define RR_CRASH_POINT()
+#endif
+
+#define RR_MAGIC		0x52524543	/* "RREC" */
+#define RR_VERSION		1
+#define RR_REC_COMMIT		0xa55a
+#define RR_REC_PAD		0x5aa5
+#define RR_HEADER_SIZE		64
+#define RR_RING_HEADER_SIZE	64
+#define RR_MIN_RING_SIZE	4096
+
+struct rr_header {
+	u32 magic;
+	u32 version;
+	u32 nr_rings;
+	u32 ring_size;		/* data bytes per ring, power of 2 */
+	u32 boot;		/* boots seen by this image */
+	u32 crc;		/* of the fields above */
+};
+
+struct rr_ring {
+	u32 head;		/* end of the last committed record */
+	u32 tail;		/* start of the oldest whole record */
+	u32 rseq;		/* ring sequence of the next record */
+	u32 dropped;		/* records given up, nested or too big */
+};
+
+struct rr_rec {
+	u32 word;		/* RR_REC_COMMIT << 16 | size, 0 until done */
+	u32 crc;		/* of the record from type on */
+	u16 type;
+	u16 len;		/* payload bytes */
+	u16 cpu;
+	u16 arg;
+	u32 rseq;
+	u32 reserved;
+	u64 seq;		/* global sequence */
+	u64 ts_ns;
+	u8 data[0];
+};
+
+#define RR_REC_HDR		sizeof(struct rr_rec)
+#define RR_CRC_OFF		offsetof(struct rr_rec, type)
+#define RR_REC_SIZE(len)	ALIGN(RR_REC_HDR + (len), 8)
+#define RR_WORD(magic, size)	((u32)(magic) << 16 | (size))
+#define RR_WORD_MAGIC(word)	((word) >> 16)
+#define RR_WORD_SIZE(word)	((word) & 0xffff)
+
+static inline struct rr_ring *rr_ring_of(void *image, u32 ring)
+{
+	struct rr_header *h = image;
+
+	return image + RR_HEADER_SIZE +
+		(size_t)ring * (RR_RING_HEADER_SIZE + h->ring_size);
+}
+
+static inline void *rr_ring_data(struct rr_ring *r)
+{
+	return (void *)r + RR_RING_HEADER_SIZE;
+}
+
+static inline u32 rr_header_crc(const struct rr_header *h)
+{
+	return crc32_le(~0, (const u8 *)h, offsetof(struct rr_header, crc));
+}
+
+/* Returns 0 if image holds a header this code can walk */
+static inline int rr_check(const void *image, size_t size)
+{
+	const struct rr_header *h = image;
+
+	if (size < RR_HEADER_SIZE || h->magic != RR_MAGIC ||
+	    h->version != RR_VERSION || h->crc != rr_header_crc(h))
+		return -EINVAL;
+	if (!h->nr_rings || !is_power_of_2(h->ring_size) ||
+	    h->ring_size < RR_MIN_RING_SIZE ||
+	    RR_HEADER_SIZE + (u64)h->nr_rings *
+	    (RR_RING_HEADER_SIZE + h->ring_size) > size)
+		return -EINVAL;
+
+	return 0;
+}
+
+/* Lays out nr_rings empty rings over [image, image + size) */
+static inline int rr_format(void *image, size_t size, u32 nr_rings, u32 boot)
+{
+	struct rr_header *h = image;
+	size_t per_ring;
+	u32 i;
+
+	if (!nr_rings || size < RR_HEADER_SIZE)
+		return -EINVAL;
+	per_ring = (size - RR_HEADER_SIZE) / nr_rings;
+	if (per_ring < RR_RING_HEADER_SIZE + RR_MIN_RING_SIZE)
+		return -ENOSPC;
+
+	memset(h, 0, RR_HEADER_SIZE);
+	h->magic = RR_MAGIC;
+	h->version = RR_VERSION;
+	h->nr_rings = nr_rings;
+	h->ring_size = rounddown_pow_of_two(per_ring - RR_RING_HEADER_SIZE);
+	h->boot = boot;
+	for (i = 0; i < nr_rings; i++)
+		memset(rr_ring_of(image, i), 0, RR_RING_HEADER_SIZE);
+	wmb();
+	h->crc = rr_header_crc(h);
+	wmb();
+
+	return 0;
+}
+
+/* Moves the tail past whatever [head, head + need) would overwrite */
+static inline void rr_make_room(struct rr_ring *r, u32 mask, u32 need)
+{
+	struct rr_rec *rec;
+	u32 tail = r->tail;
+
+	if (r->head + need - tail <= mask + 1)
+		return;
+	do {
+		rec = rr_ring_data(r) + (tail & mask);
+		if (!RR_WORD_SIZE(rec->word)) {
+			/* scribbled over, give the whole ring up */
+			tail = r->head;
+			break;
+		}
+		tail += RR_WORD_SIZE(rec->word);
+	} while (r->head + need - tail > mask + 1);
+
+	WRITE_ONCE(r->tail, tail);
+	wmb();
+	RR_CRASH_POINT();
+}
+
+/*
+ * Appends one record to ring. Caller owns the ring: it runs on the ring's
+ * cpu with interrupts off and is not nested. Returns the ring sequence of
+ * the record, negative if it was dropped.
+ */
+static inline s64 rr_write(void *image, u32 ring, u64 seq, u64 ts_ns,
+			   u16 type, u16 arg, const void *data, u16 len)
+{
+	struct rr_header *h = image;
+	struct rr_ring *r = rr_ring_of(image, ring);
+	u32 mask = h->ring_size - 1;
+	u32 size = RR_REC_SIZE(len);
+	u32 off = r->head & mask;
+	u32 pad = off + size > mask + 1 ? mask + 1 - off : 0;
+	struct rr_rec tmp, *rec;
+	u32 crc;
+
+	if (size > (mask + 1) / 4 || size > 0xffff) {
+		r->dropped++;
+		return -ENOSPC;
+	}
+
+	rr_make_room(r, mask, pad + size);
+
+	if (pad) {
+		rec = rr_ring_data(r) + off;
+		WRITE_ONCE(rec->word, RR_WORD(RR_REC_PAD, pad));
+		wmb();
+		RR_CRASH_POINT();
+		WRITE_ONCE(r->head, r->head + pad);
+		wmb();
+		RR_CRASH_POINT();
+		off = 0;
+	}
+
+	memset(&tmp, 0, sizeof(tmp));
+	tmp.type = type;
+	tmp.len = len;
+	tmp.cpu = ring;
+	tmp.arg = arg;
+	tmp.rseq = r->rseq;
+	tmp.seq = seq;
+	tmp.ts_ns = ts_ns;
+	crc = crc32_le(~h->boot, (u8 *)&tmp + RR_CRC_OFF,
+		       RR_REC_HDR - RR_CRC_OFF);
+	tmp.crc = crc32_le(crc, data, len);
+
+	rec = rr_ring_data(r) + off;
+	WRITE_ONCE(rec->word, 0);
+	wmb();
+	RR_CRASH_POINT();
+	memcpy((u8 *)rec + sizeof(rec->word), (u8 *)&tmp + sizeof(tmp.word),
+	       RR_REC_HDR - sizeof(tmp.word));
+	memcpy(rec->data, data, len);
+	wmb();
+	RR_CRASH_POINT();
+	WRITE_ONCE(rec->word, RR_WORD(RR_REC_COMMIT, size));
+	wmb();
+	RR_CRASH_POINT();
+	WRITE_ONCE(r->head, r->head + size);
+	r->rseq = tmp.rseq + 1;
+	wmb();
+
+	return tmp.rseq;
+}
+
+static inline bool rr_rec_valid(const struct rr_header *h,
+				const struct rr_rec *rec, u32 room)
+{
+	u32 size = RR_WORD_SIZE(rec->word);
+	u32 crc;
+
+	if (RR_WORD_MAGIC(rec->word) != RR_REC_COMMIT || size > room ||
+	    size < RR_REC_HDR || size != RR_REC_SIZE(rec->len))
+		return false;
+	crc = crc32_le(~h->boot, (const u8 *)rec + RR_CRC_OFF,
+		       RR_REC_HDR - RR_CRC_OFF);
+
+	return crc32_le(crc, rec->data, rec->len) == rec->crc;
+}
+
+/*
+ * Calls fn for every record recovered from ring of a checked image, oldest
+ * first. Stops at the first record that is torn, stale or out of sequence.
+ * Returns the number of records handed to fn.
+ */
+static inline u32 rr_parse_ring(const void *image, u32 ring,
+				void (*fn)(const struct rr_rec *, void *),
+				void *arg)
+{
+	const struct rr_header *h = image;
+	struct rr_ring *r = rr_ring_of((void *)image, ring);
+	u32 mask = h->ring_size - 1;
+	u32 pos = r->tail, end = r->tail + mask + 1;
+	u32 off, size, n = 0, rseq = 0;
+	const struct rr_rec *rec;
+
+	while (pos != end) {
+		off = pos & mask;
+		rec = rr_ring_data(r) + off;
+		size = RR_WORD_SIZE(rec->word);
+		if (RR_WORD_MAGIC(rec->word) == RR_REC_PAD) {
+			/* a pad always runs to the end of the ring */
+			if (size != mask + 1 - off || end - pos < size)
+				break;
+			pos += size;
+			continue;
+		}
+		if (!rr_rec_valid(h, rec, min(end - pos, mask + 1 - off)))
+			break;
+		if (n && rec->rseq != rseq + 1)
+			break;
+		rseq = rec->rseq;
+		if (fn)
+			fn(rec, arg);
+		n++;
+		pos += size;
+	}
+
+	return n;
+}
+
+#endif
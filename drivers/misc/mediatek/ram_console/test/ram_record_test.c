@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See http://www.gnu.org/licenses/gpl-2.0.html for more details.
+ */
+
+/*
+ * ram record reset test
+ *
+ * Replays the same sequence of records into a vmalloc'ed image once per
+ * crash point of the writer, copying the image when that point is hit as
+ * a warm reset would leave it. Every copy is then parsed: each record
+ * committed before the reset must come back intact, nothing else than the
+ * record being written may show up, and a ring that wrapped must still
+ * hold close to a full ring of history. Finally the image is formatted
+ * for a new boot over the old data, which must not parse as records.
+ * Results go to the kernel log; loading always fails with -EAGAIN so the
+ * test can be run again without rmmod.
+ */
+
+#define pr_fmt(fmt) "ram_record_test: " fmt
+
+#include <linux/module.h>
+#include <linux/vmalloc.h>
+
+static void rr_test_crash_point(void);
+#define RR_CRASH_POINT() rr_test_crash_point()
+
+#include "ram_record.h"
+
+#define NR_RINGS	2
+#define MAX_LEN		900
+
+static unsigned int image_kb = 64;
+module_param(image_kb, uint, 0444);
+MODULE_PARM_DESC(image_kb, "Image size, shared by the rings");
+
+static unsigned int writes = 1000;
+module_param(writes, uint, 0444);
+MODULE_PARM_DESC(writes, "Records written per replay");
+
+static void *image, *snap;
+static size_t image_size;
+static u32 crash_at, crash_count;
+static bool snapped;
+static u32 committed[NR_RINGS], snap_committed[NR_RINGS];
+static u64 written[NR_RINGS], snap_written[NR_RINGS];
+static u8 payload[MAX_LEN];
+
+static void rr_test_crash_point(void)
+{
+	if (++crash_count != crash_at)
+		return;
+	memcpy(snap, image, image_size);
+	memcpy(snap_committed, committed, sizeof(committed));
+	memcpy(snap_written, written, sizeof(written));
+	snapped = true;
+}
+
+static u32 lcg(u32 *state)
+{
+	*state = *state * 1103515245 + 12345;
+	return *state >> 8;
+}
+
+static void fill(u8 *buf, u32 ring, u32 rseq, u16 len)
+{
+	u16 i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = ring * 131 + rseq * 7 + i;
+}
+
+/* Always the same records, so every replay reaches the same points */
+static void replay(void)
+{
+	u32 state = 1, ring, rseq;
+	unsigned int i;
+	u16 len;
+	s64 ret;
+
+	rr_format(image, image_size, NR_RINGS, 1);
+	memset(committed, 0, sizeof(committed));
+	memset(written, 0, sizeof(written));
+	crash_count = 0;
+	snapped = false;
+
+	for (i = 0; i < writes; i++) {
+		ring = lcg(&state) % NR_RINGS;
+		len = lcg(&state) % 8 ? lcg(&state) % 64 :
+			lcg(&state) % MAX_LEN;
+		rseq = committed[ring];
+		fill(payload, ring, rseq, len);
+		ret = rr_write(image, ring, i, 0, 1, 0, payload, len);
+		if (ret < 0)
+			continue;
+		committed[ring] = ret + 1;
+		written[ring] += RR_REC_SIZE(len);
+	}
+}
+
+struct check {
+	u32 ring, n, first, last, span;
+	bool bad;
+};
+
+static void check_rec(const struct rr_rec *rec, void *arg)
+{
+	struct check *c = arg;
+
+	fill(payload, c->ring, rec->rseq, rec->len);
+	if (rec->cpu != c->ring || memcmp(rec->data, payload, rec->len))
+		c->bad = true;
+	if (!c->n)
+		c->first = rec->rseq;
+	c->last = rec->rseq;
+	c->span += RR_WORD_SIZE(rec->word);
+	c->n++;
+}
+
+static int check_snap(u32 point)
+{
+	const struct rr_header *h = snap;
+	struct check c;
+	u32 ring;
+
+	if (rr_check(snap, image_size)) {
+		pr_err("point %u: header lost\n", point);
+		return -EIO;
+	}
+
+	for (ring = 0; ring < NR_RINGS; ring++) {
+		memset(&c, 0, sizeof(c));
+		c.ring = ring;
+		rr_parse_ring(snap, ring, check_rec, &c);
+		if (c.bad) {
+			pr_err("point %u ring %u: torn record accepted\n",
+			       point, ring);
+			return -EIO;
+		}
+		if (!snap_committed[ring])
+			continue;
+		/* may also hold the record being written, if it got its commit */
+		if (!c.n || c.last + 1 < snap_committed[ring] ||
+		    c.last > snap_committed[ring]) {
+			pr_err("point %u ring %u: last %u of %u records committed\n",
+			       point, ring, c.n ? c.last : 0,
+			       snap_committed[ring]);
+			return -EIO;
+		}
+		if (snap_written[ring] < h->ring_size - RR_REC_SIZE(MAX_LEN) ?
+		    c.first != 0 :
+		    c.span + 4 * RR_REC_SIZE(MAX_LEN) < h->ring_size) {
+			pr_err("point %u ring %u: records from %u, %u bytes kept\n",
+			       point, ring, c.first, c.span);
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+/* Data of an earlier boot must not parse as records of the new one */
+static int check_stale(void)
+{
+	u32 ring, n;
+
+	rr_format(image, image_size, NR_RINGS, 2);
+	for (ring = 0; ring < NR_RINGS; ring++) {
+		n = rr_parse_ring(image, ring, NULL, NULL);
+		if (n) {
+			pr_err("stale: %u records of the last boot in ring %u\n",
+			       n, ring);
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+static int run(void)
+{
+	u32 points, point;
+	int ret;
+
+	crash_at = 0;
+	replay();
+	points = crash_count;
+	pr_info("%u writes, %u crash points, committed %u/%u, %llu/%llu bytes\n",
+		writes, points, committed[0], committed[1],
+		written[0], written[1]);
+
+	for (point = 1; point <= points; point++) {
+		crash_at = point;
+		replay();
+		if (!snapped) {
+			pr_err("point %u not reached\n", point);
+			return -EIO;
+		}
+		ret = check_snap(point);
+		if (ret)
+			return ret;
+		cond_resched();
+	}
+
+	return check_stale();
+}
+
+static int __init ram_record_test_init(void)
+{
+	int ret = -ENOMEM;
+
+	image_size = (size_t)image_kb << 10;
+	image = vmalloc(image_size);
+	snap = vmalloc(image_size);
+	if (image && snap)
+		ret = run();
+
+	vfree(snap);
+	vfree(image);
+
+	pr_info("%s\n", ret ? "FAIL" : "PASS");
+
+	return -EAGAIN;
+}
+
+module_init(ram_record_test_init);
+
+MODULE_AUTHOR("Mediatek");
+MODULE_DESCRIPTION("ram record reset test");
+MODULE_LICENSE("GPL");
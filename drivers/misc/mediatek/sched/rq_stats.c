@@ -1032,6 +1032,54 @@ static struct kobj_attribute big_task_attr =
 __ATTR(big_task, 0400 /* S_IRUSR */, show_big_task,
 		NULL);
 
+/* nr_running averages, decayed and lockless: reading resets nothing */
+#define NR_RUNNING_AVG_HL_MS	256
+
+static ssize_t show_nr_running_avg(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	int avg = 0, iowait_avg = 0;
+
+	sched_get_nr_running_avg_decayed(NR_RUNNING_AVG_HL_MS, &avg,
+					 &iowait_avg);
+
+	return snprintf(buf, MAX_LONG_SIZE, "%d %d\n", avg, iowait_avg);
+}
+
+static struct kobj_attribute nr_running_avg_attr =
+__ATTR(nr_running_avg, 0400 /* S_IRUSR */, show_nr_running_avg, NULL);
+
+static ssize_t show_nr_running_decay(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	unsigned int len = 0;
+	unsigned int max_len = 4096;
+	int cpu, hl;
+
+	len += snprintf(buf+len, max_len-len, "hl_ms");
+	for (hl = 0; hl < NR_SCHED_NR_HL; hl++)
+		len += snprintf(buf+len, max_len-len, " %u",
+				sched_nr_hl_ms(hl));
+	len += snprintf(buf+len, max_len-len, "\nsum");
+	for (hl = 0; hl < NR_SCHED_NR_HL; hl++)
+		len += snprintf(buf+len, max_len-len, " %d",
+				sched_get_nr_running_decayed_sum(hl));
+	len += snprintf(buf+len, max_len-len, "\n");
+
+	for_each_possible_cpu(cpu) {
+		len += snprintf(buf+len, max_len-len, "cpu%d", cpu);
+		for (hl = 0; hl < NR_SCHED_NR_HL; hl++)
+			len += snprintf(buf+len, max_len-len, " %d",
+				sched_get_nr_running_decayed(cpu, hl));
+		len += snprintf(buf+len, max_len-len, "\n");
+	}
+
+	return len;
+}
+
+static struct kobj_attribute nr_running_decay_attr =
+__ATTR(nr_running_decay, 0444, show_nr_running_decay, NULL);
+
 static struct attribute *rq_attrs[] = {
 	&cpu_normalized_load_attr.attr,
 	&def_timer_ms_attr.attr,
@@ -1045,6 +1093,8 @@ static struct attribute *rq_attrs[] = {
 	&avg_htasks_ac_attr.attr,
 	&over_util_attr.attr,
 	&big_task_attr.attr,
+	&nr_running_avg_attr.attr,
+	&nr_running_decay_attr.attr,
 	NULL,
 };
 
@@ -38,6 +38,22 @@ extern spinlock_t rqavg_lock;
 extern struct rq_data rq_info;
 extern struct workqueue_struct *rq_wq;
 
+/* Decayed nr_running, half-lives of ~4, 16, 67 and 268 ms */
+enum sched_nr_hl {
+	SCHED_NR_HL_4MS = 0,
+	SCHED_NR_HL_16MS,
+	SCHED_NR_HL_64MS,
+	SCHED_NR_HL_256MS,
+	NR_SCHED_NR_HL
+};
+
+extern int sched_get_nr_running_avg(int *avg, int *iowait_avg);
+extern int sched_get_nr_running_decayed(int cpu, int hl);
+extern int sched_get_nr_running_decayed_sum(int hl);
+extern void sched_get_nr_running_avg_decayed(unsigned int hl_ms,
+		int *avg, int *iowait_avg);
+extern unsigned int sched_nr_hl_ms(int hl);
+
 /* For heavy task detection */
 extern int sched_get_nr_heavy_running_avg(int cid, int *avg);
 extern void sched_update_nr_heavy_prod(int invoker,
@@ -24,6 +24,11 @@
 #include <linux/seq_file.h>
 #include <linux/module.h>
 #include <linux/list_sort.h>
+#include <linux/debugfs.h>
+#include <linux/log2.h>
+#include <linux/vmalloc.h>
+#include <linux/rt_mon.h>
+#include <trace/events/sched.h>
 #include "mtk_rt_mon.h"
 #include "mtk_ram_console.h"
 
@@ -61,6 +66,276 @@ static unsigned long long rt_dur_ts_buffer;
 char rt_monitor_print_at_AEE_buffer[124];
 unsigned long rt_mon_map[BITS_TO_LONGS(MAX_RT_TASK_COUNT)];
 static struct mt_rt_mon_struct memory_base[MAX_RT_TASK_COUNT];
+
+/*
+ * RT histograms
+ *
+ * Runtime per period, wakeup to run latency and throttling are counted
+ * per CPU and per priority band from the sched_switch and sched_wakeup
+ * tracepoints and the throttle path. All updates of a CPU's counters
+ * are made on that CPU with irqs disabled, so they need no lock. A
+ * throttle reported for another CPU is left in its remote_throttle
+ * atomics and folded in by that CPU before each snapshot.
+ *
+ * Each CPU has two histogram sets. A snapshot with reset switches every
+ * online CPU to the other set in an IPI and then collects and clears
+ * the old one, so every event is counted in exactly one snapshot.
+ */
+struct rt_mon_cpu {
+	u64 period_end;
+	u64 run_start;
+	int run_band;		/* band of the running RT task, -1 for none */
+	u64 acc[RT_MON_PRIO_NR];
+	int idx;
+	struct rt_mon_cpu_hist hist[2];
+	atomic_t remote_throttle[RT_MON_PRIO_NR];
+};
+
+static DEFINE_PER_CPU(struct rt_mon_cpu, rt_mon_cpu);
+static DEFINE_MUTEX(rt_mon_hist_lock);
+static u64 rt_mon_reset_ts;
+static bool rt_mon_hist_enable = true;
+
+static inline int rt_mon_band(struct task_struct *p)
+{
+	/* effective priority, a PI boosted task counts at its boost */
+	int rt_prio = MAX_RT_PRIO - 1 - p->prio;
+
+	return clamp(rt_prio >> RT_MON_PRIO_SHIFT, 0, RT_MON_PRIO_NR - 1);
+}
+
+static inline int rt_mon_bucket(u64 ns)
+{
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+
+	return us ? min_t(int, ilog2(us), RT_MON_BUCKET_NR - 1) : 0;
+}
+
+static inline struct rt_mon_cpu_hist *rt_mon_cur(struct rt_mon_cpu *rc)
+{
+	return &rc->hist[rc->idx];
+}
+
+static void rt_mon_close_period(struct rt_mon_cpu *rc)
+{
+	struct rt_mon_cpu_hist *h = rt_mon_cur(rc);
+	int i;
+
+	for (i = 0; i < RT_MON_PRIO_NR; i++) {
+		if (!rc->acc[i])
+			continue;
+		h->runtime[i][rt_mon_bucket(rc->acc[i])]++;
+		rc->acc[i] = 0;
+	}
+}
+
+/* charge the running RT task up to now and close the periods that ended */
+static void rt_mon_account(struct rt_mon_cpu *rc, u64 now)
+{
+	u64 period = global_rt_period();
+	u64 start = rc->run_start;
+
+	while (now >= rc->period_end) {
+		if (rc->run_band >= 0 && start < rc->period_end) {
+			rc->acc[rc->run_band] += rc->period_end - start;
+			start = rc->period_end;
+		}
+		rt_mon_close_period(rc);
+		rc->period_end += period;
+
+		/* periods without RT runtime are skipped at once */
+		if (rc->run_band < 0 && now >= rc->period_end)
+			rc->period_end += (div64_u64(now - rc->period_end,
+						period) + 1) * period;
+	}
+
+	if (rc->run_band >= 0 && now > start)
+		rc->acc[rc->run_band] += now - start;
+	rc->run_start = now;
+}
+
+static void rt_mon_probe_wakeup(void *data, struct task_struct *p)
+{
+	if (rt_mon_hist_enable && p->sched_class == &rt_sched_class)
+		p->se.mtk_rt_wake_ts = sched_clock();
+}
+
+static void rt_mon_probe_switch(void *data, bool preempt,
+		struct task_struct *prev, struct task_struct *next)
+{
+	struct rt_mon_cpu *rc = this_cpu_ptr(&rt_mon_cpu);
+	u64 now, wake_ts;
+
+	if (!rt_mon_hist_enable) {
+		rc->run_band = -1;
+		return;
+	}
+
+	now = sched_clock();
+	rt_mon_account(rc, now);
+
+	if (next->sched_class != &rt_sched_class) {
+		rc->run_band = -1;
+		return;
+	}
+
+	rc->run_band = rt_mon_band(next);
+	wake_ts = next->se.mtk_rt_wake_ts;
+	if (wake_ts) {
+		next->se.mtk_rt_wake_ts = 0;
+		rt_mon_cur(rc)->wakeup[rc->run_band][rt_mon_bucket(
+				now > wake_ts ? now - wake_ts : 0)]++;
+	}
+}
+
+static void rt_mon_hist_throttle(int cpu)
+{
+	struct rt_mon_cpu *rc = &per_cpu(rt_mon_cpu, cpu);
+	unsigned long flags;
+	int band;
+
+	if (!rt_mon_hist_enable)
+		return;
+
+	local_irq_save(flags);
+	band = max(READ_ONCE(rc->run_band), 0);
+	if (cpu == smp_processor_id())
+		rt_mon_cur(rc)->throttle[band]++;
+	else
+		atomic_inc(&rc->remote_throttle[band]);
+	local_irq_restore(flags);
+}
+
+static void rt_mon_hist_flip(void *info)
+{
+	struct rt_mon_cpu *rc = this_cpu_ptr(&rt_mon_cpu);
+	struct rt_mon_cpu_hist *h = rt_mon_cur(rc);
+	int i;
+
+	/* pending periods and remote throttles go into the snapshot */
+	rt_mon_account(rc, sched_clock());
+	for (i = 0; i < RT_MON_PRIO_NR; i++)
+		if (atomic_read(&rc->remote_throttle[i]))
+			h->throttle[i] +=
+				atomic_xchg(&rc->remote_throttle[i], 0);
+	if (*(bool *)info)
+		rc->idx ^= 1;
+}
+
+static void *rt_mon_hist_snapshot(bool reset, size_t *size)
+{
+	struct rt_mon_hdr *hdr;
+	struct rt_mon_cpu_hist *out, *src;
+	struct rt_mon_cpu *rc;
+	u64 now;
+	int cpu;
+
+	*size = sizeof(*hdr) + num_possible_cpus() * sizeof(*out);
+	hdr = vzalloc(*size);
+	if (!hdr)
+		return NULL;
+
+	hdr->magic = RT_MON_MAGIC;
+	hdr->version = RT_MON_VERSION;
+	hdr->nr_cpu = num_possible_cpus();
+	hdr->nr_prio = RT_MON_PRIO_NR;
+	hdr->nr_bucket = RT_MON_BUCKET_NR;
+	hdr->prio_shift = RT_MON_PRIO_SHIFT;
+	hdr->period_ns = global_rt_period();
+	out = (struct rt_mon_cpu_hist *)(hdr + 1);
+
+	mutex_lock(&rt_mon_hist_lock);
+	get_online_cpus();
+
+	on_each_cpu(rt_mon_hist_flip, &reset, 1);
+	now = sched_clock();
+	hdr->span_ns = now - rt_mon_reset_ts;
+	if (reset)
+		rt_mon_reset_ts = now;
+
+	for_each_possible_cpu(cpu) {
+		rc = &per_cpu(rt_mon_cpu, cpu);
+		/* offline CPUs were not switched and have no writer */
+		src = &rc->hist[rc->idx ^ (reset && cpu_online(cpu))];
+		memcpy(out, src, sizeof(*out));
+		out->cpu = cpu;
+		if (reset)
+			memset(src, 0, sizeof(*src));
+		out++;
+	}
+
+	put_online_cpus();
+	mutex_unlock(&rt_mon_hist_lock);
+
+	return hdr;
+}
+
+struct rt_mon_snap {
+	void *buf;
+	size_t size;
+};
+
+static int rt_mon_hist_do_open(struct file *file, bool reset)
+{
+	struct rt_mon_snap *snap;
+
+	snap = kzalloc(sizeof(*snap), GFP_KERNEL);
+	if (!snap)
+		return -ENOMEM;
+
+	snap->buf = rt_mon_hist_snapshot(reset, &snap->size);
+	if (!snap->buf) {
+		kfree(snap);
+		return -ENOMEM;
+	}
+	file->private_data = snap;
+
+	return 0;
+}
+
+static int rt_mon_hist_open(struct inode *inode, struct file *file)
+{
+	return rt_mon_hist_do_open(file, false);
+}
+
+static int rt_mon_hist_reset_open(struct inode *inode, struct file *file)
+{
+	return rt_mon_hist_do_open(file, true);
+}
+
+static ssize_t rt_mon_hist_read(struct file *file, char __user *ubuf,
+		size_t cnt, loff_t *ppos)
+{
+	struct rt_mon_snap *snap = file->private_data;
+
+	return simple_read_from_buffer(ubuf, cnt, ppos, snap->buf, snap->size);
+}
+
+static int rt_mon_hist_release(struct inode *inode, struct file *file)
+{
+	struct rt_mon_snap *snap = file->private_data;
+
+	vfree(snap->buf);
+	kfree(snap);
+
+	return 0;
+}
+
+/* hist: snapshot taken at open; hist_reset: same, and counters cleared */
+static const struct file_operations rt_mon_hist_fops = {
+	.open = rt_mon_hist_open,
+	.read = rt_mon_hist_read,
+	.llseek = default_llseek,
+	.release = rt_mon_hist_release,
+};
+
+static const struct file_operations rt_mon_hist_reset_fops = {
+	.open = rt_mon_hist_reset_open,
+	.read = rt_mon_hist_read,
+	.llseek = default_llseek,
+	.release = rt_mon_hist_release,
+};
+
 /*
  * Ease the printing of nsec fields:
  */
@@ -258,6 +533,8 @@ void mt_rt_mon_print_task(int cpu)
 	struct mt_rt_mon_struct *tmp;
 	struct list_head *list_head;
 
+	rt_mon_hist_throttle(cpu);
+
 	rt_mon_cpu_buffer = cpu;
 	rt_mon_count_buffer = __raw_get_cpu_var(rt_mon_count);
 	rt_start_ts_buffer = __raw_get_cpu_var(rt_start_ts);
@@ -409,3 +686,35 @@ static int __init mt_rt_mon_init(void)
 	return 0;
 }
 early_initcall(mt_rt_mon_init);
+
+static int __init rt_mon_hist_init(void)
+{
+	struct dentry *dir;
+	int cpu, ret;
+
+	for_each_possible_cpu(cpu)
+		per_cpu(rt_mon_cpu, cpu).run_band = -1;
+	rt_mon_reset_ts = sched_clock();
+
+	ret = register_trace_sched_wakeup(rt_mon_probe_wakeup, NULL);
+	if (!ret)
+		ret = register_trace_sched_wakeup_new(rt_mon_probe_wakeup, NULL);
+	if (!ret)
+		ret = register_trace_sched_switch(rt_mon_probe_switch, NULL);
+	if (ret) {
+		pr_info("[name:rt_monitor&] register probes failed: %d\n", ret);
+		return ret;
+	}
+
+	dir = debugfs_create_dir("rt_monitor", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	debugfs_create_bool("enable", 0644, dir, &rt_mon_hist_enable);
+	debugfs_create_file("hist", 0444, dir, NULL, &rt_mon_hist_fops);
+	debugfs_create_file("hist_reset", 0400, dir, NULL,
+			&rt_mon_hist_reset_fops);
+
+	return 0;
+}
+late_initcall(rt_mon_hist_init);
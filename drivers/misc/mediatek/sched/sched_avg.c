@@ -19,6 +19,8 @@
 #include <linux/hrtimer.h>
 #include <linux/sched.h>
 #include <linux/math64.h>
+#include <linux/mutex.h>
+#include <linux/seqlock.h>
 #include <linux/types.h>
 #include <linux/sched/clock.h>
 #include <linux/topology.h>
@@ -26,6 +28,7 @@
 #include <trace/events/sched.h>
 //TODO: remove comment after met ready
 //#include <mt-plat/mt_sched.h>
+#include <mt-plat/mtk_sched.h>
 #include "rq_stats.h"
 
 // TODO: remove comment after MET ready
@@ -951,6 +954,210 @@ void sched_big_task_nr(int *L_nr, int *B_nr)
 }
 EXPORT_SYMBOL(sched_big_task_nr);
 
+/*
+ * Decayed nr_running
+ *
+ * Exponentially decayed nr_running of each CPU for a few half-lives,
+ * updated in sched_update_nr_prod() at enqueue and dequeue only. The
+ * value is stored together with the time and nr_running of the last
+ * update under a per-CPU seqcount; readers decay it to the read time
+ * themselves, so they neither take a lock nor disturb remote CPUs.
+ *
+ * Half-lives are powers of two in ns so that the decay needs no
+ * division: 2^-(dt / hl) is a shift for the whole half-lives and a
+ * table lookup for the remaining 1/32 steps.
+ */
+#define NR_DECAY_SHIFT		10	/* fixed point of the averages */
+#define NR_DECAY_FRAC_BITS	5
+
+static const unsigned int nr_decay_hl_shift[NR_SCHED_NR_HL] = {
+	22, 24, 26, 28,	/* ~4, 16, 67, 268 ms */
+};
+
+/* 2^(-i/32) << 32 */
+static const u32 nr_decay_frac[1 << NR_DECAY_FRAC_BITS] = {
+	0xffffffff, 0xfa83b2db, 0xf5257d15, 0xefe4b99c,
+	0xeac0c6e8, 0xe5b906e7, 0xe0ccdeec, 0xdbfbb798,
+	0xd744fccb, 0xd2a81d92, 0xce248c15, 0xc9b9bd86,
+	0xc5672a11, 0xc12c4cca, 0xbd08a39f, 0xb8fbaf47,
+	0xb504f334, 0xb123f582, 0xad583eea, 0xa9a15ab5,
+	0xa5fed6aa, 0xa2704303, 0x9ef53261, 0x9b8d39ba,
+	0x9837f052, 0x94f4efa9, 0x91c3d374, 0x8ea4398b,
+	0x8b95c1e4, 0x88980e81, 0x85aac368, 0x82cd8699,
+};
+
+struct nr_decay {
+	seqcount_t seq;
+	u64 last;
+	unsigned int nr;
+	unsigned int iowait;
+	u64 avg[NR_SCHED_NR_HL];
+	u64 iowait_avg[NR_SCHED_NR_HL];
+};
+
+static DEFINE_PER_CPU(struct nr_decay, nr_decay);
+
+/* decay avg towards nr over delta ns */
+static u64 nr_decay_to(u64 avg, unsigned int nr, u64 delta, int hl)
+{
+	unsigned int shift = nr_decay_hl_shift[hl];
+	u64 target = (u64)nr << NR_DECAY_SHIFT;
+	u64 n = delta >> shift;
+	u64 factor;
+
+	if (n >= 32)
+		return target;
+
+	factor = nr_decay_frac[(delta >> (shift - NR_DECAY_FRAC_BITS)) &
+			((1 << NR_DECAY_FRAC_BITS) - 1)] >> n;
+
+	if (avg >= target)
+		return target + (((avg - target) * factor) >> 32);
+	return target - (((target - avg) * factor) >> 32);
+}
+
+/* writers are serialized by nr_lock */
+static void nr_decay_update(int cpu, u64 now, unsigned int nr)
+{
+	struct nr_decay *d = &per_cpu(nr_decay, cpu);
+	u64 delta = now - d->last;
+	int i;
+
+	write_seqcount_begin(&d->seq);
+	for (i = 0; i < NR_SCHED_NR_HL; i++) {
+		d->avg[i] = nr_decay_to(d->avg[i], d->nr, delta, i);
+		d->iowait_avg[i] = nr_decay_to(d->iowait_avg[i], d->iowait,
+					       delta, i);
+	}
+	d->last = now;
+	d->nr = nr;
+	d->iowait = nr_iowait_cpu(cpu);
+	write_seqcount_end(&d->seq);
+}
+
+/* decayed nr_running and iowait of cpu * 100, at the time of the read */
+static void nr_decay_read(int cpu, int hl, int *avg, int *iowait_avg)
+{
+	struct nr_decay *d = &per_cpu(nr_decay, cpu);
+	unsigned int seq, nr, iowait;
+	u64 a, io, last, now;
+
+	do {
+		seq = read_seqcount_begin(&d->seq);
+		a = d->avg[hl];
+		io = d->iowait_avg[hl];
+		last = d->last;
+		nr = d->nr;
+		iowait = d->iowait;
+	} while (read_seqcount_retry(&d->seq, seq));
+
+	now = sched_clock();
+	last = now > last ? now - last : 0;
+	*avg = (int)((nr_decay_to(a, nr, last, hl) * 100) >> NR_DECAY_SHIFT);
+	*iowait_avg = (int)((nr_decay_to(io, iowait, last, hl) * 100) >>
+			    NR_DECAY_SHIFT);
+}
+
+/**
+ * sched_get_nr_running_decayed
+ * @cpu: The core id.
+ * @hl: One of enum sched_nr_hl.
+ * @return: Decayed nr_running of cpu * 100.
+ *
+ * Lockless, may be called from any context and concurrently.
+ */
+int sched_get_nr_running_decayed(int cpu, int hl)
+{
+	int avg, iowait_avg;
+
+	if (hl < 0 || hl >= NR_SCHED_NR_HL)
+		return 0;
+
+	nr_decay_read(cpu, hl, &avg, &iowait_avg);
+
+	return avg;
+}
+EXPORT_SYMBOL(sched_get_nr_running_decayed);
+
+/**
+ * sched_get_nr_running_decayed_sum
+ * @hl: One of enum sched_nr_hl.
+ * @return: Sum of the decayed nr_running of all CPUs * 100.
+ */
+int sched_get_nr_running_decayed_sum(int hl)
+{
+	int cpu, sum = 0;
+
+	for_each_possible_cpu(cpu)
+		sum += sched_get_nr_running_decayed(cpu, hl);
+
+	return sum;
+}
+EXPORT_SYMBOL(sched_get_nr_running_decayed_sum);
+
+/**
+ * sched_get_nr_running_avg_decayed
+ * @hl_ms: Half-life in ms, rounded up to one of the tracked ones.
+ * @avg: Decayed nr_running of all CPUs * 100.
+ * @iowait_avg: Decayed nr_iowait of all CPUs * 100.
+ *
+ * What sched_get_nr_running_avg() reports, without its shared window:
+ * takes no lock and resets nothing, so any number of users may poll it.
+ */
+void sched_get_nr_running_avg_decayed(unsigned int hl_ms, int *avg,
+		int *iowait_avg)
+{
+	int cpu, hl, a, io;
+
+	for (hl = 0; hl < NR_SCHED_NR_HL - 1; hl++)
+		if (sched_nr_hl_ms(hl) >= hl_ms)
+			break;
+
+	*avg = 0;
+	*iowait_avg = 0;
+	for_each_possible_cpu(cpu) {
+		nr_decay_read(cpu, hl, &a, &io);
+		*avg += a;
+		*iowait_avg += io;
+	}
+}
+EXPORT_SYMBOL(sched_get_nr_running_avg_decayed);
+
+/* half-life of hl in ms, rounded */
+unsigned int sched_nr_hl_ms(int hl)
+{
+	if (hl < 0 || hl >= NR_SCHED_NR_HL)
+		return 0;
+
+	return DIV_ROUND_CLOSEST(1U << nr_decay_hl_shift[hl], NSEC_PER_MSEC);
+}
+
+static int __init nr_decay_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		seqcount_init(&per_cpu(nr_decay, cpu).seq);
+
+	return 0;
+}
+early_initcall(nr_decay_init);
+
+/* Called with the rq lock held, must only queue irq_work */
+static void (*lt_sched_kick_fp)(int cpu, u64 now);
+static DEFINE_MUTEX(lt_sched_kick_lock);
+
+void sched_set_lt_kick(void (*fn)(int cpu, u64 now))
+{
+	mutex_lock(&lt_sched_kick_lock);
+	WRITE_ONCE(lt_sched_kick_fp, fn);
+	/* callers hold the rq lock, so they run with preemption disabled */
+	if (!fn)
+		synchronize_sched();
+	mutex_unlock(&lt_sched_kick_lock);
+}
+EXPORT_SYMBOL(sched_set_lt_kick);
+
 /**
  * sched_update_nr_prod
  * @cpu: The core id of the nr running driver.
@@ -962,6 +1169,7 @@ EXPORT_SYMBOL(sched_big_task_nr);
  */
 void sched_update_nr_prod(int cpu, unsigned long nr_running, int inc)
 {
+	void (*kick)(int cpu, u64 now);
 	s64 diff;
 	u64 curr_time;
 	unsigned long flags;
@@ -986,8 +1194,14 @@ void sched_update_nr_prod(int cpu, unsigned long nr_running, int inc)
 
 	per_cpu(nr_prod_sum, cpu) += nr_running * diff;
 	per_cpu(iowait_prod_sum, cpu) += nr_iowait_cpu(cpu) * diff;
+	nr_decay_update(cpu, curr_time, nr_running + inc);
 
 	spin_unlock_irqrestore(&per_cpu(nr_lock, cpu), flags);
+
+	/* idle <-> busy transition, let load tracker re-evaluate */
+	kick = READ_ONCE(lt_sched_kick_fp);
+	if (kick && (!nr_running || !(nr_running + inc)))
+		kick(cpu, curr_time);
 }
 EXPORT_SYMBOL(sched_update_nr_prod);
 
@@ -45,6 +45,13 @@ unsigned int sensor_event_poll(unsigned char handle, struct file *file,
 	poll_table *wait);
 int sensor_input_event(unsigned char handle,
 			 const struct sensor_event *event);
+int sensor_input_events(unsigned char handle,
+			const struct sensor_event *events, unsigned int nr);
+void sensor_input_batch_begin(void);
+void sensor_input_batch_end(void);
+void sensor_ring_deliver(unsigned char handle,
+			 const struct sensor_event *event, unsigned int nr);
+bool sensor_ring_exclusive(unsigned char handle);
 unsigned int sensor_event_register(unsigned char handle);
 unsigned int sensor_event_deregister(unsigned char handle);
 #endif
@@ -107,6 +107,8 @@ int sensor_attr_register(struct sensor_attr_t *misc)
 	mutex_unlock(&sensor_attr_mtx);
 	return err;
 }
+EXPORT_SYMBOL_GPL(sensor_attr_register);
+
 int sensor_attr_deregister(struct sensor_attr_t *misc)
 {
 	if (WARN_ON(list_empty(&misc->list)))
@@ -120,6 +122,7 @@ int sensor_attr_deregister(struct sensor_attr_t *misc)
 	sensor_event_deregister(misc->minor);
 	return 0;
 }
+EXPORT_SYMBOL_GPL(sensor_attr_deregister);
 #if 0
 static char *sensor_attr_devnode(struct device *dev, umode_t *mode)
 {
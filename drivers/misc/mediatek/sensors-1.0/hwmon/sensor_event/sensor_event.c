@@ -24,6 +24,7 @@
 #include <linux/init.h>
 #include <linux/mm.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/poll.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
@@ -43,10 +44,8 @@ struct sensor_event_obj {
 };
 static struct sensor_event_obj *event_obj;
 static struct lock_class_key buffer_lock_key[ID_SENSOR_MAX_HANDLE + 1];
-/*
- * sensor_input_event only support process context.
- */
-int sensor_input_event(unsigned char handle, const struct sensor_event *event)
+static int sensor_event_push(unsigned char handle,
+			     const struct sensor_event *event)
 {
 	struct sensor_event_client *client = &event_obj->client[handle];
 	unsigned int dummy = 0;
@@ -81,6 +80,106 @@ int sensor_input_event(unsigned char handle, const struct sensor_event *event)
 	return 0;
 }
 
+#define SENSOR_INPUT_BATCH_MAX	64
+
+/*
+ * The hub FIFO drain reports events one at a time through the sensor
+ * drivers. Between sensor_input_batch_begin() and _end() the events of
+ * handles held exclusively by a ring are staged here, per run of one
+ * handle, and handed on with sensor_input_events().
+ */
+static struct sensor_input_batch {
+	struct mutex lock;
+	struct task_struct *owner;
+	unsigned char handle;
+	unsigned int nr;
+	struct sensor_event event[SENSOR_INPUT_BATCH_MAX];
+} input_batch = {
+	.lock = __MUTEX_INITIALIZER(input_batch.lock),
+};
+
+static void sensor_input_batch_flush(void)
+{
+	struct sensor_input_batch *b = &input_batch;
+
+	if (b->nr)
+		sensor_input_events(b->handle, b->event, b->nr);
+	b->nr = 0;
+}
+
+/* owner context */
+static int sensor_input_batch_add(unsigned char handle,
+				  const struct sensor_event *event)
+{
+	struct sensor_input_batch *b = &input_batch;
+
+	if (b->nr && (b->handle != handle || b->nr == SENSOR_INPUT_BATCH_MAX))
+		sensor_input_batch_flush();
+
+	/* the read() buffer may be full and the caller has to retry */
+	if (!sensor_ring_exclusive(handle))
+		return sensor_input_events(handle, event, 1);
+
+	b->handle = handle;
+	b->event[b->nr++] = *event;
+	return 0;
+}
+
+void sensor_input_batch_begin(void)
+{
+	mutex_lock(&input_batch.lock);
+	WRITE_ONCE(input_batch.owner, current);
+}
+EXPORT_SYMBOL_GPL(sensor_input_batch_begin);
+
+void sensor_input_batch_end(void)
+{
+	sensor_input_batch_flush();
+	WRITE_ONCE(input_batch.owner, NULL);
+	mutex_unlock(&input_batch.lock);
+}
+EXPORT_SYMBOL_GPL(sensor_input_batch_end);
+
+/*
+ * sensor_input_event only support process context.
+ */
+int sensor_input_event(unsigned char handle, const struct sensor_event *event)
+{
+	if (READ_ONCE(input_batch.owner) == current)
+		return sensor_input_batch_add(handle, event);
+
+	return sensor_input_events(handle, event, 1);
+}
+EXPORT_SYMBOL_GPL(sensor_input_event);
+
+/*
+ * Batch of events of one handle, e.g. a flushed hub FIFO. Mapped readers
+ * get the batch in one go with a single wakeup check.
+ */
+int sensor_input_events(unsigned char handle,
+			const struct sensor_event *events, unsigned int nr)
+{
+	unsigned int i;
+	int err = 0;
+
+	/* mapped /dev/sensor_ring readers may own the handle */
+	if (sensor_ring_exclusive(handle)) {
+		sensor_ring_deliver(handle, events, nr);
+		return 0;
+	}
+
+	/* the caller retries what did not fit, rings get it then */
+	for (i = 0; i < nr; i++) {
+		err = sensor_event_push(handle, &events[i]);
+		if (err)
+			break;
+	}
+	sensor_ring_deliver(handle, events, i);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(sensor_input_events);
+
 static int sensor_event_fetch_next(struct sensor_event_client *client,
 				   struct sensor_event *event)
 {
@@ -139,6 +238,7 @@ ssize_t sensor_event_read(unsigned char handle, struct file *file,
 
 	return read;
 }
+EXPORT_SYMBOL_GPL(sensor_event_read);
 
 unsigned int sensor_event_poll(unsigned char handle, struct file *file,
 			       poll_table *wait)
@@ -155,6 +255,7 @@ unsigned int sensor_event_poll(unsigned char handle, struct file *file,
 
 	return mask;
 }
+EXPORT_SYMBOL_GPL(sensor_event_poll);
 unsigned int sensor_event_register(unsigned char handle)
 {
 	struct sensor_event_obj *obj = event_obj;
@@ -244,7 +345,8 @@ unsigned int sensor_event_deregister(unsigned char handle)
 {
 	struct sensor_event_obj *obj = event_obj;
 
-	kfree(obj->client[handle].buffer);
+	vfree(obj->client[handle].buffer);
+	obj->client[handle].buffer = NULL;
 	return 0;
 }
 
@@ -0,0 +1,459 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+/*
+ * Sensor event ring, /dev/sensor_ring
+ *
+ * Each open file owns one ring which user space maps and drains without
+ * a system call per event. The ring subscribes to any number of sensor
+ * handles, every event passed to sensor_input_event() for a subscribed
+ * handle is copied once into the ring as is, timestamp included. Readers
+ * are woken through poll() and an optional eventfd only when a handle
+ * reaches its watermark or its latency bound, so a batched 400 Hz IMU
+ * stream costs a few wakeups per second instead of one read() per event.
+ */
+
+#define pr_fmt(fmt) "<sensor_ring> " fmt
+
+#include "sensor_event.h"
+#include "hwmsensor.h"
+#include <linux/compat.h>
+#include <linux/eventfd.h>
+#include <linux/fs.h>
+#include <linux/hrtimer.h>
+#include <linux/init.h>
+#include <linux/log2.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/poll.h>
+#include <linux/rculist.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <uapi/linux/sensor_ring.h>
+
+static unsigned int sensor_ring_slots = 4096;
+module_param(sensor_ring_slots, uint, 0644);
+MODULE_PARM_DESC(sensor_ring_slots, "Events per ring, power of two");
+
+struct sensor_ring;
+
+struct sensor_ring_subscriber {
+	struct list_head handle_node;	/* sensor_ring_subs[handle], rcu */
+	struct list_head ring_node;	/* ring->subs */
+	struct sensor_ring *ring;
+	unsigned char handle;
+	unsigned int watermark;
+	u64 max_latency_ns;
+	unsigned int flags;
+	unsigned int pending;		/* events since the last wakeup */
+	struct rcu_head rcu;
+};
+
+struct sensor_ring {
+	spinlock_t lock;		/* producer side and wakeup state */
+	struct sensor_ring_hdr *hdr;	/* vmalloc_user, mapped by the reader */
+	struct sensor_ring_event *slot;
+	unsigned int nr_slots;
+	u64 head;			/* kernel copy, hdr->head is published */
+	bool ready;			/* a wakeup condition was met */
+	ktime_t deadline;		/* earliest latency bound, 0 if none */
+	struct hrtimer timer;
+	wait_queue_head_t wait;
+	struct eventfd_ctx *efd;
+	struct list_head subs;		/* sensor_ring_mutex and lock */
+};
+
+static struct list_head sensor_ring_subs[ID_SENSOR_MAX_HANDLE + 1];
+static unsigned int sensor_ring_nr_excl[ID_SENSOR_MAX_HANDLE + 1];
+static DEFINE_MUTEX(sensor_ring_mutex);
+
+/* ring->lock held */
+static void sensor_ring_wake(struct sensor_ring *ring)
+{
+	struct sensor_ring_subscriber *sub;
+
+	list_for_each_entry(sub, &ring->subs, ring_node)
+		sub->pending = 0;
+	ring->deadline = 0;
+	hrtimer_try_to_cancel(&ring->timer);
+
+	ring->ready = true;
+	wake_up_interruptible(&ring->wait);
+	if (ring->efd)
+		eventfd_signal(ring->efd, 1);
+}
+
+static enum hrtimer_restart sensor_ring_timeout(struct hrtimer *timer)
+{
+	struct sensor_ring *ring = container_of(timer, struct sensor_ring,
+			timer);
+	unsigned long flags;
+
+	spin_lock_irqsave(&ring->lock, flags);
+	if (ring->deadline)
+		sensor_ring_wake(ring);
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
+/* ring->lock held */
+static void sensor_ring_put(struct sensor_ring_subscriber *sub,
+		const struct sensor_event *event, unsigned int nr)
+{
+	struct sensor_ring *ring = sub->ring;
+	struct sensor_ring_hdr *hdr = ring->hdr;
+	unsigned int mask = ring->nr_slots - 1;
+	unsigned int i, room;
+	bool wake = false;
+	u64 tail, used;
+	ktime_t deadline;
+
+	/* pairs with the release store of the consumer */
+	tail = smp_load_acquire(&hdr->tail);
+	used = ring->head - tail;
+	if (unlikely(used > ring->nr_slots)) {
+		/* garbage tail from user space, resync */
+		used = 0;
+		WRITE_ONCE(hdr->tail, ring->head);
+	}
+
+	room = ring->nr_slots - used;
+	if (nr > room) {
+		WRITE_ONCE(hdr->dropped, hdr->dropped + nr - room);
+		nr = room;
+		wake = true;
+	}
+
+	for (i = 0; i < nr; i++) {
+		memcpy(&ring->slot[(ring->head + i) & mask], &event[i],
+		       sizeof(struct sensor_ring_event));
+		if (event[i].flush_action != DATA_ACTION)
+			wake = true;
+	}
+	ring->head += nr;
+	/* slots before head */
+	smp_store_release(&hdr->head, ring->head);
+
+	sub->pending += nr;
+	if (sub->pending >= sub->watermark ||
+	    (ring->head - tail) * 4 >= (u64)ring->nr_slots * 3)
+		wake = true;
+
+	if (wake) {
+		sensor_ring_wake(ring);
+		return;
+	}
+
+	if (!sub->max_latency_ns || sub->pending != nr)
+		return;
+	/* first pending event of the handle, bound its latency */
+	deadline = ktime_add_ns(ktime_get(), sub->max_latency_ns);
+	if (!ring->deadline || ktime_before(deadline, ring->deadline)) {
+		ring->deadline = deadline;
+		hrtimer_start(&ring->timer, deadline, HRTIMER_MODE_ABS);
+	}
+}
+
+/*
+ * Copy events of one handle into every subscribed ring. Unless the
+ * handle is exclusive, call it only for events that made it into the
+ * read() buffer, or a retried event shows up twice in the rings.
+ */
+void sensor_ring_deliver(unsigned char handle,
+		const struct sensor_event *event, unsigned int nr)
+{
+	struct sensor_ring_subscriber *sub;
+	unsigned long flags;
+
+	if (handle > ID_SENSOR_MAX_HANDLE || !nr)
+		return;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(sub, &sensor_ring_subs[handle], handle_node) {
+		spin_lock_irqsave(&sub->ring->lock, flags);
+		sensor_ring_put(sub, event, nr);
+		spin_unlock_irqrestore(&sub->ring->lock, flags);
+	}
+	rcu_read_unlock();
+}
+EXPORT_SYMBOL_GPL(sensor_ring_deliver);
+
+/* events of the handle go to rings only, never to its read() buffer */
+bool sensor_ring_exclusive(unsigned char handle)
+{
+	return handle <= ID_SENSOR_MAX_HANDLE &&
+		READ_ONCE(sensor_ring_nr_excl[handle]) != 0;
+}
+EXPORT_SYMBOL_GPL(sensor_ring_exclusive);
+
+/* sensor_ring_mutex held */
+static struct sensor_ring_subscriber *sensor_ring_find(
+		struct sensor_ring *ring, unsigned int handle)
+{
+	struct sensor_ring_subscriber *sub;
+
+	list_for_each_entry(sub, &ring->subs, ring_node)
+		if (sub->handle == handle)
+			return sub;
+
+	return NULL;
+}
+
+/* sensor_ring_mutex and ring->lock held */
+static void sensor_ring_unsubscribe(struct sensor_ring_subscriber *sub)
+{
+	list_del_rcu(&sub->handle_node);
+	list_del(&sub->ring_node);
+	if (sub->flags & SENSOR_RING_EXCLUSIVE)
+		sensor_ring_nr_excl[sub->handle]--;
+	kfree_rcu(sub, rcu);
+}
+
+static int sensor_ring_subscribe(struct sensor_ring *ring,
+		const struct sensor_ring_sub *req)
+{
+	struct sensor_ring_subscriber *sub, *old;
+	unsigned long flags;
+
+	if (req->handle > ID_SENSOR_MAX_HANDLE ||
+	    req->flags & ~SENSOR_RING_EXCLUSIVE ||
+	    req->watermark > ring->nr_slots)
+		return -EINVAL;
+
+	sub = kzalloc(sizeof(*sub), GFP_KERNEL);
+	if (!sub)
+		return -ENOMEM;
+	sub->ring = ring;
+	sub->handle = req->handle;
+	sub->watermark = max(req->watermark, 1U);
+	sub->max_latency_ns = (u64)req->max_latency_us * NSEC_PER_USEC;
+	sub->flags = req->flags;
+
+	mutex_lock(&sensor_ring_mutex);
+	spin_lock_irqsave(&ring->lock, flags);
+	/* new parameters replace the old ones, pending starts over */
+	old = sensor_ring_find(ring, req->handle);
+	if (old)
+		sensor_ring_unsubscribe(old);
+	list_add_tail(&sub->ring_node, &ring->subs);
+	list_add_tail_rcu(&sub->handle_node, &sensor_ring_subs[sub->handle]);
+	if (sub->flags & SENSOR_RING_EXCLUSIVE)
+		sensor_ring_nr_excl[sub->handle]++;
+	spin_unlock_irqrestore(&ring->lock, flags);
+	mutex_unlock(&sensor_ring_mutex);
+
+	return 0;
+}
+
+static int sensor_ring_set_eventfd(struct sensor_ring *ring, int fd)
+{
+	struct eventfd_ctx *efd = NULL, *old;
+	unsigned long flags;
+
+	if (fd >= 0) {
+		efd = eventfd_ctx_fdget(fd);
+		if (IS_ERR(efd))
+			return PTR_ERR(efd);
+	}
+
+	spin_lock_irqsave(&ring->lock, flags);
+	old = ring->efd;
+	ring->efd = efd;
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+	if (old)
+		eventfd_ctx_put(old);
+
+	return 0;
+}
+
+static long sensor_ring_ioctl(struct file *file, unsigned int cmd,
+		unsigned long arg)
+{
+	struct sensor_ring *ring = file->private_data;
+	struct sensor_ring_subscriber *sub;
+	struct sensor_ring_sub req;
+	unsigned long flags;
+	u32 handle;
+	s32 fd;
+	int ret = 0;
+
+	switch (cmd) {
+	case SENSOR_RING_IOC_SUBSCRIBE:
+		if (copy_from_user(&req, (void __user *)arg, sizeof(req)))
+			return -EFAULT;
+		return sensor_ring_subscribe(ring, &req);
+	case SENSOR_RING_IOC_UNSUBSCRIBE:
+		if (get_user(handle, (u32 __user *)arg))
+			return -EFAULT;
+		mutex_lock(&sensor_ring_mutex);
+		sub = sensor_ring_find(ring, handle);
+		if (sub) {
+			spin_lock_irqsave(&ring->lock, flags);
+			sensor_ring_unsubscribe(sub);
+			spin_unlock_irqrestore(&ring->lock, flags);
+		} else {
+			ret = -ENOENT;
+		}
+		mutex_unlock(&sensor_ring_mutex);
+		return ret;
+	case SENSOR_RING_IOC_SET_EVENTFD:
+		if (get_user(fd, (s32 __user *)arg))
+			return -EFAULT;
+		return sensor_ring_set_eventfd(ring, fd);
+	default:
+		return -ENOTTY;
+	}
+}
+
+static unsigned int sensor_ring_poll(struct file *file, poll_table *wait)
+{
+	struct sensor_ring *ring = file->private_data;
+	unsigned int mask = 0;
+	unsigned long flags;
+
+	poll_wait(file, &ring->wait, wait);
+
+	spin_lock_irqsave(&ring->lock, flags);
+	/* drained, wait for the next wakeup condition */
+	if (ring->ready && READ_ONCE(ring->hdr->tail) == ring->head)
+		ring->ready = false;
+	if (ring->ready)
+		mask |= POLLIN | POLLRDNORM;
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+	return mask;
+}
+
+static int sensor_ring_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct sensor_ring *ring = file->private_data;
+
+	if (vma->vm_pgoff)
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, ring->hdr, 0);
+}
+
+static int sensor_ring_open(struct inode *inode, struct file *file)
+{
+	struct sensor_ring *ring;
+	unsigned int nr = sensor_ring_slots;
+
+	if (nr < 64 || !is_power_of_2(nr))
+		nr = 4096;
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	ring->hdr = vmalloc_user(PAGE_SIZE +
+			PAGE_ALIGN(nr * sizeof(struct sensor_ring_event)));
+	if (!ring->hdr) {
+		kfree(ring);
+		return -ENOMEM;
+	}
+	ring->hdr->magic = SENSOR_RING_MAGIC;
+	ring->hdr->version = SENSOR_RING_VERSION;
+	ring->hdr->nr_slots = nr;
+	ring->hdr->slot_size = sizeof(struct sensor_ring_event);
+	ring->hdr->data_offset = PAGE_SIZE;
+	ring->slot = (void *)ring->hdr + PAGE_SIZE;
+	ring->nr_slots = nr;
+
+	spin_lock_init(&ring->lock);
+	init_waitqueue_head(&ring->wait);
+	INIT_LIST_HEAD(&ring->subs);
+	hrtimer_init(&ring->timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	ring->timer.function = sensor_ring_timeout;
+
+	file->private_data = ring;
+
+	return nonseekable_open(inode, file);
+}
+
+static int sensor_ring_release(struct inode *inode, struct file *file)
+{
+	struct sensor_ring *ring = file->private_data;
+	struct sensor_ring_subscriber *sub, *tmp;
+	unsigned long flags;
+
+	mutex_lock(&sensor_ring_mutex);
+	spin_lock_irqsave(&ring->lock, flags);
+	list_for_each_entry_safe(sub, tmp, &ring->subs, ring_node)
+		sensor_ring_unsubscribe(sub);
+	spin_unlock_irqrestore(&ring->lock, flags);
+	mutex_unlock(&sensor_ring_mutex);
+
+	/* no producer can find the ring any more */
+	synchronize_rcu();
+	hrtimer_cancel(&ring->timer);
+
+	if (ring->efd)
+		eventfd_ctx_put(ring->efd);
+	vfree(ring->hdr);
+	kfree(ring);
+
+	return 0;
+}
+
+#if IS_ENABLED(CONFIG_COMPAT)
+static long sensor_ring_compat_ioctl(struct file *file, unsigned int cmd,
+		unsigned long arg)
+{
+	return sensor_ring_ioctl(file, cmd, (unsigned long)compat_ptr(arg));
+}
+#endif
+
+static const struct file_operations sensor_ring_fops = {
+	.owner = THIS_MODULE,
+	.open = sensor_ring_open,
+	.release = sensor_ring_release,
+	.poll = sensor_ring_poll,
+	.mmap = sensor_ring_mmap,
+	.unlocked_ioctl = sensor_ring_ioctl,
+#if IS_ENABLED(CONFIG_COMPAT)
+	.compat_ioctl = sensor_ring_compat_ioctl,
+#endif
+	.llseek = no_llseek,
+};
+
+static struct miscdevice sensor_ring_dev = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "sensor_ring",
+	.fops = &sensor_ring_fops,
+};
+
+static int __init sensor_ring_init(void)
+{
+	int i;
+
+	BUILD_BUG_ON(sizeof(struct sensor_event) !=
+		     sizeof(struct sensor_ring_event));
+
+	for (i = 0; i <= ID_SENSOR_MAX_HANDLE; i++)
+		INIT_LIST_HEAD(&sensor_ring_subs[i]);
+
+	return misc_register(&sensor_ring_dev);
+}
+module_init(sensor_ring_init);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("sensor event ring");
+MODULE_AUTHOR("Mediatek");
@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See http://www.gnu.org/licenses/gpl-2.0.html for more details.
+ */
+
+/*
+ * Virtual sensor for sensor event path tests
+ *
+ * Registers /dev/vsensor like a real sensor and generates events on
+ * request, batched like a hub FIFO flush. Writing "rate_hz batch count"
+ * to /sys/kernel/debug/vsensor/run emits count events in batches of
+ * batch, rate_hz apart in sample time, followed by one FLUSH_ACTION
+ * event. word[0] of data events is the sequence number from 0, the
+ * time_stamp of the last event of a batch is the CLOCK_BOOTTIME it was
+ * injected at, so readers can measure delivery latency.
+ */
+
+#define pr_fmt(fmt) "<vsensor> " fmt
+
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/hrtimer.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/wait.h>
+
+#include "hwmsensor.h"
+#include "sensor_attr.h"
+#include "sensor_event.h"
+
+#define VSENSOR_MAX_BATCH	512
+
+static int handle = ID_GYROSCOPE_UNCALIBRATED;
+module_param(handle, int, 0444);
+MODULE_PARM_DESC(handle, "Sensor handle to register, must be unused");
+
+struct vsensor_req {
+	unsigned int rate;
+	unsigned int batch;
+	unsigned int count;
+};
+
+static struct vsensor {
+	struct sensor_attr_t mdev;
+	struct task_struct *thread;
+	struct dentry *dir;
+	wait_queue_head_t wait;
+	spinlock_t lock;
+	struct vsensor_req req;
+	bool pending;
+	bool running;
+	/* last run */
+	u64 generated;
+	u64 rejected;
+	u64 elapsed_ns;
+} vs;
+
+static int vsensor_open(struct inode *inode, struct file *file)
+{
+	nonseekable_open(inode, file);
+	return 0;
+}
+
+static ssize_t vsensor_read(struct file *file, char __user *buffer,
+			    size_t count, loff_t *ppos)
+{
+	return sensor_event_read(vs.mdev.minor, file, buffer, count, ppos);
+}
+
+static unsigned int vsensor_poll(struct file *file, poll_table *wait)
+{
+	return sensor_event_poll(vs.mdev.minor, file, wait);
+}
+
+static const struct file_operations vsensor_fops = {
+	.owner = THIS_MODULE,
+	.open = vsensor_open,
+	.read = vsensor_read,
+	.poll = vsensor_poll,
+};
+
+static void vsensor_generate(const struct vsensor_req *req)
+{
+	struct sensor_event *ev;
+	u64 interval = NSEC_PER_SEC / req->rate;
+	u64 period = interval * req->batch;
+	u64 seq = 0, rejected = 0, now, t0;
+	unsigned int i, n;
+	ktime_t next;
+
+	ev = kcalloc(req->batch, sizeof(*ev), GFP_KERNEL);
+	if (!ev)
+		return;
+
+	t0 = ktime_get_ns();
+	next = ktime_get();
+	while (seq < req->count && !kthread_should_stop()) {
+		n = min_t(u64, req->batch, req->count - seq);
+		now = ktime_get_boot_ns();
+		for (i = 0; i < n; i++) {
+			ev[i].time_stamp = now - (n - 1 - i) * interval;
+			ev[i].handle = vs.mdev.minor;
+			ev[i].flush_action = DATA_ACTION;
+			ev[i].word[0] = seq + i;
+			ev[i].word[1] = n;
+		}
+		if (sensor_input_events(vs.mdev.minor, ev, n))
+			rejected += n;
+		seq += n;
+
+		next = ktime_add_ns(next, period);
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		schedule_hrtimeout_range(&next, 50 * NSEC_PER_USEC,
+				HRTIMER_MODE_ABS);
+	}
+
+	memset(ev, 0, sizeof(*ev));
+	ev->time_stamp = ktime_get_boot_ns();
+	ev->handle = vs.mdev.minor;
+	ev->flush_action = FLUSH_ACTION;
+	ev->word[0] = seq;
+	sensor_input_event(vs.mdev.minor, ev);
+
+	spin_lock(&vs.lock);
+	vs.generated = seq;
+	vs.rejected = rejected;
+	vs.elapsed_ns = ktime_get_ns() - t0;
+	spin_unlock(&vs.lock);
+
+	kfree(ev);
+}
+
+static int vsensor_thread(void *data)
+{
+	struct vsensor_req req;
+
+	while (!kthread_should_stop()) {
+		wait_event_interruptible(vs.wait,
+			READ_ONCE(vs.pending) || kthread_should_stop());
+		spin_lock(&vs.lock);
+		if (!vs.pending) {
+			spin_unlock(&vs.lock);
+			continue;
+		}
+		req = vs.req;
+		vs.pending = false;
+		vs.running = true;
+		spin_unlock(&vs.lock);
+
+		vsensor_generate(&req);
+
+		spin_lock(&vs.lock);
+		vs.running = false;
+		spin_unlock(&vs.lock);
+		wake_up_all(&vs.wait);
+	}
+
+	return 0;
+}
+
+static ssize_t vsensor_run_write(struct file *file, const char __user *ubuf,
+				 size_t count, loff_t *ppos)
+{
+	struct vsensor_req req;
+	char buf[64];
+	int ret = 0;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	if (sscanf(buf, "%u %u %u", &req.rate, &req.batch, &req.count) != 3 ||
+	    !req.rate || req.rate > NSEC_PER_SEC / 1000 || !req.batch ||
+	    req.batch > VSENSOR_MAX_BATCH)
+		return -EINVAL;
+
+	spin_lock(&vs.lock);
+	if (vs.pending || vs.running) {
+		ret = -EBUSY;
+	} else {
+		vs.req = req;
+		vs.pending = true;
+	}
+	spin_unlock(&vs.lock);
+	if (ret)
+		return ret;
+
+	wake_up_all(&vs.wait);
+
+	return count;
+}
+
+/* reading blocks until the last run has finished */
+static ssize_t vsensor_run_read(struct file *file, char __user *ubuf,
+				size_t count, loff_t *ppos)
+{
+	char buf[128];
+	int len;
+
+	if (!*ppos && wait_event_interruptible(vs.wait,
+			!READ_ONCE(vs.pending) && !READ_ONCE(vs.running)))
+		return -ERESTARTSYS;
+
+	spin_lock(&vs.lock);
+	len = scnprintf(buf, sizeof(buf),
+			"handle %d generated %llu rejected %llu elapsed_ns %llu\n",
+			vs.mdev.minor, vs.generated, vs.rejected,
+			vs.elapsed_ns);
+	spin_unlock(&vs.lock);
+
+	return simple_read_from_buffer(ubuf, count, ppos, buf, len);
+}
+
+static const struct file_operations vsensor_run_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.read = vsensor_run_read,
+	.write = vsensor_run_write,
+	.llseek = default_llseek,
+};
+
+static int __init vsensor_init(void)
+{
+	int err;
+
+	if (handle < 0 || handle > ID_SENSOR_MAX_HANDLE)
+		return -EINVAL;
+
+	init_waitqueue_head(&vs.wait);
+	spin_lock_init(&vs.lock);
+
+	vs.mdev.minor = handle;
+	vs.mdev.name = "vsensor";
+	vs.mdev.fops = &vsensor_fops;
+	err = sensor_attr_register(&vs.mdev);
+	if (err) {
+		pr_err("cannot register handle %d: %d\n", handle, err);
+		return err;
+	}
+
+	vs.thread = kthread_run(vsensor_thread, NULL, "vsensor");
+	if (IS_ERR(vs.thread)) {
+		err = PTR_ERR(vs.thread);
+		goto err_attr;
+	}
+
+	vs.dir = debugfs_create_dir("vsensor", NULL);
+	if (!vs.dir ||
+	    !debugfs_create_file("run", 0600, vs.dir, NULL, &vsensor_run_fops)) {
+		err = -ENOMEM;
+		goto err_thread;
+	}
+
+	return 0;
+
+err_thread:
+	debugfs_remove_recursive(vs.dir);
+	kthread_stop(vs.thread);
+err_attr:
+	sensor_attr_deregister(&vs.mdev);
+	return err;
+}
+
+static void __exit vsensor_exit(void)
+{
+	debugfs_remove_recursive(vs.dir);
+	kthread_stop(vs.thread);
+	sensor_attr_deregister(&vs.mdev);
+}
+
+module_init(vsensor_init);
+module_exit(vsensor_exit);
+
+MODULE_AUTHOR("Mediatek");
+MODULE_DESCRIPTION("virtual sensor for sensor event tests");
+MODULE_LICENSE("GPL");
@@ -1175,7 +1175,11 @@ static int SCP_sensorHub_server_dispatch_data(uint32_t *currWp)
 	 * will change time_stamp field, so when SCP_sensorHub_report_data fail
 	 * we should reinit the time_stamp by memcpy to event_copy;
 	 * why memcpy_fromio(&event_copy), because rp is not cacheable
+	 *
+	 * the drain is one batch for mapped sensor_ring readers, they get
+	 * the events of a handle in runs instead of one by one
 	 */
+	sensor_input_batch_begin();
 	if (rp < wp) {
 		while (rp < wp) {
 			memcpy_fromio(&event, rp, SENSOR_DATA_SIZE);
@@ -1241,6 +1245,7 @@ static int SCP_sensorHub_server_dispatch_data(uint32_t *currWp)
 			rp += SENSOR_DATA_SIZE;
 		}
 	}
+	sensor_input_batch_end();
 	/* must obj->SCP_sensorFIFO->rp = wp,
 	 *there can not obj->SCP_sensorFIFO->rp = obj->SCP_sensorFIFO->wp
 	 */
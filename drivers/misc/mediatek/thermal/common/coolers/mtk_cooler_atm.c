@@ -21,6 +21,7 @@
 #include "mt-plat/mtk_thermal_monitor.h"
 #include "mach/mtk_thermal.h"
 #include "mt-plat/mtk_thermal_platform.h"
+#include "mt-plat/mtk_thermal_headroom.h"
 #if defined(CONFIG_MTK_CLKMGR)
 #include <mach/mtk_clkmgr.h>
 #else
@@ -3617,6 +3618,11 @@ static int krtatm_thread(void *arg)
 			_adaptive_power_calc(krtatm_prev_maxtj,
 						krtatm_curr_maxtj,
 						(unsigned int) gpu_loading);
+#if PRECISE_HYBRID_POWER_BUDGET
+			mtk_thermal_headroom_update(krtatm_curr_maxtj,
+						TARGET_TJ,
+						get_total_curr_power());
+#endif
 
 			/* To confirm if krtatm kthread is really running. */
 			if (krtatm_curr_maxtj >= 100000 ||
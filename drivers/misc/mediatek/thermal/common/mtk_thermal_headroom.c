@@ -0,0 +1,337 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Thermal headroom budget
+ *
+ * ATM hands over the hottest temperature, its target and the power of the
+ * current CPU/GPU OPPs every time it runs. The RC model turns that into
+ * a budget that FPSGO can plan frame rates against, instead of finding
+ * out about the limit when the coolers cut frequency.
+ *
+ * The ambient of the model is not the room: it is observed, so it also
+ * takes whatever heat the OPP power leaves out (modem, display, charger).
+ * Each window of samples gives ambient = T + tau x dT/dt - P x r, which
+ * is filtered with a time constant long against tau.
+ */
+
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+#include "mt-plat/mtk_thermal_monitor.h"
+#include "mt-plat/mtk_thermal_headroom.h"
+
+#define HR_DEF_R		(10000)
+#define HR_DEF_TAU_MS		(40000)
+#define HR_DEF_AMBIENT		(30000)
+#define HR_DEF_OBS_MS		(4 * HR_DEF_TAU_MS)
+#define HR_DEF_GUARD		(2000)
+
+#define HR_AMBIENT_MIN		(0)
+#define HR_AMBIENT_MAX		(60000)
+/* samples are averaged over a window before the observer looks at them */
+#define HR_WIN_MS		(1000)
+/* longer gaps are suspend or ATM idling, the window starts over */
+#define HR_GAP_MS		(5000)
+#define HR_STALE_MS		(10000)
+#define HR_LN2_Q16		(45426)
+
+#define hr_dprintk(fmt, args...) pr_debug("[Thermal/HR] " fmt, ##args)
+
+static DEFINE_SPINLOCK(hr_lock);
+static struct thermal_hr hr_gov = {
+	.rc = {
+		.r = HR_DEF_R,
+		.tau_ms = HR_DEF_TAU_MS,
+		.ambient = HR_DEF_AMBIENT,
+	},
+	.obs_ms = HR_DEF_OBS_MS,
+	.guard = HR_DEF_GUARD,
+};
+static bool hr_valid;
+
+/*------------------------RC model------------------------*/
+
+int thermal_rc_steady(const struct thermal_rc *rc, unsigned int power)
+{
+	return rc->ambient + (int)div_u64((u64)power * rc->r, 1000);
+}
+EXPORT_SYMBOL(thermal_rc_steady);
+
+unsigned int thermal_rc_sustain(const struct thermal_rc *rc, int limit)
+{
+	if (limit <= rc->ambient || !rc->r)
+		return 0;
+
+	return div_u64((u64)(limit - rc->ambient) * 1000, rc->r);
+}
+EXPORT_SYMBOL(thermal_rc_sustain);
+
+/* ln(a / b) in Q16 for a >= b > 0 */
+static u32 thermal_rc_ln_q16(u64 a, u64 b)
+{
+	u32 log2 = 0;
+	u64 x;
+	int i;
+
+	while (a >= b << 1) {
+		b <<= 1;
+		log2 += 1 << 16;
+	}
+
+	/* a / b in [1, 2) as Q30, each squaring yields one bit of log2 */
+	x = div64_u64(a << 30, b);
+	for (i = 15; i >= 0; i--) {
+		x = (x * x) >> 30;
+		if (x >= 2ULL << 30) {
+			x >>= 1;
+			log2 |= 1 << i;
+		}
+	}
+
+	return (u32)(((u64)log2 * HR_LN2_Q16) >> 16);
+}
+
+/* tau x ln((T_ss - T) / (T_ss - limit)) */
+unsigned int thermal_rc_time_to(const struct thermal_rc *rc, int temp,
+	int limit, unsigned int power)
+{
+	int steady = thermal_rc_steady(rc, power);
+	u64 t;
+
+	if (temp >= limit)
+		return 0;
+	if (steady <= limit)
+		return THERMAL_HR_FOREVER;
+
+	t = ((u64)rc->tau_ms * thermal_rc_ln_q16(steady - temp,
+						steady - limit)) >> 16;
+
+	return min_t(u64, t, THERMAL_HR_FOREVER - 1);
+}
+EXPORT_SYMBOL(thermal_rc_time_to);
+
+int thermal_rc_step(const struct thermal_rc *rc, int temp,
+	unsigned int power, unsigned int dt_ms)
+{
+	int steady = thermal_rc_steady(rc, power);
+	unsigned int h = max(rc->tau_ms / 32, 1U), d;
+	s64 delta;
+
+	if (!rc->tau_ms)
+		return steady;
+
+	while (dt_ms) {
+		d = min(dt_ms, h);
+		/* rounded, or the zone would stall short of steady */
+		delta = (s64)(steady - temp) * d;
+		delta += delta < 0 ? -(s64)(rc->tau_ms / 2) : rc->tau_ms / 2;
+		temp += div_s64(delta, rc->tau_ms);
+		dt_ms -= d;
+	}
+
+	return temp;
+}
+EXPORT_SYMBOL(thermal_rc_step);
+
+/*------------------------observer------------------------*/
+
+void thermal_hr_init(struct thermal_hr *h, unsigned int r,
+	unsigned int tau_ms, int ambient, unsigned int obs_ms)
+{
+	memset(h, 0, sizeof(*h));
+	h->rc.r = r;
+	h->rc.tau_ms = tau_ms;
+	h->rc.ambient = ambient;
+	h->obs_ms = obs_ms;
+	h->guard = HR_DEF_GUARD;
+}
+EXPORT_SYMBOL(thermal_hr_init);
+
+static void thermal_hr_observe(struct thermal_hr *h, int temp,
+	unsigned int dt_ms)
+{
+	struct thermal_rc *rc = &h->rc;
+	unsigned int power = div_u64(h->win_energy, dt_ms);
+	s64 seen;
+
+	seen = (h->win_temp + temp) / 2
+		- (s64)div_u64((u64)power * rc->r, 1000)
+		+ div_s64((s64)(temp - h->win_temp) * rc->tau_ms, dt_ms);
+
+	rc->ambient += (int)div_s64((seen - rc->ambient) * dt_ms,
+				dt_ms + h->obs_ms);
+	rc->ambient = clamp(rc->ambient, HR_AMBIENT_MIN, HR_AMBIENT_MAX);
+}
+
+void thermal_hr_update(struct thermal_hr *h, int temp, int limit,
+	unsigned int power, unsigned long long ts)
+{
+	struct mtk_thermal_headroom *hr = &h->now;
+	unsigned int dt_ms = 0;
+
+	if (h->last_ts && ts > h->last_ts)
+		dt_ms = div_u64(ts - h->last_ts, NSEC_PER_MSEC);
+
+	if (!h->last_ts || dt_ms > HR_GAP_MS) {
+		h->win_temp = temp;
+		h->win_ts = ts;
+		h->win_energy = 0;
+	} else {
+		h->win_energy += (u64)h->last_power * dt_ms;
+		dt_ms = div_u64(ts - h->win_ts, NSEC_PER_MSEC);
+		if (dt_ms >= HR_WIN_MS) {
+			thermal_hr_observe(h, temp, dt_ms);
+			h->win_temp = temp;
+			h->win_ts = ts;
+			h->win_energy = 0;
+		}
+	}
+	h->last_ts = ts;
+	h->last_power = power;
+
+	limit -= h->guard;
+	hr->temp = temp;
+	hr->limit = limit;
+	hr->ambient = h->rc.ambient;
+	hr->power = power;
+	hr->sustain = thermal_rc_sustain(&h->rc, limit);
+	/* c = tau / r in mJ per m°C */
+	hr->burst_mj = h->rc.r ?
+		div_s64((s64)(limit - temp) * h->rc.tau_ms, h->rc.r) : 0;
+	hr->burst_ms = thermal_rc_time_to(&h->rc, temp, limit, power);
+	hr->ts = ts;
+}
+EXPORT_SYMBOL(thermal_hr_update);
+
+/*------------------------ATM facing------------------------*/
+
+void mtk_thermal_headroom_update(int temp, int limit, unsigned int power)
+{
+	spin_lock(&hr_lock);
+	thermal_hr_update(&hr_gov, temp, limit, power, ktime_get_ns());
+	hr_valid = true;
+	spin_unlock(&hr_lock);
+}
+EXPORT_SYMBOL(mtk_thermal_headroom_update);
+
+/*
+ * Latest budget, -ENODATA while ATM has not run lately, as the budget
+ * would describe a temperature long gone.
+ */
+int mtk_thermal_get_headroom(struct mtk_thermal_headroom *hr)
+{
+	int ret = 0;
+
+	spin_lock(&hr_lock);
+	if (!hr_valid || ktime_get_ns() - hr_gov.now.ts >
+			(u64)HR_STALE_MS * NSEC_PER_MSEC)
+		ret = -ENODATA;
+	else
+		*hr = hr_gov.now;
+	spin_unlock(&hr_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL(mtk_thermal_get_headroom);
+
+static int clhr_read(struct seq_file *m, void *v)
+{
+	struct mtk_thermal_headroom hr;
+	struct thermal_hr cfg;
+	bool valid;
+
+	spin_lock(&hr_lock);
+	cfg = hr_gov;
+	valid = hr_valid;
+	spin_unlock(&hr_lock);
+	hr = cfg.now;
+
+	seq_printf(m, "r %u tau_ms %u obs_ms %u guard %u\n",
+		cfg.rc.r, cfg.rc.tau_ms, cfg.obs_ms, cfg.guard);
+	if (!valid)
+		return 0;
+
+	seq_printf(m, "temp %d limit %d ambient %d power %u\n",
+		hr.temp, hr.limit, hr.ambient, hr.power);
+	seq_printf(m, "sustain %u burst_mj %d burst_ms %u\n",
+		hr.sustain, hr.burst_mj, hr.burst_ms);
+
+	return 0;
+}
+
+/* echo <r> <tau_ms> <obs_ms> <guard> > clhr */
+static ssize_t clhr_write(struct file *filp, const char __user *buffer,
+	size_t count, loff_t *data)
+{
+	char desc[64];
+	unsigned int r, tau_ms, obs_ms, guard;
+	int len;
+
+	len = (count < (sizeof(desc) - 1)) ? count : (sizeof(desc) - 1);
+	if (copy_from_user(desc, buffer, len))
+		return -EFAULT;
+	desc[len] = '\0';
+
+	if (sscanf(desc, "%u %u %u %u", &r, &tau_ms, &obs_ms, &guard) != 4
+	    || !r || !tau_ms) {
+		hr_dprintk("%s bad argument\n", __func__);
+		return -EINVAL;
+	}
+
+	spin_lock(&hr_lock);
+	hr_gov.rc.r = r;
+	hr_gov.rc.tau_ms = tau_ms;
+	hr_gov.obs_ms = obs_ms;
+	hr_gov.guard = guard;
+	spin_unlock(&hr_lock);
+
+	return count;
+}
+
+static int clhr_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, clhr_read, NULL);
+}
+
+static const struct file_operations clhr_fops = {
+	.owner = THIS_MODULE,
+	.open = clhr_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.write = clhr_write,
+	.release = single_release,
+};
+
+static int __init mtk_thermal_headroom_init(void)
+{
+	struct proc_dir_entry *dir_entry;
+
+	dir_entry = mtk_thermal_get_proc_drv_therm_dir_entry();
+	if (!dir_entry) {
+		hr_dprintk("%s mkdir /proc/driver/thermal failed\n", __func__);
+		return 0;
+	}
+
+	if (!proc_create("clhr", 0664, dir_entry, &clhr_fops))
+		hr_dprintk("%s create clhr failed\n", __func__);
+
+	return 0;
+}
+
+late_initcall(mtk_thermal_headroom_init);
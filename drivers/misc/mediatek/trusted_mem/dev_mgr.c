@@ -117,6 +117,10 @@ create_trusted_mem_device(enum TRUSTED_MEM_TYPE register_type,
 	if (INVALID(t_device->reg_mgr))
 		goto err_create_reg_mgr_desc;
 
+	t_device->pool_mgr = create_pool_mgr_desc(t_device);
+	if (INVALID(t_device->pool_mgr))
+		goto err_create_pool_mgr_desc;
+
 #ifdef TCORE_PROFILING_SUPPORT
 	t_device->profile_mgr = create_profile_mgr_desc();
 	if (INVALID(t_device->profile_mgr))
@@ -128,8 +132,10 @@ create_trusted_mem_device(enum TRUSTED_MEM_TYPE register_type,
 
 #ifdef TCORE_PROFILING_SUPPORT
 err_create_profile_mgr_desc:
-	mld_kfree(t_device->reg_mgr);
+	destroy_pool_mgr_desc(t_device->pool_mgr);
 #endif
+err_create_pool_mgr_desc:
+	mld_kfree(t_device->reg_mgr);
 err_create_reg_mgr_desc:
 	mld_kfree(t_device->peer_mgr);
 err_create_peer_mgr_desc:
@@ -152,6 +158,15 @@ void destroy_trusted_mem_device(struct trusted_mem_device *tmem_device)
 #ifdef TCORE_PROFILING_SUPPORT
 		FREE_IF_VALID(tmem_device->profile_mgr);
 #endif
+		if (VALID(tmem_device->pool_mgr))
+			destroy_pool_mgr_desc(tmem_device->pool_mgr);
+		if (VALID(tmem_device->reg_mgr)) {
+			cancel_delayed_work_sync(
+				&tmem_device->reg_mgr->defer_off_work);
+			if (VALID(tmem_device->reg_mgr->defer_off_wq))
+				destroy_workqueue(
+					tmem_device->reg_mgr->defer_off_wq);
+		}
 		FREE_IF_VALID(tmem_device->reg_mgr);
 		FREE_IF_VALID(tmem_device->peer_mgr);
 		FREE_IF_VALID(tmem_device);
@@ -241,6 +256,28 @@ int register_trusted_mem_device(enum TRUSTED_MEM_TYPE register_type,
 	return TMEM_OK;
 }
 
+/* The region of the device has to be off, the caller destroys it */
+int unregister_trusted_mem_device(enum TRUSTED_MEM_TYPE register_type)
+{
+	if (!VALID_MEM_TYPE(register_type) || register_type >= TRUSTED_MEM_MAX)
+		return TMEM_INVALID_REGISTER_DEVICE;
+
+	if (!VALID_MEM_TYPE(tmem_dev[register_type].mem_type)
+	    || INVALID(tmem_dev[register_type].device))
+		return TMEM_INVALID_REGISTER_DEVICE;
+
+#ifdef TCORE_PROFILING_SUPPORT
+	/* swaps the profiled ops back */
+	install_profiler(tmem_dev[register_type].device);
+#endif
+
+	pr_info("trusted mem type '%s' %d unregistered!\n",
+		tmem_dev[register_type].device->name, register_type);
+	tmem_dev[register_type].mem_type = TRUSTED_MEM_INVALID;
+	tmem_dev[register_type].device = NULL;
+	return TMEM_OK;
+}
+
 static int __init trusted_mem_subsys_init(void)
 {
 	int idx;
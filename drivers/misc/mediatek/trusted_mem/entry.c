@@ -23,6 +23,7 @@
 #include <linux/io.h>
 #include <linux/kernel.h>
 #include <linux/kthread.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/moduleparam.h>
 #include <linux/mutex.h>
@@ -49,6 +50,8 @@ static bool is_invalid_hooks(struct trusted_mem_device *mem_device)
 		return true;
 	if (unlikely(INVALID(mem_device->reg_mgr)))
 		return true;
+	if (unlikely(INVALID(mem_device->pool_mgr)))
+		return true;
 #ifdef TCORE_PROFILING_SUPPORT
 	if (unlikely(INVALID(mem_device->profile_mgr)))
 		return true;
@@ -219,6 +222,7 @@ int tmem_core_alloc_chunk(enum TRUSTED_MEM_TYPE mem_type, u32 alignment,
 	struct trusted_mem_device *mem_device =
 		get_trusted_mem_device(mem_type);
 	struct trusted_mem_configs *mem_cfg;
+	ktime_t start = ktime_get();
 
 	if (unlikely(is_invalid_hooks(mem_device))) {
 		pr_err("%s:%d %d:mem device may not be registered!\n", __func__,
@@ -238,10 +242,19 @@ int tmem_core_alloc_chunk(enum TRUSTED_MEM_TYPE mem_type, u32 alignment,
 	if (unlikely(ret))
 		return ret;
 
-	ret = mem_device->peer_mgr->mgr_sess_mem_alloc(
-		alignment, size, refcount, sec_handle, owner, id, clean,
-		mem_device->peer_ops, &mem_device->peer_mgr->peer_mgr_data,
-		mem_device->dev_desc);
+	/* pooled chunks are already cleaned */
+	if (poolmgr_take(mem_device->pool_mgr, alignment, size, sec_handle)) {
+		*refcount = 1;
+		goto out;
+	}
+
+	do {
+		ret = mem_device->peer_mgr->mgr_sess_mem_alloc(
+			alignment, size, refcount, sec_handle, owner, id, clean,
+			mem_device->peer_ops,
+			&mem_device->peer_mgr->peer_mgr_data,
+			mem_device->dev_desc);
+	} while (ret && poolmgr_shrink(mem_device->pool_mgr));
 	if (unlikely(ret)) {
 		pr_err("[%d] alloc chunk failed:%d, sz:0x%x, align:0x%x\n",
 		       mem_type, ret, size, alignment);
@@ -249,8 +262,11 @@ int tmem_core_alloc_chunk(enum TRUSTED_MEM_TYPE mem_type, u32 alignment,
 		return ret;
 	}
 
+out:
 	pr_debug("[%d] allocated handle is 0x%x\n", mem_type, *sec_handle);
 	regmgr_region_ref_inc(mem_device->reg_mgr, mem_device->mem_type);
+	tmem_lat_hist_add(&mem_device->pool_mgr->alloc_lat,
+			  ktime_us_delta(ktime_get(), start));
 	return TMEM_OK;
 }
 
@@ -282,6 +298,7 @@ int tmem_core_unref_chunk(enum TRUSTED_MEM_TYPE mem_type, u32 sec_handle,
 		return ret;
 	}
 
+	poolmgr_relax(mem_device->pool_mgr);
 	regmgr_region_ref_dec(mem_device->reg_mgr);
 	regmgr_offline(mem_device->reg_mgr);
 	return TMEM_OK;
@@ -411,6 +428,17 @@ u32 tmem_core_get_max_pool_size(enum TRUSTED_MEM_TYPE mem_type)
 	return mem_size;
 }
 
+void tmem_core_pool_dump(enum TRUSTED_MEM_TYPE mem_type, struct seq_file *m)
+{
+	struct trusted_mem_device *mem_device =
+		get_trusted_mem_device(mem_type);
+
+	if (unlikely(is_invalid_hooks(mem_device)))
+		return;
+
+	poolmgr_dump(mem_device, m);
+}
+
 bool tmem_core_get_region_info(enum TRUSTED_MEM_TYPE mem_type, u64 *pa,
 			       u32 *size)
 {
@@ -0,0 +1,411 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#define PR_FMT_HEADER_MUST_BE_INCLUDED_BEFORE_ALL_HDRS
+#include "private/tmem_pr_fmt.h" PR_FMT_HEADER_MUST_BE_INCLUDED_BEFORE_ALL_HDRS
+
+#include <linux/errno.h>
+#include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+
+#include "private/mld_helper.h"
+#include "private/tmem_error.h"
+#include "private/tmem_utils.h"
+#include "private/tmem_priv.h"
+#include "private/tmem_device.h"
+
+/*
+ * Chunk pool
+ *
+ * Chunks of the power of two size classes starting at the device's minimal
+ * chunk size are allocated from the peer ahead of time, zeroed by the peer
+ * (clean), so an allocation of a class size is served without a round trip
+ * to the secure world and without paying for the clean. A class is refilled
+ * up to the number of recent requests for it, at most TMEM_POOL_CLASS_DEPTH
+ * chunks, and the pool never holds more than 1/TMEM_POOL_REGION_SHARE of
+ * the region.
+ *
+ * Cached chunks are taken under a spinlock only, so allocations served from
+ * the pool do not queue behind the peer session. The refill runs on an
+ * unbound worker one chunk at a time. When the region runs out the pool
+ * gives its chunks back and stops refilling until a chunk is freed; when
+ * the region is turned off the pool is emptied first.
+ */
+
+#define TMEM_POOL_REGION_SHARE (8)
+#define TMEM_POOL_MAX_CACHED (TMEM_POOL_CLASS_MAX * TMEM_POOL_CLASS_DEPTH)
+
+void tmem_lat_hist_init(struct tmem_lat_hist *hist)
+{
+	memset(hist, 0x0, sizeof(struct tmem_lat_hist));
+	spin_lock_init(&hist->lock);
+}
+
+void tmem_lat_hist_add(struct tmem_lat_hist *hist, u64 lat_us)
+{
+	unsigned long flags;
+	int idx = lat_us ? ilog2(lat_us) : 0;
+
+	if (idx >= TMEM_LAT_HIST_BUCKETS)
+		idx = TMEM_LAT_HIST_BUCKETS - 1;
+
+	spin_lock_irqsave(&hist->lock, flags);
+	hist->bucket[idx]++;
+	hist->count++;
+	hist->total_us += lat_us;
+	if (lat_us > hist->max_us)
+		hist->max_us = lat_us;
+	spin_unlock_irqrestore(&hist->lock, flags);
+}
+
+void tmem_lat_hist_dump(struct tmem_lat_hist *hist, const char *name,
+			struct seq_file *m)
+{
+	struct tmem_lat_hist snap;
+	unsigned long flags;
+	int idx;
+
+	spin_lock_irqsave(&hist->lock, flags);
+	memcpy(&snap, hist, sizeof(snap));
+	spin_unlock_irqrestore(&hist->lock, flags);
+
+	seq_printf(m, "  %s: count:%llu avg:%lluus max:%lluus\n", name,
+		   snap.count,
+		   snap.count ? div64_u64(snap.total_us, snap.count) : 0,
+		   snap.max_us);
+	for (idx = 0; idx < TMEM_LAT_HIST_BUCKETS; idx++) {
+		if (IS_ZERO(snap.bucket[idx]))
+			continue;
+		seq_printf(m, "    >=%8luus: %llu\n", 1UL << idx,
+			   snap.bucket[idx]);
+	}
+}
+
+static int poolmgr_class_of(struct pool_mgr_desc *pool, u32 size)
+{
+	int idx;
+
+	for (idx = 0; idx < pool->nr_class; idx++)
+		if (pool->cls[idx].size == size)
+			return idx;
+
+	return -1;
+}
+
+static u32 poolmgr_region_size(struct pool_mgr_desc *pool)
+{
+	struct trusted_mem_device *mem_device =
+		(struct trusted_mem_device *)pool->mem_device;
+
+	return mem_device->peer_mgr->peer_mgr_data.mem_size_runtime;
+}
+
+/* pool->lock held */
+static int poolmgr_next_refill_class(struct pool_mgr_desc *pool)
+{
+	struct pool_mgr_class *cls;
+	u32 target, budget;
+	int idx;
+
+	if (!pool->active || pool->pressure)
+		return -1;
+
+	budget = poolmgr_region_size(pool) / TMEM_POOL_REGION_SHARE;
+	for (idx = 0; idx < pool->nr_class; idx++) {
+		cls = &pool->cls[idx];
+		target = min_t(u32, cls->demand, TMEM_POOL_CLASS_DEPTH);
+		if (cls->nr_cached < target
+		    && pool->cached_size + cls->size <= budget)
+			return idx;
+	}
+
+	return -1;
+}
+
+static int poolmgr_peer_alloc(struct pool_mgr_desc *pool, u32 size,
+			      u32 *sec_handle)
+{
+	struct trusted_mem_device *mem_device =
+		(struct trusted_mem_device *)pool->mem_device;
+	u32 ref_count;
+
+	return mem_device->peer_mgr->mgr_sess_mem_alloc(
+		size, size, &ref_count, sec_handle, NULL, 0, 1,
+		mem_device->peer_ops, &mem_device->peer_mgr->peer_mgr_data,
+		mem_device->dev_desc);
+}
+
+static void poolmgr_peer_free(struct pool_mgr_desc *pool, u32 sec_handle)
+{
+	struct trusted_mem_device *mem_device =
+		(struct trusted_mem_device *)pool->mem_device;
+	int ret;
+
+	ret = mem_device->peer_mgr->mgr_sess_mem_free(
+		sec_handle, NULL, 0, mem_device->peer_ops,
+		&mem_device->peer_mgr->peer_mgr_data, mem_device->dev_desc);
+	if (ret)
+		pr_err("%s:%d free pooled chunk 0x%x failed:%d\n", __func__,
+		       __LINE__, sec_handle, ret);
+}
+
+static void poolmgr_refill_handler(struct work_struct *work)
+{
+	struct pool_mgr_desc *pool =
+		container_of(work, struct pool_mgr_desc, refill_work);
+	struct pool_mgr_class *cls;
+	bool put_back;
+	u32 handle;
+	int idx, ret;
+
+	mutex_lock(&pool->refill_lock);
+
+	for (;;) {
+		spin_lock(&pool->lock);
+		idx = poolmgr_next_refill_class(pool);
+		spin_unlock(&pool->lock);
+		if (idx < 0)
+			break;
+
+		cls = &pool->cls[idx];
+		ret = poolmgr_peer_alloc(pool, cls->size, &handle);
+		if (ret) {
+			spin_lock(&pool->lock);
+			pool->pressure = true;
+			spin_unlock(&pool->lock);
+			break;
+		}
+
+		/* the region may have been shrunk or turned off meanwhile */
+		spin_lock(&pool->lock);
+		put_back = !pool->active || pool->pressure
+			   || cls->nr_cached >= TMEM_POOL_CLASS_DEPTH;
+		if (!put_back) {
+			cls->handle[cls->nr_cached++] = handle;
+			pool->cached_size += cls->size;
+			pool->refill_count++;
+		}
+		spin_unlock(&pool->lock);
+
+		if (put_back) {
+			poolmgr_peer_free(pool, handle);
+			break;
+		}
+
+		cond_resched();
+	}
+
+	/* demand decays, classes not asked for any more are not refilled */
+	spin_lock(&pool->lock);
+	for (idx = 0; idx < pool->nr_class; idx++)
+		pool->cls[idx].demand /= 2;
+	spin_unlock(&pool->lock);
+
+	mutex_unlock(&pool->refill_lock);
+}
+
+/*
+ * Serves an allocation from the pool if a chunk of its size class is
+ * cached. The peer reference of the chunk is already held.
+ */
+bool poolmgr_take(struct pool_mgr_desc *pool, u32 alignment, u32 size,
+		  u32 *sec_handle)
+{
+	struct pool_mgr_class *cls;
+	bool hit = false, refill;
+	int idx;
+
+	if (INVALID(pool) || !pool->enabled || alignment > size)
+		return false;
+
+	idx = poolmgr_class_of(pool, size);
+	if (idx < 0)
+		return false;
+
+	cls = &pool->cls[idx];
+	spin_lock(&pool->lock);
+	if (cls->demand < TMEM_POOL_CLASS_DEPTH)
+		cls->demand++;
+	if (pool->active && cls->nr_cached) {
+		*sec_handle = cls->handle[--cls->nr_cached];
+		pool->cached_size -= cls->size;
+		pool->hit_count++;
+		hit = true;
+	} else {
+		pool->miss_count++;
+	}
+	refill = pool->active && !pool->pressure
+		 && cls->nr_cached < min_t(u32, cls->demand,
+					   TMEM_POOL_CLASS_DEPTH);
+	spin_unlock(&pool->lock);
+
+	if (refill)
+		queue_work(system_unbound_wq, &pool->refill_work);
+	return hit;
+}
+
+/*
+ * Gives all cached chunks back to the peer. Returns false if that cannot
+ * have made room: nothing was cached and the pool was already under
+ * pressure, so no refill was in flight either.
+ */
+static bool poolmgr_flush(struct pool_mgr_desc *pool, bool deactivate)
+{
+	u32 handle[TMEM_POOL_MAX_CACHED];
+	bool was_pressure;
+	int idx, nr = 0;
+
+	spin_lock(&pool->lock);
+	was_pressure = pool->pressure;
+	if (deactivate)
+		pool->active = false;
+	else
+		pool->pressure = true;
+	spin_unlock(&pool->lock);
+
+	/* a refill in flight sees the flags above before it caches */
+	mutex_lock(&pool->refill_lock);
+
+	spin_lock(&pool->lock);
+	for (idx = 0; idx < pool->nr_class; idx++) {
+		while (pool->cls[idx].nr_cached)
+			handle[nr++] = pool->cls[idx].handle
+					       [--pool->cls[idx].nr_cached];
+	}
+	pool->cached_size = 0;
+	if (nr && !deactivate)
+		pool->shrink_count++;
+	spin_unlock(&pool->lock);
+
+	for (idx = 0; idx < nr; idx++)
+		poolmgr_peer_free(pool, handle[idx]);
+
+	mutex_unlock(&pool->refill_lock);
+	return nr > 0 || (!deactivate && !was_pressure);
+}
+
+/* The region ran out: make room and hold refills off until a free */
+bool poolmgr_shrink(struct pool_mgr_desc *pool)
+{
+	if (INVALID(pool) || !pool->enabled)
+		return false;
+
+	return poolmgr_flush(pool, false);
+}
+
+void poolmgr_relax(struct pool_mgr_desc *pool)
+{
+	if (INVALID(pool) || !pool->enabled)
+		return;
+
+	spin_lock(&pool->lock);
+	pool->pressure = false;
+	spin_unlock(&pool->lock);
+}
+
+/* Called by the region manager once the region is on */
+void poolmgr_activate(struct pool_mgr_desc *pool)
+{
+	if (INVALID(pool) || !pool->enabled)
+		return;
+
+	spin_lock(&pool->lock);
+	pool->active = true;
+	pool->pressure = false;
+	spin_unlock(&pool->lock);
+}
+
+/* Called by the region manager before the region is turned off */
+void poolmgr_deactivate(struct pool_mgr_desc *pool)
+{
+	if (INVALID(pool) || !pool->enabled)
+		return;
+
+	poolmgr_flush(pool, true);
+}
+
+void poolmgr_dump(struct trusted_mem_device *mem_device, struct seq_file *m)
+{
+	struct pool_mgr_desc *pool = mem_device->pool_mgr;
+	struct region_mgr_desc *reg_mgr = mem_device->reg_mgr;
+	struct pool_mgr_class *cls;
+	int idx;
+
+	seq_printf(m, "%s (mem%d) region:%s ref:%u defer_off:%ums rapid_on:%llu\n",
+		   mem_device->name, mem_device->mem_type,
+		   is_regmgr_region_on(reg_mgr) ? "on" : "off",
+		   get_regmgr_region_ref_cnt(reg_mgr),
+		   get_regmgr_region_defer_off_delay(reg_mgr),
+		   reg_mgr->rapid_online_count);
+
+	if (VALID(pool) && pool->enabled) {
+		spin_lock(&pool->lock);
+		seq_printf(m, "  pool: hit:%llu miss:%llu refill:%llu shrink:%llu cached:0x%x\n",
+			   pool->hit_count, pool->miss_count,
+			   pool->refill_count, pool->shrink_count,
+			   pool->cached_size);
+		for (idx = 0; idx < pool->nr_class; idx++) {
+			cls = &pool->cls[idx];
+			seq_printf(m, "    class 0x%x: cached:%u demand:%u\n",
+				   cls->size, cls->nr_cached, cls->demand);
+		}
+		spin_unlock(&pool->lock);
+	}
+
+	if (VALID(pool))
+		tmem_lat_hist_dump(&pool->alloc_lat, "alloc", m);
+	tmem_lat_hist_dump(&reg_mgr->off_lat, "teardown", m);
+}
+
+struct pool_mgr_desc *
+create_pool_mgr_desc(struct trusted_mem_device *mem_device)
+{
+	struct pool_mgr_desc *t_pool;
+	u32 min_chunk_size = mem_device->configs.minimal_chunk_size;
+	int idx;
+
+	t_pool = mld_kmalloc(sizeof(struct pool_mgr_desc), GFP_KERNEL);
+	if (INVALID(t_pool)) {
+		pr_err("%s:%d out of memory!\n", __func__, __LINE__);
+		return NULL;
+	}
+
+	memset(t_pool, 0x0, sizeof(struct pool_mgr_desc));
+	spin_lock_init(&t_pool->lock);
+	mutex_init(&t_pool->refill_lock);
+	INIT_WORK(&t_pool->refill_work, poolmgr_refill_handler);
+	tmem_lat_hist_init(&t_pool->alloc_lat);
+
+	t_pool->mem_device = mem_device;
+	t_pool->enabled = mem_device->configs.chunk_pool_enable
+			  && !IS_ZERO(min_chunk_size);
+	if (t_pool->enabled) {
+		t_pool->nr_class = TMEM_POOL_CLASS_MAX;
+		for (idx = 0; idx < TMEM_POOL_CLASS_MAX; idx++)
+			t_pool->cls[idx].size = min_chunk_size << idx;
+	}
+
+	return t_pool;
+}
+
+void destroy_pool_mgr_desc(struct pool_mgr_desc *pool)
+{
+	cancel_work_sync(&pool->refill_work);
+	mld_kfree(pool);
+}
@@ -14,7 +14,9 @@
 #ifndef TMEM_DEVICE_H
 #define TMEM_DEVICE_H
 
+#include <linux/ktime.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
 #include <linux/workqueue.h>
 
 #define SSMR_FEAT_INVALID_ID (0xFFFFFFFF)
@@ -137,6 +139,17 @@ struct peer_mgr_desc {
 struct region_mgr_work_data {
 };
 
+/* bucket i counts latencies in [2^i, 2^(i+1)) us, the last is open ended */
+#define TMEM_LAT_HIST_BUCKETS (20)
+
+struct tmem_lat_hist {
+	u64 bucket[TMEM_LAT_HIST_BUCKETS];
+	u64 count;
+	u64 total_us;
+	u64 max_us;
+	spinlock_t lock;
+};
+
 struct region_mgr_desc {
 	struct workqueue_struct *defer_off_wq;
 	struct delayed_work defer_off_work;
@@ -148,6 +161,41 @@ struct region_mgr_desc {
 	enum REGMGR_REGION_STATE state;
 	void *mem_device;
 	enum TRUSTED_MEM_TYPE active_mem_type;
+
+	/* defer off hysteresis */
+	ktime_t off_time;
+	u64 rapid_online_count;
+	struct tmem_lat_hist off_lat;
+};
+
+#define TMEM_POOL_CLASS_MAX (6)
+#define TMEM_POOL_CLASS_DEPTH (4)
+
+struct pool_mgr_class {
+	u32 size;
+	u32 nr_cached;
+	u32 demand;
+	u32 handle[TMEM_POOL_CLASS_DEPTH];
+};
+
+struct pool_mgr_desc {
+	spinlock_t lock;
+	struct mutex refill_lock;
+	struct work_struct refill_work;
+
+	bool enabled;
+	bool active;   /* region is on, chunks may be cached */
+	bool pressure; /* region ran out, no refill until a chunk is freed */
+	u32 nr_class;
+	u32 cached_size;
+	struct pool_mgr_class cls[TMEM_POOL_CLASS_MAX];
+	void *mem_device;
+
+	u64 hit_count;
+	u64 miss_count;
+	u64 refill_count;
+	u64 shrink_count;
+	struct tmem_lat_hist alloc_lat;
 };
 
 #define MAX_DEVICE_NAME_LEN (32)
@@ -160,6 +208,7 @@ struct trusted_mem_configs {
 	bool session_keep_alive_enable;
 	bool min_size_check_enable;
 	bool alignment_check_enable;
+	bool chunk_pool_enable;
 };
 
 #ifdef TCORE_PROFILING_SUPPORT
@@ -178,6 +227,7 @@ struct trusted_mem_device {
 
 	struct peer_mgr_desc *peer_mgr;
 	struct region_mgr_desc *reg_mgr;
+	struct pool_mgr_desc *pool_mgr;
 
 	char name[MAX_DEVICE_NAME_LEN];
 	enum TRUSTED_MEM_TYPE mem_type;
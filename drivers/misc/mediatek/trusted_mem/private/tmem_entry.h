@@ -14,6 +14,8 @@
 #ifndef TMEM_ENTRY_H
 #define TMEM_ENTRY_H
 
+#include <linux/seq_file.h>
+
 #include "private/tmem_device.h"
 
 int tmem_core_session_open(enum TRUSTED_MEM_TYPE mem_type);
@@ -37,5 +39,6 @@ u32 tmem_core_get_min_chunk_size(enum TRUSTED_MEM_TYPE mem_type);
 u32 tmem_core_get_max_pool_size(enum TRUSTED_MEM_TYPE mem_type);
 bool tmem_core_get_region_info(enum TRUSTED_MEM_TYPE mem_type, u64 *pa,
 			       u32 *size);
+void tmem_core_pool_dump(enum TRUSTED_MEM_TYPE mem_type, struct seq_file *m);
 
 #endif /* end of TMEM_ENTRY_H */
@@ -14,6 +14,8 @@
 #ifndef TMEM_PRIV_H
 #define TMEM_PRIV_H
 
+#include <linux/seq_file.h>
+
 #include "private/tmem_device.h"
 
 struct trusted_mem_device *
@@ -22,6 +24,7 @@ create_trusted_mem_device(enum TRUSTED_MEM_TYPE register_type,
 void destroy_trusted_mem_device(struct trusted_mem_device *tmem_device);
 int register_trusted_mem_device(enum TRUSTED_MEM_TYPE register_type,
 				struct trusted_mem_device *tmem_device);
+int unregister_trusted_mem_device(enum TRUSTED_MEM_TYPE register_type);
 void trusted_mem_ut_cmd_invoke(u64 cmd, u64 param1, u64 param2, u64 param3);
 struct trusted_mem_device *
 get_trusted_mem_device(enum TRUSTED_MEM_TYPE mem_type);
@@ -42,6 +45,23 @@ int regmgr_online(struct region_mgr_desc *mgr_desc,
 		  enum TRUSTED_MEM_TYPE try_mem_type);
 int regmgr_offline(struct region_mgr_desc *mgr_desc);
 bool get_device_busy_status(struct trusted_mem_device *mem_device);
+u32 get_regmgr_region_defer_off_delay(struct region_mgr_desc *mgr_desc);
+
+struct pool_mgr_desc *
+create_pool_mgr_desc(struct trusted_mem_device *mem_device);
+void destroy_pool_mgr_desc(struct pool_mgr_desc *pool);
+bool poolmgr_take(struct pool_mgr_desc *pool, u32 alignment, u32 size,
+		  u32 *sec_handle);
+bool poolmgr_shrink(struct pool_mgr_desc *pool);
+void poolmgr_relax(struct pool_mgr_desc *pool);
+void poolmgr_activate(struct pool_mgr_desc *pool);
+void poolmgr_deactivate(struct pool_mgr_desc *pool);
+void poolmgr_dump(struct trusted_mem_device *mem_device, struct seq_file *m);
+
+void tmem_lat_hist_init(struct tmem_lat_hist *hist);
+void tmem_lat_hist_add(struct tmem_lat_hist *hist, u64 lat_us);
+void tmem_lat_hist_dump(struct tmem_lat_hist *hist, const char *name,
+			struct seq_file *m);
 
 #ifdef TCORE_PROFILING_SUPPORT
 struct profile_mgr_desc *create_profile_mgr_desc(void);
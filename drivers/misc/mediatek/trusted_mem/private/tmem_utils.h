@@ -19,6 +19,9 @@
 #define REGMGR_REGION_DEFER_OFF_DONE_DELAY_MS                                  \
 	(REGMGR_REGION_DEFER_OFF_DELAY_MS                                      \
 	 + REGMGR_REGION_DEFER_OFF_OPERATION_LATENCY_MS)
+/* region back on this soon after going off doubles the defer off delay */
+#define REGMGR_REGION_REONLINE_HYSTERESIS_MS (200)
+#define REGMGR_REGION_DEFER_OFF_MAX_DELAY_MS (8000)
 
 #define UNUSED(x) ((void)x)
 #define VALID(ptr) (ptr != NULL)
@@ -166,6 +166,9 @@ enum TMEM_DEVICE_UT_COMMAND {
 	TMEM_UT_CORE_DEVICE_VIRT_REGION_ALLOC = 803,
 	TMEM_UT_CORE_MULTIPLE_REGION_MULTIPLE_THREAD_ALLOC = 804,
 	TMEM_UT_CORE_MTEE_MCHUNKS_MULTIPLE_THREAD_ALLOC = 805,
+	TMEM_UT_CORE_POOL_CONCURRENT_ALLOC = 806,
+	TMEM_UT_CORE_POOL_REGION_HYSTERESIS = 807,
+	TMEM_UT_CORE_POOL_SATURATION = 808,
 
 #ifdef TCORE_MEMORY_LEAK_DETECTION_SUPPORT
 	TMEM_MEMORY_LEAK_DETECTION_CHECK = 900,
@@ -18,6 +18,7 @@
 #include <linux/fs.h>
 #include <linux/kernel.h>
 #include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 #include <linux/string.h>
 #include <linux/uaccess.h>
 #include <linux/unistd.h>
@@ -341,9 +342,35 @@ static const struct file_operations tmem_fops = {
 	.write = tmem_write,
 };
 
+static int tmem_pool_show(struct seq_file *m, void *v)
+{
+	int mem_idx;
+
+	for (mem_idx = 0; mem_idx < TRUSTED_MEM_MAX; mem_idx++) {
+		if (tmem_core_is_device_registered(mem_idx))
+			tmem_core_pool_dump(mem_idx, m);
+	}
+
+	return 0;
+}
+
+static int tmem_pool_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tmem_pool_show, NULL);
+}
+
+static const struct file_operations tmem_pool_fops = {
+	.owner = THIS_MODULE,
+	.open = tmem_pool_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static void trusted_mem_create_proc_entry(void)
 {
 	proc_create("tmem0", 0664, NULL, &tmem_fops);
+	proc_create("tmem_pool", 0444, NULL, &tmem_pool_fops);
 }
 
 #ifdef TCORE_UT_TESTS_SUPPORT
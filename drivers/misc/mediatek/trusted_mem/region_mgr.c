@@ -16,6 +16,7 @@
 
 #include <linux/delay.h>
 #include <linux/errno.h>
+#include <linux/ktime.h>
 #include <linux/moduleparam.h>
 #include <linux/mutex.h>
 #include <linux/semaphore.h>
@@ -139,6 +140,29 @@ static void set_region_state(struct region_mgr_desc *mgr_desc,
 #endif
 }
 
+/*
+ * A region turned back on soon after its defer off is being opened and
+ * closed in a loop, so it is kept on longer next time. A region that stayed
+ * off for a while goes back to the normal delay.
+ */
+static void regmgr_update_defer_off_delay(struct region_mgr_desc *mgr_desc)
+{
+	s64 off_ms;
+
+	if (IS_ZERO(ktime_to_ns(mgr_desc->off_time)))
+		return;
+
+	off_ms = ktime_ms_delta(ktime_get(), mgr_desc->off_time);
+	if (off_ms < REGMGR_REGION_REONLINE_HYSTERESIS_MS) {
+		mgr_desc->defer_off_delay_ms =
+			min_t(u32, mgr_desc->defer_off_delay_ms * 2,
+			      REGMGR_REGION_DEFER_OFF_MAX_DELAY_MS);
+		mgr_desc->rapid_online_count++;
+	} else {
+		mgr_desc->defer_off_delay_ms = REGMGR_REGION_DEFER_OFF_DELAY_MS;
+	}
+}
+
 static int regmgr_try_on(struct region_mgr_desc *mgr_desc,
 			 enum TRUSTED_MEM_TYPE try_mem_type)
 {
@@ -163,6 +187,8 @@ static int regmgr_try_on(struct region_mgr_desc *mgr_desc,
 	mgr_desc->mem_device = mem_device;
 	mem_device->is_device_busy = true;
 	set_region_state(mgr_desc, REGMGR_REGION_STATE_ON);
+	regmgr_update_defer_off_delay(mgr_desc);
+	poolmgr_activate(mem_device->pool_mgr);
 	return TMEM_OK;
 }
 
@@ -178,8 +204,12 @@ static int regmgr_try_off(struct region_mgr_desc *mgr_desc)
 		return TMEM_OK;
 	}
 
+	/* cached chunks go back to the peer before the memory is removed */
+	poolmgr_deactivate(mem_device->pool_mgr);
+
 	if (trusted_mem_region_poweroff(mem_device)) {
 		pr_err("trusted mem poweroff failed!\n");
+		poolmgr_activate(mem_device->pool_mgr);
 		return TMEM_REGION_POWER_OFF_FAILED;
 	}
 
@@ -187,6 +217,7 @@ static int regmgr_try_off(struct region_mgr_desc *mgr_desc)
 
 	mem_device->is_device_busy = false;
 	mgr_desc->active_mem_type = TRUSTED_MEM_INVALID;
+	mgr_desc->off_time = ktime_get();
 	set_region_state(mgr_desc, REGMGR_REGION_STATE_OFF);
 	return TMEM_OK;
 }
@@ -207,9 +238,16 @@ static void regmgr_defer_off_handler(struct work_struct *work)
 	struct region_mgr_desc *mgr_desc =
 		container_of(work, struct region_mgr_desc, defer_off_work.work);
 
+	ktime_t start;
+
 	REGMGR_LOCK();
-	if (IS_ZERO(mgr_desc->valid_ref_count))
+	if (IS_ZERO(mgr_desc->valid_ref_count)
+	    && is_region_on(mgr_desc->state)) {
+		start = ktime_get();
 		regmgr_try_off(mgr_desc);
+		tmem_lat_hist_add(&mgr_desc->off_lat,
+				  ktime_us_delta(ktime_get(), start));
+	}
 	REGMGR_UNLOCK();
 }
 
@@ -244,6 +282,11 @@ u32 get_regmgr_region_ref_cnt(struct region_mgr_desc *mgr_desc)
 	return mgr_desc->valid_ref_count;
 }
 
+u32 get_regmgr_region_defer_off_delay(struct region_mgr_desc *mgr_desc)
+{
+	return mgr_desc->defer_off_delay_ms;
+}
+
 void regmgr_region_ref_inc(struct region_mgr_desc *mgr_desc,
 			   enum TRUSTED_MEM_TYPE try_mem_type)
 {
@@ -316,6 +359,9 @@ create_reg_mgr_desc(enum TRUSTED_MEM_TYPE register_type,
 	t_mgr_desc->valid_ref_count = 0;
 	t_mgr_desc->mem_device = NULL;
 	t_mgr_desc->active_mem_type = TRUSTED_MEM_INVALID;
+	t_mgr_desc->off_time = ktime_set(0, 0);
+	t_mgr_desc->rapid_online_count = 0;
+	tmem_lat_hist_init(&t_mgr_desc->off_lat);
 
 	snprintf(wq_name, 32, "tmem_regmgr_defer_off_%d", register_type);
 	t_mgr_desc->defer_off_wq = create_singlethread_workqueue(wq_name);
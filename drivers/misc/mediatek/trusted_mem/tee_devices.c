@@ -48,6 +48,7 @@ static struct trusted_mem_configs tee_smem_general_configs = {
 	.phys_limit_min_alloc_size = (1 << 6),
 	.min_size_check_enable = false,
 	.alignment_check_enable = true,
+	.chunk_pool_enable = true,
 	.caps = 0,
 };
 
@@ -414,7 +414,7 @@ static enum UT_RET_STATE config_tee_prot_region_test(struct ut_params *params,
 	ASSERT_EQ(0, ret, "clean pa region check");
 	ASSERT_FALSE(tmem_core_is_regmgr_region_on(TRUSTED_MEM_2D_FR),
 		     "FR region state off check");
-	mdelay(REGMGR_REGION_DEFER_OFF_DONE_DELAY_MS);
+	msleep(regmgr_region_defer_off_done_delay(TRUSTED_MEM_2D_FR));
 	ASSERT_FALSE(tmem_core_is_regmgr_region_on(TRUSTED_MEM_2D_FR),
 		     "FR region state off check");
 
@@ -481,7 +481,7 @@ static enum UT_RET_STATE device_share_region_basic(struct ut_params *params,
 		  "svp regmgr region offline check");
 	ASSERT_TRUE(tmem_core_is_regmgr_region_on(TRUSTED_MEM_SVP),
 		    "svp region state on check");
-	mdelay(REGMGR_REGION_DEFER_OFF_DONE_DELAY_MS);
+	msleep(regmgr_region_defer_off_done_delay(TRUSTED_MEM_SVP));
 	ASSERT_FALSE(tmem_core_is_regmgr_region_on(TRUSTED_MEM_SVP),
 		     "svp region state off check");
 
@@ -499,7 +499,7 @@ static enum UT_RET_STATE device_share_region_basic(struct ut_params *params,
 		  "FR regmgr region offline check");
 	ASSERT_TRUE(tmem_core_is_regmgr_region_on(TRUSTED_MEM_2D_FR),
 		    "FR region state on check");
-	mdelay(REGMGR_REGION_DEFER_OFF_DONE_DELAY_MS);
+	msleep(regmgr_region_defer_off_done_delay(TRUSTED_MEM_2D_FR));
 	ASSERT_FALSE(tmem_core_is_regmgr_region_on(TRUSTED_MEM_2D_FR),
 		     "FR region state off check");
 
@@ -525,7 +525,7 @@ static enum UT_RET_STATE device_share_region_switch(struct ut_params *params,
 		  "svp regmgr region offline check");
 	ASSERT_TRUE(tmem_core_is_regmgr_region_on(TRUSTED_MEM_SVP),
 		    "svp region state on check");
-	mdelay(REGMGR_REGION_DEFER_OFF_DONE_DELAY_MS);
+	msleep(regmgr_region_defer_off_done_delay(TRUSTED_MEM_SVP));
 	ASSERT_FALSE(tmem_core_is_regmgr_region_on(TRUSTED_MEM_SVP),
 		     "svp region state off check");
 
@@ -541,7 +541,7 @@ static enum UT_RET_STATE device_share_region_switch(struct ut_params *params,
 		  "FR regmgr region offline check");
 	ASSERT_TRUE(tmem_core_is_regmgr_region_on(TRUSTED_MEM_2D_FR),
 		    "FR region state on check");
-	mdelay(REGMGR_REGION_DEFER_OFF_DONE_DELAY_MS);
+	msleep(regmgr_region_defer_off_done_delay(TRUSTED_MEM_2D_FR));
 	ASSERT_FALSE(tmem_core_is_regmgr_region_on(TRUSTED_MEM_2D_FR),
 		     "FR region state off check");
 
@@ -583,7 +583,7 @@ static enum UT_RET_STATE device_share_region_alloc(struct ut_params *params,
 	ASSERT_EQ(TMEM_REGION_POWER_ON_FAILED, ret,
 		  "fr alloc chunk memory check");
 
-	mdelay(REGMGR_REGION_DEFER_OFF_DONE_DELAY_MS);
+	msleep(regmgr_region_defer_off_done_delay(TRUSTED_MEM_SVP));
 	ASSERT_FALSE(tmem_core_is_regmgr_region_on(TRUSTED_MEM_SVP),
 		     "svp region state off check");
 
@@ -605,7 +605,7 @@ static enum UT_RET_STATE device_share_region_alloc(struct ut_params *params,
 	ASSERT_EQ(TMEM_REGION_POWER_ON_FAILED, ret,
 		  "svp alloc chunk memory fail check");
 
-	mdelay(REGMGR_REGION_DEFER_OFF_DONE_DELAY_MS);
+	msleep(regmgr_region_defer_off_done_delay(TRUSTED_MEM_2D_FR));
 	ASSERT_FALSE(tmem_core_is_regmgr_region_on(TRUSTED_MEM_2D_FR),
 		     "FR region state off check");
 	ASSERT_FALSE(tmem_core_is_regmgr_region_on(TRUSTED_MEM_SVP),
@@ -629,7 +629,7 @@ static enum UT_RET_STATE device_share_region_alloc(struct ut_params *params,
 	ret = tmem_core_unref_chunk(TRUSTED_MEM_PROT, pmem_handle, NULL, 0);
 	ASSERT_EQ(0, ret, "pmem free chunk memory check");
 
-	mdelay(REGMGR_REGION_DEFER_OFF_DONE_DELAY_MS);
+	msleep(regmgr_region_defer_off_done_delay(TRUSTED_MEM_SVP));
 	ASSERT_FALSE(tmem_core_is_regmgr_region_on(TRUSTED_MEM_SVP),
 		     "svp region state off check");
 	ASSERT_FALSE(tmem_core_is_regmgr_region_on(TRUSTED_MEM_PROT),
@@ -668,6 +668,39 @@ mtee_mchunks_multiple_thread_alloc(struct ut_params *params, char *test_desc)
 }
 #endif
 
+static enum UT_RET_STATE pool_concurrent_alloc(struct ut_params *params,
+					       char *test_desc)
+{
+	pr_info("%s:%d\n", __func__, __LINE__);
+	if (ut_is_halt())
+		return UT_STATE_FAIL;
+
+	ASSERT_EQ(0, mem_pool_concurrent_alloc_test(), test_desc);
+	return UT_STATE_PASS;
+}
+
+static enum UT_RET_STATE pool_region_hysteresis(struct ut_params *params,
+						char *test_desc)
+{
+	pr_info("%s:%d\n", __func__, __LINE__);
+	if (ut_is_halt())
+		return UT_STATE_FAIL;
+
+	ASSERT_EQ(0, mem_pool_region_hysteresis_test(), test_desc);
+	return UT_STATE_PASS;
+}
+
+static enum UT_RET_STATE pool_saturation(struct ut_params *params,
+					 char *test_desc)
+{
+	pr_info("%s:%d\n", __func__, __LINE__);
+	if (ut_is_halt())
+		return UT_STATE_FAIL;
+
+	ASSERT_EQ(0, mem_pool_saturation_test(), test_desc);
+	return UT_STATE_PASS;
+}
+
 static struct test_case test_cases[] = {
 #ifdef CONFIG_MTK_SECURE_MEM_SUPPORT
 	CASE(SECMEM_UT_PROC_BASIC, "SVP Basic", TRUSTED_MEM_SVP,
@@ -936,6 +969,14 @@ static struct test_case test_cases[] = {
 	     mtee_mchunks_multiple_thread_alloc),
 #endif
 
+	CASE(TMEM_UT_CORE_POOL_CONCURRENT_ALLOC, "Pool Concurrent Alloc Test",
+	     0, 0, 0, pool_concurrent_alloc),
+	CASE(TMEM_UT_CORE_POOL_REGION_HYSTERESIS,
+	     "Pool Region Defer Off Hysteresis Test", 0, 0, 0,
+	     pool_region_hysteresis),
+	CASE(TMEM_UT_CORE_POOL_SATURATION, "Pool Saturation Test", 0, 0, 0,
+	     pool_saturation),
+
 #if defined(CONFIG_MTK_SECURE_MEM_SUPPORT)                                     \
 	&& defined(CONFIG_MTK_CAM_SECURITY_SUPPORT)
 	CASE(FR_UT_PROC_CONFIG_PROT_REGION, "Set TEE Protect Region Test", 0, 0,
@@ -29,6 +29,7 @@
 #include <linux/delay.h>
 #include <linux/kthread.h>
 #include <linux/completion.h>
+#include <linux/random.h>
 
 #include "private/mld_helper.h"
 #include "private/tmem_error.h"
@@ -36,8 +37,26 @@
 #include "private/tmem_proc.h"
 #include "private/tmem_cfg.h"
 #include "private/tmem_entry.h"
+#include "private/tmem_priv.h"
 #include "private/ut_cmd.h"
 #include "tests/ut_common.h"
+#include "tests/ut_mock_peer.h"
+
+/*
+ * The defer off delay of a region grows when it is turned on again right
+ * after going off, so waits for the off state go by its current delay.
+ */
+u32 regmgr_region_defer_off_done_delay(enum TRUSTED_MEM_TYPE mem_type)
+{
+	struct trusted_mem_device *mem_device =
+		get_trusted_mem_device(mem_type);
+
+	if (INVALID(mem_device) || INVALID(mem_device->reg_mgr))
+		return REGMGR_REGION_DEFER_OFF_DONE_DELAY_MS;
+
+	return get_regmgr_region_defer_off_delay(mem_device->reg_mgr)
+	       + REGMGR_REGION_DEFER_OFF_OPERATION_LATENCY_MS;
+}
 
 static enum UT_RET_STATE regmgr_state_check(int mem_idx, int region_final_state)
 {
@@ -46,7 +65,7 @@ static enum UT_RET_STATE regmgr_state_check(int mem_idx, int region_final_state)
 			    "regmgr reg state check");
 	} else {
 		/* wait defer timeout before check for off state */
-		mdelay(REGMGR_REGION_DEFER_OFF_DONE_DELAY_MS);
+		msleep(regmgr_region_defer_off_done_delay(mem_idx));
 
 		ASSERT_FALSE(tmem_core_is_regmgr_region_on(mem_idx),
 			     "regmgr reg state check");
@@ -57,10 +76,15 @@ static enum UT_RET_STATE regmgr_state_check(int mem_idx, int region_final_state)
 
 enum UT_RET_STATE all_regmgr_state_off_check(void)
 {
+	u32 delay_ms = 0;
 	int mem_idx;
 
 	/* wait defer timeout before check for off state */
-	mdelay(REGMGR_REGION_DEFER_OFF_DONE_DELAY_MS);
+	for (mem_idx = 0; mem_idx < TRUSTED_MEM_MAX; mem_idx++)
+		if (tmem_core_is_device_registered(mem_idx))
+			delay_ms = max(delay_ms,
+				       regmgr_region_defer_off_done_delay(mem_idx));
+	msleep(delay_ms);
 
 	for (mem_idx = 0; mem_idx < TRUSTED_MEM_MAX; mem_idx++) {
 		if (tmem_core_is_device_registered(mem_idx)) {
@@ -68,7 +92,8 @@ enum UT_RET_STATE all_regmgr_state_off_check(void)
 			 * due to pmem will invoke it when pmem unrefence mem
 			 */
 			if (mem_idx == TRUSTED_MEM_2D_FR)
-				mdelay(REGMGR_REGION_DEFER_OFF_DONE_DELAY_MS);
+				msleep(regmgr_region_defer_off_done_delay(
+					mem_idx));
 
 			ASSERT_EQ(0,
 				  tmem_core_get_regmgr_region_ref_cnt(mem_idx),
@@ -470,14 +495,17 @@ mem_regmgr_region_online_count_test(enum TRUSTED_MEM_TYPE mem_type,
 	long delay_ms_after_free;
 	int alloc_cnt;
 
-	/* make sure region is off before starting */
-	mdelay(REGMGR_REGION_DEFER_OFF_DONE_DELAY_MS);
+	/* make sure region is off before starting, the delay left by the
+	 * test before may be a grown one, and the region back on after
+	 * this long is back on the normal delay
+	 */
+	msleep(regmgr_region_defer_off_done_delay(mem_type));
 
 	/* regmgr region will online 4 times */
 	regmgr_reg_on_cnt_start =
 		tmem_core_get_regmgr_region_online_cnt(mem_type);
 	alloc_cnt = 4;
-	delay_ms_after_free = REGMGR_REGION_DEFER_OFF_DONE_DELAY_MS;
+	delay_ms_after_free = regmgr_region_defer_off_done_delay(mem_type);
 	ASSERT_EQ(0, mem_delay_after_free(mem_type, mem_owner, alloc_cnt,
 					  delay_ms_after_free),
 		  "alloc and free with delay");
@@ -906,3 +934,295 @@ enum UT_RET_STATE mem_mtee_mchunks_alloc_multithread_test(void)
 	return UT_STATE_PASS;
 }
 #endif
+
+#define POOL_STRESS_THREAD_COUNT (8)
+#define POOL_STRESS_ROUNDS (64)
+#define POOL_STRESS_HELD_CHUNKS (3)
+#define POOL_STRESS_CLASS_COUNT (3)
+#define POOL_STRESS_WAIT_MS (30000)
+#define POOL_WARM_ROUNDS (8)
+#define POOL_POLL_MS (20)
+
+struct pool_thread_param {
+	char name[MEM_THREAD_NAME_LEN];
+	enum TRUSTED_MEM_TYPE mem_type;
+	u32 fail_count;
+	struct completion comp;
+};
+static struct pool_thread_param pool_thread_param[POOL_STRESS_THREAD_COUNT];
+
+static int mem_pool_thread_alloc_test(void *data)
+{
+	struct pool_thread_param *param = (struct pool_thread_param *)data;
+	u32 min_alloc_sz = tmem_core_get_min_chunk_size(param->mem_type);
+	u32 handle[POOL_STRESS_HELD_CHUNKS] = {0};
+	u32 ref_count, size;
+	u8 *owner = param->name;
+	int round, slot, ret;
+
+	/* each thread keeps a few chunks of random classes alive */
+	for (round = 0; round < POOL_STRESS_ROUNDS; round++) {
+		slot = round % POOL_STRESS_HELD_CHUNKS;
+		if (handle[slot]) {
+			ret = tmem_core_unref_chunk(param->mem_type,
+						    handle[slot], owner, 0);
+			if (ret)
+				param->fail_count++;
+			handle[slot] = 0;
+		}
+
+		size = min_alloc_sz
+		       << (prandom_u32() % POOL_STRESS_CLASS_COUNT);
+		ret = tmem_core_alloc_chunk(param->mem_type, 0, size,
+					    &ref_count, &handle[slot], owner, 0,
+					    1);
+		if (ret || ref_count != 1 || IS_ZERO(handle[slot])) {
+			param->fail_count++;
+			handle[slot] = 0;
+		}
+	}
+
+	for (slot = 0; slot < POOL_STRESS_HELD_CHUNKS; slot++) {
+		if (handle[slot] && tmem_core_unref_chunk(param->mem_type,
+							  handle[slot], owner,
+							  0))
+			param->fail_count++;
+	}
+
+	complete(&param->comp);
+
+	pr_debug("[UT_TEST]%s is done, failed:%u\n", param->name,
+		 param->fail_count);
+	return 0;
+}
+
+static enum UT_RET_STATE mem_wait_region_off(enum TRUSTED_MEM_TYPE mem_type,
+					     int wait_ms)
+{
+	while (tmem_core_is_regmgr_region_on(mem_type) && wait_ms > 0) {
+		msleep(POOL_POLL_MS);
+		wait_ms -= POOL_POLL_MS;
+	}
+
+	ASSERT_FALSE(tmem_core_is_regmgr_region_on(mem_type),
+		     "regmgr reg state check");
+	return UT_STATE_PASS;
+}
+
+static enum UT_RET_STATE mem_alloc_free_once(enum TRUSTED_MEM_TYPE mem_type,
+					     u32 size)
+{
+	u32 handle = 0, ref_count = 0;
+	int ret;
+
+	ret = tmem_core_alloc_chunk(mem_type, 0, size, &ref_count, &handle,
+				    (u8 *)"pool_ut", 0, 0);
+	ASSERT_EQ(0, ret, "alloc chunk memory");
+	ASSERT_EQ(1, ref_count, "reference count check");
+	ASSERT_NE(0, handle, "handle check");
+
+	ret = tmem_core_unref_chunk(mem_type, handle, (u8 *)"pool_ut", 0);
+	ASSERT_EQ(0, ret, "free chunk memory");
+
+	return UT_STATE_PASS;
+}
+
+static enum UT_RET_STATE
+mem_pool_concurrent_alloc_variant(enum TRUSTED_MEM_TYPE mem_type)
+{
+	struct trusted_mem_device *mem_device =
+		get_trusted_mem_device(mem_type);
+	struct pool_thread_param *param;
+	struct task_struct *task;
+	u64 alloc_count = mem_device->pool_mgr->alloc_lat.count;
+	u32 fail_count = 0;
+	int idx, ret;
+
+	for (idx = 0; idx < POOL_STRESS_THREAD_COUNT; idx++) {
+		param = &pool_thread_param[idx];
+		memset(param, 0x0, sizeof(struct pool_thread_param));
+		snprintf(param->name, MEM_THREAD_NAME_LEN, "pool%d_thread_%d",
+			 mem_type, idx);
+		param->mem_type = mem_type;
+		init_completion(&param->comp);
+
+		task = kthread_run(mem_pool_thread_alloc_test, (void *)param,
+				   param->name);
+		if (IS_ERR(task))
+			ASSERT_NOTNULL(NULL, "create kthread");
+	}
+
+	for (idx = 0; idx < POOL_STRESS_THREAD_COUNT; idx++) {
+		param = &pool_thread_param[idx];
+		ret = wait_for_completion_timeout(
+			&param->comp, msecs_to_jiffies(POOL_STRESS_WAIT_MS));
+		ASSERT_NE(0, ret, "kthread timeout check");
+		fail_count += param->fail_count;
+	}
+
+	ASSERT_EQ(0, fail_count, "concurrent alloc and free check");
+	ASSERT_EQ(POOL_STRESS_THREAD_COUNT * POOL_STRESS_ROUNDS,
+		  (int)(mem_device->pool_mgr->alloc_lat.count - alloc_count),
+		  "alloc latency sample count check");
+	ASSERT_NE(0, mem_device->pool_mgr->hit_count, "pool hit check");
+	ASSERT_EQ(0, tmem_core_get_regmgr_region_ref_cnt(mem_type),
+		  "reg reference count check");
+
+	ret = mem_wait_region_off(
+		mem_type,
+		get_regmgr_region_defer_off_delay(mem_device->reg_mgr)
+			+ REGMGR_REGION_DEFER_OFF_OPERATION_LATENCY_MS);
+	ASSERT_EQ(0, ret, "region off check");
+	ASSERT_EQ(0, ut_mock_peer_outstanding(), "peer chunks check");
+
+	return UT_STATE_PASS;
+}
+
+static enum UT_RET_STATE
+mem_pool_region_hysteresis_variant(enum TRUSTED_MEM_TYPE mem_type)
+{
+	struct region_mgr_desc *reg_mgr =
+		get_trusted_mem_device(mem_type)->reg_mgr;
+	u32 min_alloc_sz = tmem_core_get_min_chunk_size(mem_type);
+	u64 rapid_online_count;
+	int ret;
+
+	/* first on, the delay is the normal one */
+	ret = mem_alloc_free_once(mem_type, min_alloc_sz);
+	ASSERT_EQ(0, ret, "alloc and free check");
+	ASSERT_EQ(REGMGR_REGION_DEFER_OFF_DELAY_MS,
+		  get_regmgr_region_defer_off_delay(reg_mgr),
+		  "defer off delay check");
+	ret = mem_wait_region_off(mem_type,
+				  REGMGR_REGION_DEFER_OFF_DONE_DELAY_MS);
+	ASSERT_EQ(0, ret, "region off check");
+
+	/* back on right after going off, the region is kept on longer */
+	rapid_online_count = reg_mgr->rapid_online_count;
+	ret = mem_alloc_free_once(mem_type, min_alloc_sz);
+	ASSERT_EQ(0, ret, "alloc and free check");
+	ASSERT_EQ(REGMGR_REGION_DEFER_OFF_DELAY_MS * 2,
+		  get_regmgr_region_defer_off_delay(reg_mgr),
+		  "defer off delay doubled check");
+	ASSERT_EQ(rapid_online_count + 1, reg_mgr->rapid_online_count,
+		  "rapid online count check");
+
+	msleep(REGMGR_REGION_DEFER_OFF_DONE_DELAY_MS);
+	ASSERT_TRUE(tmem_core_is_regmgr_region_on(mem_type),
+		    "region kept on check");
+	ret = mem_wait_region_off(mem_type,
+				  REGMGR_REGION_DEFER_OFF_DONE_DELAY_MS);
+	ASSERT_EQ(0, ret, "region off check");
+
+	/* off for a while, the delay goes back to the normal one */
+	msleep(REGMGR_REGION_REONLINE_HYSTERESIS_MS * 2);
+	ret = mem_alloc_free_once(mem_type, min_alloc_sz);
+	ASSERT_EQ(0, ret, "alloc and free check");
+	ASSERT_EQ(REGMGR_REGION_DEFER_OFF_DELAY_MS,
+		  get_regmgr_region_defer_off_delay(reg_mgr),
+		  "defer off delay reset check");
+	ret = mem_wait_region_off(mem_type,
+				  REGMGR_REGION_DEFER_OFF_DONE_DELAY_MS);
+	ASSERT_EQ(0, ret, "region off check");
+
+	ASSERT_LE(3, (int)reg_mgr->off_lat.count, "teardown sample check");
+	return UT_STATE_PASS;
+}
+
+static enum UT_RET_STATE
+mem_pool_saturation_variant(enum TRUSTED_MEM_TYPE mem_type)
+{
+	struct pool_mgr_desc *pool = get_trusted_mem_device(mem_type)->pool_mgr;
+	u32 min_alloc_sz = tmem_core_get_min_chunk_size(mem_type);
+	u32 max_count = MOCK_PEER_REGION_SIZE / min_alloc_sz;
+	u32 *handle_list;
+	u32 handle, ref_count, count;
+	int idx, wait_ms, ret, extra_ret;
+	bool warm;
+
+	handle_list = mld_kmalloc(sizeof(u32) * max_count, GFP_KERNEL);
+	ASSERT_NOTNULL(handle_list, "create handle list");
+
+	/* leave chunks of another class cached in the pool */
+	for (idx = 0; idx < POOL_WARM_ROUNDS; idx++) {
+		ret = mem_alloc_free_once(mem_type, min_alloc_sz * 2);
+		if (ret)
+			break;
+	}
+	for (wait_ms = POOL_STRESS_WAIT_MS; wait_ms > 0;
+	     wait_ms -= POOL_POLL_MS) {
+		if (!IS_ZERO(pool->cached_size))
+			break;
+		msleep(POOL_POLL_MS);
+	}
+	warm = !IS_ZERO(pool->cached_size);
+
+	/* the pool has to give its chunks back for the region to fill up */
+	for (count = 0; count < max_count; count++) {
+		if (tmem_core_alloc_chunk(mem_type, 0, min_alloc_sz,
+					  &ref_count, &handle_list[count],
+					  (u8 *)"pool_ut", 0, 0))
+			break;
+	}
+
+	extra_ret = tmem_core_alloc_chunk(mem_type, 0, min_alloc_sz,
+					  &ref_count, &handle, (u8 *)"pool_ut",
+					  0, 0);
+	if (!extra_ret)
+		tmem_core_unref_chunk(mem_type, handle, (u8 *)"pool_ut", 0);
+
+	for (idx = 0; idx < count; idx++) {
+		ret = tmem_core_unref_chunk(mem_type, handle_list[idx],
+					    (u8 *)"pool_ut", 0);
+		ASSERT_EQ(0, ret, "free chunk memory");
+	}
+	mld_kfree(handle_list);
+
+	ASSERT_TRUE(warm, "pool warm check");
+	ASSERT_EQ(max_count, count, "saturation chunk count check");
+	ASSERT_NE(0, extra_ret, "alloc beyond saturation check");
+	ASSERT_NE(0, pool->shrink_count, "pool shrink check");
+
+	wait_ms = REGMGR_REGION_DEFER_OFF_MAX_DELAY_MS
+		  + REGMGR_REGION_DEFER_OFF_OPERATION_LATENCY_MS;
+	ret = mem_wait_region_off(mem_type, wait_ms);
+	ASSERT_EQ(0, ret, "region off check");
+	ASSERT_EQ(0, ut_mock_peer_outstanding(), "peer chunks check");
+
+	return UT_STATE_PASS;
+}
+
+static enum UT_RET_STATE
+mem_pool_run_with_mock_peer(enum UT_RET_STATE (*variant)(
+	enum TRUSTED_MEM_TYPE mem_type))
+{
+	enum TRUSTED_MEM_TYPE mem_type;
+	int ret;
+
+	mem_type = ut_mock_peer_create();
+	if (mem_type == TRUSTED_MEM_INVALID) {
+		pr_info("[UT_TEST]no free mem type for mock peer, skipped\n");
+		return UT_STATE_PASS;
+	}
+
+	ret = variant(mem_type);
+
+	ASSERT_EQ(0, ut_mock_peer_destroy(mem_type), "mock peer destroy");
+	ASSERT_EQ(0, ret, "pool test with mock peer check");
+	return UT_STATE_PASS;
+}
+
+enum UT_RET_STATE mem_pool_concurrent_alloc_test(void)
+{
+	return mem_pool_run_with_mock_peer(mem_pool_concurrent_alloc_variant);
+}
+
+enum UT_RET_STATE mem_pool_region_hysteresis_test(void)
+{
+	return mem_pool_run_with_mock_peer(mem_pool_region_hysteresis_variant);
+}
+
+enum UT_RET_STATE mem_pool_saturation_test(void)
+{
+	return mem_pool_run_with_mock_peer(mem_pool_saturation_variant);
+}
@@ -28,6 +28,7 @@
 #define MULTIPLE_REGION_MULTIPLE_THREAD_TEST_ENABLE (0)
 #define MTEE_MCHUNKS_MULTIPLE_THREAD_TEST_ENABLE (1)
 
+u32 regmgr_region_defer_off_done_delay(enum TRUSTED_MEM_TYPE mem_type);
 enum UT_RET_STATE all_regmgr_state_off_check(void);
 enum UT_RET_STATE mem_basic_test(enum TRUSTED_MEM_TYPE mem_type,
 				 int region_final_state);
@@ -58,5 +59,8 @@ enum UT_RET_STATE mem_alloc_mixed_size_test(enum TRUSTED_MEM_TYPE mem_type,
 enum UT_RET_STATE mem_multi_type_alloc_multithread_test(void);
 enum UT_RET_STATE mem_mtee_mchunks_alloc_multithread_test(void);
 bool is_multi_type_alloc_multithread_test_locked(void);
+enum UT_RET_STATE mem_pool_concurrent_alloc_test(void);
+enum UT_RET_STATE mem_pool_region_hysteresis_test(void);
+enum UT_RET_STATE mem_pool_saturation_test(void);
 
 #endif /* end of TMEM_UT_COMMON_H */
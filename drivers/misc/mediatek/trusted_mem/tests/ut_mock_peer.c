@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#define TMEM_UT_TEST_FMT
+#define PR_FMT_HEADER_MUST_BE_INCLUDED_BEFORE_ALL_HDRS
+#include "private/tmem_pr_fmt.h" PR_FMT_HEADER_MUST_BE_INCLUDED_BEFORE_ALL_HDRS
+
+#include <linux/bitmap.h>
+#include <linux/delay.h>
+#include <linux/errno.h>
+#include <linux/kernel.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+
+#include "private/mld_helper.h"
+#include "private/tmem_error.h"
+#include "private/tmem_utils.h"
+#include "private/tmem_priv.h"
+#include "private/tmem_entry.h"
+#include "tests/ut_mock_peer.h"
+
+/*
+ * Mock peer
+ *
+ * Stands in for the secure world so the pool, region and locking paths can
+ * be stressed on any device. The region is a bitmap of minimal chunks
+ * handed out first fit at the requested alignment, and each call sleeps
+ * about as long as a world switch; a clean allocation also pays for
+ * clearing the chunk. Like the real peers, memory cannot be reclaimed
+ * while chunks are still allocated.
+ */
+
+#define MOCK_PEER_NR_SLOT (MOCK_PEER_REGION_SIZE / MOCK_PEER_MIN_CHUNK_SIZE)
+#define MOCK_PEER_REGION_PA (0x80000000ULL)
+#define MOCK_PEER_CALL_US (40)
+#define MOCK_PEER_CLEAN_US_PER_CHUNK (20)
+#define MOCK_PEER_REGION_MS (2)
+
+struct mock_peer_data {
+	spinlock_t lock;
+	DECLARE_BITMAP(slot_map, MOCK_PEER_NR_SLOT);
+	u16 nr_slot[MOCK_PEER_NR_SLOT];
+	u32 outstanding;
+	bool granted;
+	bool opened;
+};
+
+static struct mock_peer_data mock_data = {
+	.lock = __SPIN_LOCK_UNLOCKED(mock_data.lock),
+};
+static struct trusted_mem_device *mock_device;
+static DEFINE_MUTEX(mock_lock);
+
+static void mock_peer_delay(u32 us)
+{
+	usleep_range(us, us + us / 4 + 1);
+}
+
+static int mock_peer_session_open(void **peer_data, void *dev_desc)
+{
+	mock_peer_delay(MOCK_PEER_CALL_US);
+	mock_data.opened = true;
+	*peer_data = &mock_data;
+	return TMEM_OK;
+}
+
+static int mock_peer_session_close(void *peer_data, void *dev_desc)
+{
+	mock_peer_delay(MOCK_PEER_CALL_US);
+	mock_data.opened = false;
+	return TMEM_OK;
+}
+
+static int mock_peer_alloc(u32 alignment, u32 size, u32 *refcount,
+			   u32 *sec_handle, u8 *owner, u32 id, u32 clean,
+			   void *peer_data, void *dev_desc)
+{
+	struct mock_peer_data *data = (struct mock_peer_data *)peer_data;
+	u32 nr = DIV_ROUND_UP(size, MOCK_PEER_MIN_CHUNK_SIZE);
+	u32 align_nr = DIV_ROUND_UP(alignment, MOCK_PEER_MIN_CHUNK_SIZE);
+	unsigned long slot;
+
+	if (INVALID(data) || !data->granted || IS_ZERO(size))
+		return TMEM_GENERAL_ERROR;
+
+	mock_peer_delay(MOCK_PEER_CALL_US
+			+ (clean ? nr * MOCK_PEER_CLEAN_US_PER_CHUNK : 0));
+
+	spin_lock(&data->lock);
+	slot = bitmap_find_next_zero_area(data->slot_map, MOCK_PEER_NR_SLOT, 0,
+					  nr, align_nr ? align_nr - 1 : 0);
+	if (slot >= MOCK_PEER_NR_SLOT) {
+		spin_unlock(&data->lock);
+		return -ENOMEM;
+	}
+	bitmap_set(data->slot_map, slot, nr);
+	data->nr_slot[slot] = nr;
+	data->outstanding++;
+	spin_unlock(&data->lock);
+
+	*refcount = 1;
+	*sec_handle = slot + 1;
+	return TMEM_OK;
+}
+
+static int mock_peer_free(u32 sec_handle, u8 *owner, u32 id, void *peer_data,
+			  void *dev_desc)
+{
+	struct mock_peer_data *data = (struct mock_peer_data *)peer_data;
+	u32 slot = sec_handle - 1;
+
+	if (INVALID(data) || IS_ZERO(sec_handle)
+	    || slot >= MOCK_PEER_NR_SLOT)
+		return TMEM_PARAMETER_ERROR;
+
+	mock_peer_delay(MOCK_PEER_CALL_US);
+
+	spin_lock(&data->lock);
+	if (IS_ZERO(data->nr_slot[slot])) {
+		spin_unlock(&data->lock);
+		pr_err("[UT_MOCK]free of unknown handle 0x%x\n", sec_handle);
+		return TMEM_PARAMETER_ERROR;
+	}
+	bitmap_clear(data->slot_map, slot, data->nr_slot[slot]);
+	data->nr_slot[slot] = 0;
+	data->outstanding--;
+	spin_unlock(&data->lock);
+
+	return TMEM_OK;
+}
+
+static int mock_peer_grant(u64 pa, u32 size, void *peer_data, void *dev_desc)
+{
+	struct mock_peer_data *data = (struct mock_peer_data *)peer_data;
+
+	if (pa != MOCK_PEER_REGION_PA || size != MOCK_PEER_REGION_SIZE)
+		return TMEM_INVALID_ADDR_OR_SIZE;
+
+	msleep(MOCK_PEER_REGION_MS);
+	data->granted = true;
+	return TMEM_OK;
+}
+
+static int mock_peer_reclaim(void *peer_data, void *dev_desc)
+{
+	struct mock_peer_data *data = (struct mock_peer_data *)peer_data;
+	u32 outstanding;
+
+	spin_lock(&data->lock);
+	outstanding = data->outstanding;
+	spin_unlock(&data->lock);
+
+	if (outstanding) {
+		pr_err("[UT_MOCK]reclaim with %u chunks allocated\n",
+		       outstanding);
+		return TMEM_GENERAL_ERROR;
+	}
+
+	msleep(MOCK_PEER_REGION_MS);
+	data->granted = false;
+	return TMEM_OK;
+}
+
+static int mock_peer_invoke_cmd(struct trusted_driver_cmd_params *params,
+				void *peer_data, void *dev_desc)
+{
+	mock_peer_delay(MOCK_PEER_CALL_US);
+	return TMEM_OK;
+}
+
+static struct trusted_driver_operations mock_peer_ops = {
+	.session_open = mock_peer_session_open,
+	.session_close = mock_peer_session_close,
+	.memory_alloc = mock_peer_alloc,
+	.memory_free = mock_peer_free,
+	.memory_grant = mock_peer_grant,
+	.memory_reclaim = mock_peer_reclaim,
+	.invoke_cmd = mock_peer_invoke_cmd,
+};
+
+static int mock_ssmr_offline(u64 *pa, u32 *size, u32 feat, void *dev_desc)
+{
+	msleep(MOCK_PEER_REGION_MS);
+	*pa = MOCK_PEER_REGION_PA;
+	*size = MOCK_PEER_REGION_SIZE;
+	return TMEM_OK;
+}
+
+static int mock_ssmr_online(u32 feat, void *dev_desc)
+{
+	msleep(MOCK_PEER_REGION_MS);
+	return TMEM_OK;
+}
+
+static struct ssmr_operations mock_ssmr_ops = {
+	.offline = mock_ssmr_offline,
+	.online = mock_ssmr_online,
+};
+
+static struct trusted_mem_configs mock_configs = {
+	.session_keep_alive_enable = false,
+	.minimal_chunk_size = MOCK_PEER_MIN_CHUNK_SIZE,
+	.phys_mem_shift_bits = 6,
+	.phys_limit_min_alloc_size = (1 << 6),
+	.min_size_check_enable = false,
+	.alignment_check_enable = true,
+	.chunk_pool_enable = true,
+	.caps = 0,
+};
+
+/*
+ * Registers the mock device on the first free memory type, returns
+ * TRUSTED_MEM_INVALID if every type is taken by a real device.
+ */
+enum TRUSTED_MEM_TYPE ut_mock_peer_create(void)
+{
+	enum TRUSTED_MEM_TYPE mem_type;
+	struct trusted_mem_device *t_device;
+
+	mutex_lock(&mock_lock);
+
+	if (VALID(mock_device)) {
+		pr_err("[UT_MOCK]mock device is already created\n");
+		goto err_out;
+	}
+
+	for (mem_type = TRUSTED_MEM_START; mem_type < TRUSTED_MEM_MAX;
+	     mem_type++) {
+		if (!tmem_core_is_device_registered(mem_type))
+			break;
+	}
+	if (mem_type == TRUSTED_MEM_MAX)
+		goto err_out;
+
+	memset(&mock_data, 0x0, sizeof(mock_data));
+	spin_lock_init(&mock_data.lock);
+
+	t_device = create_trusted_mem_device(mem_type, &mock_configs);
+	if (INVALID(t_device))
+		goto err_out;
+
+	t_device->peer_ops = &mock_peer_ops;
+	t_device->ssmr_ops = &mock_ssmr_ops;
+	t_device->dev_desc = NULL;
+	t_device->mem_type = mem_type;
+	snprintf(t_device->name, MAX_DEVICE_NAME_LEN, "UT_MOCK_PEER");
+
+	if (register_trusted_mem_device(mem_type, t_device)) {
+		destroy_trusted_mem_device(t_device);
+		goto err_out;
+	}
+
+	mock_device = t_device;
+	mutex_unlock(&mock_lock);
+	return mem_type;
+
+err_out:
+	mutex_unlock(&mock_lock);
+	return TRUSTED_MEM_INVALID;
+}
+
+/* Waits for the region to go off, then removes the mock device */
+int ut_mock_peer_destroy(enum TRUSTED_MEM_TYPE mem_type)
+{
+	int wait_ms = REGMGR_REGION_DEFER_OFF_MAX_DELAY_MS
+		      + REGMGR_REGION_DEFER_OFF_OPERATION_LATENCY_MS;
+	int ret;
+
+	mutex_lock(&mock_lock);
+
+	if (INVALID(mock_device) || mock_device->mem_type != mem_type) {
+		mutex_unlock(&mock_lock);
+		return TMEM_PARAMETER_ERROR;
+	}
+
+	while (tmem_core_is_regmgr_region_on(mem_type) && wait_ms > 0) {
+		msleep(100);
+		wait_ms -= 100;
+	}
+	if (tmem_core_is_regmgr_region_on(mem_type)) {
+		pr_err("[UT_MOCK]region is still on, mock device is kept\n");
+		mutex_unlock(&mock_lock);
+		return TMEM_SHARED_DEVICE_REGION_IS_BUSY;
+	}
+
+	ret = unregister_trusted_mem_device(mem_type);
+	if (!ret) {
+		destroy_trusted_mem_device(mock_device);
+		mock_device = NULL;
+	}
+
+	mutex_unlock(&mock_lock);
+	return ret;
+}
+
+u32 ut_mock_peer_outstanding(void)
+{
+	u32 outstanding;
+
+	spin_lock(&mock_data.lock);
+	outstanding = mock_data.outstanding;
+	spin_unlock(&mock_data.lock);
+
+	return outstanding;
+}
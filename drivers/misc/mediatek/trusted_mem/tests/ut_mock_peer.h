@@ -0,0 +1,27 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef TMEM_UT_MOCK_PEER_H
+#define TMEM_UT_MOCK_PEER_H
+
+#include "private/tmem_device.h"
+#include "private/tmem_utils.h"
+
+#define MOCK_PEER_REGION_SIZE SIZE_16M
+#define MOCK_PEER_MIN_CHUNK_SIZE SIZE_64K
+
+enum TRUSTED_MEM_TYPE ut_mock_peer_create(void);
+int ut_mock_peer_destroy(enum TRUSTED_MEM_TYPE mem_type);
+u32 ut_mock_peer_outstanding(void);
+
+#endif /* end of TMEM_UT_MOCK_PEER_H */
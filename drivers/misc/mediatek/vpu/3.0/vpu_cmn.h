@@ -30,6 +30,8 @@
 #define VPU_PORT_OF_IOMMU M4U_PORT_VPU
 
 /* Common Structure */
+struct vpu_ring;
+
 struct vpu_device {
 	struct proc_dir_entry *proc_dir;
 	struct device *dev[MTK_VPU_CORE+3];
@@ -80,6 +82,8 @@ struct vpu_user {
 	uint8_t power_mode;
 	uint8_t power_opp;
 	uint8_t algo_num;
+	/* submission ring, set once by VPU_IOCTL_RING_SETUP */
+	struct vpu_ring *ring;
 };
 
 struct vpu_shared_memory_param {
@@ -428,6 +432,13 @@ int vpu_delete_user(struct vpu_user *user);
 int vpu_push_request_to_queue(struct vpu_user *user, struct vpu_request *req);
 int vpu_put_request_to_pool(struct vpu_user *user, struct vpu_request *req);
 
+/**
+ * vpu_dispatch_request_to_pool - queue a request with its ion handles
+ *                                imported to the pool of requested core
+ * @req:        the request to be queued.
+ */
+int vpu_dispatch_request_to_pool(struct vpu_request *req);
+
 
 
 /**
@@ -470,6 +481,12 @@ int vpu_dump_user(struct seq_file *s);
  */
 int vpu_dump_user_algo(struct seq_file *s);
 
+/**
+ * vpu_dump_ring - dump the submission ring statistics of users
+ * @s:          the pointer to seq_file.
+ */
+int vpu_dump_ring(struct seq_file *s);
+
 /* ========================== define in vpu_algo.c  ======================== */
 
 /**
@@ -512,6 +529,59 @@ int vpu_add_algo_to_user(struct vpu_user *user,
 int vpu_free_algo_from_user(struct vpu_user *user,
 	struct vpu_create_algo *create_algo);
 
+/* ========================== define in vpu_ring.c  ======================== */
+
+/**
+ * vpu_ring_setup - create the submission ring of user
+ * @user:       the pointer to user.
+ * @setup:      ring sizes and eventfd, returns the size to mmap.
+ */
+int vpu_ring_setup(struct vpu_user *user, struct vpu_ring_setup *setup);
+
+/**
+ * vpu_ring_reg_buf - register or unregister a buffer of user's ring
+ * @user:       the pointer to user.
+ * @buf:        buffer index and its ion fd.
+ */
+int vpu_ring_reg_buf(struct vpu_user *user, struct vpu_ring_buf *buf);
+
+/**
+ * vpu_ring_enter - submit the queued sqes and wait for completions
+ * @user:       the pointer to user.
+ * @enter:      sqes to submit and completions to wait for.
+ */
+int vpu_ring_enter(struct vpu_user *user, struct vpu_ring_enter *enter);
+
+/**
+ * vpu_ring_mmap - map the ring of user to user space
+ * @user:       the pointer to user.
+ * @vma:        the vma at VPU_RING_MMAP_OFFSET.
+ */
+int vpu_ring_mmap(struct vpu_user *user, struct vm_area_struct *vma);
+
+/**
+ * vpu_ring_complete - take back a finished request of user's ring
+ * @user:       the pointer to user, data_mutex is held.
+ * @req:        the finished request.
+ *
+ * Returns true if the request belongs to the ring, which then owns it.
+ * Otherwise it goes to the deque list as usual.
+ */
+bool vpu_ring_complete(struct vpu_user *user, struct vpu_request *req);
+
+/**
+ * vpu_ring_release - wait for the ring requests and free the ring of user
+ * @user:       the pointer to user.
+ */
+void vpu_ring_release(struct vpu_user *user);
+
+/**
+ * vpu_ring_dump - dump the statistics of a ring
+ * @s:          the pointer to seq_file.
+ * @user:       the pointer to user.
+ */
+void vpu_ring_dump(struct seq_file *s, struct vpu_user *user);
+
 /* ========================== define in vpu_dbg.c  ========================= */
 
 /**
@@ -34,6 +34,9 @@
 int g_vpu_log_level = 1;
 int g_vpu_internal_log_level;
 unsigned int g_func_mask;
+#ifdef CONFIG_MTK_VPU_RING_CPU
+unsigned int g_vpu_ring_cpu;
+#endif
 
 static int vpu_log_level_set(void *data, u64 val)
 {
@@ -91,6 +94,27 @@ static int vpu_func_mask_get(void *data, u64 *val)
 DEFINE_SIMPLE_ATTRIBUTE(vpu_debug_func_mask_fops, vpu_func_mask_get,
 				vpu_func_mask_set, "%llu\n");
 
+#ifdef CONFIG_MTK_VPU_RING_CPU
+/* rings set up afterwards run on the cpu reference kernels */
+static int vpu_ring_cpu_set(void *data, u64 val)
+{
+	g_vpu_ring_cpu = !!val;
+	LOG_INF("g_vpu_ring_cpu: %d\n", g_vpu_ring_cpu);
+
+	return 0;
+}
+
+static int vpu_ring_cpu_get(void *data, u64 *val)
+{
+	*val = g_vpu_ring_cpu;
+
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(vpu_debug_ring_cpu_fops, vpu_ring_cpu_get,
+				vpu_ring_cpu_set, "%llu\n");
+#endif
+
 
 #define IMPLEMENT_VPU_DEBUGFS(name)					\
 static int vpu_debug_## name ##_show(struct seq_file *s, void *unused)\
@@ -120,6 +144,7 @@ IMPLEMENT_VPU_DEBUGFS(opp_table);
 IMPLEMENT_VPU_DEBUGFS(device_dbg);
 IMPLEMENT_VPU_DEBUGFS(user_algo);
 IMPLEMENT_VPU_DEBUGFS(vpu_memory);
+IMPLEMENT_VPU_DEBUGFS(ring);
 
 #undef IMPLEMENT_VPU_DEBUGFS
 
@@ -315,6 +340,10 @@ int vpu_init_debug(struct vpu_device *vpu_dev)
 	CREATE_VPU_DEBUGFS(device_dbg);
 	CREATE_VPU_DEBUGFS(user_algo);
 	CREATE_VPU_DEBUGFS(vpu_memory);
+	CREATE_VPU_DEBUGFS(ring);
+#ifdef CONFIG_MTK_VPU_RING_CPU
+	CREATE_VPU_DEBUGFS(ring_cpu);
+#endif
 
 #undef CREATE_VPU_DEBUGFS
 
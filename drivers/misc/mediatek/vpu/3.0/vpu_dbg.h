@@ -23,6 +23,11 @@
 extern int g_vpu_log_level;
 extern int g_vpu_internal_log_level;
 extern unsigned int g_func_mask;
+#ifdef CONFIG_MTK_VPU_RING_CPU
+extern unsigned int g_vpu_ring_cpu;
+#else
+#define g_vpu_ring_cpu 0
+#endif
 
 enum VpuFuncMask {
 	VFM_NEED_WAIT_VCORE		= 0x1,
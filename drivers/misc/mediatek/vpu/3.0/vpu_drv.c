@@ -284,10 +284,9 @@ int vpu_push_request_to_queue(struct vpu_user *user, struct vpu_request *req)
 
 int vpu_put_request_to_pool(struct vpu_user *user, struct vpu_request *req)
 {
-	int i = 0, req_core = -1;
+	int i = 0;
 	int j = 0, cnt = 0, k = 0;
 	struct ion_handle *handle = NULL;
-	int ret = 0;
 
 	if (!user) {
 		LOG_ERR("empty user\n");
@@ -349,6 +348,15 @@ int vpu_put_request_to_pool(struct vpu_user *user, struct vpu_request *req)
 						(uint64_t)(uintptr_t)handle;
 			}
 	}
+
+	return vpu_dispatch_request_to_pool(req);
+}
+
+int vpu_dispatch_request_to_pool(struct vpu_request *req)
+{
+	int i = 0, req_core = -1;
+	int ret = 0;
+
 	/* CHRISTODO, specific vpu */
 	for (i = 0 ; i < MTK_VPU_CORE ; i++) {
 		/*LOG_DBG("debug i(%d), (0x1 << i) (0x%x)", i, (0x1 << i));*/
@@ -671,6 +679,9 @@ int vpu_delete_user(struct vpu_user *user)
 		}
 	}
 
+	/* ring requests may still be in the pools */
+	vpu_ring_release(user);
+
 	/* clear the list of deque */
 	mutex_lock(&user->data_mutex);
 	list_for_each_safe(head, temp, &user->deque_list) {
@@ -783,6 +794,23 @@ int vpu_dump_user(struct seq_file *s)
 }
 
 
+int vpu_dump_ring(struct seq_file *s)
+{
+	struct vpu_user *user;
+	struct list_head *head_user;
+
+	mutex_lock(&vpu_device->user_mutex);
+	list_for_each(head_user, &vpu_device->user_list)
+	{
+		user = vlist_node_of(head_user, struct vpu_user);
+		vpu_ring_dump(s, user);
+	}
+	mutex_unlock(&vpu_device->user_mutex);
+
+	return 0;
+}
+
+
 int vpu_alloc_debug_info(struct vpu_dev_debug_info **rdbginfo)
 {
 	struct vpu_dev_debug_info *dbginfo;
@@ -897,6 +925,9 @@ static long vpu_compat_ioctl(struct file *flip, unsigned int cmd,
 	case VPU_IOCTL_FREE_ALGO:
 	case VPU_IOCTL_OPEN_DEV_NOTICE:
 	case VPU_IOCTL_CLOSE_DEV_NOTICE:
+	case VPU_IOCTL_RING_SETUP:
+	case VPU_IOCTL_RING_REG_BUF:
+	case VPU_IOCTL_RING_ENTER:
 	{
 		/*void *ptr = compat_ptr(arg);*/
 
@@ -1384,6 +1415,67 @@ static long vpu_ioctl(struct file *flip, unsigned int cmd, unsigned long arg)
 
 		break;
 	}
+	case VPU_IOCTL_RING_SETUP:
+	{
+		struct vpu_ring_setup setup;
+
+		if (copy_from_user(&setup, (void *) arg,
+				sizeof(struct vpu_ring_setup))) {
+			LOG_ERR("[RING_SETUP] copy 'struct setup' failed\n");
+			ret = -EFAULT;
+			goto out;
+		}
+
+		ret = vpu_ring_setup(user, &setup);
+		if (ret) {
+			LOG_ERR("[RING_SETUP] setup failed, ret=%d\n", ret);
+			goto out;
+		}
+
+		if (copy_to_user((void *) arg, &setup,
+				sizeof(struct vpu_ring_setup)))
+			ret = -EFAULT;
+		break;
+	}
+	case VPU_IOCTL_RING_REG_BUF:
+	{
+		struct vpu_ring_buf buf;
+
+		if (copy_from_user(&buf, (void *) arg,
+				sizeof(struct vpu_ring_buf))) {
+			LOG_ERR("[RING_REG_BUF] copy 'struct buf' failed\n");
+			ret = -EFAULT;
+			goto out;
+		}
+
+		ret = vpu_ring_reg_buf(user, &buf);
+		if (ret) {
+			LOG_ERR("[RING_REG_BUF] buf %d failed, ret=%d\n",
+				buf.index, ret);
+			goto out;
+		}
+		break;
+	}
+	case VPU_IOCTL_RING_ENTER:
+	{
+		struct vpu_ring_enter enter;
+		struct vpu_ring_enter *u_enter = (struct vpu_ring_enter *) arg;
+
+		if (copy_from_user(&enter, (void *) arg,
+				sizeof(struct vpu_ring_enter))) {
+			LOG_ERR("[RING_ENTER] copy 'struct enter' failed\n");
+			ret = -EFAULT;
+			goto out;
+		}
+
+		ret = vpu_ring_enter(user, &enter);
+		/* the submitted sqes are consumed even if the wait failed */
+		if (put_user(enter.submitted, &u_enter->submitted))
+			ret = -EFAULT;
+		if (ret)
+			goto out;
+		break;
+	}
 
 	case VPU_IOCTL_GET_CORE_STATUS:
 	{
@@ -1636,6 +1728,10 @@ static int vpu_mmap(struct file *flip, struct vm_area_struct *vma)
 	unsigned long length = 0;
 	unsigned int pfn = 0x0;
 
+	/* the ring is in normal memory, keep it cacheable */
+	if (vma->vm_pgoff == (VPU_RING_MMAP_OFFSET >> PAGE_SHIFT))
+		return vpu_ring_mmap(flip->private_data, vma);
+
 	length = (vma->vm_end - vma->vm_start);
 	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
 	pfn = vma->vm_pgoff << PAGE_SHIFT;
@@ -408,6 +408,116 @@ struct vpu_lock_power {
 	enum VPU_OPP_PRIORIYY priority;
 };
 
+/*---------------------------------------------------------------------------*/
+/*  VPU Submission Ring                                                      */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * A submission ring lets a user queue requests and reap their results
+ * through memory shared with the driver, instead of one ENQUE and one
+ * DEQUE ioctl per request. The mapping at VPU_RING_MMAP_OFFSET is laid out
+ * as follows:
+ *
+ *   +---------------+---------------------------+---------------------------+
+ *   | vpu_ring_ctrl | vpu_ring_sqe x sq_entries | vpu_ring_cqe x cq_entries |
+ *   +---------------+---------------------------+---------------------------+
+ *   0               sq_off                      cq_off
+ *
+ * The user fills sqes at sq_tail and moves sq_tail on, then
+ * VPU_IOCTL_RING_ENTER submits up to to_submit of them and waits for
+ * min_complete results. The driver writes a cqe at cq_tail for each
+ * finished sqe, the user moves cq_head on once it has read them. The
+ * eventfd given at setup is signaled once per batch of results, not once
+ * per request.
+ *
+ * Buffers are registered once with VPU_IOCTL_RING_REG_BUF and referred to
+ * by index in the sqes, so a request does not import its ion fds again.
+ * A sqe flagged VPU_RING_SQE_CHAIN starts only once the sqe before it has
+ * completed successfully, otherwise it completes with VPU_REQ_STATUS_FLUSH.
+ */
+#define VPU_RING_MMAP_OFFSET	0x10000000
+#define VPU_RING_MAX_ENTRIES	256
+#define VPU_RING_MAX_PORTS	8
+#define VPU_RING_MAX_BUFS	64
+#define VPU_RING_NO_BUF		0xFFFF
+
+#define VPU_RING_SQE_CHAIN	(1 << 0)
+
+/* indexes are free running, the slot is index & (entries - 1) */
+struct vpu_ring_ctrl {
+	/* written by user */
+	uint32_t sq_tail;
+	uint32_t cq_head;
+	uint32_t user_pad[14];
+	/* written by driver */
+	uint32_t sq_head;
+	uint32_t cq_tail;
+	uint32_t cq_overflow;
+	uint32_t drv_pad[13];
+	/* constant after setup */
+	uint32_t sq_entries;
+	uint32_t cq_entries;
+	uint32_t sq_off;
+	uint32_t cq_off;
+};
+
+struct vpu_ring_sqe {
+	uint64_t user_data;      /* returned as is in the cqe */
+	uint64_t priv;
+	uint32_t flags;
+	uint32_t requested_core;
+	int frame_magic;
+	vpu_id_t algo_id[VPU_MAX_NUM_CORES];
+	uint8_t priority;
+	uint8_t boost_value;
+	uint8_t buffer_count;
+	uint16_t sett_buf;       /* registered buffer of sett, or NO_BUF */
+	uint32_t sett_lens;
+	uint64_t sett_ptr;
+	struct vpu_buffer buffers[VPU_RING_MAX_PORTS];
+	uint16_t plane_buf[VPU_RING_MAX_PORTS][3]; /* registered buffers */
+};
+
+struct vpu_ring_cqe {
+	uint64_t user_data;
+	uint64_t busy_time;
+	int frame_magic;
+	uint32_t occupied_core;
+	uint32_t bandwidth;
+	uint8_t status;
+	uint8_t reserved[3];
+};
+
+struct vpu_ring_setup {
+	uint32_t sq_entries;     /* rounded up to a power of 2 */
+	uint32_t cq_entries;     /* 0 for twice sq_entries */
+	int32_t eventfd;         /* -1 for none */
+	uint32_t mmap_size;      /* out */
+};
+
+struct vpu_ring_buf {
+	uint32_t index;
+	int32_t fd;              /* -1 to unregister the index */
+};
+
+struct vpu_ring_enter {
+	uint32_t to_submit;
+	uint32_t min_complete;
+	uint32_t submitted;      /* out */
+	uint32_t flags;
+};
+
+/*
+ * Reference kernels of the cpu backend, selected by algo_id[0]. They work
+ * on Y8 planes, the plane ptr is the byte offset in its registered buffer
+ * and the last buffer is the output.
+ */
+enum vpu_ring_cpu_algo {
+	VPU_RING_CPU_COPY = 1,
+	VPU_RING_CPU_INVERT,
+	VPU_RING_CPU_ADD,
+};
+
 #ifdef CONFIG_MTK_GZ_SUPPORT_SDSP
 extern int mtee_sdsp_enable(u32 on);
 #endif
@@ -436,6 +546,9 @@ extern int mtee_sdsp_enable(u32 on);
 
 #define VPU_IOCTL_CREATE_ALGO       _IOWR(VPU_MAGICNO,  17, int)
 #define VPU_IOCTL_FREE_ALGO         _IOWR(VPU_MAGICNO,  18, int)
+#define VPU_IOCTL_RING_SETUP        _IOWR(VPU_MAGICNO,  19, int)
+#define VPU_IOCTL_RING_REG_BUF      _IOW(VPU_MAGICNO,   20, int)
+#define VPU_IOCTL_RING_ENTER        _IOWR(VPU_MAGICNO,  21, int)
 
 #define VPU_IOCTL_SDSP_SEC_LOCK     _IOW(VPU_MAGICNO,   60, int)
 #define VPU_IOCTL_SDSP_SEC_UNLOCK   _IOW(VPU_MAGICNO,   61, int)
@@ -0,0 +1,854 @@
+/*
+ * Copyright (C) 2016 MediaTek Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/types.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
+#include <linux/idr.h>
+#include <linux/log2.h>
+#include <linux/ktime.h>
+#include <linux/cache.h>
+#include <linux/dma-buf.h>
+#include <linux/eventfd.h>
+#include <linux/workqueue.h>
+
+#include <ion.h>
+#include <mtk/ion_drv.h>
+#include <mtk/mtk_ion.h>
+
+#include "vpu_drv.h"
+#include "vpu_cmn.h"
+#include "vpu_dbg.h"
+
+/*
+ * Submission ring
+ *
+ * Each consumed sqe becomes a job holding a vpu_request, which goes
+ * through the same pools and service threads as an enqueued request. Its
+ * request_id carries the job id, so the service thread hands it back
+ * through vpu_ring_complete() instead of the deque list. Finished jobs
+ * are collected on done_list and retired by one work item, which writes
+ * their cqes, starts or flushes the jobs chained to them and signals the
+ * eventfd once for all of them.
+ *
+ * A job holds one ion reference per plane, taken on the handle of its
+ * registered buffer, which the service thread drops as it does for
+ * enqueued requests. Taking it is a lookup in the vpu ion client instead
+ * of an fd import.
+ *
+ * Lock order: user->data_mutex, ring->lock, ring->done_lock.
+ */
+
+/* request_id of a ring request, the lower word is the job id */
+#define VPU_RING_REQ_TAG	0x52494E47ULL
+#define VPU_RING_REQ_ID(id)	((VPU_RING_REQ_TAG << 32) | (uint32_t)(id))
+#define VPU_RING_DRAIN_MS	3000
+
+struct vpu_ring_reg {
+	struct dma_buf *dmabuf;
+	struct ion_handle *handle;
+	void *va;		/* kernel mapping, cpu backend only */
+	size_t size;
+};
+
+struct vpu_ring_job {
+	struct vpu_request *req;
+	struct vpu_ring_job *next;	/* chained to this job */
+	struct list_head link;
+	int id;
+	uint64_t user_data;
+	uint16_t cpu_buf[VPU_RING_MAX_PORTS];
+};
+
+struct vpu_ring {
+	struct vpu_user *user;
+	void *mem;
+	size_t size;
+	struct vpu_ring_ctrl *ctrl;
+	struct vpu_ring_sqe *sqes;
+	struct vpu_ring_cqe *cqes;
+	uint32_t sq_entries;
+	uint32_t cq_entries;
+	uint32_t sq_head;
+	uint32_t cq_tail;
+	bool cpu;
+	struct eventfd_ctx *efd;
+
+	/* submission, job chains, cqes and registered buffers */
+	struct mutex lock;
+	struct vpu_ring_reg regs[VPU_RING_MAX_BUFS];
+	struct vpu_ring_job *last;	/* last job submitted, if not retired */
+	bool last_failed;
+	unsigned int nr_inflight;
+
+	/* job ids and finished jobs */
+	spinlock_t done_lock;
+	struct idr jobs;
+	struct list_head done_list;
+	struct list_head cpu_list;
+	struct work_struct done_work;
+	struct work_struct cpu_work;
+	wait_queue_head_t cq_wait;
+
+	uint64_t nr_submit;
+	uint64_t nr_complete;
+	uint64_t nr_flush;
+	uint64_t nr_signal;
+	uint32_t max_batch;
+};
+
+static struct vpu_ring *vpu_ring_of(struct vpu_user *user)
+{
+	struct vpu_ring *ring;
+
+	mutex_lock(&user->data_mutex);
+	ring = user->ring;
+	mutex_unlock(&user->data_mutex);
+
+	return ring;
+}
+
+static void vpu_ring_put_reg(struct vpu_ring_reg *reg)
+{
+	if (!reg->handle)
+		return;
+
+	if (reg->va)
+		ion_unmap_kernel(my_ion_client, reg->handle);
+	ion_free(my_ion_client, reg->handle);
+	dma_buf_put(reg->dmabuf);
+	memset(reg, 0, sizeof(*reg));
+}
+
+static bool vpu_ring_reg_valid(struct vpu_ring *ring, uint16_t index)
+{
+	return index < VPU_RING_MAX_BUFS && ring->regs[index].handle;
+}
+
+static uint64_t vpu_ring_get_handle(struct vpu_ring *ring, uint16_t index)
+{
+	struct ion_handle *handle;
+
+	handle = ion_import_dma_buf(my_ion_client, ring->regs[index].dmabuf);
+	if (IS_ERR(handle))
+		return 0;
+
+	return (uint64_t)(uintptr_t)handle;
+}
+
+/* drops the ion references of a request that does not reach the vpu */
+static void vpu_ring_put_bufs(struct vpu_request *req)
+{
+	int i;
+
+	for (i = 0; i < VPU_MAX_NUM_PORTS * 3; i++) {
+		if (!req->buf_ion_infos[i])
+			continue;
+		ion_free(my_ion_client,
+			 (struct ion_handle *)(uintptr_t)req->buf_ion_infos[i]);
+		req->buf_ion_infos[i] = 0;
+	}
+
+	if (req->sett.sett_ion_fd) {
+		ion_free(my_ion_client,
+			 (struct ion_handle *)(uintptr_t)req->sett.sett_ion_fd);
+		req->sett.sett_ion_fd = 0;
+	}
+}
+
+/*
+ * Fills the request of job from a sqe. The sqe is shared with user space,
+ * so each field is read once and only the copy is checked.
+ */
+static uint8_t vpu_ring_build(struct vpu_ring *ring,
+	struct vpu_ring_sqe *sqe, struct vpu_ring_job *job)
+{
+	struct vpu_request *req = job->req;
+	unsigned int req_core;
+	uint16_t index;
+	uint8_t boost;
+	int i, j, cnt = 0;
+
+	job->user_data = READ_ONCE(sqe->user_data);
+	req->user_id = (unsigned long *)ring->user;
+	req->request_id = VPU_RING_REQ_ID(job->id);
+	req->requested_core = READ_ONCE(sqe->requested_core);
+	memcpy(req->algo_id, sqe->algo_id, sizeof(req->algo_id));
+	req->frame_magic = READ_ONCE(sqe->frame_magic);
+	req->priority = READ_ONCE(sqe->priority);
+	req->priv = READ_ONCE(sqe->priv);
+	req->sett.sett_lens = READ_ONCE(sqe->sett_lens);
+	req->sett.sett_ptr = READ_ONCE(sqe->sett_ptr);
+	req->buffer_count = READ_ONCE(sqe->buffer_count);
+
+	boost = READ_ONCE(sqe->boost_value);
+	req->power_param.boost_value = boost;
+	if (boost <= 100) {
+		req->power_param.opp_step = vpu_boost_value_to_opp(boost);
+		req->power_param.freq_step = vpu_boost_value_to_opp(boost);
+	} else {
+		req->power_param.opp_step = VPU_POWER_OPP_UNREQUEST;
+		req->power_param.freq_step = VPU_POWER_OPP_UNREQUEST;
+	}
+
+	/* no trylock, the ring never fails a submission for a busy vpu */
+	req_core = req->requested_core & VPU_CORE_COMMON;
+	if (req_core == VPU_TRYLOCK_CORENUM ||
+	    (req_core != VPU_CORE_COMMON && req_core > VPU_MAX_NUM_CORES))
+		return VPU_REQ_STATUS_INVALID;
+
+	if (req->priority >= VPU_REQ_MAX_NUM_PRIORITY ||
+	    req->buffer_count > VPU_RING_MAX_PORTS)
+		return VPU_REQ_STATUS_INVALID;
+
+	memcpy(req->buffers, sqe->buffers,
+	       req->buffer_count * sizeof(struct vpu_buffer));
+
+	for (i = 0; i < req->buffer_count; i++) {
+		if (req->buffers[i].plane_count > 3)
+			return VPU_REQ_STATUS_INVALID;
+
+		for (j = 0; j < req->buffers[i].plane_count; j++) {
+			index = READ_ONCE(sqe->plane_buf[i][j]);
+			if (!vpu_ring_reg_valid(ring, index))
+				return VPU_REQ_STATUS_INVALID;
+
+			if (ring->cpu) {
+				if (j == 0)
+					job->cpu_buf[i] = index;
+				continue;
+			}
+
+			req->buf_ion_infos[cnt] = vpu_ring_get_handle(ring,
+								      index);
+			if (!req->buf_ion_infos[cnt])
+				return VPU_REQ_STATUS_FAILURE;
+			cnt++;
+		}
+	}
+
+	index = READ_ONCE(sqe->sett_buf);
+	if (index != VPU_RING_NO_BUF) {
+		if (!vpu_ring_reg_valid(ring, index))
+			return VPU_REQ_STATUS_INVALID;
+		if (!ring->cpu) {
+			req->sett.sett_ion_fd = vpu_ring_get_handle(ring,
+								    index);
+			if (!req->sett.sett_ion_fd)
+				return VPU_REQ_STATUS_FAILURE;
+		}
+	}
+
+	return VPU_REQ_STATUS_SUCCESS;
+}
+
+/* space in the cq not yet promised to a job */
+static uint32_t vpu_ring_cq_space(struct vpu_ring *ring)
+{
+	uint32_t used;
+
+	used = ring->cq_tail - smp_load_acquire(&ring->ctrl->cq_head);
+	if (used > ring->cq_entries)
+		return 0;
+
+	used += ring->nr_inflight;
+	return used < ring->cq_entries ? ring->cq_entries - used : 0;
+}
+
+static uint32_t vpu_ring_cq_ready(struct vpu_ring *ring)
+{
+	return READ_ONCE(ring->cq_tail) - READ_ONCE(ring->ctrl->cq_head);
+}
+
+static void vpu_ring_post(struct vpu_ring *ring, struct vpu_ring_job *job)
+{
+	struct vpu_ring_ctrl *ctrl = ring->ctrl;
+	struct vpu_request *req = job->req;
+	struct vpu_ring_cqe *cqe;
+
+	/* only a user moving cq_head past cq_tail gets here */
+	if (ring->cq_tail - READ_ONCE(ctrl->cq_head) >= ring->cq_entries) {
+		WRITE_ONCE(ctrl->cq_overflow, ctrl->cq_overflow + 1);
+		return;
+	}
+
+	cqe = &ring->cqes[ring->cq_tail & (ring->cq_entries - 1)];
+	cqe->user_data = job->user_data;
+	cqe->busy_time = req->busy_time;
+	cqe->frame_magic = req->frame_magic;
+	cqe->occupied_core = req->occupied_core;
+	cqe->bandwidth = req->bandwidth;
+	cqe->status = req->status;
+
+	/* the cqe has to be visible before the tail covering it */
+	ring->cq_tail++;
+	smp_store_release(&ctrl->cq_tail, ring->cq_tail);
+	ring->nr_complete++;
+}
+
+static void vpu_ring_notify(struct vpu_ring *ring)
+{
+	if (ring->efd)
+		eventfd_signal(ring->efd, 1);
+	wake_up_all(&ring->cq_wait);
+}
+
+static void vpu_ring_add_done(struct vpu_ring *ring, struct vpu_ring_job *job)
+{
+	spin_lock(&ring->done_lock);
+	list_add_tail(&job->link, &ring->done_list);
+	spin_unlock(&ring->done_lock);
+
+	queue_work(system_highpri_wq, &ring->done_work);
+}
+
+static void vpu_ring_dispatch(struct vpu_ring *ring, struct vpu_ring_job *job)
+{
+	if (ring->cpu) {
+		spin_lock(&ring->done_lock);
+		list_add_tail(&job->link, &ring->cpu_list);
+		spin_unlock(&ring->done_lock);
+
+		queue_work(system_unbound_wq, &ring->cpu_work);
+		return;
+	}
+
+	if (!vpu_dispatch_request_to_pool(job->req))
+		return;
+
+	LOG_ERR("[vpu] ring request 0x%llx not queued\n",
+		job->req->request_id);
+	vpu_ring_put_bufs(job->req);
+	job->req->status = VPU_REQ_STATUS_FAILURE;
+	vpu_ring_add_done(ring, job);
+}
+
+static void vpu_ring_free_job(struct vpu_ring *ring, struct vpu_ring_job *job)
+{
+	spin_lock(&ring->done_lock);
+	idr_remove(&ring->jobs, job->id);
+	spin_unlock(&ring->done_lock);
+
+	vpu_free_request(job->req);
+	kfree(job);
+	ring->nr_inflight--;
+}
+
+/*
+ * Posts the cqe of a finished job and frees it. The job chained to it
+ * starts if it succeeded, else the rest of the chain is flushed.
+ * Returns the number of cqes posted.
+ */
+static unsigned int vpu_ring_retire(struct vpu_ring *ring,
+	struct vpu_ring_job *job)
+{
+	struct vpu_ring_job *next;
+	unsigned int posted = 0;
+	bool ok;
+
+	while (job) {
+		next = job->next;
+		ok = job->req->status == VPU_REQ_STATUS_SUCCESS;
+
+		vpu_ring_post(ring, job);
+		posted++;
+		if (ring->last == job) {
+			ring->last = NULL;
+			ring->last_failed = !ok;
+		}
+		vpu_ring_free_job(ring, job);
+
+		if (!next)
+			break;
+		if (ok) {
+			vpu_ring_dispatch(ring, next);
+			break;
+		}
+
+		vpu_ring_put_bufs(next->req);
+		next->req->status = VPU_REQ_STATUS_FLUSH;
+		ring->nr_flush++;
+		job = next;
+	}
+
+	return posted;
+}
+
+static void vpu_ring_done_work(struct work_struct *work)
+{
+	struct vpu_ring *ring = container_of(work, struct vpu_ring, done_work);
+	struct vpu_ring_job *job, *tmp;
+	unsigned int posted = 0;
+	LIST_HEAD(done);
+
+	spin_lock(&ring->done_lock);
+	list_splice_init(&ring->done_list, &done);
+	spin_unlock(&ring->done_lock);
+
+	mutex_lock(&ring->lock);
+	list_for_each_entry_safe(job, tmp, &done, link) {
+		list_del(&job->link);
+		posted += vpu_ring_retire(ring, job);
+	}
+	if (posted) {
+		ring->nr_signal++;
+		ring->max_batch = max_t(uint32_t, ring->max_batch, posted);
+	}
+	mutex_unlock(&ring->lock);
+
+	if (posted)
+		vpu_ring_notify(ring);
+}
+
+/*------------------------cpu backend------------------------*/
+
+static uint8_t *vpu_ring_cpu_plane(struct vpu_ring *ring,
+	struct vpu_ring_job *job, int port, uint32_t *len)
+{
+	struct vpu_buffer *buf = &job->req->buffers[port];
+	struct vpu_ring_reg *reg = &ring->regs[job->cpu_buf[port]];
+	struct vpu_plane *plane = &buf->planes[0];
+
+	if (!buf->plane_count || !reg->va || plane->ptr > reg->size ||
+	    plane->length > reg->size - plane->ptr)
+		return NULL;
+
+	*len = plane->length;
+	return (uint8_t *)reg->va + plane->ptr;
+}
+
+static uint8_t vpu_ring_cpu_run(struct vpu_ring *ring,
+	struct vpu_ring_job *job)
+{
+	struct vpu_request *req = job->req;
+	int nr_in = req->buffer_count - 1;
+	uint8_t *in[2], *out;
+	uint32_t len, in_len, k;
+	int i;
+
+	if (nr_in < 1 || nr_in > 2)
+		return VPU_REQ_STATUS_INVALID;
+
+	out = vpu_ring_cpu_plane(ring, job, nr_in, &len);
+	if (!out)
+		return VPU_REQ_STATUS_INVALID;
+
+	for (i = 0; i < nr_in; i++) {
+		in[i] = vpu_ring_cpu_plane(ring, job, i, &in_len);
+		if (!in[i] || in_len != len)
+			return VPU_REQ_STATUS_INVALID;
+	}
+
+	switch (req->algo_id[0]) {
+	case VPU_RING_CPU_COPY:
+		if (nr_in != 1)
+			return VPU_REQ_STATUS_INVALID;
+		memmove(out, in[0], len);
+		break;
+	case VPU_RING_CPU_INVERT:
+		if (nr_in != 1)
+			return VPU_REQ_STATUS_INVALID;
+		for (k = 0; k < len; k++)
+			out[k] = 0xff - in[0][k];
+		break;
+	case VPU_RING_CPU_ADD:
+		if (nr_in != 2)
+			return VPU_REQ_STATUS_INVALID;
+		for (k = 0; k < len; k++)
+			out[k] = min_t(unsigned int, in[0][k] + in[1][k], 0xff);
+		break;
+	default:
+		return VPU_REQ_STATUS_INVALID;
+	}
+
+	return VPU_REQ_STATUS_SUCCESS;
+}
+
+static void vpu_ring_cpu_work(struct work_struct *work)
+{
+	struct vpu_ring *ring = container_of(work, struct vpu_ring, cpu_work);
+	struct vpu_ring_job *job;
+	ktime_t start;
+	LIST_HEAD(todo);
+
+	spin_lock(&ring->done_lock);
+	list_splice_init(&ring->cpu_list, &todo);
+	spin_unlock(&ring->done_lock);
+
+	if (list_empty(&todo))
+		return;
+
+	list_for_each_entry(job, &todo, link) {
+		start = ktime_get();
+		job->req->status = vpu_ring_cpu_run(ring, job);
+		job->req->busy_time = ktime_to_ns(ktime_sub(ktime_get(),
+							    start));
+	}
+
+	spin_lock(&ring->done_lock);
+	list_splice_tail(&todo, &ring->done_list);
+	spin_unlock(&ring->done_lock);
+
+	queue_work(system_highpri_wq, &ring->done_work);
+}
+
+/*------------------------submission------------------------*/
+
+/*
+ * Turns one sqe into a job. Returns the number of cqes posted right away,
+ * for a sqe that is rejected or flushed, or a negative error if the sqe
+ * could not be consumed.
+ */
+static int vpu_ring_submit(struct vpu_ring *ring, struct vpu_ring_sqe *sqe)
+{
+	struct vpu_ring_job *job, *prev;
+	uint32_t flags = READ_ONCE(sqe->flags);
+	uint8_t status;
+	int id;
+
+	job = kzalloc(sizeof(*job), GFP_KERNEL);
+	if (!job)
+		return -ENOMEM;
+
+	if (vpu_alloc_request(&job->req)) {
+		kfree(job);
+		return -ENOMEM;
+	}
+
+	idr_preload(GFP_KERNEL);
+	spin_lock(&ring->done_lock);
+	id = idr_alloc_cyclic(&ring->jobs, job, 0, 0, GFP_NOWAIT);
+	spin_unlock(&ring->done_lock);
+	idr_preload_end();
+	if (id < 0) {
+		vpu_free_request(job->req);
+		kfree(job);
+		return id;
+	}
+
+	job->id = id;
+	ring->nr_inflight++;
+	ring->nr_submit++;
+
+	prev = ring->last;
+	ring->last = job;
+
+	status = vpu_ring_build(ring, sqe, job);
+	if (status != VPU_REQ_STATUS_SUCCESS) {
+		LOG_WRN("[vpu] ring sqe 0x%llx rejected, status %d\n",
+			job->user_data, status);
+		goto retire;
+	}
+
+	if (flags & VPU_RING_SQE_CHAIN) {
+		if (prev) {
+			prev->next = job;
+			return 0;
+		}
+		if (ring->last_failed) {
+			status = VPU_REQ_STATUS_FLUSH;
+			ring->nr_flush++;
+			goto retire;
+		}
+	}
+
+	vpu_ring_dispatch(ring, job);
+	return 0;
+
+retire:
+	vpu_ring_put_bufs(job->req);
+	job->req->status = status;
+	return vpu_ring_retire(ring, job);
+}
+
+int vpu_ring_enter(struct vpu_user *user, struct vpu_ring_enter *enter)
+{
+	struct vpu_ring *ring = vpu_ring_of(user);
+	uint32_t tail, nr, want;
+	unsigned int posted = 0;
+	int ret = 0;
+
+	enter->submitted = 0;
+	if (!ring)
+		return -EINVAL;
+
+	mutex_lock(&ring->lock);
+	tail = smp_load_acquire(&ring->ctrl->sq_tail);
+	if (tail - ring->sq_head > ring->sq_entries) {
+		mutex_unlock(&ring->lock);
+		return -EINVAL;
+	}
+
+	nr = min(enter->to_submit, tail - ring->sq_head);
+	nr = min(nr, vpu_ring_cq_space(ring));
+	while (enter->submitted < nr) {
+		ret = vpu_ring_submit(ring,
+			&ring->sqes[ring->sq_head & (ring->sq_entries - 1)]);
+		if (ret < 0)
+			break;
+		posted += ret;
+		ring->sq_head++;
+		enter->submitted++;
+	}
+	/* the sqes are read before user space may reuse them */
+	smp_store_release(&ring->ctrl->sq_head, ring->sq_head);
+	if (posted)
+		ring->nr_signal++;
+	mutex_unlock(&ring->lock);
+
+	if (posted)
+		vpu_ring_notify(ring);
+
+	if (ret < 0 && !enter->submitted)
+		return ret;
+
+	if (!enter->min_complete)
+		return 0;
+
+	want = min(enter->min_complete, ring->cq_entries);
+	ret = wait_event_interruptible(ring->cq_wait,
+			vpu_ring_cq_ready(ring) >= want ||
+			!READ_ONCE(ring->nr_inflight));
+
+	return ret ? -EINTR : 0;
+}
+
+/*------------------------setup------------------------*/
+
+int vpu_ring_setup(struct vpu_user *user, struct vpu_ring_setup *setup)
+{
+	struct vpu_ring *ring;
+	uint32_t sq, cq, sq_off, cq_off;
+	int ret;
+
+	if (!setup->sq_entries || setup->sq_entries > VPU_RING_MAX_ENTRIES ||
+	    setup->cq_entries > 2 * VPU_RING_MAX_ENTRIES)
+		return -EINVAL;
+
+	sq = roundup_pow_of_two(setup->sq_entries);
+	cq = setup->cq_entries ? roundup_pow_of_two(setup->cq_entries) : 2 * sq;
+	if (cq < sq)
+		return -EINVAL;
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	sq_off = ALIGN(sizeof(struct vpu_ring_ctrl), SMP_CACHE_BYTES);
+	cq_off = ALIGN(sq_off + sq * sizeof(struct vpu_ring_sqe),
+		       SMP_CACHE_BYTES);
+	ring->size = PAGE_ALIGN(cq_off + cq * sizeof(struct vpu_ring_cqe));
+	ring->mem = vmalloc_user(ring->size);
+	if (!ring->mem) {
+		ret = -ENOMEM;
+		goto err_free;
+	}
+
+	if (setup->eventfd >= 0) {
+		ring->efd = eventfd_ctx_fdget(setup->eventfd);
+		if (IS_ERR(ring->efd)) {
+			ret = PTR_ERR(ring->efd);
+			goto err_vfree;
+		}
+	}
+
+	ring->ctrl = ring->mem;
+	ring->sqes = ring->mem + sq_off;
+	ring->cqes = ring->mem + cq_off;
+	ring->ctrl->sq_entries = sq;
+	ring->ctrl->cq_entries = cq;
+	ring->ctrl->sq_off = sq_off;
+	ring->ctrl->cq_off = cq_off;
+	ring->sq_entries = sq;
+	ring->cq_entries = cq;
+	ring->cpu = g_vpu_ring_cpu;
+	ring->user = user;
+
+	mutex_init(&ring->lock);
+	spin_lock_init(&ring->done_lock);
+	idr_init(&ring->jobs);
+	INIT_LIST_HEAD(&ring->done_list);
+	INIT_LIST_HEAD(&ring->cpu_list);
+	INIT_WORK(&ring->done_work, vpu_ring_done_work);
+	INIT_WORK(&ring->cpu_work, vpu_ring_cpu_work);
+	init_waitqueue_head(&ring->cq_wait);
+
+	if (!my_ion_client)
+		my_ion_client = ion_client_create(g_ion_device, "vpu_drv");
+
+	mutex_lock(&user->data_mutex);
+	if (user->ring || user->deleting) {
+		mutex_unlock(&user->data_mutex);
+		ret = -EBUSY;
+		goto err_efd;
+	}
+	user->ring = ring;
+	mutex_unlock(&user->data_mutex);
+
+	setup->sq_entries = sq;
+	setup->cq_entries = cq;
+	setup->mmap_size = ring->size;
+
+	LOG_INF("[vpu] user 0x%lx ring sq(%u) cq(%u) size(0x%zx)%s\n",
+		(unsigned long)user->id, sq, cq, ring->size,
+		ring->cpu ? " on cpu" : "");
+
+	return 0;
+
+err_efd:
+	if (ring->efd)
+		eventfd_ctx_put(ring->efd);
+err_vfree:
+	vfree(ring->mem);
+err_free:
+	kfree(ring);
+	return ret;
+}
+
+int vpu_ring_reg_buf(struct vpu_user *user, struct vpu_ring_buf *buf)
+{
+	struct vpu_ring *ring = vpu_ring_of(user);
+	struct vpu_ring_reg reg = { 0 };
+	struct vpu_ring_reg old;
+	int ret;
+
+	if (!ring || buf->index >= VPU_RING_MAX_BUFS)
+		return -EINVAL;
+
+	if (buf->fd >= 0) {
+		reg.dmabuf = dma_buf_get(buf->fd);
+		if (IS_ERR(reg.dmabuf))
+			return PTR_ERR(reg.dmabuf);
+
+		reg.handle = ion_import_dma_buf(my_ion_client, reg.dmabuf);
+		if (IS_ERR(reg.handle)) {
+			ret = PTR_ERR(reg.handle);
+			dma_buf_put(reg.dmabuf);
+			return ret;
+		}
+		reg.size = reg.dmabuf->size;
+
+		if (ring->cpu) {
+			reg.va = ion_map_kernel(my_ion_client, reg.handle);
+			if (IS_ERR(reg.va)) {
+				ret = PTR_ERR(reg.va);
+				reg.va = NULL;
+				vpu_ring_put_reg(&reg);
+				return ret;
+			}
+		}
+	}
+
+	/* the cpu backend reads the buffers without references */
+	mutex_lock(&ring->lock);
+	if (ring->nr_inflight) {
+		mutex_unlock(&ring->lock);
+		vpu_ring_put_reg(&reg);
+		return -EBUSY;
+	}
+	old = ring->regs[buf->index];
+	ring->regs[buf->index] = reg;
+	mutex_unlock(&ring->lock);
+
+	vpu_ring_put_reg(&old);
+	return 0;
+}
+
+int vpu_ring_mmap(struct vpu_user *user, struct vm_area_struct *vma)
+{
+	struct vpu_ring *ring = vpu_ring_of(user);
+
+	/* the whole ring from its start, the layout has no other entry */
+	if (vma->vm_pgoff != (VPU_RING_MMAP_OFFSET >> PAGE_SHIFT))
+		return -EINVAL;
+	if (!ring || vma->vm_end - vma->vm_start > ring->size)
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, ring->mem, 0);
+}
+
+bool vpu_ring_complete(struct vpu_user *user, struct vpu_request *req)
+{
+	struct vpu_ring *ring = READ_ONCE(user->ring);
+	struct vpu_ring_job *job;
+
+	/* setup and release change user->ring under it */
+	lockdep_assert_held(&user->data_mutex);
+
+	if (!ring || (req->request_id >> 32) != VPU_RING_REQ_TAG)
+		return false;
+
+	spin_lock(&ring->done_lock);
+	job = idr_find(&ring->jobs, (uint32_t)req->request_id);
+	if (!job || job->req != req) {
+		spin_unlock(&ring->done_lock);
+		return false;
+	}
+	list_add_tail(&job->link, &ring->done_list);
+	spin_unlock(&ring->done_lock);
+
+	queue_work(system_highpri_wq, &ring->done_work);
+	return true;
+}
+
+void vpu_ring_release(struct vpu_user *user)
+{
+	struct vpu_ring *ring = vpu_ring_of(user);
+	int i;
+
+	if (!ring)
+		return;
+
+	if (!wait_event_timeout(ring->cq_wait, !READ_ONCE(ring->nr_inflight),
+				msecs_to_jiffies(VPU_RING_DRAIN_MS))) {
+		LOG_ERR("[vpu] user 0x%lx ring still has %d requests, leak\n",
+			(unsigned long)user->id, READ_ONCE(ring->nr_inflight));
+		mutex_lock(&user->data_mutex);
+		user->ring = NULL;
+		mutex_unlock(&user->data_mutex);
+		return;
+	}
+
+	mutex_lock(&user->data_mutex);
+	user->ring = NULL;
+	mutex_unlock(&user->data_mutex);
+
+	flush_work(&ring->done_work);
+	flush_work(&ring->cpu_work);
+
+	for (i = 0; i < VPU_RING_MAX_BUFS; i++)
+		vpu_ring_put_reg(&ring->regs[i]);
+	if (ring->efd)
+		eventfd_ctx_put(ring->efd);
+	idr_destroy(&ring->jobs);
+	vfree(ring->mem);
+	kfree(ring);
+}
+
+void vpu_ring_dump(struct seq_file *s, struct vpu_user *user)
+{
+	struct vpu_ring *ring;
+
+	mutex_lock(&user->data_mutex);
+	ring = user->ring;
+	if (ring)
+		vpu_print_seq(s,
+			"user 0x%lx%s: sq %u cq %u inflight %u submit %llu complete %llu flush %llu signal %llu max_batch %u overflow %u\n",
+			(unsigned long)user->id, ring->cpu ? "(cpu)" : "",
+			ring->sq_entries, ring->cq_entries, ring->nr_inflight,
+			ring->nr_submit, ring->nr_complete, ring->nr_flush,
+			ring->nr_signal, ring->max_batch,
+			READ_ONCE(ring->ctrl->cq_overflow));
+	mutex_unlock(&user->data_mutex);
+}
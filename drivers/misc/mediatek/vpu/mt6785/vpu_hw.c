@@ -2889,8 +2889,6 @@ for (j = 0 ; j < req->buffers[i].plane_count ; j++) { \
 			LOG_DBG("[vpu] flag - 6: add to deque list\n");
 
 			req->occupied_core = (0x1 << service_core);
-			list_add_tail(vlist_link(req, struct vpu_request),
-						&user->deque_list);
 
 			LOG_INF("[vpu_%d, 0x%x->0x%x] %s(%d_%d), st(%d) %s\n",
 				service_core,
@@ -2900,6 +2898,12 @@ for (j = 0 ; j < req->buffers[i].plane_count ; j++) { \
 				req->status,
 				"add to deque list done");
 
+			/* a ring request is completed through its ring */
+			if (!vpu_ring_complete(user, req))
+				list_add_tail(vlist_link(req,
+						struct vpu_request),
+						&user->deque_list);
+
 			user->running[service_core] = false;
 			mutex_unlock(&user->data_mutex);
 			wake_up_interruptible_all(&user->deque_wait);
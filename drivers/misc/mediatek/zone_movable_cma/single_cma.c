@@ -14,13 +14,16 @@
 #define CONFIG_MTK_ZONE_MOVABLE_CMA_DEBUG
 
 #include <linux/types.h>
+#include <linux/export.h>
 #include <linux/of.h>
 #include <linux/mm.h>
 #include <linux/of_reserved_mem.h>
 #include <linux/cma.h>
 #include <linux/printk.h>
 #include <linux/memblock.h>
+#include <linux/mutex.h>
 #include <linux/page-isolation.h>
+#include <linux/slab.h>
 
 #include "mt-plat/mtk_meminfo.h"
 #include "single_cma.h"
@@ -38,6 +41,16 @@ phys_addr_t zmc_max_zone_dma_phys = 0x100000000ULL;
 
 bool zmc_reserved_mem_inited;
 
+/* Windows handed out by zmc_cma_alloc(), to predict the next one */
+struct zmc_range {
+	struct list_head list;
+	struct cma *cma;
+	unsigned long pfn;
+	unsigned long count;
+};
+static LIST_HEAD(zmc_ranges);
+static DEFINE_MUTEX(zmc_ranges_lock);
+
 #define END_OF_REGISTER ((void *)(0x7a6d63))
 enum ZMC_ZONE_ORDER {
 	ZMC_LOCATE_MOVABLE,
@@ -256,6 +269,20 @@ bool is_zmc_inited(void)
 {
 	return zmc_reserved_mem_inited;
 }
+EXPORT_SYMBOL(is_zmc_inited);
+
+int zmc_for_each_cma(int (*it)(struct cma *area, void *data), void *data)
+{
+	int i, ret;
+
+	for (i = 0; i < MAX_CMA_AREAS && cma[i]; i++) {
+		ret = it(cma[i], data);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
 
 void zmc_get_range(phys_addr_t *base, phys_addr_t *size)
 {
@@ -300,7 +327,7 @@ static bool system_mem_status_ok(unsigned long count)
 	return true;
 }
 
-static bool zmc_check_mem_status_ok(unsigned long count)
+bool zmc_check_mem_status_ok(unsigned long count)
 {
 	struct pglist_data *pgdat;
 	struct zone *z;
@@ -336,12 +363,112 @@ static bool zmc_check_mem_status_ok(unsigned long count)
 	return system_mem_status_ok(count);
 }
 
-struct page *zmc_cma_alloc(struct cma *cma, int count,
+static void zmc_range_add(struct cma *cma, struct page *page,
+		unsigned long count)
+{
+	struct zmc_range *r = kmalloc(sizeof(*r), GFP_KERNEL);
+
+	/* only costs a wrong prediction */
+	if (!r)
+		return;
+
+	r->cma = cma;
+	r->pfn = page_to_pfn(page);
+	r->count = count;
+	mutex_lock(&zmc_ranges_lock);
+	list_add(&r->list, &zmc_ranges);
+	mutex_unlock(&zmc_ranges_lock);
+}
+
+static void zmc_range_del(struct cma *cma, struct page *page)
+{
+	unsigned long pfn = page_to_pfn(page);
+	struct zmc_range *r;
+
+	mutex_lock(&zmc_ranges_lock);
+	list_for_each_entry(r, &zmc_ranges, list) {
+		if (r->cma == cma && r->pfn == pfn) {
+			list_del(&r->list);
+			kfree(r);
+			break;
+		}
+	}
+	mutex_unlock(&zmc_ranges_lock);
+}
+
+/*
+ * First fit like cma_alloc() over the windows handed out so far. Assumes
+ * every allocation from @cma goes through zmc_cma_alloc().
+ */
+bool zmc_predict_pfn(struct cma *cma, unsigned long count,
+		unsigned int align, unsigned long *pfn)
+{
+	unsigned long base = PFN_DOWN(cma_get_base(cma));
+	unsigned long end = base + (cma_get_size(cma) >> PAGE_SHIFT);
+	unsigned long start;
+	struct zmc_range *r;
+	bool moved;
+
+#ifdef CONFIG_CMA_ALIGNMENT
+	if (align > CONFIG_CMA_ALIGNMENT)
+		align = CONFIG_CMA_ALIGNMENT;
+#endif
+	start = ALIGN(base, 1UL << align);
+
+	mutex_lock(&zmc_ranges_lock);
+	do {
+		moved = false;
+		list_for_each_entry(r, &zmc_ranges, list) {
+			if (r->cma != cma)
+				continue;
+			if (start < r->pfn + r->count &&
+			    r->pfn < start + count) {
+				start = ALIGN(r->pfn + r->count, 1UL << align);
+				moved = true;
+			}
+		}
+	} while (moved && start + count <= end);
+	mutex_unlock(&zmc_ranges_lock);
+
+	if (start + count > end)
+		return false;
+
+	*pfn = start;
+	return true;
+}
+
+static struct page *__zmc_cma_alloc(struct cma *cma, int count,
 		unsigned int align, struct single_cma_registration *p)
 {
 #ifdef CONFIG_ARCH_MT6757
 	struct page *candidate, *abandon = NULL;
+
+#define ABANDON_PFN	(0xc0000)
+retry:
+	candidate = cma_alloc(cma, count, align, GFP_KERNEL);
+
+	if (abandon != NULL)
+		cma_release(cma, abandon, count);
+
+	if (p->prio == ZMC_SSMR &&
+			candidate != NULL &&
+			page_to_pfn(candidate) == ABANDON_PFN) {
+		abandon = candidate;
+		pr_debug("%s %p is abandoned\n", __func__, candidate);
+		goto retry;
+	}
+
+	return candidate;
+#else
+	return cma_alloc(cma, count, align, GFP_KERNEL);
 #endif
+}
+
+struct page *zmc_cma_alloc(struct cma *cma, int count,
+		unsigned int align, struct single_cma_registration *p)
+{
+	unsigned long predicted;
+	struct page *page;
 
 	/* Check current memory status before proceeding */
 	if (p->prio >= ZMC_CHECK_MEM_STAT && !zmc_check_mem_status_ok(count)) {
@@ -361,29 +488,23 @@ struct page *zmc_cma_alloc(struct cma *cma, int count,
 	 */
 	if (!cma_alloc_range_ok(cma, count, align)) {
 		pr_debug("No more space in zone movable cma\n");
+		zmc_prefetch_cancel(cma);
 		return NULL;
 	}
 
-#ifdef CONFIG_ARCH_MT6757
-#define ABANDON_PFN	(0xc0000)
-retry:
-	candidate = cma_alloc(cma, count, align, GFP_KERNEL);
+	/* Let a pre-migrated window go right before taking it */
+	predicted = zmc_prefetch_claim(cma, count, align);
+	page = __zmc_cma_alloc(cma, count, align, p);
+	zmc_prefetch_account(predicted, page);
 
-	if (abandon != NULL)
-		cma_release(cma, abandon, count);
+	if (page)
+		zmc_range_add(cma, page, count);
+	else
+		zmc_intrusion_failed(cma, PFN_DOWN(cma_get_base(cma)),
+				cma_get_size(cma) >> PAGE_SHIFT,
+				__builtin_return_address(0));
 
-	if (p->prio == ZMC_SSMR &&
-			candidate != NULL &&
-			page_to_pfn(candidate) == ABANDON_PFN) {
-		abandon = candidate;
-		pr_debug("%s %p is abandoned\n", __func__, candidate);
-		goto retry;
-	}
-
-	return candidate;
-#else
-	return cma_alloc(cma, count, align, GFP_KERNEL);
-#endif
+	return page;
 }
 
 bool zmc_cma_release(struct cma *cma, struct page *pages, int count)
@@ -391,6 +512,9 @@ bool zmc_cma_release(struct cma *cma, struct page *pages, int count)
 	if (!zmc_reserved_mem_inited)
 		return cma_release(cma, pages, count);
 
+	if (pages)
+		zmc_range_del(cma, pages);
+
 	return cma_release(cma, pages, count);
 }
 
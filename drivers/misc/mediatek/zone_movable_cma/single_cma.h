@@ -18,4 +18,19 @@ phys_addr_t zmc_base(void);
 struct page *zmc_cma_alloc(struct cma *cma, int count, unsigned int align,
 					struct single_cma_registration *p);
 bool zmc_cma_release(struct cma *cma, struct page *pages, int count);
+
+int zmc_for_each_cma(int (*it)(struct cma *area, void *data), void *data);
+bool zmc_check_mem_status_ok(unsigned long count);
+bool zmc_predict_pfn(struct cma *cma, unsigned long count,
+		unsigned int align, unsigned long *pfn);
+
+/* zmc_prefetch.c */
+unsigned long zmc_prefetch_claim(struct cma *cma, unsigned long count,
+		unsigned int align);
+void zmc_prefetch_account(unsigned long predicted, struct page *page);
+void zmc_prefetch_cancel(struct cma *cma);
+
+/* zmc_placement.c */
+void zmc_intrusion_failed(struct cma *cma, unsigned long pfn,
+		unsigned long nr, const void *caller);
 #endif
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See http://www.gnu.org/licenses/gpl-2.0.html for more details.
+ */
+
+/*
+ * ZMC pre-migration test
+ *
+ * Times ssmr_offline() of one SSMR feature while zone movable cma is
+ * filled with shmem pages, once synchronously and once after
+ * ssmr_predict() had think_ms to evacuate the region, for a number of
+ * rounds. Also checks that a cancelled prediction gives everything back.
+ * Results go to the kernel log; loading always fails with -EAGAIN so the
+ * test can be run again without rmmod.
+ */
+
+#define pr_fmt(fmt) "zmc_prefetch_test: " fmt
+
+#include <linux/delay.h>
+#include <linux/file.h>
+#include <linux/fs.h>
+#include <linux/ktime.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/pagemap.h>
+#include <linux/shmem_fs.h>
+
+#include "mt-plat/mtk_meminfo.h"
+#include "memory_ssmr.h"
+
+static unsigned int feat;
+module_param(feat, uint, 0444);
+MODULE_PARM_DESC(feat, "SSMR feature to offline, see memory_ssmr.h");
+
+static unsigned int pressure_mb = 512;
+module_param(pressure_mb, uint, 0444);
+MODULE_PARM_DESC(pressure_mb, "Movable shmem pages to allocate per round");
+
+static unsigned int think_ms = 1000;
+module_param(think_ms, uint, 0444);
+MODULE_PARM_DESC(think_ms, "Time between ssmr_predict() and ssmr_offline()");
+
+static unsigned int rounds = 3;
+module_param(rounds, uint, 0444);
+MODULE_PARM_DESC(rounds, "Rounds per path");
+
+/* Fills a new shmem file, most of it lands in zone movable cma */
+static struct file *pressure_start(void)
+{
+	unsigned long i, nr = (unsigned long)pressure_mb << (20 - PAGE_SHIFT);
+	struct file *file;
+	struct page *page;
+
+	file = shmem_file_setup("zmc_prefetch_test", (loff_t)nr << PAGE_SHIFT,
+				VM_NORESERVE);
+	if (IS_ERR(file))
+		return file;
+
+	for (i = 0; i < nr; i++) {
+		page = shmem_read_mapping_page(file->f_mapping, i);
+		if (IS_ERR(page))
+			break;
+		set_page_dirty(page);
+		put_page(page);
+		if (fatal_signal_pending(current))
+			break;
+		cond_resched();
+	}
+
+	if (i < nr)
+		pr_info("pressure: %lu of %lu pages\n", i, nr);
+
+	return file;
+}
+
+/* Returns the offline time in us, negative on failure */
+static s64 acquire(bool predict, unsigned long *held, unsigned long *total)
+{
+	unsigned long size = 0;
+	struct file *file;
+	phys_addr_t pa;
+	ktime_t start;
+	s64 us;
+	int ret;
+
+	file = pressure_start();
+	if (IS_ERR(file))
+		return PTR_ERR(file);
+
+	*held = *total = 0;
+	if (predict) {
+		ret = ssmr_predict(feat);
+		if (ret) {
+			fput(file);
+			return ret;
+		}
+		msleep(think_ms);
+		zmc_prefetch_progress(held, total);
+	}
+
+	start = ktime_get();
+	ret = ssmr_offline(&pa, &size, true, feat);
+	us = ktime_us_delta(ktime_get(), start);
+
+	if (!ret)
+		ssmr_online(feat);
+	fput(file);
+
+	if (ret)
+		return ret;
+	if (!size)
+		return -ENOMEM;
+	return us;
+}
+
+static int run_path(bool predict)
+{
+	const char *name = predict ? "predicted" : "synchronous";
+	s64 us, sum = 0, worst = 0;
+	unsigned long held, total;
+	unsigned int i;
+
+	for (i = 0; i < rounds; i++) {
+		us = acquire(predict, &held, &total);
+		if (us < 0) {
+			pr_err("%s round %u: offline failed %lld\n", name, i, us);
+			return -EIO;
+		}
+		if (predict)
+			pr_info("%s round %u: %lld us, %lu/%lu pages evacuated after %u ms\n",
+				name, i, us, held, total, think_ms);
+		else
+			pr_info("%s round %u: %lld us\n", name, i, us);
+		sum += us;
+		worst = max(worst, us);
+	}
+
+	pr_info("%s: avg %lld us worst %lld us over %u rounds, %u MB pressure\n",
+		name, rounds ? sum / rounds : 0, worst, rounds, pressure_mb);
+
+	return 0;
+}
+
+/* A cancelled prediction must hold nothing afterwards */
+static int run_cancel(void)
+{
+	unsigned long held, total;
+	struct file *file;
+	int ret;
+
+	file = pressure_start();
+	if (IS_ERR(file))
+		return PTR_ERR(file);
+
+	ret = ssmr_predict(feat);
+	if (!ret) {
+		msleep(think_ms / 2);
+		zmc_prefetch_progress(&held, &total);
+		pr_info("cancel: %lu/%lu pages evacuated before cancel\n",
+			held, total);
+		ssmr_predict_cancel(feat);
+		zmc_prefetch_progress(&held, &total);
+		if (held || total) {
+			pr_err("cancel: still %lu/%lu pages held\n", held, total);
+			ret = -EIO;
+		}
+	}
+	fput(file);
+
+	return ret;
+}
+
+static int __init zmc_prefetch_test_init(void)
+{
+	int ret;
+
+	if (!is_zmc_inited()) {
+		pr_info("zone movable cma is not set up\n");
+		return -ENODEV;
+	}
+
+	ret = run_path(false);
+	if (!ret)
+		ret = run_path(true);
+	if (!ret)
+		ret = run_cancel();
+
+	pr_info("%s\n", ret ? "FAIL" : "PASS");
+
+	return -EAGAIN;
+}
+
+module_init(zmc_prefetch_test_init);
+
+MODULE_AUTHOR("Mediatek");
+MODULE_DESCRIPTION("zone movable cma pre-migration test");
+MODULE_LICENSE("GPL");
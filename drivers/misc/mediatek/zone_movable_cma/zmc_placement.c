@@ -0,0 +1,497 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See http://www.gnu.org/licenses/gpl-2.0.html for more details.
+ */
+
+/*
+ * ZMC placement policy and intrusion statistics
+ *
+ * Only allocations carrying __GFP_CMA may use zone movable cma. The sites
+ * in enum zmc_site ask zmc_cma_gfp() for it, and the sites set in
+ * cma_deny are refused, so pages that tend to be pinned for long land
+ * elsewhere.
+ *
+ * Pages that still make the ZMC areas expensive to evacuate are counted
+ * per area by scanning them: pinned ones (LRU pages with references
+ * beyond their mappings and page cache) and unmovable ones, attributed
+ * to an owner (anon, the file system of a page cache page, slab,
+ * reserved, ...). Every failed migration of a range is recorded with
+ * its requester, and the pages blocking it are added to the culprits
+ * of the area; the first of them are dumped with dump_page(), which
+ * shows the allocation stack when page_owner is enabled. Failures are
+ * scanned for at most the size of their area every ZMC_FAIL_SCAN_INTERVAL,
+ * so callers retrying a failed cma_alloc() do not scan the whole area
+ * under zmc_area_lock each time; the ones beyond that are only counted.
+ *
+ * debugfs/zmc_intrusion shows a fresh scan, "probe <pages> <tries>"
+ * times cma_alloc() of <pages> on every area <tries> times.
+ */
+#define pr_fmt(fmt) "zmc_placement: " fmt
+
+#include <linux/cma.h>
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/gfp.h>
+#include <linux/ktime.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/pagemap.h>
+#include <linux/ratelimit.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+
+#include "mt-plat/mtk_meminfo.h"
+#include "single_cma.h"
+
+unsigned long zmc_cma_deny = 1UL << ZMC_SITE_PIN_PRONE_CACHE;
+EXPORT_SYMBOL(zmc_cma_deny);
+module_param_named(cma_deny, zmc_cma_deny, ulong, 0644);
+MODULE_PARM_DESC(cma_deny, "Bitmask of enum zmc_site refused __GFP_CMA");
+
+enum zmc_kind {
+	ZMC_KIND_FREE,
+	ZMC_KIND_MOVABLE,
+	ZMC_KIND_PINNED,
+	ZMC_KIND_NONLRU,	/* non-lru movable, e.g. zsmalloc */
+	ZMC_KIND_UNMOVABLE,
+	NR_ZMC_KINDS,
+};
+
+static const char * const zmc_kind_name[NR_ZMC_KINDS] = {
+	"free", "movable", "pinned", "nonlru", "unmovable",
+};
+
+#define ZMC_NR_OWNERS	8
+#define ZMC_OWNER_LEN	24
+#define ZMC_NR_FAILS	8
+#define ZMC_DUMP_PAGES	2
+#define ZMC_FAIL_SCAN_INTERVAL	HZ
+
+struct zmc_owner {
+	char name[ZMC_OWNER_LEN];
+	unsigned long pinned;
+	unsigned long unmovable;
+};
+
+struct zmc_fail {
+	unsigned long pfn;
+	unsigned long nr;
+	const void *caller;
+	bool scanned;
+	unsigned long blocking;	/* pinned and unmovable pages */
+	char owner[ZMC_OWNER_LEN];	/* first of them */
+};
+
+struct zmc_area {
+	struct cma *cma;
+	unsigned long base_pfn;
+	unsigned long nr_pages;
+
+	/* last full scan */
+	unsigned long pages[NR_ZMC_KINDS];
+	struct zmc_owner owners[ZMC_NR_OWNERS];
+	unsigned long scans;
+	u64 scan_ns;
+	unsigned long scanned_at;	/* jiffies */
+
+	/* failed migrations */
+	unsigned long failures;
+	unsigned long unscanned;	/* failures over the scan budget */
+	unsigned long fail_window;	/* jiffies */
+	unsigned long fail_scanned;	/* pages scanned in fail_window */
+	struct zmc_owner culprits[ZMC_NR_OWNERS];
+	struct zmc_fail fails[ZMC_NR_FAILS];
+
+	/* probe */
+	unsigned long probe_tries;
+	unsigned long probe_ok;
+	u64 probe_ns;
+	u64 probe_max_ns;
+};
+
+/* zmc_areas and everything in them */
+static DEFINE_MUTEX(zmc_area_lock);
+static struct zmc_area zmc_areas[MAX_CMA_AREAS];
+static int nr_zmc_areas;
+
+static DEFINE_RATELIMIT_STATE(zmc_dump_rs, 60 * HZ, 4);
+
+static struct zmc_area *zmc_area_of(struct cma *cma)
+{
+	int i;
+
+	for (i = 0; i < nr_zmc_areas; i++)
+		if (zmc_areas[i].cma == cma)
+			return &zmc_areas[i];
+
+	return NULL;
+}
+
+static void owner_of_mapping(struct page *page, char *owner)
+{
+	struct address_space *mapping = page_mapping(page);
+	struct inode *host = mapping ? mapping->host : NULL;
+
+	if (host && host->i_sb && host->i_sb->s_type)
+		strlcpy(owner, host->i_sb->s_type->name, ZMC_OWNER_LEN);
+	else
+		strlcpy(owner, "file", ZMC_OWNER_LEN);
+}
+
+/*
+ * Racy by nature, like has_unmovable_pages(). A reference keeps the page
+ * from being freed and the page lock keeps its mapping alive while the
+ * owner is looked up.
+ */
+static enum zmc_kind zmc_classify(struct page *page, char *owner)
+{
+	enum zmc_kind kind = ZMC_KIND_UNMOVABLE;
+	int extra;
+
+	strlcpy(owner, "kernel", ZMC_OWNER_LEN);
+
+	page = compound_head(page);
+	if (PageBuddy(page) || !get_page_unless_zero(page))
+		return ZMC_KIND_FREE;
+
+	if (PageReserved(page)) {
+		strlcpy(owner, "reserved", ZMC_OWNER_LEN);
+	} else if (PageSlab(page)) {
+		strlcpy(owner, "slab", ZMC_OWNER_LEN);
+	} else if (PageLRU(page)) {
+		/* less our reference, the mappings and the page cache */
+		extra = page_count(page) - 1 - total_mapcount(page);
+		if (PageAnon(page)) {
+			strlcpy(owner, "anon", ZMC_OWNER_LEN);
+			extra -= PageSwapCache(page);
+		} else if (trylock_page(page)) {
+			owner_of_mapping(page, owner);
+			extra -= !!page->mapping + page_has_private(page);
+			unlock_page(page);
+		} else {
+			/* locked for I/O, that does not last */
+			strlcpy(owner, "file", ZMC_OWNER_LEN);
+			extra = 0;
+		}
+		kind = extra > 0 ? ZMC_KIND_PINNED : ZMC_KIND_MOVABLE;
+	} else if (__PageMovable(page)) {
+		if (trylock_page(page)) {
+			owner_of_mapping(page, owner);
+			unlock_page(page);
+		}
+		kind = ZMC_KIND_NONLRU;
+	}
+
+	put_page(page);
+	return kind;
+}
+
+static void owner_account(struct zmc_owner *owners, const char *name,
+		enum zmc_kind kind)
+{
+	struct zmc_owner *o, *least = &owners[0];
+	int i;
+
+	for (i = 0; i < ZMC_NR_OWNERS; i++) {
+		o = &owners[i];
+		if (!o->name[0] || !strcmp(o->name, name))
+			goto found;
+		if (o->pinned + o->unmovable < least->pinned + least->unmovable)
+			least = o;
+	}
+
+	/* table full, the smallest owner makes room */
+	o = least;
+	memset(o, 0, sizeof(*o));
+found:
+	if (!o->name[0])
+		strlcpy(o->name, name, ZMC_OWNER_LEN);
+	if (kind == ZMC_KIND_PINNED)
+		o->pinned++;
+	else
+		o->unmovable++;
+}
+
+/* Returns the number of pinned and unmovable pages in [pfn, end) */
+static unsigned long zmc_scan(unsigned long pfn, unsigned long end,
+		unsigned long *pages, struct zmc_owner *owners,
+		char *first, unsigned int nr_dump)
+{
+	char owner[ZMC_OWNER_LEN];
+	unsigned long blocking = 0;
+	enum zmc_kind kind;
+	struct page *page;
+
+	for (; pfn < end; pfn++) {
+		if (!(pfn & 1023))
+			cond_resched();
+		if (!pfn_valid(pfn))
+			continue;
+
+		page = pfn_to_page(pfn);
+		kind = zmc_classify(page, owner);
+		if (pages)
+			pages[kind]++;
+		if (kind != ZMC_KIND_PINNED && kind != ZMC_KIND_UNMOVABLE)
+			continue;
+
+		owner_account(owners, owner, kind);
+		if (!blocking++ && first)
+			strlcpy(first, owner, ZMC_OWNER_LEN);
+		if (nr_dump && __ratelimit(&zmc_dump_rs)) {
+			nr_dump--;
+			dump_page(page, kind == ZMC_KIND_PINNED ?
+				"zmc: pinned page blocks migration" :
+				"zmc: unmovable page blocks migration");
+		}
+	}
+
+	return blocking;
+}
+
+/* Called with zmc_area_lock held */
+static void zmc_scan_area(struct zmc_area *a)
+{
+	ktime_t start = ktime_get();
+
+	memset(a->pages, 0, sizeof(a->pages));
+	memset(a->owners, 0, sizeof(a->owners));
+	zmc_scan(a->base_pfn, a->base_pfn + a->nr_pages, a->pages, a->owners,
+		 NULL, 0);
+	a->scans++;
+	a->scan_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	a->scanned_at = jiffies;
+}
+
+/**
+ * zmc_intrusion_failed - record a failed migration of a range
+ * @cma: area the range belongs to
+ * @pfn: first pfn of the range
+ * @nr: pages in the range
+ * @caller: who wanted the range
+ */
+void zmc_intrusion_failed(struct cma *cma, unsigned long pfn,
+		unsigned long nr, const void *caller)
+{
+	struct zmc_area *a;
+	struct zmc_fail *f;
+
+	mutex_lock(&zmc_area_lock);
+	a = zmc_area_of(cma);
+	if (!a) {
+		mutex_unlock(&zmc_area_lock);
+		return;
+	}
+
+	f = &a->fails[a->failures % ZMC_NR_FAILS];
+	memset(f, 0, sizeof(*f));
+	f->pfn = pfn;
+	f->nr = nr;
+	f->caller = caller;
+	a->failures++;
+
+	if (time_after(jiffies, a->fail_window + ZMC_FAIL_SCAN_INTERVAL)) {
+		a->fail_window = jiffies;
+		a->fail_scanned = 0;
+	}
+	if (a->fail_scanned + nr > a->nr_pages) {
+		a->unscanned++;
+		mutex_unlock(&zmc_area_lock);
+		pr_debug("migration of pfn [0x%lx-0x%lx) for %pS failed\n",
+			 pfn, pfn + nr, caller);
+		return;
+	}
+	a->fail_scanned += nr;
+	f->scanned = true;
+	f->blocking = zmc_scan(pfn, pfn + nr, NULL, a->culprits, f->owner,
+			       ZMC_DUMP_PAGES);
+	mutex_unlock(&zmc_area_lock);
+
+	pr_info("migration of pfn [0x%lx-0x%lx) for %pS failed, %lu pinned or unmovable, first %s\n",
+			pfn, pfn + nr, caller, f->blocking,
+			f->blocking ? f->owner : "none");
+}
+
+/*
+ * Called without zmc_area_lock: cma_alloc() reports failed migrations
+ * through zmc_intrusion_failed(), and a probe may take a while.
+ */
+static void zmc_probe_area(struct zmc_area *a, unsigned long count)
+{
+	struct page *page;
+	ktime_t start;
+	u64 ns;
+
+	start = ktime_get();
+	page = cma_alloc(a->cma, count, 0, GFP_KERNEL);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	if (page)
+		cma_release(a->cma, page, count);
+
+	mutex_lock(&zmc_area_lock);
+	a->probe_tries++;
+	a->probe_ns += ns;
+	a->probe_max_ns = max(a->probe_max_ns, ns);
+	if (page)
+		a->probe_ok++;
+	/* the allocation moved pages around, rescan on the next read */
+	a->scans = 0;
+	mutex_unlock(&zmc_area_lock);
+}
+
+static void seq_owners(struct seq_file *m, const char *what,
+		struct zmc_owner *owners)
+{
+	int i;
+
+	seq_printf(m, "  %s:", what);
+	for (i = 0; i < ZMC_NR_OWNERS && owners[i].name[0]; i++)
+		seq_printf(m, " %s %lu/%lu", owners[i].name,
+			   owners[i].pinned, owners[i].unmovable);
+	seq_puts(m, i ? " (pinned/unmovable)\n" : " none\n");
+}
+
+static int zmc_intrusion_show(struct seq_file *m, void *v)
+{
+	struct zmc_area *a;
+	struct zmc_fail *f;
+	unsigned long n;
+	int i, k;
+
+	seq_printf(m, "cma_deny: 0x%lx\n", READ_ONCE(zmc_cma_deny));
+
+	mutex_lock(&zmc_area_lock);
+	for (i = 0; i < nr_zmc_areas; i++) {
+		a = &zmc_areas[i];
+		if (!a->scans || time_after(jiffies, a->scanned_at + HZ))
+			zmc_scan_area(a);
+
+		seq_printf(m, "area %s: pfn [0x%lx-0x%lx) scan %llu us\n",
+			   cma_get_name(a->cma), a->base_pfn,
+			   a->base_pfn + a->nr_pages,
+			   a->scan_ns / NSEC_PER_USEC);
+		seq_puts(m, " ");
+		for (k = 0; k < NR_ZMC_KINDS; k++)
+			seq_printf(m, " %s %lu", zmc_kind_name[k], a->pages[k]);
+		seq_putc(m, '\n');
+		seq_owners(m, "owners", a->owners);
+
+		seq_printf(m, "  failures: %lu unscanned %lu\n", a->failures,
+			   a->unscanned);
+		seq_owners(m, "culprits", a->culprits);
+		for (n = a->failures > ZMC_NR_FAILS ?
+		     a->failures - ZMC_NR_FAILS : 0; n < a->failures; n++) {
+			f = &a->fails[n % ZMC_NR_FAILS];
+			if (!f->scanned) {
+				seq_printf(m, "  fail: pfn [0x%lx-0x%lx) for %pS not scanned\n",
+					   f->pfn, f->pfn + f->nr, f->caller);
+				continue;
+			}
+			seq_printf(m, "  fail: pfn [0x%lx-0x%lx) for %pS blocking %lu first %s\n",
+				   f->pfn, f->pfn + f->nr, f->caller,
+				   f->blocking, f->blocking ? f->owner : "none");
+		}
+
+		seq_printf(m, "  probe: ok %lu/%lu avg_us %llu max_us %llu\n",
+			   a->probe_ok, a->probe_tries,
+			   a->probe_tries ? div64_u64(a->probe_ns,
+				a->probe_tries) / NSEC_PER_USEC : 0,
+			   a->probe_max_ns / NSEC_PER_USEC);
+	}
+	mutex_unlock(&zmc_area_lock);
+
+	return 0;
+}
+
+static int zmc_intrusion_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, zmc_intrusion_show, NULL);
+}
+
+static ssize_t zmc_intrusion_write(struct file *file,
+		const char __user *user_buf, size_t size, loff_t *ppos)
+{
+	unsigned long count, tries, t;
+	char buf[64];
+	int i;
+
+	if (size >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, user_buf, size))
+		return -EFAULT;
+	buf[size] = '\0';
+
+	if (!strncmp(buf, "reset", 5)) {
+		mutex_lock(&zmc_area_lock);
+		for (i = 0; i < nr_zmc_areas; i++) {
+			struct zmc_area *a = &zmc_areas[i];
+
+			a->failures = a->unscanned = 0;
+			a->fail_window = a->fail_scanned = 0;
+			memset(a->culprits, 0, sizeof(a->culprits));
+			memset(a->fails, 0, sizeof(a->fails));
+			a->probe_tries = a->probe_ok = 0;
+			a->probe_ns = a->probe_max_ns = 0;
+			a->scans = 0;
+		}
+		mutex_unlock(&zmc_area_lock);
+	} else if (sscanf(buf, "probe %lu %lu", &count, &tries) == 2) {
+		if (!count || !tries || tries > 1000)
+			return -EINVAL;
+		/* the areas are fixed after init, no lock to walk them */
+		for (i = 0; i < nr_zmc_areas; i++) {
+			if (count > zmc_areas[i].nr_pages)
+				continue;
+			for (t = 0; t < tries; t++)
+				zmc_probe_area(&zmc_areas[i], count);
+		}
+	} else {
+		return -EINVAL;
+	}
+
+	return size;
+}
+
+static const struct file_operations zmc_intrusion_fops = {
+	.open		= zmc_intrusion_open,
+	.read		= seq_read,
+	.write		= zmc_intrusion_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init zmc_area_add(struct cma *cma, void *data)
+{
+	struct zmc_area *a = &zmc_areas[nr_zmc_areas++];
+
+	a->cma = cma;
+	a->base_pfn = PFN_DOWN(cma_get_base(cma));
+	a->nr_pages = cma_get_size(cma) >> PAGE_SHIFT;
+
+	return 0;
+}
+
+static int __init zmc_placement_init(void)
+{
+	if (!is_zmc_inited())
+		return 0;
+
+	zmc_for_each_cma(zmc_area_add, NULL);
+
+	if (!debugfs_create_file("zmc_intrusion", 0644, NULL, NULL,
+				&zmc_intrusion_fops))
+		pr_warn("Failed to create debugfs zmc_intrusion file\n");
+
+	return 0;
+}
+device_initcall(zmc_placement_init);
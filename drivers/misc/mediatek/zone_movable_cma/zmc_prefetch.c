@@ -0,0 +1,503 @@
+/*
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See http://www.gnu.org/licenses/gpl-2.0.html for more details.
+ */
+
+/*
+ * ZMC pre-migration
+ *
+ * When a user predicts an allocation (ZMC_EVENT_PREDICT_MOVABLE), the
+ * window cma_alloc() will pick is evacuated in the background: unbound
+ * workers on all CPUs take MAX_ORDER sized units of the window one by
+ * one and claim them with alloc_contig_range(), which migrates their
+ * movable pages away. Claimed units are held so the page allocator
+ * cannot refill them.
+ *
+ * zmc_cma_alloc() joins the evacuation that is still running, gives the
+ * held units back and lets cma_alloc() take the now free window, so the
+ * requester only waits for what has not been migrated yet. Units that
+ * could not be claimed are left to cma_alloc(). A prediction that is
+ * not followed by an allocation is cancelled by ZMC_EVENT_CANCEL_MOVABLE
+ * or after hold_ms.
+ */
+#define pr_fmt(fmt) "zmc_prefetch: " fmt
+
+#include <linux/cma.h>
+#include <linux/cpumask.h>
+#include <linux/debugfs.h>
+#include <linux/gfp.h>
+#include <linux/ktime.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/notifier.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#include "mt-plat/mtk_meminfo.h"
+#include "single_cma.h"
+
+static unsigned int hold_ms = 10000;
+module_param(hold_ms, uint, 0644);
+MODULE_PARM_DESC(hold_ms, "Release an unclaimed prediction after this long");
+
+static unsigned int max_workers;
+module_param(max_workers, uint, 0644);
+MODULE_PARM_DESC(max_workers, "Parallel migration workers, 0 for one per CPU");
+
+enum zmc_unit_state {
+	ZMC_UNIT_PENDING,
+	ZMC_UNIT_RUNNING,
+	ZMC_UNIT_HELD,
+	ZMC_UNIT_FAILED,
+};
+
+static const char zmc_unit_char[] = {
+	[ZMC_UNIT_PENDING] = '.',
+	[ZMC_UNIT_RUNNING] = '>',
+	[ZMC_UNIT_HELD] = '#',
+	[ZMC_UNIT_FAILED] = 'x',
+};
+
+struct zmc_prefetch;
+
+struct zmc_prefetch_worker {
+	struct work_struct work;
+	struct zmc_prefetch *pf;
+};
+
+struct zmc_prefetch {
+	struct cma *cma;
+	unsigned long base_pfn;
+	unsigned long count;
+	unsigned int align;
+
+	unsigned long unit_pages;
+	unsigned int nr_units;
+	u8 *state;			/* enum zmc_unit_state per unit */
+	atomic_t next;			/* next unit to take */
+	atomic_t nr_held;
+	atomic_t nr_failed;
+	bool stop;
+
+	unsigned int nr_workers;
+	atomic_t nr_running;
+	struct completion done;
+	struct zmc_prefetch_worker *workers;
+
+	ktime_t start;
+	u64 evac_ns;
+	struct delayed_work expire;
+};
+
+static struct zmc_prefetch_stat {
+	unsigned long predicted;
+	unsigned long started;
+	unsigned long claimed;
+	unsigned long claimed_full;	/* every unit was held */
+	unsigned long hit;		/* cma_alloc() took the window */
+	unsigned long miss;
+	unsigned long cancelled;
+	unsigned long expired;
+	unsigned long evacuated;	/* pages in held units */
+	u64 last_evac_ns;
+	u64 last_wait_ns;		/* claimer waiting for the workers */
+} zmc_pf_stat;
+
+/* zmc_pf and zmc_pf_stat */
+static DEFINE_MUTEX(zmc_pf_lock);
+static struct zmc_prefetch *zmc_pf;
+static struct workqueue_struct *zmc_pf_wq;
+
+static unsigned long unit_pfn(struct zmc_prefetch *pf, unsigned int i)
+{
+	return pf->base_pfn + i * pf->unit_pages;
+}
+
+static unsigned long unit_nr(struct zmc_prefetch *pf, unsigned int i)
+{
+	return min(pf->unit_pages, pf->base_pfn + pf->count - unit_pfn(pf, i));
+}
+
+static void zmc_prefetch_work(struct work_struct *work)
+{
+	struct zmc_prefetch_worker *w =
+		container_of(work, struct zmc_prefetch_worker, work);
+	struct zmc_prefetch *pf = w->pf;
+	unsigned long pfn;
+	unsigned int i;
+
+	while (!READ_ONCE(pf->stop)) {
+		i = atomic_inc_return(&pf->next) - 1;
+		if (i >= pf->nr_units)
+			break;
+
+		pfn = unit_pfn(pf, i);
+		WRITE_ONCE(pf->state[i], ZMC_UNIT_RUNNING);
+		if (alloc_contig_range(pfn, pfn + unit_nr(pf, i), MIGRATE_CMA,
+				       GFP_KERNEL)) {
+			WRITE_ONCE(pf->state[i], ZMC_UNIT_FAILED);
+			atomic_inc(&pf->nr_failed);
+			zmc_intrusion_failed(pf->cma, pfn, unit_nr(pf, i),
+					zmc_prefetch_work);
+		} else {
+			WRITE_ONCE(pf->state[i], ZMC_UNIT_HELD);
+			atomic_inc(&pf->nr_held);
+		}
+		cond_resched();
+	}
+
+	if (atomic_dec_and_test(&pf->nr_running)) {
+		pf->evac_ns = ktime_to_ns(ktime_sub(ktime_get(), pf->start));
+		complete_all(&pf->done);
+	}
+}
+
+/* Waits for the workers, gives the held units back and frees @pf */
+static void zmc_prefetch_finish(struct zmc_prefetch *pf, bool stop)
+{
+	unsigned long evacuated = 0;
+	unsigned int i;
+
+	if (stop)
+		WRITE_ONCE(pf->stop, true);
+	wait_for_completion(&pf->done);
+
+	for (i = 0; i < pf->nr_units; i++) {
+		if (pf->state[i] != ZMC_UNIT_HELD)
+			continue;
+		free_contig_range(unit_pfn(pf, i), unit_nr(pf, i));
+		evacuated += unit_nr(pf, i);
+	}
+
+	mutex_lock(&zmc_pf_lock);
+	zmc_pf_stat.evacuated += evacuated;
+	zmc_pf_stat.last_evac_ns = pf->evac_ns;
+	mutex_unlock(&zmc_pf_lock);
+
+	kfree(pf->workers);
+	kfree(pf->state);
+	kfree(pf);
+}
+
+/* Takes the running prefetch out of zmc_pf, NULL @cma matches any */
+static struct zmc_prefetch *zmc_prefetch_detach(struct cma *cma)
+{
+	struct zmc_prefetch *pf;
+
+	mutex_lock(&zmc_pf_lock);
+	pf = zmc_pf;
+	if (pf && (!cma || pf->cma == cma))
+		zmc_pf = NULL;
+	else
+		pf = NULL;
+	mutex_unlock(&zmc_pf_lock);
+
+	if (pf)
+		cancel_delayed_work_sync(&pf->expire);
+
+	return pf;
+}
+
+static void zmc_prefetch_expire(struct work_struct *work)
+{
+	struct zmc_prefetch *pf =
+		container_of(to_delayed_work(work), struct zmc_prefetch,
+			     expire);
+
+	mutex_lock(&zmc_pf_lock);
+	if (zmc_pf != pf) {
+		/* being claimed or cancelled, that path frees it */
+		mutex_unlock(&zmc_pf_lock);
+		return;
+	}
+	zmc_pf = NULL;
+	zmc_pf_stat.expired++;
+	mutex_unlock(&zmc_pf_lock);
+
+	pr_info("prediction for pfn 0x%lx expired\n", pf->base_pfn);
+	zmc_prefetch_finish(pf, true);
+}
+
+static int zmc_prefetch_start(struct zmc_predict *req)
+{
+	struct zmc_prefetch *pf;
+	unsigned long pfn;
+	unsigned int i;
+	int ret = 0;
+
+	mutex_lock(&zmc_pf_lock);
+	zmc_pf_stat.predicted++;
+	mutex_unlock(&zmc_pf_lock);
+
+	if (!zmc_pf_wq || !is_zmc_inited() || !req || !req->cma ||
+	    !req->count)
+		return -EINVAL;
+
+	if (req->prio >= ZMC_CHECK_MEM_STAT &&
+	    !zmc_check_mem_status_ok(req->count))
+		return -ENOMEM;
+
+	if (!zmc_predict_pfn(req->cma, req->count, req->align, &pfn))
+		return -ENOSPC;
+
+	pf = kzalloc(sizeof(*pf), GFP_KERNEL);
+	if (!pf)
+		return -ENOMEM;
+
+	pf->cma = req->cma;
+	pf->base_pfn = pfn;
+	pf->count = req->count;
+	pf->align = req->align;
+	/* alloc_contig_range() isolates whole MAX_ORDER blocks */
+	pf->unit_pages = max_t(unsigned long, MAX_ORDER_NR_PAGES,
+			       pageblock_nr_pages);
+	pf->nr_units = DIV_ROUND_UP(pf->count, pf->unit_pages);
+	pf->nr_workers = min(num_online_cpus(), pf->nr_units);
+	if (max_workers)
+		pf->nr_workers = min(pf->nr_workers, max_workers);
+	atomic_set(&pf->nr_running, pf->nr_workers);
+	init_completion(&pf->done);
+	INIT_DELAYED_WORK(&pf->expire, zmc_prefetch_expire);
+
+	pf->state = kcalloc(pf->nr_units, sizeof(*pf->state), GFP_KERNEL);
+	pf->workers = kcalloc(pf->nr_workers, sizeof(*pf->workers),
+			      GFP_KERNEL);
+	if (!pf->state || !pf->workers) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	mutex_lock(&zmc_pf_lock);
+	if (zmc_pf) {
+		/* the same prediction again keeps the running one */
+		if (zmc_pf->cma != pf->cma || zmc_pf->count != pf->count)
+			ret = -EBUSY;
+		mutex_unlock(&zmc_pf_lock);
+		goto err;
+	}
+
+	zmc_pf = pf;
+	zmc_pf_stat.started++;
+	pf->start = ktime_get();
+	for (i = 0; i < pf->nr_workers; i++) {
+		pf->workers[i].pf = pf;
+		INIT_WORK(&pf->workers[i].work, zmc_prefetch_work);
+		queue_work(zmc_pf_wq, &pf->workers[i].work);
+	}
+	if (hold_ms)
+		schedule_delayed_work(&pf->expire, msecs_to_jiffies(hold_ms));
+	mutex_unlock(&zmc_pf_lock);
+
+	pr_info("evacuating pfn [0x%lx-0x%lx) with %u workers\n",
+			pf->base_pfn, pf->base_pfn + pf->count,
+			pf->nr_workers);
+	return 0;
+
+err:
+	kfree(pf->workers);
+	kfree(pf->state);
+	kfree(pf);
+	return ret;
+}
+
+void zmc_prefetch_cancel(struct cma *cma)
+{
+	struct zmc_prefetch *pf = zmc_prefetch_detach(cma);
+
+	if (!pf)
+		return;
+
+	mutex_lock(&zmc_pf_lock);
+	zmc_pf_stat.cancelled++;
+	mutex_unlock(&zmc_pf_lock);
+
+	zmc_prefetch_finish(pf, true);
+}
+
+/**
+ * zmc_prefetch_claim - hand a prefetched window over to cma_alloc()
+ *
+ * Waits for the evacuation of the matching prediction to finish and
+ * releases its held units. A prediction for another size is cancelled.
+ *
+ * Return: the first pfn of the evacuated window, or 0 if there was none.
+ */
+unsigned long zmc_prefetch_claim(struct cma *cma, unsigned long count,
+		unsigned int align)
+{
+	struct zmc_prefetch *pf = zmc_prefetch_detach(cma);
+	unsigned long pfn;
+	ktime_t start;
+	bool full;
+	u64 wait;
+
+	if (!pf)
+		return 0;
+
+	if (pf->count != count || pf->align != align) {
+		mutex_lock(&zmc_pf_lock);
+		zmc_pf_stat.cancelled++;
+		mutex_unlock(&zmc_pf_lock);
+		zmc_prefetch_finish(pf, true);
+		return 0;
+	}
+
+	start = ktime_get();
+	wait_for_completion(&pf->done);
+	wait = ktime_to_ns(ktime_sub(ktime_get(), start));
+	full = atomic_read(&pf->nr_held) == pf->nr_units;
+	pfn = pf->base_pfn;
+
+	mutex_lock(&zmc_pf_lock);
+	zmc_pf_stat.claimed++;
+	if (full)
+		zmc_pf_stat.claimed_full++;
+	zmc_pf_stat.last_wait_ns = wait;
+	mutex_unlock(&zmc_pf_lock);
+
+	zmc_prefetch_finish(pf, false);
+
+	return pfn;
+}
+
+void zmc_prefetch_account(unsigned long predicted, struct page *page)
+{
+	if (!predicted)
+		return;
+
+	mutex_lock(&zmc_pf_lock);
+	if (page && page_to_pfn(page) == predicted)
+		zmc_pf_stat.hit++;
+	else
+		zmc_pf_stat.miss++;
+	mutex_unlock(&zmc_pf_lock);
+}
+
+/**
+ * zmc_prefetch_progress - pages evacuated for the running prediction
+ * @held: pages held so far
+ * @total: pages of the predicted window, 0 when nothing is running
+ */
+void zmc_prefetch_progress(unsigned long *held, unsigned long *total)
+{
+	struct zmc_prefetch *pf;
+
+	*held = *total = 0;
+
+	mutex_lock(&zmc_pf_lock);
+	pf = zmc_pf;
+	if (pf) {
+		*held = min_t(unsigned long, pf->count,
+			      atomic_read(&pf->nr_held) * pf->unit_pages);
+		*total = pf->count;
+	}
+	mutex_unlock(&zmc_pf_lock);
+}
+EXPORT_SYMBOL(zmc_prefetch_progress);
+
+static int zmc_prefetch_notify(struct notifier_block *nb,
+		unsigned long event, void *data)
+{
+	struct zmc_predict *req = data;
+	int ret;
+
+	switch (event) {
+	case ZMC_EVENT_PREDICT_MOVABLE:
+		ret = zmc_prefetch_start(req);
+		if (ret)
+			pr_info("prediction of %lu pages ignored: %d\n",
+					req ? req->count : 0, ret);
+		break;
+	case ZMC_EVENT_CANCEL_MOVABLE:
+		zmc_prefetch_cancel(req ? req->cma : NULL);
+		break;
+	default:
+		break;
+	}
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block zmc_prefetch_nb = {
+	.notifier_call = zmc_prefetch_notify,
+};
+
+static int zmc_prefetch_show(struct seq_file *m, void *v)
+{
+	struct zmc_prefetch_stat st;
+	struct zmc_prefetch *pf;
+	unsigned int i;
+
+	mutex_lock(&zmc_pf_lock);
+	st = zmc_pf_stat;
+	pf = zmc_pf;
+	if (pf) {
+		unsigned int pending = pf->nr_units -
+			atomic_read(&pf->nr_held) - atomic_read(&pf->nr_failed);
+
+		seq_printf(m, "window: pfn [0x%lx-0x%lx) %lu pages, %u units of %lu pages, %u workers\n",
+			pf->base_pfn, pf->base_pfn + pf->count, pf->count,
+			pf->nr_units, pf->unit_pages, pf->nr_workers);
+		seq_printf(m, "units: held %d failed %d pending %u, %lld ms\n",
+			atomic_read(&pf->nr_held), atomic_read(&pf->nr_failed),
+			pending,
+			ktime_ms_delta(ktime_get(), pf->start));
+		seq_puts(m, "map: ");
+		for (i = 0; i < pf->nr_units; i++)
+			seq_putc(m, zmc_unit_char[READ_ONCE(pf->state[i])]);
+		seq_putc(m, '\n');
+	} else {
+		seq_puts(m, "window: none\n");
+	}
+	mutex_unlock(&zmc_pf_lock);
+
+	seq_printf(m, "predicted %lu started %lu claimed %lu (full %lu) hit %lu miss %lu cancelled %lu expired %lu\n",
+		st.predicted, st.started, st.claimed, st.claimed_full,
+		st.hit, st.miss, st.cancelled, st.expired);
+	seq_printf(m, "evacuated %lu pages, last evacuation %llu ms, last claim wait %llu ms\n",
+		st.evacuated, st.last_evac_ns / NSEC_PER_MSEC,
+		st.last_wait_ns / NSEC_PER_MSEC);
+
+	return 0;
+}
+
+static int zmc_prefetch_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, zmc_prefetch_show, NULL);
+}
+
+static const struct file_operations zmc_prefetch_fops = {
+	.open		= zmc_prefetch_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init zmc_prefetch_init(void)
+{
+	if (!is_zmc_inited())
+		return 0;
+
+	zmc_pf_wq = alloc_workqueue("zmc_prefetch", WQ_UNBOUND, 0);
+	if (!zmc_pf_wq)
+		return -ENOMEM;
+
+	zmc_register_client(&zmc_prefetch_nb);
+
+	if (!debugfs_create_file("zmc_prefetch", 0444, NULL, NULL,
+				&zmc_prefetch_fops))
+		pr_warn("Failed to create debugfs zmc_prefetch file\n");
+
+	return 0;
+}
+device_initcall(zmc_prefetch_init);
@@ -63,6 +63,7 @@
 #endif
 #include <linux/ktime.h>
 #include <linux/kernel.h>
+#include <linux/seq_file.h>
 #endif
 
 //#ifdef VENDOR_EDIT
@@ -138,6 +139,8 @@ static void oppo_chg_check_tbatt_status(struct oppo_chg_chip *chip);
 static void oppo_chg_get_chargerid_voltage(struct oppo_chg_chip *chip);
 static void oppo_chg_set_input_current_limit(struct oppo_chg_chip *chip);
 static void oppo_chg_battery_update_status(struct oppo_chg_chip *chip);
+static void oppo_chg_sm_init(struct oppo_chg_chip *chip);
+static void init_proc_chg_sm(void);
 
 #ifdef  CONFIG_FB
 static int fb_notifier_callback(struct notifier_block *nb, unsigned long event, void *data);
@@ -555,6 +558,9 @@ int oppo_battery_set_property(struct power_supply *psy,
                 ret = -EINVAL;
                 break;
         }
+        if (!ret) {
+                oppo_chg_post_event(chip, CHG_EVENT__USER);
+        }
         return ret;
 }
 
@@ -1439,11 +1445,11 @@ int oppo_chg_init(struct oppo_chg_chip *chip)
 #ifndef CONFIG_OPPO_CHARGER_MTK
         chip->pmic_spmi.psy_registered = true;
 #endif
+        INIT_DELAYED_WORK(&chip->update_work, oppo_chg_update_work);
+        oppo_chg_sm_init(chip);
         g_charger_chip = chip;
         oppo_chg_awake_init(chip);
 
-        INIT_DELAYED_WORK(&chip->update_work, oppo_chg_update_work);
-
         chip->shortc_thread = kthread_create(shortc_thread_main, (void *)chip, thread_name);
         if (!chip->shortc_thread) {
                 chg_err("Can't create shortc_thread\n");
@@ -1482,6 +1488,7 @@ int oppo_chg_init(struct oppo_chg_chip *chip)
         init_proc_chg_cycle();
         init_proc_critical_log();
         init_proc_tbatt_pwroff();
+        init_proc_chg_sm();
 #ifdef ODM_WT_EDIT
 /*Shouli.Wang@ODM_WT.BSP.CHG 2019/11/05, add for batt_param_noplug proc*/
 		init_proc_batt_param_noplug();
@@ -5054,6 +5061,7 @@ static bool oppo_chg_soc_reduce_slow_when_1(struct oppo_chg_chip *chip)
         }
 }
 
+/* in OPPO_CHG_UPDATE_INTERVAL periods, the counters advance by chip->sm_ticks */
 #define SOC_SYNC_UP_RATE_10S                                  2
 #define SOC_SYNC_UP_RATE_60S                                  12
 #define SOC_SYNC_DOWN_RATE_300S                               60
@@ -5108,7 +5116,7 @@ static void oppo_chg_update_ui_soc(struct oppo_chg_chip *chip)
 				} else if ((chip->tbatt_status == BATTERY_STATUS__NORMAL) || (chip->tbatt_status == BATTERY_STATUS__LITTLE_COOL_TEMP)
                         || (chip->tbatt_status == BATTERY_STATUS__COOL_TEMP) || (chip->tbatt_status == BATTERY_STATUS__LITTLE_COLD_TEMP)) {
                         soc_down_count = 0;
-                        soc_up_count++;
+                        soc_up_count += chip->sm_ticks;
                         if (soc_up_count >= soc_up_limit) {
                                 soc_up_count = 0;
                                 chip->ui_soc++;
@@ -5133,14 +5141,14 @@ static void oppo_chg_update_ui_soc(struct oppo_chg_chip *chip)
                         soc_up_count = 0;
                 } else if (chip->soc > chip->ui_soc) {
                         soc_down_count = 0;
-                        soc_up_count++;
+                        soc_up_count += chip->sm_ticks;
                         if (soc_up_count >= soc_up_limit) {
                                 soc_up_count = 0;
                                 chip->ui_soc++;
                         }
                 } else if (chip->soc < chip->ui_soc) {
                         soc_up_count = 0;
-                        soc_down_count++;
+                        soc_down_count += chip->sm_ticks;
                         if (soc_down_count >= soc_down_limit) {
                                 soc_down_count = 0;
                                 chip->ui_soc--;
@@ -5157,7 +5165,7 @@ static void oppo_chg_update_ui_soc(struct oppo_chg_chip *chip)
                         if (soc_down_count > soc_down_limit) {
                                 soc_down_count = soc_down_limit + 1;
                         } else {
-                                soc_down_count++;
+                                soc_down_count += chip->sm_ticks;
                         }
                         sleep_tm = chip->sleep_tm_sec;
                         if (chip->sleep_tm_sec > 0) {
@@ -5766,17 +5774,22 @@ static void oppo_chg_other_thing(struct oppo_chg_chip *chip)
 {
 		if (oppo_vooc_get_fastchg_started() == false) {
                 chip->chg_ops->kick_wdt();
-                chip->chg_ops->dump_registers();
+                /* nothing changes in the charger registers while unplugged */
+                if (chip->charger_exist) {
+                        chip->chg_ops->dump_registers();
+                }
 #ifdef ODM_WT_EDIT
 				//Junbo.Guo@ODM_WT.BSP.CHG, 2019/11/11, Modify for subcharger
 				if(chip->is_double_charger_support){
 					chip->sub_chg_ops->kick_wdt();
-                	chip->sub_chg_ops->dump_registers();
+					if (chip->charger_exist) {
+						chip->sub_chg_ops->dump_registers();
+					}
 				}
 #endif
         }
         if (chip->charger_exist) {
-                chip->total_time += OPPO_CHG_UPDATE_INTERVAL_SEC;
+                chip->total_time += chip->sm_ticks * OPPO_CHG_UPDATE_INTERVAL_SEC;
         }
         oppo_chg_print_log(chip);
         oppo_chg_critical_log(chip);
@@ -6218,10 +6231,261 @@ static int __ref FAST_charger_thread_main(void *data)
 
 #endif
 
+static const char * const oppo_chg_sm_names[CHG_SM__MAX] = {
+        [CHG_SM__NO_CHARGER] = "no_charger",
+        [CHG_SM__DETECT] = "detect",
+        [CHG_SM__CHARGING] = "charging",
+        [CHG_SM__FASTCHG] = "fastchg",
+        [CHG_SM__FULL] = "full",
+        [CHG_SM__FAULT] = "fault",
+};
+
+static const char * const oppo_chg_event_names[CHG_EVENT_NUM] = {
+        "usb", "adapter", "gauge", "temp", "user", "timer",
+};
+
+/*
+ * Poll interval of each state in seconds when no event comes in. The
+ * charger and gauge IC drivers do not post plug, gauge or temperature
+ * events yet, so plug detection and the battery temperature checks
+ * still depend on the poll: every state keeps the OPPO_CHG_UPDATE_INTERVAL
+ * cadence until they do.
+ */
+static const int oppo_chg_sm_poll_sec[CHG_SM__MAX] = {
+        [CHG_SM__NO_CHARGER] = OPPO_CHG_UPDATE_INTERVAL_SEC,
+        [CHG_SM__DETECT] = OPPO_CHG_UPDATE_INTERVAL_SEC,
+        [CHG_SM__CHARGING] = OPPO_CHG_UPDATE_INTERVAL_SEC,
+        [CHG_SM__FASTCHG] = OPPO_CHG_UPDATE_INTERVAL_SEC,
+        [CHG_SM__FULL] = OPPO_CHG_UPDATE_INTERVAL_SEC,
+        [CHG_SM__FAULT] = OPPO_CHG_UPDATE_INTERVAL_SEC,
+};
+
+#define OPPO_CHG_SM_DETECT_MS        (3 * OPPO_CHG_UPDATE_INTERVAL_SEC * 1000)
+
+static u64 oppo_chg_sm_now_ms(void)
+{
+        return div_u64(ktime_get_boot_ns(), NSEC_PER_MSEC);
+}
+
+const char *oppo_chg_sm_state_name(int state)
+{
+        if (state < 0 || state >= CHG_SM__MAX) {
+                return "unknown";
+        }
+        return oppo_chg_sm_names[state];
+}
+
+/*
+ * Asks for an update pass now. Meant for the plug, gauge and temperature
+ * interrupts of the IC drivers and for the property and proc writes;
+ * safe in atomic context.
+ */
+void oppo_chg_post_event(struct oppo_chg_chip *chip, unsigned long events)
+{
+        unsigned long flags;
+
+        if (!chip) {
+                return;
+        }
+        spin_lock_irqsave(&chip->sm_lock, flags);
+        if (!chip->sm_events) {
+                chip->sm_event_ms = oppo_chg_sm_now_ms();
+        }
+        chip->sm_events |= events;
+        spin_unlock_irqrestore(&chip->sm_lock, flags);
+        mod_delayed_work(system_wq, &chip->update_work, 0);
+}
+
+void oppo_chg_sm_get_stats(struct oppo_chg_chip *chip, struct oppo_chg_sm_stats *stats)
+{
+        unsigned long flags;
+
+        spin_lock_irqsave(&chip->sm_lock, flags);
+        *stats = chip->sm_stats;
+        stats->state_ms[chip->sm_state] += oppo_chg_sm_now_ms() - chip->sm_entered_ms;
+        spin_unlock_irqrestore(&chip->sm_lock, flags);
+}
+
+static void oppo_chg_sm_init(struct oppo_chg_chip *chip)
+{
+        spin_lock_init(&chip->sm_lock);
+        chip->sm_state = CHG_SM__NO_CHARGER;
+        chip->sm_events = 0;
+        chip->sm_entered_ms = oppo_chg_sm_now_ms();
+        chip->sm_last_pass = jiffies;
+        chip->sm_carry_ms = 0;
+        chip->sm_ticks = 1;
+        memset(&chip->sm_stats, 0, sizeof(chip->sm_stats));
+}
+
+/*
+ * Takes the pending events and works out how many update periods this
+ * pass covers, so the per pass counters keep their meaning in time
+ * whatever the poll interval was. Returns the events of the pass and
+ * when the first of them was posted.
+ */
+static unsigned long oppo_chg_sm_begin(struct oppo_chg_chip *chip, u64 *since_ms)
+{
+        unsigned long flags, events, now = jiffies;
+        int period = OPPO_CHG_UPDATE_INTERVAL_SEC * 1000;
+        int ms, i;
+
+        spin_lock_irqsave(&chip->sm_lock, flags);
+        events = chip->sm_events;
+        chip->sm_events = 0;
+        *since_ms = events ? chip->sm_event_ms : oppo_chg_sm_now_ms();
+        if (!events) {
+                events = CHG_EVENT__TIMER;
+                chip->sm_stats.timer_passes++;
+        }
+        chip->sm_stats.passes++;
+        for (i = 0; i < CHG_EVENT_NUM; i++) {
+                if (events & (1 << i)) {
+                        chip->sm_stats.events[i]++;
+                }
+        }
+        spin_unlock_irqrestore(&chip->sm_lock, flags);
+
+        ms = jiffies_to_msecs(now - chip->sm_last_pass) + chip->sm_carry_ms;
+        chip->sm_last_pass = now;
+        chip->sm_ticks = (ms + period / 2) / period;
+        chip->sm_carry_ms = ms - chip->sm_ticks * period;
+
+        return events;
+}
+
+static OPPO_CHG_SM_STATE oppo_chg_sm_next(struct oppo_chg_chip *chip)
+{
+        if (!chip->charger_exist) {
+                return CHG_SM__NO_CHARGER;
+        }
+        if (oppo_vooc_get_fastchg_started() == true) {
+                return CHG_SM__FASTCHG;
+        }
+        if (chip->charging_state == CHARGING_STATUS_FAIL) {
+                return CHG_SM__FAULT;
+        }
+        if (chip->batt_full) {
+                return CHG_SM__FULL;
+        }
+        if (chip->sm_state == CHG_SM__NO_CHARGER
+                || (chip->sm_state == CHG_SM__DETECT
+                && oppo_chg_sm_now_ms() - chip->sm_entered_ms < OPPO_CHG_SM_DETECT_MS)) {
+                return CHG_SM__DETECT;
+        }
+        return CHG_SM__CHARGING;
+}
+
+static void oppo_chg_sm_end(struct oppo_chg_chip *chip, unsigned long events, u64 since_ms)
+{
+        OPPO_CHG_SM_STATE next = oppo_chg_sm_next(chip);
+        struct oppo_chg_sm_stats *st = &chip->sm_stats;
+        struct oppo_chg_sm_transition *t;
+        u64 now = oppo_chg_sm_now_ms();
+        unsigned long flags;
+        int prev = chip->sm_state;
+
+        if (next == prev) {
+                return;
+        }
+        spin_lock_irqsave(&chip->sm_lock, flags);
+        t = &st->log[st->transitions % CHG_SM_LOG_SIZE];
+        t->time_ms = now;
+        t->latency_ms = now - since_ms;
+        t->from = prev;
+        t->to = next;
+        t->events = events;
+        st->transitions++;
+        st->state_ms[prev] += now - chip->sm_entered_ms;
+        chip->sm_state = next;
+        chip->sm_entered_ms = now;
+        spin_unlock_irqrestore(&chip->sm_lock, flags);
+
+        charger_xlog_printk(CHG_LOG_CRTI, "%s -> %s, events 0x%lx, %u ms\n",
+                oppo_chg_sm_names[prev], oppo_chg_sm_names[next], events, t->latency_ms);
+}
+
+static unsigned long oppo_chg_sm_interval(struct oppo_chg_chip *chip)
+{
+        int sec = oppo_chg_sm_poll_sec[chip->sm_state];
+        bool converging;
+
+        /* ui_soc moves towards soc a step per few periods, keep the pace until it is there */
+        if (chip->sm_state == CHG_SM__FULL) {
+                converging = chip->ui_soc < 100;
+        } else {
+                converging = chip->ui_soc != chip->soc;
+        }
+        if (converging || vbatt_lowerthan_3300mv) {
+                sec = OPPO_CHG_UPDATE_INTERVAL_SEC;
+        }
+        return round_jiffies_relative(msecs_to_jiffies(sec * 1000));
+}
+
+static int chg_sm_show(struct seq_file *m, void *v)
+{
+        struct oppo_chg_sm_stats *st;
+        struct oppo_chg_sm_transition *t;
+        unsigned long i, first;
+
+        if (!g_charger_chip) {
+                return -ENODEV;
+        }
+        st = kmalloc(sizeof(*st), GFP_KERNEL);
+        if (!st) {
+                return -ENOMEM;
+        }
+        oppo_chg_sm_get_stats(g_charger_chip, st);
+
+        seq_printf(m, "state: %s\n", oppo_chg_sm_names[g_charger_chip->sm_state]);
+        seq_printf(m, "passes: %lu timer: %lu\n", st->passes, st->timer_passes);
+        seq_puts(m, "events:");
+        for (i = 0; i < CHG_EVENT_NUM; i++) {
+                seq_printf(m, " %s %lu", oppo_chg_event_names[i], st->events[i]);
+        }
+        seq_puts(m, "\nstate_ms:");
+        for (i = 0; i < CHG_SM__MAX; i++) {
+                seq_printf(m, " %s %llu", oppo_chg_sm_names[i], st->state_ms[i]);
+        }
+        seq_printf(m, "\ntransitions: %lu\n", st->transitions);
+        first = st->transitions > CHG_SM_LOG_SIZE ? st->transitions - CHG_SM_LOG_SIZE : 0;
+        for (i = first; i < st->transitions; i++) {
+                t = &st->log[i % CHG_SM_LOG_SIZE];
+                seq_printf(m, "  %llu %s -> %s events 0x%x latency_ms %u\n",
+                        t->time_ms, oppo_chg_sm_names[t->from], oppo_chg_sm_names[t->to],
+                        t->events, t->latency_ms);
+        }
+        kfree(st);
+        return 0;
+}
+
+static int chg_sm_open(struct inode *inode, struct file *file)
+{
+        return single_open(file, chg_sm_show, NULL);
+}
+
+static const struct file_operations chg_sm_proc_fops = {
+        .open = chg_sm_open,
+        .read = seq_read,
+        .llseek = seq_lseek,
+        .release = single_release,
+};
+
+static void init_proc_chg_sm(void)
+{
+        if (!proc_create("charger_sm", 0444, NULL, &chg_sm_proc_fops)) {
+                chg_err("proc_create chg_sm_proc_fops fail!\n");
+        }
+}
+
 static void oppo_chg_update_work(struct work_struct *work)
 {
         struct delayed_work *dwork = to_delayed_work(work);
         struct oppo_chg_chip *chip = container_of(dwork, struct oppo_chg_chip, update_work);
+        unsigned long events;
+        u64 since_ms;
+
+        events = oppo_chg_sm_begin(chip, &since_ms);
 
         oppo_charger_detect_check(chip);
         oppo_chg_get_battery_data(chip);
@@ -6257,19 +6521,21 @@ static void oppo_chg_update_work(struct work_struct *work)
 
         oppo_chg_other_thing(chip);
 
-        /* run again after interval */
-        schedule_delayed_work(&chip->update_work, OPPO_CHG_UPDATE_INTERVAL);
+        oppo_chg_sm_end(chip, events, since_ms);
+        /* ui_soc updates from resume and oppo_chg_soc_update() count one period */
+        chip->sm_ticks = 1;
+
+        /* run again when the state needs it, events come in earlier */
+        schedule_delayed_work(&chip->update_work, oppo_chg_sm_interval(chip));
 }
 
 bool oppo_chg_wake_update_work(void)
 {
-        int shedule_work = 0;
-
         if (!g_charger_chip) {
                 chg_err(" g_charger_chip NULL,return\n");
                 return true;
         }
-        shedule_work = mod_delayed_work(system_wq, &g_charger_chip->update_work, 0);
+        oppo_chg_post_event(g_charger_chip, CHG_EVENT__ADAPTER);
 
         return true;
 }
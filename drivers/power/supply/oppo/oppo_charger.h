@@ -238,6 +238,47 @@ typedef enum {
         VOOC_TEMP_STATUS__HIGH,                            /*>38 && <=45C*/
 }OPPO_CHG_TBAT_VOOC_STATUS;
 
+/* States of the charger core, see oppo_chg_sm_next() */
+typedef enum {
+        CHG_SM__NO_CHARGER = 0,
+        CHG_SM__DETECT,                                 /*plugged, type and current not settled*/
+        CHG_SM__CHARGING,
+        CHG_SM__FASTCHG,                                /*vooc owns the gauge*/
+        CHG_SM__FULL,
+        CHG_SM__FAULT,                                  /*stopped by temp, vchg, vbat or timeout*/
+        CHG_SM__MAX,
+}OPPO_CHG_SM_STATE;
+
+/* Reasons to run the update work, posted with oppo_chg_post_event() */
+typedef enum {
+        CHG_EVENT__USB                          =        (1 << 0),        /*plug in/out, type detected*/
+        CHG_EVENT__ADAPTER                      =        (1 << 1),        /*fast charge adapter, vooc*/
+        CHG_EVENT__GAUGE                        =        (1 << 2),        /*soc, voltage or current alert*/
+        CHG_EVENT__TEMP                         =        (1 << 3),        /*battery temperature alert*/
+        CHG_EVENT__USER                         =        (1 << 4),        /*property and proc writes*/
+        CHG_EVENT__TIMER                        =        (1 << 5),        /*poll interval of the state expired*/
+}OPPO_CHG_EVENT;
+
+#define CHG_EVENT_NUM                   6
+#define CHG_SM_LOG_SIZE                 32
+
+struct oppo_chg_sm_transition {
+        u64                     time_ms;                /*boot time of the transition*/
+        u32                     latency_ms;             /*since the first event of the pass was posted*/
+        u8                      from;
+        u8                      to;
+        u16                     events;
+};
+
+struct oppo_chg_sm_stats {
+        unsigned long           passes;                 /*update work runs*/
+        unsigned long           timer_passes;           /*of which only the poll timer expired*/
+        unsigned long           events[CHG_EVENT_NUM];
+        unsigned long           transitions;
+        u64                     state_ms[CHG_SM__MAX];
+        struct oppo_chg_sm_transition log[CHG_SM_LOG_SIZE];   /*last transitions, log[transitions % CHG_SM_LOG_SIZE] is next*/
+};
+
 struct tbatt_anti_shake{
         int cold_bound;
         int little_cold_bound;
@@ -720,6 +761,15 @@ struct oppo_chg_chip {
 	OPPO_CHG_AP_TEMP_STAT ap_sm;
 	OPPO_CHG_BATT_TEMP_EXTEND_STAT jeita_sm;
 #endif /*ODM_WT_EDIT*/
+        OPPO_CHG_SM_STATE           sm_state;
+        spinlock_t                  sm_lock;
+        unsigned long               sm_events;          /*pending CHG_EVENT__ bits*/
+        u64                         sm_event_ms;        /*when the first pending event was posted*/
+        u64                         sm_entered_ms;
+        unsigned long               sm_last_pass;       /*jiffies*/
+        int                         sm_carry_ms;
+        int                         sm_ticks;           /*OPPO_CHG_UPDATE_INTERVAL periods covered by this pass*/
+        struct oppo_chg_sm_stats    sm_stats;
 };
 
 
@@ -837,6 +887,9 @@ void oppo_charger_detect_check(struct oppo_chg_chip *chip);
 int oppo_chg_get_prop_batt_health(struct oppo_chg_chip *chip);
 
 bool oppo_chg_wake_update_work(void);
+void oppo_chg_post_event(struct oppo_chg_chip *chip, unsigned long events);
+void oppo_chg_sm_get_stats(struct oppo_chg_chip *chip, struct oppo_chg_sm_stats *stats);
+const char *oppo_chg_sm_state_name(int state);
 void oppo_chg_soc_update_when_resume(unsigned long sleep_tm_sec);
 void oppo_chg_soc_update(void);
 int oppo_chg_get_batt_volt(void);
@@ -0,0 +1,62 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0
+#
+# Replays a charge session on the fake charger and gauge IC
+# (CONFIG_OPPO_CHARGER_FAKE_IC) and prints the report.
+#
+#   chg_replay.sh [session file]
+#
+# Without a file a plug, charge, hot battery, full and unplug session is
+# replayed. The session takes a few minutes, the time the core needs to
+# see full and to go through its poll intervals.
+
+D=/sys/kernel/debug/oppo_chg_fake
+
+if [ ! -w $D/session ]; then
+	echo "$D not available, fake IC not built in or not root?"
+	exit 4
+fi
+
+default_session()
+{
+	cat <<-SESSION
+	# idle, discharging
+	soc 60
+	vbat 3900
+	ibat -300
+	temp 250
+	wait 60000
+	# charging
+	plug dcp
+	ibat 1500
+	wait 30000
+	soc 75
+	vbat 4100
+	wait 20000
+	# battery too hot, then back
+	temp 560
+	wait 20000
+	temp 300
+	wait 20000
+	# full
+	soc 100
+	vbat 4400
+	ibat -50
+	wait 60000
+	unplug
+	ibat -300
+	wait 60000
+	SESSION
+}
+
+if [ -n "$1" ]; then
+	cat "$1" > $D/session || exit 1
+else
+	default_session > $D/session || exit 1
+fi
+
+while grep -q "session: running" $D/report; do
+	sleep 5
+done
+cat $D/report
+cat /proc/charger_sm
@@ -0,0 +1,851 @@
+/**********************************************************************************
+* Description: Fake gauge and charger IC for the charger core.
+*                 Stands in for the charger and gauge drivers so charge
+*                 sessions can be replayed without hardware.
+* ------------------------------ Revision History: --------------------------------
+* <version>           <date>                <desc>
+* Revision 1.0        2020-03-02            Created for charger state machine tests
+***********************************************************************************/
+
+/*
+ * Binds to a "oppo,fake-charger" node, registers the usb, ac and battery
+ * power supplies and runs the charger core on top of a simulated charger
+ * and gauge. Every register access the real ICs would do over I2C is
+ * counted.
+ *
+ * A session is a script written to debugfs oppo_chg_fake/session, one
+ * command per line, '#' starts a comment:
+ *
+ *   plug usb|cdp|dcp      charger in, posts a usb event
+ *   unplug                charger out, posts a usb event
+ *   soc <pct>             gauge readings, each posts a gauge event
+ *   vbat <mv>
+ *   ibat <ma>
+ *   temp <decidegc>       battery temperature, posts a temp event
+ *   wait <ms>             let the core run
+ *
+ * The session is replayed right away. oppo_chg_fake/report shows the
+ * update passes (wakeups), I2C transactions and the state transitions of
+ * the session with the time from the stimulus to the new state.
+ */
+
+#define pr_fmt(fmt) "[OPPO_CHG][fake_ic] " fmt
+
+#include <linux/atomic.h>
+#include <linux/debugfs.h>
+#include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/power_supply.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/workqueue.h>
+
+#include "../oppo_charger.h"
+#include "../oppo_gauge.h"
+
+#define FAKE_SESSION_MAX        4096
+#define FAKE_STIMULI_MAX        64
+
+struct fake_stimulus {
+        u64                     time_ms;
+        char                    cmd[24];
+};
+
+struct fake_ic {
+        struct oppo_chg_chip    *chip;
+        struct oppo_gauge_chip  gauge;
+        struct dentry           *debugfs;
+
+        /* simulated hardware */
+        bool                    plugged;
+        int                     charger_type;
+        bool                    chg_enabled;
+        bool                    suspended;
+        int                     ichg_ma;
+        int                     icl_ma;
+        int                     fv_mv;
+        int                     soc;
+        int                     vbat_mv;
+        int                     ibat_ma;
+        int                     temp;
+
+        atomic_t                reads;
+        atomic_t                writes;
+
+        /* replay */
+        struct mutex            lock;
+        struct work_struct      replay_work;
+        char                    *session;
+        bool                    running;
+        u64                     start_ms;
+        u64                     end_ms;
+        int                     reads_base;
+        int                     writes_base;
+        struct oppo_chg_sm_stats base;
+        struct fake_stimulus    stimuli[FAKE_STIMULI_MAX];
+        int                     nr_stimuli;
+};
+
+static struct fake_ic *fake;
+
+static u64 fake_now_ms(void)
+{
+        return div_u64(ktime_get_boot_ns(), NSEC_PER_MSEC);
+}
+
+static int fake_read(int val)
+{
+        atomic_inc(&fake->reads);
+        return val;
+}
+
+static int fake_write(void)
+{
+        atomic_inc(&fake->writes);
+        return 0;
+}
+
+/*--------------------------- charger ---------------------------*/
+
+static void fake_dump_registers(void)
+{
+        /* a real dump reads the whole register map */
+        atomic_add(16, &fake->reads);
+}
+
+static int fake_kick_wdt(void)
+{
+        return fake_write();
+}
+
+static int fake_hardware_init(void)
+{
+        fake->suspended = false;
+        fake->chg_enabled = true;
+        atomic_add(4, &fake->writes);
+        return 0;
+}
+
+static int fake_charging_current_write_fast(int cur)
+{
+        fake->ichg_ma = cur;
+        return fake_write();
+}
+
+static int fake_input_current_write(int cur)
+{
+        fake->icl_ma = cur;
+        return fake_write();
+}
+
+static int fake_float_voltage_write(int mv)
+{
+        fake->fv_mv = mv;
+        return fake_write();
+}
+
+static int fake_term_current_set(int cur)
+{
+        return fake_write();
+}
+
+static void fake_set_aicl_point(int vbatt)
+{
+        fake_write();
+}
+
+static int fake_charging_enable(void)
+{
+        fake->chg_enabled = true;
+        return fake_write();
+}
+
+static int fake_charging_disable(void)
+{
+        fake->chg_enabled = false;
+        return fake_write();
+}
+
+static int fake_get_charging_enable(void)
+{
+        return fake_read(fake->chg_enabled);
+}
+
+static int fake_charger_suspend(void)
+{
+        fake->suspended = true;
+        return fake_write();
+}
+
+static int fake_charger_unsuspend(void)
+{
+        fake->suspended = false;
+        return fake_write();
+}
+
+static int fake_set_rechg_vol(int vol)
+{
+        return fake_write();
+}
+
+static int fake_reset_charger(void)
+{
+        return fake_write();
+}
+
+static int fake_read_full(void)
+{
+        return fake_read(fake->soc >= 100 && fake->ibat_ma > -100);
+}
+
+static int fake_otg_enable(void)
+{
+        return fake_write();
+}
+
+static int fake_otg_disable(void)
+{
+        return fake_write();
+}
+
+static int fake_set_charging_term_disable(void)
+{
+        return fake_write();
+}
+
+static bool fake_check_charger_resume(void)
+{
+        return true;
+}
+
+static int fake_get_charger_type(void)
+{
+        return fake_read(fake->plugged ? fake->charger_type : POWER_SUPPLY_TYPE_UNKNOWN);
+}
+
+static int fake_get_charger_volt(void)
+{
+        return fake_read(fake->plugged ? 5000 : 0);
+}
+
+static int fake_get_chargerid_volt(void)
+{
+        return 0;
+}
+
+static void fake_set_chargerid_switch_val(int value)
+{
+}
+
+static int fake_get_chargerid_switch_val(void)
+{
+        return 0;
+}
+
+static bool fake_check_chrdet_status(void)
+{
+        return fake_read(fake->plugged);
+}
+
+static int fake_get_boot_mode(void)
+{
+        return 0;
+}
+
+static int fake_get_boot_reason(void)
+{
+        return 0;
+}
+
+static int fake_get_instant_vbatt(void)
+{
+        return fake_read(fake->vbat_mv);
+}
+
+static int fake_get_rtc_soc(void)
+{
+        return fake->soc;
+}
+
+static int fake_set_rtc_soc(int val)
+{
+        return 0;
+}
+
+static void fake_set_power_off(void)
+{
+}
+
+static void fake_usb_connect(void)
+{
+}
+
+static void fake_usb_disconnect(void)
+{
+}
+
+#ifndef CONFIG_OPPO_CHARGER_MTK
+static int fake_get_aicl_ma(void)
+{
+        return fake_read(fake->icl_ma);
+}
+
+static void fake_rerun_aicl(void)
+{
+        fake_write();
+}
+
+static int fake_tlim_en(bool enable)
+{
+        return fake_write();
+}
+
+static int fake_set_system_temp_level(int level)
+{
+        return fake_write();
+}
+
+static int fake_otg_pulse_skip_disable(enum skip_reason reason, bool disable)
+{
+        return fake_write();
+}
+
+static int fake_set_dp_dm(int val)
+{
+        return fake_write();
+}
+
+static int fake_calc_flash_current(void)
+{
+        return 0;
+}
+#endif
+
+static int fake_get_chg_current_step(void)
+{
+        return 64;
+}
+
+static bool fake_need_to_check_ibatt(void)
+{
+        return false;
+}
+
+static int fake_get_dyna_aicl_result(void)
+{
+        return fake_read(fake->icl_ma);
+}
+
+static bool fake_get_shortc_hw_gpio_status(void)
+{
+        return true;
+}
+
+static int fake_get_charger_subtype(void)
+{
+        return CHARGER_SUBTYPE_DEFAULT;
+}
+
+static const struct oppo_chg_operations fake_chg_ops = {
+        .dump_registers = fake_dump_registers,
+        .kick_wdt = fake_kick_wdt,
+        .hardware_init = fake_hardware_init,
+        .charging_current_write_fast = fake_charging_current_write_fast,
+        .set_aicl_point = fake_set_aicl_point,
+        .input_current_write = fake_input_current_write,
+        .float_voltage_write = fake_float_voltage_write,
+        .term_current_set = fake_term_current_set,
+        .charging_enable = fake_charging_enable,
+        .charging_disable = fake_charging_disable,
+        .get_charging_enable = fake_get_charging_enable,
+        .charger_suspend = fake_charger_suspend,
+        .charger_unsuspend = fake_charger_unsuspend,
+        .set_rechg_vol = fake_set_rechg_vol,
+        .reset_charger = fake_reset_charger,
+        .read_full = fake_read_full,
+        .otg_enable = fake_otg_enable,
+        .otg_disable = fake_otg_disable,
+        .set_charging_term_disable = fake_set_charging_term_disable,
+        .check_charger_resume = fake_check_charger_resume,
+        .get_charger_type = fake_get_charger_type,
+        .get_charger_volt = fake_get_charger_volt,
+        .get_chargerid_volt = fake_get_chargerid_volt,
+        .set_chargerid_switch_val = fake_set_chargerid_switch_val,
+        .get_chargerid_switch_val = fake_get_chargerid_switch_val,
+        .check_chrdet_status = fake_check_chrdet_status,
+        .get_boot_mode = fake_get_boot_mode,
+        .get_boot_reason = fake_get_boot_reason,
+        .get_instant_vbatt = fake_get_instant_vbatt,
+        .get_rtc_soc = fake_get_rtc_soc,
+        .set_rtc_soc = fake_set_rtc_soc,
+        .set_power_off = fake_set_power_off,
+        .usb_connect = fake_usb_connect,
+        .usb_disconnect = fake_usb_disconnect,
+#ifndef CONFIG_OPPO_CHARGER_MTK
+        .get_aicl_ma = fake_get_aicl_ma,
+        .rerun_aicl = fake_rerun_aicl,
+        .tlim_en = fake_tlim_en,
+        .set_system_temp_level = fake_set_system_temp_level,
+        .otg_pulse_skip_disable = fake_otg_pulse_skip_disable,
+        .set_dp_dm = fake_set_dp_dm,
+        .calc_flash_current = fake_calc_flash_current,
+#endif
+        .get_chg_current_step = fake_get_chg_current_step,
+        .need_to_check_ibatt = fake_need_to_check_ibatt,
+        .get_dyna_aicl_result = fake_get_dyna_aicl_result,
+        .get_shortc_hw_gpio_status = fake_get_shortc_hw_gpio_status,
+        .get_charger_subtype = fake_get_charger_subtype,
+};
+
+/*--------------------------- gauge ---------------------------*/
+
+static int fake_gauge_mvolts(void)
+{
+        return fake_read(fake->vbat_mv);
+}
+
+static int fake_gauge_temperature(void)
+{
+        return fake_read(fake->temp);
+}
+
+static int fake_gauge_soc(void)
+{
+        return fake_read(fake->soc);
+}
+
+static int fake_gauge_current(void)
+{
+        return fake_read(fake->ibat_ma);
+}
+
+static int fake_gauge_fcc(void)
+{
+        return fake_read(4000);
+}
+
+static int fake_gauge_rm(void)
+{
+        return fake_read(40 * fake->soc);
+}
+
+static int fake_gauge_cc(void)
+{
+        return fake_read(10);
+}
+
+static int fake_gauge_soh(void)
+{
+        return fake_read(100);
+}
+
+static bool fake_gauge_authenticate(void)
+{
+        return true;
+}
+
+static void fake_gauge_set_full(bool full)
+{
+}
+
+/* what the gauge driver caches for vooc, no bus access */
+static int fake_gauge_prev_mvolts(void)
+{
+        return fake->vbat_mv;
+}
+
+static int fake_gauge_prev_temperature(void)
+{
+        return fake->temp;
+}
+
+static int fake_gauge_prev_soc(void)
+{
+        return fake->soc;
+}
+
+static int fake_gauge_prev_current(void)
+{
+        return fake->ibat_ma;
+}
+
+static int fake_gauge_prev_rm(void)
+{
+        return 40 * fake->soc;
+}
+
+static int fake_gauge_update(void)
+{
+        return fake_write();
+}
+
+static struct oppo_gauge_operations fake_gauge_ops = {
+        .get_battery_mvolts = fake_gauge_mvolts,
+        .get_battery_temperature = fake_gauge_temperature,
+        .get_batt_remaining_capacity = fake_gauge_rm,
+        .get_battery_soc = fake_gauge_soc,
+        .get_average_current = fake_gauge_current,
+        .get_battery_fcc = fake_gauge_fcc,
+        .get_battery_cc = fake_gauge_cc,
+        .get_battery_soh = fake_gauge_soh,
+        .get_battery_authenticate = fake_gauge_authenticate,
+        .set_battery_full = fake_gauge_set_full,
+        .get_prev_battery_mvolts = fake_gauge_prev_mvolts,
+        .get_prev_battery_temperature = fake_gauge_prev_temperature,
+        .get_prev_battery_soc = fake_gauge_prev_soc,
+        .get_prev_average_current = fake_gauge_prev_current,
+        .get_prev_batt_remaining_capacity = fake_gauge_prev_rm,
+        .get_battery_mvolts_2cell_max = fake_gauge_mvolts,
+        .get_battery_mvolts_2cell_min = fake_gauge_mvolts,
+        .get_prev_battery_mvolts_2cell_max = fake_gauge_prev_mvolts,
+        .get_prev_battery_mvolts_2cell_min = fake_gauge_prev_mvolts,
+        .update_battery_dod0 = fake_gauge_update,
+        .update_soc_smooth_parameter = fake_gauge_update,
+};
+
+/*--------------------------- replay ---------------------------*/
+
+static void fake_stimulus(const char *cmd)
+{
+        struct fake_stimulus *s;
+
+        mutex_lock(&fake->lock);
+        if (fake->nr_stimuli < FAKE_STIMULI_MAX) {
+                s = &fake->stimuli[fake->nr_stimuli++];
+                s->time_ms = fake_now_ms();
+                strlcpy(s->cmd, cmd, sizeof(s->cmd));
+        }
+        mutex_unlock(&fake->lock);
+}
+
+static int fake_run_line(char *line)
+{
+        char cmd[16], arg[16];
+        int n, val = 0;
+
+        n = sscanf(line, "%15s %15s", cmd, arg);
+        if (n < 1 || cmd[0] == '#') {
+                return 0;
+        }
+        if (n == 2 && strcmp(cmd, "plug") && kstrtoint(arg, 0, &val)) {
+                return -EINVAL;
+        }
+
+        if (!strcmp(cmd, "wait")) {
+                msleep(val);
+                return 0;
+        }
+        fake_stimulus(line);
+
+        if (!strcmp(cmd, "plug") && n == 2) {
+                if (!strcmp(arg, "usb")) {
+                        fake->charger_type = POWER_SUPPLY_TYPE_USB;
+                } else if (!strcmp(arg, "cdp")) {
+                        fake->charger_type = POWER_SUPPLY_TYPE_USB_CDP;
+                } else if (!strcmp(arg, "dcp")) {
+                        fake->charger_type = POWER_SUPPLY_TYPE_USB_DCP;
+                } else {
+                        return -EINVAL;
+                }
+                fake->plugged = true;
+                oppo_chg_post_event(fake->chip, CHG_EVENT__USB);
+        } else if (!strcmp(cmd, "unplug")) {
+                fake->plugged = false;
+                fake->chg_enabled = false;
+                oppo_chg_post_event(fake->chip, CHG_EVENT__USB);
+        } else if (!strcmp(cmd, "soc") && n == 2) {
+                fake->soc = val;
+                oppo_chg_post_event(fake->chip, CHG_EVENT__GAUGE);
+        } else if (!strcmp(cmd, "vbat") && n == 2) {
+                fake->vbat_mv = val;
+                oppo_chg_post_event(fake->chip, CHG_EVENT__GAUGE);
+        } else if (!strcmp(cmd, "ibat") && n == 2) {
+                fake->ibat_ma = val;
+                oppo_chg_post_event(fake->chip, CHG_EVENT__GAUGE);
+        } else if (!strcmp(cmd, "temp") && n == 2) {
+                fake->temp = val;
+                oppo_chg_post_event(fake->chip, CHG_EVENT__TEMP);
+        } else {
+                return -EINVAL;
+        }
+        return 0;
+}
+
+static void fake_replay_work(struct work_struct *work)
+{
+        char *p, *line;
+        int lineno = 0, ret;
+
+        p = fake->session;
+        while ((line = strsep(&p, "\n")) != NULL) {
+                lineno++;
+                line = strim(line);
+                ret = fake_run_line(line);
+                if (ret) {
+                        pr_err("session line %d: bad command '%s'\n", lineno, line);
+                        break;
+                }
+        }
+
+        mutex_lock(&fake->lock);
+        kfree(fake->session);
+        fake->session = NULL;
+        fake->end_ms = fake_now_ms();
+        fake->running = false;
+        mutex_unlock(&fake->lock);
+}
+
+static ssize_t fake_session_write(struct file *file, const char __user *buf,
+                                  size_t len, loff_t *ppos)
+{
+        char *session;
+
+        if (len >= FAKE_SESSION_MAX) {
+                return -E2BIG;
+        }
+        session = memdup_user_nul(buf, len);
+        if (IS_ERR(session)) {
+                return PTR_ERR(session);
+        }
+
+        mutex_lock(&fake->lock);
+        if (fake->running) {
+                mutex_unlock(&fake->lock);
+                kfree(session);
+                return -EBUSY;
+        }
+        fake->running = true;
+        fake->session = session;
+        fake->nr_stimuli = 0;
+        fake->reads_base = atomic_read(&fake->reads);
+        fake->writes_base = atomic_read(&fake->writes);
+        oppo_chg_sm_get_stats(fake->chip, &fake->base);
+        fake->start_ms = fake_now_ms();
+        fake->end_ms = 0;
+        mutex_unlock(&fake->lock);
+
+        queue_work(system_unbound_wq, &fake->replay_work);
+
+        return len;
+}
+
+static const struct file_operations fake_session_fops = {
+        .write = fake_session_write,
+        .llseek = noop_llseek,
+};
+
+/* Latency of a transition is counted from the last stimulus before it */
+static s64 fake_stimulus_latency(u64 time_ms, const char **cmd)
+{
+        int i;
+
+        for (i = fake->nr_stimuli - 1; i >= 0; i--) {
+                if (fake->stimuli[i].time_ms <= time_ms) {
+                        *cmd = fake->stimuli[i].cmd;
+                        return time_ms - fake->stimuli[i].time_ms;
+                }
+        }
+        *cmd = "start";
+        return time_ms - fake->start_ms;
+}
+
+static int fake_report_show(struct seq_file *m, void *v)
+{
+        struct oppo_chg_sm_stats *st;
+        struct oppo_chg_sm_transition *t;
+        unsigned long i, first;
+        const char *cmd;
+        u64 end;
+        s64 lat;
+
+        st = kmalloc(sizeof(*st), GFP_KERNEL);
+        if (!st) {
+                return -ENOMEM;
+        }
+        oppo_chg_sm_get_stats(fake->chip, st);
+
+        mutex_lock(&fake->lock);
+        end = fake->running ? fake_now_ms() : fake->end_ms;
+        seq_printf(m, "session: %s, %llu ms\n", fake->running ? "running" : "done",
+                fake->start_ms ? end - fake->start_ms : 0);
+        seq_printf(m, "wakeups: %lu timer %lu\n", st->passes - fake->base.passes,
+                st->timer_passes - fake->base.timer_passes);
+        seq_printf(m, "i2c: reads %d writes %d\n",
+                atomic_read(&fake->reads) - fake->reads_base,
+                atomic_read(&fake->writes) - fake->writes_base);
+        seq_printf(m, "state: %s\n", oppo_chg_sm_state_name(fake->chip->sm_state));
+        seq_puts(m, "state_ms:");
+        for (i = 0; i < CHG_SM__MAX; i++) {
+                seq_printf(m, " %s %llu", oppo_chg_sm_state_name(i),
+                        st->state_ms[i] - fake->base.state_ms[i]);
+        }
+        seq_printf(m, "\ntransitions: %lu\n", st->transitions - fake->base.transitions);
+
+        first = max(fake->base.transitions,
+                st->transitions > CHG_SM_LOG_SIZE ? st->transitions - CHG_SM_LOG_SIZE : 0);
+        for (i = first; i < st->transitions; i++) {
+                t = &st->log[i % CHG_SM_LOG_SIZE];
+                lat = fake_stimulus_latency(t->time_ms, &cmd);
+                seq_printf(m, "  +%llu ms %s -> %s events 0x%x, %lld ms after '%s'\n",
+                        t->time_ms - fake->start_ms,
+                        oppo_chg_sm_state_name(t->from), oppo_chg_sm_state_name(t->to),
+                        t->events, lat, cmd);
+        }
+        mutex_unlock(&fake->lock);
+
+        kfree(st);
+        return 0;
+}
+
+static int fake_report_open(struct inode *inode, struct file *file)
+{
+        return single_open(file, fake_report_show, NULL);
+}
+
+static const struct file_operations fake_report_fops = {
+        .open = fake_report_open,
+        .read = seq_read,
+        .llseek = seq_lseek,
+        .release = single_release,
+};
+
+/*--------------------------- probe ---------------------------*/
+
+static enum power_supply_property fake_usb_props[] = {
+        POWER_SUPPLY_PROP_ONLINE,
+};
+
+static enum power_supply_property fake_ac_props[] = {
+        POWER_SUPPLY_PROP_ONLINE,
+};
+
+static enum power_supply_property fake_batt_props[] = {
+        POWER_SUPPLY_PROP_STATUS,
+        POWER_SUPPLY_PROP_CAPACITY,
+        POWER_SUPPLY_PROP_TEMP,
+        POWER_SUPPLY_PROP_VOLTAGE_NOW,
+        POWER_SUPPLY_PROP_CURRENT_NOW,
+};
+
+static int fake_register_psy(struct oppo_chg_chip *chip)
+{
+        chip->usb_psd.name = "usb";
+        chip->usb_psd.type = POWER_SUPPLY_TYPE_USB;
+        chip->usb_psd.properties = fake_usb_props;
+        chip->usb_psd.num_properties = ARRAY_SIZE(fake_usb_props);
+        chip->usb_psd.get_property = oppo_usb_get_property;
+        chip->usb_psy = power_supply_register(chip->dev, &chip->usb_psd, NULL);
+        if (IS_ERR(chip->usb_psy)) {
+                return PTR_ERR(chip->usb_psy);
+        }
+
+        chip->ac_psd.name = "ac";
+        chip->ac_psd.type = POWER_SUPPLY_TYPE_MAINS;
+        chip->ac_psd.properties = fake_ac_props;
+        chip->ac_psd.num_properties = ARRAY_SIZE(fake_ac_props);
+        chip->ac_psd.get_property = oppo_ac_get_property;
+        chip->ac_psy = power_supply_register(chip->dev, &chip->ac_psd, NULL);
+        if (IS_ERR(chip->ac_psy)) {
+                power_supply_unregister(chip->usb_psy);
+                return PTR_ERR(chip->ac_psy);
+        }
+
+        chip->battery_psd.name = "battery";
+        chip->battery_psd.type = POWER_SUPPLY_TYPE_BATTERY;
+        chip->battery_psd.properties = fake_batt_props;
+        chip->battery_psd.num_properties = ARRAY_SIZE(fake_batt_props);
+        chip->battery_psd.get_property = oppo_battery_get_property;
+        chip->batt_psy = power_supply_register(chip->dev, &chip->battery_psd, NULL);
+        if (IS_ERR(chip->batt_psy)) {
+                power_supply_unregister(chip->ac_psy);
+                power_supply_unregister(chip->usb_psy);
+                return PTR_ERR(chip->batt_psy);
+        }
+        return 0;
+}
+
+static int fake_ic_probe(struct platform_device *pdev)
+{
+        struct oppo_chg_chip *chip;
+        int rc;
+
+        if (fake) {
+                return -EBUSY;
+        }
+        /* not devm: the gauge and charger core keep pointers into both */
+        fake = kzalloc(sizeof(*fake), GFP_KERNEL);
+        chip = kzalloc(sizeof(*chip), GFP_KERNEL);
+        if (!fake || !chip) {
+                kfree(fake);
+                kfree(chip);
+                fake = NULL;
+                return -ENOMEM;
+        }
+        mutex_init(&fake->lock);
+        INIT_WORK(&fake->replay_work, fake_replay_work);
+        fake->chip = chip;
+        fake->soc = 50;
+        fake->vbat_mv = 3850;
+        fake->ibat_ma = -300;
+        fake->temp = 250;
+
+        chip->dev = &pdev->dev;
+        chip->chg_ops = &fake_chg_ops;
+        oppo_chg_parse_svooc_dt(chip);
+        rc = oppo_chg_parse_charger_dt(chip);
+        if (rc) {
+                kfree(chip);
+                kfree(fake);
+                fake = NULL;
+                return rc;
+        }
+
+        fake->gauge.dev = &pdev->dev;
+        fake->gauge.gauge_ops = &fake_gauge_ops;
+        oppo_gauge_init(&fake->gauge);
+
+        rc = fake_register_psy(chip);
+        if (rc) {
+                goto err;
+        }
+        rc = oppo_chg_init(chip);
+        if (rc) {
+                goto err;
+        }
+
+        fake->debugfs = debugfs_create_dir("oppo_chg_fake", NULL);
+        debugfs_create_file("session", 0200, fake->debugfs, NULL, &fake_session_fops);
+        debugfs_create_file("report", 0444, fake->debugfs, NULL, &fake_report_fops);
+
+        dev_info(&pdev->dev, "fake charger and gauge up\n");
+        return 0;
+err:
+        /* fake stays allocated, the gauge still points at it */
+        dev_err(&pdev->dev, "probe failed %d\n", rc);
+        return rc;
+}
+
+static const struct of_device_id fake_ic_match[] = {
+        { .compatible = "oppo,fake-charger" },
+        { },
+};
+
+static struct platform_driver fake_ic_driver = {
+        .driver = {
+                .name = "oppo_chg_fake_ic",
+                .of_match_table = fake_ic_match,
+                /* the charger core keeps the chip for good */
+                .suppress_bind_attrs = true,
+        },
+        .probe = fake_ic_probe,
+};
+
+builtin_platform_driver(fake_ic_driver);
+
+MODULE_DESCRIPTION("Fake charger and gauge IC for the OPPO charger core");
+MODULE_LICENSE("GPL");
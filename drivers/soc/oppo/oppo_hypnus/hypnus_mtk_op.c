@@ -33,7 +33,6 @@
 
 static struct pm_qos_request hypnus_ddr_qos_request;
 
-extern void sched_get_nr_running_avg(int *avg, int *iowait_avg);
 extern int mt_gpufreq_scene_protect(unsigned int min_freq, unsigned int max_freq);
 extern int set_sched_boost(unsigned int val);
 extern int sched_deisolate_cpu(int cpu);
@@ -66,9 +65,12 @@ enum {
 	NR_IDX_POWER_MIN_LIMITED,
 };
 
+/* hypnus is polled by its daemon, average over a few hundred ms */
+#define HYPNUS_RUNNING_AVG_HL_MS	256
+
 static int mt_get_running_avg(int *avg, int *big_avg, int *iowait)
 {
-	sched_get_nr_running_avg(avg, iowait);
+	sched_get_nr_running_avg_decayed(HYPNUS_RUNNING_AVG_HL_MS, avg, iowait);
 	*big_avg = sched_get_nr_heavy_task();
 	if (*avg >= 100 * NR_CPUS)
 		*avg = 100 * NR_CPUS;
@@ -3114,4 +3114,6 @@ void fuse_init_file_inode(struct inode *inode)
 {
 	inode->i_fop = &fuse_file_operations;
 	inode->i_data.a_ops = &fuse_file_aops;
+	/* requests in flight and splice keep page cache pages pinned */
+	mapping_set_pin_prone(&inode->i_data);
 }
@@ -14,6 +14,27 @@
  * limitations under the License.
  */
 
+/*
+ * Foreground UID registry
+ *
+ * Several UIDs can be foreground at once (split screen, picture in
+ * picture, freeform). They are kept in a small open addressing hash set
+ * that is replaced as a whole on every change and published with RCU,
+ * so is_fg() is a lockless O(1) lookup usable from the scheduler, reclaim,
+ * block and network paths. Every change bumps a generation number that
+ * users may cache decisions against, and each UID that enters or leaves
+ * the set is reported on the fg_uid notifier chain.
+ *
+ * /proc/fg_info/fg_uids accepts:
+ *   "uid [uid ...]"	replace the set, a single uid as before
+ *   "add uid"		add one uid
+ *   "del uid"		remove one uid
+ *   "" or "clear"	empty the set
+ * A negative uid is never foreground, so writing one alone still means
+ * no foreground uid, as it did when a single uid was kept.
+ * /proc/fg_info/fg_uids_gen reads the current generation.
+ */
+
 #include <linux/module.h>
 #include <linux/types.h>
 #include <linux/errno.h>
@@ -21,6 +42,13 @@
 #include <linux/proc_fs.h>
 #include <linux/fs.h>
 #include <linux/seq_file.h>
+#include <linux/hash.h>
+#include <linux/log2.h>
+#include <linux/mutex.h>
+#include <linux/notifier.h>
+#include <linux/rcupdate.h>
+#include <linux/slab.h>
+#include <linux/cred.h>
 #include <asm/uaccess.h>
 #include <linux/uaccess.h>
 #include "internal.h"
@@ -28,25 +56,254 @@
 
 #define FG_RW (S_IWUSR|S_IRUSR|S_IWGRP|S_IRGRP|S_IWOTH|S_IROTH)
 
-struct fg_info fginfo = {
-    .fg_num = 0,
-    .fg_uids = -555,
+#define FG_UID_SLOT_EMPTY	(-1)
+#define FG_UID_NONE		(-555)	/* shown for an empty set */
+
+/* load factor at most 1/2, there is always an empty slot to stop a probe */
+struct fg_uid_set {
+	struct rcu_head rcu;
+	unsigned int nr;
+	unsigned int bits;
+	int slot[];
 };
 
+static struct fg_uid_set __rcu *fg_uid_set;
+static unsigned long fg_uid_gen;
+static DEFINE_MUTEX(fg_uid_lock);
+static BLOCKING_NOTIFIER_HEAD(fg_uid_chain);
+
 static struct proc_dir_entry *fg_dir;
 
+static bool fg_uid_set_has(const struct fg_uid_set *s, int uid)
+{
+	u32 mask, i;
+
+	if (!s)
+		return false;
+
+	mask = (1U << s->bits) - 1;
+	for (i = hash_32((u32)uid, s->bits); s->slot[i] != FG_UID_SLOT_EMPTY;
+	     i = (i + 1) & mask) {
+		if (s->slot[i] == uid)
+			return true;
+	}
+
+	return false;
+}
+
 bool is_fg(int uid)
 {
-    bool ret = false;
-    if (uid == fginfo.fg_uids)
-	ret = true;
-    return ret;
+	bool ret;
+
+	rcu_read_lock();
+	ret = fg_uid_set_has(rcu_dereference(fg_uid_set), uid);
+	rcu_read_unlock();
+
+	return ret;
+}
+EXPORT_SYMBOL(is_fg);
+
+unsigned long fg_uid_generation(void)
+{
+	return READ_ONCE(fg_uid_gen);
+}
+EXPORT_SYMBOL(fg_uid_generation);
+
+int fg_uid_register_notifier(struct notifier_block *nb)
+{
+	return blocking_notifier_chain_register(&fg_uid_chain, nb);
+}
+EXPORT_SYMBOL(fg_uid_register_notifier);
+
+int fg_uid_unregister_notifier(struct notifier_block *nb)
+{
+	return blocking_notifier_chain_unregister(&fg_uid_chain, nb);
 }
+EXPORT_SYMBOL(fg_uid_unregister_notifier);
+
+/* duplicates are dropped, NULL with no error for an empty set */
+static struct fg_uid_set *fg_uid_build(const int *uids, unsigned int nr,
+		int *err)
+{
+	struct fg_uid_set *s;
+	unsigned int bits, i;
+	u32 mask, h;
+
+	*err = 0;
+	if (!nr)
+		return NULL;
+
+	bits = max_t(unsigned int, ilog2(nr) + 2, 2);
+	s = kmalloc(sizeof(*s) + (sizeof(int) << bits), GFP_KERNEL);
+	if (!s) {
+		*err = -ENOMEM;
+		return NULL;
+	}
+
+	s->nr = 0;
+	s->bits = bits;
+	mask = (1U << bits) - 1;
+	memset(s->slot, 0xff, sizeof(int) << bits);	/* FG_UID_SLOT_EMPTY */
+
+	for (i = 0; i < nr; i++) {
+		for (h = hash_32((u32)uids[i], bits);
+		     s->slot[h] != FG_UID_SLOT_EMPTY; h = (h + 1) & mask)
+			if (s->slot[h] == uids[i])
+				break;
+		if (s->slot[h] == FG_UID_SLOT_EMPTY) {
+			s->slot[h] = uids[i];
+			s->nr++;
+		}
+	}
+
+	return s;
+}
+
+static void fg_uid_notify(const struct fg_uid_set *from,
+		const struct fg_uid_set *to, unsigned long action,
+		unsigned long gen)
+{
+	struct fg_uid_event ev = { .gen = gen };
+	u32 i;
+
+	if (!from)
+		return;
+
+	for (i = 0; i < (1U << from->bits); i++) {
+		if (from->slot[i] == FG_UID_SLOT_EMPTY ||
+		    fg_uid_set_has(to, from->slot[i]))
+			continue;
+		ev.uid = from->slot[i];
+		blocking_notifier_call_chain(&fg_uid_chain, action, &ev);
+	}
+}
+
+/* fg_uid_lock held */
+static int fg_uid_publish(const int *uids, unsigned int nr)
+{
+	struct fg_uid_set *old, *new;
+	unsigned long gen;
+	int err;
+
+	new = fg_uid_build(uids, nr, &err);
+	if (err)
+		return err;
+
+	old = rcu_dereference_protected(fg_uid_set,
+			lockdep_is_held(&fg_uid_lock));
+	rcu_assign_pointer(fg_uid_set, new);
+	gen = fg_uid_gen + 1;
+	WRITE_ONCE(fg_uid_gen, gen);
+
+	fg_uid_notify(old, new, FG_UID_DEL, gen);
+	fg_uid_notify(new, old, FG_UID_ADD, gen);
+
+	if (old)
+		kfree_rcu(old, rcu);
+
+	return 0;
+}
+
+/* uids of the current set into buf[max], fg_uid_lock held */
+static unsigned int fg_uid_collect(int *buf, unsigned int max)
+{
+	struct fg_uid_set *s;
+	unsigned int n = 0;
+	u32 i;
+
+	s = rcu_dereference_protected(fg_uid_set,
+			lockdep_is_held(&fg_uid_lock));
+	if (!s)
+		return 0;
+
+	for (i = 0; i < (1U << s->bits) && n < max; i++)
+		if (s->slot[i] != FG_UID_SLOT_EMPTY)
+			buf[n++] = s->slot[i];
+
+	return n;
+}
+
+int fg_uid_replace(const int *uids, unsigned int nr)
+{
+	int ret;
+
+	if (nr > FG_UID_MAX)
+		return -E2BIG;
+
+	mutex_lock(&fg_uid_lock);
+	ret = fg_uid_publish(uids, nr);
+	mutex_unlock(&fg_uid_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL(fg_uid_replace);
+
+static int fg_uid_change(int uid, bool add)
+{
+	int *buf;
+	unsigned int n, i;
+	int ret = 0;
+
+	buf = kmalloc_array(FG_UID_MAX, sizeof(int), GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	mutex_lock(&fg_uid_lock);
+	if (add == is_fg(uid))
+		goto out;
+
+	n = fg_uid_collect(buf, FG_UID_MAX);
+	if (add) {
+		if (n == FG_UID_MAX) {
+			ret = -E2BIG;
+			goto out;
+		}
+		buf[n++] = uid;
+	} else {
+		for (i = 0; i < n; i++) {
+			if (buf[i] == uid) {
+				buf[i] = buf[--n];
+				break;
+			}
+		}
+	}
+	ret = fg_uid_publish(buf, n);
+out:
+	mutex_unlock(&fg_uid_lock);
+	kfree(buf);
+
+	return ret;
+}
+
+int fg_uid_add(int uid)
+{
+	return fg_uid_change(uid, true);
+}
+EXPORT_SYMBOL(fg_uid_add);
+
+int fg_uid_del(int uid)
+{
+	return fg_uid_change(uid, false);
+}
+EXPORT_SYMBOL(fg_uid_del);
 
 static int fg_uids_show(struct seq_file *m, void *v)
 {
-    seq_printf(m, "fg_uids: %d\n", fginfo.fg_uids);
-    return 0;
+	struct fg_uid_set *s;
+	u32 i;
+
+	seq_puts(m, "fg_uids:");
+	rcu_read_lock();
+	s = rcu_dereference(fg_uid_set);
+	if (!s)
+		seq_printf(m, " %d", FG_UID_NONE);
+	for (i = 0; s && i < (1U << s->bits); i++)
+		if (s->slot[i] != FG_UID_SLOT_EMPTY)
+			seq_printf(m, " %d", s->slot[i]);
+	rcu_read_unlock();
+	seq_putc(m, '\n');
+
+	return 0;
 }
 
 static int fg_uids_open(struct inode *inode, struct file *filp)
@@ -54,24 +311,72 @@ static int fg_uids_open(struct inode *inode, struct file *filp)
    return single_open(filp, fg_uids_show, inode);
 }
 
+static int fg_uids_gen_show(struct seq_file *m, void *v)
+{
+	seq_printf(m, "%lu\n", fg_uid_generation());
+	return 0;
+}
+
+static int fg_uids_gen_open(struct inode *inode, struct file *filp)
+{
+   return single_open(filp, fg_uids_gen_show, inode);
+}
+
 static ssize_t fg_uids_write(struct file *file, const char __user *buf,
                         size_t count, loff_t *ppos)
 {
-    char buffer[MAX_ARRAY_LENGTH];
-    int err = 0;
+	char *buffer, *p, *tok;
+	int *uids = NULL;
+	unsigned int nr = 0;
+	long uid;
+	int err = 0;
 
-    memset(buffer, 0, sizeof(buffer));
-    if (count > sizeof(buffer) - 1)
-        count = sizeof(buffer) - 1;
-    if (copy_from_user((void *)buffer, buf, count)) {
-        err = -EFAULT;
-        goto out;
-    }
+	if (count > FG_UID_WRITE_MAX)
+		return -EINVAL;
+
+	buffer = memdup_user_nul(buf, count);
+	if (IS_ERR(buffer))
+		return PTR_ERR(buffer);
 
-    fginfo.fg_uids = simple_strtol(buffer, NULL, 0);
-    fginfo.fg_num = 1;
+	p = strim(buffer);
+	if (!strncmp(p, "add ", 4) || !strncmp(p, "del ", 4)) {
+		err = kstrtol(skip_spaces(p + 4), 0, &uid);
+		if (!err && (uid < 0 || uid > INT_MAX))
+			err = -EINVAL;
+		if (!err)
+			err = *p == 'a' ? fg_uid_add(uid) : fg_uid_del(uid);
+		goto out;
+	}
+
+	uids = kmalloc_array(FG_UID_MAX, sizeof(int), GFP_KERNEL);
+	if (!uids) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	if (strcmp(p, "clear")) {
+		while ((tok = strsep(&p, " \t\n,")) != NULL) {
+			if (!*tok)
+				continue;
+			if (nr == FG_UID_MAX) {
+				err = -E2BIG;
+				goto out;
+			}
+			err = kstrtol(tok, 0, &uid);
+			if (!err && (uid < INT_MIN || uid > INT_MAX))
+				err = -EINVAL;
+			if (err)
+				goto out;
+			if (uid >= 0)
+				uids[nr++] = uid;
+		}
+	}
+
+	err = fg_uid_replace(uids, nr);
 out:
-    return err < 0 ? err : count;
+	kfree(uids);
+	kfree(buffer);
+	return err < 0 ? err : count;
 }
 
 static const struct file_operations proc_fg_uids_operations = {
@@ -82,6 +387,13 @@ static const struct file_operations proc_fg_uids_operations = {
    .release    = single_release,
 };
 
+static const struct file_operations proc_fg_uids_gen_operations = {
+   .open       = fg_uids_gen_open,
+   .read       = seq_read,
+   .llseek     = seq_lseek,
+   .release    = single_release,
+};
+
 static void uids_proc_fs_init(struct proc_dir_entry *p_parent)
 {
     struct proc_dir_entry *p_temp;
@@ -93,6 +405,11 @@ static void uids_proc_fs_init(struct proc_dir_entry *p_parent)
     if (!p_temp)
         goto out_p_temp;
 
+    p_temp = proc_create(FS_FG_UIDS_GEN, S_IRUGO, p_parent,
+			 &proc_fg_uids_gen_operations);
+    if (!p_temp)
+        goto out_p_temp;
+
 out_p_temp:
     return ;
 }
@@ -114,6 +431,7 @@ static  void __exit fg_uids_exit(void)
     if (!fg_dir)
         return ;
 
+    remove_proc_entry(FS_FG_UIDS_GEN, fg_dir);
     remove_proc_entry(FS_FG_UIDS, fg_dir);
 }
 
@@ -18,13 +18,9 @@
 
 #include <linux/spinlock.h>
 
-#define MAX_ARRAY_LENGTH 256
+#define FG_UID_WRITE_MAX (FG_UID_MAX * 12)
 #define FS_FG_INFO_PATH "fg_info"
 #define FS_FG_UIDS "fg_uids"
-
-struct fg_info {
-    int fg_num;
-    int fg_uids;
-};
+#define FS_FG_UIDS_GEN "fg_uids_gen"
 
 #endif /*_FG_UID_H*/
@@ -19,6 +19,7 @@
 #include <linux/shmem_fs.h>
 #include <linux/uaccess.h>
 #include <linux/mm_inline.h>
+#include <linux/ktime.h>
 
 #include <asm/elf.h>
 #include <asm/tlb.h>
@@ -514,13 +515,33 @@ struct mem_size_stats {
 	u64 pss_locked;
 	u64 swap_pss;
 	bool check_shmem_swap;
+#ifdef CONFIG_PROC_PSS_CACHE
+	/* split of pss and private bytes by the rss counter of the page */
+	u64 pss_counter[NR_MM_COUNTERS];
+	unsigned long uss_counter[NR_MM_COUNTERS];
+#endif
 };
 
+#ifdef CONFIG_PROC_PSS_CACHE
+static inline void smaps_account_counter(struct mem_size_stats *mss,
+		int counter, unsigned long private, u64 pss)
+{
+	mss->pss_counter[counter] += pss;
+	mss->uss_counter[counter] += private;
+}
+#else
+static inline void smaps_account_counter(struct mem_size_stats *mss,
+		int counter, unsigned long private, u64 pss)
+{
+}
+#endif
+
 static void smaps_account(struct mem_size_stats *mss, struct page *page,
 		bool compound, bool young, bool dirty, bool locked)
 {
 	int i, nr = compound ? 1 << compound_order(page) : 1;
 	unsigned long size = nr * PAGE_SIZE;
+	int counter = mm_counter(page);
 
 	if (PageAnon(page)) {
 		mss->anonymous += size;
@@ -546,6 +567,8 @@ static void smaps_account(struct mem_size_stats *mss, struct page *page,
 		mss->pss += (u64)size << PSS_SHIFT;
 		if (locked)
 			mss->pss_locked += (u64)size << PSS_SHIFT;
+		smaps_account_counter(mss, counter, size,
+				(u64)size << PSS_SHIFT);
 		return;
 	}
 
@@ -561,6 +584,7 @@ static void smaps_account(struct mem_size_stats *mss, struct page *page,
 			mss->pss += pss / mapcount;
 			if (locked)
 				mss->pss_locked += pss / mapcount;
+			smaps_account_counter(mss, counter, 0, pss / mapcount);
 		} else {
 			if (dirty || PageDirty(page))
 				mss->private_dirty += PAGE_SIZE;
@@ -569,6 +593,7 @@ static void smaps_account(struct mem_size_stats *mss, struct page *page,
 			mss->pss += pss;
 			if (locked)
 				mss->pss_locked += pss;
+			smaps_account_counter(mss, counter, PAGE_SIZE, pss);
 		}
 	}
 }
@@ -799,12 +824,9 @@ void __weak arch_show_smap(struct seq_file *m, struct vm_area_struct *vma)
 {
 }
 
-static int show_smap(struct seq_file *m, void *v, int is_pid)
+static void smap_gather_stats(struct vm_area_struct *vma,
+		struct mem_size_stats *mss)
 {
-	struct proc_maps_private *priv = m->private;
-	struct vm_area_struct *vma = v;
-	struct mem_size_stats mss_stack;
-	struct mem_size_stats *mss;
 	struct mm_walk smaps_walk = {
 		.pmd_entry = smaps_pte_range,
 #ifdef CONFIG_HUGETLB_PAGE
@@ -812,23 +834,6 @@ static int show_smap(struct seq_file *m, void *v, int is_pid)
 #endif
 		.mm = vma->vm_mm,
 	};
-	int ret = 0;
-	bool rollup_mode;
-	bool last_vma;
-
-	if (priv->rollup) {
-		rollup_mode = true;
-		mss = priv->rollup;
-		if (mss->first) {
-			mss->first_vma_start = vma->vm_start;
-			mss->first = false;
-		}
-		last_vma = !m_next_vma(priv, vma);
-	} else {
-		rollup_mode = false;
-		memset(&mss_stack, 0, sizeof(mss_stack));
-		mss = &mss_stack;
-	}
 
 	smaps_walk.private = mss;
 
@@ -857,8 +862,36 @@ static int show_smap(struct seq_file *m, void *v, int is_pid)
 		}
 	}
 #endif
-	/* mmap_sem is held in m_start */
+	/* mmap_sem is held by the caller */
 	walk_page_vma(vma, &smaps_walk);
+}
+
+static int show_smap(struct seq_file *m, void *v, int is_pid)
+{
+	struct proc_maps_private *priv = m->private;
+	struct vm_area_struct *vma = v;
+	struct mem_size_stats mss_stack;
+	struct mem_size_stats *mss;
+	int ret = 0;
+	bool rollup_mode;
+	bool last_vma;
+
+	if (priv->rollup) {
+		rollup_mode = true;
+		mss = priv->rollup;
+		if (mss->first) {
+			mss->first_vma_start = vma->vm_start;
+			mss->first = false;
+		}
+		last_vma = !m_next_vma(priv, vma);
+	} else {
+		rollup_mode = false;
+		memset(&mss_stack, 0, sizeof(mss_stack));
+		mss = &mss_stack;
+	}
+
+	/* mmap_sem is held in m_start */
+	smap_gather_stats(vma, mss);
 
 	#ifdef VENDOR_EDIT //yixue.ge@bsp.drv modify for android.bg get pss too slow
 	if (strcmp(current->comm, "android.bg") == 0) {
@@ -1025,6 +1058,277 @@ const struct file_operations proc_tid_smaps_operations = {
 	.release	= proc_map_release,
 };
 
+#ifdef CONFIG_PROC_PSS_CACHE
+/*
+ * Cached PSS/USS/swap estimates, /proc/<pid>/pss
+ *
+ * A full smaps walk visits every PTE of the mm, which for a large app
+ * costs tens of milliseconds. The walk is done once and its result is
+ * kept per mm together with the PSS and USS share of every rss counter.
+ * Later reads scale those shares by the current rss counters, which the
+ * rmap and fault paths maintain anyway, so they cost a handful of loads.
+ * The walk is redone when the cache is older than pss_cache_period_ms,
+ * when the rss moved by more than pss_cache_drift_pct since the walk,
+ * or when anything is written to the file.
+ *
+ * Sharing that changes without this mm faulting (another process mapping
+ * or unmapping the same pages) is only seen by the next walk.
+ */
+int sysctl_pss_cache_period_ms = 10000;
+int sysctl_pss_cache_drift_pct = 10;
+
+static const int pss_cache_counters[] = {
+	MM_FILEPAGES, MM_ANONPAGES, MM_SHMEMPAGES,
+};
+
+struct mm_pss_cache {
+	struct mutex lock;
+	unsigned long stamp;		/* jiffies at the last walk */
+	unsigned long walks;
+	u64 walk_ns;			/* duration of the last walk */
+	/* at the last walk, rss in pages, pss in bytes << PSS_SHIFT */
+	unsigned long rss[NR_MM_COUNTERS];
+	u64 pss[NR_MM_COUNTERS];
+	unsigned long uss[NR_MM_COUNTERS];
+	unsigned long swap;
+	u64 swap_pss;
+};
+
+struct pss_estimate {
+	unsigned long rss;
+	u64 pss;
+	u64 pss_counter[NR_MM_COUNTERS];
+	unsigned long uss;
+	unsigned long swap;
+	u64 swap_pss;
+	unsigned long age;		/* ms since the last walk */
+	unsigned long walks;
+	u64 walk_ns;
+};
+
+void proc_pss_cache_free(struct mm_struct *mm)
+{
+	kfree(mm->pss_cache);
+	mm->pss_cache = NULL;
+}
+
+static struct mm_pss_cache *pss_cache_get(struct mm_struct *mm)
+{
+	struct mm_pss_cache *pc = READ_ONCE(mm->pss_cache);
+
+	if (pc)
+		return pc;
+
+	pc = kzalloc(sizeof(*pc), GFP_KERNEL);
+	if (!pc)
+		return NULL;
+	mutex_init(&pc->lock);
+
+	if (cmpxchg(&mm->pss_cache, NULL, pc)) {
+		kfree(pc);
+		pc = READ_ONCE(mm->pss_cache);
+	}
+
+	return pc;
+}
+
+/* pc->lock held */
+static bool pss_cache_stale(struct mm_struct *mm, struct mm_pss_cache *pc)
+{
+	unsigned long then = 0, now, diff;
+	int i, c;
+
+	if (!pc->walks)
+		return true;
+	if (time_after(jiffies, pc->stamp +
+			msecs_to_jiffies(sysctl_pss_cache_period_ms)))
+		return true;
+
+	now = get_mm_rss(mm);
+	for (i = 0; i < ARRAY_SIZE(pss_cache_counters); i++) {
+		c = pss_cache_counters[i];
+		then += pc->rss[c];
+	}
+	diff = now > then ? now - then : then - now;
+
+	return diff * 100 > then * sysctl_pss_cache_drift_pct;
+}
+
+/* pc->lock held, mm pinned by the caller */
+static int pss_cache_walk(struct mm_struct *mm, struct mm_pss_cache *pc)
+{
+	struct mem_size_stats mss;
+	struct vm_area_struct *vma;
+	u64 t0;
+	int c;
+
+	memset(&mss, 0, sizeof(mss));
+	t0 = ktime_get_ns();
+	if (down_read_killable(&mm->mmap_sem))
+		return -EINTR;
+	for (vma = mm->mmap; vma; vma = vma->vm_next)
+		smap_gather_stats(vma, &mss);
+	for (c = 0; c < NR_MM_COUNTERS; c++)
+		pc->rss[c] = get_mm_counter(mm, c);
+	up_read(&mm->mmap_sem);
+
+	memcpy(pc->pss, mss.pss_counter, sizeof(pc->pss));
+	memcpy(pc->uss, mss.uss_counter, sizeof(pc->uss));
+	pc->swap = mss.swap;
+	pc->swap_pss = mss.swap_pss;
+	pc->walk_ns = ktime_get_ns() - t0;
+	pc->stamp = jiffies;
+	pc->walks++;
+
+	return 0;
+}
+
+/* @val at the last walk of @then pages, scaled to @now pages */
+static u64 pss_cache_scale(u64 val, unsigned long then, unsigned long now,
+		u64 page_val)
+{
+	if (!then)
+		return page_val * now;	/* nothing seen yet, assume private */
+
+	return div64_u64(val, then) * now;
+}
+
+static int pss_cache_estimate(struct mm_struct *mm, struct pss_estimate *est,
+		bool force)
+{
+	struct mm_pss_cache *pc = pss_cache_get(mm);
+	unsigned long now, swapents;
+	int i, c, ret = 0;
+
+	if (!pc)
+		return -ENOMEM;
+
+	memset(est, 0, sizeof(*est));
+	mutex_lock(&pc->lock);
+	if (force || pss_cache_stale(mm, pc))
+		ret = pss_cache_walk(mm, pc);
+	if (ret)
+		goto out;
+
+	for (i = 0; i < ARRAY_SIZE(pss_cache_counters); i++) {
+		c = pss_cache_counters[i];
+		now = get_mm_counter(mm, c);
+		est->rss += now;
+		est->pss_counter[c] = pss_cache_scale(pc->pss[c], pc->rss[c],
+				now, (u64)PAGE_SIZE << PSS_SHIFT);
+		est->pss += est->pss_counter[c];
+		est->uss += pss_cache_scale(pc->uss[c], pc->rss[c], now,
+				PAGE_SIZE);
+	}
+
+	/* swap entries are counted exactly, shmem swap is kept from the walk */
+	swapents = get_mm_counter(mm, MM_SWAPENTS);
+	est->swap = pc->swap + swapents * PAGE_SIZE;
+	est->swap = est->swap > pc->rss[MM_SWAPENTS] * PAGE_SIZE ?
+		est->swap - pc->rss[MM_SWAPENTS] * PAGE_SIZE : 0;
+	est->swap_pss = pss_cache_scale(pc->swap_pss, pc->rss[MM_SWAPENTS],
+			swapents, (u64)PAGE_SIZE << PSS_SHIFT);
+
+	est->age = jiffies_to_msecs(jiffies - pc->stamp);
+	est->walks = pc->walks;
+	est->walk_ns = pc->walk_ns;
+out:
+	mutex_unlock(&pc->lock);
+
+	return ret;
+}
+
+static int pss_cache_show(struct seq_file *m, void *v)
+{
+	struct mm_struct *mm = m->private;
+	struct pss_estimate est;
+	int ret;
+
+	if (!mm || !mmget_not_zero(mm))
+		return 0;
+	ret = pss_cache_estimate(mm, &est, false);
+	mmput(mm);
+	if (ret)
+		return ret;
+
+	seq_printf(m,
+		   "Rss:            %8lu kB\n"
+		   "Pss:            %8lu kB\n"
+		   "Pss_Anon:       %8lu kB\n"
+		   "Pss_File:       %8lu kB\n"
+		   "Pss_Shmem:      %8lu kB\n"
+		   "Uss:            %8lu kB\n"
+		   "Swap:           %8lu kB\n"
+		   "SwapPss:        %8lu kB\n"
+		   "Age:            %8lu ms\n"
+		   "Walks:          %8lu\n"
+		   "WalkTime:       %8llu us\n",
+		   est.rss << (PAGE_SHIFT - 10),
+		   (unsigned long)(est.pss >> (10 + PSS_SHIFT)),
+		   (unsigned long)(est.pss_counter[MM_ANONPAGES] >> (10 + PSS_SHIFT)),
+		   (unsigned long)(est.pss_counter[MM_FILEPAGES] >> (10 + PSS_SHIFT)),
+		   (unsigned long)(est.pss_counter[MM_SHMEMPAGES] >> (10 + PSS_SHIFT)),
+		   est.uss >> 10,
+		   est.swap >> 10,
+		   (unsigned long)(est.swap_pss >> (10 + PSS_SHIFT)),
+		   est.age,
+		   est.walks,
+		   div_u64(est.walk_ns, NSEC_PER_USEC));
+
+	return 0;
+}
+
+static int pss_cache_open(struct inode *inode, struct file *file)
+{
+	struct mm_struct *mm = proc_mem_open(inode, PTRACE_MODE_READ);
+	int ret;
+
+	if (IS_ERR(mm))
+		return PTR_ERR(mm);
+
+	ret = single_open(file, pss_cache_show, mm);
+	if (ret && mm)
+		mmdrop(mm);
+
+	return ret;
+}
+
+/* any write reconciles the cache with a full walk */
+static ssize_t pss_cache_write(struct file *file, const char __user *buf,
+		size_t count, loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+	struct mm_struct *mm = m->private;
+	struct pss_estimate est;
+	int ret;
+
+	if (!mm || !mmget_not_zero(mm))
+		return -ESRCH;
+	ret = pss_cache_estimate(mm, &est, true);
+	mmput(mm);
+
+	return ret ? ret : count;
+}
+
+static int pss_cache_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *m = file->private_data;
+
+	if (m->private)
+		mmdrop(m->private);
+
+	return single_release(inode, file);
+}
+
+const struct file_operations proc_pid_pss_cache_operations = {
+	.open		= pss_cache_open,
+	.read		= seq_read,
+	.write		= pss_cache_write,
+	.llseek		= seq_lseek,
+	.release	= pss_cache_release,
+};
+#endif /* CONFIG_PROC_PSS_CACHE */
+
 enum clear_refs_types {
 	CLEAR_REFS_ALL = 1,
 	CLEAR_REFS_ANON,
@@ -413,7 +413,26 @@ do {						\
 #ifdef VENDOR_EDIT
 #ifdef CONFIG_OPPO_FG_OPT
 /* Huacai.Zhou@PSW.BSP.Kernel.MM, 2018-07-07, add fg process opt*/
+#define FG_UID_MAX	1024
+
+/* fg_uid notifier actions, data is a struct fg_uid_event */
+#define FG_UID_ADD	1
+#define FG_UID_DEL	2
+
+struct fg_uid_event {
+	int uid;
+	unsigned long gen;	/* generation after the change */
+};
+
+struct notifier_block;
+
 extern bool is_fg(int uid);
+extern unsigned long fg_uid_generation(void);
+extern int fg_uid_add(int uid);
+extern int fg_uid_del(int uid);
+extern int fg_uid_replace(const int *uids, unsigned int nr);
+extern int fg_uid_register_notifier(struct notifier_block *nb);
+extern int fg_uid_unregister_notifier(struct notifier_block *nb);
 static inline int current_is_fg(void)
 {
 	int cur_uid;
@@ -446,6 +465,38 @@ static inline bool is_fg(int uid)
 {
 	return false;
 }
+
+static inline unsigned long fg_uid_generation(void)
+{
+	return 0;
+}
+
+static inline int fg_uid_add(int uid)
+{
+	return -EOPNOTSUPP;
+}
+
+static inline int fg_uid_del(int uid)
+{
+	return -EOPNOTSUPP;
+}
+
+static inline int fg_uid_replace(const int *uids, unsigned int nr)
+{
+	return -EOPNOTSUPP;
+}
+
+struct notifier_block;
+
+static inline int fg_uid_register_notifier(struct notifier_block *nb)
+{
+	return 0;
+}
+
+static inline int fg_uid_unregister_notifier(struct notifier_block *nb)
+{
+	return 0;
+}
 #endif /*CONFIG_OPPO_FG_OPT*/
 #endif /*VENDOR_EDIT*/
 
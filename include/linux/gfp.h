@@ -454,6 +454,30 @@ static inline bool gfpflags_normal_context(const gfp_t gfp_flags)
 #define IS_ZONE_MOVABLE_CMA_ZONE_IDX(z)		(false)
 #endif
 
+/*
+ * Allocation sites the zmc placement policy may refuse __GFP_CMA, to keep
+ * pages that tend to be pinned for long out of CMA pageblocks.
+ */
+enum zmc_site {
+	ZMC_SITE_ANON,			/* anonymous user pages */
+	ZMC_SITE_PIN_PRONE_CACHE,	/* page cache of AS_PIN_PRONE mappings */
+	NR_ZMC_SITES,
+};
+
+#ifdef CONFIG_ZONE_MOVABLE_CMA
+extern unsigned long zmc_cma_deny;
+
+static inline gfp_t zmc_cma_gfp(enum zmc_site site)
+{
+	return READ_ONCE(zmc_cma_deny) & (1UL << site) ? 0 : __GFP_CMA;
+}
+#else
+static inline gfp_t zmc_cma_gfp(enum zmc_site site)
+{
+	return __GFP_CMA;
+}
+#endif
+
 static inline enum zone_type gfp_zone(gfp_t flags)
 {
 	enum zone_type z;
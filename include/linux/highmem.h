@@ -181,8 +181,8 @@ static inline struct page *
 alloc_zeroed_user_highpage_movable(struct vm_area_struct *vma,
 					unsigned long vaddr)
 {
-	return __alloc_zeroed_user_highpage(__GFP_MOVABLE | __GFP_CMA,
-			vma, vaddr);
+	return __alloc_zeroed_user_highpage(__GFP_MOVABLE |
+			zmc_cma_gfp(ZMC_SITE_ANON), vma, vaddr);
 }
 
 static inline void clear_highpage(struct page *page)
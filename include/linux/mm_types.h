@@ -524,6 +524,10 @@ struct mm_struct {
 	/* HMM needs to track a few things per mm */
 	struct hmm *hmm;
 #endif
+#ifdef CONFIG_PROC_PSS_CACHE
+	/* PSS estimates of /proc/<pid>/pss, allocated on first read */
+	struct mm_pss_cache *pss_cache;
+#endif
 } __randomize_layout;
 
 extern struct mm_struct init_mm;
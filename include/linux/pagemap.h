@@ -27,6 +27,7 @@ enum mapping_flags {
 	AS_EXITING	= 4, 	/* final truncate in progress */
 	/* writeback related tags are not used */
 	AS_NO_WRITEBACK_TAGS = 5,
+	AS_PIN_PRONE	= 6,	/* pages get pinned for long, e.g. fuse */
 };
 
 /**
@@ -95,6 +96,16 @@ static inline int mapping_use_writeback_tags(struct address_space *mapping)
 	return !test_bit(AS_NO_WRITEBACK_TAGS, &mapping->flags);
 }
 
+static inline void mapping_set_pin_prone(struct address_space *mapping)
+{
+	set_bit(AS_PIN_PRONE, &mapping->flags);
+}
+
+static inline int mapping_pin_prone(struct address_space *mapping)
+{
+	return test_bit(AS_PIN_PRONE, &mapping->flags);
+}
+
 static inline gfp_t mapping_gfp_mask(struct address_space * mapping)
 {
 	return mapping->gfp_mask;
@@ -245,7 +256,9 @@ static inline gfp_t readahead_gfp_mask(struct address_space *x)
 #else
 	return mapping_gfp_mask(x) |
 				  __GFP_COLD | __GFP_NORETRY | __GFP_NOWARN |
-				  __GFP_CMA;
+				  (mapping_pin_prone(x) ?
+				   zmc_cma_gfp(ZMC_SITE_PIN_PRONE_CACHE) :
+				   __GFP_CMA);
 #endif
 }
 
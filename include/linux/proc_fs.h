@@ -77,6 +77,13 @@ extern void proc_register_uid(kuid_t uid);
 static inline void proc_register_uid(kuid_t uid) {}
 #endif
 
+struct mm_struct;
+#ifdef CONFIG_PROC_PSS_CACHE
+extern void proc_pss_cache_free(struct mm_struct *mm);
+#else
+static inline void proc_pss_cache_free(struct mm_struct *mm) {}
+#endif
+
 struct net;
 
 static inline struct proc_dir_entry *proc_net_mkdir(
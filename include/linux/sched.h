@@ -561,6 +561,7 @@ struct sched_entity {
 
 #ifdef CONFIG_MTK_RT_THROTTLE_MON
 	u64			mtk_isr_time;
+	u64			mtk_rt_wake_ts;
 #endif
 };
 
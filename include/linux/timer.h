@@ -238,6 +238,11 @@ int timer_migration_handler(struct ctl_table *table, int write,
 			    loff_t *ppos);
 #endif
 
+#ifdef CONFIG_TIMER_CAPACITY_AWARE
+extern unsigned int sysctl_timer_migration_capacity;
+extern unsigned int sysctl_timer_migration_local_ns;
+#endif
+
 unsigned long __round_jiffies(unsigned long j, int cpu);
 unsigned long __round_jiffies_relative(unsigned long j, int cpu);
 unsigned long round_jiffies(unsigned long j);
@@ -0,0 +1,74 @@
+/*
+ * MediaTek RT monitor histograms
+ *
+ * Copyright (C) 2017 MediaTek Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __UAPI_RT_MON_H__
+#define __UAPI_RT_MON_H__
+
+#include <linux/types.h>
+
+#define RT_MON_MAGIC		0x52544d48	/* "RTMH" */
+#define RT_MON_VERSION		1
+
+/*
+ * RT priorities are grouped in bands of 1 << RT_MON_PRIO_SHIFT levels,
+ * band = rt_priority >> RT_MON_PRIO_SHIFT.
+ */
+#define RT_MON_PRIO_SHIFT	4
+#define RT_MON_PRIO_NR		7
+
+/* bucket i counts values in [2^i, 2^(i+1)) us, bucket 0 also below 1 us */
+#define RT_MON_BUCKET_NR	24
+
+/**
+ * struct rt_mon_hdr - head of /sys/kernel/debug/rt_monitor/hist
+ *
+ * @magic:	RT_MON_MAGIC
+ * @version:	RT_MON_VERSION
+ * @nr_cpu:	number of struct rt_mon_cpu_hist that follow
+ * @nr_prio:	RT_MON_PRIO_NR
+ * @nr_bucket:	RT_MON_BUCKET_NR
+ * @prio_shift:	RT_MON_PRIO_SHIFT
+ * @period_ns:	RT bandwidth period the runtime histograms are taken over
+ * @span_ns:	time covered by the snapshot, since the last reset
+ */
+struct rt_mon_hdr {
+	__u32 magic;
+	__u32 version;
+	__u32 nr_cpu;
+	__u32 nr_prio;
+	__u32 nr_bucket;
+	__u32 prio_shift;
+	__u64 period_ns;
+	__u64 span_ns;
+};
+
+/**
+ * struct rt_mon_cpu_hist - histograms of one CPU
+ *
+ * @cpu:	CPU number
+ * @throttle:	RT throttling events, by band of the throttled task
+ * @runtime:	RT runtime of a band within one period, one sample per
+ *		period in which the band ran
+ * @wakeup:	wakeup to run latency of RT tasks
+ */
+struct rt_mon_cpu_hist {
+	__u32 cpu;
+	__u32 pad;
+	__u64 throttle[RT_MON_PRIO_NR];
+	__u64 runtime[RT_MON_PRIO_NR][RT_MON_BUCKET_NR];
+	__u64 wakeup[RT_MON_PRIO_NR][RT_MON_BUCKET_NR];
+};
+
+#endif /* __UAPI_RT_MON_H__ */
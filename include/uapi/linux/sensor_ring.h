@@ -0,0 +1,100 @@
+/*
+ * MediaTek sensor event ring
+ *
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __UAPI_SENSOR_RING_H__
+#define __UAPI_SENSOR_RING_H__
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+#define SENSOR_RING_MAGIC	0x534e5247	/* "SNRG" */
+#define SENSOR_RING_VERSION	1
+
+/**
+ * struct sensor_ring_event - one ring slot
+ *
+ * Same layout as the struct sensor_event of the sensor hub, copied
+ * as delivered by the sensor driver.
+ *
+ * @time_stamp:		sample time in ns, as reported by the sensor driver
+ * @handle:		sensor handle (ID_*)
+ * @flush_action:	DATA_ACTION, FLUSH_ACTION, ...
+ * @status:		accuracy
+ * @word:		sensor data
+ */
+struct sensor_ring_event {
+	__s64 time_stamp;
+	__s8 handle;
+	__s8 flush_action;
+	__s8 status;
+	__s8 reserved;
+	__s32 word[6];
+} __attribute__((packed));
+
+/**
+ * struct sensor_ring_hdr - first page of the mmap area of /dev/sensor_ring
+ *
+ * Single producer (the kernel), single consumer. Slot of sequence s is at
+ * data_offset + (s & (nr_slots - 1)) * slot_size. Slots in [tail, head)
+ * are valid. The kernel never overwrites unconsumed slots, events that
+ * do not fit are counted in @dropped.
+ *
+ * @head:	written by the kernel with release semantics, read it with
+ *		acquire semantics before reading slots
+ * @tail:	written by the consumer with release semantics once the
+ *		slots before it have been copied out
+ */
+struct sensor_ring_hdr {
+	__u32 magic;
+	__u32 version;
+	__u32 nr_slots;
+	__u32 slot_size;
+	__u32 data_offset;
+	__u32 reserved;
+	__u64 dropped;
+	__u64 head __attribute__((aligned(64)));
+	__u64 tail __attribute__((aligned(64)));
+};
+
+/* keep the events of the handle out of the per-sensor read() buffer */
+#define SENSOR_RING_EXCLUSIVE	(1U << 0)
+
+/**
+ * struct sensor_ring_sub - subscription of the ring to one sensor
+ *
+ * The reader is woken when @watermark events of the handle are pending,
+ * when the oldest pending event is @max_latency_us old, on any non data
+ * event (flush, calibration, ...) and when the ring is 3/4 full.
+ *
+ * @handle:		sensor handle (ID_*)
+ * @watermark:		events, 0 or 1 wakes on every event
+ * @max_latency_us:	0 for no timeout
+ * @flags:		SENSOR_RING_*
+ */
+struct sensor_ring_sub {
+	__u32 handle;
+	__u32 watermark;
+	__u32 max_latency_us;
+	__u32 flags;
+};
+
+#define SENSOR_RING_IOC_MAGIC		's'
+#define SENSOR_RING_IOC_SUBSCRIBE	_IOW(SENSOR_RING_IOC_MAGIC, 1, \
+					     struct sensor_ring_sub)
+#define SENSOR_RING_IOC_UNSUBSCRIBE	_IOW(SENSOR_RING_IOC_MAGIC, 2, __u32)
+/* eventfd signalled on every wakeup, -1 to detach */
+#define SENSOR_RING_IOC_SET_EVENTFD	_IOW(SENSOR_RING_IOC_MAGIC, 3, __s32)
+
+#endif /* __UAPI_SENSOR_RING_H__ */
@@ -0,0 +1,83 @@
+/*
+ * MediaTek CPU loading indication ring
+ *
+ * Copyright (C) 2018 MediaTek Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __UAPI_ULOAD_IND_H__
+#define __UAPI_ULOAD_IND_H__
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+#define ULOAD_RING_VERSION	1
+
+/* event types */
+#define ULOAD_EV_SAMPLE		0	/* periodic loading sample */
+#define ULOAD_EV_OVER		1	/* entered high state */
+#define ULOAD_EV_UNDER		2	/* entered low state */
+#define ULOAD_EV_NORMAL		3	/* back to mid state */
+
+#define ULOAD_EV_MASK(type)	(1U << (type))
+#define ULOAD_EV_MASK_CROSS	(ULOAD_EV_MASK(ULOAD_EV_OVER) | \
+				 ULOAD_EV_MASK(ULOAD_EV_UNDER) | \
+				 ULOAD_EV_MASK(ULOAD_EV_NORMAL))
+
+/* states, same values as the uload_ind driver */
+#define ULOAD_STATE_HIGH	1
+#define ULOAD_STATE_MID		2
+#define ULOAD_STATE_LOW		3
+
+/**
+ * struct uload_event - one ring slot
+ *
+ * @seq:	sequence number, slot is valid when seq matches the sequence
+ *		the reader expects; re-check after copying the slot
+ * @ts_ns:	CLOCK_MONOTONIC timestamp of the sample
+ * @loading:	CPU loading 0~100
+ * @type:	ULOAD_EV_*
+ * @state:	ULOAD_STATE_* after this event
+ */
+struct uload_event {
+	__u64 seq;
+	__u64 ts_ns;
+	__s32 loading;
+	__u16 type;
+	__u16 state;
+	__u64 reserved;
+};
+
+/**
+ * struct uload_ring_hdr - first page of the mmap area
+ *
+ * @head:	sequence of the next slot to be written. Slot of sequence s
+ *		is at data_offset + (s & (nr_slots - 1)) * slot_size
+ */
+struct uload_ring_hdr {
+	__u32 version;
+	__u32 nr_slots;
+	__u32 slot_size;
+	__u32 data_offset;
+	__u64 head;
+};
+
+#define ULOAD_IOC_MAGIC		'u'
+/* minimum interval between poll wakeups for samples, crossings bypass */
+#define ULOAD_IOC_SET_RATE	_IOW(ULOAD_IOC_MAGIC, 1, __u32)
+/* ULOAD_EV_MASK() of event types which wake this reader */
+#define ULOAD_IOC_SET_MASK	_IOW(ULOAD_IOC_MAGIC, 2, __u32)
+/* mmap readers: everything before this sequence has been consumed */
+#define ULOAD_IOC_CONSUME	_IOW(ULOAD_IOC_MAGIC, 3, __u64)
+/* feed a loading value through the tracker callback, CAP_SYS_ADMIN */
+#define ULOAD_IOC_INJECT	_IOW(ULOAD_IOC_MAGIC, 4, __s32)
+
+#endif /* __UAPI_ULOAD_IND_H__ */
@@ -49,6 +49,7 @@
 #include <linux/sched/debug.h>
 #include <linux/sched/task_stack.h>
 #include <mt-plat/aee.h>
+#include <mt-plat/mtk_ram_record.h>
 #include <linux/proc_fs.h>
 
 #include <linux/uaccess.h>
@@ -863,6 +864,10 @@ static int log_store(int facility, int level,
 	log_next_idx += msg->len;
 	log_next_seq++;
 
+	ram_record_write(RAM_RECORD_PRINTK, msg->level, msg->ts_nsec,
+			 log_text(msg),
+			 min_t(u16, msg->text_len, RAM_RECORD_TEXT_MAX));
+
 	/* printk too much detect */
 #if defined(CONFIG_MTK_ENG_BUILD) && defined(CONFIG_LOG_TOO_MUCH_WARNING)
 	if (printk_too_much_enable == 1) {
@@ -63,6 +63,7 @@ MODULE_AUTHOR("Paul E. McKenney <paulmck@linux.vnet.ibm.com>");
 
 torture_param(bool, gp_async, false, "Use asynchronous GP wait primitives");
 torture_param(int, gp_async_max, 1000, "Max # outstanding waits per reader");
+torture_param(int, cb_flood, 0, "Callbacks posted per writer flood, zero to disable");
 torture_param(bool, gp_exp, false, "Use expedited GP wait primitives");
 torture_param(int, holdoff, 10, "Holdoff time before test start (s)");
 torture_param(int, nreaders, 0, "Number of RCU reader threads");
@@ -93,6 +94,7 @@ static u64 t_rcu_perf_writer_finished;
 static unsigned long b_rcu_perf_writer_started;
 static unsigned long b_rcu_perf_writer_finished;
 static DEFINE_PER_CPU(atomic_t, n_async_inflight);
+static DEFINE_PER_CPU(unsigned long, n_flood_cbs_invoked);
 
 static int rcu_perf_writer_state;
 #define RTWS_INIT		0
@@ -397,6 +399,60 @@ static void rcu_perf_async_cb(struct rcu_head *rhp)
 	kfree(rhp);
 }
 
+/*
+ * Callback flood from rcu_perf_writer(), mimicking the bursts of callbacks
+ * posted by large process exits or dentry pruning.  The writer-duration
+ * of a flood is the time from posting the first callback until the last
+ * one has been invoked, and the per-CPU invocation counts show where the
+ * callbacks ran (for example with CONFIG_RCU_NOCB_CPU_CLUSTER).
+ */
+struct rcu_perf_flood;
+
+struct rcu_perf_flood_cb {
+	struct rcu_head rh;
+	struct rcu_perf_flood *fp;
+};
+
+struct rcu_perf_flood {
+	atomic_t pending;
+	wait_queue_head_t wq;
+	struct rcu_perf_flood_cb cbs[];
+};
+
+static void rcu_perf_flood_cb(struct rcu_head *rhp)
+{
+	struct rcu_perf_flood_cb *fcb;
+
+	fcb = container_of(rhp, struct rcu_perf_flood_cb, rh);
+	this_cpu_inc(n_flood_cbs_invoked);
+	if (atomic_dec_and_test(&fcb->fp->pending))
+		wake_up(&fcb->fp->wq);
+}
+
+static struct rcu_perf_flood *rcu_perf_flood_alloc(void)
+{
+	struct rcu_perf_flood *fp;
+	int i;
+
+	fp = kzalloc(sizeof(*fp) + cb_flood * sizeof(fp->cbs[0]), GFP_KERNEL);
+	if (!fp)
+		return NULL;
+	init_waitqueue_head(&fp->wq);
+	for (i = 0; i < cb_flood; i++)
+		fp->cbs[i].fp = fp;
+	return fp;
+}
+
+static void rcu_perf_flood(struct rcu_perf_flood *fp)
+{
+	int i;
+
+	atomic_set(&fp->pending, cb_flood);
+	for (i = 0; i < cb_flood; i++)
+		cur_ops->async(&fp->cbs[i].rh, rcu_perf_flood_cb);
+	wait_event(fp->wq, !atomic_read(&fp->pending));
+}
+
 /*
  * RCU perf writer kthread.  Repeatedly does a grace period.
  */
@@ -407,6 +463,7 @@ rcu_perf_writer(void *arg)
 	int i_max;
 	long me = (long)arg;
 	struct rcu_head *rhp = NULL;
+	struct rcu_perf_flood *fp = NULL;
 	struct sched_param sp;
 	bool started = false, done = false, alldone = false;
 	u64 t;
@@ -419,6 +476,11 @@ rcu_perf_writer(void *arg)
 	sp.sched_priority = 1;
 	sched_setscheduler_nocheck(current, SCHED_FIFO, &sp);
 
+	if (cb_flood) {
+		fp = rcu_perf_flood_alloc();
+		WARN_ON(!fp);
+	}
+
 	if (holdoff)
 		schedule_timeout_uninterruptible(holdoff * HZ);
 
@@ -439,7 +501,10 @@ rcu_perf_writer(void *arg)
 			udelay(writer_holdoff);
 		wdp = &wdpp[i];
 		*wdp = ktime_get_mono_fast_ns();
-		if (gp_async) {
+		if (fp) {
+			rcu_perf_writer_state = RTWS_ASYNC;
+			rcu_perf_flood(fp);
+		} else if (gp_async) {
 retry:
 			if (!rhp)
 				rhp = kmalloc(sizeof(*rhp), GFP_KERNEL);
@@ -506,6 +571,7 @@ rcu_perf_writer(void *arg)
 		rcu_perf_writer_state = RTWS_BARRIER;
 		cur_ops->gp_barrier();
 	}
+	kfree(fp);
 	rcu_perf_writer_state = RTWS_STOPPING;
 	writer_n_durations[me] = i_max;
 	torture_kthread_stopping("rcu_perf_writer");
@@ -516,8 +582,9 @@ static inline void
 rcu_perf_print_module_parms(struct rcu_perf_ops *cur_ops, const char *tag)
 {
 	pr_alert("%s" PERF_FLAG
-		 "--- %s: nreaders=%d nwriters=%d verbose=%d shutdown=%d\n",
-		 perf_type, tag, nrealreaders, nrealwriters, verbose, shutdown);
+		 "--- %s: nreaders=%d nwriters=%d verbose=%d shutdown=%d cb_flood=%d\n",
+		 perf_type, tag, nrealreaders, nrealwriters, verbose, shutdown,
+		 cb_flood);
 }
 
 static void
@@ -596,6 +663,13 @@ rcu_perf_cleanup(void)
 		kfree(writer_n_durations);
 	}
 
+	if (cb_flood) {
+		for_each_possible_cpu(i)
+			pr_alert("%s%s cpu %d flood-cbs-invoked: %lu\n",
+				 perf_type, PERF_FLAG, i,
+				 per_cpu(n_flood_cbs_invoked, i));
+	}
+
 	/* Do flavor-specific cleanup operations.  */
 	if (cur_ops->cleanup != NULL)
 		cur_ops->cleanup();
@@ -672,6 +746,12 @@ rcu_perf_init(void)
 	}
 	if (cur_ops->init)
 		cur_ops->init();
+	if (cb_flood && !cur_ops->async) {
+		pr_alert("rcu-perf: %s has no async primitive for cb_flood\n",
+			 perf_type);
+		firsterr = -EINVAL;
+		goto unwind;
+	}
 
 	nrealwriters = compute_real(nwriters);
 	nrealreaders = compute_real(nreaders);
@@ -281,6 +281,13 @@ struct rcu_data {
 	/* The following fields are used by the follower, hence new cachline. */
 	struct rcu_data *nocb_leader ____cacheline_internodealigned_in_smp;
 					/* Leader CPU takes GP-end wakeups. */
+	long nocb_batch_limit;		/* Adaptive # CBs per bh-off batch. */
+	long nocb_max_backlog;		/* Largest ->nocb_q_count seen. */
+	unsigned long nocb_n_batches;	/* # of invocation batches. */
+	u64 nocb_ready_ts;		/* When CBs became ready to invoke. */
+	u64 nocb_lat_sum;		/* Sum of ready-to-invoke latencies. */
+	u64 nocb_lat_max;		/* Max ready-to-invoke latency. */
+	unsigned long nocb_lat_n;	/* # of latency samples. */
 #endif /* #ifdef CONFIG_RCU_NOCB_CPU */
 
 	/* 8) RCU CPU stall data. */
@@ -24,10 +24,13 @@
  *	   Paul E. McKenney <paulmck@linux.vnet.ibm.com>
  */
 
+#include <linux/of.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/gfp.h>
 #include <linux/oom.h>
 #include <linux/sched/debug.h>
+#include <linux/seq_file.h>
 #include <linux/smpboot.h>
 #include <uapi/linux/sched/types.h>
 #include "../time/tick-internal.h"
@@ -61,6 +64,8 @@ DEFINE_PER_CPU(char, rcu_cpu_has_work);
 static cpumask_var_t rcu_nocb_mask; /* CPUs to have callbacks offloaded. */
 static bool have_rcu_nocb_mask;	    /* Was rcu_nocb_mask allocated? */
 static bool __read_mostly rcu_nocb_poll;    /* Offload kthread are to poll. */
+static cpumask_var_t rcu_nocb_affinity; /* CPUs to run rcuo kthreads on. */
+static bool have_rcu_nocb_affinity; /* Was rcu_nocb_affinity set up? */
 #endif /* #ifdef CONFIG_RCU_NOCB_CPU */
 
 /*
@@ -1772,6 +1777,31 @@ static int __init parse_rcu_nocb_poll(char *arg)
 }
 early_param("rcu_nocb_poll", parse_rcu_nocb_poll);
 
+/* Parse the boot-time rcuo kthread affinity CPU list. */
+static int __init rcu_nocb_affinity_setup(char *str)
+{
+	alloc_bootmem_cpumask_var(&rcu_nocb_affinity);
+	if (cpulist_parse(str, rcu_nocb_affinity) ||
+	    !cpumask_intersects(rcu_nocb_affinity, cpu_possible_mask)) {
+		pr_info("\tIgnoring invalid rcu_nocb_affinity=%s.\n", str);
+		return 1;
+	}
+	have_rcu_nocb_affinity = true;
+	return 1;
+}
+__setup("rcu_nocb_affinity=", rcu_nocb_affinity_setup);
+
+/*
+ * Offloaded callbacks are invoked in batches with bottom halves disabled.
+ * The batch size adapts so that one batch takes about rcu_nocb_batch_us,
+ * between RCU_NOCB_BATCH_MIN and rcu_nocb_batch_max callbacks.
+ */
+#define RCU_NOCB_BATCH_MIN	8
+static ulong rcu_nocb_batch_us = 500;
+module_param(rcu_nocb_batch_us, ulong, 0644);
+static long rcu_nocb_batch_max = 1024;
+module_param(rcu_nocb_batch_max, long, 0644);
+
 /*
  * Wake up any no-CBs CPUs' kthreads that were waiting on the just-ended
  * grace period.
@@ -1940,6 +1970,9 @@ static void __call_rcu_nocb_enqueue(struct rcu_data *rdp,
 	WRITE_ONCE(*old_rhpp, rhp);
 	atomic_long_add(rhcount_lazy, &rdp->nocb_q_count_lazy);
 	smp_mb__after_atomic(); /* Store *old_rhpp before _wake test. */
+	len = atomic_long_read(&rdp->nocb_q_count);
+	if (len > READ_ONCE(rdp->nocb_max_backlog))
+		WRITE_ONCE(rdp->nocb_max_backlog, len);
 
 	/* If we are not being polled and there is a kthread, awaken it ... */
 	t = READ_ONCE(rdp->nocb_kthread);
@@ -1948,7 +1981,6 @@ static void __call_rcu_nocb_enqueue(struct rcu_data *rdp,
 				    TPS("WakeNotPoll"));
 		return;
 	}
-	len = atomic_long_read(&rdp->nocb_q_count);
 	if (old_rhpp == &rdp->nocb_head) {
 		if (!irqs_disabled_flags(flags)) {
 			/* ... if queue was empty ... */
@@ -2151,6 +2183,8 @@ static void nocb_leader_wait(struct rcu_data *my_rdp)
 		tail = rdp->nocb_follower_tail;
 		rdp->nocb_follower_tail = rdp->nocb_gp_tail;
 		*tail = rdp->nocb_gp_head;
+		if (tail == &rdp->nocb_follower_head)
+			rdp->nocb_ready_ts = local_clock();
 		raw_spin_unlock_irqrestore(&rdp->nocb_lock, flags);
 		if (rdp != my_rdp && tail == &rdp->nocb_follower_head) {
 			/* List was empty, so wake up the follower.  */
@@ -2182,6 +2216,25 @@ static void nocb_follower_wait(struct rcu_data *rdp)
 	}
 }
 
+/*
+ * Adapt the number of callbacks invoked per bh-disabled batch so that a
+ * batch takes about rcu_nocb_batch_us: halve it after a slow batch, double
+ * it after a full batch that finished in less than half the budget.
+ */
+static void rcu_nocb_batch_adjust(struct rcu_data *rdp, long n, u64 ns)
+{
+	u64 budget = (u64)READ_ONCE(rcu_nocb_batch_us) * NSEC_PER_USEC;
+	long limit = rdp->nocb_batch_limit;
+
+	if (ns > budget)
+		limit = max_t(long, limit / 2, RCU_NOCB_BATCH_MIN);
+	else if (n >= limit && ns < budget / 2)
+		limit = min_t(long, limit * 2,
+			      max_t(long, READ_ONCE(rcu_nocb_batch_max),
+				    RCU_NOCB_BATCH_MIN));
+	WRITE_ONCE(rdp->nocb_batch_limit, limit);
+}
+
 /*
  * Per-rcu_data kthread, but only for no-CBs CPUs.  Each kthread invokes
  * callbacks queued by the corresponding no-CBs CPU, however, there is
@@ -2191,13 +2244,15 @@ static void nocb_follower_wait(struct rcu_data *rdp)
 static int rcu_nocb_kthread(void *arg)
 {
 	int c, cl;
+	long n;
+	u64 t, lat;
 	unsigned long flags;
 	struct rcu_head *list;
 	struct rcu_head *next;
 	struct rcu_head **tail;
 	struct rcu_data *rdp = arg;
 
-	/* Each pass through this loop invokes one batch of callbacks */
+	/* Each pass through this loop invokes one list of callbacks */
 	for (;;) {
 		/* Wait for callbacks. */
 		if (rdp->nocb_leader == rdp)
@@ -2211,34 +2266,55 @@ static int rcu_nocb_kthread(void *arg)
 		rdp->nocb_follower_head = NULL;
 		tail = rdp->nocb_follower_tail;
 		rdp->nocb_follower_tail = &rdp->nocb_follower_head;
+		t = rdp->nocb_ready_ts;
 		raw_spin_unlock_irqrestore(&rdp->nocb_lock, flags);
 		BUG_ON(!list);
 		trace_rcu_nocb_wake(rdp->rsp->name, rdp->cpu, TPS("WokeNonEmpty"));
 
-		/* Each pass through the following loop invokes a callback. */
+		lat = local_clock() - t;
+		rdp->nocb_lat_sum += lat;
+		rdp->nocb_lat_n++;
+		if (lat > rdp->nocb_lat_max)
+			rdp->nocb_lat_max = lat;
+
+		/*
+		 * Each pass through the following loop invokes a batch of
+		 * callbacks with bottom halves disabled once per batch.
+		 */
 		trace_rcu_batch_start(rdp->rsp->name,
 				      atomic_long_read(&rdp->nocb_q_count_lazy),
 				      atomic_long_read(&rdp->nocb_q_count), -1);
 		c = cl = 0;
 		while (list) {
-			next = list->next;
+			n = 0;
+			t = local_clock();
+			local_bh_disable();
+			while (list && n < rdp->nocb_batch_limit) {
+				next = READ_ONCE(list->next);
+				/* Enqueuing still in progress, wait below. */
+				if (next == NULL && &list->next != tail)
+					break;
+				debug_rcu_head_unqueue(list);
+				if (__rcu_reclaim(rdp->rsp->name, list))
+					cl++;
+				n++;
+				list = next;
+			}
+			local_bh_enable();
+			c += n;
+			rdp->nocb_n_batches++;
+			rcu_nocb_batch_adjust(rdp, n, local_clock() - t);
+
 			/* Wait for enqueuing to complete, if needed. */
-			while (next == NULL && &list->next != tail) {
+			while (list && READ_ONCE(list->next) == NULL &&
+			       &list->next != tail) {
 				trace_rcu_nocb_wake(rdp->rsp->name, rdp->cpu,
 						    TPS("WaitQueue"));
 				schedule_timeout_interruptible(1);
 				trace_rcu_nocb_wake(rdp->rsp->name, rdp->cpu,
 						    TPS("WokeQueue"));
-				next = list->next;
 			}
-			debug_rcu_head_unqueue(list);
-			local_bh_disable();
-			if (__rcu_reclaim(rdp->rsp->name, list))
-				cl++;
-			c++;
-			local_bh_enable();
 			cond_resched_rcu_qs();
-			list = next;
 		}
 		trace_rcu_batch_end(rdp->rsp->name, c, !!list, 0, 0, 1);
 		smp_mb__before_atomic();  /* _add after CB invocation. */
@@ -2310,6 +2386,11 @@ void __init rcu_init_nohz(void)
 	if (!have_rcu_nocb_mask)
 		return;
 
+	/* Without rcu_nocbs=, offload every CPU to the little cluster. */
+	if (IS_ENABLED(CONFIG_RCU_NOCB_CPU_CLUSTER) &&
+	    cpumask_empty(rcu_nocb_mask))
+		cpumask_copy(rcu_nocb_mask, cpu_possible_mask);
+
 #if defined(CONFIG_NO_HZ_FULL)
 	if (tick_nohz_full_running)
 		cpumask_or(rcu_nocb_mask, rcu_nocb_mask, tick_nohz_full_mask);
@@ -2341,6 +2422,76 @@ static void __init rcu_boot_init_nocb_percpu_data(struct rcu_data *rdp)
 	raw_spin_lock_init(&rdp->nocb_lock);
 	setup_timer(&rdp->nocb_timer, do_nocb_deferred_wakeup_timer,
 		    (unsigned long)rdp);
+	rdp->nocb_batch_limit = RCU_NOCB_BATCH_MIN;
+}
+
+#ifdef CONFIG_RCU_NOCB_CPU_CLUSTER
+/*
+ * Raw capacity-dmips-mhz of the CPU from the device tree, 0 if it has
+ * none.  The normalized cpu_scale cannot be used: the rcuo kthreads are
+ * spawned before cpufreq has come up to normalize it, and until then
+ * every CPU reads SCHED_CAPACITY_SCALE.
+ */
+static u32 __init rcu_nocb_cpu_dmips(int cpu)
+{
+	struct device_node *cn;
+	u32 dmips = 0;
+
+	cn = of_get_cpu_node(cpu, NULL);
+	if (!cn)
+		return 0;
+	of_property_read_u32(cn, "capacity-dmips-mhz", &dmips);
+	of_node_put(cn);
+	return dmips;
+}
+
+/*
+ * Without an rcu_nocb_affinity= boot list, restrict the rcuo kthreads to
+ * the CPUs with the lowest capacity-dmips-mhz, so that callback floods
+ * are invoked on the little cluster.  Done once at boot: CPUs hotplugged
+ * later reuse the mask, or run anywhere if it could not be set up.
+ */
+static void __init rcu_nocb_cluster_affinity_init(void)
+{
+	u32 dmips, min_dmips = U32_MAX;
+	int cpu;
+
+	if (have_rcu_nocb_affinity)
+		return;
+	if (!zalloc_cpumask_var(&rcu_nocb_affinity, GFP_KERNEL))
+		return;
+
+	for_each_possible_cpu(cpu) {
+		dmips = rcu_nocb_cpu_dmips(cpu);
+		if (!dmips) {
+			/* no capacities to go by, do not restrict */
+			free_cpumask_var(rcu_nocb_affinity);
+			return;
+		}
+		min_dmips = min(min_dmips, dmips);
+	}
+	for_each_possible_cpu(cpu) {
+		if (rcu_nocb_cpu_dmips(cpu) == min_dmips)
+			cpumask_set_cpu(cpu, rcu_nocb_affinity);
+	}
+	pr_info("\tOffload RCU callback kthreads to CPUs: %*pbl.\n",
+		cpumask_pr_args(rcu_nocb_affinity));
+	have_rcu_nocb_affinity = true;
+}
+#else /* #ifdef CONFIG_RCU_NOCB_CPU_CLUSTER */
+static void __init rcu_nocb_cluster_affinity_init(void)
+{
+}
+#endif /* #else #ifdef CONFIG_RCU_NOCB_CPU_CLUSTER */
+
+/*
+ * CPUs the rcuo kthreads may run on: the rcu_nocb_affinity= boot list or
+ * the little cluster picked by rcu_nocb_cluster_affinity_init(), else all
+ * of them.  Userspace may still re-affine the kthreads afterwards.
+ */
+static const struct cpumask *rcu_nocb_kthread_affinity(void)
+{
+	return have_rcu_nocb_affinity ? rcu_nocb_affinity : cpu_possible_mask;
 }
 
 /*
@@ -2385,9 +2536,15 @@ static void rcu_spawn_one_nocb_kthread(struct rcu_state *rsp, int cpu)
 	}
 
 	/* Spawn the kthread for this CPU and RCU flavor. */
-	t = kthread_run_perf_critical(cpu_lp_mask, rcu_nocb_kthread, rdp_spawn,
-				      "rcuo%c/%d", rsp->abbr, cpu);
+	t = kthread_create(rcu_nocb_kthread, rdp_spawn,
+			   "rcuo%c/%d", rsp->abbr, cpu);
 	BUG_ON(IS_ERR(t));
+	/* none of the CPUs online yet, say, then it runs anywhere */
+	if (set_cpus_allowed_ptr(t, rcu_nocb_kthread_affinity()))
+		pr_warn_once("\tCould not affine rcuo%c/%d to %*pbl.\n",
+			     rsp->abbr, cpu,
+			     cpumask_pr_args(rcu_nocb_kthread_affinity()));
+	wake_up_process(t);
 	WRITE_ONCE(rdp_spawn->nocb_kthread, t);
 }
 
@@ -2414,6 +2571,7 @@ static void __init rcu_spawn_nocb_kthreads(void)
 {
 	int cpu;
 
+	rcu_nocb_cluster_affinity_init();
 	for_each_online_cpu(cpu)
 		rcu_spawn_all_nocb_kthreads(cpu);
 }
@@ -2482,6 +2640,75 @@ static bool init_nocb_callback_list(struct rcu_data *rdp)
 	return true;
 }
 
+#ifdef CONFIG_DEBUG_FS
+
+/*
+ * Per no-CBs CPU callback backlog, batching and ready-to-invoke latency,
+ * in /sys/kernel/debug/rcu/rcuo.
+ */
+static int rcu_nocb_stats_show(struct seq_file *m, void *unused)
+{
+	int cpu;
+	struct rcu_data *rdp;
+	struct rcu_state *rsp;
+	struct task_struct *t;
+
+	if (!have_rcu_nocb_mask)
+		return 0;
+
+	seq_puts(m, "flavor cpu backlog max_backlog invoked batches batch_limit lat_avg_us lat_max_us kthread_cpus\n");
+	for_each_rcu_flavor(rsp) {
+		for_each_cpu(cpu, rcu_nocb_mask) {
+			rdp = per_cpu_ptr(rsp->rda, cpu);
+			t = READ_ONCE(rdp->nocb_kthread);
+			seq_printf(m, "%s %d %ld %ld %lu %lu %ld %llu %llu %*pbl\n",
+				   rsp->name, cpu,
+				   atomic_long_read(&rdp->nocb_q_count),
+				   READ_ONCE(rdp->nocb_max_backlog),
+				   READ_ONCE(rdp->n_nocbs_invoked),
+				   READ_ONCE(rdp->nocb_n_batches),
+				   READ_ONCE(rdp->nocb_batch_limit),
+				   rdp->nocb_lat_n ?
+				   div64_u64(rdp->nocb_lat_sum,
+					     rdp->nocb_lat_n * NSEC_PER_USEC) : 0,
+				   div_u64(rdp->nocb_lat_max, NSEC_PER_USEC),
+				   cpumask_pr_args(t ? &t->cpus_allowed :
+						   cpu_none_mask));
+		}
+	}
+	return 0;
+}
+
+static int rcu_nocb_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, rcu_nocb_stats_show, NULL);
+}
+
+static const struct file_operations rcu_nocb_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = rcu_nocb_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init rcu_nocb_stats_init(void)
+{
+	struct dentry *dir;
+
+	if (!have_rcu_nocb_mask)
+		return 0;
+
+	dir = debugfs_create_dir("rcu", NULL);
+	if (!IS_ERR_OR_NULL(dir))
+		debugfs_create_file("rcuo", 0444, dir, NULL,
+				    &rcu_nocb_stats_fops);
+	return 0;
+}
+late_initcall(rcu_nocb_stats_init);
+
+#endif /* #ifdef CONFIG_DEBUG_FS */
+
 #else /* #ifdef CONFIG_RCU_NOCB_CPU */
 
 static bool rcu_nocb_cpu_needs_barrier(struct rcu_state *rsp, int cpu)
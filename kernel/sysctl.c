@@ -146,6 +146,10 @@ static int two_hundred = 200;
 #endif
 #endif
 static int one_thousand = 1000;
+#ifdef CONFIG_PROC_PSS_CACHE
+extern int sysctl_pss_cache_period_ms;
+extern int sysctl_pss_cache_drift_pct;
+#endif
 #ifdef VENDOR_EDIT
 /*Huacai.Zhou@PSW.BSP.Kernel.Performance, 2018-04-28, add foreground task io opt*/
 unsigned int sysctl_fg_io_opt = 1;
@@ -1432,6 +1436,24 @@ static struct ctl_table kern_table[] = {
 		.extra2		= &one,
 	},
 #endif
+#ifdef CONFIG_TIMER_CAPACITY_AWARE
+	{
+		.procname	= "timer_migration_capacity",
+		.data		= &sysctl_timer_migration_capacity,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &one,
+	},
+	{
+		.procname	= "timer_migration_local_ns",
+		.data		= &sysctl_timer_migration_local_ns,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec,
+	},
+#endif
 #ifdef CONFIG_BPF_SYSCALL
 	{
 		.procname	= "unprivileged_bpf_disabled",
@@ -1632,6 +1654,25 @@ static struct ctl_table vm_table[] = {
 		.extra2 	= &two_hundred,
 	},
 #endif
+#ifdef CONFIG_PROC_PSS_CACHE
+	{
+		.procname	= "pss_cache_period_ms",
+		.data		= &sysctl_pss_cache_period_ms,
+		.maxlen		= sizeof(sysctl_pss_cache_period_ms),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+	},
+	{
+		.procname	= "pss_cache_drift_pct",
+		.data		= &sysctl_pss_cache_drift_pct,
+		.maxlen		= sizeof(sysctl_pss_cache_drift_pct),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &one_hundred,
+	},
+#endif
 #ifdef CONFIG_HUGETLB_PAGE
 	{
 		.procname	= "nr_hugepages",
@@ -202,7 +202,7 @@ struct hrtimer_cpu_base *get_target_base(struct hrtimer_cpu_base *base,
 {
 	if (pinned || !base->migration_enabled)
 		return base;
-	return &per_cpu(hrtimer_bases, get_nohz_timer_target());
+	return &per_cpu(hrtimer_bases, timer_placement_target());
 }
 #else
 static inline
@@ -234,7 +234,8 @@ switch_hrtimer_base(struct hrtimer *timer, struct hrtimer_clock_base *base,
 	int basenum = base->index;
 
 	this_cpu_base = this_cpu_ptr(&hrtimer_bases);
-	new_cpu_base = get_target_base(this_cpu_base, pinned);
+	new_cpu_base = get_target_base(this_cpu_base,
+				       pinned || timer_placement_local(timer));
 again:
 	new_base = &new_cpu_base->clock_base[basenum];
 
@@ -1316,6 +1317,7 @@ static void __run_hrtimer(struct hrtimer_cpu_base *cpu_base,
 	 * the timer base.
 	 */
 	raw_spin_unlock(&cpu_base->lock);
+	timer_placement_account(true);
 	trace_hrtimer_expire_entry(timer, now);
 #ifdef CONFIG_MTK_SCHED_MONITOR
 	mt_trace_hrt_start(fn);
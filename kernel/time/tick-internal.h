@@ -160,6 +160,21 @@ extern void timers_update_migration(bool update_nohz);
 static inline void timers_update_migration(bool update_nohz) { }
 #endif
 
+#ifdef CONFIG_TIMER_CAPACITY_AWARE
+extern int timer_placement_target(void);
+extern bool timer_placement_local(struct hrtimer *timer);
+extern void timer_placement_account(bool hrtimer);
+#else
+# if defined(CONFIG_SMP) && defined(CONFIG_NO_HZ_COMMON)
+static inline int timer_placement_target(void)
+{
+	return get_nohz_timer_target();
+}
+# endif
+static inline bool timer_placement_local(struct hrtimer *timer) { return false; }
+static inline void timer_placement_account(bool hrtimer) { }
+#endif
+
 DECLARE_PER_CPU(struct hrtimer_cpu_base, hrtimer_bases);
 
 extern u64 get_next_timer_interrupt(unsigned long basej, u64 basem);
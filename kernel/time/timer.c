@@ -870,7 +870,7 @@ get_target_base(struct timer_base *base, unsigned tflags)
 #ifdef CONFIG_SMP
 	if ((tflags & TIMER_PINNED) || !base->migration_enabled)
 		return get_timer_this_cpu_base(tflags);
-	return get_timer_cpu_base(tflags, get_nohz_timer_target());
+	return get_timer_cpu_base(tflags, timer_placement_target());
 #else
 	return get_timer_this_cpu_base(tflags);
 #endif
@@ -1325,6 +1325,7 @@ static void call_timer_fn(struct timer_list *timer, void (*fn)(unsigned long),
 	 */
 	lock_map_acquire(&lockdep_map);
 
+	timer_placement_account(false);
 	trace_timer_expire_entry(timer);
 #ifdef CONFIG_MTK_SCHED_MONITOR
 	mt_trace_sft_start(fn);
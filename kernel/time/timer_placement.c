@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * kernel/time/timer_placement.c
+ *
+ * Capacity aware placement of migratable timers on asymmetric (big.LITTLE)
+ * systems.
+ *
+ * get_nohz_timer_target() picks any non-idle CPU, so unpinned timers armed
+ * on a big core tend to stay on the big cluster and keep it out of deep
+ * idle. When kernel.timer_migration_capacity is set, unpinned timer wheel
+ * timers and hrtimers go to the busy CPU with the lowest capacity instead,
+ * and hrtimers which are latency critical (armed by RT/DL tasks or expiring
+ * within kernel.timer_migration_local_ns) stay on the local CPU.
+ *
+ * Per-CPU expiry and idle wakeup counts are exported in
+ * /proc/timer_placement so the idle residency gained can be quantified.
+ */
+
+#include <linux/arch_topology.h>
+#include <linux/hrtimer.h>
+#include <linux/init.h>
+#include <linux/percpu.h>
+#include <linux/proc_fs.h>
+#include <linux/sched.h>
+#include <linux/sched/nohz.h>
+#include <linux/sched/rt.h>
+#include <linux/seq_file.h>
+#include <linux/tick.h>
+#include <linux/timer.h>
+
+#include "tick-internal.h"
+
+unsigned int sysctl_timer_migration_capacity = 1;
+unsigned int sysctl_timer_migration_local_ns = 2 * NSEC_PER_MSEC;
+
+struct timer_placement_stats {
+	unsigned long	timer_expired;
+	unsigned long	timer_wakeups;
+	unsigned long	hrtimer_expired;
+	unsigned long	hrtimer_wakeups;
+	unsigned long	placed_local;
+	unsigned long	placed_remote;
+	unsigned long	kept_local;
+};
+
+static DEFINE_PER_CPU(struct timer_placement_stats, timer_placement_stats);
+
+static inline unsigned long timer_cpu_capacity(int cpu)
+{
+	return topology_get_cpu_scale(NULL, cpu);
+}
+
+/*
+ * Pick the busy housekeeping CPU with the lowest capacity. The local CPU
+ * wins ties so that timers are not bounced around within a cluster. Falls
+ * back to get_nohz_timer_target() when every candidate is idle.
+ */
+int timer_placement_target(void)
+{
+	int cpu = smp_processor_id();
+	unsigned long cap, best_cap = ULONG_MAX;
+	int i, best = -1;
+
+	if (!sysctl_timer_migration_capacity)
+		return get_nohz_timer_target();
+
+	if (!idle_cpu(cpu) && is_housekeeping_cpu(cpu)) {
+		best = cpu;
+		best_cap = timer_cpu_capacity(cpu);
+	}
+
+	for_each_cpu_and(i, cpu_online_mask, housekeeping_cpumask()) {
+		if (i == cpu || idle_cpu(i))
+			continue;
+
+		cap = timer_cpu_capacity(i);
+		if (cap < best_cap) {
+			best = i;
+			best_cap = cap;
+		}
+	}
+
+	if (best < 0)
+		best = get_nohz_timer_target();
+
+	if (best == cpu)
+		this_cpu_inc(timer_placement_stats.placed_local);
+	else
+		this_cpu_inc(timer_placement_stats.placed_remote);
+
+	return best;
+}
+
+/*
+ * Latency critical hrtimers must not pay for a remote CPU wakeup or for a
+ * slower core running their callback.
+ */
+bool timer_placement_local(struct hrtimer *timer)
+{
+	s64 delta;
+
+	if (!sysctl_timer_migration_capacity)
+		return false;
+
+	if (rt_task(current))
+		goto local;
+
+	delta = ktime_to_ns(ktime_sub(hrtimer_get_expires(timer),
+				      timer->base->get_time()));
+	if (delta < sysctl_timer_migration_local_ns)
+		goto local;
+
+	return false;
+local:
+	this_cpu_inc(timer_placement_stats.kept_local);
+	return true;
+}
+
+/*
+ * Called on the expiring CPU right before the callback, with the base lock
+ * already dropped. The stats are only ever written by their own CPU, and
+ * this_cpu ops keep the counts right when a timer interrupt expiring
+ * hrtimers lands in the middle of timer softirq or of a placement.
+ */
+void timer_placement_account(bool hrtimer)
+{
+	unsigned long from_idle = is_idle_task(current);
+
+	if (hrtimer) {
+		this_cpu_inc(timer_placement_stats.hrtimer_expired);
+		this_cpu_add(timer_placement_stats.hrtimer_wakeups, from_idle);
+	} else {
+		this_cpu_inc(timer_placement_stats.timer_expired);
+		this_cpu_add(timer_placement_stats.timer_wakeups, from_idle);
+	}
+}
+
+static int timer_placement_show(struct seq_file *m, void *v)
+{
+	int cpu;
+
+	seq_puts(m, "cpu capacity timer_expired timer_wakeups hrtimer_expired hrtimer_wakeups placed_local placed_remote kept_local\n");
+	for_each_possible_cpu(cpu) {
+		struct timer_placement_stats *s;
+
+		s = per_cpu_ptr(&timer_placement_stats, cpu);
+		seq_printf(m, "%d %lu %lu %lu %lu %lu %lu %lu %lu\n",
+			   cpu, timer_cpu_capacity(cpu),
+			   s->timer_expired, s->timer_wakeups,
+			   s->hrtimer_expired, s->hrtimer_wakeups,
+			   s->placed_local, s->placed_remote, s->kept_local);
+	}
+
+	return 0;
+}
+
+static int timer_placement_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, timer_placement_show, NULL);
+}
+
+static const struct file_operations timer_placement_fops = {
+	.open		= timer_placement_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init timer_placement_init(void)
+{
+	proc_create("timer_placement", 0444, NULL, &timer_placement_fops);
+	return 0;
+}
+device_initcall(timer_placement_init);
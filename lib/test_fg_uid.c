@@ -0,0 +1,260 @@
+/*
+ * Foreground UID registry lookup benchmark
+ *
+ * Measures is_fg() from a hot path context (irqs off) for growing
+ * numbers of foreground UIDs and compares it with a linear scan of the
+ * same UIDs. Then runs lookups on every online CPU while one thread
+ * keeps adding and removing UIDs, and checks that readers always see
+ * the UIDs that stay in the set and that every change was notified.
+ *
+ * The registry is left empty when the module is loaded.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#define pr_fmt(fmt) "test_fg_uid: " fmt
+
+#include <linux/atomic.h>
+#include <linux/cpu.h>
+#include <linux/cred.h>
+#include <linux/delay.h>
+#include <linux/irqflags.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/notifier.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+
+#define FG_BENCH_UID_BASE	10000
+#define FG_BENCH_STABLE_UID	1000	/* stays in the set during churn */
+
+static unsigned int loops = 100000;
+module_param(loops, uint, 0444);
+MODULE_PARM_DESC(loops, "Lookups per measurement");
+
+static unsigned int churn_ms = 500;
+module_param(churn_ms, uint, 0444);
+MODULE_PARM_DESC(churn_ms, "Duration of the concurrent update test");
+
+static const unsigned int fg_bench_counts[] = { 1, 8, 64, 256, FG_UID_MAX };
+
+static int *fg_bench_uids;
+
+static noinline bool fg_bench_linear(const int *uids, unsigned int nr, int uid)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++)
+		if (uids[i] == uid)
+			return true;
+
+	return false;
+}
+
+/* ns per lookup, hit or miss, with irqs off as on a scheduler path */
+static u64 fg_bench_lookup(unsigned int nr, bool hit, bool linear)
+{
+	unsigned long flags;
+	unsigned int i, found = 0;
+	u64 t0, t1;
+	int uid;
+
+	local_irq_save(flags);
+	t0 = ktime_get_ns();
+	for (i = 0; i < loops; i++) {
+		uid = hit ? fg_bench_uids[i % nr] : FG_BENCH_UID_BASE - 1 - i;
+		if (linear)
+			found += fg_bench_linear(fg_bench_uids, nr, uid);
+		else
+			found += is_fg(uid);
+	}
+	t1 = ktime_get_ns();
+	local_irq_restore(flags);
+
+	if (found != (hit ? loops : 0))
+		pr_err("%s lookup of %u uids found %u of %u\n",
+			linear ? "linear" : "hash", nr, found,
+			hit ? loops : 0);
+
+	return div_u64((t1 - t0) * 1000, loops);	/* in 1/1000 ns */
+}
+
+static int fg_bench_scaling(void)
+{
+	unsigned int i, nr;
+	u64 hit, miss, lin_hit, lin_miss;
+	int ret;
+
+	pr_info("uids  hash hit/miss ns   linear hit/miss ns\n");
+	for (i = 0; i < ARRAY_SIZE(fg_bench_counts); i++) {
+		nr = fg_bench_counts[i];
+		ret = fg_uid_replace(fg_bench_uids, nr);
+		if (ret)
+			return ret;
+
+		hit = fg_bench_lookup(nr, true, false);
+		miss = fg_bench_lookup(nr, false, false);
+		lin_hit = fg_bench_lookup(nr, true, true);
+		lin_miss = fg_bench_lookup(nr, false, true);
+
+		pr_info("%4u  %4llu.%03llu %4llu.%03llu  %6llu.%03llu %6llu.%03llu\n",
+			nr, hit / 1000, hit % 1000, miss / 1000, miss % 1000,
+			lin_hit / 1000, lin_hit % 1000,
+			lin_miss / 1000, lin_miss % 1000);
+	}
+
+	return 0;
+}
+
+static atomic_long_t fg_bench_nr_ntf;
+static atomic_long_t fg_bench_nr_lookup;
+static atomic_t fg_bench_nr_miss;
+
+static int fg_bench_ntf(struct notifier_block *nb, unsigned long action,
+		void *data)
+{
+	struct fg_uid_event *ev = data;
+
+	if (ev->uid != FG_BENCH_STABLE_UID)
+		atomic_long_inc(&fg_bench_nr_ntf);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block fg_bench_nb = {
+	.notifier_call = fg_bench_ntf,
+};
+
+static int fg_bench_reader(void *data)
+{
+	unsigned long n = 0;
+	int uid;
+
+	while (!kthread_should_stop()) {
+		if (!is_fg(FG_BENCH_STABLE_UID))
+			atomic_inc(&fg_bench_nr_miss);
+		uid = FG_BENCH_UID_BASE + (prandom_u32() % FG_UID_MAX);
+		is_fg(uid);
+		n += 2;
+		if (!(n & 0xfff))
+			cond_resched();
+	}
+	atomic_long_add(n, &fg_bench_nr_lookup);
+
+	return 0;
+}
+
+static int fg_bench_churn(void)
+{
+	struct task_struct **tsk;
+	unsigned long changes = 0, end;
+	unsigned int nr = FG_UID_MAX / 2;
+	int cpu, uid, ret;
+	u64 t0;
+
+	tsk = kcalloc(nr_cpu_ids, sizeof(*tsk), GFP_KERNEL);
+	if (!tsk)
+		return -ENOMEM;
+
+	fg_bench_uids[0] = FG_BENCH_STABLE_UID;
+	ret = fg_uid_replace(fg_bench_uids, nr);
+	if (ret)
+		goto out;
+	fg_uid_register_notifier(&fg_bench_nb);
+
+	get_online_cpus();
+	for_each_online_cpu(cpu) {
+		tsk[cpu] = kthread_create(fg_bench_reader, NULL,
+				"fg_bench/%d", cpu);
+		if (IS_ERR(tsk[cpu])) {
+			tsk[cpu] = NULL;
+			continue;
+		}
+		kthread_bind(tsk[cpu], cpu);
+		wake_up_process(tsk[cpu]);
+	}
+	put_online_cpus();
+
+	t0 = ktime_get_ns();
+	end = jiffies + msecs_to_jiffies(churn_ms);
+	ret = 0;
+	while (time_before(jiffies, end)) {
+		uid = FG_BENCH_UID_BASE + FG_UID_MAX +
+			(prandom_u32() % FG_UID_MAX);
+		ret = is_fg(uid) ? fg_uid_del(uid) : fg_uid_add(uid);
+		cond_resched();
+		if (ret == -E2BIG)
+			continue;
+		if (ret)
+			break;
+		changes++;
+	}
+	t0 = ktime_get_ns() - t0;
+	if (ret == -E2BIG)
+		ret = 0;
+
+	for_each_possible_cpu(cpu)
+		if (tsk[cpu])
+			kthread_stop(tsk[cpu]);
+	fg_uid_unregister_notifier(&fg_bench_nb);
+
+	pr_info("churn: %lu updates (%llu ns each), %ld lookups, %ld notified\n",
+		changes, changes ? div64_u64(t0, changes) : 0,
+		atomic_long_read(&fg_bench_nr_lookup),
+		atomic_long_read(&fg_bench_nr_ntf));
+
+	if (atomic_read(&fg_bench_nr_miss)) {
+		pr_err("FAIL: stable uid missed %d times\n",
+			atomic_read(&fg_bench_nr_miss));
+		ret = -EINVAL;
+	} else if (atomic_long_read(&fg_bench_nr_ntf) != changes) {
+		pr_err("FAIL: %lu changes but %ld notifications\n",
+			changes, atomic_long_read(&fg_bench_nr_ntf));
+		ret = -EINVAL;
+	}
+out:
+	kfree(tsk);
+	return ret;
+}
+
+static int __init test_fg_uid_init(void)
+{
+	unsigned long gen;
+	int i, ret;
+
+	fg_bench_uids = kmalloc_array(FG_UID_MAX, sizeof(int), GFP_KERNEL);
+	if (!fg_bench_uids)
+		return -ENOMEM;
+	for (i = 0; i < FG_UID_MAX; i++)
+		fg_bench_uids[i] = FG_BENCH_UID_BASE + i * 7;
+
+	gen = fg_uid_generation();
+	ret = fg_bench_scaling();
+	if (!ret && fg_uid_generation() - gen != ARRAY_SIZE(fg_bench_counts)) {
+		pr_err("FAIL: generation did not follow the updates\n");
+		ret = -EINVAL;
+	}
+	if (!ret)
+		ret = fg_bench_churn();
+
+	fg_uid_replace(NULL, 0);
+	kfree(fg_bench_uids);
+
+	if (!ret)
+		pr_info("PASS\n");
+
+	return ret;
+}
+
+static void __exit test_fg_uid_exit(void)
+{
+}
+
+module_init(test_fg_uid_init);
+module_exit(test_fg_uid_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Foreground UID registry lookup benchmark");
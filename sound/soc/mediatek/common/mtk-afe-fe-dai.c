@@ -22,6 +22,7 @@
 #include <sound/pcm_params.h>
 
 #include "mtk-afe-fe-dai.h"
+#include "mtk-afe-latency.h"
 #include "mtk-base-afe.h"
 #if defined(CONFIG_MTK_VOW_BARGE_IN_SUPPORT)
 #include "../scp_vow/mtk-scp-vow-common.h"
@@ -435,6 +436,8 @@ int mtk_afe_fe_trigger(struct snd_pcm_substream *substream, int cmd,
 				       << irq_data->irq_fs_shift,
 				       fs << irq_data->irq_fs_shift);
 
+		mtk_afe_lat_stream_start(afe->lat, id, substream);
+
 		/* enable interrupt */
 		mtk_regmap_update_bits(afe->regmap, irq_data->irq_en_reg,
 				       1 << irq_data->irq_en_shift,
@@ -456,6 +459,8 @@ int mtk_afe_fe_trigger(struct snd_pcm_substream *substream, int cmd,
 		/* and clear pending IRQ */
 		mtk_regmap_write(afe->regmap, irq_data->irq_clr_reg,
 				 1 << irq_data->irq_clr_shift);
+
+		mtk_afe_lat_stream_stop(afe->lat, id);
 		return ret;
 	default:
 		return -EINVAL;
@@ -470,6 +475,9 @@ int mtk_afe_fe_prepare(struct snd_pcm_substream *substream,
 	struct mtk_base_afe *afe = snd_soc_dai_get_drvdata(dai);
 	int id = rtd->cpu_dai->id;
 
+	/* catch xruns not seen from irq, e.g. found on hwsync */
+	mtk_afe_lat_check_xrun(afe->lat, id, substream, "prepare");
+
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
 		if (afe->get_memif_pbuf_size) {
 			int pbuf_size = afe->get_memif_pbuf_size(substream);
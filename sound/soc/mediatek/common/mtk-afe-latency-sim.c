@@ -0,0 +1,305 @@
+// SPDX-License-Identifier: GPL-2.0
+//
+// mtk-afe-latency-sim.c  --  Mediatek AFE latency instrumentation simulator
+//
+// Copyright (c) 2019 MediaTek Inc.
+//
+// A hrtimer driven memif bound to the ASoC dummy codec, so the AFE latency
+// histograms and the XRUN snapshot can be exercised with aplay/arecord or
+// tinyplay on a machine without MediaTek audio hardware. stall_every and
+// stall_us inject irq handling delay to provoke XRUNs on purpose.
+
+#include <linux/delay.h>
+#include <linux/hrtimer.h>
+#include <linux/module.h>
+#include <linux/platform_device.h>
+
+#include <sound/pcm_params.h>
+#include <sound/soc.h>
+
+#include "mtk-afe-latency.h"
+
+#define LAT_SIM_NAME		"mtk-afe-lat-sim"
+#define LAT_SIM_DAI_NAME	"mtk-afe-lat-sim-dai"
+#define LAT_SIM_BUFFER_MAX	(64 * 1024)
+
+static unsigned int stall_every;
+module_param(stall_every, uint, 0644);
+MODULE_PARM_DESC(stall_every, "Stall the fake irq every N periods, 0 = off");
+
+static unsigned int stall_us = 5000;
+module_param(stall_us, uint, 0644);
+MODULE_PARM_DESC(stall_us, "Fake irq stall duration in us");
+
+struct mtk_afe_lat_sim {
+	struct mtk_afe_lat *lat;
+	struct hrtimer timer;
+	struct snd_pcm_substream *substream;
+	ktime_t period;
+	snd_pcm_uframes_t pos;
+	unsigned int irq_cnt;
+	bool running;
+};
+
+static struct mtk_afe_lat_sim lat_sim;
+static struct platform_device *lat_sim_pdev;
+
+static const struct snd_pcm_hardware lat_sim_hardware = {
+	.info = (SNDRV_PCM_INFO_MMAP | SNDRV_PCM_INFO_INTERLEAVED |
+		 SNDRV_PCM_INFO_MMAP_VALID),
+	.formats = SNDRV_PCM_FMTBIT_S16_LE | SNDRV_PCM_FMTBIT_S32_LE,
+	.rates = SNDRV_PCM_RATE_8000_192000,
+	.rate_min = 8000,
+	.rate_max = 192000,
+	.channels_min = 1,
+	.channels_max = 2,
+	.buffer_bytes_max = LAT_SIM_BUFFER_MAX,
+	.period_bytes_min = 256,
+	.period_bytes_max = LAT_SIM_BUFFER_MAX / 2,
+	.periods_min = 2,
+	.periods_max = 256,
+};
+
+static enum hrtimer_restart lat_sim_irq(struct hrtimer *timer)
+{
+	struct mtk_afe_lat_sim *sim = container_of(timer,
+						   struct mtk_afe_lat_sim,
+						   timer);
+	struct snd_pcm_runtime *runtime;
+	u64 lat_begin = mtk_afe_lat_begin();
+
+	if (!READ_ONCE(sim->running))
+		return HRTIMER_NORESTART;
+
+	runtime = sim->substream->runtime;
+
+	if (stall_every && ++sim->irq_cnt % stall_every == 0)
+		udelay(stall_us);
+
+	sim->pos = (sim->pos + runtime->period_size) % runtime->buffer_size;
+	mtk_afe_lat_period_elapsed(sim->lat, 0, sim->substream, lat_begin);
+
+	hrtimer_forward_now(timer, sim->period);
+	return HRTIMER_RESTART;
+}
+
+static int lat_sim_pcm_open(struct snd_pcm_substream *substream)
+{
+	snd_soc_set_runtime_hwparams(substream, &lat_sim_hardware);
+	return snd_pcm_hw_constraint_integer(substream->runtime,
+					     SNDRV_PCM_HW_PARAM_PERIODS);
+}
+
+static int lat_sim_pcm_hw_params(struct snd_pcm_substream *substream,
+				 struct snd_pcm_hw_params *params)
+{
+	return snd_pcm_lib_malloc_pages(substream,
+					params_buffer_bytes(params));
+}
+
+static int lat_sim_pcm_hw_free(struct snd_pcm_substream *substream)
+{
+	return snd_pcm_lib_free_pages(substream);
+}
+
+static int lat_sim_pcm_prepare(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+
+	mtk_afe_lat_check_xrun(lat_sim.lat, 0, substream, "prepare");
+
+	lat_sim.pos = 0;
+	lat_sim.period = ns_to_ktime(div_u64((u64)runtime->period_size *
+					     NSEC_PER_SEC, runtime->rate));
+	return 0;
+}
+
+static int lat_sim_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
+{
+	switch (cmd) {
+	case SNDRV_PCM_TRIGGER_START:
+	case SNDRV_PCM_TRIGGER_RESUME:
+		lat_sim.substream = substream;
+		mtk_afe_lat_stream_start(lat_sim.lat, 0, substream);
+		WRITE_ONCE(lat_sim.running, true);
+		hrtimer_start(&lat_sim.timer, lat_sim.period,
+			      HRTIMER_MODE_REL);
+		return 0;
+	case SNDRV_PCM_TRIGGER_STOP:
+	case SNDRV_PCM_TRIGGER_SUSPEND:
+		/* atomic context, the callback sees !running and stops */
+		WRITE_ONCE(lat_sim.running, false);
+		hrtimer_try_to_cancel(&lat_sim.timer);
+		mtk_afe_lat_stream_stop(lat_sim.lat, 0);
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+static snd_pcm_uframes_t lat_sim_pcm_pointer(struct snd_pcm_substream *substream)
+{
+	u64 lat_begin = mtk_afe_lat_begin();
+	snd_pcm_uframes_t pos = READ_ONCE(lat_sim.pos);
+
+	mtk_afe_lat_end(lat_sim.lat, 0, MTK_AFE_LAT_POINTER, lat_begin, pos);
+	return pos;
+}
+
+static int lat_sim_pcm_ack(struct snd_pcm_substream *substream)
+{
+	u64 lat_begin = mtk_afe_lat_begin();
+
+	mtk_afe_lat_end(lat_sim.lat, 0, MTK_AFE_LAT_ACK, lat_begin,
+			substream->runtime->control->appl_ptr);
+	return 0;
+}
+
+static const struct snd_pcm_ops lat_sim_pcm_ops = {
+	.open = lat_sim_pcm_open,
+	.ioctl = snd_pcm_lib_ioctl,
+	.hw_params = lat_sim_pcm_hw_params,
+	.hw_free = lat_sim_pcm_hw_free,
+	.prepare = lat_sim_pcm_prepare,
+	.trigger = lat_sim_pcm_trigger,
+	.pointer = lat_sim_pcm_pointer,
+	.ack = lat_sim_pcm_ack,
+};
+
+static int lat_sim_pcm_new(struct snd_soc_pcm_runtime *rtd)
+{
+	return snd_pcm_lib_preallocate_pages_for_all(rtd->pcm,
+			SNDRV_DMA_TYPE_CONTINUOUS,
+			snd_dma_continuous_data(GFP_KERNEL),
+			LAT_SIM_BUFFER_MAX, LAT_SIM_BUFFER_MAX);
+}
+
+static void lat_sim_pcm_free(struct snd_pcm *pcm)
+{
+	snd_pcm_lib_preallocate_free_for_all(pcm);
+}
+
+static const struct snd_soc_platform_driver lat_sim_platform = {
+	.ops = &lat_sim_pcm_ops,
+	.pcm_new = lat_sim_pcm_new,
+	.pcm_free = lat_sim_pcm_free,
+};
+
+static struct snd_soc_dai_driver lat_sim_dai = {
+	.name = LAT_SIM_DAI_NAME,
+	.playback = {
+		.stream_name = "Sim Playback",
+		.channels_min = 1,
+		.channels_max = 2,
+		.rates = SNDRV_PCM_RATE_8000_192000,
+		.formats = SNDRV_PCM_FMTBIT_S16_LE | SNDRV_PCM_FMTBIT_S32_LE,
+	},
+	.capture = {
+		.stream_name = "Sim Capture",
+		.channels_min = 1,
+		.channels_max = 2,
+		.rates = SNDRV_PCM_RATE_8000_192000,
+		.formats = SNDRV_PCM_FMTBIT_S16_LE | SNDRV_PCM_FMTBIT_S32_LE,
+	},
+};
+
+static const struct snd_soc_component_driver lat_sim_component = {
+	.name = LAT_SIM_NAME,
+};
+
+static struct snd_soc_dai_link lat_sim_dai_link = {
+	.name = "lat-sim",
+	.stream_name = "lat-sim",
+	.cpu_dai_name = LAT_SIM_DAI_NAME,
+	.platform_name = LAT_SIM_NAME,
+	.codec_name = "snd-soc-dummy",
+	.codec_dai_name = "snd-soc-dummy-dai",
+};
+
+static struct snd_soc_card lat_sim_card = {
+	.name = "mtk-afe-lat-sim",
+	.owner = THIS_MODULE,
+	.dai_link = &lat_sim_dai_link,
+	.num_links = 1,
+};
+
+static int lat_sim_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	int ret;
+
+	hrtimer_init(&lat_sim.timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	lat_sim.timer.function = lat_sim_irq;
+
+	lat_sim.lat = mtk_afe_lat_create(dev, "mtk_afe_lat_sim", 1);
+	if (!lat_sim.lat)
+		return -ENOMEM;
+	mtk_afe_lat_set_name(lat_sim.lat, 0, "SIM");
+
+	ret = devm_snd_soc_register_platform(dev, &lat_sim_platform);
+	if (ret)
+		goto err;
+
+	ret = devm_snd_soc_register_component(dev, &lat_sim_component,
+					      &lat_sim_dai, 1);
+	if (ret)
+		goto err;
+
+	lat_sim_card.dev = dev;
+	ret = devm_snd_soc_register_card(dev, &lat_sim_card);
+	if (ret)
+		goto err;
+
+	return 0;
+err:
+	dev_err(dev, "%s(), ret %d\n", __func__, ret);
+	mtk_afe_lat_destroy(lat_sim.lat);
+	lat_sim.lat = NULL;
+	return ret;
+}
+
+static int lat_sim_remove(struct platform_device *pdev)
+{
+	hrtimer_cancel(&lat_sim.timer);
+	mtk_afe_lat_destroy(lat_sim.lat);
+	lat_sim.lat = NULL;
+	return 0;
+}
+
+static struct platform_driver lat_sim_driver = {
+	.driver = {
+		.name = LAT_SIM_NAME,
+	},
+	.probe = lat_sim_probe,
+	.remove = lat_sim_remove,
+};
+
+static int __init lat_sim_init(void)
+{
+	int ret;
+
+	ret = platform_driver_register(&lat_sim_driver);
+	if (ret)
+		return ret;
+
+	lat_sim_pdev = platform_device_register_simple(LAT_SIM_NAME, -1,
+						       NULL, 0);
+	if (IS_ERR(lat_sim_pdev)) {
+		platform_driver_unregister(&lat_sim_driver);
+		return PTR_ERR(lat_sim_pdev);
+	}
+
+	return 0;
+}
+
+static void __exit lat_sim_exit(void)
+{
+	platform_device_unregister(lat_sim_pdev);
+	platform_driver_unregister(&lat_sim_driver);
+}
+
+module_init(lat_sim_init);
+module_exit(lat_sim_exit);
+
+MODULE_DESCRIPTION("Mediatek AFE latency instrumentation simulator");
+MODULE_LICENSE("GPL v2");
@@ -0,0 +1,618 @@
+// SPDX-License-Identifier: GPL-2.0
+//
+// mtk-afe-latency.c  --  Mediatek AFE latency instrumentation
+//
+// Copyright (c) 2019 MediaTek Inc.
+//
+// Per-memif latency histograms of the irq, pointer and ack paths, plus an
+// always-on per-cpu ring of audio, scheduler and hard irq events. When an
+// XRUN is detected the rings are frozen into a snapshot so the events that
+// preceded it can be inspected from debugfs afterwards.
+
+#include <linux/debugfs.h>
+#include <linux/device.h>
+#include <linux/interrupt.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/tracepoint.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+
+#include <sound/pcm.h>
+
+#include "mtk-afe-latency.h"
+
+/* log2 usec buckets: <1us, 1us, 2~3us, ..., >= 16ms */
+#define MTK_AFE_LAT_BUCKETS	16
+/* events kept per cpu, power of 2 */
+#define MTK_AFE_LAT_RING_SIZE	256
+
+static const char * const lat_type_name[MTK_AFE_LAT_TYPE_NUM] = {
+	[MTK_AFE_LAT_IRQ] = "irq",
+	[MTK_AFE_LAT_POINTER] = "pointer",
+	[MTK_AFE_LAT_ACK] = "ack",
+	[MTK_AFE_LAT_PERIOD] = "period",
+};
+
+enum mtk_afe_lat_ev_type {
+	LAT_EV_NONE,
+	LAT_EV_IRQ,
+	LAT_EV_ELAPSED,
+	LAT_EV_POINTER,
+	LAT_EV_ACK,
+	LAT_EV_START,
+	LAT_EV_STOP,
+	LAT_EV_XRUN,
+	LAT_EV_SCHED_SWITCH,
+	LAT_EV_SCHED_WAKEUP,
+	LAT_EV_HARDIRQ,
+};
+
+static const char * const lat_ev_name[] = {
+	[LAT_EV_NONE] = "none",
+	[LAT_EV_IRQ] = "afe_irq",
+	[LAT_EV_ELAPSED] = "elapsed",
+	[LAT_EV_POINTER] = "pointer",
+	[LAT_EV_ACK] = "ack",
+	[LAT_EV_START] = "start",
+	[LAT_EV_STOP] = "stop",
+	[LAT_EV_XRUN] = "XRUN",
+	[LAT_EV_SCHED_SWITCH] = "switch",
+	[LAT_EV_SCHED_WAKEUP] = "wakeup",
+	[LAT_EV_HARDIRQ] = "hardirq",
+};
+
+struct mtk_afe_lat_event {
+	u64 ts;
+	u32 a;
+	u32 b;
+	u16 type;
+	s16 id;
+	pid_t pid;
+	int prio;
+	char comm[TASK_COMM_LEN];
+};
+
+struct mtk_afe_lat_ring {
+	unsigned int head;
+	struct mtk_afe_lat_event ev[MTK_AFE_LAT_RING_SIZE];
+};
+
+struct mtk_afe_lat_hist {
+	u64 count;
+	u64 sum;
+	u64 max;
+	u32 bucket[MTK_AFE_LAT_BUCKETS];
+};
+
+struct mtk_afe_lat_memif {
+	const char *name;
+	bool running;
+	bool xrun_logged;
+	unsigned int xrun_cnt;
+	u64 last_irq;
+	u64 period_ns;
+	struct mtk_afe_lat_hist hist[MTK_AFE_LAT_TYPE_NUM];
+};
+
+struct mtk_afe_lat_snapshot {
+	bool valid;
+	u64 ts;
+	int id;
+	const char *where;
+	unsigned long hw_ptr;
+	unsigned long appl_ptr;
+	/* nr_cpu_ids rings, oldest event first */
+	struct mtk_afe_lat_event ev[0];
+};
+
+struct mtk_afe_lat {
+	struct device *dev;
+	struct dentry *dir;
+	int nr_memif;
+	struct mtk_afe_lat_memif *memif;
+
+	spinlock_t snap_lock;	/* protects snap */
+	struct mtk_afe_lat_snapshot *snap;
+};
+
+static DEFINE_PER_CPU(struct mtk_afe_lat_ring, lat_ring);
+static atomic_t lat_active = ATOMIC_INIT(0);
+static atomic_t lat_frozen = ATOMIC_INIT(0);
+
+static DEFINE_MUTEX(lat_tp_lock);
+static int lat_tp_users;
+
+static size_t lat_snap_size(void)
+{
+	return sizeof(struct mtk_afe_lat_snapshot) +
+	       nr_cpu_ids * MTK_AFE_LAT_RING_SIZE *
+	       sizeof(struct mtk_afe_lat_event);
+}
+
+static void lat_log(u16 type, s16 id, u32 a, u32 b, struct task_struct *t)
+{
+	struct mtk_afe_lat_ring *ring;
+	struct mtk_afe_lat_event *ev;
+	unsigned long flags;
+
+	if (atomic_read(&lat_frozen))
+		return;
+
+	local_irq_save(flags);
+	ring = this_cpu_ptr(&lat_ring);
+	ev = &ring->ev[ring->head++ & (MTK_AFE_LAT_RING_SIZE - 1)];
+	ev->ts = ktime_get_ns();
+	ev->type = type;
+	ev->id = id;
+	ev->a = a;
+	ev->b = b;
+	ev->pid = t->pid;
+	ev->prio = t->prio;
+	memcpy(ev->comm, t->comm, TASK_COMM_LEN);
+	local_irq_restore(flags);
+}
+
+/* scheduler and irq probes, only log while an instrumented stream runs */
+static void lat_probe_sched_switch(void *data, bool preempt,
+				   struct task_struct *prev,
+				   struct task_struct *next)
+{
+	if (!atomic_read(&lat_active))
+		return;
+	lat_log(LAT_EV_SCHED_SWITCH, -1, prev->pid, preempt, next);
+}
+
+static void lat_probe_sched_wakeup(void *data, struct task_struct *p)
+{
+	if (!atomic_read(&lat_active))
+		return;
+	lat_log(LAT_EV_SCHED_WAKEUP, -1, task_cpu(p), 0, p);
+}
+
+static void lat_probe_irq_entry(void *data, int irq, struct irqaction *action)
+{
+	if (!atomic_read(&lat_active))
+		return;
+	lat_log(LAT_EV_HARDIRQ, -1, irq, 0, current);
+}
+
+static struct {
+	const char *name;
+	void *probe;
+	struct tracepoint *tp;
+} lat_tps[] = {
+	{ .name = "sched_switch", .probe = lat_probe_sched_switch, },
+	{ .name = "sched_wakeup", .probe = lat_probe_sched_wakeup, },
+	{ .name = "irq_handler_entry", .probe = lat_probe_irq_entry, },
+};
+
+static void lat_lookup_tp(struct tracepoint *tp, void *priv)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(lat_tps); i++) {
+		if (!strcmp(lat_tps[i].name, tp->name))
+			lat_tps[i].tp = tp;
+	}
+}
+
+static void lat_tp_get(struct device *dev)
+{
+	int i;
+
+	mutex_lock(&lat_tp_lock);
+	if (lat_tp_users++)
+		goto unlock;
+
+	for_each_kernel_tracepoint(lat_lookup_tp, NULL);
+	for (i = 0; i < ARRAY_SIZE(lat_tps); i++) {
+		if (!lat_tps[i].tp ||
+		    tracepoint_probe_register(lat_tps[i].tp,
+					      lat_tps[i].probe, NULL)) {
+			dev_warn(dev, "%s(), %s not traced\n",
+				 __func__, lat_tps[i].name);
+			lat_tps[i].tp = NULL;
+		}
+	}
+unlock:
+	mutex_unlock(&lat_tp_lock);
+}
+
+static void lat_tp_put(void)
+{
+	int i;
+
+	mutex_lock(&lat_tp_lock);
+	if (--lat_tp_users)
+		goto unlock;
+
+	for (i = 0; i < ARRAY_SIZE(lat_tps); i++) {
+		if (lat_tps[i].tp)
+			tracepoint_probe_unregister(lat_tps[i].tp,
+						    lat_tps[i].probe, NULL);
+		lat_tps[i].tp = NULL;
+	}
+	tracepoint_synchronize_unregister();
+unlock:
+	mutex_unlock(&lat_tp_lock);
+}
+
+static void lat_hist_add(struct mtk_afe_lat_hist *hist, u64 ns)
+{
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+	int idx = min_t(int, fls64(us), MTK_AFE_LAT_BUCKETS - 1);
+
+	hist->bucket[idx]++;
+	hist->count++;
+	hist->sum += ns;
+	if (ns > hist->max)
+		hist->max = ns;
+}
+
+static inline bool lat_valid(struct mtk_afe_lat *lat, int id)
+{
+	return lat && id >= 0 && id < lat->nr_memif;
+}
+
+void mtk_afe_lat_set_name(struct mtk_afe_lat *lat, int id, const char *name)
+{
+	if (lat_valid(lat, id))
+		lat->memif[id].name = name;
+}
+EXPORT_SYMBOL_GPL(mtk_afe_lat_set_name);
+
+void mtk_afe_lat_stream_start(struct mtk_afe_lat *lat, int id,
+			      struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct mtk_afe_lat_memif *m;
+
+	if (!lat_valid(lat, id))
+		return;
+
+	m = &lat->memif[id];
+	if (m->running)
+		return;
+
+	m->period_ns = runtime->rate ?
+		div_u64((u64)runtime->period_size * NSEC_PER_SEC,
+			runtime->rate) : 0;
+	m->last_irq = 0;
+	m->xrun_logged = false;
+	m->running = true;
+	atomic_inc(&lat_active);
+	lat_log(LAT_EV_START, id, runtime->period_size, runtime->rate,
+		current);
+}
+EXPORT_SYMBOL_GPL(mtk_afe_lat_stream_start);
+
+void mtk_afe_lat_stream_stop(struct mtk_afe_lat *lat, int id)
+{
+	struct mtk_afe_lat_memif *m;
+
+	if (!lat_valid(lat, id))
+		return;
+
+	m = &lat->memif[id];
+	if (!m->running)
+		return;
+
+	lat_log(LAT_EV_STOP, id, 0, 0, current);
+	m->running = false;
+	atomic_dec(&lat_active);
+}
+EXPORT_SYMBOL_GPL(mtk_afe_lat_stream_stop);
+
+void mtk_afe_lat_end(struct mtk_afe_lat *lat, int id,
+		     enum mtk_afe_lat_type type, u64 begin, u32 val)
+{
+	u64 delta;
+
+	if (!lat_valid(lat, id))
+		return;
+
+	delta = ktime_get_ns() - begin;
+	lat_hist_add(&lat->memif[id].hist[type], delta);
+
+	switch (type) {
+	case MTK_AFE_LAT_POINTER:
+		lat_log(LAT_EV_POINTER, id, (u32)delta, val, current);
+		break;
+	case MTK_AFE_LAT_ACK:
+		lat_log(LAT_EV_ACK, id, (u32)delta, val, current);
+		break;
+	case MTK_AFE_LAT_IRQ:
+		lat_log(LAT_EV_ELAPSED, id, (u32)delta, val, current);
+		break;
+	default:
+		break;
+	}
+}
+EXPORT_SYMBOL_GPL(mtk_afe_lat_end);
+
+static void lat_take_snapshot(struct mtk_afe_lat *lat, int id,
+			      struct snd_pcm_runtime *runtime,
+			      const char *where)
+{
+	struct mtk_afe_lat_snapshot *snap = lat->snap;
+	struct mtk_afe_lat_event *dst;
+	unsigned long flags;
+	int cpu;
+
+	if (!snap)
+		return;
+
+	/* stop all writers while the rings are copied out */
+	if (atomic_inc_return(&lat_frozen) != 1)
+		goto out;
+
+	spin_lock_irqsave(&lat->snap_lock, flags);
+	snap->valid = true;
+	snap->ts = ktime_get_ns();
+	snap->id = id;
+	snap->where = where;
+	snap->hw_ptr = runtime->status->hw_ptr;
+	snap->appl_ptr = runtime->control->appl_ptr;
+
+	dst = snap->ev;
+	for_each_possible_cpu(cpu) {
+		struct mtk_afe_lat_ring *ring = per_cpu_ptr(&lat_ring, cpu);
+		unsigned int head = READ_ONCE(ring->head);
+		unsigned int i;
+
+		for (i = 0; i < MTK_AFE_LAT_RING_SIZE; i++)
+			*dst++ = ring->ev[(head + i) &
+					  (MTK_AFE_LAT_RING_SIZE - 1)];
+	}
+	spin_unlock_irqrestore(&lat->snap_lock, flags);
+out:
+	atomic_dec(&lat_frozen);
+}
+
+void mtk_afe_lat_check_xrun(struct mtk_afe_lat *lat, int id,
+			    struct snd_pcm_substream *substream,
+			    const char *where)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct mtk_afe_lat_memif *m;
+
+	if (!lat_valid(lat, id) || !runtime)
+		return;
+
+	if (runtime->status->state != SNDRV_PCM_STATE_XRUN)
+		return;
+
+	m = &lat->memif[id];
+	if (m->xrun_logged)
+		return;
+
+	m->xrun_logged = true;
+	m->xrun_cnt++;
+	lat_log(LAT_EV_XRUN, id, runtime->status->hw_ptr,
+		runtime->control->appl_ptr, current);
+	lat_take_snapshot(lat, id, runtime, where);
+}
+EXPORT_SYMBOL_GPL(mtk_afe_lat_check_xrun);
+
+void mtk_afe_lat_period_elapsed(struct mtk_afe_lat *lat, int id,
+				struct snd_pcm_substream *substream,
+				u64 irq_begin)
+{
+	struct mtk_afe_lat_memif *m;
+
+	if (!lat_valid(lat, id)) {
+		snd_pcm_period_elapsed(substream);
+		return;
+	}
+
+	m = &lat->memif[id];
+	lat_log(LAT_EV_IRQ, id, 0, 0, current);
+
+	if (m->last_irq && m->period_ns) {
+		s64 jitter = (s64)(irq_begin - m->last_irq) - m->period_ns;
+
+		lat_hist_add(&m->hist[MTK_AFE_LAT_PERIOD], abs(jitter));
+	}
+	m->last_irq = irq_begin;
+
+	snd_pcm_period_elapsed(substream);
+
+	mtk_afe_lat_end(lat, id, MTK_AFE_LAT_IRQ, irq_begin, 0);
+	mtk_afe_lat_check_xrun(lat, id, substream, "irq");
+}
+EXPORT_SYMBOL_GPL(mtk_afe_lat_period_elapsed);
+
+/* debugfs */
+static int lat_hist_show(struct seq_file *s, void *unused)
+{
+	struct mtk_afe_lat *lat = s->private;
+	int id, type, i;
+
+	seq_puts(s, "buckets(us): <1");
+	for (i = 1; i < MTK_AFE_LAT_BUCKETS; i++)
+		seq_printf(s, " %u", 1 << (i - 1));
+	seq_puts(s, "+\n");
+
+	for (id = 0; id < lat->nr_memif; id++) {
+		struct mtk_afe_lat_memif *m = &lat->memif[id];
+
+		if (!m->hist[MTK_AFE_LAT_POINTER].count &&
+		    !m->hist[MTK_AFE_LAT_IRQ].count)
+			continue;
+
+		seq_printf(s, "memif %d %s, running %d, xrun %u\n",
+			   id, m->name ? m->name : "", m->running,
+			   m->xrun_cnt);
+
+		for (type = 0; type < MTK_AFE_LAT_TYPE_NUM; type++) {
+			struct mtk_afe_lat_hist *h = &m->hist[type];
+
+			seq_printf(s, "  %-8s cnt %llu avg %llu max %llu |",
+				   lat_type_name[type], h->count,
+				   h->count ?
+				   div64_u64(h->sum, h->count * NSEC_PER_USEC) :
+				   0,
+				   div_u64(h->max, NSEC_PER_USEC));
+			for (i = 0; i < MTK_AFE_LAT_BUCKETS; i++)
+				seq_printf(s, " %u", h->bucket[i]);
+			seq_puts(s, "\n");
+		}
+	}
+
+	return 0;
+}
+
+static int lat_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lat_hist_show, inode->i_private);
+}
+
+static ssize_t lat_hist_write(struct file *file, const char __user *buf,
+			      size_t count, loff_t *ppos)
+{
+	struct mtk_afe_lat *lat = ((struct seq_file *)file->private_data)->private;
+	char cmd[8] = { 0 };
+	int id;
+
+	if (copy_from_user(cmd, buf, min(count, sizeof(cmd) - 1)))
+		return -EFAULT;
+
+	if (strncmp(cmd, "reset", 5))
+		return -EINVAL;
+
+	for (id = 0; id < lat->nr_memif; id++) {
+		memset(lat->memif[id].hist, 0, sizeof(lat->memif[id].hist));
+		lat->memif[id].xrun_cnt = 0;
+	}
+
+	return count;
+}
+
+static const struct file_operations lat_hist_fops = {
+	.open = lat_hist_open,
+	.read = seq_read,
+	.write = lat_hist_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int lat_xrun_show(struct seq_file *s, void *unused)
+{
+	struct mtk_afe_lat_snapshot *snap = s->private;
+	struct mtk_afe_lat_event *ev = snap->ev;
+	int cpu, i;
+
+	if (!snap->valid) {
+		seq_puts(s, "no xrun captured\n");
+		return 0;
+	}
+
+	seq_printf(s, "xrun memif %d at %llu ns (%s), hw_ptr %lu appl_ptr %lu\n",
+		   snap->id, snap->ts, snap->where,
+		   snap->hw_ptr, snap->appl_ptr);
+
+	for_each_possible_cpu(cpu) {
+		seq_printf(s, "cpu %d:\n", cpu);
+		for (i = 0; i < MTK_AFE_LAT_RING_SIZE; i++, ev++) {
+			if (ev->type == LAT_EV_NONE)
+				continue;
+			seq_printf(s, "  %+9lld us %-8s id %2d a %u b %u %s-%d prio %d\n",
+				   div_s64((s64)(ev->ts - snap->ts),
+					   NSEC_PER_USEC),
+				   lat_ev_name[ev->type], ev->id,
+				   ev->a, ev->b, ev->comm, ev->pid,
+				   ev->prio);
+		}
+	}
+
+	return 0;
+}
+
+static int lat_xrun_open(struct inode *inode, struct file *file)
+{
+	struct mtk_afe_lat *lat = inode->i_private;
+	struct mtk_afe_lat_snapshot *copy;
+	unsigned long flags;
+	int ret;
+
+	copy = vmalloc(lat_snap_size());
+	if (!copy)
+		return -ENOMEM;
+
+	spin_lock_irqsave(&lat->snap_lock, flags);
+	memcpy(copy, lat->snap, lat_snap_size());
+	spin_unlock_irqrestore(&lat->snap_lock, flags);
+
+	ret = single_open(file, lat_xrun_show, copy);
+	if (ret)
+		vfree(copy);
+	return ret;
+}
+
+static int lat_xrun_release(struct inode *inode, struct file *file)
+{
+	vfree(((struct seq_file *)file->private_data)->private);
+	return single_release(inode, file);
+}
+
+static const struct file_operations lat_xrun_fops = {
+	.open = lat_xrun_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = lat_xrun_release,
+};
+
+struct mtk_afe_lat *mtk_afe_lat_create(struct device *dev, const char *name,
+				       int nr_memif)
+{
+	struct mtk_afe_lat *lat;
+
+	lat = kzalloc(sizeof(*lat), GFP_KERNEL);
+	if (!lat)
+		return NULL;
+
+	lat->memif = kcalloc(nr_memif, sizeof(*lat->memif), GFP_KERNEL);
+	lat->snap = vzalloc(lat_snap_size());
+	if (!lat->memif || !lat->snap) {
+		kfree(lat->memif);
+		vfree(lat->snap);
+		kfree(lat);
+		return NULL;
+	}
+
+	lat->dev = dev;
+	lat->nr_memif = nr_memif;
+	spin_lock_init(&lat->snap_lock);
+
+	lat->dir = debugfs_create_dir(name, NULL);
+	debugfs_create_file("latency", 0644, lat->dir, lat, &lat_hist_fops);
+	debugfs_create_file("xrun", 0444, lat->dir, lat, &lat_xrun_fops);
+
+	lat_tp_get(dev);
+
+	return lat;
+}
+EXPORT_SYMBOL_GPL(mtk_afe_lat_create);
+
+void mtk_afe_lat_destroy(struct mtk_afe_lat *lat)
+{
+	int id;
+
+	if (!lat)
+		return;
+
+	for (id = 0; id < lat->nr_memif; id++)
+		mtk_afe_lat_stream_stop(lat, id);
+
+	debugfs_remove_recursive(lat->dir);
+	lat_tp_put();
+	vfree(lat->snap);
+	kfree(lat->memif);
+	kfree(lat);
+}
+EXPORT_SYMBOL_GPL(mtk_afe_lat_destroy);
@@ -0,0 +1,49 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * mtk-afe-latency.h  --  Mediatek AFE latency instrumentation
+ *
+ * Copyright (c) 2019 MediaTek Inc.
+ */
+
+#ifndef _MTK_AFE_LATENCY_H_
+#define _MTK_AFE_LATENCY_H_
+
+#include <linux/ktime.h>
+
+struct device;
+struct dentry;
+struct snd_pcm_substream;
+struct mtk_afe_lat;
+
+enum mtk_afe_lat_type {
+	MTK_AFE_LAT_IRQ,	/* irq entry to period_elapsed done */
+	MTK_AFE_LAT_POINTER,	/* .pointer callback */
+	MTK_AFE_LAT_ACK,	/* .ack callback, appl_ptr to DMA */
+	MTK_AFE_LAT_PERIOD,	/* deviation of irq interval from period */
+	MTK_AFE_LAT_TYPE_NUM,
+};
+
+struct mtk_afe_lat *mtk_afe_lat_create(struct device *dev, const char *name,
+				       int nr_memif);
+void mtk_afe_lat_destroy(struct mtk_afe_lat *lat);
+void mtk_afe_lat_set_name(struct mtk_afe_lat *lat, int id, const char *name);
+
+void mtk_afe_lat_stream_start(struct mtk_afe_lat *lat, int id,
+			      struct snd_pcm_substream *substream);
+void mtk_afe_lat_stream_stop(struct mtk_afe_lat *lat, int id);
+
+static inline u64 mtk_afe_lat_begin(void)
+{
+	return ktime_get_ns();
+}
+
+void mtk_afe_lat_end(struct mtk_afe_lat *lat, int id,
+		     enum mtk_afe_lat_type type, u64 begin, u32 val);
+void mtk_afe_lat_period_elapsed(struct mtk_afe_lat *lat, int id,
+				struct snd_pcm_substream *substream,
+				u64 irq_begin);
+void mtk_afe_lat_check_xrun(struct mtk_afe_lat *lat, int id,
+			    struct snd_pcm_substream *substream,
+			    const char *where);
+
+#endif
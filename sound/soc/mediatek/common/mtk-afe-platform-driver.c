@@ -18,6 +18,7 @@
 #include <linux/dma-mapping.h>
 #include <sound/soc.h>
 
+#include "mtk-afe-latency.h"
 #include "mtk-afe-platform-driver.h"
 #include "mtk-base-afe.h"
 
@@ -108,6 +109,7 @@ static snd_pcm_uframes_t mtk_afe_pcm_pointer
 	int reg_ofs_base = memif_data->reg_ofs_base;
 	int reg_ofs_cur = memif_data->reg_ofs_cur;
 	unsigned int hw_ptr = 0, hw_base = 0;
+	u64 lat_begin = mtk_afe_lat_begin();
 	int ret, pcm_ptr_bytes;
 
 	ret = regmap_read(regmap, reg_ofs_cur, &hw_ptr);
@@ -128,6 +130,8 @@ static snd_pcm_uframes_t mtk_afe_pcm_pointer
 
 POINTER_RETURN_FRAMES:
 	pcm_ptr_bytes = word_size_align(pcm_ptr_bytes);
+	mtk_afe_lat_end(afe->lat, rtd->cpu_dai->id, MTK_AFE_LAT_POINTER,
+			lat_begin, pcm_ptr_bytes);
 	return bytes_to_frames(substream->runtime, pcm_ptr_bytes);
 }
 
@@ -136,13 +140,17 @@ int mtk_afe_pcm_ack(struct snd_pcm_substream *substream)
 	struct snd_soc_pcm_runtime *rtd = substream->private_data;
 	struct mtk_base_afe *afe = snd_soc_platform_get_drvdata(rtd->platform);
 	struct mtk_base_afe_memif *memif = &afe->memif[rtd->cpu_dai->id];
+	u64 lat_begin;
 
 	if (!memif->ack_enable)
 		return 0;
 
-	if (memif->ack)
+	if (memif->ack) {
+		lat_begin = mtk_afe_lat_begin();
 		memif->ack(substream);
-	else
+		mtk_afe_lat_end(afe->lat, rtd->cpu_dai->id, MTK_AFE_LAT_ACK,
+				lat_begin, substream->runtime->control->appl_ptr);
+	} else
 		dev_warn(afe->dev, "%s(), ack_enable but ack == NULL\n",
 			 __func__);
 
@@ -78,6 +78,7 @@ struct list_head;
 struct mtk_base_afe_memif;
 struct mtk_base_afe_irq;
 struct mtk_base_afe_dai;
+struct mtk_afe_lat;
 struct regmap;
 struct snd_pcm_substream;
 struct snd_soc_dai;
@@ -121,6 +122,7 @@ struct mtk_base_afe {
 
 	struct dentry *debugfs;
 	const struct mtk_afe_debug_cmd *debug_cmds;
+	struct mtk_afe_lat *lat;
 
 	void *platform_priv;
 };
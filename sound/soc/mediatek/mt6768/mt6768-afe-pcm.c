@@ -20,6 +20,7 @@
 #include "../common/mtk-afe-debug.h"
 #include "../common/mtk-afe-platform-driver.h"
 #include "../common/mtk-afe-fe-dai.h"
+#include "../common/mtk-afe-latency.h"
 #include "../common/mtk-sp-pcm-ops.h"
 #include "../common/mtk-sram-manager.h"
 #include "../common/mtk-mmap-ion.h"
@@ -2086,6 +2087,7 @@ static irqreturn_t mt6768_afe_irq_handler(int irq_id, void *dev)
 	unsigned int status;
 	unsigned int status_mcu;
 	unsigned int mcu_en;
+	u64 lat_begin = mtk_afe_lat_begin();
 	int ret;
 	int i;
 
@@ -2115,7 +2117,9 @@ static irqreturn_t mt6768_afe_irq_handler(int irq_id, void *dev)
 		irq = &afe->irqs[memif->irq_usage];
 
 		if (status_mcu & (1 << irq->irq_data->irq_en_shift))
-			snd_pcm_period_elapsed(memif->substream);
+			mtk_afe_lat_period_elapsed(afe->lat, i,
+						   memif->substream,
+						   lat_begin);
 	}
 
 err_irq:
@@ -3427,6 +3431,10 @@ static int mt6768_afe_pcm_dev_probe(struct platform_device *pdev)
 					   S_IFREG | 0444, NULL,
 					   afe, &mt6768_debugfs_ops);
 
+	afe->lat = mtk_afe_lat_create(dev, "mtksocaudio_lat", afe->memif_size);
+	for (i = 0; i < afe->memif_size; i++)
+		mtk_afe_lat_set_name(afe->lat, i, afe->memif[i].data->name);
+
 	/* register platform */
 	ret = devm_snd_soc_register_platform(&pdev->dev,
 					     &mt6768_afe_pcm_platform);
@@ -3457,6 +3465,8 @@ static int mt6768_afe_pcm_dev_probe(struct platform_device *pdev)
 
 err_platform:
 	snd_soc_unregister_platform(&pdev->dev);
+	mtk_afe_lat_destroy(afe->lat);
+	afe->lat = NULL;
 
 err_pm_disable:
 	pm_runtime_disable(&pdev->dev);
@@ -3469,6 +3479,9 @@ static int mt6768_afe_pcm_dev_remove(struct platform_device *pdev)
 {
 	struct mtk_base_afe *afe = platform_get_drvdata(pdev);
 
+	mtk_afe_lat_destroy(afe->lat);
+	afe->lat = NULL;
+
 	pm_runtime_disable(&pdev->dev);
 	if (!pm_runtime_status_suspended(&pdev->dev))
 		mt6768_afe_runtime_suspend(&pdev->dev);
@@ -0,0 +1,553 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * zram.c
+ *
+ * zram swap-path benchmark: configures a zram device with each of the
+ * available compression backends, fills it with a chosen page mix and
+ * measures write/read bandwidth, per-page latency percentiles, compression
+ * ratio and (optionally) read-back latency after idle writeback to the
+ * backing device.
+ *
+ * The benchmark reconfigures (resets) the given zram device, so it must not
+ * be used as swap while the benchmark runs.
+ */
+
+#include "debug.h"
+#include "../perf.h"
+#include "../util/util.h"
+#include <subcmd/parse-options.h>
+#include "bench.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <linux/time64.h>
+
+#define ZRAM_PAGE_SIZE		4096
+#define ZRAM_SYSFS_FMT		"/sys/block/%s/%s"
+
+static const char	*dev_str	= "zram0";
+static const char	*algo_str	= "all";
+static const char	*size_str	= "64MB";
+static const char	*pattern_str	= "mix";
+static const char	*corpus_str;
+static const char	*backing_str;
+static int		nr_loops	= 1;
+
+static const struct option options[] = {
+	OPT_STRING('d', "device", &dev_str, "zram0",
+		    "zram device to (re)configure, e.g. zram0"),
+	OPT_STRING('a', "algorithm", &algo_str, "all",
+		    "Comma separated comp_algorithm list, \"all\" runs every backend the device offers"),
+	OPT_STRING('s', "size", &size_str, "64MB",
+		    "Amount of data to write. Available units: B, KB, MB, GB (case insensitive)"),
+	OPT_STRING('p', "pattern", &pattern_str, "mix",
+		    "Page content: zero, same, text, random, mix or corpus"),
+	OPT_STRING('c', "corpus", &corpus_str, "file",
+		    "File captured from a real workload, used for --pattern corpus and mixed into --pattern mix"),
+	OPT_STRING('b', "backing-dev", &backing_str, "path",
+		    "Backing device for writeback; measures read latency of written-back pages"),
+	OPT_INTEGER('l', "nr_loops", &nr_loops,
+		    "Specify the number of loops to run. (default: 1)"),
+	OPT_END()
+};
+
+static const char * const bench_zram_usage[] = {
+	"perf bench zram <options>",
+	NULL
+};
+
+struct zram_result {
+	double		write_bps;
+	double		read_bps;
+	double		wb_read_bps;
+	u64		orig_size;
+	u64		compr_size;
+	u64		mem_used;
+	u64		same_pages;
+	u64		*lat;		/* per-page latency, ns */
+	u64		*wb_lat;
+};
+
+static int sysfs_write(const char *attr, const char *val)
+{
+	char path[PATH_MAX];
+	ssize_t len = strlen(val);
+	int fd, ret = 0;
+
+	snprintf(path, sizeof(path), ZRAM_SYSFS_FMT, dev_str, attr);
+	fd = open(path, O_WRONLY);
+	if (fd < 0)
+		return -errno;
+	if (write(fd, val, len) != len)
+		ret = -errno;
+	close(fd);
+	return ret;
+}
+
+static int sysfs_read(const char *attr, char *buf, size_t size)
+{
+	char path[PATH_MAX];
+	ssize_t len;
+	int fd;
+
+	snprintf(path, sizeof(path), ZRAM_SYSFS_FMT, dev_str, attr);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+	len = read(fd, buf, size - 1);
+	close(fd);
+	if (len < 0)
+		return -errno;
+	buf[len] = '\0';
+	return 0;
+}
+
+static u64 now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/*
+ * Page generators. "same" pages exercise the same-filled fast path in
+ * zram_drv.c, "zero" the zero-page shortcut, "text" gives typical
+ * compressible heap/page cache content and "random" is incompressible.
+ */
+static const char *text_words[] = {
+	"the ", "zram ", "swap ", "page ", "android ", "activity ", "view ",
+	"0x0000 ", "null ", "java/lang/String ", "layout ", "{\"id\": ",
+	"\n", "\t", "true ", "false ", "bitmap ", "com.android.",
+};
+
+static void fill_zero(char *page, unsigned long idx __maybe_unused)
+{
+	memset(page, 0, ZRAM_PAGE_SIZE);
+}
+
+static void fill_same(char *page, unsigned long idx)
+{
+	unsigned long val = 0x0101010101010101UL * ((idx % 255) + 1);
+	unsigned long *p = (unsigned long *)page;
+	unsigned int i;
+
+	for (i = 0; i < ZRAM_PAGE_SIZE / sizeof(*p); i++)
+		p[i] = val;
+}
+
+static void fill_text(char *page, unsigned long idx)
+{
+	unsigned int seed = idx * 2654435761U;
+	size_t off = 0;
+
+	while (off < ZRAM_PAGE_SIZE) {
+		const char *w = text_words[rand_r(&seed) % ARRAY_SIZE(text_words)];
+		size_t len = min(strlen(w), (size_t)ZRAM_PAGE_SIZE - off);
+
+		memcpy(page + off, w, len);
+		off += len;
+	}
+}
+
+static void fill_random(char *page, unsigned long idx)
+{
+	unsigned int seed = idx ^ 0x5a5a5a5aU;
+	unsigned int i;
+
+	for (i = 0; i < ZRAM_PAGE_SIZE; i++)
+		page[i] = rand_r(&seed);
+}
+
+static char *corpus;
+static size_t corpus_pages;
+
+static void fill_corpus(char *page, unsigned long idx)
+{
+	memcpy(page, corpus + (idx % corpus_pages) * ZRAM_PAGE_SIZE,
+	       ZRAM_PAGE_SIZE);
+}
+
+/*
+ * Rough mix seen on Android swap: a quarter zero or same-filled pages,
+ * mostly compressible data and a small incompressible tail.
+ */
+static void fill_mix(char *page, unsigned long idx)
+{
+	switch (idx % 16) {
+	case 0: case 1:
+		fill_zero(page, idx);
+		break;
+	case 2: case 3:
+		fill_same(page, idx);
+		break;
+	case 4:
+		fill_random(page, idx);
+		break;
+	default:
+		if (corpus_pages && (idx & 1))
+			fill_corpus(page, idx);
+		else
+			fill_text(page, idx);
+		break;
+	}
+}
+
+struct pattern {
+	const char *name;
+	void (*fill)(char *page, unsigned long idx);
+};
+
+static const struct pattern patterns[] = {
+	{ "zero",	fill_zero	},
+	{ "same",	fill_same	},
+	{ "text",	fill_text	},
+	{ "random",	fill_random	},
+	{ "corpus",	fill_corpus	},
+	{ "mix",	fill_mix	},
+	{ NULL,		NULL		},
+};
+
+static int load_corpus(void)
+{
+	struct stat st;
+	int fd, ret = 0;
+
+	if (!corpus_str)
+		return 0;
+
+	fd = open(corpus_str, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Failed to open corpus %s: %s\n",
+			corpus_str, strerror(errno));
+		return -1;
+	}
+
+	if (fstat(fd, &st) < 0) {
+		fprintf(stderr, "Failed to stat corpus %s: %s\n",
+			corpus_str, strerror(errno));
+		ret = -1;
+		goto out;
+	}
+
+	corpus_pages = st.st_size / ZRAM_PAGE_SIZE;
+	if (!corpus_pages) {
+		fprintf(stderr, "Corpus %s is smaller than a page\n", corpus_str);
+		ret = -1;
+		goto out;
+	}
+
+	corpus = malloc(corpus_pages * ZRAM_PAGE_SIZE);
+	if (!corpus ||
+	    readn(fd, corpus, corpus_pages * ZRAM_PAGE_SIZE) < 0) {
+		fprintf(stderr, "Failed to read corpus %s\n", corpus_str);
+		ret = -1;
+	}
+out:
+	close(fd);
+	return ret;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static u64 percentile(u64 *sorted, unsigned long nr, unsigned int pct)
+{
+	unsigned long idx = (nr * pct) / 100;
+
+	return sorted[idx >= nr ? nr - 1 : idx];
+}
+
+static int zram_setup(const char *algo, u64 disksize)
+{
+	char buf[64];
+	int ret;
+
+	ret = sysfs_write("reset", "1");
+	if (ret)
+		return ret;
+
+	ret = sysfs_write("comp_algorithm", algo);
+	if (ret)
+		return ret;
+
+	if (backing_str) {
+		ret = sysfs_write("backing_dev", backing_str);
+		if (ret)
+			return ret;
+	}
+
+	snprintf(buf, sizeof(buf), "%llu", (unsigned long long)disksize);
+	return sysfs_write("disksize", buf);
+}
+
+static int run_pass(int fd, char *buf, unsigned long nr_pages, u64 *lat,
+		    bool do_write, const struct pattern *pat)
+{
+	unsigned long i;
+	ssize_t ret;
+	u64 t0;
+
+	for (i = 0; i < nr_pages; i++) {
+		if (do_write)
+			pat->fill(buf, i);
+
+		t0 = now_ns();
+		if (do_write)
+			ret = pwrite(fd, buf, ZRAM_PAGE_SIZE, (off_t)i * ZRAM_PAGE_SIZE);
+		else
+			ret = pread(fd, buf, ZRAM_PAGE_SIZE, (off_t)i * ZRAM_PAGE_SIZE);
+		lat[i] = now_ns() - t0;
+
+		if (ret != ZRAM_PAGE_SIZE)
+			return -1;
+	}
+
+	return 0;
+}
+
+static u64 sum_u64(const u64 *v, unsigned long nr)
+{
+	unsigned long i;
+	u64 sum = 0;
+
+	for (i = 0; i < nr; i++)
+		sum += v[i];
+	return sum;
+}
+
+static int zram_writeback(void)
+{
+	int ret;
+
+	/* Mark everything idle, then push idle pages to the backing device. */
+	ret = sysfs_write("idle", "all");
+	if (ret)
+		return ret;
+	return sysfs_write("writeback", "idle");
+}
+
+static int bench_one(const char *algo, const struct pattern *pat,
+		     unsigned long nr_pages, struct zram_result *res)
+{
+	char path[PATH_MAX], stat_buf[256];
+	unsigned long long mm[6] = { 0 };
+	char *buf;
+	int fd, ret;
+
+	ret = zram_setup(algo, (u64)nr_pages * ZRAM_PAGE_SIZE);
+	if (ret) {
+		fprintf(stderr, "Failed to configure %s with %s: %s\n",
+			dev_str, algo, strerror(-ret));
+		return ret;
+	}
+
+	if (posix_memalign((void **)&buf, ZRAM_PAGE_SIZE, ZRAM_PAGE_SIZE))
+		return -ENOMEM;
+
+	snprintf(path, sizeof(path), "/dev/%s", dev_str);
+	fd = open(path, O_RDWR | O_DIRECT);
+	if (fd < 0) {
+		ret = -errno;
+		fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+		goto out_free;
+	}
+
+	/*
+	 * Bandwidth is derived from the sum of the per-page I/O times so the
+	 * cost of generating page content does not skew the result.
+	 */
+	if (run_pass(fd, buf, nr_pages, res->lat, true, pat) < 0)
+		goto out_io;
+	res->write_bps = (double)nr_pages * ZRAM_PAGE_SIZE * NSEC_PER_SEC /
+			 (double)sum_u64(res->lat, nr_pages);
+
+	if (!sysfs_read("mm_stat", stat_buf, sizeof(stat_buf)))
+		sscanf(stat_buf, "%llu %llu %llu %llu %llu %llu",
+		       &mm[0], &mm[1], &mm[2], &mm[3], &mm[4], &mm[5]);
+	res->orig_size = mm[0];
+	res->compr_size = mm[1];
+	res->mem_used = mm[2];
+	res->same_pages = mm[5];
+
+	if (run_pass(fd, buf, nr_pages, res->lat + nr_pages, false, pat) < 0)
+		goto out_io;
+	res->read_bps = (double)nr_pages * ZRAM_PAGE_SIZE * NSEC_PER_SEC /
+			(double)sum_u64(res->lat + nr_pages, nr_pages);
+
+	if (backing_str) {
+		ret = zram_writeback();
+		if (ret) {
+			fprintf(stderr, "Writeback on %s failed: %s\n",
+				dev_str, strerror(-ret));
+			goto out_close;
+		}
+		if (run_pass(fd, buf, nr_pages, res->wb_lat, false, pat) < 0)
+			goto out_io;
+		res->wb_read_bps = (double)nr_pages * ZRAM_PAGE_SIZE *
+				   NSEC_PER_SEC /
+				   (double)sum_u64(res->wb_lat, nr_pages);
+	}
+
+	ret = 0;
+	goto out_close;
+
+out_io:
+	ret = -EIO;
+	fprintf(stderr, "I/O error on %s\n", path);
+out_close:
+	close(fd);
+	sysfs_write("reset", "1");
+out_free:
+	free(buf);
+	return ret;
+}
+
+static void print_lat(const char *what, u64 *lat, unsigned long nr)
+{
+	qsort(lat, nr, sizeof(*lat), cmp_u64);
+	printf(" %-10s latency (usec): p50 %8.2f  p90 %8.2f  p99 %8.2f  p99.9 %8.2f  max %8.2f\n",
+	       what,
+	       percentile(lat, nr, 50) / 1000.0,
+	       percentile(lat, nr, 90) / 1000.0,
+	       percentile(lat, nr, 99) / 1000.0,
+	       lat[min(nr - 1, nr * 999 / 1000)] / 1000.0,
+	       lat[nr - 1] / 1000.0);
+}
+
+static void print_result(const char *algo, struct zram_result *res,
+			 unsigned long nr_pages)
+{
+	double ratio = res->compr_size ?
+		(double)res->orig_size / (double)res->compr_size : 0.0;
+
+	if (bench_format == BENCH_FORMAT_SIMPLE) {
+		printf("%s %lf %lf %lf %lf\n", algo,
+		       res->write_bps / 1024 / 1024,
+		       res->read_bps / 1024 / 1024, ratio,
+		       res->wb_read_bps / 1024 / 1024);
+		return;
+	}
+
+	printf("# comp_algorithm '%s'\n", algo);
+	printf(" %14lf MB/sec write\n", res->write_bps / 1024 / 1024);
+	printf(" %14lf MB/sec read\n", res->read_bps / 1024 / 1024);
+	printf(" %14lf compression ratio (orig %llu, compr %llu, mem_used %llu, same %llu pages)\n",
+	       ratio, (unsigned long long)res->orig_size,
+	       (unsigned long long)res->compr_size,
+	       (unsigned long long)res->mem_used,
+	       (unsigned long long)res->same_pages);
+	print_lat("write", res->lat, nr_pages);
+	print_lat("read", res->lat + nr_pages, nr_pages);
+	if (backing_str) {
+		printf(" %14lf MB/sec read after writeback\n",
+		       res->wb_read_bps / 1024 / 1024);
+		print_lat("wb-read", res->wb_lat, nr_pages);
+	}
+	printf("\n");
+}
+
+/* comp_algorithm reads back as "lzo [lz4] zstd", the current one bracketed. */
+static char *available_algorithms(void)
+{
+	char buf[256], *p;
+
+	if (sysfs_read("comp_algorithm", buf, sizeof(buf)))
+		return NULL;
+
+	for (p = buf; *p; p++) {
+		if (*p == '[' || *p == ']' || *p == '\n')
+			*p = ' ';
+	}
+	return strdup(buf);
+}
+
+int bench_zram(int argc, const char **argv)
+{
+	const struct pattern *pat;
+	struct zram_result res;
+	unsigned long nr_pages;
+	char *algos, *algo, *saveptr = NULL;
+	int i, ret = 0;
+	s64 size;
+
+	argc = parse_options(argc, argv, options, bench_zram_usage, 0);
+	if (argc)
+		usage_with_options(bench_zram_usage, options);
+
+	size = perf_atoll((char *)size_str);
+	if (size < ZRAM_PAGE_SIZE) {
+		fprintf(stderr, "Invalid size:%s\n", size_str);
+		return 1;
+	}
+	nr_pages = size / ZRAM_PAGE_SIZE;
+
+	for (pat = patterns; pat->name; pat++) {
+		if (!strcmp(pat->name, pattern_str))
+			break;
+	}
+	if (!pat->name) {
+		fprintf(stderr, "Unknown pattern:%s\n", pattern_str);
+		return 1;
+	}
+
+	if (load_corpus())
+		return 1;
+	if (pat->fill == fill_corpus && !corpus_pages) {
+		fprintf(stderr, "--pattern corpus requires --corpus <file>\n");
+		return 1;
+	}
+
+	if (!strcmp(algo_str, "all"))
+		algos = available_algorithms();
+	else
+		algos = strdup(algo_str);
+	if (!algos) {
+		fprintf(stderr, "Unable to query %s comp_algorithm, is zram loaded?\n",
+			dev_str);
+		return 1;
+	}
+
+	res.lat = calloc(nr_pages * 2, sizeof(u64));
+	res.wb_lat = calloc(nr_pages, sizeof(u64));
+	if (!res.lat || !res.wb_lat) {
+		printf("# Memory allocation failed - maybe size (%s) is too large?\n",
+		       size_str);
+		ret = 1;
+		goto out;
+	}
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# Writing %s of '%s' pages to %s ...\n\n",
+		       size_str, pattern_str, dev_str);
+
+	for (algo = strtok_r(algos, " ,", &saveptr); algo;
+	     algo = strtok_r(NULL, " ,", &saveptr)) {
+		for (i = 0; i < nr_loops; i++) {
+			res.write_bps = res.read_bps = res.wb_read_bps = 0.0;
+			if (bench_one(algo, pat, nr_pages, &res)) {
+				ret = 1;
+				break;
+			}
+			print_result(algo, &res, nr_pages);
+		}
+	}
+
+out:
+	free(res.lat);
+	free(res.wb_lat);
+	free(algos);
+	free(corpus);
+	return ret;
+}
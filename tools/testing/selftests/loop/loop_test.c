@@ -0,0 +1,333 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Loop device setup and parallel read test
+ *
+ * Backs NR_DEV loop devices with sparse image files, the way APEX and
+ * other image-backed mounts are set up, and times the setup once with
+ * the legacy sequence (LOOP_SET_FD, LOOP_SET_STATUS64, LOOP_SET_DIRECT_IO)
+ * and once with LOOP_CONFIGURE, which passes backing file, offset, size
+ * and direct I/O in one call. The devices are then read end to end, by
+ * one thread and by one thread per CPU, and the throughput of both is
+ * reported. Every device must come up with the configured size and
+ * show its own image at the configured offset.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <linux/loop.h>
+
+#include "../kselftest.h"
+
+#define LOOP_CONTROL	"/dev/loop-control"
+
+#define NR_DEV		32
+#define IMG_OFFSET	(1UL << 20)
+#define IMG_SIZE	(64UL << 20)
+#define READ_SIZE	(128UL << 10)
+#define OPEN_WAIT_MS	2000
+
+struct dev {
+	int nr;
+	int fd;
+	int img;
+	unsigned long long bytes;
+	int bad;
+};
+
+static struct dev devs[NR_DEV];
+static char dir[] = "/tmp/loop_test.XXXXXX";
+static int ctl;
+
+static unsigned long long now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/* A sparse image whose first block, at IMG_OFFSET, names the device */
+static int make_img(int i)
+{
+	char path[64], tag[32];
+	int fd;
+
+	snprintf(path, sizeof(path), "%s/img%d", dir, i);
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0)
+		return -1;
+	snprintf(tag, sizeof(tag), "loop_test img%d", i);
+	if (ftruncate(fd, IMG_OFFSET + IMG_SIZE) ||
+	    pwrite(fd, tag, sizeof(tag), IMG_OFFSET) != sizeof(tag) ||
+	    fsync(fd)) {
+		close(fd);
+		return -1;
+	}
+	close(fd);
+
+	/* the devices are read-only, so are their images */
+	return open(path, O_RDONLY);
+}
+
+/* Device nodes of new devices show up once udev/ueventd got to them */
+static int open_dev(int nr)
+{
+	char path[64];
+	int fd, ms;
+
+	for (ms = 0; ms < OPEN_WAIT_MS; ms++) {
+		snprintf(path, sizeof(path), "/dev/loop%d", nr);
+		fd = open(path, O_RDONLY);
+		if (fd < 0 && errno == ENOENT) {
+			snprintf(path, sizeof(path), "/dev/block/loop%d", nr);
+			fd = open(path, O_RDONLY);
+		}
+		if (fd >= 0 || errno != ENOENT)
+			return fd;
+		usleep(1000);
+	}
+
+	return -1;
+}
+
+static int setup_legacy(struct dev *d)
+{
+	struct loop_info64 info;
+
+	if (ioctl(d->fd, LOOP_SET_FD, d->img))
+		return -1;
+
+	memset(&info, 0, sizeof(info));
+	info.lo_offset = IMG_OFFSET;
+	info.lo_sizelimit = IMG_SIZE;
+	if (ioctl(d->fd, LOOP_SET_STATUS64, &info))
+		return -1;
+
+	/* not every file system can do direct I/O, keep going without */
+	ioctl(d->fd, LOOP_SET_DIRECT_IO, 1UL);
+
+	return 0;
+}
+
+static int setup_configure(struct dev *d)
+{
+	struct loop_config config;
+
+	memset(&config, 0, sizeof(config));
+	config.fd = d->img;
+	config.info.lo_offset = IMG_OFFSET;
+	config.info.lo_sizelimit = IMG_SIZE;
+	config.info.lo_flags = LO_FLAGS_READ_ONLY | LO_FLAGS_DIRECT_IO;
+
+	return ioctl(d->fd, LOOP_CONFIGURE, &config);
+}
+
+static void clear_all(void)
+{
+	int i;
+
+	for (i = 0; i < NR_DEV; i++) {
+		if (devs[i].fd < 0)
+			continue;
+		ioctl(devs[i].fd, LOOP_CLR_FD, 0);
+		close(devs[i].fd);
+		devs[i].fd = -1;
+	}
+}
+
+/*
+ * Sets all devices up, each from a free device, and returns the mean
+ * setup time in us, or -1 when a device failed to come up as asked.
+ */
+static long setup_all(int (*setup)(struct dev *), int *dio)
+{
+	unsigned long long t, total = 0;
+	struct loop_info64 info;
+	uint64_t size;
+	int i;
+
+	*dio = 0;
+	for (i = 0; i < NR_DEV; i++) {
+		struct dev *d = &devs[i];
+
+		t = now_us();
+		d->nr = ioctl(ctl, LOOP_CTL_GET_FREE);
+		if (d->nr < 0)
+			return -1;
+		d->fd = open_dev(d->nr);
+		if (d->fd < 0 || setup(d))
+			return -1;
+		total += now_us() - t;
+
+		if (ioctl(d->fd, BLKGETSIZE64, &size) || size != IMG_SIZE ||
+		    ioctl(d->fd, LOOP_GET_STATUS64, &info))
+			return -1;
+		if (info.lo_flags & LO_FLAGS_DIRECT_IO)
+			(*dio)++;
+	}
+
+	return total / NR_DEV;
+}
+
+static void *reader(void *arg)
+{
+	struct dev *d = arg;
+	char tag[32], *buf;
+	off_t off;
+	ssize_t n;
+
+	if (posix_memalign((void **)&buf, 4096, READ_SIZE)) {
+		d->bad = 1;
+		return NULL;
+	}
+
+	snprintf(tag, sizeof(tag), "loop_test img%d", (int)(d - devs));
+	for (off = 0; off < IMG_SIZE; off += n) {
+		n = pread(d->fd, buf, READ_SIZE, off);
+		if (n <= 0) {
+			d->bad = 1;
+			break;
+		}
+		if (!off && strcmp(buf, tag))
+			d->bad = 1;
+		d->bytes += n;
+	}
+	free(buf);
+
+	return NULL;
+}
+
+struct share {
+	int first, step;
+};
+
+static void *reader_share(void *arg)
+{
+	struct share *s = arg;
+	int i;
+
+	for (i = s->first; i < NR_DEV; i += s->step)
+		reader(&devs[i]);
+
+	return NULL;
+}
+
+/* Reads all devices with nr_threads, returns MB/s, -1 on bad data */
+static long read_all(int nr_threads)
+{
+	pthread_t tid[NR_DEV];
+	struct share share[NR_DEV];
+	unsigned long long t, bytes = 0;
+	int i, bad = 0;
+
+	for (i = 0; i < NR_DEV; i++) {
+		devs[i].bytes = 0;
+		devs[i].bad = 0;
+		/* what was read before would come from the page cache */
+		ioctl(devs[i].fd, BLKFLSBUF, 0);
+	}
+
+	t = now_us();
+	for (i = 0; i < nr_threads; i++) {
+		share[i].first = i;
+		share[i].step = nr_threads;
+		if (pthread_create(&tid[i], NULL, reader_share, &share[i]))
+			return -1;
+	}
+	for (i = 0; i < nr_threads; i++)
+		pthread_join(tid[i], NULL);
+	t = now_us() - t;
+
+	for (i = 0; i < NR_DEV; i++) {
+		bytes += devs[i].bytes;
+		bad |= devs[i].bad;
+	}
+	if (bad || bytes != (unsigned long long)NR_DEV * IMG_SIZE)
+		return -1;
+
+	return t ? bytes / t : 0;
+}
+
+int main(void)
+{
+	long legacy_us, configure_us, mbs_one, mbs_all;
+	int i, dio, nr_threads, failed = 0;
+	char path[64];
+
+	ksft_print_header();
+
+	ctl = open(LOOP_CONTROL, O_RDWR);
+	if (ctl < 0)
+		ksft_exit_skip(LOOP_CONTROL " not available, not root?\n");
+	if (!mkdtemp(dir))
+		ksft_exit_fail_msg("cannot create %s\n", dir);
+
+	for (i = 0; i < NR_DEV; i++) {
+		devs[i].fd = -1;
+		devs[i].img = make_img(i);
+		if (devs[i].img < 0)
+			ksft_exit_fail_msg("cannot create image %d\n", i);
+	}
+
+	nr_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nr_threads < 1)
+		nr_threads = 1;
+	if (nr_threads > NR_DEV)
+		nr_threads = NR_DEV;
+
+	/* brings the device nodes up, so that neither run waits for them */
+	setup_all(setup_configure, &dio);
+	clear_all();
+
+	legacy_us = setup_all(setup_legacy, &dio);
+	clear_all();
+	if (legacy_us < 0) {
+		ksft_test_result_fail("legacy setup\n");
+		failed = 1;
+	} else {
+		ksft_test_result_pass("legacy setup: %ld us per device, %d/%d with direct I/O\n",
+				      legacy_us, dio, NR_DEV);
+	}
+
+	configure_us = setup_all(setup_configure, &dio);
+	if (configure_us < 0) {
+		clear_all();
+		ksft_test_result_fail("configure setup\n");
+		ksft_test_result_skip("parallel read\n");
+		failed = 1;
+		goto out;
+	}
+	ksft_test_result_pass("configure setup: %ld us per device, %d/%d with direct I/O\n",
+			      configure_us, dio, NR_DEV);
+
+	mbs_one = read_all(1);
+	mbs_all = read_all(nr_threads);
+	clear_all();
+	if (mbs_one < 0 || mbs_all < 0) {
+		ksft_test_result_fail("parallel read: short read or wrong data\n");
+		failed = 1;
+	} else {
+		ksft_test_result_pass("parallel read: %ld MB/s by 1 thread, %ld MB/s by %d\n",
+				      mbs_one, mbs_all, nr_threads);
+	}
+
+out:
+	for (i = 0; i < NR_DEV; i++) {
+		close(devs[i].img);
+		snprintf(path, sizeof(path), "%s/img%d", dir, i);
+		unlink(path);
+	}
+	rmdir(dir);
+	close(ctl);
+
+	return failed ? ksft_exit_fail() : ksft_exit_pass();
+}
@@ -0,0 +1,312 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * rt_monitor histogram test
+ *
+ * Runs SCHED_FIFO load with known sleep and run patterns pinned to one
+ * CPU and checks the runtime, wakeup latency and throttle histograms
+ * read from /sys/kernel/debug/rt_monitor.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/rt_mon.h>
+
+#include "../kselftest.h"
+
+#define DBG_DIR		"/sys/kernel/debug/rt_monitor/"
+
+static int test_cpu;
+
+struct snap {
+	struct rt_mon_hdr hdr;
+	struct rt_mon_cpu_hist *cpu;	/* histograms of test_cpu */
+	void *buf;
+};
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void busy_ns(unsigned long long ns)
+{
+	unsigned long long end = now_ns() + ns;
+
+	while (now_ns() < end)
+		;
+}
+
+static int proc_read_long(const char *path, long *val)
+{
+	FILE *f = fopen(path, "r");
+	int ret;
+
+	if (!f)
+		return -1;
+	ret = fscanf(f, "%ld", val) == 1 ? 0 : -1;
+	fclose(f);
+
+	return ret;
+}
+
+static int snap_take(struct snap *s, int reset)
+{
+	size_t size = 1 << 20, len = 0;
+	struct rt_mon_cpu_hist *h;
+	unsigned int i;
+	ssize_t n;
+	int fd;
+
+	s->buf = NULL;
+	fd = open(reset ? DBG_DIR "hist_reset" : DBG_DIR "hist", O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	s->buf = malloc(size);
+	if (!s->buf) {
+		close(fd);
+		return -1;
+	}
+	while ((n = read(fd, (char *)s->buf + len, size - len)) > 0)
+		len += n;
+	close(fd);
+
+	if (len < sizeof(s->hdr))
+		goto err;
+	memcpy(&s->hdr, s->buf, sizeof(s->hdr));
+	if (s->hdr.magic != RT_MON_MAGIC || s->hdr.version != RT_MON_VERSION ||
+	    s->hdr.nr_prio != RT_MON_PRIO_NR ||
+	    s->hdr.nr_bucket != RT_MON_BUCKET_NR ||
+	    len != sizeof(s->hdr) + s->hdr.nr_cpu * sizeof(*h))
+		goto err;
+
+	s->cpu = NULL;
+	h = (struct rt_mon_cpu_hist *)((char *)s->buf + sizeof(s->hdr));
+	for (i = 0; i < s->hdr.nr_cpu; i++)
+		if (h[i].cpu == test_cpu)
+			s->cpu = &h[i];
+	if (s->cpu)
+		return 0;
+err:
+	free(s->buf);
+	s->buf = NULL;
+	return -1;
+}
+
+static void snap_free(struct snap *s)
+{
+	free(s->buf);
+	s->buf = NULL;
+}
+
+static unsigned long long hist_sum(const __u64 *h, int from, int to)
+{
+	unsigned long long sum = 0;
+	int i;
+
+	for (i = from; i <= to && i < RT_MON_BUCKET_NR; i++)
+		sum += h[i];
+
+	return sum;
+}
+
+static void hist_print(const char *what, const __u64 *h)
+{
+	char line[512];
+	int i, n = 0;
+
+	for (i = 0; i < RT_MON_BUCKET_NR; i++)
+		if (h[i])
+			n += snprintf(line + n, sizeof(line) - n, " %uus:%llu",
+				1U << i, (unsigned long long)h[i]);
+	ksft_print_msg("%s%s\n", what, n ? line : " empty");
+}
+
+static int set_fifo(int prio)
+{
+	struct sched_param sp = { .sched_priority = prio };
+
+	return sched_setscheduler(0, SCHED_FIFO, &sp);
+}
+
+static int band_of(int prio)
+{
+	int band = prio >> RT_MON_PRIO_SHIFT;
+
+	return band < RT_MON_PRIO_NR ? band : RT_MON_PRIO_NR - 1;
+}
+
+/*
+ * Sleep 10 ms, run 2 ms: every wakeup is seen with a short latency and
+ * each period holds about 1/6 of it as runtime.
+ */
+static void test_periodic(void)
+{
+	const int prio = 50, band = band_of(prio);
+	const int iters = 150;
+	struct timespec ts = { 0, 10 * 1000 * 1000 };
+	unsigned long long wakeups, fast, expect_us;
+	struct snap s;
+	int i, lo;
+
+	if (snap_take(&s, 1)) {
+		ksft_test_result_fail("periodic: bad snapshot\n");
+		return;
+	}
+	snap_free(&s);
+
+	if (set_fifo(prio)) {
+		ksft_test_result_fail("periodic: sched_setscheduler: %s\n",
+			strerror(errno));
+		return;
+	}
+	for (i = 0; i < iters; i++) {
+		nanosleep(&ts, NULL);
+		busy_ns(2 * 1000 * 1000);
+	}
+	sched_setscheduler(0, SCHED_OTHER, &(struct sched_param){ 0 });
+
+	/* let the last period end */
+	usleep(s.hdr.period_ns / 1000 + 100 * 1000);
+
+	if (snap_take(&s, 1)) {
+		ksft_test_result_fail("periodic: bad snapshot\n");
+		return;
+	}
+
+	hist_print("periodic wakeup:", s.cpu->wakeup[band]);
+	hist_print("periodic runtime:", s.cpu->runtime[band]);
+
+	wakeups = hist_sum(s.cpu->wakeup[band], 0, RT_MON_BUCKET_NR - 1);
+	fast = hist_sum(s.cpu->wakeup[band], 0, 10);	/* < 2 ms */
+	if (wakeups < iters * 9 / 10 || fast < wakeups * 9 / 10) {
+		ksft_test_result_fail("periodic: %llu wakeups, %llu under 2 ms, expected %d\n",
+			wakeups, fast, iters);
+		snap_free(&s);
+		return;
+	}
+
+	/* 2 of every 12 ms, within a factor of two either side */
+	expect_us = s.hdr.period_ns / 1000 / 6;
+	for (lo = 0; (2ULL << lo) <= expect_us; lo++)
+		;
+	if (!hist_sum(s.cpu->runtime[band], lo - 1, lo + 1)) {
+		ksft_test_result_fail("periodic: no runtime sample near %llu us\n",
+			expect_us);
+		snap_free(&s);
+		return;
+	}
+
+	ksft_test_result_pass("periodic: %llu wakeups, runtime per period ok\n",
+		wakeups);
+	snap_free(&s);
+}
+
+/* a busy loop over one and a half periods has to be throttled */
+static void test_throttle(void)
+{
+	const int prio = 10, band = band_of(prio);
+	unsigned long long throttled, over;
+	long runtime_us, period_us;
+	struct snap s;
+	int top;
+
+	if (proc_read_long("/proc/sys/kernel/sched_rt_runtime_us", &runtime_us) ||
+	    proc_read_long("/proc/sys/kernel/sched_rt_period_us", &period_us) ||
+	    runtime_us < 0 || runtime_us >= period_us) {
+		ksft_test_result_skip("throttle: RT throttling disabled\n");
+		return;
+	}
+
+	snap_take(&s, 1);
+	snap_free(&s);
+
+	if (set_fifo(prio)) {
+		ksft_test_result_fail("throttle: sched_setscheduler: %s\n",
+			strerror(errno));
+		return;
+	}
+	busy_ns(period_us * 1500ULL);
+	sched_setscheduler(0, SCHED_OTHER, &(struct sched_param){ 0 });
+
+	usleep(period_us + 100 * 1000);
+
+	if (snap_take(&s, 1)) {
+		ksft_test_result_fail("throttle: bad snapshot\n");
+		return;
+	}
+
+	hist_print("throttle runtime:", s.cpu->runtime[band]);
+	throttled = s.cpu->throttle[band];
+	ksft_print_msg("throttle: %llu events in band %d\n", throttled, band);
+
+	/* at most runtime_us per period, so nothing above that bucket */
+	for (top = 0; (2L << top) <= runtime_us; top++)
+		;
+	over = hist_sum(s.cpu->runtime[band], top + 1, RT_MON_BUCKET_NR - 1);
+	if (!throttled)
+		ksft_test_result_fail("throttle: no throttle event\n");
+	else if (!hist_sum(s.cpu->runtime[band], 0, top))
+		ksft_test_result_fail("throttle: no runtime sample\n");
+	else if (over)
+		ksft_test_result_fail("throttle: %llu periods over %ld us\n",
+			over, runtime_us);
+	else
+		ksft_test_result_pass("throttle: %llu events\n", throttled);
+	snap_free(&s);
+}
+
+/* counts from before a reset must not show up after it */
+static void test_reset(void)
+{
+	struct snap s;
+	unsigned long long sum = 0;
+	int b;
+
+	snap_take(&s, 1);
+	snap_free(&s);
+
+	if (snap_take(&s, 0)) {
+		ksft_test_result_fail("reset: bad snapshot\n");
+		return;
+	}
+	for (b = 0; b < RT_MON_PRIO_NR; b++)
+		sum += s.cpu->throttle[b];
+	snap_free(&s);
+
+	if (sum)
+		ksft_test_result_fail("reset: %llu throttle events left\n", sum);
+	else
+		ksft_test_result_pass("reset: counters cleared\n");
+}
+
+int main(void)
+{
+	cpu_set_t set;
+
+	ksft_print_header();
+
+	if (access(DBG_DIR "hist_reset", R_OK))
+		ksft_exit_skip("rt_monitor histograms not available, not root?\n");
+
+	test_cpu = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+	CPU_ZERO(&set);
+	CPU_SET(test_cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set))
+		ksft_exit_fail_msg("sched_setaffinity: %s\n", strerror(errno));
+
+	test_periodic();
+	test_throttle();
+	test_reset();
+
+	return ksft_get_fail_cnt() ? ksft_exit_fail() : ksft_exit_pass();
+}
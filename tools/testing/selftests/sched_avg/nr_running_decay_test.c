@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Decayed nr_running test
+ *
+ * Runs a number of busy processes and checks the decayed nr_running
+ * averages of /sys/devices/system/cpu/rq-stats/nr_running_decay against
+ * the load and against nr_running_avg, the system wide average over the
+ * longest half-life. Also checks that the short half-life follows a load
+ * drop faster than the long one, and that reading does not reset them.
+ */
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../kselftest.h"
+
+#define RQ_DIR		"/sys/devices/system/cpu/rq-stats/"
+#define MAX_HL		8
+#define MAX_LOAD	64
+
+static int nr_hl;
+static unsigned int hl_ms[MAX_HL];
+
+/* system wide nr_running * 100 over the longest half-life */
+static int read_avg(void)
+{
+	FILE *f = fopen(RQ_DIR "nr_running_avg", "r");
+	int avg = -1, iowait;
+
+	if (!f)
+		return -1;
+	if (fscanf(f, "%d %d", &avg, &iowait) != 2)
+		avg = -1;
+	fclose(f);
+
+	return avg;
+}
+
+static int read_decay(int *sum)
+{
+	char line[256], *p;
+	FILE *f = fopen(RQ_DIR "nr_running_decay", "r");
+	int n = 0, off;
+
+	if (!f)
+		return -1;
+
+	while (fgets(line, sizeof(line), f)) {
+		if (!strncmp(line, "hl_ms", 5)) {
+			for (n = 0, p = line + 5; n < MAX_HL &&
+			     sscanf(p, "%u%n", &hl_ms[n], &off) == 1; n++)
+				p += off;
+			nr_hl = n;
+		} else if (!strncmp(line, "sum", 3)) {
+			for (n = 0, p = line + 3; n < MAX_HL &&
+			     sscanf(p, "%d%n", &sum[n], &off) == 1; n++)
+				p += off;
+		}
+	}
+	fclose(f);
+
+	return nr_hl && n == nr_hl ? 0 : -1;
+}
+
+static void start_load(pid_t *pids, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		pids[i] = fork();
+		if (!pids[i])
+			for (;;)
+				;
+	}
+}
+
+static void stop_load(pid_t *pids, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		if (pids[i] > 0) {
+			kill(pids[i], SIGKILL);
+			waitpid(pids[i], NULL, 0);
+		}
+	}
+}
+
+/*
+ * In steady state the longest half-life has to match the load and
+ * nr_running_avg, and a second read right after the first must not
+ * find the average restarted.
+ */
+static void test_steady(int n)
+{
+	pid_t pids[MAX_LOAD];
+	int sum[MAX_HL], avg, again, diff, tol, i;
+
+	start_load(pids, n);
+	/* settle for more than five of the longest half-lives */
+	usleep(5 * hl_ms[nr_hl - 1] * 1000 + 200 * 1000);
+	avg = read_avg();
+	again = read_avg();
+	if (read_decay(sum) || avg < 0 || again < 0) {
+		stop_load(pids, n);
+		ksft_test_result_fail("steady %d: cannot read averages\n", n);
+		return;
+	}
+	stop_load(pids, n);
+
+	for (i = 0; i < nr_hl; i++)
+		ksft_print_msg("load %2d: hl %3u ms decayed %5d\n",
+			n, hl_ms[i], sum[i]);
+	ksft_print_msg("load %2d: nr_running_avg  %5d %5d\n", n, avg, again);
+
+	diff = abs(sum[nr_hl - 1] - avg);
+	tol = avg * 15 / 100 > 50 ? avg * 15 / 100 : 50;
+	if (diff > tol || abs(again - avg) > tol)
+		ksft_test_result_fail("steady %d: decayed %d avg %d then %d\n",
+			n, sum[nr_hl - 1], avg, again);
+	else if (sum[nr_hl - 1] < n * 100 - 50)
+		ksft_test_result_fail("steady %d: decayed %d below the load\n",
+			n, sum[nr_hl - 1]);
+	else
+		ksft_test_result_pass("steady %d: decayed %d avg %d\n",
+			n, sum[nr_hl - 1], avg);
+}
+
+/* a short while after the load is gone only the long half-life remembers it */
+static void test_drop(int n)
+{
+	pid_t pids[MAX_LOAD];
+	int sum[MAX_HL], fast, slow;
+
+	start_load(pids, n);
+	usleep(5 * hl_ms[nr_hl - 1] * 1000 + 200 * 1000);
+	stop_load(pids, n);
+
+	/* ~10 of the shortest and ~0.2 of the longest half-life */
+	usleep(10 * hl_ms[0] * 1000);
+	if (read_decay(sum)) {
+		ksft_test_result_fail("drop: cannot read averages\n");
+		return;
+	}
+
+	fast = sum[0];
+	slow = sum[nr_hl - 1];
+	ksft_print_msg("drop %d: hl %u ms %d, hl %u ms %d\n", n,
+		hl_ms[0], fast, hl_ms[nr_hl - 1], slow);
+
+	if (slow - fast < n * 100 / 2)
+		ksft_test_result_fail("drop: fast %d slow %d\n", fast, slow);
+	else
+		ksft_test_result_pass("drop: fast %d slow %d\n", fast, slow);
+}
+
+int main(void)
+{
+	int sum[MAX_HL];
+	int ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+	ksft_print_header();
+
+	if (access(RQ_DIR "nr_running_decay", R_OK) ||
+	    access(RQ_DIR "nr_running_avg", R_OK))
+		ksft_exit_skip("nr_running averages not available, not root?\n");
+	if (read_decay(sum))
+		ksft_exit_fail_msg("cannot parse nr_running_decay\n");
+
+	if (ncpu > MAX_LOAD)
+		ncpu = MAX_LOAD;
+
+	test_steady(1);
+	if (ncpu > 2)
+		test_steady(ncpu / 2);
+	test_steady(ncpu);
+	test_drop(ncpu);
+
+	return ksft_get_fail_cnt() ? ksft_exit_fail() : ksft_exit_pass();
+}
@@ -0,0 +1,327 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Sensor event ring test
+ *
+ * Uses the vsensor test driver to generate batched events and receives
+ * them through the per-event read() of /dev/vsensor and through a mapped
+ * /dev/sensor_ring, woken by poll() or an eventfd. Checks that the ring
+ * loses nothing and wakes once per watermark, and reports throughput,
+ * CPU time and delivery latency of each path.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <linux/sensor_ring.h>
+
+#include "../kselftest.h"
+
+#define VSENSOR_RUN	"/sys/kernel/debug/vsensor/run"
+#define VSENSOR_DEV	"/dev/vsensor"
+#define RING_DEV	"/dev/sensor_ring"
+
+#define DATA_ACTION	0
+#define FLUSH_ACTION	1
+
+#define MAX_LAT		65536
+
+enum mode { MODE_READ, MODE_POLL, MODE_EVENTFD };
+static const char * const mode_name[] = { "read", "ring/poll", "ring/eventfd" };
+
+struct run {
+	unsigned int rate, batch, count;
+};
+
+struct result {
+	unsigned long long received, gaps, wakeups, dropped;
+	unsigned long long lat[MAX_LAT];
+	unsigned int nr_lat;
+	double cpu_us, wall_ms;
+	int flushed;
+};
+
+static int handle = -1;
+
+static unsigned long long boot_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_BOOTTIME, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static double cpu_us(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e6 +
+		ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+static int vsensor_start(const struct run *r)
+{
+	char buf[64];
+	int fd, len, ret;
+
+	fd = open(VSENSOR_RUN, O_WRONLY);
+	if (fd < 0)
+		return -1;
+	len = snprintf(buf, sizeof(buf), "%u %u %u", r->rate, r->batch,
+		       r->count);
+	ret = write(fd, buf, len) == len ? 0 : -1;
+	close(fd);
+
+	return ret;
+}
+
+/* waits for the run to finish, fills handle on the first call */
+static int vsensor_result(unsigned long long *generated,
+			  unsigned long long *rejected)
+{
+	char buf[128];
+	ssize_t n;
+	int fd = open(VSENSOR_RUN, O_RDONLY);
+
+	if (fd < 0)
+		return -1;
+	n = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (n <= 0)
+		return -1;
+	buf[n] = '\0';
+
+	return sscanf(buf, "handle %d generated %llu rejected %llu",
+		      &handle, generated, rejected) == 3 ? 0 : -1;
+}
+
+static void account(struct result *res, const struct run *r,
+		    const struct sensor_ring_event *ev)
+{
+	unsigned long long seq;
+
+	if (ev->handle != handle)
+		return;
+	if (ev->flush_action == FLUSH_ACTION) {
+		res->flushed = 1;
+		return;
+	}
+
+	seq = (unsigned int)ev->word[0];
+	if (seq != res->received)
+		res->gaps++;
+	res->received = seq + 1;
+
+	/* the last event of a batch carries its injection time */
+	if ((seq + 1) % r->batch == 0 || seq + 1 == r->count)
+		if (res->nr_lat < MAX_LAT)
+			res->lat[res->nr_lat++] = boot_ns() - ev->time_stamp;
+}
+
+static int receive_read(struct result *res, const struct run *r)
+{
+	struct sensor_ring_event ev[256];
+	struct pollfd pfd;
+	ssize_t n;
+	int i;
+
+	pfd.fd = open(VSENSOR_DEV, O_RDONLY);
+	if (pfd.fd < 0)
+		return -1;
+	pfd.events = POLLIN;
+
+	if (vsensor_start(r)) {
+		close(pfd.fd);
+		return -1;
+	}
+	while (!res->flushed) {
+		if (poll(&pfd, 1, 2000) <= 0)
+			break;
+		res->wakeups++;
+		while ((n = read(pfd.fd, ev, sizeof(ev))) > 0)
+			for (i = 0; i < n / (int)sizeof(ev[0]); i++)
+				account(res, r, &ev[i]);
+	}
+	close(pfd.fd);
+
+	return 0;
+}
+
+static int receive_ring(struct result *res, const struct run *r, int efd)
+{
+	struct sensor_ring_sub sub = {
+		.handle = handle,
+		.watermark = r->batch,
+		.max_latency_us = 20000,
+		.flags = SENSOR_RING_EXCLUSIVE,
+	};
+	struct sensor_ring_hdr *hdr;
+	struct sensor_ring_event *slot;
+	unsigned long long head, tail, cnt;
+	struct pollfd pfd;
+	size_t size;
+	int fd, ret = -1;
+
+	fd = open(RING_DEV, O_RDWR);
+	if (fd < 0)
+		return -1;
+
+	hdr = mmap(NULL, getpagesize(), PROT_READ, MAP_SHARED, fd, 0);
+	if (hdr == MAP_FAILED)
+		goto out;
+	if (hdr->magic != SENSOR_RING_MAGIC ||
+	    hdr->version != SENSOR_RING_VERSION ||
+	    hdr->slot_size != sizeof(*slot)) {
+		munmap(hdr, getpagesize());
+		goto out;
+	}
+	size = hdr->data_offset + (size_t)hdr->nr_slots * hdr->slot_size;
+	munmap(hdr, getpagesize());
+
+	hdr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (hdr == MAP_FAILED)
+		goto out;
+	slot = (void *)((char *)hdr + hdr->data_offset);
+
+	if (ioctl(fd, SENSOR_RING_IOC_SUBSCRIBE, &sub) ||
+	    (efd >= 0 && ioctl(fd, SENSOR_RING_IOC_SET_EVENTFD, &efd)))
+		goto out_unmap;
+
+	pfd.fd = efd >= 0 ? efd : fd;
+	pfd.events = POLLIN;
+	if (vsensor_start(r))
+		goto out_unmap;
+
+	tail = __atomic_load_n(&hdr->tail, __ATOMIC_RELAXED);
+	while (!res->flushed) {
+		if (poll(&pfd, 1, 2000) <= 0)
+			break;
+		if (efd >= 0 && read(efd, &cnt, sizeof(cnt)) != sizeof(cnt))
+			break;
+		res->wakeups++;
+
+		head = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+		for (; tail != head; tail++)
+			account(res, r, &slot[tail & (hdr->nr_slots - 1)]);
+		__atomic_store_n(&hdr->tail, tail, __ATOMIC_RELEASE);
+	}
+	res->dropped = hdr->dropped;
+	ret = 0;
+
+out_unmap:
+	munmap(hdr, size);
+out:
+	close(fd);
+	return ret;
+}
+
+static int cmp_ull(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void test_path(enum mode mode, const struct run *r)
+{
+	static struct result res;
+	unsigned long long generated = 0, rejected = 0, p50 = 0, p99 = 0;
+	unsigned long long max_wakeups;
+	double c0, t0;
+	int efd = -1, ret;
+
+	memset(&res, 0, sizeof(res));
+	if (mode == MODE_EVENTFD) {
+		efd = eventfd(0, EFD_NONBLOCK);
+		if (efd < 0) {
+			ksft_test_result_fail("%s: eventfd: %s\n",
+				mode_name[mode], strerror(errno));
+			return;
+		}
+	}
+
+	c0 = cpu_us();
+	t0 = boot_ns();
+	ret = mode == MODE_READ ? receive_read(&res, r) :
+				  receive_ring(&res, r, efd);
+	res.wall_ms = (boot_ns() - t0) / 1e6;
+	res.cpu_us = cpu_us() - c0;
+	if (efd >= 0)
+		close(efd);
+
+	if (ret || vsensor_result(&generated, &rejected)) {
+		ksft_test_result_fail("%s %u Hz x%u: cannot run\n",
+			mode_name[mode], r->rate, r->batch);
+		return;
+	}
+
+	if (res.nr_lat) {
+		qsort(res.lat, res.nr_lat, sizeof(res.lat[0]), cmp_ull);
+		p50 = res.lat[res.nr_lat / 2];
+		p99 = res.lat[res.nr_lat * 99 / 100];
+	}
+	ksft_print_msg("%-12s %5u Hz x%-3u: %llu/%llu events %.0f ev/s, %llu wakeups, %.1f us cpu/1k ev, latency p50 %llu us p99 %llu us\n",
+		mode_name[mode], r->rate, r->batch, res.received, generated,
+		res.received * 1000.0 / res.wall_ms, res.wakeups,
+		res.received ? res.cpu_us * 1000 / res.received : 0,
+		p50 / 1000, p99 / 1000);
+
+	if (mode == MODE_READ) {
+		/* the old path is only measured, it may reject when slow */
+		ksft_test_result_pass("%s %u Hz x%u: %llu rejected\n",
+			mode_name[mode], r->rate, r->batch, rejected);
+		return;
+	}
+
+	/* one wakeup per batch, plus the flush and some timer slack */
+	max_wakeups = (generated + r->batch - 1) / r->batch + 2 +
+		generated / r->rate * 50;
+	if (!res.flushed || res.gaps || res.dropped || rejected ||
+	    res.received != generated)
+		ksft_test_result_fail("%s %u Hz x%u: received %llu of %llu, %llu gaps, %llu dropped\n",
+			mode_name[mode], r->rate, r->batch, res.received,
+			generated, res.gaps, res.dropped);
+	else if (res.wakeups > max_wakeups)
+		ksft_test_result_fail("%s %u Hz x%u: %llu wakeups, expected at most %llu\n",
+			mode_name[mode], r->rate, r->batch, res.wakeups,
+			max_wakeups);
+	else
+		ksft_test_result_pass("%s %u Hz x%u\n",
+			mode_name[mode], r->rate, r->batch);
+}
+
+int main(void)
+{
+	static const struct run runs[] = {
+		{ 400, 20, 1200 },	/* batched IMU */
+		{ 10000, 100, 30000 },	/* bulk */
+	};
+	unsigned long long g, rj;
+	unsigned int i;
+
+	ksft_print_header();
+
+	if (access(VSENSOR_RUN, W_OK) || access(RING_DEV, R_OK))
+		ksft_exit_skip("vsensor or sensor_ring not available, not root?\n");
+	if (vsensor_result(&g, &rj))
+		ksft_exit_fail_msg("cannot read %s\n", VSENSOR_RUN);
+
+	for (i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+		test_path(MODE_READ, &runs[i]);
+		test_path(MODE_POLL, &runs[i]);
+		test_path(MODE_EVENTFD, &runs[i]);
+	}
+
+	return ksft_get_fail_cnt() ? ksft_exit_fail() : ksft_exit_pass();
+}
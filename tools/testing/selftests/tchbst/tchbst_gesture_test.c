@@ -0,0 +1,345 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Kernel touch boost gesture test
+ *
+ * Creates a uinput touch screen, replays tap, slow drag, fling and long
+ * press traces and checks the boost timeline that ktch records in
+ * /proc/perfmgr/tchbst/kernel/tb_timeline for each of them.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+
+#include "../kselftest.h"
+
+#define PROC_DIR	"/proc/perfmgr/tchbst/kernel/"
+#define TS_MAX		1079
+#define TL_MAX		64
+
+struct tl_rec {
+	unsigned long long ts;
+	char class[8];
+	int velocity;
+	int freq;
+	int timeout_ms;
+};
+
+static int ufd = -1;
+static struct tl_rec tl[TL_MAX];
+static int nr_tl;
+
+static int proc_write(const char *name, const char *val)
+{
+	char path[128];
+	int fd, ret;
+
+	snprintf(path, sizeof(path), PROC_DIR "%s", name);
+	fd = open(path, O_WRONLY);
+	if (fd < 0)
+		return -1;
+	ret = write(fd, val, strlen(val));
+	close(fd);
+
+	return ret < 0 ? -1 : 0;
+}
+
+/* first character of a proc value, '0' if it cannot be read */
+static char proc_read(const char *name)
+{
+	char path[128], c = '0';
+	int fd;
+
+	snprintf(path, sizeof(path), PROC_DIR "%s", name);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return c;
+	if (read(fd, &c, 1) != 1)
+		c = '0';
+	close(fd);
+
+	return c;
+}
+
+static void emit(int type, int code, int value)
+{
+	struct input_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.type = type;
+	ev.code = code;
+	ev.value = value;
+	if (write(ufd, &ev, sizeof(ev)) != sizeof(ev))
+		ksft_exit_fail_msg("uinput write: %s\n", strerror(errno));
+}
+
+static void report(int x, int y)
+{
+	emit(EV_ABS, ABS_MT_POSITION_X, x);
+	emit(EV_ABS, ABS_MT_POSITION_Y, y);
+	emit(EV_ABS, ABS_X, x);
+	emit(EV_ABS, ABS_Y, y);
+	emit(EV_SYN, SYN_REPORT, 0);
+}
+
+static void touch_down(int x, int y)
+{
+	emit(EV_ABS, ABS_MT_SLOT, 0);
+	emit(EV_ABS, ABS_MT_TRACKING_ID, 1);
+	emit(EV_KEY, BTN_TOUCH, 1);
+	report(x, y);
+}
+
+static void touch_up(void)
+{
+	emit(EV_ABS, ABS_MT_TRACKING_ID, -1);
+	emit(EV_KEY, BTN_TOUCH, 0);
+	emit(EV_SYN, SYN_REPORT, 0);
+}
+
+/* move by dx per step, one report every step_ms */
+static void touch_move(int *x, int y, int dx, int steps, int step_ms)
+{
+	int i;
+
+	for (i = 0; i < steps; i++) {
+		usleep(step_ms * 1000);
+		*x += dx;
+		report(*x, y);
+	}
+}
+
+static int uinput_create(void)
+{
+	struct uinput_user_dev ud;
+	int axes[] = { ABS_X, ABS_Y, ABS_MT_POSITION_X, ABS_MT_POSITION_Y };
+	unsigned int i;
+
+	ufd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+	if (ufd < 0)
+		return -1;
+
+	ioctl(ufd, UI_SET_EVBIT, EV_KEY);
+	ioctl(ufd, UI_SET_KEYBIT, BTN_TOUCH);
+	ioctl(ufd, UI_SET_EVBIT, EV_ABS);
+	ioctl(ufd, UI_SET_ABSBIT, ABS_MT_SLOT);
+	ioctl(ufd, UI_SET_ABSBIT, ABS_MT_TRACKING_ID);
+	for (i = 0; i < sizeof(axes) / sizeof(axes[0]); i++)
+		ioctl(ufd, UI_SET_ABSBIT, axes[i]);
+	ioctl(ufd, UI_SET_PROPBIT, INPUT_PROP_DIRECT);
+
+	memset(&ud, 0, sizeof(ud));
+	snprintf(ud.name, UINPUT_MAX_NAME_SIZE, "tchbst-selftest");
+	ud.id.bustype = BUS_VIRTUAL;
+	for (i = 0; i < sizeof(axes) / sizeof(axes[0]); i++)
+		ud.absmax[axes[i]] = TS_MAX;
+	ud.absmax[ABS_MT_SLOT] = 9;
+	ud.absmax[ABS_MT_TRACKING_ID] = 65535;
+
+	if (write(ufd, &ud, sizeof(ud)) != sizeof(ud) ||
+	    ioctl(ufd, UI_DEV_CREATE) < 0) {
+		close(ufd);
+		return -1;
+	}
+
+	/* let the input handlers connect */
+	usleep(200 * 1000);
+
+	return 0;
+}
+
+static int timeline_read(void)
+{
+	char line[128];
+	FILE *f;
+
+	nr_tl = 0;
+	f = fopen(PROC_DIR "tb_timeline", "r");
+	if (!f)
+		return -1;
+
+	/* skip header */
+	if (!fgets(line, sizeof(line), f)) {
+		fclose(f);
+		return -1;
+	}
+
+	while (nr_tl < TL_MAX && fgets(line, sizeof(line), f)) {
+		struct tl_rec *r = &tl[nr_tl];
+
+		if (sscanf(line, "%llu %7s %d %d %d", &r->ts, r->class,
+				&r->velocity, &r->freq, &r->timeout_ms) == 5)
+			nr_tl++;
+	}
+	fclose(f);
+
+	return 0;
+}
+
+static void timeline_print(const char *trace)
+{
+	int i;
+
+	ksft_print_msg("%s: %d boost updates\n", trace, nr_tl);
+	for (i = 0; i < nr_tl; i++)
+		ksft_print_msg("  +%6llu us %-5s v %5d freq %7d timeout %4d ms\n",
+			tl[i].ts - tl[0].ts, tl[i].class, tl[i].velocity,
+			tl[i].freq, tl[i].timeout_ms);
+}
+
+static struct tl_rec *timeline_find(const char *class, int timed)
+{
+	int i;
+
+	for (i = 0; i < nr_tl; i++)
+		if (!strcmp(tl[i].class, class) &&
+		    (!timed || tl[i].timeout_ms > 0))
+			return &tl[i];
+
+	return NULL;
+}
+
+static void trace_begin(void)
+{
+	proc_write("tb_timeline", "0");
+}
+
+/* wait for the hold or fling ramp to finish, then collect */
+static void trace_end(const char *trace)
+{
+	usleep(1500 * 1000);
+	if (timeline_read())
+		ksft_exit_fail_msg("cannot read tb_timeline\n");
+	timeline_print(trace);
+}
+
+static void test_tap(void)
+{
+	struct tl_rec *r;
+
+	trace_begin();
+	touch_down(540, 1000);
+	usleep(60 * 1000);
+	touch_up();
+	trace_end("tap");
+
+	r = timeline_find("tap", 1);
+	if (r && r->freq > 0 && !timeline_find("fling", 0))
+		ksft_test_result_pass("tap: short timed boost\n");
+	else
+		ksft_test_result_fail("tap: no timed tap boost\n");
+}
+
+static void test_slow_drag(void)
+{
+	struct tl_rec *r;
+	int x = 200;
+
+	trace_begin();
+	touch_down(x, 1000);
+	/* ~300 per-mille of width per second */
+	touch_move(&x, 1000, 5, 60, 16);
+	/* stop before lifting, there must be no fling */
+	usleep(150 * 1000);
+	touch_up();
+	trace_end("slow drag");
+
+	r = timeline_find("drag", 0);
+	if (r && !timeline_find("fling", 0))
+		ksft_test_result_pass("slow drag: drag boost, no fling\n");
+	else
+		ksft_test_result_fail("slow drag: unexpected classes\n");
+}
+
+static void test_fling(void)
+{
+	struct tl_rec *first = NULL, *last = NULL;
+	int x = 100, i;
+
+	trace_begin();
+	touch_down(x, 1000);
+	/* ~5000 per-mille of width per second */
+	touch_move(&x, 1000, 44, 18, 8);
+	touch_up();
+	trace_end("fling");
+
+	for (i = 0; i < nr_tl; i++) {
+		if (strcmp(tl[i].class, "fling"))
+			continue;
+		if (!first)
+			first = &tl[i];
+		last = &tl[i];
+	}
+
+	if (!first || first->timeout_ms <= 0)
+		ksft_test_result_fail("fling: no timed fling boost\n");
+	else if (first == last || last->freq > first->freq)
+		ksft_test_result_fail("fling: boost does not ramp down\n");
+	else
+		ksft_test_result_pass("fling: %d -> %d over %llu us\n",
+			first->freq, last->freq, last->ts - first->ts);
+}
+
+static void test_long_press(void)
+{
+	struct tl_rec *tap, *press;
+
+	trace_begin();
+	touch_down(540, 1000);
+	usleep(600 * 1000);
+	touch_up();
+	trace_end("long press");
+
+	tap = timeline_find("tap", 0);
+	press = timeline_find("press", 0);
+	if (press && (!tap || tap->ts < press->ts) &&
+	    !timeline_find("drag", 0))
+		ksft_test_result_pass("long press: tap turns into press\n");
+	else
+		ksft_test_result_fail("long press: no press boost\n");
+}
+
+static char saved_enable[2] = { '0', 0 };
+static char saved_gesture[2] = { '0', 0 };
+
+/* put touch boost back the way the test found it, on every exit */
+static void tb_restore(void)
+{
+	proc_write("tb_gesture", saved_gesture);
+	proc_write("tb_enable", saved_enable);
+}
+
+int main(void)
+{
+	ksft_print_header();
+
+	if (access(PROC_DIR "tb_timeline", F_OK))
+		ksft_exit_skip("gesture touch boost not available\n");
+
+	/* gesture boost is off by default, enable it for the test */
+	saved_enable[0] = proc_read("tb_enable");
+	saved_gesture[0] = proc_read("tb_gesture");
+	atexit(tb_restore);
+	if (proc_write("tb_enable", "1") || proc_write("tb_gesture", "1"))
+		ksft_exit_skip("cannot enable touch boost, not root?\n");
+
+	if (uinput_create())
+		ksft_exit_skip("cannot create uinput device\n");
+
+	test_tap();
+	test_slow_drag();
+	test_fling();
+	test_long_press();
+
+	ioctl(ufd, UI_DEV_DESTROY);
+	close(ufd);
+
+	return ksft_get_fail_cnt() ? ksft_exit_fail() : ksft_exit_pass();
+}
@@ -0,0 +1,337 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * uload_ind loading ring test
+ *
+ * Checks the threshold/hysteresis events and per reader rate limit of
+ * /dev/cpu_loading, then injects loading values at a high rate and
+ * compares delivery latency and CPU cost of the mmap ring against the
+ * kobject uevent path.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/uload_ind.h>
+
+#include "../kselftest.h"
+
+#define DEV_PATH	"/dev/cpu_loading"
+#define PROC_DIR	"/proc/cpu_loading/"
+
+static struct uload_ring_hdr *hdr;
+static size_t map_len;
+static int nr_events = 2000;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static unsigned long long cpu_ns(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ULL +
+		(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ULL;
+}
+
+static int proc_read(const char *name)
+{
+	char path[128], buf[32];
+	int fd, n;
+
+	snprintf(path, sizeof(path), PROC_DIR "%s", name);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	n = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (n <= 0)
+		return -1;
+	buf[n] = '\0';
+	return atoi(buf);
+}
+
+static int proc_write(const char *name, int val)
+{
+	char path[128], buf[32];
+	int fd, n;
+
+	snprintf(path, sizeof(path), PROC_DIR "%s", name);
+	fd = open(path, O_WRONLY);
+	if (fd < 0)
+		return -1;
+	n = snprintf(buf, sizeof(buf), "%d", val);
+	n = write(fd, buf, n);
+	close(fd);
+	return n < 0 ? -1 : 0;
+}
+
+static struct uload_event *slot(__u64 seq)
+{
+	return (void *)hdr + hdr->data_offset +
+		(seq & (hdr->nr_slots - 1)) * hdr->slot_size;
+}
+
+/* copy events [*tail, head) of the given types, returns the count */
+static int ring_collect(__u64 *tail, __u32 mask, struct uload_event *out,
+			int max)
+{
+	__u64 head = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+	int n = 0;
+
+	if (head - *tail > hdr->nr_slots)
+		*tail = head - hdr->nr_slots;
+
+	for (; *tail < head; (*tail)++) {
+		struct uload_event ev = *slot(*tail);
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (slot(*tail)->seq != *tail)
+			continue;
+		if (!(mask & ULOAD_EV_MASK(ev.type)))
+			continue;
+		if (n < max)
+			out[n] = ev;
+		n++;
+	}
+
+	return n;
+}
+
+static int inject(int fd, int loading)
+{
+	__s32 val = loading;
+
+	return ioctl(fd, ULOAD_IOC_INJECT, &val);
+}
+
+static void test_crossing(int fd)
+{
+	int over = proc_read("overThrhld");
+	int under = proc_read("underThrhld");
+	int hyst = proc_read("hysteresis");
+	struct uload_event ev[8];
+	__u64 tail = hdr->head;
+	int n;
+
+	if (over < 0 || under < 0 || hyst < 0)
+		ksft_exit_fail_msg("cannot read thresholds\n");
+
+	/* reset to mid, then go high */
+	inject(fd, (over + under) / 2);
+	tail = hdr->head;
+	inject(fd, over + 1);
+	n = ring_collect(&tail, ULOAD_EV_MASK_CROSS, ev, 8);
+	if (n != 1 || ev[0].type != ULOAD_EV_OVER ||
+	    ev[0].state != ULOAD_STATE_HIGH)
+		ksft_exit_fail_msg("no OVER event on crossing %d\n", over);
+
+	/* inside the hysteresis band, stays high */
+	if (hyst > 0) {
+		inject(fd, over - hyst + 1);
+		n = ring_collect(&tail, ULOAD_EV_MASK_CROSS, ev, 8);
+		if (n != 0)
+			ksft_exit_fail_msg("event inside hysteresis band\n");
+	}
+
+	inject(fd, over - hyst);
+	n = ring_collect(&tail, ULOAD_EV_MASK_CROSS, ev, 8);
+	if (n != 1 || ev[0].type != ULOAD_EV_NORMAL)
+		ksft_exit_fail_msg("no NORMAL event leaving high state\n");
+
+	inject(fd, under);
+	n = ring_collect(&tail, ULOAD_EV_MASK_CROSS, ev, 8);
+	if (n != 1 || ev[0].type != ULOAD_EV_UNDER)
+		ksft_exit_fail_msg("no UNDER event on crossing %d\n", under);
+
+	n = ring_collect(&tail, ULOAD_EV_MASK(ULOAD_EV_SAMPLE), ev, 8);
+	if (n != 0)
+		ksft_exit_fail_msg("stale samples left in ring\n");
+
+	ksft_test_result_pass("threshold crossing with hysteresis %d\n", hyst);
+}
+
+static void test_rate_limit(int fd)
+{
+	struct pollfd pfd = { .events = POLLIN };
+	__u32 rate = 1000, mask = ULOAD_EV_MASK(ULOAD_EV_SAMPLE);
+	__u64 seq;
+	int rfd;
+
+	rfd = open(DEV_PATH, O_RDONLY);
+	if (rfd < 0)
+		ksft_exit_fail_msg("open reader: %s\n", strerror(errno));
+	if (ioctl(rfd, ULOAD_IOC_SET_RATE, &rate) ||
+	    ioctl(rfd, ULOAD_IOC_SET_MASK, &mask))
+		ksft_exit_fail_msg("reader ioctl: %s\n", strerror(errno));
+
+	pfd.fd = rfd;
+	inject(fd, 50);
+	if (poll(&pfd, 1, 0) != 1)
+		ksft_exit_fail_msg("first sample did not wake reader\n");
+
+	seq = hdr->head;
+	ioctl(rfd, ULOAD_IOC_CONSUME, &seq);
+	inject(fd, 51);
+	if (poll(&pfd, 1, 0) != 0)
+		ksft_exit_fail_msg("rate limited reader woken twice\n");
+
+	close(rfd);
+	ksft_test_result_pass("per reader rate limit\n");
+}
+
+static int cmp_ull(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void report(const char *name, unsigned long long *lat,
+		   unsigned long long cpu)
+{
+	qsort(lat, nr_events, sizeof(*lat), cmp_ull);
+	ksft_print_msg("%-6s events %d p50 %llu ns p99 %llu ns max %llu ns cpu/event %llu ns\n",
+		       name, nr_events, lat[nr_events / 2],
+		       lat[nr_events * 99 / 100], lat[nr_events - 1],
+		       cpu / nr_events);
+}
+
+static void bench_ring(int fd, unsigned long long *lat)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	struct uload_event ev[4];
+	unsigned long long t0, cpu;
+	__u64 tail;
+	int i;
+
+	proc_write("uevent_enable", 0);
+	tail = hdr->head;
+	ioctl(fd, ULOAD_IOC_CONSUME, &tail);
+
+	cpu = cpu_ns();
+	for (i = 0; i < nr_events; i++) {
+		t0 = now_ns();
+		inject(fd, i & 1 ? 95 : 5);
+		if (poll(&pfd, 1, 1000) != 1)
+			ksft_exit_fail_msg("ring event %d not delivered\n", i);
+		ring_collect(&tail, ULOAD_EV_MASK_CROSS, ev, 4);
+		ioctl(fd, ULOAD_IOC_CONSUME, &tail);
+		lat[i] = now_ns() - t0;
+	}
+	report("ring", lat, cpu_ns() - cpu);
+}
+
+static void bench_uevent(int fd, unsigned long long *lat)
+{
+	struct sockaddr_nl addr = {
+		.nl_family = AF_NETLINK,
+		.nl_groups = 1,
+	};
+	unsigned long long t0, cpu;
+	char buf[4096];
+	int sk, i, n;
+
+	sk = socket(AF_NETLINK, SOCK_DGRAM, NETLINK_KOBJECT_UEVENT);
+	if (sk < 0 || bind(sk, (struct sockaddr *)&addr, sizeof(addr))) {
+		ksft_test_result_skip("uevent socket: %s\n", strerror(errno));
+		return;
+	}
+
+	proc_write("uevent_enable", 1);
+
+	cpu = cpu_ns();
+	for (i = 0; i < nr_events; i++) {
+		t0 = now_ns();
+		inject(fd, i & 1 ? 95 : 5);
+		for (;;) {
+			n = recv(sk, buf, sizeof(buf) - 1, 0);
+			if (n <= 0)
+				ksft_exit_fail_msg("uevent recv: %s\n",
+						   strerror(errno));
+			buf[n] = '\0';
+			/* parse like a listener would */
+			if (strstr(buf, "cpu_loading") &&
+			    (memmem(buf, n, "over=1", 6) ||
+			     memmem(buf, n, "lower=2", 7)))
+				break;
+		}
+		lat[i] = now_ns() - t0;
+	}
+	report("uevent", lat, cpu_ns() - cpu);
+
+	close(sk);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long long *lat;
+	int fd, uevent_enable;
+
+	if (argc > 1)
+		nr_events = atoi(argv[1]);
+	if (nr_events < 100)
+		nr_events = 100;
+
+	ksft_print_header();
+
+	fd = open(DEV_PATH, O_RDONLY);
+	if (fd < 0)
+		ksft_exit_skip(DEV_PATH " not available: %s\n", strerror(errno));
+
+	if (inject(fd, 50) && errno == EPERM)
+		ksft_exit_skip("needs CAP_SYS_ADMIN\n");
+
+	/* map the header page first to learn the ring size */
+	hdr = mmap(NULL, getpagesize(), PROT_READ, MAP_SHARED, fd, 0);
+	if (hdr == MAP_FAILED)
+		ksft_exit_fail_msg("mmap: %s\n", strerror(errno));
+	if (hdr->version != ULOAD_RING_VERSION ||
+	    (hdr->nr_slots & (hdr->nr_slots - 1)) ||
+	    hdr->slot_size < sizeof(struct uload_event))
+		ksft_exit_fail_msg("bad ring header\n");
+	map_len = hdr->data_offset + (size_t)hdr->nr_slots * hdr->slot_size;
+	munmap(hdr, getpagesize());
+
+	hdr = mmap(NULL, map_len, PROT_READ, MAP_SHARED, fd, 0);
+	if (hdr == MAP_FAILED)
+		ksft_exit_fail_msg("mmap ring: %s\n", strerror(errno));
+	ksft_test_result_pass("ring mapped, %u slots\n", hdr->nr_slots);
+
+	uevent_enable = proc_read("uevent_enable");
+
+	test_crossing(fd);
+	test_rate_limit(fd);
+
+	lat = calloc(nr_events, sizeof(*lat));
+	if (!lat)
+		ksft_exit_fail_msg("out of memory\n");
+
+	bench_ring(fd, lat);
+	bench_uevent(fd, lat);
+	ksft_test_result_pass("ring vs uevent delivery\n");
+
+	if (uevent_enable >= 0)
+		proc_write("uevent_enable", uevent_enable);
+	free(lat);
+	munmap(hdr, map_len);
+	close(fd);
+
+	ksft_exit_pass();
+}
@@ -0,0 +1,363 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Compares the cached estimates of /proc/self/pss with a full walk of
+ * /proc/self/smaps_rollup while private anon, shmem and file mappings
+ * grow in steps, and reports the largest error seen per mapping type.
+ *
+ * Growth below vm.pss_cache_drift_pct is served from the cache, so the
+ * estimate may be off by at most that share of the rss. Sharing added
+ * by fork() does not move the rss and is only corrected by a walk,
+ * which a write to the file forces.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#define PSS_PATH	"/proc/self/pss"
+#define ROLLUP_PATH	"/proc/self/smaps_rollup"
+#define PERIOD_PATH	"/proc/sys/vm/pss_cache_period_ms"
+#define DRIFT_PATH	"/proc/sys/vm/pss_cache_drift_pct"
+
+#define REGION_SIZE	(64UL << 20)
+#define SLACK_KB	512	/* counter batching and the test itself */
+
+struct figures {
+	long rss, pss, uss, swap, swap_pss, walks;
+};
+
+static long page_size;
+static long drift_pct;
+
+static long field(const char *buf, const char *key)
+{
+	const char *p = strstr(buf, key);
+
+	return p ? strtol(p + strlen(key), NULL, 10) : -1;
+}
+
+static int slurp(const char *path, char *buf, size_t len)
+{
+	ssize_t n;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+		return -1;
+	n = read(fd, buf, len - 1);
+	close(fd);
+	if (n <= 0)
+		return -1;
+	buf[n] = '\0';
+
+	return 0;
+}
+
+static int read_cache(struct figures *f)
+{
+	char buf[1024];
+
+	if (slurp(PSS_PATH, buf, sizeof(buf)))
+		return -1;
+	f->rss = field(buf, "Rss:");
+	f->pss = field(buf, "Pss:");
+	f->uss = field(buf, "Uss:");
+	f->swap = field(buf, "Swap:");
+	f->swap_pss = field(buf, "SwapPss:");
+	f->walks = field(buf, "Walks:");
+
+	return f->pss < 0 || f->walks < 0 ? -1 : 0;
+}
+
+static int read_rollup(struct figures *f)
+{
+	char buf[4096];
+
+	if (slurp(ROLLUP_PATH, buf, sizeof(buf)))
+		return -1;
+	f->rss = field(buf, "Rss:");
+	f->pss = field(buf, "Pss:");
+	f->uss = field(buf, "Private_Clean:") + field(buf, "Private_Dirty:");
+	f->swap = field(buf, "Swap:");
+	f->swap_pss = field(buf, "SwapPss:");
+	f->walks = 0;
+
+	return f->pss < 0 ? -1 : 0;
+}
+
+static int reconcile(void)
+{
+	int fd = open(PSS_PATH, O_WRONLY);
+	int ret;
+
+	if (fd < 0)
+		return -1;
+	ret = write(fd, "1", 1) == 1 ? 0 : -1;
+	close(fd);
+
+	return ret;
+}
+
+static long read_long(const char *path)
+{
+	char buf[64];
+
+	return slurp(path, buf, sizeof(buf)) ? -1 : strtol(buf, NULL, 10);
+}
+
+static int write_long(const char *path, long val)
+{
+	char buf[64];
+	int fd = open(path, O_WRONLY);
+	int len, ret;
+
+	if (fd < 0)
+		return -1;
+	len = snprintf(buf, sizeof(buf), "%ld", val);
+	ret = write(fd, buf, len) == len ? 0 : -1;
+	close(fd);
+
+	return ret;
+}
+
+static long labs_diff(long a, long b)
+{
+	return a > b ? a - b : b - a;
+}
+
+struct result {
+	const char *name;
+	int samples;		/* reads served from the cache */
+	int walks;		/* reads that walked */
+	long pss_err, uss_err, rss_err;	/* largest error in kB */
+	long pss_at;		/* rollup pss where pss_err was seen */
+};
+
+static void compare(struct result *r, long walks_before)
+{
+	struct figures c, w;
+
+	if (read_cache(&c) || read_rollup(&w)) {
+		r->walks = -1;
+		return;
+	}
+	if (c.walks != walks_before) {
+		r->walks++;
+		return;
+	}
+
+	r->samples++;
+	if (labs_diff(c.pss, w.pss) > r->pss_err) {
+		r->pss_err = labs_diff(c.pss, w.pss);
+		r->pss_at = w.pss;
+	}
+	if (labs_diff(c.uss, w.uss) > r->uss_err)
+		r->uss_err = labs_diff(c.uss, w.uss);
+	if (labs_diff(c.rss, w.rss) > r->rss_err)
+		r->rss_err = labs_diff(c.rss, w.rss);
+}
+
+/*
+ * Touch @size bytes of @p in steps of a third of the drift threshold,
+ * comparing cache and walk after each step.
+ */
+static int grow(struct result *r, char *p, unsigned long size, int write)
+{
+	struct figures c;
+	unsigned long off = 0, step, end;
+	volatile char sink;
+
+	reconcile();
+	while (off < size) {
+		if (read_cache(&c))
+			return -1;
+		step = (unsigned long)c.rss * 1024 * drift_pct / 300;
+		if (step < (unsigned long)page_size)
+			step = page_size;
+		end = off + step < size ? off + step : size;
+		for (; off < end; off += page_size) {
+			if (write)
+				p[off] = 1;
+			else
+				sink = p[off];
+		}
+		compare(r, c.walks);
+		if (r->walks < 0)
+			return -1;
+	}
+	(void)sink;
+
+	return 0;
+}
+
+/* an estimate may be off by the drift threshold of the rss, plus slack */
+static int check(struct result *r, long rss_kb)
+{
+	long bound = rss_kb * drift_pct / 100 + SLACK_KB;
+	int fail = r->samples == 0 || r->pss_err > bound ||
+		r->uss_err > bound || r->rss_err > SLACK_KB;
+
+	printf("%-12s %3d cached %3d walked  max err pss %6ld kB (at %ld kB) uss %6ld kB rss %4ld kB  bound %ld kB %s\n",
+		r->name, r->samples, r->walks, r->pss_err, r->pss_at,
+		r->uss_err, r->rss_err, bound, fail ? "FAIL" : "ok");
+
+	return fail;
+}
+
+static int test_anon(void)
+{
+	struct result r = { .name = "anon" };
+	struct figures w;
+	char *p;
+	int ret;
+
+	p = mmap(NULL, REGION_SIZE, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		return 1;
+	ret = grow(&r, p, REGION_SIZE, 1);
+	read_rollup(&w);
+	ret = ret || check(&r, w.rss);
+	munmap(p, REGION_SIZE);
+
+	return ret;
+}
+
+static int test_shmem(void)
+{
+	struct result r = { .name = "shmem" };
+	struct figures w;
+	char *p;
+	int ret;
+
+	p = mmap(NULL, REGION_SIZE, PROT_READ | PROT_WRITE,
+		 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		return 1;
+	ret = grow(&r, p, REGION_SIZE, 1);
+	read_rollup(&w);
+	ret = ret || check(&r, w.rss);
+	munmap(p, REGION_SIZE);
+
+	return ret;
+}
+
+static int test_file(void)
+{
+	struct result r = { .name = "file" };
+	char path[] = "/tmp/pss_cache_XXXXXX";
+	struct figures w;
+	char *buf, *p;
+	unsigned long off;
+	int fd, ret;
+
+	fd = mkstemp(path);
+	if (fd < 0)
+		return 1;
+	unlink(path);
+
+	buf = calloc(1, 1 << 20);
+	for (off = 0; buf && off < REGION_SIZE; off += 1 << 20)
+		if (write(fd, buf, 1 << 20) != 1 << 20)
+			break;
+	free(buf);
+	if (off < REGION_SIZE) {
+		close(fd);
+		return 1;
+	}
+
+	p = mmap(NULL, REGION_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+		return 1;
+	ret = grow(&r, p, REGION_SIZE, 0);
+	read_rollup(&w);
+	ret = ret || check(&r, w.rss);
+	munmap(p, REGION_SIZE);
+
+	return ret;
+}
+
+/* fork() shares every anon page without changing the rss */
+static int test_fork(void)
+{
+	struct figures before, c, w;
+	int pipefd[2], status;
+	char *p, x;
+	pid_t pid;
+	int ret = 1;
+
+	p = mmap(NULL, REGION_SIZE, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED || pipe(pipefd))
+		return 1;
+	memset(p, 1, REGION_SIZE);
+	reconcile();
+	read_cache(&before);
+
+	pid = fork();
+	if (!pid) {
+		read(pipefd[0], &x, 1);
+		_exit(0);
+	}
+
+	read_cache(&c);
+	read_rollup(&w);
+	printf("%-12s stale   pss %6ld kB walk %6ld kB err %6ld kB (reported only)\n",
+		"fork", c.pss, w.pss, labs_diff(c.pss, w.pss));
+
+	reconcile();
+	read_cache(&c);
+	read_rollup(&w);
+	ret = c.walks == before.walks ||
+		labs_diff(c.pss, w.pss) > SLACK_KB ||
+		labs_diff(c.uss, w.uss) > SLACK_KB;
+	printf("%-12s written pss %6ld kB walk %6ld kB err %6ld kB %s\n",
+		"fork", c.pss, w.pss, labs_diff(c.pss, w.pss),
+		ret ? "FAIL" : "ok");
+
+	write(pipefd[1], "x", 1);
+	waitpid(pid, &status, 0);
+	close(pipefd[0]);
+	close(pipefd[1]);
+	munmap(p, REGION_SIZE);
+
+	return ret;
+}
+
+int main(void)
+{
+	long period;
+	int ret = 0;
+
+	page_size = sysconf(_SC_PAGESIZE);
+
+	if (access(PSS_PATH, R_OK | W_OK)) {
+		printf("%s not available, skipping\n", PSS_PATH);
+		return 0;
+	}
+
+	drift_pct = read_long(DRIFT_PATH);
+	period = read_long(PERIOD_PATH);
+	if (drift_pct < 0 || period < 0) {
+		printf("pss_cache sysctls not available, skipping\n");
+		return 0;
+	}
+	/* keep the age out of the way, only the drift triggers walks */
+	if (write_long(PERIOD_PATH, 3600 * 1000))
+		printf("cannot raise %s, expect extra walks\n", PERIOD_PATH);
+
+	printf("drift threshold %ld%%\n", drift_pct);
+	ret |= test_anon();
+	ret |= test_shmem();
+	ret |= test_file();
+	ret |= test_fork();
+
+	write_long(PERIOD_PATH, period);
+
+	return ret;
+}
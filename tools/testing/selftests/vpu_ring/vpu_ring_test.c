@@ -0,0 +1,619 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * VPU submission ring test
+ *
+ * Runs the submission ring of /dev/vpu on its cpu backend, so no VPU
+ * firmware is needed: ion buffers are registered once, jobs are queued in
+ * the mapped sq and submitted and reaped with VPU_IOCTL_RING_ENTER. The
+ * cases cover plain jobs and their output, chained jobs and the flush of
+ * a chain behind a failed job, completions batched behind one eventfd
+ * signal, the cq never being overcommitted or overflowed, bogus ring
+ * indexes from user space, and a request enqueued the old way with a
+ * request_id forged to look like a ring job, which must come back through
+ * DEQUE and leave the ring alone.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+
+#include "vpu_drv.h"
+
+#include "../kselftest.h"
+
+#define VPU_DEV		"/dev/vpu"
+#define ION_DEV		"/dev/ion"
+#define RING_CPU	"/sys/kernel/debug/vpu/ring_cpu"
+
+/* legacy ion interface of this kernel, see staging/android/uapi/ion.h */
+struct ion_allocation_data {
+	size_t len;
+	size_t align;
+	unsigned int heap_id_mask;
+	unsigned int flags;
+	int handle;
+};
+
+struct ion_fd_data {
+	int handle;
+	int fd;
+};
+
+struct ion_handle_data {
+	int handle;
+};
+
+#define ION_IOC_MAGIC		'I'
+#define ION_IOC_ALLOC		_IOWR(ION_IOC_MAGIC, 0, struct ion_allocation_data)
+#define ION_IOC_FREE		_IOWR(ION_IOC_MAGIC, 1, struct ion_handle_data)
+#define ION_IOC_SHARE		_IOWR(ION_IOC_MAGIC, 4, struct ion_fd_data)
+#define ION_FLAG_CACHED		1
+#define ION_HEAP_MULTIMEDIA_MASK	(1 << 10)
+
+/* the ring tags its requests with this in the upper word of request_id */
+#define RING_REQ_TAG		0x52494E47ULL
+
+#define NR_BUF		8
+#define BUF_SIZE	4096
+#define PLANE_LEN	1024
+#define NR_BATCH	64
+#define DEQUE_WAIT_S	5
+
+struct ring {
+	int fd;
+	int efd;
+	void *mem;
+	size_t size;
+	struct vpu_ring_ctrl *ctrl;
+	struct vpu_ring_sqe *sqes;
+	struct vpu_ring_cqe *cqes;
+	uint32_t sq_tail;
+	uint32_t cq_head;
+};
+
+static int ion = -1;
+static int buf_fd[NR_BUF];
+static uint8_t *buf_va[NR_BUF];
+
+static int ion_buf(size_t len, int *fd, uint8_t **va)
+{
+	struct ion_allocation_data alloc = {
+		.len = len,
+		.heap_id_mask = ION_HEAP_MULTIMEDIA_MASK,
+		.flags = ION_FLAG_CACHED,
+	};
+	struct ion_handle_data free_data;
+	struct ion_fd_data share;
+	int ret;
+
+	if (ioctl(ion, ION_IOC_ALLOC, &alloc))
+		return -1;
+
+	share.handle = alloc.handle;
+	ret = ioctl(ion, ION_IOC_SHARE, &share);
+	/* the fd keeps the buffer */
+	free_data.handle = alloc.handle;
+	ioctl(ion, ION_IOC_FREE, &free_data);
+	if (ret)
+		return -1;
+
+	*va = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, share.fd, 0);
+	if (*va == MAP_FAILED) {
+		close(share.fd);
+		return -1;
+	}
+	*fd = share.fd;
+
+	return 0;
+}
+
+static int ring_open(struct ring *r, unsigned int sq, unsigned int cq,
+		     int with_efd)
+{
+	struct vpu_ring_setup setup = {
+		.sq_entries = sq,
+		.cq_entries = cq,
+		.eventfd = -1,
+	};
+	struct vpu_ring_buf reg;
+	int i;
+
+	memset(r, 0, sizeof(*r));
+	r->efd = -1;
+	r->fd = open(VPU_DEV, O_RDWR);
+	if (r->fd < 0)
+		return -1;
+
+	if (with_efd) {
+		r->efd = eventfd(0, EFD_NONBLOCK);
+		if (r->efd < 0)
+			return -1;
+		setup.eventfd = r->efd;
+	}
+	if (ioctl(r->fd, VPU_IOCTL_RING_SETUP, &setup))
+		return -1;
+
+	r->size = setup.mmap_size;
+	r->mem = mmap(NULL, r->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		      r->fd, VPU_RING_MMAP_OFFSET);
+	if (r->mem == MAP_FAILED)
+		return -1;
+	r->ctrl = r->mem;
+	r->sqes = (void *)((char *)r->mem + r->ctrl->sq_off);
+	r->cqes = (void *)((char *)r->mem + r->ctrl->cq_off);
+
+	for (i = 0; i < NR_BUF; i++) {
+		reg.index = i;
+		reg.fd = buf_fd[i];
+		if (ioctl(r->fd, VPU_IOCTL_RING_REG_BUF, &reg))
+			return -1;
+	}
+
+	return 0;
+}
+
+static void ring_close(struct ring *r)
+{
+	if (r->mem && r->mem != MAP_FAILED)
+		munmap(r->mem, r->size);
+	if (r->efd >= 0)
+		close(r->efd);
+	if (r->fd >= 0)
+		close(r->fd);
+}
+
+/* queues out = algo(in0[, in1]) on PLANE_LEN bytes of the buffers */
+static void ring_queue(struct ring *r, int algo, int in0, int in1, int out,
+		       uint32_t flags, uint64_t user_data)
+{
+	struct vpu_ring_sqe *sqe;
+	int port[3] = { in0, in1, out };
+	int i, n = 0;
+
+	sqe = &r->sqes[r->sq_tail & (r->ctrl->sq_entries - 1)];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->user_data = user_data;
+	sqe->flags = flags;
+	sqe->requested_core = VPU_CORE_COMMON;
+	sqe->algo_id[0] = algo;
+	sqe->boost_value = 0xff;
+	sqe->sett_buf = VPU_RING_NO_BUF;
+
+	for (i = 0; i < 3; i++) {
+		if (port[i] < 0)
+			continue;
+		sqe->buffers[n].port_id = n;
+		sqe->buffers[n].format = VPU_BUF_FORMAT_IMG_Y8;
+		sqe->buffers[n].plane_count = 1;
+		sqe->buffers[n].width = PLANE_LEN;
+		sqe->buffers[n].height = 1;
+		sqe->buffers[n].planes[0].stride = PLANE_LEN;
+		sqe->buffers[n].planes[0].length = PLANE_LEN;
+		sqe->plane_buf[n][0] = port[i];
+		n++;
+	}
+	sqe->buffer_count = n;
+
+	r->sq_tail++;
+	__atomic_store_n(&r->ctrl->sq_tail, r->sq_tail, __ATOMIC_RELEASE);
+}
+
+static int ring_enter(struct ring *r, unsigned int to_submit,
+		      unsigned int min_complete, unsigned int *submitted)
+{
+	struct vpu_ring_enter enter = {
+		.to_submit = to_submit,
+		.min_complete = min_complete,
+	};
+	int ret;
+
+	ret = ioctl(r->fd, VPU_IOCTL_RING_ENTER, &enter);
+	if (submitted)
+		*submitted = enter.submitted;
+
+	return ret;
+}
+
+static unsigned int ring_ready(struct ring *r)
+{
+	return __atomic_load_n(&r->ctrl->cq_tail, __ATOMIC_ACQUIRE) -
+		r->cq_head;
+}
+
+/* reaps one cqe, returns its status or -1 if there is none */
+static int ring_reap(struct ring *r, uint64_t *user_data)
+{
+	struct vpu_ring_cqe *cqe;
+	int status;
+
+	if (!ring_ready(r))
+		return -1;
+
+	cqe = &r->cqes[r->cq_head & (r->ctrl->cq_entries - 1)];
+	*user_data = cqe->user_data;
+	status = cqe->status;
+	r->cq_head++;
+	__atomic_store_n(&r->ctrl->cq_head, r->cq_head, __ATOMIC_RELEASE);
+
+	return status;
+}
+
+static void fill(int buf, uint8_t seed)
+{
+	int i;
+
+	for (i = 0; i < PLANE_LEN; i++)
+		buf_va[buf][i] = (uint8_t)(seed + i * 7);
+}
+
+static int check(int buf, int (*expect)(int i))
+{
+	int i;
+
+	for (i = 0; i < PLANE_LEN; i++)
+		if (buf_va[buf][i] != (uint8_t)expect(i))
+			return -1;
+
+	return 0;
+}
+
+static int exp_seed1(int i) { return (uint8_t)(1 + i * 7); }
+static int exp_inv1(int i) { return 0xff - (uint8_t)(1 + i * 7); }
+static int exp_add12(int i)
+{
+	int v = (uint8_t)(1 + i * 7) + (uint8_t)(2 + i * 7);
+
+	return v > 0xff ? 0xff : v;
+}
+
+/* copy, invert and add, one job each, all in one ENTER */
+static int test_ops(void)
+{
+	struct ring r;
+	uint64_t ud, seen = 0;
+	unsigned int n;
+	int i, st, ret = -1;
+
+	if (ring_open(&r, 8, 0, 0))
+		goto out;
+
+	fill(0, 1);
+	fill(1, 2);
+	ring_queue(&r, VPU_RING_CPU_COPY, 0, -1, 2, 0, 1);
+	ring_queue(&r, VPU_RING_CPU_INVERT, 0, -1, 3, 0, 2);
+	ring_queue(&r, VPU_RING_CPU_ADD, 0, 1, 4, 0, 4);
+	if (ring_enter(&r, 3, 3, &n) || n != 3)
+		goto out;
+
+	for (i = 0; i < 3; i++) {
+		st = ring_reap(&r, &ud);
+		if (st != VPU_REQ_STATUS_SUCCESS || (seen & ud))
+			goto out;
+		seen |= ud;
+	}
+	if (seen != 7 || ring_ready(&r))
+		goto out;
+
+	if (check(2, exp_seed1) || check(3, exp_inv1) || check(4, exp_add12))
+		goto out;
+	ret = 0;
+out:
+	ring_close(&r);
+	return ret;
+}
+
+/*
+ * A chain only starts a job once the one before it succeeded: copy, invert
+ * of the copy, copy of the inverse, each reading what the one before wrote.
+ * A chain behind a failed job is flushed, also when the failed job was
+ * reaped by an earlier ENTER.
+ */
+static int test_chain(void)
+{
+	struct ring r;
+	uint64_t ud;
+	unsigned int n;
+	int i, ret = -1;
+
+	if (ring_open(&r, 8, 0, 0))
+		goto out;
+
+	fill(0, 1);
+	for (i = 2; i < 6; i++)
+		memset(buf_va[i], 0, PLANE_LEN);
+	ring_queue(&r, VPU_RING_CPU_COPY, 0, -1, 2, 0, 10);
+	ring_queue(&r, VPU_RING_CPU_INVERT, 2, -1, 3, VPU_RING_SQE_CHAIN, 11);
+	ring_queue(&r, VPU_RING_CPU_COPY, 3, -1, 5, VPU_RING_SQE_CHAIN, 12);
+	if (ring_enter(&r, 3, 3, &n) || n != 3)
+		goto out;
+	for (i = 0; i < 3; i++)
+		if (ring_reap(&r, &ud) != VPU_REQ_STATUS_SUCCESS ||
+		    ud != 10 + (uint64_t)i)
+			goto out;
+	if (check(2, exp_seed1) || check(5, exp_inv1))
+		goto out;
+
+	/* algo 0 is no cpu kernel, the job fails when it runs */
+	ring_queue(&r, 0, 0, -1, 2, 0, 20);
+	ring_queue(&r, VPU_RING_CPU_COPY, 0, -1, 3, VPU_RING_SQE_CHAIN, 21);
+	ring_queue(&r, VPU_RING_CPU_COPY, 0, -1, 4, VPU_RING_SQE_CHAIN, 22);
+	if (ring_enter(&r, 3, 3, &n) || n != 3)
+		goto out;
+	if (ring_reap(&r, &ud) != VPU_REQ_STATUS_INVALID || ud != 20 ||
+	    ring_reap(&r, &ud) != VPU_REQ_STATUS_FLUSH || ud != 21 ||
+	    ring_reap(&r, &ud) != VPU_REQ_STATUS_FLUSH || ud != 22)
+		goto out;
+
+	ring_queue(&r, VPU_RING_CPU_COPY, 0, -1, 3, VPU_RING_SQE_CHAIN, 23);
+	if (ring_enter(&r, 1, 1, &n) || n != 1 ||
+	    ring_reap(&r, &ud) != VPU_REQ_STATUS_FLUSH || ud != 23)
+		goto out;
+
+	/* an unchained job starts over */
+	ring_queue(&r, VPU_RING_CPU_COPY, 0, -1, 3, 0, 24);
+	if (ring_enter(&r, 1, 1, &n) || n != 1 ||
+	    ring_reap(&r, &ud) != VPU_REQ_STATUS_SUCCESS || ud != 24)
+		goto out;
+	ret = 0;
+out:
+	ring_close(&r);
+	return ret;
+}
+
+/* NR_BATCH jobs in one ENTER complete behind fewer eventfd signals */
+static int test_batch(unsigned long long *signals)
+{
+	struct ring r;
+	uint64_t ud, cnt = 0;
+	unsigned int n;
+	int i, ret = -1;
+
+	if (ring_open(&r, NR_BATCH, 0, 1))
+		goto out;
+
+	fill(0, 1);
+	for (i = 0; i < NR_BATCH; i++)
+		ring_queue(&r, VPU_RING_CPU_INVERT, 0, -1, 1 + i % 4, 0, i);
+	if (ring_enter(&r, NR_BATCH, NR_BATCH, &n) || n != NR_BATCH)
+		goto out;
+	for (i = 0; i < NR_BATCH; i++)
+		if (ring_reap(&r, &ud) != VPU_REQ_STATUS_SUCCESS)
+			goto out;
+
+	if (read(r.efd, &cnt, sizeof(cnt)) != sizeof(cnt))
+		goto out;
+	*signals = cnt;
+	if (cnt < 1 || cnt >= NR_BATCH)
+		goto out;
+	ret = 0;
+out:
+	ring_close(&r);
+	return ret;
+}
+
+/*
+ * The ring never takes more sqes than the cq has room for, so unreaped
+ * completions are never overwritten, and it rejects indexes user space
+ * moved out of range instead of trusting them.
+ */
+static int test_cq_full(void)
+{
+	struct ring r;
+	uint64_t ud;
+	unsigned int n, cq;
+	int i, ret = -1;
+
+	if (ring_open(&r, 4, 4, 0))
+		goto out;
+	cq = r.ctrl->cq_entries;
+
+	fill(0, 1);
+	for (i = 0; i < 4; i++)
+		ring_queue(&r, VPU_RING_CPU_COPY, 0, -1, 1, 0, i);
+	if (ring_enter(&r, 4, 4, &n) || n != 4 || ring_ready(&r) != cq)
+		goto out;
+
+	/* cq full and not reaped: nothing is taken */
+	for (i = 0; i < 4; i++)
+		ring_queue(&r, VPU_RING_CPU_COPY, 0, -1, 1, 0, 4 + i);
+	if (ring_enter(&r, 4, 0, &n) || n != 0 ||
+	    __atomic_load_n(&r.ctrl->sq_head, __ATOMIC_ACQUIRE) != 4)
+		goto out;
+
+	/* cq_head past cq_tail is garbage, nothing is taken on it */
+	for (i = 0; i < 2; i++)
+		if (ring_reap(&r, &ud) != VPU_REQ_STATUS_SUCCESS ||
+		    ud != (uint64_t)i)
+			goto out;
+	__atomic_store_n(&r.ctrl->cq_head, r.cq_head + 1000, __ATOMIC_RELEASE);
+	if (ring_enter(&r, 4, 0, &n) || n != 0)
+		goto out;
+	__atomic_store_n(&r.ctrl->cq_head, r.cq_head, __ATOMIC_RELEASE);
+
+	/* half reaped: only as many as there is room for */
+	if (ring_enter(&r, 4, 2, &n) || n != 2)
+		goto out;
+
+	/* sq_tail beyond a full sq is rejected */
+	__atomic_store_n(&r.ctrl->sq_tail, r.sq_tail + 1000, __ATOMIC_RELEASE);
+	if (ring_enter(&r, 1, 0, &n) != -1 || errno != EINVAL)
+		goto out;
+	__atomic_store_n(&r.ctrl->sq_tail, r.sq_tail, __ATOMIC_RELEASE);
+
+	/* the rest go in as the cq is reaped */
+	for (i = 2; i < 8; i++) {
+		if (ring_enter(&r, 0, 1, NULL) ||
+		    ring_reap(&r, &ud) != VPU_REQ_STATUS_SUCCESS ||
+		    ud != (uint64_t)i)
+			goto out;
+		if (i < 4 && (ring_enter(&r, 1, 0, &n) || n != 1))
+			goto out;
+	}
+	if (ring_ready(&r) ||
+	    __atomic_load_n(&r.ctrl->sq_head, __ATOMIC_ACQUIRE) != r.sq_tail)
+		goto out;
+	if (r.ctrl->cq_overflow)
+		goto out;
+	ret = 0;
+out:
+	ring_close(&r);
+	return ret;
+}
+
+static void on_alarm(int sig)
+{
+}
+
+/*
+ * A request enqueued the old way with a request_id carrying the ring tag,
+ * here the id of the next ring job, runs on the VPU and has to come back
+ * through DEQUE. The ring must neither post a cqe for it nor lose its own
+ * job of that id. Needs the VPU itself, returns 1 if it cannot run.
+ */
+static int test_forged(void)
+{
+	struct sigaction sa = { .sa_handler = on_alarm };
+	struct vpu_request req;
+	struct ring r;
+	uint64_t ud;
+	unsigned int n;
+	int ret = -1;
+
+	if (ring_open(&r, 4, 0, 0))
+		goto out;
+
+	fill(0, 1);
+	ring_queue(&r, VPU_RING_CPU_COPY, 0, -1, 1, 0, 30);
+	if (ring_enter(&r, 1, 1, &n) || n != 1 ||
+	    ring_reap(&r, &ud) != VPU_REQ_STATUS_SUCCESS)
+		goto out;
+
+	memset(&req, 0, sizeof(req));
+	req.request_id = RING_REQ_TAG << 32 | 1;
+	req.requested_core = VPU_CORE_COMMON;
+	req.power_param.boost_value = 0xff;
+	if (ioctl(r.fd, VPU_IOCTL_ENQUE_REQUEST, &req)) {
+		ret = 1;
+		goto out;
+	}
+
+	ring_queue(&r, VPU_RING_CPU_INVERT, 0, -1, 2, 0, 31);
+	if (ring_enter(&r, 1, 1, &n) || n != 1 ||
+	    ring_reap(&r, &ud) != VPU_REQ_STATUS_SUCCESS || ud != 31)
+		goto out;
+
+	sigaction(SIGALRM, &sa, NULL);
+	alarm(DEQUE_WAIT_S);
+	if (ioctl(r.fd, VPU_IOCTL_DEQUE_REQUEST, &req)) {
+		alarm(0);
+		ret = errno == EINTR ? 1 : -1;
+		goto out;
+	}
+	alarm(0);
+
+	if (ring_ready(&r) || r.ctrl->cq_overflow || check(2, exp_inv1))
+		goto out;
+	ret = 0;
+out:
+	ring_close(&r);
+	return ret;
+}
+
+/* sets the cpu backend for new rings, returns what it was or -1 */
+static int ring_cpu(int on)
+{
+	char old = '0';
+	int fd, ret;
+
+	fd = open(RING_CPU, O_RDWR);
+	if (fd < 0)
+		return -1;
+	if (read(fd, &old, 1) != 1 || lseek(fd, 0, SEEK_SET))
+		old = '0';
+	ret = write(fd, on ? "1" : "0", 1) == 1 ? old == '1' : -1;
+	close(fd);
+
+	return ret;
+}
+
+int main(void)
+{
+	unsigned long long signals = 0;
+	int i, fd, ret, old_cpu, failed = 0;
+
+	ksft_print_header();
+
+	fd = open(VPU_DEV, O_RDWR);
+	if (fd < 0)
+		ksft_exit_skip(VPU_DEV " not available, not root?\n");
+	close(fd);
+	old_cpu = ring_cpu(1);
+	if (old_cpu < 0)
+		ksft_exit_skip(RING_CPU " not available, needs CONFIG_MTK_VPU_RING_CPU\n");
+
+	ion = open(ION_DEV, O_RDONLY);
+	if (ion < 0)
+		ksft_exit_fail_msg("cannot open " ION_DEV "\n");
+	for (i = 0; i < NR_BUF; i++)
+		if (ion_buf(BUF_SIZE, &buf_fd[i], &buf_va[i]))
+			ksft_exit_fail_msg("cannot allocate ion buffer %d\n", i);
+
+	if (test_ops()) {
+		ksft_test_result_fail("copy, invert and add\n");
+		failed = 1;
+	} else {
+		ksft_test_result_pass("copy, invert and add\n");
+	}
+
+	if (test_chain()) {
+		ksft_test_result_fail("chained jobs and flush after failure\n");
+		failed = 1;
+	} else {
+		ksft_test_result_pass("chained jobs and flush after failure\n");
+	}
+
+	if (test_batch(&signals)) {
+		ksft_test_result_fail("batched completion: %llu signals for %d jobs\n",
+				      signals, NR_BATCH);
+		failed = 1;
+	} else {
+		ksft_test_result_pass("batched completion: %llu signals for %d jobs\n",
+				      signals, NR_BATCH);
+	}
+
+	if (test_cq_full()) {
+		ksft_test_result_fail("cq full and bogus indexes\n");
+		failed = 1;
+	} else {
+		ksft_test_result_pass("cq full and bogus indexes\n");
+	}
+
+	ret = test_forged();
+	if (ret > 0) {
+		ksft_test_result_skip("forged request_id: no VPU to run it\n");
+	} else if (ret) {
+		ksft_test_result_fail("forged request_id\n");
+		failed = 1;
+	} else {
+		ksft_test_result_pass("forged request_id\n");
+	}
+
+	ring_cpu(old_cpu);
+	for (i = 0; i < NR_BUF; i++) {
+		munmap(buf_va[i], BUF_SIZE);
+		close(buf_fd[i]);
+	}
+	close(ion);
+
+	return failed ? ksft_exit_fail() : ksft_exit_pass();
+}
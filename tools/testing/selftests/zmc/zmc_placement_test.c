@@ -0,0 +1,240 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * ZMC placement test
+ *
+ * Churns movable anonymous memory and pins part of it with vmsplice()
+ * into pipes, then times contiguous allocations of every zone movable
+ * cma area through debugfs/zmc_intrusion, once with anonymous pages
+ * allowed into CMA and once with them refused. Reports success rate,
+ * latency and the pinned pages found in the areas; with anonymous pages
+ * refused the pins must stay out of them.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+#include "../kselftest.h"
+
+#define INTRUSION	"/sys/kernel/debug/zmc_intrusion"
+#define CMA_DENY	"/sys/module/zmc_placement/parameters/cma_deny"
+
+#define ZMC_SITE_ANON	0
+
+#define CHUNK		(16UL << 20)
+#define ROUNDS		16
+#define PIPE_SIZE	(1 << 20)
+#define MAX_PIPES	64
+#define PROBE_PAGES	4096	/* 16MB */
+#define PROBE_TRIES	10
+#define SLACK_PAGES	64
+
+struct figures {
+	unsigned long ok, tries, avg_us, max_us;
+	unsigned long pinned, anon_pinned;
+};
+
+static long page_size;
+static int pipes[MAX_PIPES][2];
+static int nr_pipes;
+
+static int write_str(const char *path, const char *str)
+{
+	int fd = open(path, O_WRONLY);
+	int ret;
+
+	if (fd < 0)
+		return -1;
+	ret = write(fd, str, strlen(str)) == (ssize_t)strlen(str) ? 0 : -1;
+	close(fd);
+
+	return ret;
+}
+
+static int read_all(const char *path, char *buf, size_t len)
+{
+	size_t off = 0;
+	ssize_t n;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+		return -1;
+	while (off < len - 1 && (n = read(fd, buf + off, len - 1 - off)) > 0)
+		off += n;
+	close(fd);
+	buf[off] = '\0';
+
+	return off ? 0 : -1;
+}
+
+/* Sums the figures of all areas */
+static int read_figures(struct figures *f)
+{
+	static char buf[1 << 16];
+	unsigned long a, b, c, d;
+	char *line, *p;
+
+	memset(f, 0, sizeof(*f));
+	if (read_all(INTRUSION, buf, sizeof(buf)))
+		return -1;
+
+	for (line = strtok(buf, "\n"); line; line = strtok(NULL, "\n")) {
+		if (sscanf(line, "  probe: ok %lu/%lu avg_us %lu max_us %lu",
+			   &a, &b, &c, &d) == 4) {
+			f->ok += a;
+			f->tries += b;
+			f->avg_us = c > f->avg_us ? c : f->avg_us;
+			f->max_us = d > f->max_us ? d : f->max_us;
+		}
+		p = strstr(line, " pinned ");
+		if (p && !strncmp(line, "  free ", 7))
+			f->pinned += strtoul(p + 8, NULL, 10);
+		p = strstr(line, " anon ");
+		if (p && !strncmp(line, "  owners:", 9))
+			f->anon_pinned += strtoul(p + 6, NULL, 10);
+	}
+
+	return 0;
+}
+
+/* Pins [p, p + len) into pipes, returns the pages pinned */
+static unsigned long pin(char *p, unsigned long len)
+{
+	unsigned long done = 0;
+	struct iovec iov;
+	ssize_t n;
+
+	while (done < len && nr_pipes < MAX_PIPES) {
+		if (pipe(pipes[nr_pipes]))
+			break;
+		fcntl(pipes[nr_pipes][1], F_SETPIPE_SZ, PIPE_SIZE);
+		iov.iov_base = p + done;
+		iov.iov_len = len - done;
+		n = vmsplice(pipes[nr_pipes][1], &iov, 1, SPLICE_F_NONBLOCK);
+		nr_pipes++;
+		if (n <= 0)
+			break;
+		done += n;
+	}
+
+	return done / page_size;
+}
+
+static void unpin(void)
+{
+	while (nr_pipes--) {
+		close(pipes[nr_pipes][0]);
+		close(pipes[nr_pipes][1]);
+	}
+	nr_pipes = 0;
+}
+
+/*
+ * Maps, touches and unmaps chunks, keeping every other one, and pins
+ * part of each kept chunk. Unmapping a pinned chunk leaves its pages
+ * held by the pipes only.
+ */
+static unsigned long churn(char **kept)
+{
+	unsigned long pinned = 0;
+	char *p;
+	int i;
+
+	for (i = 0; i < ROUNDS; i++) {
+		p = mmap(NULL, CHUNK, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED)
+			break;
+		memset(p, i, CHUNK);
+		if (i & 1) {
+			munmap(p, CHUNK);
+			continue;
+		}
+		pinned += pin(p, CHUNK / 4);
+		kept[i] = p;
+	}
+
+	return pinned;
+}
+
+static void release(char **kept)
+{
+	int i;
+
+	unpin();
+	for (i = 0; i < ROUNDS; i++) {
+		if (kept[i])
+			munmap(kept[i], CHUNK);
+		kept[i] = NULL;
+	}
+}
+
+static void run(int deny_anon, unsigned long deny)
+{
+	char *kept[ROUNDS] = { NULL };
+	const char *name = deny_anon ? "anon refused" : "anon allowed";
+	struct figures before, after;
+	unsigned long pinned, d;
+	char cmd[64];
+
+	d = deny_anon ? deny | (1UL << ZMC_SITE_ANON) :
+			deny & ~(1UL << ZMC_SITE_ANON);
+	snprintf(cmd, sizeof(cmd), "%lu", d);
+	if (write_str(CMA_DENY, cmd) || write_str(INTRUSION, "reset") ||
+	    read_figures(&before)) {
+		ksft_test_result_fail("%s: cannot set up\n", name);
+		return;
+	}
+
+	pinned = churn(kept);
+
+	snprintf(cmd, sizeof(cmd), "probe %d %d", PROBE_PAGES, PROBE_TRIES);
+	if (write_str(INTRUSION, cmd) || read_figures(&after)) {
+		release(kept);
+		ksft_test_result_fail("%s: probe failed to run\n", name);
+		return;
+	}
+	release(kept);
+
+	ksft_print_msg("%s: %lu pages pinned, in cma: pinned %lu -> %lu, anon %lu -> %lu; %lu/%lu probes of %d pages ok, avg %lu us max %lu us\n",
+		name, pinned, before.pinned, after.pinned,
+		before.anon_pinned, after.anon_pinned, after.ok, after.tries,
+		PROBE_PAGES, after.avg_us, after.max_us);
+
+	if (!after.tries)
+		ksft_test_result_skip("%s: no area large enough\n", name);
+	else if (deny_anon &&
+		 after.anon_pinned > before.anon_pinned + SLACK_PAGES)
+		ksft_test_result_fail("%s: %lu anon pages pinned in cma\n",
+			name, after.anon_pinned - before.anon_pinned);
+	else
+		ksft_test_result_pass("%s\n", name);
+}
+
+int main(void)
+{
+	unsigned long deny;
+	char buf[64];
+
+	ksft_print_header();
+	page_size = sysconf(_SC_PAGESIZE);
+
+	if (access(INTRUSION, R_OK | W_OK) || access(CMA_DENY, R_OK | W_OK))
+		ksft_exit_skip("zmc_intrusion not available, not root?\n");
+	if (read_all(CMA_DENY, buf, sizeof(buf)))
+		ksft_exit_fail_msg("cannot read %s\n", CMA_DENY);
+	deny = strtoul(buf, NULL, 0);
+
+	run(0, deny);
+	run(1, deny);
+
+	snprintf(buf, sizeof(buf), "%lu", deny);
+	write_str(CMA_DENY, buf);
+
+	return ksft_get_fail_cnt() ? ksft_exit_fail() : ksft_exit_pass();
+}